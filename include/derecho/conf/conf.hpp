@@ -33,6 +33,8 @@ public:
     static constexpr const char* DERECHO_SST_PORT = "DERECHO/sst_port";
     static constexpr const char* DERECHO_RDMC_PORT = "DERECHO/rdmc_port";
     static constexpr const char* DERECHO_EXTERNAL_PORT = "DERECHO/external_port";
+    static constexpr const char* DERECHO_EXTERNAL_CLIENT_ID = "DERECHO/external_client_id";
+    static constexpr const char* DERECHO_EXTERNAL_CLIENT_PORT = "DERECHO/external_client_port";
     static constexpr const char* DERECHO_HEARTBEAT_MS = "DERECHO/heartbeat_ms";
     static constexpr const char* DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS = "DERECHO/p2p_loop_busy_wait_before_sleep_ms";
     static constexpr const char* DERECHO_SST_POLL_CQ_TIMEOUT_MS = "DERECHO/sst_poll_cq_timeout_ms";
@@ -44,6 +46,11 @@ public:
     static constexpr const char* DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE = "DERECHO/max_p2p_request_payload_size";
     static constexpr const char* DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE = "DERECHO/max_p2p_reply_payload_size";
     static constexpr const char* DERECHO_P2P_WINDOW_SIZE = "DERECHO/p2p_window_size";
+    static constexpr const char* DERECHO_P2P_HEDGE_PERCENTILE = "DERECHO/p2p_hedge_percentile";
+    static constexpr const char* DERECHO_P2P_HEDGE_MIN_DELAY_US = "DERECHO/p2p_hedge_min_delay_us";
+    static constexpr const char* DERECHO_MAX_QUEUED_SENDS = "DERECHO/max_queued_sends";
+    static constexpr const char* DERECHO_RPC_TRACE_PATH = "DERECHO/rpc_trace_path";
+    static constexpr const char* DERECHO_PARALLEL_APPLY_THREADS = "DERECHO/parallel_apply_threads";
 
     static constexpr const char* SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE = "SUBGROUP/DEFAULT/max_payload_size";
     static constexpr const char* SUBGROUP_DEFAULT_MAX_REPLY_PAYLOAD_SIZE = "SUBGROUP/DEFAULT/max_reply_payload_size";
@@ -51,17 +58,38 @@ public:
     static constexpr const char* SUBGROUP_DEFAULT_BLOCK_SIZE = "SUBGROUP/DEFAULT/block_size";
     static constexpr const char* SUBGROUP_DEFAULT_WINDOW_SIZE = "SUBGROUP/DEFAULT/window_size";
     static constexpr const char* SUBGROUP_DEFAULT_RDMC_SEND_ALGORITHM = "SUBGROUP/DEFAULT/rdmc_send_algorithm";
+    static constexpr const char* SUBGROUP_DEFAULT_PRIORITY = "SUBGROUP/DEFAULT/priority";
+    static constexpr const char* SUBGROUP_DEFAULT_WEIGHT = "SUBGROUP/DEFAULT/weight";
+    static constexpr const char* SUBGROUP_DEFAULT_RATE_LIMIT = "SUBGROUP/DEFAULT/rate_limit";
+    static constexpr const char* SUBGROUP_DEFAULT_SENDER_RATE_LIMIT = "SUBGROUP/DEFAULT/sender_rate_limit";
+    static constexpr const char* SUBGROUP_DEFAULT_RATE_LIMIT_BURST = "SUBGROUP/DEFAULT/rate_limit_burst";
+    static constexpr const char* SUBGROUP_DEFAULT_ADMISSION_TARGET_US = "SUBGROUP/DEFAULT/admission_target_us";
+    static constexpr const char* SUBGROUP_DEFAULT_ADMISSION_INTERVAL_US = "SUBGROUP/DEFAULT/admission_interval_us";
+    static constexpr const char* SUBGROUP_DEFAULT_COALESCE_LINGER_US = "SUBGROUP/DEFAULT/coalesce_linger_us";
+    static constexpr const char* SUBGROUP_DEFAULT_COALESCE_MAX_BYTES = "SUBGROUP/DEFAULT/coalesce_max_bytes";
+    static constexpr const char* SUBGROUP_DEFAULT_PERSISTENCE_QUORUM = "SUBGROUP/DEFAULT/persistence_quorum";
+    static constexpr const char* SUBGROUP_DEFAULT_DIRECT_LOG_PLACEMENT = "SUBGROUP/DEFAULT/direct_log_placement";
 
     static constexpr const char* RDMA_PROVIDER = "RDMA/provider";
     static constexpr const char* RDMA_DOMAIN = "RDMA/domain";
     static constexpr const char* RDMA_TX_DEPTH = "RDMA/tx_depth";
     static constexpr const char* RDMA_RX_DEPTH = "RDMA/rx_depth";
+    static constexpr const char* RDMA_HUGE_PAGES = "RDMA/huge_pages";
     static constexpr const char* PERS_FILE_PATH = "PERS/file_path";
     static constexpr const char* PERS_RAMDISK_PATH = "PERS/ramdisk_path";
+    static constexpr const char* PERS_DAX_PATH = "PERS/dax_path";
     static constexpr const char* PERS_RESET = "PERS/reset";
     static constexpr const char* PERS_MAX_LOG_ENTRY = "PERS/max_log_entry";
     static constexpr const char* PERS_MAX_DATA_SIZE = "PERS/max_data_size";
+    static constexpr const char* PERS_PREALLOCATE = "PERS/preallocate";
+    static constexpr const char* PERS_PREWARM_BYTES = "PERS/prewarm_bytes";
+    static constexpr const char* PERS_VERSION_CACHE_BYTES = "PERS/version_cache_bytes";
+    static constexpr const char* PERS_ALLOW_DIRECT_LOG_PLACEMENT = "PERS/allow_direct_log_placement";
     static constexpr const char* PERS_PRIVATE_KEY_FILE = "PERS/private_key_file";
+    static constexpr const char* NUMA_THREAD_CPUS = "NUMA/thread_cpus";
+    static constexpr const char* NUMA_PIN_TO_NIC_NODE = "NUMA/pin_to_nic_node";
+    static constexpr const char* NUMA_NIC_NODE = "NUMA/nic_node";
+    static constexpr const char* NUMA_BIND_BUFFERS = "NUMA/bind_buffers";
     static constexpr const char* LOGGER_DEFAULT_LOG_NAME = "LOGGER/default_log_name";
     static constexpr const char* LOGGER_DEFAULT_LOG_LEVEL = "LOGGER/default_log_level";
     static constexpr const char* LOGGER_SST_LOG_LEVEL = "LOGGER/sst_log_level";
@@ -100,6 +128,11 @@ private:
             {DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE, "10240"},
             {DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE, "10240"},
             {DERECHO_P2P_WINDOW_SIZE, "16"},
+            {DERECHO_P2P_HEDGE_PERCENTILE, "95"},
+            {DERECHO_P2P_HEDGE_MIN_DELAY_US, "200"},
+            {DERECHO_MAX_QUEUED_SENDS, "1024"},
+            {DERECHO_RPC_TRACE_PATH, ""},
+            {DERECHO_PARALLEL_APPLY_THREADS, "4"},
             {DERECHO_MAX_NODE_ID, "1024"},
             // [SUBGROUP/<subgroupname>]
             {SUBGROUP_DEFAULT_MAX_PAYLOAD_SIZE, "10240"},
@@ -107,19 +140,31 @@ private:
             {SUBGROUP_DEFAULT_MAX_SMC_PAYLOAD_SIZE, "10240"},
             {SUBGROUP_DEFAULT_BLOCK_SIZE, "1048576"},
             {SUBGROUP_DEFAULT_WINDOW_SIZE, "16"},
+            // The optional subgroup profile fields get their defaults from subgroupProfileOptionalFields
             {DERECHO_HEARTBEAT_MS, "1"},
             // [RDMA]
             {RDMA_PROVIDER, "sockets"},
             {RDMA_DOMAIN, "eth0"},
             {RDMA_TX_DEPTH, "256"},
             {RDMA_RX_DEPTH, "256"},
+            {RDMA_HUGE_PAGES, "false"},
             // [PERS]
             {PERS_FILE_PATH, ".plog"},
             {PERS_RAMDISK_PATH, "/dev/shm/volatile_t"},
+            {PERS_DAX_PATH, ".plog_dax"},
             {PERS_RESET, "false"},
             {PERS_MAX_LOG_ENTRY, "1048576"},       // 1M log entries.
             {PERS_MAX_DATA_SIZE, "549755813888"},  // 512G total data size.
+            {PERS_PREALLOCATE, "false"},
+            {PERS_PREWARM_BYTES, "0"},
+            {PERS_VERSION_CACHE_BYTES, "0"},
+            {PERS_ALLOW_DIRECT_LOG_PLACEMENT, "false"},
             {PERS_PRIVATE_KEY_FILE, "private_key.pem"},
+            // [NUMA]
+            {NUMA_THREAD_CPUS, ""},
+            {NUMA_PIN_TO_NIC_NODE, "false"},
+            {NUMA_NIC_NODE, "-1"},
+            {NUMA_BIND_BUFFERS, "false"},
             // [LOGGER]
             {LOGGER_DEFAULT_LOG_NAME, "derecho_debug"},
             {LOGGER_DEFAULT_LOG_LEVEL, "info"},
@@ -223,6 +268,9 @@ public:
 
     // Defines fields used for loading subgroup profiles in multicast_group.h
     static const std::vector<std::string> subgroupProfileFields;
+    // Defines the optional subgroup profile fields and the value each one
+    // takes in any profile that does not set it
+    static const std::map<std::string, uint32_t> subgroupProfileOptionalFields;
 
 private:
     // singleton
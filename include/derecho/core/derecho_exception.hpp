@@ -52,6 +52,14 @@ struct buffer_overflow_exception : public derecho_exception {
     buffer_overflow_exception(const std::string& message) : derecho_exception(message) {}
 };
 
+/**
+ * Exception that means a non-blocking send could not get a buffer, because
+ * the send window to the destination node is full.
+ */
+struct send_window_full_exception : public derecho_exception {
+    send_window_full_exception(const std::string& message) : derecho_exception(message) {}
+};
+
 /**
  * Exception that means a reference-like type is "empty" (does not contain a
  * valid object).
@@ -2,7 +2,15 @@
 
 namespace derecho {
 enum class Mode {
+    /** Totally ordered delivery, in round-robin order across the shard's senders */
     ORDERED,
-    UNORDERED
+    /** Delivery as soon as a message is received, with no ordering across senders */
+    UNORDERED,
+    /**
+     * Totally ordered delivery, in an order assigned by the shard leader acting
+     * as a sequencer. Senders that have nothing to send do not need to send
+     * nulls, so an idle or slow sender does not hold up the others.
+     */
+    SEQUENCED
 };
 }
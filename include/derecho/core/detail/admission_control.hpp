@@ -0,0 +1,141 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+
+namespace derecho {
+
+/**
+ * The outcome of a non-blocking attempt to send a multicast.
+ */
+enum class send_admission {
+    /** The message was admitted and sent. */
+    ADMITTED,
+    /** The sender's token bucket is empty; the message would exceed the rate limit. */
+    RATE_LIMITED,
+    /** The admission controller is shedding load because delivery latency is above target. */
+    OVERLOADED,
+    /** The send window is full, or the subgroup is wedged for a view change. */
+    WOULD_BLOCK
+};
+
+/**
+ * A token bucket that refills continuously at a fixed rate, up to a maximum
+ * burst. A rate of 0 means the bucket is unlimited. Not thread-safe.
+ */
+class TokenBucket {
+    double tokens_per_ns;
+    double capacity;
+    double tokens;
+    uint64_t last_refill_ns;
+
+    void refill(uint64_t now_ns);
+
+public:
+    /**
+     * @param rate_per_sec The refill rate in tokens per second, or 0 for no limit
+     * @param burst The maximum number of tokens the bucket can hold (at least 1)
+     */
+    TokenBucket(double rate_per_sec, double burst);
+
+    bool unlimited() const { return tokens_per_ns == 0; }
+    /** Changes the refill rate, keeping the tokens accumulated so far. */
+    void set_rate(double rate_per_sec);
+    /** Takes one token if one is available. */
+    bool try_consume(uint64_t now_ns);
+    /** Returns a token taken by try_consume() for an operation that did not happen. */
+    void refund();
+    /** @return The number of nanoseconds until a token will be available. */
+    uint64_t time_until_token(uint64_t now_ns);
+};
+
+/**
+ * A CoDel-style admission controller for the messages this node sends in one
+ * subgroup. It watches the time from each send to the local delivery of that
+ * message (the "sojourn time"), and if the sojourn time stays above the
+ * target for a whole interval, it starts pacing new sends: it admits one send
+ * per interval / sqrt(n) (the CoDel control law), with n growing for as long
+ * as the latency stays above target. Pacing stops as soon as a message is
+ * delivered within the target. A target of 0 disables the controller.
+ * Not thread-safe.
+ */
+class LatencyAdmissionController {
+    const uint64_t target_ns;
+    const uint64_t interval_ns;
+    /** When the sojourn time first went above target, or 0 if it is below target */
+    uint64_t first_above_time_ns = 0;
+    bool pacing = false;
+    /** The next time a send may be admitted while pacing */
+    uint64_t next_admit_ns = 0;
+    uint32_t pacing_count = 0;
+    /** The pacing slot used by the last admitted send, which cancel_admit() gives back */
+    uint64_t last_admit_slot_ns = 0;
+    bool last_admit_paced = false;
+
+    uint64_t control_law(uint64_t t_ns) const;
+
+public:
+    LatencyAdmissionController(uint64_t target_us, uint64_t interval_us);
+
+    bool enabled() const { return target_ns != 0; }
+    /** Records the sojourn time of a message sent by this node that has just been delivered. */
+    void record_sojourn(uint64_t sojourn_ns, uint64_t now_ns);
+    /** Decides whether a send may be admitted now; each admitted send uses up the current pacing slot. */
+    bool try_admit(uint64_t now_ns);
+    /** Gives back the pacing slot used by the last admitted send, if that send did not happen. */
+    void cancel_admit();
+    /** @return The number of nanoseconds until try_admit() would succeed. */
+    uint64_t time_until_admit(uint64_t now_ns) const;
+};
+
+/**
+ * The rate limits and admission control for this node's sends in one
+ * subgroup: a token bucket enforcing the smaller of the per-sender limit and
+ * this sender's share of the per-subgroup limit, followed by a latency
+ * admission controller. Thread-safe.
+ */
+class SendAdmissionControl {
+    std::mutex control_mutex;
+    const double subgroup_rate_limit;
+    const double sender_rate_limit;
+    TokenBucket bucket;
+    LatencyAdmissionController controller;
+
+    static double effective_rate(double subgroup_rate_limit, double sender_rate_limit, uint32_t num_senders);
+
+public:
+    /**
+     * @param subgroup_rate_limit The maximum total rate, in messages per second,
+     * of all senders in the shard, or 0 for no limit. Each sender enforces an
+     * equal share of it.
+     * @param sender_rate_limit The maximum rate of this sender, in messages
+     * per second, or 0 for no limit
+     * @param burst The number of messages that can be sent back-to-back
+     * before the rate limit applies
+     * @param target_delay_us The target send-to-delivery latency of the
+     * admission controller, in microseconds, or 0 to disable it
+     * @param interval_us The interval over which latency must stay above the
+     * target before the admission controller starts pacing sends
+     * @param num_senders The number of senders in the shard
+     */
+    SendAdmissionControl(uint32_t subgroup_rate_limit, uint32_t sender_rate_limit, uint32_t burst,
+                         uint32_t target_delay_us, uint32_t interval_us, uint32_t num_senders);
+
+    /** @return true if neither rate limits nor admission control are configured. */
+    bool unrestricted() const { return subgroup_rate_limit == 0 && sender_rate_limit == 0 && !controller.enabled(); }
+    /** Recomputes this sender's share of the subgroup rate limit after a view change. */
+    void set_num_senders(uint32_t num_senders);
+    /**
+     * Decides whether to admit a send now, taking a token if it does.
+     * @return ADMITTED, RATE_LIMITED, or OVERLOADED
+     */
+    send_admission try_admit();
+    /** Returns the token and the pacing slot taken by an admitted send that could not proceed. */
+    void cancel_admit();
+    /** @return The number of nanoseconds until try_admit() would succeed. */
+    uint64_t time_until_admit();
+    /** Feeds the send-to-delivery latency of one of this sender's messages to the admission controller. */
+    void record_sojourn(uint64_t sojourn_ns);
+};
+
+}  // namespace derecho
@@ -31,6 +31,13 @@ public:
      * @param my_id The ID of this node
      */
     tcp_connections(node_id_t my_id);
+    /**
+     * Starts listening on the specified port for incoming connections, if
+     * this connection manager was created without a connection_listener.
+     * Does nothing if it already listens on a port.
+     * @param my_port The port this node should listen on
+     */
+    void start_listening(uint16_t my_port);
     /**
      * Deletes all of the connections and the incoming connection listener
      * without deleting the tcp_connections object itself.
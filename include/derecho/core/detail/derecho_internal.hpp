@@ -57,11 +57,33 @@ using persistence_callback_t = std::function<void(subgroup_id_t, persistent::ver
  * Parameter 2: The version number up to which the log has been verified
  */
 using verified_callback_t = std::function<void(subgroup_id_t, persistent::version_t)>;
+/**
+ * The function type for the callbacks that resolve an optimistic delivery.
+ * Expected parameters:
+ * Parameter 1: ID of the subgroup in which the message was optimistically delivered
+ * Parameter 2: Message sender's node ID
+ * Parameter 3: Message ID
+ * Parameter 4: Persistent version the message was optimistically delivered with
+ */
+using optimistic_outcome_callback_t = std::function<void(subgroup_id_t, node_id_t, message_id_t, persistent::version_t)>;
+/**
+ * The function type for send failure callbacks. Expected parameters:
+ * Parameter 1: ID of the subgroup in which the message was sent
+ * Parameter 2: Pair containing (message body, body size)
+ */
+using send_failure_callback_t = std::function<void(subgroup_id_t, std::pair<uint8_t*, long long int>)>;
 /**
  * The type of the function used by MulticastGroup to notify RPCManager of a new message.
  * Matches the type signature of RPCManager::rpc_message_handler (but as a free function).
  */
 using rpc_handler_t = std::function<void(subgroup_id_t, node_id_t, persistent::version_t, uint64_t, uint8_t*, uint32_t)>;
+/**
+ * The function type for completion callbacks of sends queued by ViewManager::send_async.
+ * The parameter is true if the message was handed to a MulticastGroup, and false if it
+ * was dropped (because this node is no longer a sender in the subgroup, or the group is
+ * shutting down).
+ */
+using send_completion_callback_t = std::function<void(bool)>;
 
 /**
  * Bundles together a set of callback functions for message delivery events.
@@ -79,6 +101,43 @@ struct UserMessageCallbacks {
     persistence_callback_t global_persistence_callback = nullptr;
     /** A function to be called when a new version of a subgroup's state has been signed correctly by all replicas */
     verified_callback_t global_verified_callback = nullptr;
+    /**
+     * A function to be called, in ORDERED subgroups, as soon as a message has
+     * been received locally along with every message before it in the delivery
+     * order, without waiting for it to reach global stability. The message is
+     * delivered with the version it will have if it is confirmed. Every
+     * optimistically delivered message is later either confirmed or rolled
+     * back. Subgroups in other delivery modes are never delivered
+     * optimistically.
+     *
+     * Only raw sends (Replicated<RawObject>::send) carry their body to this
+     * callback. An RPC call sent with ordered_send is delivered with an empty
+     * body (std::nullopt), since its payload is a serialized invocation: the
+     * called function only runs, and its reply is only sent, when the message
+     * is delivered for good. An application that needs to act on RPCs
+     * optimistically can only use the message's sender, index and version.
+     */
+    message_callback_t optimistic_delivery_callback = nullptr;
+    /** A function to be called when an optimistically delivered message reaches global stability and is delivered for good */
+    optimistic_outcome_callback_t optimistic_confirmation_callback = nullptr;
+    /** A function to be called when an optimistically delivered message is discarded by a view change's ragged edge cleanup */
+    optimistic_outcome_callback_t optimistic_rollback_callback = nullptr;
+    /**
+     * A function to be called when a new version of a subgroup's state has been
+     * persisted on a quorum of replicas, as set by the subgroup profile's
+     * persistence_quorum (see DerechoParams)
+     */
+    persistence_callback_t quorum_persistence_callback = nullptr;
+    /**
+     * A function to be called with each raw message that send() accepted but
+     * that will never be sent, because a view change left this node without a
+     * sender role in the subgroup before the message was assigned an index.
+     * This can only happen to a message still waiting to be coalesced (see
+     * DerechoParams::coalesce_linger_us). It is called during the view change,
+     * so it must not block or send in the group. An RPC call lost this way is
+     * failed through its QueryResults instead.
+     */
+    send_failure_callback_t send_failure_callback = nullptr;
 };
 
 /** The type of factory function the user must provide to the Group constructor,
@@ -96,4 +155,13 @@ using subgroup_post_next_version_func_t = std::function<void(
         const persistent::version_t&,
         const uint64_t&)>;
 
+// to find the persistent log that a subgroup's messages can be received into
+using subgroup_placement_log_func_t = std::function<persistent::PersistLog*(const subgroup_id_t&)>;
+
+// to finish a pass of message delivery in a subgroup
+using subgroup_delivery_batch_func_t = std::function<void(const subgroup_id_t&)>;
+
+// to fail a subgroup's most recent RPC calls, which could not be sent
+using subgroup_send_failure_func_t = std::function<void(const subgroup_id_t&, const uint32_t&)>;
+
 }  // namespace derecho
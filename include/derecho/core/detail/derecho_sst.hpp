@@ -35,6 +35,12 @@ inline ChangeProposal make_change_proposal(uint16_t leader_id, uint16_t change_i
     return ChangeProposal{leader_id, change_id, false};
 }
 
+/**
+ * The number of sequencer cuts that the shard leader of a SEQUENCED-mode
+ * subgroup can have published but not yet copied by every member of the shard.
+ */
+constexpr uint32_t sequencer_cut_ring_size = 16;
+
 /**
  * ViewManager and MulticastGroup will share the same SST for efficiency. This
  * class defines all the fields in this SST.
@@ -147,6 +153,14 @@ public:
      * begins in this array.
      */
     SSTFieldVector<int32_t> num_received;
+    /**
+     * For subgroups in SEQUENCED mode, the number of sequencer cuts, indexed
+     * by subgroup number. In the shard leader's row this is the number of cuts
+     * it has published in sequencer_cuts; in every other member's row it is
+     * the number of those cuts the member has copied, and so no longer needs
+     * to be kept in the leader's ring.
+     */
+    SSTFieldVector<int32_t> num_cuts;
     /**
      * Set after calling rdmc::wedged(), reports that this member is wedged.
      * Must be after num_received!
@@ -164,10 +178,26 @@ public:
      * has published a global_min for the current view change
      */
     SSTFieldVector<bool> global_min_ready;
+    /**
+     * For subgroups in SEQUENCED mode, the number of sequencer cuts to deliver
+     * (in cut order, before the rest of the messages up to global_min) in the
+     * current view change, indexed by subgroup number. Published by each shard
+     * leader along with global_min.
+     */
+    SSTFieldVector<int32_t> global_num_cuts;
     /** for SST multicast */
     SSTFieldVector<uint8_t> slots;
     SSTFieldVector<int32_t> num_received_sst;
     SSTFieldVector<int32_t> index;
+    /**
+     * The sequencer cuts published by the shard leader of each SEQUENCED-mode
+     * subgroup. A cut contains, for each sender in the shard, the highest
+     * message index that the global order includes so far, and messages are
+     * delivered one cut at a time. Each subgroup has a ring of
+     * sequencer_cut_ring_size cuts starting at its num_received_offset times
+     * sequencer_cut_ring_size, and cut n is in position n % sequencer_cut_ring_size.
+     */
+    SSTFieldVector<int32_t> sequencer_cuts;
 
     /** to check for failures - used by the thread running check_failures_loop in derecho_group **/
     SSTFieldVector<uint64_t> local_stability_frontier;
@@ -201,19 +231,22 @@ public:
               joiner_rdmc_ports(100 + parameters.members.size()),
               joiner_external_ports(100 + parameters.members.size()),
               num_received(num_received_size),
+              num_cuts(num_subgroups),
               global_min(num_received_size),
               global_min_ready(num_subgroups),
+              global_num_cuts(num_subgroups),
               slots(slot_size),
               num_received_sst(num_received_size),
               index(index_field_size),
+              sequencer_cuts(num_received_size * sequencer_cut_ring_size),
               local_stability_frontier(num_subgroups) {
         SSTInit(seq_num, delivered_num, signatures,
                 persisted_num, verified_num,
                 vid, suspected, changes, joiner_ips,
                 joiner_gms_ports, joiner_state_transfer_ports, joiner_sst_ports, joiner_rdmc_ports, joiner_external_ports,
                 num_changes, num_committed, num_acked, num_installed,
-                num_received, wedged, global_min, global_min_ready,
-                slots, num_received_sst, index, local_stability_frontier, rip);
+                num_received, num_cuts, wedged, global_min, global_min_ready, global_num_cuts,
+                slots, num_received_sst, index, sequencer_cuts, local_stability_frontier, rip);
         //Once superclass constructor has finished, table entries can be initialized
         for(unsigned int row = 0; row < get_num_rows(); ++row) {
             vid[row] = 0;
@@ -231,6 +264,9 @@ public:
             for(size_t i = 0; i < global_min.size(); ++i) {
                 global_min[row][i] = 0;
             }
+            for(size_t i = 0; i < global_num_cuts.size(); ++i) {
+                global_num_cuts[row][i] = 0;
+            }
             memset(const_cast<uint32_t*>(joiner_ips[row]), 0, joiner_ips.size());
             memset(const_cast<uint16_t*>(joiner_gms_ports[row]), 0, joiner_gms_ports.size());
             memset(const_cast<uint16_t*>(joiner_state_transfer_ports[row]), 0, joiner_state_transfer_ports.size());
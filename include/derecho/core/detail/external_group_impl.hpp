@@ -1,5 +1,9 @@
 #include "../external_group.hpp"
 #include "version_code.hpp"
+#include "derecho/utils/placement.hpp"
+#include "derecho/utils/time.h"
+
+#include <cstring>
 
 namespace derecho {
 
@@ -9,7 +13,9 @@ ExternalClientCaller<T, ExternalGroupType>::ExternalClientCaller(subgroup_type_i
           subgroup_id(subgroup_id),
           group_client(group_client),
           wrapped_this(rpc::make_remote_invoker<T>(nid, type_id, subgroup_id,
-                                                   T::register_functions(), *group_client.receivers)) {
+                                                   T::register_functions(), *group_client.receivers)),
+          hedge_latency_tracker(std::make_shared<rpc::ReplyLatencyTracker>()),
+          hedge_timer(rpc::HedgeTimer::get()) {
     this->client_stub_mutex = std::make_unique<std::mutex>();
 }
 
@@ -78,13 +84,13 @@ void ExternalClientCaller<T, ExternalGroupType>::add_p2p_connection(node_id_t de
             throw derecho_exception("Leader rejected join, ID already in use.");
         }
         sock.write(ExternalClientRequest::ESTABLISH_P2P);
-        sock.write(getConfUInt16(Conf::DERECHO_EXTERNAL_PORT));
+        sock.write(group_client.my_external_port);
     } catch(tcp::socket_error&) {
         throw derecho_exception("Failed to establish P2P connection: socket error while sending join request.");
     }
 
     assert(dest_node != node_id);
-    if(!sst::add_external_node(dest_node, {group_client.curr_view->member_ips_and_ports[rank].ip_address,
+    if(!sst::add_external_node(group_client.my_id, dest_node, {group_client.curr_view->member_ips_and_ports[rank].ip_address,
                                            group_client.curr_view->member_ips_and_ports[rank].external_port})) {
         dbg_default_error("Failed to set up a TCP connection to {} on {}:{}", dest_node, group_client.curr_view->member_ips_and_ports[rank].ip_address, group_client.curr_view->member_ips_and_ports[rank].external_port);
         throw derecho_exception("Failed to establish P2P connection: sst::add_external_node failed");
@@ -95,17 +101,43 @@ void ExternalClientCaller<T, ExternalGroupType>::add_p2p_connection(node_id_t de
 template <typename T, typename ExternalGroupType>
 template <rpc::FunctionTag tag, typename... Args>
 auto ExternalClientCaller<T, ExternalGroupType>::p2p_send(node_id_t dest_node, Args&&... args) {
+    return p2p_send_until<tag>(dest_node, 0, true, std::forward<Args>(args)...);
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::p2p_send_with_deadline(node_id_t dest_node, std::chrono::nanoseconds timeout, Args&&... args) {
+    return p2p_send_until<tag>(dest_node, get_walltime() + timeout.count(), true, std::forward<Args>(args)...);
+}
+
+template <typename T, typename ExternalGroupType>
+template <typename Ret>
+void ExternalClientCaller<T, ExternalGroupType>::cancel(node_id_t dest_node, const rpc::QueryResults<Ret>& results) {
+    group_client.send_p2p_cancel(dest_node, results.get_p2p_request_id());
+}
+
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::p2p_send_until(node_id_t dest_node, uint64_t deadline, bool wait_for_buffer, Args&&... args) {
     add_p2p_connection(dest_node);
 
     uint64_t message_seq_num;
     auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
-            [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
+            [this, &dest_node, deadline, wait_for_buffer, &message_seq_num](size_t size) -> uint8_t* {
                 const std::size_t max_p2p_request_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
                 if(size <= max_p2p_request_payload_size) {
-                    auto buffer_handle = group_client.get_sendbuffer_ptr(dest_node,
-                                                                         sst::MESSAGE_TYPE::P2P_REQUEST);
-                    message_seq_num = buffer_handle.seq_num;
-                    return buffer_handle.buf_ptr;
+                    std::optional<sst::P2PBufferHandle> buffer_handle;
+                    if(wait_for_buffer) {
+                        buffer_handle = group_client.get_p2p_request_buffer(dest_node, deadline);
+                    } else {
+                        buffer_handle = group_client.try_get_p2p_request_buffer(dest_node, deadline);
+                        if(!buffer_handle) {
+                            throw send_window_full_exception("The P2P send window to node "
+                                                             + std::to_string(dest_node) + " is full.");
+                        }
+                    }
+                    message_seq_num = buffer_handle->seq_num;
+                    return buffer_handle->buf_ptr;
                 } else {
                     throw derecho_exception("The size of serialized args exceeds the maximum message size (Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE).");
                 }
@@ -115,6 +147,27 @@ auto ExternalClientCaller<T, ExternalGroupType>::p2p_send(node_id_t dest_node, A
     return std::move(*return_pair.results);
 }
 
+template <typename T, typename ExternalGroupType>
+template <rpc::FunctionTag tag, typename... Args>
+auto ExternalClientCaller<T, ExternalGroupType>::p2p_send_hedged(node_id_t dest_node, node_id_t hedge_node, Args&&... args) {
+    // Set up the backup connection now, so sending the hedge request is not delayed by it
+    add_p2p_connection(hedge_node);
+    // Capturing this is safe because HedgedQueryResults stops its hedge timer when destroyed, and must
+    // not outlive this object. The hedge timer must not wait for a P2P buffer, so the duplicate request
+    // fails fast if there is none.
+    auto send_hedge = [this, hedge_node, hedge_args = std::make_tuple(std::decay_t<Args>(args)...)]() {
+        return std::apply([&](const auto&... a) { return p2p_send_until<tag>(hedge_node, 0, false, a...); },
+                          hedge_args);
+    };
+    auto primary_results = p2p_send<tag>(dest_node, std::forward<Args>(args)...);
+    using Ret = typename decltype(primary_results)::type;
+    auto cancel_request = [this](node_id_t node, const rpc::QueryResults<Ret>& results) {
+        cancel(node, results);
+    };
+    return rpc::HedgedQueryResults<Ret>(std::move(primary_results), dest_node, hedge_node,
+                                        send_hedge, cancel_request, hedge_latency_tracker);
+}
+
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::initialize_p2p_connections() {
     uint64_t view_max_rpc_reply_payload_size = 0;
@@ -141,7 +194,8 @@ void ExternalGroupClient<ReplicatedTypes...>::initialize_p2p_connections() {
             getConfUInt32(Conf::DERECHO_P2P_WINDOW_SIZE),
             view_max_rpc_window_size,
             getConfUInt64(Conf::DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE) + sizeof(header),
-            getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header),
+            getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header)
+                    + sizeof(rpc::remote_invocation_utilities::p2p_request_header),
             view_max_rpc_reply_payload_size + sizeof(header),
             true,
             NULL});
@@ -149,7 +203,10 @@ void ExternalGroupClient<ReplicatedTypes...>::initialize_p2p_connections() {
 
 template <typename... ReplicatedTypes>
 ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient()
-        : my_id(getConfUInt32(Conf::DERECHO_LOCAL_ID)),
+        : my_id(hasCustomizedConfKey(Conf::DERECHO_EXTERNAL_CLIENT_ID) ? getConfUInt32(Conf::DERECHO_EXTERNAL_CLIENT_ID)
+                                                                        : getConfUInt32(Conf::DERECHO_LOCAL_ID)),
+          my_external_port(hasCustomizedConfKey(Conf::DERECHO_EXTERNAL_CLIENT_PORT) ? getConfUInt16(Conf::DERECHO_EXTERNAL_CLIENT_PORT)
+                                                                                    : getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)),
           receivers(new std::decay_t<decltype(*receivers)>()),
           // ExternalGroupClient needs to create the RPC logger since P2PConnectionManager uses it (but there is no RPCManager to create it)
           rpc_logger(LoggerFactory::createIfAbsent(LoggerFactory::RPC_LOGGER_NAME, getConfString(Conf::LOGGER_RPC_LOG_LEVEL))),
@@ -157,11 +214,11 @@ ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient()
     RpcLoggerPtr::initialize();
 #ifdef USE_VERBS_API
     sst::verbs_initialize({},
-                          std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)}}},
+                          std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), my_external_port}}},
                           my_id);
 #else
     sst::lf_initialize({},
-                       std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)}}},
+                       std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), my_external_port}}},
                        my_id);
 #endif
 
@@ -180,7 +237,10 @@ template <typename... ReplicatedTypes>
 ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient(
         std::vector<DeserializationContext*> deserialization_contexts,
         std::function<std::unique_ptr<ReplicatedTypes>()>... factories)
-        : my_id(getConfUInt32(Conf::DERECHO_LOCAL_ID)),
+        : my_id(hasCustomizedConfKey(Conf::DERECHO_EXTERNAL_CLIENT_ID) ? getConfUInt32(Conf::DERECHO_EXTERNAL_CLIENT_ID)
+                                                                        : getConfUInt32(Conf::DERECHO_LOCAL_ID)),
+          my_external_port(hasCustomizedConfKey(Conf::DERECHO_EXTERNAL_CLIENT_PORT) ? getConfUInt16(Conf::DERECHO_EXTERNAL_CLIENT_PORT)
+                                                                                    : getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)),
           receivers(new std::decay_t<decltype(*receivers)>()),
 #if __GNUC__ < 9
           factories(make_kind_map(factories...)),
@@ -195,11 +255,11 @@ ExternalGroupClient<ReplicatedTypes...>::ExternalGroupClient(
     }
 #ifdef USE_VERBS_API
     sst::verbs_initialize({},
-                          std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)}}},
+                          std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), my_external_port}}},
                           my_id);
 #else
     sst::lf_initialize({},
-                       std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), getConfUInt16(Conf::DERECHO_EXTERNAL_PORT)}}},
+                       std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>{{my_id, {getConfString(Conf::DERECHO_LOCAL_IP), my_external_port}}},
                        my_id);
 #endif
 
@@ -217,6 +277,13 @@ ExternalGroupClient<ReplicatedTypes...>::~ExternalGroupClient() {
     if(rpc_listener_thread.joinable()) {
         rpc_listener_thread.join();
     }
+    // Release the P2P connections before the transport they use
+    p2p_connections.reset();
+#ifdef USE_VERBS_API
+    sst::verbs_destroy(my_id);
+#else
+    sst::lf_destroy(my_id);
+#endif
 }
 
 template <typename... ReplicatedTypes>
@@ -269,7 +336,7 @@ bool ExternalGroupClient<ReplicatedTypes...>::get_view(const node_id_t nid) {
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::clean_up() {
     p2p_connections->filter_to(curr_view->members);
-    sst::filter_external_to(curr_view->members);
+    sst::filter_external_to(my_id, curr_view->members);
 
     for(auto& fulfilled_pending_results_pair : fulfilled_pending_results) {
         const subgroup_id_t subgroup_id = fulfilled_pending_results_pair.first;
@@ -354,6 +421,29 @@ sst::P2PBufferHandle ExternalGroupClient<ReplicatedTypes...>::get_sendbuffer_ptr
     return *buffer;
 }
 
+template <typename... ReplicatedTypes>
+sst::P2PBufferHandle ExternalGroupClient<ReplicatedTypes...>::get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline) {
+    sst::P2PBufferHandle buffer_handle = get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+    buffer_handle.buf_ptr = remote_invocation_utilities::populate_p2p_request_header(
+            buffer_handle.buf_ptr, deadline, buffer_handle.seq_num);
+    return buffer_handle;
+}
+
+template <typename... ReplicatedTypes>
+std::optional<sst::P2PBufferHandle> ExternalGroupClient<ReplicatedTypes...>::try_get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline) {
+    std::optional<sst::P2PBufferHandle> buffer_handle;
+    try {
+        buffer_handle = p2p_connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+    if(buffer_handle) {
+        buffer_handle->buf_ptr = remote_invocation_utilities::populate_p2p_request_header(
+                buffer_handle->buf_ptr, deadline, buffer_handle->seq_num);
+    }
+    return buffer_handle;
+}
+
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num, std::weak_ptr<rpc::AbstractPendingResults> pending_results_handle) {
     try {
@@ -363,11 +453,27 @@ void ExternalGroupClient<ReplicatedTypes...>::send_p2p_message(node_id_t dest_id
     }
     std::shared_ptr<AbstractPendingResults> pending_results = pending_results_handle.lock();
     if(pending_results) {
+        pending_results->set_p2p_request_id(sequence_num);
         pending_results->fulfill_map({dest_id});
         fulfilled_pending_results[dest_subgroup_id].push_back(pending_results_handle);
     }
 }
 
+template <typename... ReplicatedTypes>
+void ExternalGroupClient<ReplicatedTypes...>::send_p2p_cancel(node_id_t dest_id, uint64_t request_id) {
+    using namespace remote_invocation_utilities;
+    auto buffer_handle = get_p2p_request_buffer(dest_id);
+    uint32_t flags = 0;
+    RPC_HEADER_FLAG_SET(flags, CANCEL);
+    populate_header(buffer_handle.buf_ptr, sizeof(request_id), rpc::Opcode{}, my_id, flags);
+    std::memcpy(buffer_handle.buf_ptr + header_space(), &request_id, sizeof(request_id));
+    try {
+        p2p_connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST, buffer_handle.seq_num);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+}
+
 template <typename... ReplicatedTypes>
 std::exception_ptr ExternalGroupClient<ReplicatedTypes...>::receive_message(
         const rpc::Opcode& indx, const node_id_t& received_from, uint8_t const* const buf,
@@ -398,9 +504,13 @@ std::exception_ptr ExternalGroupClient<ReplicatedTypes...>::receive_message(
 }
 
 template <typename... ReplicatedTypes>
-void ExternalGroupClient<ReplicatedTypes...>::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
+void ExternalGroupClient<ReplicatedTypes...>::p2p_message_handler(node_id_t sender_id, sst::MESSAGE_TYPE type, uint8_t* msg_buf) {
     using namespace remote_invocation_utilities;
     const std::size_t header_size = header_space();
+    if(type == sst::MESSAGE_TYPE::P2P_REQUEST) {
+        // Requests from group members never have deadlines or cancellations, so the rest of the header isn't needed
+        msg_buf += sizeof(p2p_request_header);
+    }
     std::size_t payload_size;
     Opcode indx;
     node_id_t received_from;
@@ -428,6 +538,7 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_message_handler(node_id_t send
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker() {
     pthread_setname_np(pthread_self(), "eg_req_wkr");
+    pin_thread("eg_req_wkr");
     using namespace remote_invocation_utilities;
     const std::size_t header_size = header_space();
     std::size_t payload_size;
@@ -487,6 +598,7 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker() {
 template <typename... ReplicatedTypes>
 void ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop() {
     pthread_setname_np(pthread_self(), "eg_rpc_lsnr");
+    pin_thread("eg_rpc_lsnr");
 
     request_worker_thread = std::thread(&ExternalGroupClient<ReplicatedTypes...>::p2p_request_worker, this);
 
@@ -501,7 +613,7 @@ void ExternalGroupClient<ReplicatedTypes...>::p2p_receive_loop() {
             auto message_handle = optional_message.value();
             // Invalid ID means the message was empty (a null reply)
             if(message_handle.sender_id != INVALID_NODE_ID) {
-                p2p_message_handler(message_handle.sender_id, message_handle.buf);
+                p2p_message_handler(message_handle.sender_id, message_handle.type, message_handle.buf);
                 p2p_connections->increment_incoming_seq_num(message_handle.sender_id, message_handle.type);
             }
 
@@ -579,6 +691,19 @@ std::vector<std::vector<node_id_t>> ExternalGroupClient<ReplicatedTypes...>::get
     return ret;
 }
 
+template <typename... ReplicatedTypes>
+template <typename SubgroupType>
+std::vector<std::vector<node_id_t>> ExternalGroupClient<ReplicatedTypes...>::get_subgroup_non_standby_members(uint32_t subgroup_index) const {
+    std::vector<std::vector<node_id_t>> ret;
+    if(subgroup_index < this->template get_number_of_subgroups<SubgroupType>()) {
+        for (const auto& sv: curr_view->subgroup_shard_views[
+                curr_view->subgroup_ids_by_type_id.at(this->template get_index_of_type<SubgroupType>())[subgroup_index]]) {
+            ret.push_back(sv.non_standby_members());
+        }
+    }
+    return ret;
+}
+
 template <typename... ReplicatedTypes>
 uint64_t ExternalGroupClient<ReplicatedTypes...>::get_oob_memory_key(void* addr) {
     return sst::P2PConnection::get_oob_memory_key(addr);
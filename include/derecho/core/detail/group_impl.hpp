@@ -7,6 +7,7 @@
 #include "derecho/mutils-serialization/SerializationSupport.hpp"
 #include "derecho/utils/container_template_functions.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 #include "derecho_internal.hpp"
 #include "make_kind_map.hpp"
 
@@ -48,6 +49,14 @@ std::vector<std::vector<node_id_t>> _Group::get_subgroup_members(uint32_t subgro
         throw derecho_exception("Error: this top-level group contains no subgroups for the selected type.");
 }
 
+template <typename SubgroupType>
+std::vector<std::vector<node_id_t>> _Group::get_subgroup_non_standby_members(uint32_t subgroup_index) {
+    if(auto gptr = dynamic_cast<GroupProjection<SubgroupType>*>(this)) {
+        return gptr->get_subgroup_non_standby_members(subgroup_index);
+    } else
+        throw derecho_exception("Error: this top-level group contains no subgroups for the selected type.");
+}
+
 template <typename SubgroupType>
 std::vector<std::vector<IpAndPorts>> _Group::get_subgroup_member_addresses(uint32_t subgroup_index) {
     if(auto gptr = dynamic_cast<GroupProjection<SubgroupType>*>(this)) {
@@ -105,6 +114,12 @@ GroupProjection<ReplicatedType>::get_subgroup_members(uint32_t subgroup_index) {
     return get_view_manager().get_subgroup_members(get_index_of_type(typeid(ReplicatedType)), subgroup_index);
 }
 
+template <typename ReplicatedType>
+std::vector<std::vector<node_id_t>>
+GroupProjection<ReplicatedType>::get_subgroup_non_standby_members(uint32_t subgroup_index) {
+    return get_view_manager().get_subgroup_non_standby_members(get_index_of_type(typeid(ReplicatedType)), subgroup_index);
+}
+
 template <typename ReplicatedType>
 std::vector<std::vector<IpAndPorts>>
 GroupProjection<ReplicatedType>::get_subgroup_member_addresses(uint32_t subgroup_index) {
@@ -256,7 +271,18 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
             // Verification callback
             [this](subgroup_id_t subgroup, persistent::version_t version) {
                 rpc_manager.notify_verification_finished(subgroup, version);
+            },
+            // Quorum persistence callback
+            [this](subgroup_id_t subgroup, persistent::version_t version) {
+                rpc_manager.notify_quorum_persistence_finished(subgroup, version);
             }};
+    // Parallel-apply subgroups finish each delivery pass in RPCManager
+    internal_callbacks.delivery_batch_callback = [this](const subgroup_id_t& subgroup) {
+        rpc_manager.end_delivery_batch(subgroup);
+    };
+    internal_callbacks.rpc_send_failure_callback = [this](const subgroup_id_t& subgroup, const uint32_t& num_calls) {
+        rpc_manager.fail_unsent_rpc_calls(subgroup, num_calls);
+    };
     view_manager.initialize_multicast_groups(callbacks, internal_callbacks);
     rpc_manager.create_connections();
     // This function registers some new-view upcalls to view_manager, so it must come before finish_setup()
@@ -266,6 +292,8 @@ Group<ReplicatedTypes...>::Group(const UserMessageCallbacks& callbacks,
     rpc_manager.start_listening();
     view_manager.start();
     persistence_manager.start();
+    // Threads pin themselves when they start, so most of them will be in the report by now
+    log_placement_report();
     dbg_default_info("Derecho Group successfully started");
 }
 
@@ -315,6 +343,16 @@ std::set<std::pair<subgroup_id_t, node_id_t>> Group<ReplicatedTypes...>::constru
                     // also erase from objects_by_subgroup_id
                     objects_by_subgroup_id.erase(subgroup_id);
                     replicated_objects.template get<FirstType>().erase(old_object);
+                } else if(old_object != replicated_objects.template get<FirstType>().end() && !in_restart) {
+                    // A warm standby that missed updates is listed as joining its own shard,
+                    // and replaces its state with the shard leader's
+                    const std::vector<node_id_t>& joined = curr_view.subgroup_shard_views.at(subgroup_id).at(shard_num).joined;
+                    if(std::find(joined.begin(), joined.end(), my_id) != joined.end()) {
+                        dbg_default_debug("Deleting old Replicated Object state for type {}; this warm standby will receive shard {}'s state again",
+                                          typeid(FirstType).name(), shard_num);
+                        objects_by_subgroup_id.erase(subgroup_id);
+                        replicated_objects.template get<FirstType>().erase(old_object);
+                    }
                 }
                 // Determine if there is existing state for this shard on another node
                 bool has_previous_leader = old_shard_leaders.size() > subgroup_id
@@ -499,7 +537,7 @@ void Group<ReplicatedTypes...>::receive_objects(const std::set<std::pair<subgrou
         ReplicatedObject* subgroup_object = objects_by_subgroup_id.at(subgroup_and_leader.first);
         try {
             if(subgroup_object->is_persistent()) {
-                persistent::version_t log_tail_length = subgroup_object->get_minimum_latest_persisted_version();
+                persistent::version_t log_tail_length = subgroup_object->get_state_transfer_log_tail();
                 dbg_default_debug("Sending log tail length of {} for subgroup {} to node {}.",
                                   log_tail_length, subgroup_and_leader.first, subgroup_and_leader.second);
                 leader_socket.get().write(log_tail_length);
@@ -535,6 +573,13 @@ void Group<ReplicatedTypes...>::leave(bool group_shutdown) {
     view_manager.leave();
 }
 
+template <typename... ReplicatedTypes>
+bool Group<ReplicatedTypes...>::drain(std::chrono::milliseconds timeout) {
+    const bool caught_up = view_manager.drain(timeout);
+    view_manager.leave();
+    return caught_up;
+}
+
 template <typename... ReplicatedTypes>
 std::vector<node_id_t> Group<ReplicatedTypes...>::get_members() {
     return view_manager.get_members();
@@ -551,6 +596,12 @@ std::vector<std::vector<node_id_t>> Group<ReplicatedTypes...>::get_subgroup_memb
     return GroupProjection<SubgroupType>::get_subgroup_members(subgroup_index);
 }
 
+template <typename... ReplicatedTypes>
+template <typename SubgroupType>
+std::vector<std::vector<node_id_t>> Group<ReplicatedTypes...>::get_subgroup_non_standby_members(uint32_t subgroup_index) {
+    return GroupProjection<SubgroupType>::get_subgroup_non_standby_members(subgroup_index);
+}
+
 template <typename... ReplicatedTypes>
 template <typename SubgroupType>
 std::vector<std::vector<IpAndPorts>> Group<ReplicatedTypes...>::get_subgroup_member_addresses(uint32_t subgroup_index) {
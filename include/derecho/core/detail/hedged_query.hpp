@@ -0,0 +1,373 @@
+/**
+ * @file hedged_query.hpp
+ *
+ * Support for "hedged" P2P queries, which send a duplicate of a read-only
+ * request to a second replica if the first is slow to reply.
+ */
+
+#pragma once
+
+#include "../derecho_type_definitions.hpp"
+#include "rpc_utils.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace derecho {
+
+namespace rpc {
+
+/**
+ * Keeps a sliding window of recent P2P reply latencies, and computes the delay
+ * after which a hedged query should send its duplicate request: the configured
+ * percentile of the recent latencies, but never less than a minimum delay.
+ * Until enough samples have been collected, the minimum delay is used.
+ * Thread-safe.
+ */
+class ReplyLatencyTracker {
+    std::mutex tracker_mutex;
+    /** A ring buffer of recent latencies, in nanoseconds */
+    std::vector<uint64_t> samples;
+    std::size_t next_sample = 0;
+    std::size_t num_samples = 0;
+    /** The percentile (0-100) of recent latencies to use as the hedge delay */
+    const double percentile;
+    const uint64_t min_delay_ns;
+    /** The hedge delay computed from the samples, refreshed every recompute_interval samples */
+    uint64_t cached_delay_ns;
+    std::size_t samples_since_recompute = 0;
+
+    static constexpr std::size_t window_size = 1024;
+    static constexpr std::size_t min_samples = 32;
+    static constexpr std::size_t recompute_interval = 64;
+
+    void recompute_delay();
+
+public:
+    /**
+     * @param percentile The percentile of recent reply latencies after which to
+     * send a hedge request
+     * @param min_delay_us The minimum time to wait before hedging, in microseconds
+     */
+    ReplyLatencyTracker(double percentile, uint64_t min_delay_us);
+    /** Constructs a tracker using the percentile and minimum delay in the configuration file. */
+    ReplyLatencyTracker();
+
+    /** Records the latency of one P2P query, from sending the request to receiving the reply. */
+    void record(std::chrono::nanoseconds latency);
+    /** @return How long a hedged query should wait for a reply before sending its duplicate request. */
+    std::chrono::nanoseconds hedge_delay();
+};
+
+/**
+ * A background thread that runs tasks at given times, which hedged queries
+ * use to send their duplicate requests on time whether or not the caller is
+ * waiting for a reply. Tasks run one at a time on the timer's thread, so they
+ * must not block; a task that cannot finish yet returns a time at which to
+ * run it again. The process shares one timer, which is started by the first
+ * call to get() and stopped (dropping any tasks that have not run) when the
+ * last shared_ptr to it is destroyed. The objects that send hedged queries
+ * hold one for as long as they exist, so that the thread is not restarted for
+ * each query.
+ */
+class HedgeTimer {
+public:
+    using task_id_t = uint64_t;
+    using time_point_t = std::chrono::steady_clock::time_point;
+    /** A task returns the time to run it again, or std::nullopt if it is done */
+    using task_t = std::function<std::optional<time_point_t>()>;
+
+private:
+    std::mutex timer_mutex;
+    /** Notified when a task is scheduled, so the timer thread can recompute its wakeup time */
+    std::condition_variable tasks_changed;
+    /** Notified when a task finishes running */
+    std::condition_variable task_finished;
+    /** Tasks that have not run yet, ordered by deadline */
+    std::map<std::pair<time_point_t, task_id_t>, task_t> tasks;
+    /** The deadline of each task in tasks, by task ID */
+    std::map<task_id_t, time_point_t> task_deadlines;
+    task_id_t next_task_id = 1;
+    /** The ID of the task that is running, or 0 if none is */
+    task_id_t running_task = 0;
+    /** True if the running task was cancelled while it ran, so it must not be run again */
+    bool running_task_cancelled = false;
+    /** Set by the destructor to stop the timer thread */
+    bool shutdown = false;
+    std::thread timer_thread;
+
+    /** Guards instance */
+    static std::mutex instance_mutex;
+    /** The process's timer, if any object still holds it */
+    static std::weak_ptr<HedgeTimer> instance;
+
+    HedgeTimer();
+    void run();
+
+public:
+    /** Stops the timer thread and waits for it to exit; must not be called from a task. */
+    ~HedgeTimer();
+    /** @return The process's timer, starting it if no other object holds it */
+    static std::shared_ptr<HedgeTimer> get();
+    /**
+     * Schedules a task to run at a deadline.
+     * @return An ID that can be passed to cancel()
+     */
+    task_id_t schedule(time_point_t deadline, task_t task);
+    /**
+     * Ensures a task will not run after this returns: removes it if it has
+     * run yet or is waiting to run again, or waits for it to finish if it is
+     * running. Does nothing if the task is done. Must not be called from a
+     * task.
+     */
+    void cancel(task_id_t task_id);
+};
+
+/**
+ * The results of a hedged P2P query. The request is first sent to a primary
+ * node; if its reply has not arrived once the hedge delay has passed, the
+ * same request is sent to a backup node, and the first reply to arrive is
+ * returned. The duplicate request is sent by HedgeTimer, so it goes out on
+ * time even if the caller has not called get() yet. The other request is
+ * cancelled if it is still queued, and otherwise its reply is discarded
+ * without being surfaced to the caller. Only read-only (P2P-callable)
+ * functions should be hedged, since both replicas may execute the call.
+ *
+ * The functions that send and cancel the requests call back into the object
+ * that created this HedgedQueryResults (a PeerCaller or ExternalClientCaller),
+ * so that object must outlive it. Destroying a HedgedQueryResults, or
+ * returning from get(), stops the hedge request from being sent later.
+ * @tparam Ret The return type of the RPC function being called
+ */
+template <typename Ret>
+class HedgedQueryResults {
+    static_assert(!std::is_void_v<Ret>, "Void RPC functions do not send replies, so they cannot be hedged");
+
+    using send_function_t = std::function<QueryResults<Ret>()>;
+    using cancel_function_t = std::function<void(node_id_t, const QueryResults<Ret>&)>;
+    using time_point_t = HedgeTimer::time_point_t;
+
+    /** How long to wait before trying again to send a hedge request whose P2P window was full */
+    static constexpr std::chrono::microseconds window_full_retry_delay{50};
+
+    /**
+     * The state shared with the hedge timer task and the reply listeners,
+     * which can run after this object has been moved.
+     */
+    struct HedgeState {
+        std::mutex mutex;
+        /** Notified each time a reply arrives from either node */
+        std::condition_variable reply_arrived;
+        /**
+         * Sends the duplicate request to the backup node without waiting for a
+         * P2P buffer, throwing send_window_full_exception if there is none;
+         * empty once the request has been sent or is no longer needed
+         */
+        send_function_t send_hedge;
+        /** The results of the duplicate request, once it has been sent */
+        std::unique_ptr<QueryResults<Ret>> hedge_results;
+        /** When the primary node's reply (or exception) arrived, if it has */
+        std::optional<time_point_t> primary_reply_time;
+        /** True once get() has found that the primary node's reply is an exception */
+        bool primary_failed = false;
+        /** When the backup node's reply (or exception) arrived, if it has */
+        std::optional<time_point_t> hedge_reply_time;
+    };
+
+    std::unique_ptr<QueryResults<Ret>> primary_results;
+    node_id_t primary_node;
+    node_id_t hedge_node;
+    /** Cancels the request that lost the race, if it is still queued at its destination */
+    cancel_function_t cancel_request;
+    std::shared_ptr<ReplyLatencyTracker> latency_tracker;
+    std::shared_ptr<HedgeTimer> timer;
+    time_point_t send_time;
+    std::shared_ptr<HedgeState> state;
+    /** The timer task that sends the duplicate request */
+    HedgeTimer::task_id_t hedge_task;
+    node_id_t responder;
+
+    /** @return A reply listener that records the arrival time of the primary's or the backup's reply */
+    static std::function<void(node_id_t)> make_reply_listener(const std::shared_ptr<HedgeState>& state, bool primary) {
+        //A weak pointer, since the state owns the QueryResults that owns the listener
+        return [weak_state = std::weak_ptr<HedgeState>(state), primary](node_id_t) {
+            if(auto state = weak_state.lock()) {
+                std::lock_guard<std::mutex> lock(state->mutex);
+                std::optional<time_point_t>& reply_time = primary ? state->primary_reply_time : state->hedge_reply_time;
+                if(!reply_time) {
+                    reply_time = std::chrono::steady_clock::now();
+                }
+                state->reply_arrived.notify_all();
+            }
+        };
+    }
+
+    /**
+     * The hedge timer task: sends the duplicate request unless the primary has
+     * already replied (and get() has not found that reply to be a failure).
+     * send_hedge must not wait for a P2P buffer, since that would hold up
+     * every other hedge on the timer thread; if the window to the backup node
+     * is full, the task is run again after a short delay.
+     * @return The time to try again, or std::nullopt once the task is done
+     */
+    static std::optional<time_point_t> send_hedge_request(const std::shared_ptr<HedgeState>& state,
+                                                          node_id_t primary_node, node_id_t hedge_node) {
+        send_function_t send_hedge;
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            //If get() finds that this reply failed, it runs the task again
+            if(state->primary_reply_time && !state->primary_failed) {
+                return std::nullopt;
+            }
+            send_hedge = state->send_hedge;
+        }
+        if(!send_hedge) {
+            return std::nullopt;
+        }
+        dbg_trace(RpcLoggerPtr::get(), "Hedging a P2P query to node {} by sending it to node {}", primary_node, hedge_node);
+        std::unique_ptr<QueryResults<Ret>> hedge_results;
+        try {
+            hedge_results = std::make_unique<QueryResults<Ret>>(send_hedge());
+        } catch(send_window_full_exception&) {
+            dbg_trace(RpcLoggerPtr::get(), "The P2P window to node {} is full; retrying the hedge request", hedge_node);
+            return std::chrono::steady_clock::now() + window_full_retry_delay;
+        } catch(derecho_exception& ex) {
+            //The primary may still reply, but get() must not wait for a hedge that will never be sent
+            dbg_warn(RpcLoggerPtr::get(), "Failed to send a hedge request to node {}: {}", hedge_node, ex.what());
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->send_hedge = nullptr;
+            state->reply_arrived.notify_all();
+            return std::nullopt;
+        }
+        //Registered without holding the state's lock, which the listener takes
+        hedge_results->set_reply_listener(make_reply_listener(state, false));
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->send_hedge = nullptr;
+        state->hedge_results = std::move(hedge_results);
+        state->reply_arrived.notify_all();
+        return std::nullopt;
+    }
+
+    /** Schedules the hedge timer task to run at a deadline */
+    void schedule_hedge(time_point_t deadline) {
+        hedge_task = timer->schedule(deadline, [state = state, primary_node = primary_node, hedge_node = hedge_node]() {
+            return send_hedge_request(state, primary_node, hedge_node);
+        });
+    }
+
+public:
+    HedgedQueryResults(QueryResults<Ret>&& primary, node_id_t primary_node, node_id_t hedge_node,
+                       send_function_t send_hedge, cancel_function_t cancel_request,
+                       std::shared_ptr<ReplyLatencyTracker> latency_tracker)
+            : primary_results(std::make_unique<QueryResults<Ret>>(std::move(primary))),
+              primary_node(primary_node),
+              hedge_node(hedge_node),
+              cancel_request(std::move(cancel_request)),
+              latency_tracker(std::move(latency_tracker)),
+              timer(HedgeTimer::get()),
+              send_time(std::chrono::steady_clock::now()),
+              state(std::make_shared<HedgeState>()),
+              responder(primary_node) {
+        state->send_hedge = std::move(send_hedge);
+        primary_results->set_reply_listener(make_reply_listener(state, true));
+        schedule_hedge(send_time + this->latency_tracker->hedge_delay());
+    }
+    HedgedQueryResults(HedgedQueryResults&&) = default;
+    HedgedQueryResults(const HedgedQueryResults&) = delete;
+    ~HedgedQueryResults() {
+        if(state) {
+            timer->cancel(hedge_task);
+        }
+    }
+
+    /**
+     * Blocks until a reply arrives from the primary node or (if the primary
+     * is slow) the backup node, and returns it. If the primary's reply is an
+     * exception, sends the duplicate request at once if it has not been sent,
+     * and waits for the backup node; if the backup's reply is an exception
+     * too, or the duplicate request could not be sent, rethrows the primary's
+     * or backup's exception.
+     */
+    Ret get() {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        std::unique_ptr<Ret> result;
+        std::exception_ptr failure;
+        bool hedge_failed = false;
+        while(!result) {
+            const bool primary_ready = state->primary_reply_time && !state->primary_failed;
+            //The backup's reply can arrive before the timer task stores its results
+            const bool hedge_ready = state->hedge_reply_time && state->hedge_results && !hedge_failed;
+            if(primary_ready || hedge_ready) {
+                const node_id_t node = primary_ready ? primary_node : hedge_node;
+                QueryResults<Ret>& results = primary_ready ? *primary_results : *state->hedge_results;
+                try {
+                    result = std::make_unique<Ret>(results.get().get(node));
+                    responder = node;
+                } catch(...) {
+                    failure = std::current_exception();
+                    (primary_ready ? state->primary_failed : hedge_failed) = true;
+                }
+                if(primary_ready && state->primary_failed && state->send_hedge) {
+                    //Don't wait out the hedge delay for a backup that is now the only hope
+                    lock.unlock();
+                    timer->cancel(hedge_task);
+                    schedule_hedge(std::chrono::steady_clock::now());
+                    lock.lock();
+                }
+                continue;
+            }
+            //Both replies are in, or the primary failed and no hedge request will be sent
+            if(state->primary_failed && (hedge_failed || (!state->hedge_results && !state->send_hedge))) {
+                std::rethrow_exception(failure);
+            }
+            state->reply_arrived.wait(lock);
+        }
+        //A hedge request is no longer needed if it has not been sent
+        state->send_hedge = nullptr;
+        lock.unlock();
+        //Once the timer task can no longer run, hedge_results won't change
+        timer->cancel(hedge_task);
+        lock.lock();
+        const bool primary_won = (responder == primary_node);
+        //The primary took at least as long as the winning reply, unless it failed sooner
+        if(primary_won || !state->primary_reply_time) {
+            latency_tracker->record((primary_won ? *state->primary_reply_time : *state->hedge_reply_time) - send_time);
+        }
+        //Don't make the slower node do work that nobody will look at
+        if(state->hedge_results && !(primary_won ? state->hedge_reply_time : state->primary_reply_time)) {
+            QueryResults<Ret>& loser_results = primary_won ? *state->hedge_results : *primary_results;
+            const node_id_t loser_node = primary_won ? hedge_node : primary_node;
+            lock.unlock();
+            try {
+                cancel_request(loser_node, loser_results);
+            } catch(node_removed_from_group_exception&) {
+                //The loser is gone anyway
+            }
+        }
+        return std::move(*result);
+    }
+
+    /** @return true if the duplicate request was sent to the backup node. */
+    bool was_hedged() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->hedge_results != nullptr;
+    }
+
+    /** @return The node whose reply get() returned (only meaningful after get() returns). */
+    node_id_t get_responder() const {
+        return responder;
+    }
+};
+
+}  // namespace rpc
+}  // namespace derecho
@@ -2,6 +2,7 @@
 
 #include "../derecho_modes.hpp"
 #include "../subgroup_info.hpp"
+#include "admission_control.hpp"
 #include "connection_manager.hpp"
 #include "derecho/conf/conf.hpp"
 #include "derecho/mutils-serialization/SerializationMacros.hpp"
@@ -9,6 +10,7 @@
 #include "derecho/rdmc/rdmc.hpp"
 #include "derecho/sst/multicast.hpp"
 #include "derecho/sst/sst.hpp"
+#include "derecho/utils/placement.hpp"
 #include "derecho_internal.hpp"
 #include "derecho_sst.hpp"
 #include "persistence_manager.hpp"
@@ -16,7 +18,9 @@
 #include <spdlog/spdlog.h>
 
 #include <assert.h>
+#include <chrono>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <list>
 #include <map>
@@ -41,10 +45,15 @@ struct __attribute__((__packed__)) header {
     uint64_t    timestamp;
     uint32_t    num_nulls;
     uint8_t     cooked_send;
-    uint8_t     resv_b1;
-    uint8_t     resv_b2;
+    /**
+     * In the first message of a coalesced SST multicast, the number of
+     * messages packed into the slot (each with its own header); otherwise 0.
+     */
+    uint16_t    num_batched;
     uint8_t     resv_b3;
-    uint64_t    resv_q4;
+    /** The size of this message, including its header, within a coalesced SST multicast */
+    uint32_t    record_size;
+    uint32_t    resv_d4;
 };
 
 /**
@@ -74,6 +83,70 @@ struct DerechoParams : public mutils::ByteRepresentable {
     rdmc::send_algorithm rdmc_send_algorithm;
     /** The TCP port to use when transferring state to new members. */
     uint32_t state_transfer_port;
+    /**
+     * The priority class of this subgroup's multicasts. When several subgroups
+     * have messages ready to send, the sender thread always sends for the one
+     * with the highest priority first, and RDMC defers the blocks of a
+     * lower-priority transfer while a higher-priority one is in progress.
+     */
+    uint32_t priority;
+    /**
+     * The relative share of sends this subgroup gets among ready subgroups of
+     * the same priority (weighted round-robin).
+     */
+    uint32_t weight;
+    /**
+     * The maximum total rate, in messages per second, at which the senders in
+     * a shard may send; each sender enforces an equal share. 0 means no limit.
+     */
+    uint32_t rate_limit;
+    /** The maximum rate, in messages per second, of each sender. 0 means no limit. */
+    uint32_t sender_rate_limit;
+    /** The number of messages a sender can send back-to-back before its rate limit applies. */
+    uint32_t rate_limit_burst;
+    /**
+     * The target send-to-delivery latency, in microseconds, of the admission
+     * controller. If a sender's messages take longer than this to be delivered
+     * for a whole admission_interval_us, it starts pacing its sends. 0 disables
+     * admission control.
+     */
+    uint32_t admission_target_us;
+    /** The interval, in microseconds, used by the admission controller. */
+    uint32_t admission_interval_us;
+    /**
+     * How long, in microseconds, a small (SST-sized) multicast may wait for
+     * more small multicasts from the same sender to be packed into the same
+     * SST slot. With 0, a slot is sent as soon as the sender is free to send
+     * it. Coalescing is disabled if this and coalesce_max_bytes are both 0.
+     */
+    uint32_t coalesce_linger_us;
+    /**
+     * The number of bytes of coalesced multicasts, including their headers,
+     * at which a coalesced slot is sent without waiting for the linger time
+     * to expire. 0 means the slot is sent when it is full. A nonzero value
+     * enables coalescing even if coalesce_linger_us is 0.
+     */
+    uint32_t coalesce_max_bytes;
+    /**
+     * The number of shard members that must have persisted a version for it
+     * to be "quorum-persisted." The quorum persistence frontier is the k-th
+     * largest persisted version among the shard members, so with k less than
+     * the shard size it is not held back by the slowest disks. 0 (or any
+     * value at least the shard size) means all members, which makes it the
+     * same as the global persistence frontier.
+     */
+    uint32_t persistence_quorum;
+    /**
+     * If nonzero, messages from other senders are received directly into the
+     * data ring of the subgroup's persistent log, so make_version() can append
+     * them without copying the payload. This requires the Replicated object to
+     * have exactly one delta-supporting Persistent<T> field with an unsigned
+     * log. Only a window of the log's data ring near its tail is registered
+     * as RDMA memory at a time. Ignored on nodes that do not set
+     * PERS/allow_direct_log_placement, since registering the ring pins page
+     * cache pages of the log file.
+     */
+    uint32_t direct_log_placement;
 
     static uint64_t compute_max_msg_size(
             const uint64_t max_payload_size,
@@ -109,14 +182,36 @@ struct DerechoParams : public mutils::ByteRepresentable {
                   unsigned int window_size,
                   unsigned int heartbeat_ms,
                   rdmc::send_algorithm rdmc_send_algorithm,
-                  uint32_t state_transfer_port)
+                  uint32_t state_transfer_port,
+                  uint32_t priority = 0,
+                  uint32_t weight = 1,
+                  uint32_t rate_limit = 0,
+                  uint32_t sender_rate_limit = 0,
+                  uint32_t rate_limit_burst = 1,
+                  uint32_t admission_target_us = 0,
+                  uint32_t admission_interval_us = 100000,
+                  uint32_t coalesce_linger_us = 0,
+                  uint32_t coalesce_max_bytes = 0,
+                  uint32_t persistence_quorum = 0,
+                  uint32_t direct_log_placement = 0)
             : max_reply_msg_size(max_reply_payload_size + sizeof(header)),
               sst_max_msg_size(max_smc_payload_size + sizeof(header)),
               block_size(block_size),
               window_size(window_size),
               heartbeat_ms(heartbeat_ms),
               rdmc_send_algorithm(rdmc_send_algorithm),
-              state_transfer_port(state_transfer_port) {
+              state_transfer_port(state_transfer_port),
+              priority(priority),
+              weight(weight),
+              rate_limit(rate_limit),
+              sender_rate_limit(sender_rate_limit),
+              rate_limit_burst(rate_limit_burst),
+              admission_target_us(admission_target_us),
+              admission_interval_us(admission_interval_us),
+              coalesce_linger_us(coalesce_linger_us),
+              coalesce_max_bytes(coalesce_max_bytes),
+              persistence_quorum(persistence_quorum),
+              direct_log_placement(direct_log_placement) {
         //if this is initialized above, DerechoParams turns abstract. idk why.
         max_msg_size = compute_max_msg_size(max_payload_size, block_size,
                                             max_payload_size > max_smc_payload_size);
@@ -151,6 +246,29 @@ struct DerechoParams : public mutils::ByteRepresentable {
         uint32_t timeout_ms = getConfUInt32(Conf::DERECHO_HEARTBEAT_MS);
         const std::string& algorithm = getConfString(prefix + Conf::subgroupProfileFields[5]);
         uint32_t state_transfer_port = getConfUInt32(Conf::DERECHO_STATE_TRANSFER_PORT);
+        // The remaining fields are optional, so older profiles keep working;
+        // their defaults are listed in Conf::subgroupProfileOptionalFields
+        auto get_optional = [&prefix](const std::string& field) {
+            return hasCustomizedConfKey(prefix + field) ? getConfUInt32(prefix + field)
+                                                        : Conf::subgroupProfileOptionalFields.at(field);
+        };
+        uint32_t priority = get_optional("priority");
+        uint32_t weight = get_optional("weight");
+        if(weight == 0) {
+            throw profile + " derecho subgroup profile has weight 0; weights must be at least 1";
+        }
+        uint32_t rate_limit = get_optional("rate_limit");
+        uint32_t sender_rate_limit = get_optional("sender_rate_limit");
+        uint32_t rate_limit_burst = get_optional("rate_limit_burst");
+        if(rate_limit_burst == 0) {
+            rate_limit_burst = window_size;
+        }
+        uint32_t admission_target_us = get_optional("admission_target_us");
+        uint32_t admission_interval_us = get_optional("admission_interval_us");
+        uint32_t coalesce_linger_us = get_optional("coalesce_linger_us");
+        uint32_t coalesce_max_bytes = get_optional("coalesce_max_bytes");
+        uint32_t persistence_quorum = get_optional("persistence_quorum");
+        uint32_t direct_log_placement = get_optional("direct_log_placement");
 
         return DerechoParams{
                 max_payload_size,
@@ -161,12 +279,27 @@ struct DerechoParams : public mutils::ByteRepresentable {
                 timeout_ms,
                 DerechoParams::send_algorithm_from_string(algorithm),
                 state_transfer_port,
+                priority,
+                weight,
+                rate_limit,
+                sender_rate_limit,
+                rate_limit_burst,
+                admission_target_us,
+                admission_interval_us,
+                coalesce_linger_us,
+                coalesce_max_bytes,
+                persistence_quorum,
+                direct_log_placement,
         };
     }
 
     DEFAULT_SERIALIZATION_SUPPORT(DerechoParams, max_msg_size, max_reply_msg_size,
                                   sst_max_msg_size, block_size, window_size,
-                                  heartbeat_ms, rdmc_send_algorithm, state_transfer_port);
+                                  heartbeat_ms, rdmc_send_algorithm, state_transfer_port,
+                                  priority, weight, rate_limit, sender_rate_limit,
+                                  rate_limit_burst, admission_target_us, admission_interval_us,
+                                  coalesce_linger_us, coalesce_max_bytes, persistence_quorum,
+                                  direct_log_placement);
 };
 
 /**
@@ -176,16 +309,32 @@ struct DerechoParams : public mutils::ByteRepresentable {
  * This is a move-only type, since memory regions can't be copied.
  */
 struct MessageBuffer {
-    std::unique_ptr<uint8_t[]> buffer;
+    registered_buffer_ptr buffer;
     std::shared_ptr<rdma::memory_region> mr;
+    /**
+     * If the buffer borrows a region of a persistent log's data ring (see
+     * DerechoParams::direct_log_placement), the log it must be returned to;
+     * nullptr if the buffer owns its memory.
+     */
+    persistent::PersistLog* placement_log = nullptr;
 
     MessageBuffer() {}
     MessageBuffer(size_t size) {
         if(size != 0) {
-            buffer = std::unique_ptr<uint8_t[]>(new uint8_t[size]);
+            buffer = make_registered_buffer(size);
             mr = std::make_shared<rdma::memory_region>(buffer.get(), size);
         }
     }
+    /**
+     * Constructs a buffer that borrows a region reserved in a persistent log.
+     * @param region The region returned by PersistLog::reservePlacement()
+     * @param log_mr The registration of the log's whole placement region
+     * @param log The log the region was reserved in
+     */
+    MessageBuffer(uint8_t* region, std::shared_ptr<rdma::memory_region> log_mr, persistent::PersistLog* log)
+            : buffer(region, registered_buffer_deleter{0, false}),
+              mr(std::move(log_mr)),
+              placement_log(log) {}
     MessageBuffer(const MessageBuffer&) = delete;
     MessageBuffer(MessageBuffer&&) = default;
     MessageBuffer& operator=(const MessageBuffer&) = delete;
@@ -237,6 +386,8 @@ struct SubgroupSettings {
     std::vector<node_id_t> members;
     /** The "is_sender" flags for members of this node's shard of the subgroup */
     std::vector<int> senders;
+    /** The "is_standby" flags for members of this node's shard of the subgroup */
+    std::vector<int> standbys;
     /** This node's sender rank within the shard (as defined by SubView::sender_rank_of) */
     int sender_rank;
     /** The offset of this node's num_received counter within the subgroup's SST section */
@@ -276,6 +427,29 @@ struct MulticastGroupCallbacks {
      * verification callback in UserMessageCallbacks).
      */
     verified_callback_t global_verified_callback;
+    /**
+     * A callback to notify internal components that a new version has reached
+     * quorum persistence (separate from the user-defined quorum persistence
+     * callback in UserMessageCallbacks).
+     */
+    persistence_callback_t quorum_persistence_callback = nullptr;
+    /**
+     * A callback that finds the persistent log a subgroup's incoming messages
+     * can be received directly into, if the subgroup uses direct log placement.
+     */
+    subgroup_placement_log_func_t placement_log_callback = nullptr;
+    /**
+     * A callback to be called after each pass of message delivery in a
+     * subgroup, before the versions it created are posted for persistence.
+     * RPCManager uses it to wait for the calls of the pass that it applies in
+     * parallel, and to create their versions.
+     */
+    subgroup_delivery_batch_func_t delivery_batch_callback = nullptr;
+    /**
+     * A callback to tell RPCManager how many of a subgroup's most recent RPC
+     * calls were dropped from a coalesced batch that could not be sent.
+     */
+    subgroup_send_failure_func_t rpc_send_failure_callback = nullptr;
 };
 
 /** Implements the low-level mechanics of tracking multicasts in a Derecho group,
@@ -307,13 +481,44 @@ private:
     /** Maps subgroup IDs for which this node is a sender to the RDMC group it should use to send.
      * Constructed incrementally in create_rdmc_sst_groups(), so it can't be const.  */
     std::map<subgroup_id_t, uint32_t> subgroup_to_rdmc_group;
-    /** Offset to add to member ranks to form RDMC group numbers. */
+    /** The first RDMC group number of the range reserved by this node's Group */
+    const uint16_t rdmc_group_num_base;
+    /** The index, within the reserved range, of the next RDMC group to create. */
     uint16_t rdmc_group_num_offset;
+    /** The RDMC group numbers created by this MulticastGroup, to destroy with it. */
+    std::vector<uint16_t> rdmc_group_numbers;
     /** false if RDMC groups haven't been created successfully */
     bool rdmc_sst_groups_created = false;
     /** Stores message buffers not currently in use. Protected by
      * msg_state_mtx */
     std::map<uint32_t, std::vector<MessageBuffer>> free_message_buffers;
+    /**
+     * The state of direct log placement in one subgroup: the persistent log
+     * whose data ring other senders' messages are received into, and the RDMA
+     * registrations of windows of that ring near the log's tail.
+     */
+    struct PlacementLog {
+        /** The log, or nullptr if the subgroup cannot use direct placement */
+        persistent::PersistLog* log = nullptr;
+        /** The registered windows, oldest first; at most the current one and the next */
+        std::vector<std::shared_ptr<rdma::memory_region>> windows;
+        /** The start of the next window to register, or nullptr if none is needed */
+        uint8_t* requested_window = nullptr;
+    };
+    /**
+     * The PlacementLog of each subgroup that uses direct log placement.
+     * Windows are registered by placement_thread, never by the receive
+     * callback, so a message that arrives before the window it needs is
+     * registered is received into an ordinary buffer instead. Buffers placed
+     * in an older window keep it registered until they are released. Filled in
+     * on the first receive, since the subgroup's Replicated object may not
+     * exist yet when this MulticastGroup is constructed. Protected by
+     * msg_state_mtx.
+     */
+    std::map<subgroup_id_t, PlacementLog> placement_logs;
+
+    /** The smallest window of a log's data ring that direct log placement registers at once */
+    static constexpr uint64_t MIN_PLACEMENT_WINDOW_SIZE = 64ull << 20;
 
     /** Index to be used the next time get_sendbuffer_ptr is called.
      * When next_message is not none, then next_message.index = future_message_index-1 */
@@ -357,6 +562,9 @@ private:
 
     /** The next message ID that can be delivered in each subgroup, indexed by subgroup number. */
     std::vector<message_id_t> next_message_to_deliver;
+    /** The sequence number of the last message passed to the optimistic
+     * delivery callback in each subgroup, indexed by subgroup number. */
+    std::vector<message_id_t> optimistically_delivered_num;
     /**
      * The minimum (persistent) version number that has finished persisting in
      * each subgroup, indexed by subgroup number.
@@ -368,6 +576,22 @@ private:
     std::vector<std::unique_ptr<std::atomic<persistent::version_t>>> minimum_persisted_version;
     mutable std::vector<std::condition_variable> minimum_persisted_cv;
     mutable std::vector<std::mutex> minimum_persisted_mtx; // for use with minimum_persisted_cv, It does not guard minimum_persisted_version
+    /**
+     * The quorum persistence frontier in each subgroup, indexed by subgroup
+     * number: the latest version that at least SubgroupSettings::profile.persistence_quorum
+     * shard members have persisted. Atomic for the same reason as minimum_persisted_version.
+     */
+    std::vector<std::unique_ptr<std::atomic<persistent::version_t>>> quorum_persisted_version;
+    /**
+     * The delivered_num and persisted_num last seen in each warm standby's
+     * row, for each subgroup that has standbys, indexed by shard rank (other
+     * members' entries are unused). Guarded by msg_state_mtx;
+     * update_min_persisted_num wakes sender_cv whenever one of them advances,
+     * since the standbys are not part of any frontier that would.
+     */
+    std::map<subgroup_id_t, std::vector<std::pair<message_id_t, persistent::version_t>>> standby_progress;
+    mutable std::vector<std::condition_variable> quorum_persisted_cv;
+    mutable std::vector<std::mutex> quorum_persisted_mtx; // for use with quorum_persisted_cv
     /**
      * The minimum (persistent) version number that has had its signature verified
      * in each subgroup, indexed by subgroup number, if the signed log feature is
@@ -382,8 +606,86 @@ private:
      */
     std::vector<std::unique_ptr<std::atomic<persistent::version_t>>> delivered_version;
 
+    /**
+     * The rate limits and admission control for each subgroup in which this
+     * node is a sender, indexed by subgroup ID. Only subgroups whose profile
+     * configures any limits have an entry. Carried over from the previous
+     * MulticastGroup on a view change, so that limits and latency history
+     * persist across views.
+     */
+    std::map<subgroup_id_t, std::unique_ptr<SendAdmissionControl>> send_admission_controls;
+
+    /**
+     * Small multicasts from this node that are waiting, up to the subgroup's
+     * coalesce_linger_us, to be sent together in one SST slot. Each message
+     * is stored with its own header, and is only assigned a message index
+     * when the batch is flushed.
+     */
+    struct CoalescedSends {
+        std::unique_ptr<uint8_t[]> buffer;
+        /** The size of buffer, which is the size of an SST slot */
+        std::size_t capacity;
+        /** The number of bytes at which the batch is flushed without waiting */
+        std::size_t flush_threshold;
+        /** The number of bytes used by complete messages */
+        std::size_t used = 0;
+        uint32_t num_messages = 0;
+        /** The time (from get_time()) at which the first message was added */
+        uint64_t first_message_time = 0;
+    };
+    /** Coalescing state for each subgroup in which this node is a sender and
+     * coalescing is enabled. Protected by msg_state_mtx. */
+    std::map<subgroup_id_t, CoalescedSends> coalesced_sends;
+    /** For each subgroup, whether the buffer returned by the last call to
+     * get_sendbuffer_ptr was in coalesced_sends rather than an SST slot or
+     * RDMC message. */
+    std::vector<bool> last_send_coalesced;
+    /** For each subgroup, the coalesced batches that have been committed to
+     * the SST multicast group but not yet pushed by sst_send_trigger. */
+    std::vector<std::vector<sst::multicast_group<DerechoSST>::slot_run>> coalesced_slot_runs;
+    /**
+     * For each subgroup in which this node is a sender, the last message
+     * index held by each of this node's SST slots, indexed by the slot's SST
+     * multicast index modulo the window size (-1 if the slot is unused). A
+     * coalesced batch holds many message indices in one slot, and receivers
+     * deliver its messages in place, so a slot can only be reused once its
+     * last message has been delivered. Protected by msg_state_mtx.
+     */
+    std::vector<std::vector<message_id_t>> sst_slot_last_index;
+    /** For each subgroup, the number of SST slots this node has reserved so far. */
+    std::vector<int32_t> num_sst_slots_reserved;
+
+    /**
+     * The delivery state of a subgroup in SEQUENCED mode. Messages are still
+     * stored in locally_stable_rdmc_messages and locally_stable_sst_messages
+     * under their round-robin sequence numbers, but they are delivered in the
+     * order given by the shard leader's cuts, and numbered (for versions and
+     * delivered_num) by their position in that order.
+     */
+    struct SequencerState {
+        /** Cuts that have been copied from the leader's row (or, at the
+         * leader, published) but not yet delivered, oldest first. */
+        std::deque<std::vector<int32_t>> pending_cuts;
+        /** The number of cuts delivered so far in this view */
+        int32_t num_delivered_cuts = 0;
+        /** The last cut delivered; -1 for every sender before the first one */
+        std::vector<int32_t> last_delivered_cut;
+        /** For each delivered cut that included messages from this node, the
+         * sequence number of the cut's last message and the highest index of
+         * this node's messages in the cut. */
+        std::deque<std::pair<message_id_t, int32_t>> own_cut_ends;
+        /** The highest index of this node's messages that every member of the
+         * shard has delivered */
+        int32_t own_index_delivered = -1;
+    };
+    /** The SequencerState of each SEQUENCED-mode subgroup this node belongs
+     * to. Protected by msg_state_mtx. */
+    std::map<subgroup_id_t, SequencerState> sequencer_states;
+
     std::recursive_mutex msg_state_mtx;
     std::condition_variable_any sender_cv;
+    /** Notified when a subgroup requests a window of its log for direct placement */
+    std::condition_variable_any placement_cv;
 
     /** The time, in milliseconds, that a sender can wait to send a message before it is considered failed. */
     unsigned int sender_timeout;
@@ -395,6 +697,10 @@ private:
 
     std::thread timeout_thread;
 
+    /** The background thread that registers windows of persistent logs for
+     * direct placement; only started if some subgroup uses it. */
+    std::thread placement_thread;
+
     /** The SST, shared between this group and its GMS. */
     std::shared_ptr<DerechoSST> sst;
 
@@ -423,9 +729,54 @@ private:
     void check_failures_loop();
 
     bool create_rdmc_sst_groups();
+    /**
+     * Throws a derecho_exception if this view needs more RDMC groups than
+     * the GROUP_NUMBER_RANGE_SIZE numbers in the Group's reserved range, since
+     * create_rdmc_sst_groups() would then reuse the numbers of its own groups.
+     * Called at the start of the constructors, before any thread is started.
+     */
+    void check_rdmc_group_count() const;
     void initialize_sst_row();
     void register_predicates();
 
+    /**
+     * Reserves a region of the subgroup's persistent log to receive an RDMC
+     * message into, if the subgroup uses direct log placement and the region
+     * lies in an already registered window. Requests the next window from
+     * placement_thread once the tail is halfway through the newest one, or
+     * has left it. Must be called with msg_state_mtx held.
+     * @param subgroup_num The subgroup the message is being received in
+     * @param length The number of bytes RDMC will write
+     * @return A MessageBuffer borrowing the reserved region, or std::nullopt if
+     * the message should be received into an ordinary buffer
+     */
+    std::optional<MessageBuffer> reserve_log_placement(subgroup_id_t subgroup_num, size_t length);
+
+    /**
+     * Registers a window of a log's data ring that placements are received
+     * into: enough for two full windows of messages from every sender in the
+     * shard, but never less than MIN_PLACEMENT_WINDOW_SIZE or more than the
+     * rest of the ring's mapping. This pins the window, which can take a
+     * while, so it must be called without msg_state_mtx held.
+     * @param subgroup_num The subgroup the log belongs to
+     * @param log The log
+     * @param start The start of the window
+     */
+    std::shared_ptr<rdma::memory_region> register_placement_window(subgroup_id_t subgroup_num,
+                                                                   persistent::PersistLog* log,
+                                                                   uint8_t* start);
+
+    /** The loop of placement_thread, which registers the windows that receives request. */
+    void register_placement_windows_loop();
+
+    /**
+     * Returns a received message's buffer after it is no longer needed: a
+     * buffer borrowed from a persistent log gives its region back to the log,
+     * and any other buffer goes back on free_message_buffers. Must be called
+     * with msg_state_mtx held.
+     */
+    void recycle_message_buffer(subgroup_id_t subgroup_num, MessageBuffer&& buffer);
+
     /**
      * Delivers a single message to the application layer, either by invoking
      * an RPC function or by calling a global stability callback.
@@ -474,7 +825,15 @@ private:
     bool version_message(SSTMessage& msg, const subgroup_id_t& subgroup_num,
                          const persistent::version_t& version, const uint64_t& msg_timestamp);
 
-    uint32_t get_num_senders(const std::vector<int>& shard_senders) {
+    /**
+     * Finishes a pass of message delivery that created new versions, up to
+     * and including version, and posts a persistence request for them.
+     * @param subgroup_num The ID of the subgroup the messages were delivered in
+     * @param version The version assigned to the last message delivered
+     */
+    void finish_delivery_batch(const subgroup_id_t& subgroup_num, const persistent::version_t& version);
+
+    uint32_t get_num_senders(const std::vector<int>& shard_senders) const {
         uint32_t num = 0;
         for(const auto i : shard_senders) {
             if(i) {
@@ -484,6 +843,20 @@ private:
         return num;
     };
 
+    /** @return true if the member with this rank in a shard is a warm standby */
+    bool is_standby(const SubgroupSettings& subgroup_settings, uint32_t shard_rank) const {
+        return !subgroup_settings.standbys.empty() && subgroup_settings.standbys[shard_rank];
+    }
+
+    /**
+     * Checks whether a member's row counts toward this node's stability
+     * frontier in a shard: warm standbys receive every message, but only
+     * their own row holds back what they deliver.
+     */
+    bool counts_toward_stability(const SubgroupSettings& subgroup_settings, uint32_t shard_rank) const {
+        return !is_standby(subgroup_settings, shard_rank) || shard_rank == subgroup_settings.shard_rank;
+    }
+
     int32_t resolve_num_received(int32_t index, uint32_t num_received_entry);
 
     /* Predicate functions for receiving and delivering messages, parameterized by subgroup.
@@ -492,6 +865,53 @@ private:
     void delivery_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                           const uint32_t num_shard_members, DerechoSST& sst);
 
+    /**
+     * Passes the messages that this node has received in order, up to its own
+     * seq_num, to the optimistic delivery callback, without waiting for the
+     * other members. Must be called with msg_state_mtx held.
+     */
+    void deliver_optimistically(subgroup_id_t subgroup_num, DerechoSST& sst);
+    /**
+     * Calls the optimistic confirmation callback for a message that is being
+     * delivered, if it was optimistically delivered earlier.
+     */
+    void confirm_optimistic_delivery(subgroup_id_t subgroup_num, node_id_t sender_id,
+                                     message_id_t index, const persistent::version_t& version);
+
+    /**
+     * The delivery trigger for subgroups in SEQUENCED mode. At the shard
+     * leader, publishes a new cut if it has received new messages; at the
+     * other members, copies the cuts the leader has published. Then delivers
+     * every cut that all members have copied and whose messages all members
+     * have received.
+     */
+    void sequenced_delivery_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
+                                    const uint32_t num_shard_members, DerechoSST& sst);
+    /**
+     * Delivers, in round-robin order, the messages of a SEQUENCED-mode
+     * subgroup that come after the cut last delivered and up to next_cut,
+     * numbering them consecutively after the current delivered_num. Must be
+     * called with msg_state_mtx held.
+     * @param next_cut The highest message index to deliver from each sender
+     * @param non_null_msgs_delivered Set to true if any message delivered was not a null
+     * @param assigned_version Set to the version of the last message delivered
+     */
+    void deliver_sequenced_messages(subgroup_id_t subgroup_num, const std::vector<int32_t>& next_cut,
+                                    bool& non_null_msgs_delivered, persistent::version_t& assigned_version);
+    /**
+     * Checks whether every member of a shard has delivered this node's
+     * message with the given index. This decides when the message's window
+     * slot and buffer can be reused, so unlike stability it also waits for
+     * warm standbys, which deliver messages in place like any other member.
+     */
+    bool delivered_by_all(subgroup_id_t subgroup_num, message_id_t index);
+    /**
+     * @return The lowest delivered_num of any member of this node's shard in
+     * a subgroup, including warm standbys, i.e. the sequence number every
+     * member has delivered up to
+     */
+    message_id_t min_shard_delivered_num(subgroup_id_t subgroup_num, const DerechoSST& sst) const;
+
     void sst_send_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                           const uint32_t num_shard_members, DerechoSST& sst);
 
@@ -515,6 +935,82 @@ private:
     void update_min_verified_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                  uint32_t num_shard_members, DerechoSST& sst);
 
+    /**
+     * Creates (or, after a view change, updates) the SendAdmissionControl for
+     * each subgroup in which this node is a sender and whose profile sets
+     * rate limits or an admission target.
+     */
+    void init_send_admission_controls();
+    /**
+     * Blocks until the subgroup's rate limits and admission controller admit
+     * a send, then takes its token.
+     * @return false if the group was wedged while waiting
+     */
+    bool wait_for_send_admission(subgroup_id_t subgroup_num);
+    /**
+     * Feeds the send-to-delivery latency of one of this node's own messages,
+     * which has just been delivered, to the subgroup's admission controller.
+     * @param send_timestamp The timestamp from the message's header
+     */
+    void record_send_latency(subgroup_id_t subgroup_num, uint64_t send_timestamp);
+    /**
+     * Hands a message that has been written into the buffer returned by
+     * get_sendbuffer_ptr to RDMC or SST for sending. Must be called with
+     * msg_state_mtx held.
+     */
+    void commit_send(subgroup_id_t subgroup_num);
+    /**
+     * Creates the CoalescedSends for each subgroup in which this node is a
+     * sender and whose profile enables coalescing, keeping any batches carried
+     * over from the previous view. A carried-over batch for a subgroup in which
+     * this node is no longer a sender is failed with fail_coalesced_sends().
+     */
+    void init_coalesced_sends();
+    /**
+     * Reports every message in a batch that will never be sent as failed:
+     * raw messages to the send failure callback, and RPC calls to RPCManager.
+     */
+    void fail_coalesced_sends(subgroup_id_t subgroup_num, const CoalescedSends& batch);
+    /**
+     * Starts placement_thread if this node allows direct log placement (see
+     * PERS/allow_direct_log_placement) and some subgroup's profile requests it.
+     * Must be called before the RDMC groups are created.
+     */
+    void init_placement_thread();
+    /**
+     * Checks whether every member of the shard has delivered far enough for
+     * this node to send an RDMC message in the subgroup without overrunning
+     * the window.
+     */
+    bool window_has_room(subgroup_id_t subgroup_num);
+    /**
+     * Checks whether every member of the shard has delivered all of the
+     * messages in the SST slot that this node's next SST multicast in the
+     * subgroup will overwrite.
+     */
+    bool sst_window_has_room(subgroup_id_t subgroup_num);
+    /**
+     * Records that this node just reserved its next SST slot in the subgroup
+     * for messages up to last_index.
+     */
+    void record_sst_slot(subgroup_id_t subgroup_num, message_id_t last_index);
+    /**
+     * Reserves space for a message in the subgroup's coalesced batch,
+     * flushing the batch first if the message does not fit.
+     * @return A pointer to write the payload to, or nullptr if the batch was
+     * full and could not be flushed yet
+     */
+    uint8_t* get_coalesced_sendbuffer_ptr(subgroup_id_t subgroup_num, long long unsigned int msg_size, bool cooked_send);
+    /**
+     * Sends the subgroup's coalesced batch, if any, in one SST slot. The batch
+     * is assigned one message index per message it contains, so every message
+     * is delivered and versioned individually. Must be called with
+     * msg_state_mtx held.
+     * @return true if the batch was sent or empty, false if there was no room
+     * in the window
+     */
+    bool flush_coalesced_sends(subgroup_id_t subgroup_num);
+
     // Internally used to automatically send a NULL message
     void get_buffer_and_send_auto_null(subgroup_id_t subgroup_num);
     /* Get a pointer into the current buffer, to write data into it before sending
@@ -539,6 +1035,8 @@ public:
      * @param sender_timeout
      * @param persistence_manager_ref A reference to the PersistenceManager
      * that will be used to persist received messages
+     * @param rdmc_group_num_base The first RDMC group number of the range
+     * reserved for this Group with rdmc::reserve_group_numbers()
      * @param already_failed (Optional) A Boolean vector indicating which
      * elements of _members are nodes that have already failed in this view
      */
@@ -551,6 +1049,7 @@ public:
             const std::map<subgroup_id_t, SubgroupSettings>& subgroup_settings_by_id,
             unsigned int sender_timeout,
             PersistenceManager& persistence_manager_ref,
+            uint16_t rdmc_group_num_base,
             std::vector<char> already_failed = {});
     /** Constructor to initialize a new MulticastGroup from an old one,
      * preserving the same settings but providing a new list of members. */
@@ -564,11 +1063,38 @@ public:
 
     ~MulticastGroup();
 
-    void deliver_messages_upto(const std::vector<int32_t>& max_indices_for_senders, subgroup_id_t subgroup_num, uint32_t num_shard_senders);
+    /**
+     * Delivers the messages left over from the current view, as decided by
+     * the ragged edge cleanup.
+     * @param max_indices_for_senders The highest index to deliver from each sender
+     * @param num_cuts For a SEQUENCED-mode subgroup, the number of sequencer
+     * cuts to deliver in cut order before delivering the rest of the messages
+     * in round-robin order; ignored in other modes.
+     */
+    void deliver_messages_upto(const std::vector<int32_t>& max_indices_for_senders, subgroup_id_t subgroup_num,
+                               uint32_t num_shard_senders, int32_t num_cuts = 0);
+    /**
+     * Computes the number of sequencer cuts that the ragged edge cleanup of a
+     * SEQUENCED-mode subgroup should deliver: the largest number, up to
+     * max_num_cuts, such that every one of those cuts lies within the messages
+     * being delivered.
+     * @param max_num_cuts The number of cuts that every surviving member has copied
+     * @param max_indices_for_senders The highest index that will be delivered from each sender
+     */
+    int32_t get_ragged_trim_num_cuts(subgroup_id_t subgroup_num, int32_t max_num_cuts,
+                                     const std::vector<int32_t>& max_indices_for_senders);
     /** Send now internally calls get_sendbuffer_ptr.
 	The user function that generates the message is supplied to send */
     bool send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
               const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send);
+    /**
+     * A non-blocking version of send(). Sends the message only if the
+     * subgroup's rate limits and admission controller admit it and there is
+     * room in the send window; otherwise returns without calling msg_generator.
+     * @return ADMITTED if the message was sent, or the reason it was not
+     */
+    send_admission try_send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                            const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send);
 
     /** Compute the global real-time stability frontier in nano seconds.
      */
@@ -586,11 +1112,70 @@ public:
      */
     bool wait_for_global_persistence_frontier(subgroup_id_t subgroup_num, persistent::version_t version) const;
 
+    /** Get the quorum persistence frontier version of local shard in a subgroup. This is the latest version which
+     *  has been persisted by at least persistence_quorum shard members (see DerechoParams); it is never behind the
+     *  global persistence frontier.
+     */
+    const persistent::version_t get_quorum_persistence_frontier(subgroup_id_t subgroup_num) const;
+
+    /** Wait until the quorum persistence frontier of local shard in a subgroup goes beyond a given version. Like
+     * wait_for_global_persistence_frontier(), returns false immediately if the version has not been delivered yet.
+     */
+    bool wait_for_quorum_persistence_frontier(subgroup_id_t subgroup_num, persistent::version_t version) const;
+
     /** Get the global verified version of local shard in a subgroup. The global verified frontier version is the latest
      * version which has been verified by all shard members.
      */
     const persistent::version_t get_global_verified_frontier(subgroup_id_t subgroup_num) const;
 
+    /**
+     * @return For each subgroup in which this node is a sender, the index of
+     * the last message it has sent or committed to sending in this view,
+     * counting a coalesced batch that has not been flushed yet, or -1 if it
+     * has not sent any.
+     */
+    std::map<subgroup_id_t, message_id_t> get_last_send_indices();
+    /**
+     * Checks whether every member of this node's shard has delivered this
+     * node's messages up to the given index, in each subgroup in the map.
+     * @param last_send_indices A map returned by get_last_send_indices()
+     */
+    bool delivered_upto(const std::map<subgroup_id_t, message_id_t>& last_send_indices);
+    /** @return the version of the latest message this node delivered in a subgroup */
+    persistent::version_t get_delivered_version(subgroup_id_t subgroup_num) const;
+    /**
+     * Waits until every member of this node's shard has delivered this node's
+     * messages up to the given indices and, in each subgroup of
+     * persisted_versions, persisted the given version. Progress is signalled
+     * on sender_cv, so the wait also ends when this MulticastGroup is wedged.
+     * @param last_send_indices A map returned by get_last_send_indices()
+     * @param persisted_versions The version to wait for in each persistent subgroup
+     * @param deadline The time to give up waiting, or std::nullopt to wait until
+     * the shard catches up or the group is wedged
+     * @return true if the shard caught up, false if the group was wedged or
+     * the deadline passed first
+     */
+    bool wait_for_drained(const std::map<subgroup_id_t, message_id_t>& last_send_indices,
+                          const std::map<subgroup_id_t, persistent::version_t>& persisted_versions,
+                          std::optional<std::chrono::steady_clock::time_point> deadline);
+    /**
+     * Waits until a warm standby in this node's shard of a subgroup has
+     * delivered every message this node has delivered so far and, if a
+     * version is given, persisted that version. Progress is signalled on
+     * sender_cv, so the wait also ends when this MulticastGroup is wedged.
+     * @param subgroup_num The subgroup
+     * @param standby_id The node ID of the warm standby
+     * @param persisted_version The version to wait for, or
+     * persistent::INVALID_VERSION if the subgroup is not persistent
+     * @param deadline The time to give up waiting, or std::nullopt to wait until
+     * the standby catches up or the group is wedged
+     * @return true if the standby caught up, false if the group was wedged or
+     * the deadline passed first
+     */
+    bool wait_for_standby(subgroup_id_t subgroup_num, node_id_t standby_id,
+                          persistent::version_t persisted_version,
+                          std::optional<std::chrono::steady_clock::time_point> deadline);
+
     /** Stops all sending and receiving in this group, in preparation for shutting it down. */
     void wedge();
     /** Debugging function; prints the current state of the SST to stdout. */
@@ -5,6 +5,7 @@
 #else
 #include "derecho/sst/detail/lf.hpp"
 #endif
+#include "derecho/utils/placement.hpp"
 
 #include <atomic>
 #include <iostream>
@@ -51,8 +52,8 @@ class P2PConnection {
     const uint32_t remote_id;
     const ConnectionParams& connection_params;
     std::shared_ptr<spdlog::logger> rpc_logger;
-    std::unique_ptr<volatile uint8_t[]> incoming_p2p_buffer;
-    std::unique_ptr<volatile uint8_t[]> outgoing_p2p_buffer;
+    derecho::volatile_registered_buffer_ptr incoming_p2p_buffer;
+    derecho::volatile_registered_buffer_ptr outgoing_p2p_buffer;
     std::unique_ptr<resources> res;
     std::map<MESSAGE_TYPE, std::atomic<uint64_t>> incoming_seq_nums_map, outgoing_seq_nums_map;
     uint64_t getOffsetSeqNum(MESSAGE_TYPE type, uint64_t seq_num);
@@ -26,6 +26,21 @@ namespace rpc {
 /** defined in rpc_manager.h */
 bool in_rpc_handler();
 
+/**
+ * defined in rpc_manager.h; true if the RPC call being handled should be
+ * acknowledged without sending its return value, because of its ReplyPolicy
+ */
+bool rpc_reply_value_omitted();
+
+/** Values of the first byte of an RPC response message */
+enum class reply_status : uint8_t {
+    VALUE = 0,
+    EXCEPTION = 1,
+    ACK_ONLY = 2,
+    /** The request was dropped before execution because it expired or was cancelled */
+    EXPIRED = 3
+};
+
 //Technically, RemoteInvocable "specializes" this template for the case where
 //the second parameter is a std::function<Ret(Args...)>. However, there is no
 //implementation for any other specialization, so this template is meaningless.
@@ -129,7 +144,14 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
          * | RemoteInvokerForClass) | shared_ptr<PendingResults> | arguments            |
          * ------------------------------------------------------------------------------
          */
-        uint8_t* serialized_args = out_alloc(size);
+        uint8_t* serialized_args;
+        try {
+            serialized_args = out_alloc(size);
+        } catch(...) {
+            //No message will carry the invocation ID, so nothing else will free it
+            delete results_heap_ptr;
+            throw;
+        }
         {
             auto buf_ptr = serialized_args + mutils::to_bytes(results_heap_ptr, serialized_args);
             auto check_size = mutils::bytes_size(results_heap_ptr) + serialize_all(buf_ptr, remote_args...);
@@ -155,14 +177,20 @@ struct RemoteInvoker<Tag, std::function<Ret(Args...)>> {
             mutils::DeserializationManager* dsm,
             const node_id_t& nid, const uint8_t* response,
             const std::function<definitely_uint8*(int)>&) {
-        bool is_exception = response[0];
+        const reply_status status = static_cast<reply_status>(response[0]);
         std::shared_ptr<PendingResults<Ret>>* results_heap_ptr;
         std::memcpy(&results_heap_ptr, (response + 1), sizeof(results_heap_ptr));
         dbg_trace(RpcLoggerPtr::get(), "Received an RPC response from node {} with invocation ID {}", nid, fmt::ptr(results_heap_ptr));
         //Hold this lock while calling set_value and all_responded to ensure that
         //only one thread will get all_responded = true and delete the pointer.
         std::unique_lock<std::mutex> results_object_lock((*results_heap_ptr)->object_mutex());
-        if(is_exception) {
+        if(status == reply_status::EXPIRED) {
+            dbg_trace(RpcLoggerPtr::get(), "Node {} dropped the request with invocation ID {} because it expired", nid, fmt::ptr(results_heap_ptr));
+            (*results_heap_ptr)->set_exception(nid, std::make_exception_ptr(request_expired_exception{nid}));
+        } else if(status == reply_status::ACK_ONLY) {
+            dbg_trace(RpcLoggerPtr::get(), "Received an acknowledgement without a value from node {} for invocation ID {}", nid, fmt::ptr(results_heap_ptr));
+            (*results_heap_ptr)->set_value_omitted(nid);
+        } else if(status == reply_status::EXCEPTION) {
             auto exception_info = mutils::from_bytes_noalloc<remote_exception_info>(nullptr, response + 1 + sizeof(results_heap_ptr));
             dbg_trace(RpcLoggerPtr::get(), "Received an exception from node {} in response to invocation ID {}", nid, fmt::ptr(results_heap_ptr));
             rls_default_error("Received an exception from node {}. Exception message: {}", nid, exception_info->exception_what);
@@ -284,15 +312,24 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
         /*
          * Response message format:
          * --------------------------------------------------------------------------------------
-         * | is_exception | address of a                     | serialized response value OR     |
+         * | reply_status | address of a                     | serialized response value OR     |
          * |              | std::shared_ptr<PendingResults>  | serialized remote_exception_info |
+         * |              |                                  | (nothing if ACK_ONLY)            |
          * --------------------------------------------------------------------------------------
          */
         try {
             const auto result = mutils::deserialize_and_run(dsm, recv_buf, remote_invocable_function);
+            if(rpc_reply_value_omitted()) {
+                const std::size_t ack_size = sizeof(invocation_id) + 1;
+                uint8_t* out = out_alloc(ack_size);
+                out[0] = static_cast<uint8_t>(reply_status::ACK_ONLY);
+                std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
+                dbg_trace(RpcLoggerPtr::get(), "Ready to send an RPC acknowledgement for invocation ID {} to node {}", fmt::ptr(invocation_id), caller);
+                return recv_ret{reply_opcode, ack_size, out, nullptr};
+            }
             const auto result_size = mutils::bytes_size(result) + sizeof(invocation_id) + 1;
             auto out = out_alloc(result_size);
-            out[0] = false;
+            out[0] = static_cast<uint8_t>(reply_status::VALUE);
             std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
             mutils::to_bytes(result, out + sizeof(invocation_id) + 1);
             dbg_trace(RpcLoggerPtr::get(), "Ready to send an RPC reply for invocation ID {} to node {}", fmt::ptr(invocation_id), caller);
@@ -310,7 +347,7 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
                 result_size = mutils::bytes_size(exception_info) + sizeof(invocation_id) + 1;
             }
             uint8_t* out = out_alloc(result_size);
-            out[0] = true;
+            out[0] = static_cast<uint8_t>(reply_status::EXCEPTION);
             std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
             mutils::to_bytes(exception_info, out + sizeof(invocation_id) + 1);
             dbg_trace(RpcLoggerPtr::get(), "Ready to send remote exception info for invocation ID {} to node {}. Exception info is: ({}, {}), with size ", fmt::ptr(invocation_id), caller, exception_info.exception_name, exception_info.exception_what, result_size);
@@ -321,7 +358,7 @@ struct RemoteInvocable<Tag, std::function<Ret(Args...)>> {
             const remote_exception_info exception_info("Unknown type", "");
             const std::size_t result_size = mutils::bytes_size(exception_info) + sizeof(invocation_id) + 1;
             uint8_t* out = out_alloc(result_size);
-            out[0] = true;
+            out[0] = static_cast<uint8_t>(reply_status::EXCEPTION);
             std::memcpy(out + 1, &invocation_id, sizeof(invocation_id));
             mutils::to_bytes(exception_info, out + sizeof(invocation_id) + 1);
             return recv_ret{reply_opcode, result_size, out,
@@ -705,6 +742,17 @@ public:
      */
     template <FunctionTag Tag, typename... Args>
     auto send(const std::function<uint8_t*(std::size_t)>& out_alloc, Args&&... args) {
+        return send_with_reply_policy<Tag>(out_alloc, ReplyPolicy::all(), std::forward<Args>(args)...);
+    }
+
+    /**
+     * Constructs a message like send(), but tells the recipients to reply
+     * according to the given ReplyPolicy instead of all sending their return
+     * values.
+     */
+    template <FunctionTag Tag, typename... Args>
+    auto send_with_reply_policy(const std::function<uint8_t*(std::size_t)>& out_alloc,
+                                const ReplyPolicy& reply_policy, Args&&... args) {
         using namespace remote_invocation_utilities;
 
         constexpr std::integral_constant<FunctionTag, Tag>* choice{nullptr};
@@ -715,10 +763,13 @@ public:
                     return out_alloc(size + header_size) + header_size;
                 },
                 std::forward<Args>(args)...);
+        //The PendingResults is still owned by sent_return.results, so the weak_ptr is valid
+        sent_return.pending.lock()->set_reply_policy(reply_policy);
 
         std::size_t payload_size = sent_return.size;
         uint8_t* buf = sent_return.buf - header_size;
         uint32_t flags = 0;
+        set_reply_policy(flags, reply_policy);
         /*
          set the cascading flag if necessary.
          This is not important because, unlike p2p_send, ordered_send/query
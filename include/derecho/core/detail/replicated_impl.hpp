@@ -4,9 +4,11 @@
 #include "view_manager.hpp"
 
 #include "derecho/mutils-serialization/SerializationSupport.hpp"
+#include "derecho/utils/time.h"
 
 #include <functional>
 #include <mutex>
+#include <optional>
 #include <utility>
 
 namespace derecho {
@@ -41,6 +43,7 @@ Replicated<T>::Replicated(subgroup_type_id_t type_id, node_id_t nid, subgroup_id
                                                    openssl::DigestAlgorithm::SHA256);
         signature_size = signer->get_max_signature_size();
     }
+    register_parallel_apply();
 }
 
 template <typename T>
@@ -68,6 +71,22 @@ Replicated<T>::Replicated(subgroup_type_id_t type_id, node_id_t nid, subgroup_id
                                                    openssl::DigestAlgorithm::SHA256);
         signature_size = signer->get_max_signature_size();
     }
+    register_parallel_apply();
+}
+
+template <typename T>
+void Replicated<T>::register_parallel_apply() {
+    if constexpr(parallel_apply_enabled_v<T>) {
+        // Capture the heap objects rather than this, which is not stable across moves
+        group_rpc_manager.register_parallel_apply(
+                subgroup_id,
+                [object = user_object_ptr.get()](rpc::FunctionTag tag, const uint8_t* args, std::size_t args_size) {
+                    return (**object).conflict_key(tag, args, args_size);
+                },
+                [registry = persistent_registry.get()](persistent::version_t ver, const HLC& hlc) {
+                    registry->makeVersion(ver, hlc);
+                });
+    }
 }
 
 template <typename T>
@@ -108,8 +127,7 @@ auto Replicated<T>::p2p_send(node_id_t dest_node, Args&&... args) const {
                 [this, &dest_node, &message_seq_num](std::size_t size) -> uint8_t* {
                     const std::size_t max_p2p_request_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
                     if(size <= max_p2p_request_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
+                        auto buffer_handle = group_rpc_manager.get_p2p_request_buffer(dest_node);
                         // Record the sequence number for this message buffer
                         message_seq_num = buffer_handle.seq_num;
                         return buffer_handle.buf_ptr;
@@ -128,6 +146,12 @@ auto Replicated<T>::p2p_send(node_id_t dest_node, Args&&... args) const {
 template <typename T>
 template <rpc::FunctionTag tag, typename... Args>
 auto Replicated<T>::ordered_send(Args&&... args) {
+    return ordered_send_with_reply_policy<tag>(rpc::ReplyPolicy::all(), std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto Replicated<T>::ordered_send_with_reply_policy(const rpc::ReplyPolicy& reply_policy, Args&&... args) {
     if(is_valid()) {
         size_t payload_size_for_multicast_send = wrapped_this->template get_size_for_ordered_send<rpc::to_internal_tag<false>(tag)>(std::forward<Args>(args)...);
 
@@ -139,7 +163,7 @@ auto Replicated<T>::ordered_send(Args&&... args) {
         auto serializer = [&](uint8_t* buffer) {
             // By the time this lambda runs, the current thread will be holding a read lock on view_mutex
             const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
-            auto send_return_struct = wrapped_this->template send<rpc::to_internal_tag<false>(tag)>(
+            auto send_return_struct = wrapped_this->template send_with_reply_policy<rpc::to_internal_tag<false>(tag)>(
                     // Invoke the sending function with a buffer-allocator that uses the buffer supplied as an argument to the serializer
                     [&buffer, &max_payload_size](size_t size) -> uint8_t* {
                         if(size <= max_payload_size) {
@@ -148,7 +172,7 @@ auto Replicated<T>::ordered_send(Args&&... args) {
                             throw buffer_overflow_exception("The size of an ordered_send message exceeds the maximum message size.");
                         }
                     },
-                    std::forward<Args>(args)...);
+                    reply_policy, std::forward<Args>(args)...);
             results_ptr = std::move(send_return_struct.results);
             pending_ptr = send_return_struct.pending;
         };
@@ -165,12 +189,65 @@ auto Replicated<T>::ordered_send(Args&&... args) {
     }
 }
 
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto Replicated<T>::try_ordered_send(Args&&... args) {
+    if(is_valid()) {
+        size_t payload_size_for_multicast_send = wrapped_this->template get_size_for_ordered_send<rpc::to_internal_tag<false>(tag)>(std::forward<Args>(args)...);
+
+        using Ret = typename std::remove_pointer<decltype(wrapped_this->template getReturnType<rpc::to_internal_tag<false>(tag)>(
+                std::forward<Args>(args)...))>::type;
+        std::unique_ptr<rpc::QueryResults<Ret>> results_ptr;
+        std::weak_ptr<rpc::PendingResults<Ret>> pending_ptr;
+        // Only called if the send is admitted, so args are not consumed otherwise
+        auto serializer = [&](uint8_t* buffer) {
+            const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
+            auto send_return_struct = wrapped_this->template send<rpc::to_internal_tag<false>(tag)>(
+                    [&buffer, &max_payload_size](size_t size) -> uint8_t* {
+                        if(size <= max_payload_size) {
+                            return buffer;
+                        } else {
+                            throw buffer_overflow_exception("The size of an ordered_send message exceeds the maximum message size.");
+                        }
+                    },
+                    std::forward<Args>(args)...);
+            results_ptr = std::move(send_return_struct.results);
+            pending_ptr = send_return_struct.pending;
+        };
+
+        std::shared_lock<std::shared_timed_mutex> view_read_lock(group_rpc_manager.view_manager.view_mutex, std::try_to_lock);
+        if(!view_read_lock.owns_lock()
+           || group_rpc_manager.view_manager.curr_view->multicast_group->try_send(
+                      subgroup_id, payload_size_for_multicast_send, serializer, true)
+                      != send_admission::ADMITTED) {
+            return std::optional<rpc::QueryResults<Ret>>{};
+        }
+        group_rpc_manager.register_rpc_results(subgroup_id, pending_ptr);
+        return std::optional<rpc::QueryResults<Ret>>{std::move(*results_ptr)};
+    } else {
+        throw empty_reference_exception{"Attempted to use an empty Replicated<T>"};
+    }
+}
+
 template <typename T>
 void Replicated<T>::send(unsigned long long int payload_size,
                          const std::function<void(uint8_t* buf)>& msg_generator) {
     group_rpc_manager.view_manager.send(subgroup_id, payload_size, msg_generator);
 }
 
+template <typename T>
+bool Replicated<T>::send_async(unsigned long long int payload_size,
+                               const std::function<void(uint8_t* buf)>& msg_generator,
+                               const send_completion_callback_t& completion_callback) {
+    return group_rpc_manager.view_manager.send_async(subgroup_id, payload_size, msg_generator, completion_callback);
+}
+
+template <typename T>
+send_admission Replicated<T>::try_send(unsigned long long int payload_size,
+                                       const std::function<void(uint8_t* buf)>& msg_generator) {
+    return group_rpc_manager.view_manager.try_send(subgroup_id, payload_size, msg_generator);
+}
+
 template <typename T>
 std::size_t Replicated<T>::object_size() const {
     return mutils::bytes_size(**user_object_ptr);
@@ -218,7 +295,12 @@ void Replicated<T>::new_view_callback(const View& new_view) {
 
 template <typename T>
 void Replicated<T>::make_version(persistent::version_t ver, const HLC& hlc) {
-    persistent_registry->makeVersion(ver, hlc);
+    if constexpr(parallel_apply_enabled_v<T>) {
+        // The call may still be running; the version is made when its delivery pass ends
+        group_rpc_manager.defer_make_version(subgroup_id, ver, hlc);
+    } else {
+        persistent_registry->makeVersion(ver, hlc);
+    }
 }
 
 template <typename T>
@@ -279,14 +361,41 @@ persistent::version_t Replicated<T>::get_minimum_latest_persisted_version() {
     return persistent_registry->getMinimumLatestPersistedVersion();
 }
 
+template <typename T>
+persistent::version_t Replicated<T>::get_state_transfer_log_tail() {
+    if constexpr(rebuilds_from_log_v<T>) {
+        if(*user_object_ptr && !(**user_object_ptr).local_log_is_complete()) {
+            dbg_default_info("Subgroup {}: the local log has been trimmed, requesting a full state transfer", subgroup_id);
+            return persistent::INVALID_VERSION;
+        }
+    }
+    return get_minimum_latest_persisted_version();
+}
+
 template <typename T>
 void Replicated<T>::post_next_version(persistent::version_t version, uint64_t ts_us) {
     current_version = version;
     current_timestamp_us = ts_us;
 }
 
+template <typename T>
+persistent::PersistLog* Replicated<T>::get_placement_log() {
+    if constexpr(has_persistent_fields<T>::value) {
+        return persistent_registry->getPlacementLog();
+    } else {
+        return nullptr;
+    }
+}
+
 template <typename T>
 std::tuple<persistent::version_t, uint64_t> Replicated<T>::get_current_version() {
+    if constexpr(parallel_apply_enabled_v<T>) {
+        // current_version has moved on to the last call delivered, which may not be the one applying
+        auto [applying_version, applying_timestamp] = rpc::parallel_apply_version();
+        if(applying_version != persistent::INVALID_VERSION) {
+            return std::make_tuple(applying_version, applying_timestamp);
+        }
+    }
     return std::tie(current_version, current_timestamp_us);
 }
 
@@ -341,6 +450,16 @@ bool Replicated<T>::wait_for_global_persistence_frontier(persistent::version_t v
     return group_rpc_manager.view_manager.wait_for_global_persistence_frontier(subgroup_id, version);
 }
 
+template <typename T>
+persistent::version_t Replicated<T>::get_quorum_persistence_frontier() {
+    return group_rpc_manager.view_manager.get_quorum_persistence_frontier(subgroup_id);
+}
+
+template <typename T>
+bool Replicated<T>::wait_for_quorum_persistence_frontier(persistent::version_t version) {
+    return group_rpc_manager.view_manager.wait_for_quorum_persistence_frontier(subgroup_id, version);
+}
+
 template <typename T>
 persistent::version_t Replicated<T>::get_global_verified_frontier() {
     return group_rpc_manager.view_manager.get_global_verified_frontier(subgroup_id);
@@ -353,13 +472,33 @@ PeerCaller<T>::PeerCaller(uint32_t type_id, node_id_t nid, subgroup_id_t subgrou
           subgroup_id(subgroup_id),
           group_rpc_manager(group_rpc_manager),
           wrapped_this(rpc::make_remote_invoker<T>(nid, type_id, subgroup_id,
-                                                   T::register_functions(), *group_rpc_manager.receivers)) {}
+                                                   T::register_functions(), *group_rpc_manager.receivers)),
+          hedge_latency_tracker(std::make_shared<rpc::ReplyLatencyTracker>()),
+          hedge_timer(rpc::HedgeTimer::get()) {}
 
 // This is literally copied and pasted from Replicated<T>. I wish I could let them share code with inheritance,
 // but I'm afraid that will introduce unnecessary overheads.
 template <typename T>
 template <rpc::FunctionTag tag, typename... Args>
 auto PeerCaller<T>::p2p_send(node_id_t dest_node, Args&&... args) {
+    return p2p_send_until<tag>(dest_node, 0, true, std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto PeerCaller<T>::p2p_send_with_deadline(node_id_t dest_node, std::chrono::nanoseconds timeout, Args&&... args) {
+    return p2p_send_until<tag>(dest_node, get_walltime() + timeout.count(), true, std::forward<Args>(args)...);
+}
+
+template <typename T>
+template <typename Ret>
+void PeerCaller<T>::cancel(node_id_t dest_node, const rpc::QueryResults<Ret>& results) {
+    group_rpc_manager.send_p2p_cancel(dest_node, results.get_p2p_request_id());
+}
+
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto PeerCaller<T>::p2p_send_until(node_id_t dest_node, uint64_t deadline, bool wait_for_buffer, Args&&... args) {
     if(is_valid()) {
         assert(dest_node != node_id);
         if(group_rpc_manager.view_manager.get_current_view().get().rank_of(dest_node) == -1) {
@@ -368,14 +507,22 @@ auto PeerCaller<T>::p2p_send(node_id_t dest_node, Args&&... args) {
         }
         uint64_t message_seq_num;
         auto return_pair = wrapped_this->template send<rpc::to_internal_tag<true>(tag)>(
-                [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
+                [this, &dest_node, deadline, wait_for_buffer, &message_seq_num](size_t size) -> uint8_t* {
                     const std::size_t max_payload_size = group_rpc_manager.view_manager.get_max_payload_sizes().at(subgroup_id);
                     if(size <= max_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
+                        std::optional<sst::P2PBufferHandle> buffer_handle;
+                        if(wait_for_buffer) {
+                            buffer_handle = group_rpc_manager.get_p2p_request_buffer(dest_node, deadline);
+                        } else {
+                            buffer_handle = group_rpc_manager.try_get_p2p_request_buffer(dest_node, deadline);
+                            if(!buffer_handle) {
+                                throw send_window_full_exception("The P2P send window to node "
+                                                                 + std::to_string(dest_node) + " is full.");
+                            }
+                        }
                         // Record the sequence number for this message buffer
-                        message_seq_num = buffer_handle.seq_num;
-                        return buffer_handle.buf_ptr;
+                        message_seq_num = buffer_handle->seq_num;
+                        return buffer_handle->buf_ptr;
                     } else {
                         throw buffer_overflow_exception("The size of a P2P message exceeds the maximum P2P message size.");
                     }
@@ -388,6 +535,25 @@ auto PeerCaller<T>::p2p_send(node_id_t dest_node, Args&&... args) {
     }
 }
 
+template <typename T>
+template <rpc::FunctionTag tag, typename... Args>
+auto PeerCaller<T>::p2p_send_hedged(node_id_t dest_node, node_id_t hedge_node, Args&&... args) {
+    // Keep a copy of the arguments in case the request needs to be sent again. Capturing this is safe
+    // because HedgedQueryResults stops its hedge timer when destroyed, and must not outlive this object.
+    // The hedge timer must not wait for a P2P buffer, so the duplicate request fails fast if there is none.
+    auto send_hedge = [this, hedge_node, hedge_args = std::make_tuple(std::decay_t<Args>(args)...)]() {
+        return std::apply([&](const auto&... a) { return p2p_send_until<tag>(hedge_node, 0, false, a...); },
+                          hedge_args);
+    };
+    auto primary_results = p2p_send<tag>(dest_node, std::forward<Args>(args)...);
+    using Ret = typename decltype(primary_results)::type;
+    auto cancel_request = [this](node_id_t node, const rpc::QueryResults<Ret>& results) {
+        cancel(node, results);
+    };
+    return rpc::HedgedQueryResults<Ret>(std::move(primary_results), dest_node, hedge_node,
+                                        send_hedge, cancel_request, hedge_latency_tracker);
+}
+
 template <typename T>
 ExternalClientCallback<T>::ExternalClientCallback(uint32_t type_id, node_id_t nid, subgroup_id_t subgroup_id,
                                                   rpc::RPCManager& group_rpc_manager)
@@ -415,8 +581,7 @@ auto ExternalClientCallback<T>::p2p_send(node_id_t dest_node, Args&&... args) {
                 [this, &dest_node, &message_seq_num](size_t size) -> uint8_t* {
                     const std::size_t max_payload_size = getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE);
                     if(size <= max_payload_size) {
-                        auto buffer_handle = group_rpc_manager.get_sendbuffer_ptr(dest_node,
-                                                                                  sst::MESSAGE_TYPE::P2P_REQUEST);
+                        auto buffer_handle = group_rpc_manager.get_p2p_request_buffer(dest_node);
                         // Record the sequence number for this message buffer
                         message_seq_num = buffer_handle.seq_num;
                         return buffer_handle.buf_ptr;
@@ -23,12 +23,14 @@ public:
     virtual bool is_signed() const = 0;
     virtual void make_version(persistent::version_t ver, const HLC& hlc) = 0;
     virtual persistent::version_t get_minimum_latest_persisted_version() = 0;
+    virtual persistent::version_t get_state_transfer_log_tail() = 0;
     virtual persistent::version_t persist(persistent::version_t version, uint8_t* signature) = 0;
     virtual std::vector<uint8_t> get_signature(persistent::version_t version) = 0;
     virtual bool verify_log(persistent::version_t version, openssl::Verifier& verifier,
                             const uint8_t* signature) = 0;
     virtual void truncate(persistent::version_t latest_version) = 0;
     virtual void post_next_version(persistent::version_t version, uint64_t msg_ts) = 0;
+    virtual persistent::PersistLog* get_placement_log() = 0;
 };
 
 }  // namespace derecho
@@ -96,6 +96,15 @@ struct RestartState {
      */
     static persistent::version_t ragged_trim_to_latest_version(const int32_t view_id,
                                                                const std::vector<int32_t>& max_received_by_sender);
+    /**
+     * Computes the ragged trim proposal whose last message, in round-robin
+     * order, has the given sequence number; this is the inverse of
+     * ragged_trim_to_latest_version.
+     * @param seq_num The sequence number of the last message delivered
+     * @param num_shard_senders The number of senders in the shard
+     * @return The highest message index delivered from each sender
+     */
+    static std::vector<int32_t> seq_num_to_ragged_trim(const int32_t seq_num, const uint32_t num_shard_senders);
 };
 
 class RestartLeaderState {
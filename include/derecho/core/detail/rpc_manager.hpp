@@ -14,13 +14,18 @@
 #include "derecho_internal.hpp"
 #include "p2p_connection_manager.hpp"
 #include "remote_invocable.hpp"
+#include "rpc_trace.hpp"
 #include "rpc_utils.hpp"
 
+#include <condition_variable>
+#include <deque>
 #include <exception>
 #include <functional>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
+#include <thread>
 #include <vector>
 
 namespace derecho {
@@ -78,6 +83,16 @@ auto make_remote_invoker(const node_id_t nid, uint32_t type_id, uint32_t instanc
                             funs);
 }
 
+/**
+ * Type of a function that returns the conflict key of an ordered RPC call, or
+ * std::nullopt if the call conflicts with every other call. The arguments are
+ * the function's internal tag (see to_internal_tag()) and its serialized
+ * arguments.
+ */
+using conflict_key_func_t = std::function<std::optional<uint64_t>(FunctionTag, const uint8_t*, std::size_t)>;
+/** Type of a function that creates a version of a subgroup's replicated object. */
+using make_version_func_t = std::function<void(persistent::version_t, const HLC&)>;
+
 class RPCManager {
     static_assert(std::is_trivially_copyable<Opcode>::value, "Oh no! Opcode is not trivially copyable!");
     /** The ID of the node this RPCManager is running on. */
@@ -136,7 +151,7 @@ class RPCManager {
      * one to be received in rpc_message_handler()). Note that the PendingResults
      * objects themselves live in the RemoteInvocableClass that sent the message.
      */
-    std::map<subgroup_id_t, std::queue<std::weak_ptr<AbstractPendingResults>>> pending_results_to_fulfill;
+    std::map<subgroup_id_t, std::deque<std::weak_ptr<AbstractPendingResults>>> pending_results_to_fulfill;
     /**
      * For each subgroup, contains a map from version number to the PendingResults
      * for that version's RPC call (i.e., a set of PendingResults indexed by
@@ -151,6 +166,20 @@ class RPCManager {
      * still needs to use the PendingResults to report that global persistence has finished.
      */
     std::map<subgroup_id_t, std::map<persistent::version_t, std::weak_ptr<AbstractPendingResults>>> results_awaiting_global_persistence;
+    /**
+     * For each subgroup, contains a map from version number to the PendingResults
+     * for that version's RPC call. These RPC messages have been delivered locally
+     * but RPCManager still needs to report that quorum persistence has finished.
+     * This is tracked separately from the local/global persistence maps, because
+     * a quorum of other replicas may persist a version before this node does.
+     */
+    std::map<subgroup_id_t, std::map<persistent::version_t, std::weak_ptr<AbstractPendingResults>>> results_awaiting_quorum_persistence;
+    /**
+     * The latest quorum persistence frontier reported for each subgroup, used
+     * to fulfill PendingResults for versions that reach the quorum before they
+     * are delivered (and added to results_awaiting_quorum_persistence) here.
+     */
+    std::map<subgroup_id_t, persistent::version_t> quorum_persistence_frontier;
     /**
      * For each subgroup, contains a map from version number to the PendingResults
      * for that version's RPC call (i.e., a set of PendingResults indexed by
@@ -181,22 +210,122 @@ class RPCManager {
     std::thread rpc_listener_thread;
     /** The maximum busy wait time in millisecond before sleep */
     const uint64_t busy_wait_before_sleep_ms;
+    /** Records the ordered RPC messages this node delivers, if DERECHO/rpc_trace_path is set; otherwise null. */
+    std::unique_ptr<RPCTraceRecorder> trace_recorder;
+
+    /** An ordered RPC call handed to the parallel apply workers. */
+    struct apply_task {
+        node_id_t sender_id;
+        persistent::version_t version;
+        uint64_t timestamp;
+        bool reply_value_omitted;
+        /** A copy of the message, since the delivery buffer is reused before the call is applied */
+        std::vector<uint8_t> msg;
+        /** The reply message, including its header, or empty if there is none */
+        std::vector<uint8_t> reply;
+        /** The exception thrown while applying the call, rethrown on the delivery thread at the end of its batch */
+        std::exception_ptr exception;
+    };
+    /** The parallel apply state of a subgroup whose replicated type implements ParallelApply. */
+    struct parallel_apply_state {
+        conflict_key_func_t conflict_key;
+        make_version_func_t make_version;
+        /** The calls delivered since the last batch ended, in delivery order */
+        std::deque<apply_task> batch;
+        /** The versions whose creation is deferred until the end of the batch */
+        std::vector<std::pair<persistent::version_t, HLC>> deferred_versions;
+    };
+    /**
+     * The subgroups registered for parallel apply. Entries are added when a
+     * Replicated object is constructed and removed when it is destroyed,
+     * which can happen while the delivery thread reads the map, so it is
+     * guarded by parallel_apply_mutex. The delivery thread holds its own
+     * reference to an entry while it uses it, so removing the entry from the
+     * map never frees a state that is still in use.
+     */
+    std::map<subgroup_id_t, std::shared_ptr<parallel_apply_state>> parallel_apply_subgroups;
+    /** Guards parallel_apply_subgroups and apply_workers */
+    std::mutex parallel_apply_mutex;
+    /**
+     * One queue of tasks for each parallel apply worker. A call is queued to
+     * the worker its conflict key hashes to, so the calls with the same key
+     * are applied in delivery order.
+     */
+    std::vector<std::deque<apply_task*>> apply_queues;
+    std::vector<std::thread> apply_workers;
+    /** Guards apply_queues and apply_tasks_outstanding. */
+    std::mutex apply_mutex;
+    /** Notified when a task is queued, and when the last outstanding task completes. */
+    std::condition_variable apply_cv;
+    std::size_t apply_tasks_outstanding = 0;
+    bool apply_shutdown = false;
+
+    /** Applies the calls queued to one parallel apply worker. */
+    void parallel_apply_worker(uint32_t worker_index);
+    /** Applies one ordered RPC call, on the calling thread, putting its reply in the task. */
+    void apply(apply_task& task);
+    /** Waits until every queued task has been applied. */
+    void wait_for_parallel_apply();
+    /** @return The parallel apply state of a subgroup, or nullptr if it does not use parallel apply */
+    std::shared_ptr<parallel_apply_state> get_parallel_apply_state(subgroup_id_t subgroup_id);
+    /**
+     * Returns true if this node should acknowledge an ordered RPC message
+     * without its return value, because of the message's reply policy.
+     */
+    bool reply_value_omitted(subgroup_id_t subgroup_id, const uint8_t* msg_buf);
+    /**
+     * Returns true if this node is a warm standby in its shard of the
+     * subgroup, which applies ordered RPC calls without replying to them.
+     */
+    bool is_warm_standby(subgroup_id_t subgroup_id);
+    /**
+     * Fulfills the PendingResults of an ordered RPC message this node sent,
+     * upon receiving it. Must be called in delivery order.
+     */
+    void fulfill_self_receive(subgroup_id_t subgroup_id, persistent::version_t version, uint64_t timestamp);
     /** The thread that processes P2P requests in FIFO order; implemented by p2p_request_worker() */
     std::thread request_worker_thread;
     /** A simple struct representing a P2P request message.
      *  Encapsulates the parameters to a p2p_message_handler call. */
     struct p2p_req {
         node_id_t sender_id;
+        /** The RPC message, after the request's p2p_request_header */
         uint8_t* msg_buf;
+        /** The wall-clock time after which the request should be dropped, or 0 for none */
+        uint64_t deadline;
+        /** The request's sequence number among the P2P requests from sender_id */
+        uint64_t request_id;
+        /** Set if the sender cancelled the request while it was waiting in the queue */
+        bool cancelled;
+        /**
+         * Set if this is not a request but a cancellation of request_id,
+         * which only needs a null reply to free its slot in the sender's window
+         */
+        bool cancellation;
         p2p_req() : sender_id(0),
-                    msg_buf(nullptr) {}
+                    msg_buf(nullptr),
+                    deadline(0),
+                    request_id(0),
+                    cancelled(false),
+                    cancellation(false) {}
         p2p_req(node_id_t _sender_id,
-                uint8_t* _msg_buf)
+                uint8_t* _msg_buf,
+                uint64_t _deadline,
+                uint64_t _request_id,
+                bool _cancellation = false)
                 : sender_id(_sender_id),
-                  msg_buf(_msg_buf) {}
+                  msg_buf(_msg_buf),
+                  deadline(_deadline),
+                  request_id(_request_id),
+                  cancelled(false),
+                  cancellation(_cancellation) {}
     };
-    /** P2P requests that need to be handled by the worker thread. */
-    std::queue<p2p_req> p2p_request_queue;
+    /**
+     * P2P requests that need to be handled by the worker thread, in FIFO
+     * order. A deque rather than a queue so that cancellations can find
+     * requests that are still waiting.
+     */
+    std::deque<p2p_req> p2p_request_queue;
     std::mutex request_queue_mutex;
     /** Notified when the request worker thread has work to do. */
     std::condition_variable request_queue_cv;
@@ -210,13 +339,37 @@ class RPCManager {
     /** Handles non-cascading P2P Send requests in FIFO order. */
     void p2p_request_worker();
 
+    /**
+     * Marks a P2P request as cancelled if it is still waiting in the request
+     * queue, so the worker thread will drop it instead of executing it.
+     * @param sender_id The node that sent the request
+     * @param request_id The request ID of the request
+     */
+    void cancel_queued_request(node_id_t sender_id, uint64_t request_id);
+
+    /**
+     * Gets a P2P reply buffer for a node, waiting for one to become
+     * available if the reply window is full. Since it can block, this must
+     * only be called on the P2P worker thread, never the listener thread.
+     * @return The buffer, or std::nullopt if the node is no longer connected
+     * or the RPCManager is shutting down
+     */
+    std::optional<sst::P2PBufferHandle> get_p2p_reply_buffer(node_id_t dest_id);
+
+    /**
+     * Sends an EXPIRED reply for a P2P request that the worker thread dropped
+     * without executing, so the caller's QueryResults is not left waiting.
+     */
+    void send_expired_reply(const p2p_req& request);
+
     /**
      * Handler to be called by p2p_receive_loop each time it receives a
      * peer-to-peer message over an RDMA P2P connection.
      * @param sender_id The ID of the node that sent the message
+     * @param type The type of P2P message; P2P requests start with a p2p_request_header
      * @param msg_buf A pointer to a buffer containing the message
      */
-    void p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf);
+    void p2p_message_handler(node_id_t sender_id, sst::MESSAGE_TYPE type, uint8_t* msg_buf);
 
     /**
      * Reports to the view manager that the given node has failed if it's an
@@ -312,6 +465,36 @@ public:
 
     void destroy_remote_invocable_class(uint32_t instance_id);
 
+    /**
+     * Switches a subgroup to parallel apply: from now on, the ordered RPC
+     * calls it delivers are applied by a pool of worker threads, where calls
+     * with different conflict keys may run concurrently and calls with the
+     * same key run in delivery order. Each batch of delivered calls ends with
+     * end_delivery_batch(), which waits for them to be applied, sends their
+     * replies in delivery order, then creates their versions in order.
+     * @param subgroup_id The subgroup
+     * @param conflict_key The function that computes the conflict key of a call
+     * @param make_version The function that creates a version of the
+     * subgroup's replicated object
+     */
+    void register_parallel_apply(subgroup_id_t subgroup_id, const conflict_key_func_t& conflict_key,
+                                 const make_version_func_t& make_version);
+
+    /**
+     * Defers the creation of a version of a parallel apply subgroup's object
+     * until the end of the current delivery batch, after the calls delivered
+     * in it have been applied.
+     */
+    void defer_make_version(subgroup_id_t subgroup_id, persistent::version_t version, const HLC& hlc);
+
+    /**
+     * Handler to be called by MulticastGroup after it delivers a batch of
+     * messages in a subgroup, and before it requests their persistence.
+     * Completes the batch if the subgroup uses parallel apply; otherwise
+     * does nothing.
+     */
+    void end_delivery_batch(subgroup_id_t subgroup_id);
+
     /**
      * Callback for new-view events that updates internal state in response to
      * joins or leaves. Specifically, forms new RDMA connections for P2P RPC
@@ -363,6 +546,18 @@ public:
      */
     void notify_global_persistence_finished(subgroup_id_t subgroup_id, persistent::version_t version);
 
+    /**
+     * Callback to be called by MulticastGroup when it detects that a version
+     * has reached quorum persistence. This will deliver "quorum persistence
+     * done" events to the PendingResults objects of all RPC messages with
+     * version numbers lower than the provided version.
+     * @param subgroup_id The subgroup in which persistence has finished for a
+     * version
+     * @param version The latest version number that has finished persisting
+     * on the subgroup's persistence quorum
+     */
+    void notify_quorum_persistence_finished(subgroup_id_t subgroup_id, persistent::version_t version);
+
     /**
      * Callback to be called by MulticastGroup when it detects that a version
      * has been (globally) verified. This will deliver "signature verified"
@@ -386,6 +581,16 @@ public:
      */
     void register_rpc_results(subgroup_id_t subgroup_id, std::weak_ptr<AbstractPendingResults> pending_results_handle);
 
+    /**
+     * Fails the most recent RPC calls registered in a subgroup, whose messages
+     * were dropped before they could be sent because this node stopped being a
+     * sender in the subgroup. Their QueryResults get a
+     * sender_removed_from_group_exception.
+     * @param subgroup_id The subgroup in which the calls were made.
+     * @param num_calls The number of calls that were dropped.
+     */
+    void fail_unsent_rpc_calls(subgroup_id_t subgroup_id, uint32_t num_calls);
+
     /**
      * Retrieves a buffer for sending P2P messages from the RPCManager's pool of
      * P2P RDMA connections. After filling it with data, the next call to
@@ -395,6 +600,25 @@ public:
      */
     sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type);
 
+    /**
+     * Retrieves a buffer for sending a P2P request, like get_sendbuffer_ptr,
+     * and fills in the request's p2p_request_header. The request ID is the
+     * buffer's sequence number, which is unique among the requests this node
+     * sends to dest_id.
+     * @param dest_id The ID of the node that the request will be sent to
+     * @param deadline The wall-clock time after which the request may be
+     * dropped, or 0 for no deadline
+     * @return A handle whose buf_ptr points past the p2p_request_header, where
+     * the RPC message goes, and whose seq_num is the request ID
+     */
+    sst::P2PBufferHandle get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline = 0);
+
+    /**
+     * Like get_p2p_request_buffer, but returns std::nullopt instead of waiting
+     * if the send window to dest_id is full.
+     */
+    std::optional<sst::P2PBufferHandle> try_get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline = 0);
+
     /**
      * Sends the P2P message buffer with the specified sequence number over an RDMA
      * connection to the specified node, and registers the "promise object" pointed
@@ -407,6 +631,15 @@ public:
      */
     void send_p2p_message(node_id_t dest_node, subgroup_id_t dest_subgroup_id, uint64_t sequence_num,
                           std::weak_ptr<AbstractPendingResults> pending_results_handle);
+    /**
+     * Asks a node to drop a P2P request this node sent it earlier, if the
+     * node has not started executing it yet. The request's QueryResults will
+     * get a request_expired_exception if it was dropped, or the normal reply
+     * if it was too late to cancel.
+     * @param dest_node The node the request was sent to
+     * @param request_id The request's request ID (see QueryResults::get_p2p_request_id())
+     */
+    void send_p2p_cancel(node_id_t dest_node, uint64_t request_id);
     /**
      * Get the id of the latest rpc caller.
      */
@@ -492,5 +725,12 @@ using RemoteInvokerFor = std::decay_t<decltype(*make_remote_invoker<T>(std::decl
 // test if the current thread is in an RPC handler to tell if we are sending a cascading RPC message.
 bool in_rpc_handler();
 
+// test if the RPC call being handled by the current thread should be acknowledged without its return value.
+bool rpc_reply_value_omitted();
+
+// the version and timestamp of the ordered RPC call a parallel apply worker is applying, or of the version
+// being created at the end of a parallel apply batch; INVALID_VERSION on any other thread.
+std::pair<persistent::version_t, uint64_t> parallel_apply_version();
+
 }  // namespace rpc
 }  // namespace derecho
@@ -0,0 +1,324 @@
+/**
+ * @file rpc_trace.hpp
+ *
+ * Recording of the ordered RPC messages a subgroup delivers, and offline
+ * replay of such a recording against a Replicated type.
+ */
+
+#pragma once
+
+#include "../derecho_exception.hpp"
+#include "derecho/persistent/Persistent.hpp"
+#include "derecho/utils/logger.hpp"
+#include "derecho/utils/time.h"
+#include "derecho_internal.hpp"
+#include "remote_invocable.hpp"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace derecho {
+
+namespace rpc {
+
+/**
+ * The header of each record of an RPC trace file. A trace file starts with a
+ * RPCTraceFileHeader, followed by one record for each ordered RPC message
+ * delivered in the subgroup, in delivery order: this header, then the whole
+ * RPC message (including its RPC header) as it was delivered, zero-padded to
+ * a multiple of 8 bytes. A record whose sender_id is RPC_TRACE_GAP_SENDER has
+ * no message, and marks where the recorder dropped records: its version and
+ * timestamp_us are those of the first dropped message.
+ */
+struct RPCTraceRecord {
+    int64_t version;
+    uint64_t timestamp_us;
+    uint32_t sender_id;
+    uint32_t size;
+} __attribute__((packed));
+
+struct RPCTraceFileHeader {
+    uint64_t magic;
+    uint32_t format_version;
+    uint32_t subgroup_id;
+} __attribute__((packed));
+
+/** "DRPCTRCE" */
+constexpr uint64_t RPC_TRACE_MAGIC = 0x4543525443505244ull;
+constexpr uint32_t RPC_TRACE_FORMAT_VERSION = 2;
+/** The sender_id of a gap record */
+constexpr uint32_t RPC_TRACE_GAP_SENDER = UINT32_MAX;
+
+/**
+ * Records the ordered RPC messages delivered by an RPCManager, one trace file
+ * per subgroup, named "<path prefix>.<subgroup ID>". Records are appended to
+ * an in-memory buffer, so recording costs a memcpy per message in the
+ * delivery path. Each trace file has two buffers: once the one being filled
+ * grows past FLUSH_THRESHOLD, the two are swapped and a background thread
+ * writes the full one out while delivery fills the other. If the disk cannot
+ * keep up, so that the buffer being filled reaches max_buffered_bytes while
+ * the other is still being written, new records are dropped with a warning
+ * until the write finishes, and a gap record is written in their place so
+ * that readers know the trace is incomplete from there on. An existing trace
+ * file is overwritten when the subgroup delivers its first message.
+ * Thread-safe.
+ */
+class RPCTraceRecorder {
+    struct TraceFile {
+        int fd;
+        /** The records appended by record() */
+        std::vector<uint8_t> buffer;
+        /** The records being written by the writer thread */
+        std::vector<uint8_t> write_buffer;
+        /** True while write_buffer is owned by the writer thread */
+        bool write_pending = false;
+        /** The number of records dropped since buffer reached max_buffered_bytes */
+        uint64_t num_dropped = 0;
+        /** The version and timestamp of the first of those records */
+        persistent::version_t first_dropped_version = persistent::INVALID_VERSION;
+        uint64_t first_dropped_timestamp_us = 0;
+    };
+    const std::string path_prefix;
+    std::shared_ptr<spdlog::logger> logger;
+    const std::size_t max_buffered_bytes;
+    std::mutex trace_mutex;
+    /** Wakes the writer thread when a buffer is handed off, or on shutdown */
+    std::condition_variable writer_cv;
+    /** Notified by the writer thread after it writes out buffers */
+    std::condition_variable written_cv;
+    bool shutdown;
+    std::map<subgroup_id_t, TraceFile> trace_files;
+    std::thread writer_thread;
+
+    // Swap a trace file's buffers and wake the writer thread, unless it is
+    // still writing the previous ones. We assume trace_mutex is acquired.
+    void hand_off(TraceFile& file);
+    // Append a gap record for the records dropped since the last one appended,
+    // if any. We assume trace_mutex is acquired.
+    void end_gap(subgroup_id_t subgroup_id, TraceFile& file);
+    void writer_loop();
+
+public:
+    static constexpr std::size_t FLUSH_THRESHOLD = 1 << 20;
+    /** The default for the most records that are buffered while the writer thread is busy, in bytes */
+    static constexpr std::size_t MAX_BUFFERED_BYTES = 64 * FLUSH_THRESHOLD;
+
+    /**
+     * @param path_prefix The path of the trace files, without the subgroup ID
+     * @param logger The logger to report I/O errors to
+     * @param max_buffered_bytes The most records, in bytes, that are buffered
+     * for each trace file while the writer thread is busy
+     */
+    RPCTraceRecorder(const std::string& path_prefix, std::shared_ptr<spdlog::logger> logger,
+                     std::size_t max_buffered_bytes = MAX_BUFFERED_BYTES);
+    ~RPCTraceRecorder();
+
+    /**
+     * Appends a delivered message to the subgroup's trace. An I/O error is
+     * logged and stops the recording of that subgroup, rather than failing
+     * the delivery, and the message is dropped if max_buffered_bytes are
+     * already waiting for the writer thread. A run of dropped messages is
+     * replaced by a single gap record once there is room again.
+     */
+    void record(subgroup_id_t subgroup_id, node_id_t sender_id, persistent::version_t version,
+                uint64_t timestamp_us, const uint8_t* msg_buf, uint32_t size);
+
+    /** Writes out the buffered records of every subgroup, and waits until they are written. */
+    void flush();
+};
+
+/**
+ * Reads an RPC trace file, which is loaded into memory in full so that
+ * replaying it does not measure file I/O. A record torn by a crash of the
+ * recording node ends the trace, and so does a gap record, since the records
+ * after it do not follow on from the ones before.
+ */
+class RPCTraceReader {
+    std::vector<uint8_t> data;
+    std::size_t offset;
+    subgroup_id_t subgroup_id;
+    /** The version of the first dropped message, if next() stopped at a gap record */
+    persistent::version_t gap_version;
+
+public:
+    /**
+     * @param trace_file The path of the trace file
+     * @throws derecho_exception if the file cannot be read, or is not an RPC trace
+     */
+    RPCTraceReader(const std::string& trace_file);
+
+    /** @return The subgroup the trace was recorded in */
+    subgroup_id_t get_subgroup_id() const { return subgroup_id; }
+
+    /**
+     * Reads the next record.
+     * @param record Set to the record's header
+     * @param msg_buf Set to the record's RPC message, which is valid as long
+     * as this reader
+     * @return false if there are no more records, or the next record is a gap
+     */
+    bool next(RPCTraceRecord& record, const uint8_t*& msg_buf);
+
+    /** @return True if next() stopped at a gap record rather than at the end of the trace */
+    bool reached_gap() const { return gap_version != persistent::INVALID_VERSION; }
+
+    /** @return The version of the first message missing from the trace, if reached_gap() */
+    persistent::version_t get_gap_version() const { return gap_version; }
+
+    /** Restarts from the first record. */
+    void rewind();
+};
+
+/** The cost of replaying the messages of one RPC function. */
+struct RPCReplayStats {
+    uint64_t count = 0;
+    /** Total and maximum time spent in the RPC handler, in nanoseconds */
+    uint64_t handler_ns = 0;
+    uint64_t max_handler_ns = 0;
+    /** Total time spent creating the Persistent versions, in nanoseconds */
+    uint64_t version_ns = 0;
+    /** Total size of the RPC messages, including their headers */
+    uint64_t bytes = 0;
+};
+
+/** The cost of replaying a trace. */
+struct RPCReplayResult {
+    /** The cost of each RPC function, by internal function tag (see to_internal_tag()) */
+    std::map<FunctionTag, RPCReplayStats> functions;
+    /** The number of calls to persist and the total time they took, in nanoseconds */
+    uint64_t persist_count = 0;
+    uint64_t persist_ns = 0;
+    /** The wall-clock duration of the whole replay, in nanoseconds */
+    uint64_t total_ns = 0;
+    /**
+     * If the replay stopped at a gap in the trace, the version of the first
+     * message missing from it; otherwise INVALID_VERSION.
+     */
+    persistent::version_t gap_version = persistent::INVALID_VERSION;
+};
+
+/**
+ * Builds the RPC receivers of an object of type T, the same way RPCManager
+ * does for a Replicated<T>, but registered under type 0 and subgroup 0.
+ */
+template <typename T>
+auto make_replay_invocable_class(std::unique_ptr<T>* object, std::map<Opcode, receive_fun_t>& receivers) {
+    return mutils::callFunc([&](const auto&... unpacked_functions) {
+        return build_remote_invocable_class<T>(0, 0, 0, receivers,
+                                               bind_to_instance(object, unpacked_functions)...);
+    },
+                            T::register_functions());
+}
+
+/**
+ * Replays RPC traces against a standalone object of type T, outside of any
+ * Group: each message is passed to the RPC handler registered by T, then a
+ * version of T's Persistent fields is created with the message's version and
+ * timestamp, as the delivery path of a Replicated<T> does. Nothing is sent,
+ * and replies are written to a scratch buffer and discarded.
+ *
+ * Handlers that use their GroupReference, or send RPC messages of their own,
+ * cannot run outside of a Group and should not be replayed. The Persistent
+ * fields of T are stored with the PERS settings of the current configuration
+ * under T's type name, like those of a Replicated<T> in subgroup 0, shard 0,
+ * so replays should run in their own working directory.
+ */
+template <typename T>
+class RPCTraceReplayer {
+    std::unique_ptr<persistent::PersistentRegistry> persistent_registry;
+    std::unique_ptr<T> object;
+    std::map<Opcode, receive_fun_t> receivers;
+    decltype(make_replay_invocable_class(std::declval<std::unique_ptr<T>*>(),
+                                         std::declval<std::map<Opcode, receive_fun_t>&>())) invocable;
+    mutils::RemoteDeserialization_v rdv;
+    std::vector<uint8_t> reply_buffer;
+
+public:
+    /**
+     * @param object_factory A factory for the object to replay the traces against
+     * @param deserialization_contexts The deserialization contexts the Group
+     * of the recording node was given
+     */
+    RPCTraceReplayer(const Factory<T>& object_factory,
+                     const std::vector<mutils::RemoteDeserializationContext*>& deserialization_contexts = {})
+            : persistent_registry(std::make_unique<persistent::PersistentRegistry>(
+                    nullptr, std::type_index(typeid(T)), 0, 0)),
+              object(object_factory(persistent_registry.get(), 0)),
+              invocable(make_replay_invocable_class(&object, receivers)),
+              rdv(deserialization_contexts.begin(), deserialization_contexts.end()) {}
+
+    /** @return The object the traces are replayed against */
+    T& get_object() { return *object; }
+
+    /**
+     * Replays a trace as fast as possible, up to its end or its first gap,
+     * which is reported in the result.
+     * @param reader The trace
+     * @param persist_interval Persist T's Persistent fields after every
+     * persist_interval versions, and at the end of the trace; 0 to never
+     * persist them
+     * @return The cost of each RPC function, and of persisting
+     */
+    RPCReplayResult replay(RPCTraceReader& reader, uint32_t persist_interval = 1) {
+        using namespace remote_invocation_utilities;
+        RPCReplayResult result;
+        RPCTraceRecord record;
+        const uint8_t* msg_buf;
+        persistent::version_t latest_version = persistent::INVALID_VERSION;
+        uint32_t unpersisted = 0;
+        auto scratch_alloc = [this](std::size_t size) {
+            reply_buffer.resize(std::max(reply_buffer.size(), size));
+            return reply_buffer.data();
+        };
+        auto persist = [&]() {
+            uint64_t persist_start_ns = get_time();
+            persistent_registry->persist(latest_version);
+            result.persist_ns += get_time() - persist_start_ns;
+            result.persist_count++;
+            unpersisted = 0;
+        };
+        const uint64_t replay_start_ns = get_time();
+        while(reader.next(record, msg_buf)) {
+            std::size_t payload_size;
+            Opcode indx;
+            node_id_t received_from;
+            uint32_t flags;
+            retrieve_header(nullptr, msg_buf, payload_size, indx, received_from, flags);
+            auto receiver = receivers.find(Opcode{0, 0, indx.function_id, indx.is_reply});
+            if(receiver == receivers.end()) {
+                throw derecho_exception("RPC trace contains a message for a function that the replayed type does not register.");
+            }
+            RPCReplayStats& function_stats = result.functions[indx.function_id];
+            uint64_t start_ns = get_time();
+            receiver->second(&rdv, received_from, msg_buf + header_space(), scratch_alloc);
+            uint64_t handler_done_ns = get_time();
+            persistent_registry->makeVersion(record.version, {record.timestamp_us, 0});
+            uint64_t version_done_ns = get_time();
+            function_stats.count++;
+            function_stats.handler_ns += handler_done_ns - start_ns;
+            function_stats.max_handler_ns = std::max(function_stats.max_handler_ns, handler_done_ns - start_ns);
+            function_stats.version_ns += version_done_ns - handler_done_ns;
+            function_stats.bytes += record.size;
+            latest_version = record.version;
+            if(persist_interval != 0 && ++unpersisted == persist_interval) {
+                persist();
+            }
+        }
+        if(persist_interval != 0 && unpersisted != 0) {
+            persist();
+        }
+        result.total_ns = get_time() - replay_start_ns;
+        result.gap_version = reader.get_gap_version();
+        return result;
+    }
+};
+
+}  // namespace rpc
+}  // namespace derecho
@@ -14,7 +14,9 @@
 
 #include <mutils/macro_utils.hpp>
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
 #include <exception>
 #include <functional>
 #include <future>
@@ -215,6 +217,113 @@ struct sender_removed_from_group_exception : public derecho_exception {
                                 "and can no longer send the RPC message.") {}
 };
 
+/**
+ * Indicates that a node dropped a P2P request without executing it, either
+ * because the request's deadline had passed by the time the node got to it,
+ * or because the caller cancelled it.
+ */
+struct request_expired_exception : public derecho_exception {
+    node_id_t who;
+    request_expired_exception(node_id_t who)
+            : derecho_exception(std::string("Node with ID ")
+                                + std::to_string(who)
+                                + std::string(" dropped the request because it expired or was cancelled.")),
+              who(who) {}
+};
+
+/**
+ * Indicates that a node did not send its return value for an ordered_send
+ * query, because the query's ReplyPolicy asked only a designated member of
+ * the shard to send one. The node executed the call and acknowledged it.
+ */
+struct reply_omitted_exception : public derecho_exception {
+    node_id_t who;
+    reply_omitted_exception(node_id_t who)
+            : derecho_exception(std::string("Node with ID ")
+                                + std::to_string(who)
+                                + std::string(" acknowledged the call without sending a reply value.")),
+              who(who) {}
+};
+
+/**
+ * Selects which members of a shard send their return value for an
+ * ordered_send query, and how many replies the caller's QueryResults needs
+ * before await_reply_policy() returns. Every member still executes the call.
+ */
+struct ReplyPolicy {
+    enum class Kind : uint8_t {
+        /** Every member sends its return value; satisfied once all have replied. */
+        ALL = 0,
+        /**
+         * Only the member at shard rank `param` (modulo the shard size) sends
+         * its return value; the others send a small acknowledgement, which
+         * shows up as a reply_omitted_exception. If the designated member has
+         * failed, the next surviving member in rank order takes its place.
+         * Satisfied once the designated member has replied.
+         */
+        DESIGNATED = 1,
+        /**
+         * The first `param` surviving members in rank order send their return
+         * values and the others acknowledge; satisfied once they have replied.
+         */
+        FIRST_K = 2,
+        /**
+         * The first majority of the shard's surviving members in rank order
+         * send their return values and the others acknowledge; satisfied once
+         * they have replied.
+         */
+        QUORUM = 3
+    };
+    Kind kind = Kind::ALL;
+    /** The designated member's shard rank for DESIGNATED, or k for FIRST_K */
+    uint16_t param = 0;
+
+    static ReplyPolicy all() { return ReplyPolicy{}; }
+    static ReplyPolicy designated(uint16_t shard_rank = 0) { return ReplyPolicy{Kind::DESIGNATED, shard_rank}; }
+    static ReplyPolicy first_k(uint16_t k) { return ReplyPolicy{Kind::FIRST_K, k}; }
+    static ReplyPolicy quorum() { return ReplyPolicy{Kind::QUORUM, 0}; }
+
+    /**
+     * @return The number of return values this policy asks for from a shard
+     * of the given size
+     */
+    uint32_t num_values(uint32_t shard_size) const {
+        switch(kind) {
+            case Kind::DESIGNATED:
+                return shard_size == 0 ? 0 : 1;
+            case Kind::FIRST_K:
+                return std::min<uint32_t>(param, shard_size);
+            case Kind::QUORUM:
+                return shard_size / 2 + 1;
+            default:
+                return shard_size;
+        }
+    }
+
+    /**
+     * Computes which members of a shard send their return value under this
+     * policy. The replicas and the caller both use this, so they agree on the
+     * senders as long as they agree on which members have failed.
+     * @param failed One entry per shard member in rank order, true if that
+     * member is known to have failed
+     * @return The shard ranks of the members that send a value, in rank order
+     */
+    std::vector<uint32_t> value_senders(const std::vector<char>& failed) const {
+        const uint32_t shard_size = failed.size();
+        const uint32_t num_senders = num_values(shard_size);
+        //DESIGNATED starts counting at the designated rank and wraps around; the others start at rank 0
+        const uint32_t first_rank = (kind == Kind::DESIGNATED && shard_size > 0) ? param % shard_size : 0;
+        std::vector<uint32_t> senders;
+        for(uint32_t offset = 0; offset < shard_size && senders.size() < num_senders; ++offset) {
+            const uint32_t rank = (first_rank + offset) % shard_size;
+            if(kind == Kind::ALL || !failed[rank]) {
+                senders.push_back(rank);
+            }
+        }
+        return senders;
+    }
+};
+
 /**
  * Return type of all the RemoteInvocable::receive_* methods. If the method is
  * receive_call, this struct contains the message to send in reply, along with
@@ -294,6 +403,14 @@ public:
         */
         bool contains(const node_id_t& nid) { return rmap.count(nid); }
 
+        /*
+          returns true if this node's reply (or exception) has arrived,
+          so get(nid) will not block.
+        */
+        bool is_ready(const node_id_t& nid) {
+            return rmap.count(nid) && rmap.at(nid).wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+        }
+
         auto begin() { return std::begin(rmap); }
 
         auto end() { return std::end(rmap); }
@@ -324,8 +441,12 @@ private:
     std::future<void> local_persistence_done;
     /** This signals that global persistence has completed for the version assigned to this RPC function call */
     std::future<void> global_persistence_done;
+    /** This signals that quorum persistence has completed for the version assigned to this RPC function call */
+    std::future<void> quorum_persistence_done;
     /** This signals that the signature has been verified at all replicas on the version assigned to this RPC function call */
     std::future<void> signature_done;
+    /** This signals that enough replies have arrived to satisfy this RPC function call's ReplyPolicy */
+    std::future<void> reply_policy_satisfied;
     /**
      * An owning pointer to the PendingResults that is paired with this QueryResults
      * (i.e. the one that constructed this QueryResults). It ensures that the
@@ -344,12 +465,15 @@ public:
     QueryResults(std::shared_ptr<PendingResults<Ret>> paired_pending_results,
                  map_fut reply_map_future, std::future<std::pair<persistent::version_t, uint64_t>> persistent_version,
                  std::future<void> local_persistence_done, std::future<void> global_persistence_done,
-                 std::future<void> signature_done)
+                 std::future<void> quorum_persistence_done, std::future<void> signature_done,
+                 std::future<void> reply_policy_satisfied)
             : pending_rmap(std::move(reply_map_future)),
               persistent_version(std::move(persistent_version)),
               local_persistence_done(std::move(local_persistence_done)),
               global_persistence_done(std::move(global_persistence_done)),
+              quorum_persistence_done(std::move(quorum_persistence_done)),
               signature_done(std::move(signature_done)),
+              reply_policy_satisfied(std::move(reply_policy_satisfied)),
               paired_pending_results(paired_pending_results) {}
     /** Move constructor for QueryResults. */
     QueryResults(QueryResults&& o)
@@ -358,7 +482,9 @@ public:
               persistent_version{std::move(o.persistent_version)},
               local_persistence_done{std::move(o.local_persistence_done)},
               global_persistence_done{std::move(o.global_persistence_done)},
+              quorum_persistence_done{std::move(o.quorum_persistence_done)},
               signature_done{std::move(o.signature_done)},
+              reply_policy_satisfied{std::move(o.reply_policy_satisfied)},
               paired_pending_results{std::move(o.paired_pending_results)} {}
     /** QueryResults, like std::future, is not copyable. */
     QueryResults(const QueryResults&) = delete;
@@ -393,6 +519,48 @@ public:
         }
     }
 
+    /**
+     * @return The request ID of this call if it was sent as a P2P request,
+     * which is needed to cancel it
+     */
+    uint64_t get_p2p_request_id() const {
+        return paired_pending_results->get_p2p_request_id();
+    }
+
+    /**
+     * Registers a function to be called with a node's ID each time that node's
+     * reply (or an exception in place of its reply) arrives. It is called on
+     * the thread that delivers the reply, so it must be short and must not
+     * block; it is called at once for any replies that have already arrived.
+     * Replaces any listener registered before.
+     */
+    void set_reply_listener(std::function<void(node_id_t)> listener) {
+        paired_pending_results->set_reply_listener(std::move(listener));
+    }
+
+    /**
+     * Blocks until enough replies have arrived to satisfy the ReplyPolicy the
+     * call was sent with, then returns the ReplyMap. Futures for nodes whose
+     * replies were not needed may still be pending; check them with
+     * ReplyMap::is_ready() before calling get() on them. With the default
+     * policy this is the same as waiting for every reply. Throws
+     * node_removed_from_group_exception if a member that was supposed to send
+     * a value failed and no surviving member sent one in its place.
+     */
+    ReplyMap& await_reply_policy() {
+        ReplyMap& rmap = get();
+        reply_policy_satisfied.wait();
+        return rmap;
+    }
+
+    /**
+     * Checks if a call to await_reply_policy() would return without blocking.
+     */
+    bool reply_policy_is_satisfied() {
+        return replies.rmap.size() != 0
+               && reply_policy_satisfied.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
     /**
      * Test if all the future entries are ready.
      * A true return value indicates that get() will not block.
@@ -454,6 +622,17 @@ public:
         global_persistence_done.get();
     }
 
+    /**
+     * Blocks until the update caused by this RPC function call has finished
+     * persisting on a quorum of replicas, as set by the subgroup profile's
+     * persistence_quorum. With the default quorum (all members) this is the
+     * same as await_global_persistence(). Like that function, it only works
+     * on QueryResults that are generated by ordered_send calls.
+     */
+    void await_quorum_persistence() {
+        quorum_persistence_done.get();
+    }
+
     /**
      * Blocks until the update caused by this RPC function call has been signed
      * on all replicas and the signatures have been verified. Note that this is
@@ -483,6 +662,14 @@ public:
         return global_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
     }
 
+    /**
+     * Checks if a call to await_quorum_persistence() would succeed without
+     * blocking; returns true if so.
+     */
+    bool quorum_persistence_is_ready() const {
+        return quorum_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
     /**
      * Checks if a call to await_signature_verification() would succeed without
      * blocking; returns true if so.
@@ -542,6 +729,8 @@ private:
     std::future<void> local_persistence_done;
     /** This signals that global persistence has completed for the version assigned to this RPC function call */
     std::future<void> global_persistence_done;
+    /** This signals that quorum persistence has completed for the version assigned to this RPC function call */
+    std::future<void> quorum_persistence_done;
     /** This signals that the signature has been verified at all replicas on the version assigned to this RPC function call */
     std::future<void> signature_done;
     /**
@@ -555,11 +744,12 @@ public:
     QueryResults(std::shared_ptr<PendingResults<void>> paired_pending_results,
                  map_fut reply_map_future, std::future<std::pair<persistent::version_t, uint64_t>> persistent_version,
                  std::future<void> local_persistence_done, std::future<void> global_persistence_done,
-                 std::future<void> signature_done)
+                 std::future<void> quorum_persistence_done, std::future<void> signature_done)
             : pending_rmap(std::move(reply_map_future)),
               persistent_version(std::move(persistent_version)),
               local_persistence_done(std::move(local_persistence_done)),
               global_persistence_done(std::move(global_persistence_done)),
+              quorum_persistence_done(std::move(quorum_persistence_done)),
               signature_done(std::move(signature_done)),
               paired_pending_results(paired_pending_results) {}
     QueryResults(QueryResults&& o)
@@ -568,6 +758,7 @@ public:
               persistent_version{std::move(o.persistent_version)},
               local_persistence_done{std::move(o.local_persistence_done)},
               global_persistence_done{std::move(o.global_persistence_done)},
+              quorum_persistence_done{std::move(o.quorum_persistence_done)},
               signature_done{std::move(o.signature_done)},
               paired_pending_results{std::move(o.paired_pending_results)} {}
     QueryResults(const QueryResults&) = delete;
@@ -650,6 +841,17 @@ public:
         global_persistence_done.get();
     }
 
+    /**
+     * Blocks until the update caused by this RPC function call has finished
+     * persisting on a quorum of replicas, as set by the subgroup profile's
+     * persistence_quorum. With the default quorum (all members) this is the
+     * same as await_global_persistence(). Like that function, it only works
+     * on QueryResults that are generated by ordered_send calls.
+     */
+    void await_quorum_persistence() {
+        quorum_persistence_done.get();
+    }
+
     /**
      * Blocks until the update caused by this RPC function call has been signed
      * on all replicas and the signatures have been verified. Note that this is
@@ -679,6 +881,14 @@ public:
         return global_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
     }
 
+    /**
+     * Checks if a call to await_quorum_persistence() would succeed without
+     * blocking; returns true if so.
+     */
+    bool quorum_persistence_is_ready() const {
+        return quorum_persistence_done.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+    }
+
     /**
      * Checks if a call to await_signature_verification() would succeed without
      * blocking; returns true if so.
@@ -694,16 +904,24 @@ public:
  * parameter.
  */
 class AbstractPendingResults {
+protected:
+    /** The sequence number of the P2P request this call was sent in, or 0 if it was not sent as one */
+    uint64_t p2p_request_id = 0;
+
 public:
     virtual void fulfill_map(const node_list_t&) = 0;
     virtual void delete_self_ptr() = 0;
     virtual void set_persistent_version(persistent::version_t, uint64_t) = 0;
     virtual void set_local_persistence() = 0;
     virtual void set_global_persistence() = 0;
+    virtual void set_quorum_persistence() = 0;
     virtual void set_signature_verified() = 0;
     virtual void set_exception_for_removed_node(const node_id_t&) = 0;
     virtual void set_exception_for_caller_removed() = 0;
     virtual bool all_responded() = 0;
+    virtual void set_reply_policy(const ReplyPolicy&) = 0;
+    void set_p2p_request_id(uint64_t request_id) { p2p_request_id = request_id; }
+    uint64_t get_p2p_request_id() const { return p2p_request_id; }
     virtual ~AbstractPendingResults() {}
 };
 
@@ -780,12 +998,96 @@ private:
      * replicas.
      */
     std::promise<void> global_persistence_promise;
+    /**
+     * A promise representing the "quorum persistence" event for the update
+     * caused by this RPC call; the future end lives in QueryResults. This is
+     * fulfilled to signal that the update has finished persisting on the
+     * subgroup's persistence quorum.
+     */
+    std::promise<void> quorum_persistence_promise;
     /**
      * A promise representing the "signature verified" event for the update
      * caused by this RPC call; the future end lives in QueryResults.
      */
     std::promise<void> signature_verified_promise;
 
+    /** The ReplyPolicy this RPC function call was sent with. */
+    ReplyPolicy reply_policy;
+    /**
+     * A promise representing the "reply policy satisfied" event; the future
+     * end lives in QueryResults. Fulfilled once enough replies have arrived
+     * to satisfy reply_policy, or once no more replies can arrive.
+     */
+    std::promise<void> reply_policy_promise;
+    /** True once reply_policy_promise has been fulfilled. */
+    bool reply_policy_satisfied = false;
+    /** The destination nodes in shard-rank order, as given to fulfill_map. */
+    node_list_t dest_node_order;
+    /** Destination nodes that were removed from the group before replying. */
+    std::set<node_id_t> removed_nodes;
+    /** Destination nodes that acknowledged the call without sending a value. */
+    std::set<node_id_t> value_omitted_nodes;
+    /** Called with a node's ID after its reply promise is fulfilled; see QueryResults::set_reply_listener. */
+    std::function<void(node_id_t)> reply_listener;
+
+    /**
+     * Calls reply_listener, if there is one, for a node that has just
+     * responded. Must be called with responded_nodes_mutex held.
+     */
+    void notify_reply_listener(node_id_t nid) {
+        if(reply_listener) {
+            reply_listener(nid);
+        }
+    }
+
+    /**
+     * Fulfills reply_policy_promise if the replies received so far satisfy
+     * reply_policy, or puts an exception in it if they never can. The nodes
+     * that must reply are recomputed from the nodes removed so far, so a
+     * failed sender is replaced by the same surviving member the replicas
+     * picked. If a node we now expect a value from only acknowledged the call
+     * (it executed the call before learning of the failure), no value will
+     * arrive, and the caller gets a node_removed_from_group_exception for the
+     * failed sender. Must be called with responded_nodes_mutex held.
+     */
+    void check_reply_policy() {
+        //dest_nodes is filled in before any reply can be delivered, unlike map_fulfilled
+        if(reply_policy_satisfied || dest_nodes.empty()) {
+            return;
+        }
+        if(reply_policy.kind == ReplyPolicy::Kind::ALL) {
+            if(responded_nodes == dest_nodes) {
+                reply_policy_satisfied = true;
+                reply_policy_promise.set_value();
+            }
+            return;
+        }
+        std::vector<char> failed(dest_node_order.size());
+        for(std::size_t rank = 0; rank < dest_node_order.size(); ++rank) {
+            failed[rank] = removed_nodes.count(dest_node_order[rank]) > 0;
+        }
+        const std::vector<uint32_t> senders = reply_policy.value_senders(failed);
+        //Too few members survived to send the values the policy asks for
+        bool unsatisfiable = senders.size() < reply_policy.num_values(dest_node_order.size());
+        bool satisfied = true;
+        for(const uint32_t sender_rank : senders) {
+            const node_id_t sender = dest_node_order[sender_rank];
+            unsatisfiable = unsatisfiable || value_omitted_nodes.count(sender);
+            satisfied = satisfied && responded_nodes.count(sender);
+        }
+        if(unsatisfiable) {
+            reply_policy_satisfied = true;
+            reply_policy_promise.set_exception(std::make_exception_ptr(
+                    node_removed_from_group_exception{removed_nodes.empty() ? dest_node_order[senders.front()]
+                                                                            : *removed_nodes.begin()}));
+            return;
+        }
+        if(satisfied) {
+            reply_policy_satisfied = true;
+            reply_policy_promise.set_value();
+        }
+    }
+
     /**
      * A flag set to true the first time delete_self_ptr() is called, to
      * prevent it from attempting to delete the pointer again if it is
@@ -828,7 +1130,9 @@ public:
                                                    version_promise.get_future(),
                                                    local_persistence_promise.get_future(),
                                                    global_persistence_promise.get_future(),
-                                                   signature_verified_promise.get_future());
+                                                   quorum_persistence_promise.get_future(),
+                                                   signature_verified_promise.get_future(),
+                                                   reply_policy_promise.get_future());
     }
 
     /**
@@ -843,6 +1147,8 @@ public:
         for(const auto& e : who) {
             futures->emplace(e, promises[e].get_future());
         }
+        //The member list is in shard-rank order, which is how the replicas pick the members that send values
+        dest_node_order = who;
         dest_nodes.insert(who.begin(), who.end());
         dbg_trace(RpcLoggerPtr::get(), "Setting a value for reply_promises_are_ready");
         promise_for_reply_promises.set_value(std::move(promises));
@@ -850,6 +1156,26 @@ public:
         map_fulfilled = true;
     }
 
+    /**
+     * Sets the ReplyPolicy for this RPC function call. Must be called before
+     * the call is sent.
+     */
+    void set_reply_policy(const ReplyPolicy& policy) {
+        reply_policy = policy;
+    }
+
+    /**
+     * Sets the function to call each time a node responds, and calls it for
+     * the nodes that have already responded.
+     */
+    void set_reply_listener(std::function<void(node_id_t)> listener) {
+        std::lock_guard<std::mutex> lock(responded_nodes_mutex);
+        reply_listener = std::move(listener);
+        for(const node_id_t nid : responded_nodes) {
+            notify_reply_listener(nid);
+        }
+    }
+
     /**
      * Stores the address of a heap-allocated shared_ptr to this PendingResults
      * object, which was allocated by RemoteInvoker and used as an invocation ID.
@@ -882,6 +1208,8 @@ public:
         if(!map_fulfilled) {
             promise_for_pending_map.set_exception(
                     std::make_exception_ptr(sender_removed_from_group_exception{}));
+            reply_policy_promise.set_exception(
+                    std::make_exception_ptr(sender_removed_from_group_exception{}));
         } else {
             if(reply_promises.size() == 0) {
                 reply_promises = std::move(reply_promises_are_ready.get());
@@ -893,8 +1221,15 @@ public:
                    == responded_nodes.end()) {
                     node_and_promise.second.set_exception(
                             std::make_exception_ptr(sender_removed_from_group_exception{}));
+                    notify_reply_listener(node_and_promise.first);
                 }
             }
+            //No more replies can arrive, so stop waiting on the policy
+            std::lock_guard<std::mutex> lock(responded_nodes_mutex);
+            if(!reply_policy_satisfied) {
+                reply_policy_satisfied = true;
+                reply_policy_promise.set_value();
+            }
         }
     }
 
@@ -914,7 +1249,10 @@ public:
            && responded_nodes.find(removed_nid) == responded_nodes.end()) {
             //Mark the node as "responded" for the purposes of the other methods
             responded_nodes.insert(removed_nid);
+            removed_nodes.insert(removed_nid);
             reply_promises.at(removed_nid).set_exception(std::make_exception_ptr(node_removed_from_group_exception{removed_nid}));
+            check_reply_policy();
+            notify_reply_listener(removed_nid);
         }
     }
 
@@ -935,6 +1273,9 @@ public:
             reply_promises = std::move(reply_promises_are_ready.get());
         }
         reply_promises.at(nid).set_value(v);
+        std::lock_guard<std::mutex> responded_lock(responded_nodes_mutex);
+        check_reply_policy();
+        notify_reply_listener(nid);
     }
 
     /**
@@ -952,6 +1293,23 @@ public:
             reply_promises = std::move(reply_promises_are_ready.get());
         }
         reply_promises.at(nid).set_exception(e);
+        std::lock_guard<std::mutex> lock(responded_nodes_mutex);
+        check_reply_policy();
+        notify_reply_listener(nid);
+    }
+
+    /**
+     * Fulfills a promise for a single node's reply to indicate that the node
+     * executed the RPC call but, because of the call's ReplyPolicy, only
+     * acknowledged it instead of sending its return value.
+     * @param nid The node that acknowledged the RPC call
+     */
+    void set_value_omitted(const node_id_t& nid) {
+        {
+            std::lock_guard<std::mutex> lock(responded_nodes_mutex);
+            value_omitted_nodes.insert(nid);
+        }
+        set_exception(nid, std::make_exception_ptr(reply_omitted_exception{nid}));
     }
 
     /**
@@ -991,6 +1349,15 @@ public:
         global_persistence_promise.set_value();
     }
 
+    /**
+     * Fulfills the quorum persistence promise, unblocking the future end. This
+     * should be called to signal client code that the update has finished
+     * persisting on the persistence quorum of this subgroup.
+     */
+    void set_quorum_persistence() {
+        quorum_persistence_promise.set_value();
+    }
+
     /**
      * Fulfills the signature verification promise, unblocking the future end.
      * This should be called to signal client code that the update has been
@@ -1025,6 +1392,7 @@ private:
     std::promise<std::pair<persistent::version_t, uint64_t>> version_promise;
     std::promise<void> local_persistence_promise;
     std::promise<void> global_persistence_promise;
+    std::promise<void> quorum_persistence_promise;
     std::promise<void> signature_verified_promise;
 
 public:
@@ -1034,6 +1402,7 @@ public:
                                                     version_promise.get_future(),
                                                     local_persistence_promise.get_future(),
                                                     global_persistence_promise.get_future(),
+                                                    quorum_persistence_promise.get_future(),
                                                     signature_verified_promise.get_future());
     }
 
@@ -1056,6 +1425,10 @@ public:
 
     void set_exception_for_removed_node(const node_id_t&) {}
 
+    void set_reply_policy(const ReplyPolicy&) {
+        //Void functions do not send replies, so there is no policy to apply
+    }
+
     void set_exception_for_caller_removed() {
         if(!map_fulfilled) {
             promise_for_pending_map.set_exception(
@@ -1095,6 +1468,15 @@ public:
         global_persistence_promise.set_value();
     }
 
+    /**
+     * Fulfills the quorum persistence promise, unblocking the future end. This
+     * should be called to signal client code that the update has finished
+     * persisting on the persistence quorum of this subgroup.
+     */
+    void set_quorum_persistence() {
+        quorum_persistence_promise.set_value();
+    }
+
     /**
      * Fulfills the signature verification promise, unblocking the future end.
      * This should be called to signal client code that the update has been
@@ -1119,6 +1501,24 @@ namespace remote_invocation_utilities {
 // add new rpc header flags here.
 #define _RPC_HEADER_FLAG_CASCADE (0)
 #define _RPC_HEADER_FLAG_RESERVED (1)
+// A CANCEL message carries only the request ID of an earlier P2P request from the same sender
+#define _RPC_HEADER_FLAG_CANCEL (2)
+
+// The upper bits of the flags field carry the ReplyPolicy of an ordered_send:
+// bits 8-15 hold the policy kind and bits 16-31 hold its parameter.
+#define _RPC_HEADER_REPLY_POLICY_KIND_SHIFT (8)
+#define _RPC_HEADER_REPLY_POLICY_PARAM_SHIFT (16)
+
+inline void set_reply_policy(uint32_t& flags, const ReplyPolicy& policy) {
+    flags &= (((uint32_t)1L) << _RPC_HEADER_REPLY_POLICY_KIND_SHIFT) - 1;
+    flags |= static_cast<uint32_t>(policy.kind) << _RPC_HEADER_REPLY_POLICY_KIND_SHIFT;
+    flags |= static_cast<uint32_t>(policy.param) << _RPC_HEADER_REPLY_POLICY_PARAM_SHIFT;
+}
+
+inline ReplyPolicy get_reply_policy(const uint32_t& flags) {
+    return ReplyPolicy{static_cast<ReplyPolicy::Kind>((flags >> _RPC_HEADER_REPLY_POLICY_KIND_SHIFT) & 0xff),
+                       static_cast<uint16_t>(flags >> _RPC_HEADER_REPLY_POLICY_PARAM_SHIFT)};
+}
 
 inline std::size_t header_space() {
     return sizeof(std::size_t) + sizeof(Opcode) + sizeof(node_id_t) + sizeof(uint32_t);
@@ -1159,6 +1559,40 @@ inline void retrieve_header(mutils::RemoteDeserialization_v* rdv,
     offset += sizeof(from);
     flags = reinterpret_cast<const uint32_t*>(reply_buf + offset)[0];
 }
+
+/**
+ * The fields that only P2P requests need, which every message in a P2P
+ * request buffer carries before its RPC header. Ordered sends and replies
+ * don't have them.
+ */
+struct p2p_request_header {
+    /**
+     * A wall-clock time in nanoseconds (see get_walltime()) after which the
+     * request may be dropped without being executed, or 0 for no deadline
+     */
+    uint64_t deadline;
+    /**
+     * The request's sequence number among the P2P requests from its sender to
+     * its destination, which identifies it in a CANCEL message
+     */
+    uint64_t request_id;
+};
+
+/**
+ * Writes the p2p_request_header at the start of a P2P request buffer.
+ * @return A pointer to the rest of the buffer, where the RPC message goes
+ */
+inline uint8_t* populate_p2p_request_header(uint8_t* request_buf, uint64_t deadline, uint64_t request_id) {
+    const p2p_request_header request_header{deadline, request_id};
+    std::memcpy(request_buf, &request_header, sizeof(request_header));
+    return request_buf + sizeof(request_header);
+}
+
+inline p2p_request_header retrieve_p2p_request_header(const uint8_t* request_buf) {
+    p2p_request_header request_header;
+    std::memcpy(&request_header, request_buf, sizeof(request_header));
+    return request_header;
+}
 }  // namespace remote_invocation_utilities
 
 }  // namespace rpc
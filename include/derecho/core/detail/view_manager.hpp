@@ -19,10 +19,12 @@
 
 #include <spdlog/spdlog.h>
 
+#include <chrono>
 #include <list>
 #include <map>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <string>
 #include <thread>
@@ -139,6 +141,14 @@ private:
     /** May hold a pointer to the partially-constructed next view, if we are
      *  in the process of transitioning to a new view. */
     std::unique_ptr<View> next_view;
+    /** The first RDMC group number of the range reserved for this Group's
+     *  multicast groups in this process. RDMC group numbers only identify
+     *  groups locally, so each member reserves whichever range is free in its
+     *  own process, and different members of a Group may use different ones. */
+    std::optional<uint16_t> rdmc_group_num_base;
+    /** The node ID with which initialize_rdmc_sst() initialized RDMC and SST,
+     *  once it has; the destructor releases this Group's share of them. */
+    std::optional<node_id_t> transport_node_id;
 
     /** contains client sockets for pending requests that have not yet been handled.*/
     LockedQueue<tcp::socket> pending_new_sockets;
@@ -153,6 +163,29 @@ private:
      */
     std::list<std::pair<node_id_t, tcp::socket>> startup_pending_external_sockets;
 
+    /**
+     * A send that was issued by send_async() while the current view was wedged
+     * for a view change (or could not be sent without waiting), and is waiting
+     * to be replayed by queued_send_thread.
+     */
+    struct QueuedSend {
+        long long unsigned int payload_size;
+        std::function<void(uint8_t* buf)> msg_generator;
+        bool cooked_send;
+        send_completion_callback_t completion_callback;
+    };
+    /**
+     * Sends queued during a view change, indexed by subgroup ID. A QueuedSend
+     * stays at the front of its queue until it has been handed to the new
+     * view's MulticastGroup, so a non-empty queue means later sends to the
+     * same subgroup must also be queued to preserve their order.
+     */
+    std::map<subgroup_id_t, std::queue<QueuedSend>> queued_sends;
+    std::mutex queued_sends_mutex;
+    std::condition_variable queued_sends_cv;
+    /** The maximum number of sends that can be queued for each subgroup. */
+    const uint32_t max_queued_sends;
+
     /** Contains old Views that need to be cleaned up. */
     std::queue<std::unique_ptr<View>> old_views;
     std::mutex old_views_mutex;
@@ -169,6 +202,8 @@ private:
     /** The background thread that listens for clients connecting on our server socket. */
     std::thread client_listener_thread;
     std::thread old_view_cleanup_thread;
+    /** The background thread that replays queued sends into the current view. */
+    std::thread queued_send_thread;
 
     /**
      * A user-configurable option that disables the checks for partitioning events.
@@ -274,6 +309,13 @@ private:
      */
     std::atomic<bool> bSilent = false;
 
+    /**
+     * Set by drain() once the successors of this node have caught up with it
+     * and it only has to flush its last messages before leaving; from then
+     * on, new application sends are refused.
+     */
+    std::atomic<bool> draining = false;
+
     std::function<void(uint32_t)> add_external_connection_upcall;
 
     bool has_pending_new() { return pending_new_sockets.locked().access.size() > 0; }
@@ -520,6 +562,14 @@ private:
     void startup_to_first_view();
     /** Constructor helper method to encapsulate spawning the background threads. */
     void create_threads();
+    /**
+     * The main loop of queued_send_thread. Waits for send_async() to queue
+     * messages, then replays them into the current view's MulticastGroup in
+     * FIFO order within each subgroup, blocking (in this thread only) until
+     * any in-progress view change has finished and the subgroup's window and
+     * rate limits admit the message.
+     */
+    void replay_queued_sends();
     /** Constructor helper method to encapsulate creating all the predicates. */
     void register_predicates();
     /** Constructor helper that reads logged ragged trim information from disk,
@@ -528,10 +578,15 @@ private:
     /** Constructor helper for the leader when it first starts; waits for enough
      * new nodes to join to make the first view adequately provisioned. */
     void await_first_view();
+    /** Constructor helper for the leader; reserves the range of RDMC group
+     * numbers it will send to joining nodes, unless it already has one. */
+    void reserve_rdmc_group_numbers();
     /**
      * Constructor helper for non-leader nodes; encapsulates receiving and
-     * deserializing a View, DerechoParams, and state-transfer leaders (old
-     * shard leaders) from the leader.
+     * deserializing a View, DerechoParams, state-transfer leaders (old
+     * shard leaders), and the range of RDMC group numbers from the leader.
+     * Throws a derecho_exception if another Group in this process already
+     * reserved that range.
      * @return true if the leader successfully sent the View, false if the
      * leader crashed (i.e. a socket operation to it failed) before completing
      * the process.
@@ -647,6 +702,48 @@ private:
      * transfer), the "node ID" for that shard will be -1.
      */
     static vector_int64_2d old_shard_leaders_by_new_ids(const View& curr_view, const View& next_view);
+    /**
+     * Lists the warm standbys of one of this node's shards in the current
+     * View that did not receive every message within the shard's ragged
+     * trim, and so cannot deliver it. Must be called after the ragged trim is
+     * known; since the SST rows it reads no longer change by then, every
+     * member of the shard finds the same standbys.
+     * @param subgroup_id The subgroup ID in the current View
+     * @param shard_num This node's shard of the subgroup
+     */
+    std::vector<node_id_t> standbys_behind_ragged_trim(subgroup_id_t subgroup_id, uint32_t shard_num) const;
+    /**
+     * Adds the warm standbys that fell behind the ragged trims of this node's
+     * shards to the joined lists of those shards in next_view, if they are
+     * still members, so that they get the shard's state from the old shard
+     * leader like a joining member.
+     */
+    void mark_standbys_behind_ragged_trim();
+    /**
+     * Chooses the warm standby that will replace this node in each of its
+     * shards once it leaves: the one with the lowest node ID, since the
+     * allocator promotes available standbys in that order. Shards without a
+     * warm standby, shards in which this node is itself a standby, and
+     * UNORDERED subgroups have no successor.
+     * @return A map from subgroup ID to the node ID of this node's successor
+     * in that subgroup, in the current View
+     */
+    std::map<subgroup_id_t, node_id_t> choose_drain_successors() const;
+    /**
+     * Used by drain() to wait, while holding the view lock, until the
+     * successor chosen by choose_drain_successors() in each of this node's
+     * shards has delivered everything this node has delivered and persisted
+     * every version it delivered. If include_own_sends is true, it also waits
+     * until every member of those shards has delivered all of this node's
+     * messages and the global persistence frontier covers its delivered
+     * versions. If the View changes, it chooses the successors again and
+     * starts over with new targets.
+     * @param include_own_sends Whether to wait for this node's own messages
+     * @param deadline The time to give up, or std::nullopt to wait indefinitely
+     * @return true if the targets were reached, false if the deadline passed
+     * or this node is shutting down
+     */
+    bool wait_for_handover(bool include_own_sends, std::optional<std::chrono::steady_clock::time_point> deadline);
 
     /**
      * A little convenience method that receives a 2-dimensional vector using
@@ -827,6 +924,33 @@ public:
     /** Causes this node to cleanly leave the group by setting itself to "failed." */
     void leave();
 
+    /**
+     * Prepares this node for a planned leave, so that removing it from the
+     * group is a cheap View change for the remaining members. It hands each
+     * of this node's shard roles to a successor chosen by
+     * choose_drain_successors(): a warm standby of the shard (see
+     * ShardAllocationPolicy::warm_standbys), which already receives and
+     * persists every update, and which the allocator promotes in the View
+     * that removes this node. First, while this node keeps sending and
+     * serving requests as usual, it waits until every successor has caught
+     * up with what this node has delivered and persisted. Only then does it
+     * stop accepting new sends (send() then throws and send_async() and
+     * try_send() refuse the message), wait for the sends already queued to be
+     * replayed, and wait until every member of its shards, including the
+     * successors, has delivered all of its messages, and the persistent
+     * subgroups have persisted every version it delivered. The ragged edge
+     * cleanup triggered by its departure then has none of its messages to
+     * discard or wait for, and the successor needs no state transfer. In a
+     * shard without a warm standby, the allocator picks a replacement when
+     * this node leaves, and it gets the shard's state by state transfer as
+     * usual. The waits block on the condition variables that signal
+     * progress, and start over with new targets if the View changes.
+     * @param timeout The maximum time to wait, or zero to wait indefinitely
+     * @return true if the successors and the rest of the group caught up with
+     * this node, false if the timeout expired first
+     */
+    bool drain(std::chrono::milliseconds timeout);
+
     /** Returns a vector listing the nodes that are currently members of the group. */
     std::vector<node_id_t> get_members();
 
@@ -843,6 +967,10 @@ public:
      * (identified by type and index), organized by shard number. */
     std::vector<std::vector<node_id_t>> get_subgroup_members(subgroup_type_id_t subgroup_type, uint32_t subgroup_index);
 
+    /** Returns the members of a single subgroup like get_subgroup_members(),
+     * but without the warm standbys of each shard. */
+    std::vector<std::vector<node_id_t>> get_subgroup_non_standby_members(subgroup_type_id_t subgroup_type, uint32_t subgroup_index);
+
     /** Returns a vector of vectors listing the IP addresses and ports of a
      * single subgroup (identified by type and index), organized by shard number. */
     std::vector<std::vector<IpAndPorts>> get_subgroup_member_addresses(subgroup_type_id_t subgroup_type, uint32_t subgroup_index);
@@ -894,6 +1022,41 @@ public:
     void send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
               const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send = false);
 
+    /**
+     * A non-blocking version of send(). If the current view is able to accept
+     * the message, it is sent immediately and completion_callback is called
+     * before this function returns. If a view change is in progress, the send
+     * would have to wait for window space or the subgroup's rate limits, or
+     * earlier sends to the same subgroup are still queued, the message is queued and
+     * will be replayed into the next view's MulticastGroup by a background
+     * thread, which calls completion_callback once the message has been sent
+     * or dropped. Since msg_generator may run after this function returns, it
+     * must not capture any references to the caller's stack.
+     * @param subgroup_num The subgroup to send to
+     * @param payload_size The size of the message payload
+     * @param msg_generator A function that writes the message into a buffer
+     * @param completion_callback A function to call when the send completes
+     * @param cooked_send True if the message is an RPC message
+     * @return true if the message was sent or queued, false if the queue for
+     * this subgroup was full and the message was neither sent nor queued (in
+     * which case completion_callback will not be called)
+     */
+    bool send_async(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                    const std::function<void(uint8_t* buf)>& msg_generator,
+                    const send_completion_callback_t& completion_callback,
+                    bool cooked_send = false);
+
+    /**
+     * A non-blocking version of send() that honors the subgroup's rate limits
+     * and admission control. Sends the message only if it can be sent without
+     * waiting; otherwise returns immediately without calling msg_generator.
+     * @return ADMITTED if the message was sent; RATE_LIMITED or OVERLOADED if
+     * the subgroup's rate limit or admission controller rejected it; or
+     * WOULD_BLOCK if the send window is full or a view change is in progress
+     */
+    send_admission try_send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                            const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send = false);
+
     const uint64_t compute_global_stability_frontier(subgroup_id_t subgroup_num);
 
     /**
@@ -911,6 +1074,21 @@ public:
      */
     bool wait_for_global_persistence_frontier(subgroup_id_t subgroup_num,persistent::version_t version) const;
 
+    /**
+     * Get the current quorum persistence frontier. For persisted data ONLY.
+     * @param subgroup_num  the subgroup id
+     * @return the latest version persisted by the subgroup's persistence quorum
+     */
+    const persistent::version_t get_quorum_persistence_frontier(subgroup_id_t subgroup_num) const;
+
+    /**
+     * Wait on quorum persistence frontier
+     * @param subgroup_num  the subgroup id
+     * @param version   the version to wait on
+     * @return false if the given version is beyond the latest atomic broadcast.
+     */
+    bool wait_for_quorum_persistence_frontier(subgroup_id_t subgroup_num, persistent::version_t version) const;
+
     /**
      * Get the current global verified frontier. For persisted and signed data ONLY.
      * @param subgroup_num  the subgroup id
@@ -7,6 +7,7 @@
 
 #include "derecho/conf/conf.hpp"
 #include "detail/connection_manager.hpp"
+#include "detail/hedged_query.hpp"
 #include "detail/p2p_connection_manager.hpp"
 #include "group.hpp"
 #include "notification.hpp"
@@ -54,6 +55,18 @@ private:
     std::unique_ptr<T> client_stub;
     mutable std::unique_ptr<std::mutex> client_stub_mutex;
     std::unique_ptr<rpc::RemoteInvocableOf<T>> remote_invocable_ptr;
+    /** Recent P2P reply latencies, which determine when p2p_send_hedged sends its duplicate request */
+    std::shared_ptr<rpc::ReplyLatencyTracker> hedge_latency_tracker;
+    /** Keeps the process's hedge timer running while this object can send hedged queries */
+    std::shared_ptr<rpc::HedgeTimer> hedge_timer;
+
+    /**
+     * Implements p2p_send and p2p_send_with_deadline; a deadline of 0 means
+     * none. If wait_for_buffer is false and the P2P window to dest_node is
+     * full, throws send_window_full_exception instead of waiting for a buffer.
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_until(node_id_t dest_node, uint64_t deadline, bool wait_for_buffer, Args&&... args);
 
 public:
     /**
@@ -101,6 +114,44 @@ public:
      */
     template <rpc::FunctionTag tag, typename... Args>
     auto p2p_send(node_id_t dest_node, Args&&... args);
+    /**
+     * Sends a hedged peer-to-peer query: the request is sent to dest_node, and
+     * if its reply has not arrived within a percentile of recent reply
+     * latencies, the same request is sent to hedge_node. The first reply is
+     * returned and the other is discarded. Only use this for read-only
+     * functions, since both nodes may execute the call. The duplicate request
+     * is sent from a timer thread through this object, so the returned
+     * HedgedQueryResults must be destroyed before this ExternalClientCaller.
+     * @param dest_node The ID of the node to send the request to first
+     * @param hedge_node The ID of another replica in the same shard
+     * @param args The arguments to the RPC function being invoked
+     * @return An instance of rpc::HedgedQueryResults<Ret>, where Ret is the
+     * return type of the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_hedged(node_id_t dest_node, node_id_t hedge_node, Args&&... args);
+    /**
+     * Sends a peer-to-peer message like p2p_send, with a deadline. If the
+     * destination node has not started executing the request by the time the
+     * deadline passes, it drops the request and replies with a
+     * request_expired_exception instead. The deadline is checked against the
+     * destination node's wall clock, so it assumes loosely synchronized clocks.
+     * @param dest_node The ID of the node that the P2P message should be sent to
+     * @param timeout How long from now the request remains worth executing
+     * @param args The arguments to the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_with_deadline(node_id_t dest_node, std::chrono::nanoseconds timeout, Args&&... args);
+    /**
+     * Cancels a P2P request sent earlier with p2p_send. If the destination
+     * node has not started executing it yet, the request is dropped and its
+     * QueryResults gets a request_expired_exception; otherwise the normal
+     * reply still arrives.
+     * @param dest_node The node the request was sent to
+     * @param results The QueryResults returned when the request was sent
+     */
+    template <typename Ret>
+    void cancel(node_id_t dest_node, const rpc::QueryResults<Ret>& results);
 };
 
 /**
@@ -120,7 +171,14 @@ class ExternalGroupClient {
 private:
     template <typename T, typename ExternalGroupType>
     friend class ExternalClientCaller;
+    /**
+     * The client's node ID and external port, which are DERECHO/local_id and
+     * DERECHO/external_port unless DERECHO/external_client_id and
+     * DERECHO/external_client_port are set (as they must be if the process
+     * is also a member of a Group).
+     */
     const node_id_t my_id;
+    const uint16_t my_external_port;
     std::unique_ptr<View> prev_view;
     std::unique_ptr<View> curr_view;
     std::unique_ptr<sst::P2PConnectionManager> p2p_connections;
@@ -159,7 +217,12 @@ private:
     std::shared_ptr<spdlog::logger> rpc_logger;
     const uint64_t busy_wait_before_sleep_ms;
     sst::P2PBufferHandle get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type);
+    /** Like RPCManager::get_p2p_request_buffer */
+    sst::P2PBufferHandle get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline = 0);
+    /** Like RPCManager::try_get_p2p_request_buffer */
+    std::optional<sst::P2PBufferHandle> try_get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline = 0);
     void send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num, std::weak_ptr<AbstractPendingResults> pending_results_handle);
+    void send_p2p_cancel(node_id_t dest_id, uint64_t request_id);
     std::atomic<bool> thread_shutdown{false};
     std::thread rpc_listener_thread;
     /** p2p send and queries are queued in fifo worker */
@@ -180,7 +243,7 @@ private:
     mutils::RemoteDeserialization_v rdv;
     void p2p_receive_loop();
     void p2p_request_worker();
-    void p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf);
+    void p2p_message_handler(node_id_t sender_id, sst::MESSAGE_TYPE type, uint8_t* msg_buf);
     std::exception_ptr receive_message(const rpc::Opcode& indx, const node_id_t& received_from,
                                        uint8_t const* const buf, std::size_t payload_size,
                                        const std::function<uint8_t*(int)>& out_alloc);
@@ -289,6 +352,15 @@ public:
     template <typename SubgroupType>
     std::vector<std::vector<node_id_t>> get_subgroup_members(uint32_t subgroup_index = 0) const;
 
+    /**
+     * Get subgroup members, leaving out the warm standbys of each shard
+     * @tparam SubgroupType     The type of the subgroup
+     * @param subgroup_index    The index of the subgroup of type 'SubgroupType'
+     * @return      A vector of vectors, each element vector contains the non-standby nodes in the corresponding shard.
+     */
+    template <typename SubgroupType>
+    std::vector<std::vector<node_id_t>> get_subgroup_non_standby_members(uint32_t subgroup_index = 0) const;
+
     /**
      * Get Out-of-band memory region's remote access key
      * @param addr      The address of the memory region
@@ -106,6 +106,9 @@ public:
     template <typename SubgroupType>
     std::vector<std::vector<node_id_t>> get_subgroup_members(uint32_t subgroup_index = 0);
 
+    template <typename SubgroupType>
+    std::vector<std::vector<node_id_t>> get_subgroup_non_standby_members(uint32_t subgroup_index = 0);
+
     template <typename SubgroupType>
     std::vector<std::vector<IpAndPorts>> get_subgroup_member_addresses(uint32_t subgroup_index = 0);
 
@@ -135,6 +138,7 @@ public:
     PeerCaller<ReplicatedType>& get_nonmember_subgroup(uint32_t subgroup_index = 0);
     ExternalClientCallback<ReplicatedType>& get_client_callback(uint32_t subgroup_index = 0);
     std::vector<std::vector<node_id_t>> get_subgroup_members(uint32_t subgroup_index = 0);
+    std::vector<std::vector<node_id_t>> get_subgroup_non_standby_members(uint32_t subgroup_index = 0);
     std::vector<std::vector<IpAndPorts>> get_subgroup_member_addresses(uint32_t subgroup_index = 0);
     std::size_t get_number_of_shards(uint32_t subgroup_index = 0);
     uint32_t get_num_subgroups();
@@ -327,7 +331,9 @@ public:
      * the Derecho configuration file (loaded by the conf module).
      *
      * @param callbacks The set of callback functions for message delivery
-     * events in this group.
+     * events in this group. Note that the optimistic delivery callback is
+     * given no body for RPC calls sent with ordered_send (see
+     * UserMessageCallbacks::optimistic_delivery_callback).
      * @param subgroup_info The set of functions that define how membership in
      * each subgroup and shard will be determined in this group.
      * @param deserialization_context The context used for deserialization
@@ -426,6 +432,26 @@ public:
      */
     void leave(bool group_shutdown = true);
 
+    /**
+     * Causes this node to leave the group in a planned way that disrupts the
+     * remaining members as little as possible. In each of its shards that has
+     * a warm standby (see ShardAllocationPolicy::warm_standbys), it hands its
+     * role to the standby with the lowest node ID, which the allocator
+     * promotes in the View that removes this node. This node keeps serving
+     * while its successors catch up with the messages it delivered and the
+     * versions it persisted. Then it refuses new sends, waits until the
+     * members of its shards have delivered every message it sent and
+     * persisted every version it delivered, and leaves, so the View change
+     * that removes it has nothing of this node's to clean up and the
+     * successors need no state transfer. A shard without a warm standby gets
+     * a replacement from the allocator, which receives the shard's state by
+     * state transfer as usual.
+     * @param timeout The maximum time to wait for the group to catch up before
+     * leaving anyway, or zero to wait indefinitely
+     * @return true if the group caught up with this node before it left
+     */
+    bool drain(std::chrono::milliseconds timeout = std::chrono::milliseconds::zero());
+
     /** @returns a vector listing the nodes that are currently members of the group. */
     std::vector<node_id_t> get_members();
 
@@ -462,6 +488,19 @@ public:
     template <typename SubgroupType>
     std::vector<std::vector<node_id_t>> get_subgroup_members(uint32_t subgroup_index = 0);
 
+    /**
+     * Gets the nodes currently assigned to the subgroup of the specified type
+     * and index, organized by shard, like get_subgroup_members(), but leaves
+     * out each shard's warm standbys, which apply updates but do not answer
+     * requests.
+     * @tparam SubgroupType the subgroup type
+     * @param subgroup_index The index of the subgroup (of the same type)
+     * @return A vector of vectors, where the outer index represents a shard
+     * number, and the inner index counts the non-standby nodes in that shard.
+     */
+    template <typename SubgroupType>
+    std::vector<std::vector<node_id_t>> get_subgroup_non_standby_members(uint32_t subgroup_index = 0);
+
     /**
      * Gets a list of IP addresses of nodes currently assigned to the subgroup
      * of the specified type and index, organized by shard. This has the same
@@ -0,0 +1,320 @@
+#pragma once
+
+/**
+ * @file kv_store.hpp
+ * @brief A persistent key-value store that can be used as a Replicated type.
+ */
+
+#include "bytes_object.hpp"
+#include "derecho/mutils-serialization/SerializationSupport.hpp"
+#include "derecho/persistent/Persistent.hpp"
+#include "register_rpc_functions.hpp"
+#include "replicated.hpp"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * An open-addressing hash table from keys to values, both arbitrary byte
+ * strings. It uses linear probing over a power-of-two array of slots, each of
+ * which caches the hash of its key so that probes rarely compare keys, and
+ * backward-shift deletion so that lookups never have to skip tombstones.
+ * The caller computes the hashes with hash(), so that a hash can be reused
+ * across several tables. Not thread-safe.
+ */
+class KVIndex {
+    struct Slot {
+        /** The hash of the key; 0 marks an empty slot */
+        uint64_t hash = 0;
+        std::string key;
+        std::string value;
+    };
+    std::vector<Slot> slots;
+    std::size_t num_entries = 0;
+
+    /** Doubles the number of slots, or allocates the first ones. */
+    void grow();
+
+public:
+    /** @return The hash of a key, which is never 0 */
+    static uint64_t hash(std::string_view key);
+
+    /** @return The value of the key, or nullptr if it is absent; valid until the next update */
+    const std::string* find(std::string_view key, uint64_t hash) const;
+    /** Inserts the key, or replaces its value if it is present. */
+    void put(std::string_view key, uint64_t hash, std::string_view value);
+    /** @return true if the key was present and has been removed */
+    bool erase(std::string_view key, uint64_t hash);
+    void clear();
+
+    std::size_t size() const { return num_entries; }
+
+    /** Calls visitor(key, value) for each entry, in no particular order. */
+    template <typename Func>
+    void for_each(Func&& visitor) const {
+        for(const Slot& slot : slots) {
+            if(slot.hash != 0) {
+                visitor(slot.key, slot.value);
+            }
+        }
+    }
+};
+
+/**
+ * The updates of one version of a KVStoreState, as they are stored in its
+ * Persistent log: a 32-bit number of operations, each of which is an opcode
+ * byte, the 32-bit sizes of the key and the value, then the key and the value.
+ * A KVStoreDelta deserialized with from_bytes_noalloc() reads the log entry in
+ * place, which is how KVStore answers versioned and temporal reads.
+ */
+class KVStoreDelta : public mutils::ByteRepresentable {
+public:
+    enum class Op : uint8_t {
+        PUT = 0,
+        REMOVE = 1
+    };
+
+private:
+    const uint8_t* buffer;
+    std::size_t length;
+    /** Holds the buffer if this delta was deserialized by copying it */
+    std::unique_ptr<uint8_t[]> owned_buffer;
+
+public:
+    /** Reads a serialized delta in place; the buffer must outlive this object. */
+    explicit KVStoreDelta(const uint8_t* buffer);
+
+    /** Appends an operation to a delta being built, which must start out empty. */
+    static void append(std::string& delta, Op op, std::string_view key, std::string_view value);
+
+    /** Calls visitor(op, key, value) for each operation of the delta, in order. */
+    template <typename Func>
+    void for_each(Func&& visitor) const {
+        uint32_t num_ops;
+        memcpy(&num_ops, buffer, sizeof(num_ops));
+        std::size_t offset = sizeof(num_ops);
+        for(uint32_t i = 0; i < num_ops; ++i) {
+            const Op op = static_cast<Op>(buffer[offset]);
+            uint32_t key_size;
+            uint32_t value_size;
+            memcpy(&key_size, buffer + offset + 1, sizeof(key_size));
+            memcpy(&value_size, buffer + offset + 1 + sizeof(key_size), sizeof(value_size));
+            offset += 1 + sizeof(key_size) + sizeof(value_size);
+            const std::string_view key(reinterpret_cast<const char*>(buffer + offset), key_size);
+            const std::string_view value(reinterpret_cast<const char*>(buffer + offset + key_size), value_size);
+            offset += key_size + value_size;
+            visitor(op, key, value);
+        }
+    }
+
+    /**
+     * @return The last operation of the delta on the key, and the value it
+     * put (empty for a REMOVE), or std::nullopt if the delta does not update
+     * the key
+     */
+    std::optional<std::pair<Op, std::string_view>> find(std::string_view key) const;
+
+    /** @return The keys the delta updates; a DeltaKeyExtractor for KVStoreState's log */
+    static std::vector<std::string> extract_keys(const uint8_t* const buffer, std::size_t size);
+
+    std::size_t to_bytes(uint8_t* buffer) const;
+    std::size_t bytes_size() const;
+    void post_object(const std::function<void(uint8_t const* const, std::size_t)>& post_func) const;
+    void ensure_registered(mutils::DeserializationManager&) {}
+    static std::unique_ptr<KVStoreDelta> from_bytes(mutils::DeserializationManager*, const uint8_t* const buffer);
+    static mutils::context_ptr<KVStoreDelta> from_bytes_noalloc(mutils::DeserializationManager*, const uint8_t* const buffer);
+    static mutils::context_ptr<const KVStoreDelta> from_bytes_noalloc_const(mutils::DeserializationManager*, const uint8_t* const buffer);
+};
+
+/**
+ * The state of a KVStore, which is kept in a Persistent<KVStoreState> and
+ * logged as one KVStoreDelta per version.
+ *
+ * The entries are split over NUM_PARTITIONS KVIndex tables by key hash, each
+ * with its own lock, so that updates to different keys can be applied
+ * concurrently (see ParallelApply), and reads do not wait for updates to
+ * other partitions. The delta of each version is kept apart while its call is
+ * applied, under ParallelApply::applying_version(), so that it is logged under
+ * the right version even if calls with later versions finish first.
+ *
+ * When state is transferred to a node that already has a persisted log of this
+ * object, only a marker is sent instead of the entries; the node then rebuilds
+ * the state from its own log, to which the sender has appended the entries it
+ * was missing (see rebuild()). A node whose log has been trimmed cannot do
+ * that, so it asks for the entries instead (see KVStore::local_log_is_complete()).
+ */
+class KVStoreState : public mutils::ByteRepresentable, public persistent::IDeltaSupport<KVStoreState> {
+public:
+    static constexpr std::size_t NUM_PARTITIONS = 64;
+
+private:
+    struct Partition {
+        mutable std::mutex mutex;
+        KVIndex index;
+    };
+    std::array<Partition, NUM_PARTITIONS> partitions;
+    /** Guards pending_deltas */
+    std::mutex delta_mutex;
+    /** The deltas of the versions being applied, by version */
+    std::map<persistent::version_t, std::string> pending_deltas;
+    /** True if this state was received as a marker, and must be rebuilt from the log */
+    bool rebuild_needed = false;
+
+    Partition& partition_of(uint64_t hash) { return partitions[hash >> 58]; }
+    const Partition& partition_of(uint64_t hash) const { return partitions[hash >> 58]; }
+    /** Applies an update to the entries, without recording it; false if it removed an absent key. */
+    bool apply(KVStoreDelta::Op op, std::string_view key, std::string_view value);
+    /** Records an update in the delta of the version being applied. */
+    void record(KVStoreDelta::Op op, std::string_view key, std::string_view value);
+    /** @return true if this state is serialized as a marker, during a state transfer to a node with a log */
+    bool serialize_as_marker() const;
+
+public:
+    static_assert(NUM_PARTITIONS == 64, "partition_of() uses the top 6 bits of the hash");
+
+    KVStoreState() = default;
+
+    /** Sets the value of a key. */
+    void put(std::string_view key, std::string_view value);
+    /** @return true if the key was present and has been removed */
+    bool remove(std::string_view key);
+
+    /**
+     * Calls reader(value) with the key's value, while holding its partition's
+     * lock.
+     * @return false if the key is absent, in which case reader is not called
+     */
+    template <typename Func>
+    bool read(std::string_view key, Func&& reader) const {
+        const uint64_t hash = KVIndex::hash(key);
+        const Partition& partition = partition_of(hash);
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        const std::string* value = partition.index.find(key, hash);
+        if(value == nullptr) {
+            return false;
+        }
+        reader(*value);
+        return true;
+    }
+
+    /** @return The number of keys */
+    std::size_t size() const;
+
+    /** @return true if this state must be rebuilt from the log before use */
+    bool needs_rebuild() const { return rebuild_needed; }
+    /**
+     * Rebuilds a state received as a marker, by applying the deltas of a
+     * Persistent<KVStoreState> log from the first version to the last one.
+     * @throws derecho_exception if the log has been trimmed
+     */
+    void rebuild(const persistent::Persistent<KVStoreState>& log);
+
+    /** @return true if none of a Persistent<KVStoreState> log's entries have been trimmed */
+    static bool log_is_complete(const persistent::Persistent<KVStoreState>& log);
+
+    // IDeltaSupport
+    virtual void finalizeCurrentDelta(const persistent::DeltaFinalizer& finalizer) override;
+    virtual void applyDelta(uint8_t const* const delta) override;
+    static std::unique_ptr<KVStoreState> create(mutils::DeserializationManager*);
+
+    // ByteRepresentable: a flag that is true for a marker, then the number of entries and each entry
+    std::size_t to_bytes(uint8_t* buffer) const;
+    std::size_t bytes_size() const;
+    void post_object(const std::function<void(uint8_t const* const, std::size_t)>& post_func) const;
+    void ensure_registered(mutils::DeserializationManager&) {}
+    static std::unique_ptr<KVStoreState> from_bytes(mutils::DeserializationManager*, const uint8_t* const buffer);
+    static mutils::context_ptr<KVStoreState> from_bytes_noalloc(mutils::DeserializationManager* dsm, const uint8_t* const buffer);
+    static mutils::context_ptr<const KVStoreState> from_bytes_noalloc_const(mutils::DeserializationManager* dsm, const uint8_t* const buffer);
+};
+
+/**
+ * A replicated, persistent key-value store, with binary keys and values. Each
+ * put or remove is an ordered call that creates a version holding just that
+ * update, so the log can be read back at any version or time. Ordered calls on
+ * different keys are applied in parallel (see ParallelApply, and
+ * DERECHO/parallel_apply_threads).
+ *
+ * Reads come in three kinds:
+ * - get, as an ordered call, is linearizable with the updates;
+ * - get, as a P2P call, reads the latest state of the replica it is sent to;
+ * - get_by_version and get_by_time read the state at a past version or time
+ *   from the log, using a per-key index of the log (see
+ *   Persistent::enableKeyIndex), so they cost one index lookup and one log
+ *   read regardless of how many versions the store has.
+ *
+ * Keys are passed to the RPC functions as std::string, so they must not
+ * contain null bytes; values are arbitrary.
+ */
+class KVStore : public mutils::ByteRepresentable, public PersistsFields, public ParallelApply, public RebuildsFromLog {
+    persistent::Persistent<KVStoreState> state;
+
+    /**
+     * @return An empty value if the key was absent at a version of the log
+     * before which no remaining entry updated it
+     * @throws persistent::persistent_invalid_version if a trimmed entry may
+     * have updated it
+     */
+    Bytes value_without_update(const std::string& key, persistent::version_t version) const;
+
+public:
+    /** Creates an empty store, or loads the one in the local log. */
+    KVStore(persistent::PersistentRegistry* registry);
+    /** Deserialization constructor */
+    KVStore(persistent::Persistent<KVStoreState>& state);
+
+    /** Sets the value of a key. */
+    void put(const std::string& key, const Bytes& value);
+    /** @return true if the key was present and has been removed */
+    bool remove(const std::string& key);
+    /** @return The value of the key, or an empty value if it is absent */
+    Bytes get(const std::string& key) const;
+    /**
+     * @return The value the key had at a version, or an empty value if it was
+     * absent
+     * @throws persistent::persistent_invalid_version if the version, or the
+     * key's last update at or before it, has been trimmed
+     */
+    Bytes get_by_version(const std::string& key, persistent::version_t version) const;
+    /**
+     * @return The value the key had at a time, in microseconds, or an empty
+     * value if it was absent
+     * @throws persistent::persistent_version_not_stable if the time is not
+     * globally persisted yet
+     * @throws persistent::persistent_invalid_hlc if the time comes before the
+     * earliest entry left after trimming
+     * @throws persistent::persistent_invalid_version if the key's last update
+     * at or before the time has been trimmed
+     */
+    Bytes get_by_time(const std::string& key, uint64_t time_us) const;
+    /** @return The versions that updated the key, oldest first */
+    std::vector<persistent::version_t> get_key_versions(const std::string& key) const;
+    /** @return The number of keys */
+    uint64_t get_size() const;
+
+    /** Updates and ordered reads conflict only with calls on the same key. */
+    virtual std::optional<uint64_t> conflict_key(rpc::FunctionTag tag, const uint8_t* args, std::size_t args_size) const override;
+
+    /**
+     * The state can only be rebuilt from the local log if it has not been
+     * trimmed; otherwise a joining node must receive all the entries.
+     */
+    virtual bool local_log_is_complete() const override;
+
+    REGISTER_RPC_FUNCTIONS(KVStore,
+                           ORDERED_TARGETS(put, remove, get),
+                           P2P_TARGETS(get, get_by_version, get_by_time, get_key_versions, get_size));
+    DEFAULT_SERIALIZATION_SUPPORT(KVStore, state);
+};
+
+}  // namespace derecho
@@ -9,6 +9,7 @@
 #include "derecho/tcp/tcp.hpp"
 #include "derecho_exception.hpp"
 #include "detail/derecho_internal.hpp"
+#include "detail/hedged_query.hpp"
 #include "detail/remote_invocable.hpp"
 #include "detail/replicated_interface.hpp"
 #include "detail/rpc_manager.hpp"
@@ -17,6 +18,7 @@
 #include <functional>
 #include <iostream>
 #include <memory>
+#include <optional>
 #include <tuple>
 #include <type_traits>
 
@@ -86,6 +88,85 @@ using view_callback_enabled = std::is_base_of<GetsViewChangeCallback, T>;
 template<typename T>
 inline constexpr bool view_callback_enabled_v = view_callback_enabled<T>::value;
 
+/**
+ * An interface that user-defined Replicated Object types can implement to
+ * have their ordered RPC calls applied in parallel. Each call is given a
+ * conflict key by conflict_key(); the calls delivered in one pass of message
+ * delivery are spread over a pool of DERECHO/parallel_apply_threads threads
+ * so that calls with the same key run one at a time, in delivery order, while
+ * calls with different keys run concurrently. A call without a key conflicts
+ * with every call: it runs alone, after all the calls delivered before it.
+ * The replies to the calls are sent in delivery order at the end of the pass.
+ *
+ * Since calls of a pass overlap, the versions they create are only made once
+ * all of them have been applied, in version order. To produce the same log
+ * as applying the calls one at a time, an implementing type must:
+ * - allow concurrent calls with different keys to update it, and
+ * - keep its Persistent fields' deltas per version, recording each update
+ *   under applying_version(), so that finalizeCurrentDelta() can return just
+ *   the delta of applying_version() (which is set while versions are made).
+ * Handlers must not rely on the state left by calls with other keys.
+ */
+class ParallelApply {
+public:
+    /**
+     * @param tag The internal tag of the called function, which is
+     * rpc::to_internal_tag<false>(RPC_NAME(function))
+     * @param args The serialized arguments of the call
+     * @param args_size The size of the serialized arguments
+     * @return The key of the state the call reads or updates, or std::nullopt
+     * if it may touch any of it
+     */
+    virtual std::optional<uint64_t> conflict_key(rpc::FunctionTag tag, const uint8_t* args, std::size_t args_size) const = 0;
+
+    /**
+     * @return The version of the call being applied, or of the version being
+     * made, by the current thread; INVALID_VERSION outside of those
+     */
+    static persistent::version_t applying_version() {
+        return rpc::parallel_apply_version().first;
+    }
+};
+
+/**
+ * A template whose member field "value" will be true if type T inherits
+ * from ParallelApply.
+ */
+template <typename T>
+using parallel_apply_enabled = std::is_base_of<ParallelApply, T>;
+
+/** Shortcut for parallel_apply_enabled<T>::value */
+template <typename T>
+inline constexpr bool parallel_apply_enabled_v = parallel_apply_enabled<T>::value;
+
+/**
+ * An interface that user-defined Replicated Object types can implement if
+ * their state transfer relies on the joining node's own log, for example by
+ * sending only a marker instead of the object when the joining node already
+ * has a log and rebuilding the object from that log. A joining node whose log
+ * cannot be used this way asks for the whole object instead.
+ */
+class RebuildsFromLog {
+public:
+    /**
+     * @return true if this object's state can be rebuilt from its local
+     * logs, which are complete from their first version; false if some of
+     * their entries have been trimmed
+     */
+    virtual bool local_log_is_complete() const = 0;
+};
+
+/**
+ * A template whose member field "value" will be true if type T inherits
+ * from RebuildsFromLog.
+ */
+template <typename T>
+using rebuilds_from_log = std::is_base_of<RebuildsFromLog, T>;
+
+/** Shortcut for rebuilds_from_log<T>::value */
+template <typename T>
+inline constexpr bool rebuilds_from_log_v = rebuilds_from_log<T>::value;
+
 /**
  * An empty class to be used as the "replicated type" for a subgroup that
  * doesn't implement a Replicated Object. Subgroups of type RawObject will
@@ -157,6 +238,9 @@ private:
     /** The timestamp associated with the current version number */
     uint64_t current_timestamp_us = 0;
 
+    /** Registers this subgroup with the RPCManager for parallel apply, if T implements ParallelApply. */
+    void register_parallel_apply();
+
 public:
     /**
      * Constructs a Replicated<T> that enables sending and receiving RPC
@@ -273,6 +357,33 @@ public:
     template <rpc::FunctionTag tag, typename... Args>
     auto ordered_send(Args&&... args);
 
+    /**
+     * Sends a multicast like ordered_send, but asks the members of the
+     * subgroup to reply according to a ReplyPolicy: for example, only one
+     * designated member sends its return value and the others send a small
+     * acknowledgement, or only the first k members send values. Every
+     * member still executes the call. Use QueryResults::await_reply_policy()
+     * to wait until the policy is satisfied.
+     * @param reply_policy The ReplyPolicy to apply to this call's replies
+     * @param args The arguments to the RPC function
+     * @return An instance of rpc::QueryResults<Ret>, where Ret is the return type
+     * of the RPC function being invoked.
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto ordered_send_with_reply_policy(const rpc::ReplyPolicy& reply_policy, Args&&... args);
+
+    /**
+     * A non-blocking version of ordered_send. Instead of waiting for the
+     * subgroup's rate limits, admission controller, or send window, it returns
+     * an empty optional if the multicast cannot be sent right away; the caller
+     * can back off and retry, or shed the request.
+     * @param args The arguments to the RPC function
+     * @return An std::optional<rpc::QueryResults<Ret>> containing the results
+     * of the call if it was sent, or std::nullopt if it would have blocked.
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto try_ordered_send(Args&&... args);
+
     /**
      * Submits a call to send a "raw" (byte array) message in a multicast to
      * this object's subgroup; the message will be generated by invoking msg_generator
@@ -280,6 +391,26 @@ public:
      */
     void send(unsigned long long int payload_size, const std::function<void(uint8_t* buf)>& msg_generator);
 
+    /**
+     * Submits a "raw" message like send(), but never blocks waiting for a view
+     * change to finish. If the subgroup is wedged, the message is queued and
+     * sent in the next view; completion_callback is called with true once the
+     * message has been sent, or false if it had to be dropped.
+     * @return false if the message could not be queued because this subgroup's
+     * send queue is full, true otherwise
+     */
+    bool send_async(unsigned long long int payload_size, const std::function<void(uint8_t* buf)>& msg_generator,
+                    const send_completion_callback_t& completion_callback);
+
+    /**
+     * Submits a "raw" message like send(), but only if it can be sent without
+     * waiting for the subgroup's rate limits, admission controller, send
+     * window, or a view change; otherwise msg_generator is not called.
+     * @return send_admission::ADMITTED if the message was sent, or the reason
+     * it was not
+     */
+    send_admission try_send(unsigned long long int payload_size, const std::function<void(uint8_t* buf)>& msg_generator);
+
     /**
      * @return The serialized size of the object, of type T, that holds the
      * state of this Replicated<T>.
@@ -339,6 +470,16 @@ public:
      */
     virtual persistent::version_t get_minimum_latest_persisted_version();
 
+    /**
+     * Returns the version a joining node should ask the shard leader to send
+     * log entries after during state transfer: normally the same as
+     * get_minimum_latest_persisted_version(), but INVALID_VERSION (asking for
+     * the whole object) if T implements RebuildsFromLog and its local log is
+     * not complete.
+     * @return A version number
+     */
+    virtual persistent::version_t get_state_transfer_log_tail();
+
     /**
      * Returns the current global persistence frontier, aka, stable frontier that will survive whole system restart.
      * Please note this applies to persistent data ONLY. The data not in Persistent<> are not saved.
@@ -352,6 +493,20 @@ public:
      */
     virtual bool wait_for_global_persistence_frontier(persistent::version_t version);
 
+    /**
+     * Returns the current quorum persistence frontier: the latest version that
+     * the number of replicas set by the subgroup profile's persistence_quorum
+     * have persisted. It is never behind the global persistence frontier.
+     */
+    virtual persistent::version_t get_quorum_persistence_frontier();
+
+    /**
+     * Wait until the current quorum persistence frontier advanced beyond a version.
+     * @param version   the version
+     * @return false if the given version is beyond the latest atomic broadcast.
+     */
+    virtual bool wait_for_quorum_persistence_frontier(persistent::version_t version);
+
     /**
      * Returns the current global verified frontier, aka, stable frontier that will survive whole system restart.
      * Please note this applies to persistent data ONLY. The data not in Persistent<> are not saved.
@@ -423,6 +578,13 @@ public:
      */
     virtual void post_next_version(persistent::version_t version, uint64_t ts_us);
 
+    /**
+     * @return The log of this object's delta-supporting persistent field, if it
+     * has exactly one and the log can receive message payloads in place, or
+     * nullptr otherwise.
+     */
+    virtual persistent::PersistLog* get_placement_log();
+
     /**
      * Get the current version, set by the most recent ordered_send update.
      * During the execution of an ordered_send RPC method, this represents the
@@ -546,6 +708,18 @@ private:
     rpc::RPCManager& group_rpc_manager;
     /** The actual implementation of PeerCaller, which has lots of ugly template parameters */
     std::unique_ptr<rpc::RemoteInvokerFor<T>> wrapped_this;
+    /** Recent P2P reply latencies, which determine when p2p_send_hedged sends its duplicate request */
+    std::shared_ptr<rpc::ReplyLatencyTracker> hedge_latency_tracker;
+    /** Keeps the process's hedge timer running while this object can send hedged queries */
+    std::shared_ptr<rpc::HedgeTimer> hedge_timer;
+
+    /**
+     * Implements p2p_send and p2p_send_with_deadline; a deadline of 0 means
+     * none. If wait_for_buffer is false and the P2P window to dest_node is
+     * full, throws send_window_full_exception instead of waiting for a buffer.
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_until(node_id_t dest_node, uint64_t deadline, bool wait_for_buffer, Args&&... args);
 
 public:
     PeerCaller(uint32_t type_id, node_id_t nid, subgroup_id_t subgroup_id, rpc::RPCManager& group_rpc_manager);
@@ -565,6 +739,51 @@ public:
     template <rpc::FunctionTag tag, typename... Args>
     auto p2p_send(node_id_t dest_node, Args&&... args);
 
+    /**
+     * Sends a hedged peer-to-peer query: the request is sent to dest_node, and
+     * if its reply has not arrived within a percentile of recent reply
+     * latencies (see p2p_hedge_percentile in the configuration), the same
+     * request is sent to hedge_node. The first reply is returned and the other
+     * is discarded. Only use this for read-only functions, since both nodes
+     * may execute the call. Both nodes should be replicas of the same shard.
+     * The duplicate request is sent from a timer thread through this object,
+     * so the returned HedgedQueryResults must be destroyed before this
+     * PeerCaller (and the Group that owns it).
+     * @param dest_node The ID of the node to send the request to first
+     * @param hedge_node The ID of the node to send the duplicate request to
+     * @param args The arguments to the RPC function being invoked
+     * @return An instance of rpc::HedgedQueryResults<Ret>, where Ret is the
+     * return type of the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_hedged(node_id_t dest_node, node_id_t hedge_node, Args&&... args);
+
+    /**
+     * Sends a peer-to-peer message like p2p_send, with a deadline. If the
+     * destination node has not started executing the request by the time the
+     * deadline passes, it drops the request and replies with a
+     * request_expired_exception instead. The deadline is checked against the
+     * destination node's wall clock, so it assumes loosely synchronized clocks.
+     * @param dest_node The ID of the node that the P2P message should be sent to
+     * @param timeout How long from now the request remains worth executing
+     * @param args The arguments to the RPC function being invoked
+     * @return An instance of rpc::QueryResults<Ret>, where Ret is the return type
+     * of the RPC function being invoked
+     */
+    template <rpc::FunctionTag tag, typename... Args>
+    auto p2p_send_with_deadline(node_id_t dest_node, std::chrono::nanoseconds timeout, Args&&... args);
+
+    /**
+     * Cancels a P2P request sent earlier with p2p_send. If the destination
+     * node has not started executing it yet, the request is dropped and its
+     * QueryResults gets a request_expired_exception; otherwise the normal
+     * reply still arrives.
+     * @param dest_node The node the request was sent to
+     * @param results The QueryResults returned when the request was sent
+     */
+    template <typename Ret>
+    void cancel(node_id_t dest_node, const rpc::QueryResults<Ret>& results);
+
     bool is_valid() const { return true; }
 };
 
@@ -0,0 +1,180 @@
+#pragma once
+
+/**
+ * @file shard_router.hpp
+ * @brief Routing of keys to the shards of a subgroup, and to the members of
+ * those shards, by consistent hashing.
+ */
+
+#include "derecho_exception.hpp"
+#include "view.hpp"
+
+#include <cstdint>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * Maps keys to the shards of a sharded subgroup, and to a member of each shard,
+ * for clients (such as an ExternalGroupClient) and group members that send
+ * requests to the shard owning a key.
+ *
+ * Shards are placed on a consistent-hash ring, each at virtual_nodes points,
+ * and a key belongs to the shard of the first point after the key's hash. When
+ * the number of shards changes, only the keys of the points added or removed
+ * move, roughly 1/num_shards of them per shard. Within a shard, a key is routed
+ * to the member with the highest rendezvous (highest random weight) score for
+ * it, so a membership change only moves the keys of the members that joined or
+ * left, and the keys of a shard are spread over all of its members.
+ *
+ * The mapping only depends on the hash of the keys and the shard numbers, so
+ * all routers with the same number of virtual nodes route a key to the same
+ * shard. update() must be called after each view change (for example from a
+ * view upcall, or after ExternalGroupClient::update_view()); it only rebuilds
+ * the parts of the routing state that the view change affected.
+ * Thread-safe: routing can proceed concurrently with other routing, and waits
+ * for updates.
+ */
+class ShardRouter {
+public:
+    /** The destination of a key */
+    struct Route {
+        uint32_t shard_num;
+        node_id_t node_id;
+    };
+
+    /**
+     * A batch of keys grouped by destination node: the keys to send to
+     * nodes[i] are those at the indices key_indices[offsets[i]] to
+     * key_indices[offsets[i + 1] - 1] of the batch, in their order in the
+     * batch. Can be reused across calls to route_batch() to save allocations.
+     */
+    struct BatchRoutes {
+        std::vector<node_id_t> nodes;
+        std::vector<std::size_t> offsets;
+        std::vector<std::size_t> key_indices;
+
+    private:
+        friend class ShardRouter;
+        /** The node slot of each key, while the batch is being routed */
+        std::vector<uint32_t> key_slots;
+    };
+
+    static constexpr uint32_t DEFAULT_VIRTUAL_NODES = 128;
+
+private:
+    struct Shard {
+        std::vector<node_id_t> members;
+        /** The rendezvous hashing seed of each member, with the same indices as members */
+        std::vector<uint64_t> member_seeds;
+        /** The index of each member in node_slots, with the same indices as members */
+        std::vector<uint32_t> member_slots;
+    };
+
+    const uint32_t virtual_nodes;
+    mutable std::shared_mutex router_mutex;
+    /** The points of the ring, sorted, and the shard of each point */
+    std::vector<uint64_t> ring_points;
+    std::vector<uint32_t> ring_shards;
+    /**
+     * The ring is split into 2^bucket_bits equal buckets by the top bits of
+     * the hash, and bucket_starts[b] is the index of the first point in
+     * bucket b (with a last entry equal to the number of points), so that a
+     * lookup only searches the few points of one bucket.
+     */
+    uint32_t bucket_bits = 0;
+    std::vector<uint32_t> bucket_starts;
+    std::vector<Shard> shards;
+    /** The distinct members of all the shards, so that route_batch() can count keys by node in an array */
+    std::vector<node_id_t> node_slots;
+
+    // These methods assume router_mutex is held.
+    /** Adds the points of shards [first_shard, end_shard) to the ring. */
+    void add_shards(uint32_t first_shard, uint32_t end_shard);
+    /** Removes the points of the shards numbered first_shard and higher from the ring. */
+    void remove_shards(uint32_t first_shard);
+    void rebuild_buckets();
+    void rebuild_node_slots();
+    uint32_t shard_of_hash(uint64_t hash) const;
+    /** @return The rank, within the shard, of the member a hash is routed to */
+    std::size_t member_of_hash(uint32_t shard_num, uint64_t hash) const;
+
+public:
+    /**
+     * @param virtual_nodes The number of points of each shard on the ring.
+     * More points spread the keys more evenly over the shards, at the cost of
+     * a larger ring.
+     */
+    explicit ShardRouter(uint32_t virtual_nodes = DEFAULT_VIRTUAL_NODES);
+
+    /**
+     * Hashes a key the way the router does. Keys are hashed 8 bytes at a time,
+     * with a result that does not depend on the host's byte order.
+     */
+    static uint64_t hash_key(std::string_view key);
+    /**
+     * Hashes a batch of keys, with the same results as hash_key(). Groups of
+     * keys are hashed in lockstep, so that the hashes of independent keys
+     * overlap in the CPU (or are vectorized by the compiler), instead of
+     * waiting on each other's multiplications.
+     * @param keys The keys
+     * @param num_keys The number of keys
+     * @param hashes An array of num_keys hashes to fill in
+     */
+    static void hash_keys(const std::string_view* keys, std::size_t num_keys, uint64_t* hashes);
+
+    /**
+     * Updates the router to the members of each shard of the subgroup.
+     * @param shard_members The members of each shard, indexed by shard number,
+     * as returned by get_subgroup_non_standby_members(). Keys are routed to
+     * every member given, so warm standbys should be left out.
+     * @return true if the routes changed
+     */
+    bool update(const std::vector<std::vector<node_id_t>>& shard_members);
+    /**
+     * Updates the router to the shards of a subgroup in a View, leaving out
+     * the warm standbys of each shard.
+     * @throws derecho_exception if the View has no subgroup with that ID
+     */
+    bool update(const View& view, subgroup_id_t subgroup_id);
+    /**
+     * Updates the router to the shards of a subgroup of a Group or
+     * ExternalGroupClient, leaving out the warm standbys of each shard.
+     * @tparam SubgroupType The type of the subgroup
+     * @param group The Group or ExternalGroupClient
+     * @param subgroup_index The index of the subgroup among those of its type
+     */
+    template <typename SubgroupType, typename GroupType>
+    bool update(GroupType& group, uint32_t subgroup_index = 0) {
+        return update(group.template get_subgroup_non_standby_members<SubgroupType>(subgroup_index));
+    }
+
+    /** @return The number of shards the router routes to */
+    uint32_t get_num_shards() const;
+
+    /**
+     * @return The shard a key belongs to
+     * @throws derecho_exception if the router has no shards
+     */
+    uint32_t get_shard(std::string_view key) const;
+    /**
+     * @return The shard a key belongs to, and the member of that shard to send it to
+     * @throws derecho_exception if the router has no shards, or the key's shard has no members
+     */
+    Route route(std::string_view key) const;
+    /**
+     * Routes a batch of keys, and groups them by destination node, so that a
+     * request can be sent to each node for all of its keys.
+     * @param keys The keys
+     * @param num_keys The number of keys
+     * @param routes Set to the keys to send to each node
+     * @throws derecho_exception if the router has no shards, or a key's shard has no members
+     */
+    void route_batch(const std::string_view* keys, std::size_t num_keys, BatchRoutes& routes) const;
+    BatchRoutes route_batch(const std::vector<std::string>& keys) const;
+};
+
+}  // namespace derecho
@@ -57,9 +57,12 @@ constexpr char min_nodes_by_shard_field[] = "min_nodes_by_shard";
 constexpr char max_nodes_by_shard_field[] = "max_nodes_by_shard";
 constexpr char reserved_node_ids_by_shard_field[] = "reserved_node_ids_by_shard";
 constexpr char reserved_node_is_sender_tag = '*';
+constexpr char standby_node_ids_by_shard_field[] = "standby_node_ids_by_shard";
+constexpr char warm_standbys_field[] = "warm_standbys";
 constexpr char delivery_modes_by_shard_field[] = "delivery_modes_by_shard";
 constexpr char delivery_mode_ordered[] = "Ordered";
 constexpr char delivery_mode_raw[] = "Raw";
+constexpr char delivery_mode_sequenced[] = "Sequenced";
 constexpr char profiles_by_shard_field[] = "profiles_by_shard";
 
 /**
@@ -134,6 +137,35 @@ struct ShardAllocationPolicy {
      * reserved pool, this shard will have no senders.
      */
     std::vector<std::set<node_id_t>> reserved_sender_ids_by_shard;
+    /**
+     * For each shard, this stores a list of node IDs that are standbys for it;
+     * may be empty if no shard has standbys. When members of its shard fail,
+     * a standby node that is in the View is promoted into the shard before
+     * any other unassigned node, so the failed members are replaced without
+     * waiting for a new node to join. It is never assigned to another shard.
+     * A standby node can be a standby for only one shard, and cannot also be
+     * reserved by any shard.
+     */
+    std::vector<std::set<node_id_t>> standby_node_ids_by_shard;
+    /**
+     * If false, a standby node is kept out of its shard until it is promoted,
+     * so it does not slow down the shard's multicasts, but it gets the shard's
+     * state by state transfer when it is promoted. If true, each standby node
+     * in the View is a member of its shard that does not send and does not
+     * count toward the shard's size, so it receives and persists every update;
+     * like any other standby, it is promoted (counted, and made a sender like
+     * any added member) when a member of its shard fails or leaves, and that
+     * promotion needs no state transfer.
+     *
+     * A warm standby is left out of the shard's stability and persistence
+     * frontiers and does not reply to RPC calls, so messages are delivered and
+     * versions reported persisted without waiting for it; only the multicast
+     * window waits for it, since a message's buffer is reused once every
+     * receiver has the message. If a View change finds that a standby did not
+     * receive every message the shard delivered, it gets the shard's state
+     * again by state transfer, as if it had just joined.
+     */
+    bool warm_standbys = false;
 };
 
 /**
@@ -246,8 +278,8 @@ ShardAllocationPolicy raw_fixed_even_shards(int num_shards, int nodes_per_shard,
  * shard; the ith shard must have at least min_nodes_by_shard[i] members.
  * @param max_nodes_by_shard A vector specifying the maximum number of nodes for each
  * shard; the ith shard can have up to max_nodes_by_shard[i] members.
- * @param delivery_modes_by_shard A vector specifying the delivery mode (Raw or
- * Ordered) for each shard, in the same order as the other vectors.
+ * @param delivery_modes_by_shard A vector specifying the delivery mode (Raw,
+ * Ordered, or Sequenced) for each shard, in the same order as the other vectors.
  * @param profiles_by_shard A vector specifying the profile (defined in configuration
  * file) for each shard, in the same order as the other vectors.
  * @return A ShardAllocationPolicy that specifies these shard sizes and modes.
@@ -263,8 +295,8 @@ ShardAllocationPolicy custom_shards_policy(const std::vector<int>& min_nodes_by_
  * In this function, the minimum and maximum number of members in each shard is
  * specified by the min_nodes and max_nodes constants in each shard's configuration
  * profile.
- * @param delivery_modes_by_shard A vector specifying the delivery mode (Raw or
- * Ordered) for each shard
+ * @param delivery_modes_by_shard A vector specifying the delivery mode (Raw,
+ * Ordered, or Sequenced) for each shard
  * @param profiles_by_shard A vector specifying the configuration profile to use
  * for each shard
  * @return A ShardAllocationPolicy that specifies the shard sizes and modes found
@@ -314,6 +346,21 @@ protected:
      */
     std::set<node_id_t> all_reserved_node_ids;
 
+    /**
+     * @return The union set of standby_node_ids from all shards of all
+     * standard subgroup policies.
+     */
+    std::set<node_id_t> collect_standby_node_ids() const;
+
+    /**
+     * Checks that the standby node IDs of every shard policy are consistent:
+     * each policy lists standby nodes for all of its shards or none, no node
+     * is a standby node for more than one shard (including the same shard of
+     * identical subgroups), and no standby node is also a reserved node.
+     * Throws a derecho_exception if they are not.
+     */
+    void validate_standby_node_ids() const;
+
     /**
      * Determines how many members each shard can have in the current view, based
      * on each shard's policy (minimum and maximum number of nodes) and the size
@@ -421,7 +468,9 @@ public:
      */
     DefaultSubgroupAllocator(const std::map<std::type_index, SubgroupPolicyVariant>&
                                      policies_by_subgroup_type)
-            : policies(policies_by_subgroup_type) {}
+            : policies(policies_by_subgroup_type) {
+        validate_standby_node_ids();
+    }
     /**
      * Constructs a subgroup allocator with policies that include reserved node
      * IDs. In this case the allocator must be initialized with the set of all
@@ -436,7 +485,9 @@ public:
                                      policies_by_subgroup_type,
                              const std::set<node_id_t>& all_reserved_node_ids)
             : policies(policies_by_subgroup_type),
-              all_reserved_node_ids(all_reserved_node_ids) {}
+              all_reserved_node_ids(all_reserved_node_ids) {
+        validate_standby_node_ids();
+    }
 
     /**
      * Constructs a subgroup allocator from a vector of subgroup types and a
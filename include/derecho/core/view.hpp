@@ -87,6 +87,11 @@ public:
     /** vector selecting the senders, 0 for non-sender, non-0 for sender*/
     /** integers instead of booleans due to the serialization issue :-/ */
     std::vector<int> is_sender;
+    /** vector marking the warm standbys (see ShardAllocationPolicy::warm_standbys),
+     * 0 for an ordinary member, non-0 for a standby; empty if the shard has none.
+     * A standby receives every message, but does not count toward the shard's
+     * stability and persistence frontiers, and does not reply to RPC calls. */
+    std::vector<int> is_standby;
     /** IP addresses and ports of members in this subgroup/shard, with the same indices as members. */
     std::vector<IpAndPorts> member_ips_and_ports;
     /** List of IDs of nodes that joined since the previous view, if any. */
@@ -106,14 +111,19 @@ public:
     int sender_rank_of(uint32_t rank) const;
     /** returns the number of senders in the subview */
     uint32_t num_senders() const;
+    /** Returns true if the member with the given rank is a warm standby */
+    bool is_standby_rank(uint32_t rank) const;
+    /** Returns the members that are not warm standbys, in rank order */
+    std::vector<node_id_t> non_standby_members() const;
     /** Creates an empty new SubView with num_members members.
      * The vectors will have room for num_members elements. */
     SubView(int32_t num_members);
 
-    DEFAULT_SERIALIZATION_SUPPORT(SubView, mode, members, is_sender,
+    DEFAULT_SERIALIZATION_SUPPORT(SubView, mode, members, is_sender, is_standby,
                                   member_ips_and_ports, joined, departed, profile);
     SubView(Mode mode, const std::vector<node_id_t>& members,
             std::vector<int> is_sender,
+            std::vector<int> is_standby,
             const std::vector<IpAndPorts>& member_ips_and_ports,
             const std::vector<node_id_t>& joined,
             const std::vector<node_id_t>& departed,
@@ -121,6 +131,7 @@ public:
             : mode(mode),
               members(members),
               is_sender(is_sender),
+              is_standby(is_standby),
               member_ips_and_ports(member_ips_and_ports),
               joined(joined),
               departed(departed),
@@ -130,7 +141,8 @@ public:
     SubView(Mode mode, const std::vector<node_id_t>& members,
             std::vector<int> is_sender,
             const std::vector<IpAndPorts>& member_ips_and_ports,
-            std::string profile);
+            std::string profile,
+            std::vector<int> is_standby = {});
 
     /**
      * Initialization helper method that initializes the joined and departed lists
@@ -203,12 +215,14 @@ public:
      * @param   mode            ordered or raw
      * @param   is_sender       i am sender or node.
      * @param   profile         profile in configuration
+     * @param   is_standby      which members are warm standbys, or empty if none
      * @return A SubView containing those members, the corresponding member IPs,
      * and the subsets of joined[] and departed[] that intersect with those members
      * @throws subgroup_provisioning_exception if any of the requested members
      * are not actually in this View's members vector.
      */
-    SubView make_subview(const std::vector<node_id_t>& with_members, const Mode mode = Mode::ORDERED, const std::vector<int>& is_sender = {}, std::string profile = "DEFAULT") const;
+    SubView make_subview(const std::vector<node_id_t>& with_members, const Mode mode = Mode::ORDERED, const std::vector<int>& is_sender = {}, std::string profile = "DEFAULT",
+                         const std::vector<int>& is_standby = {}) const;
 
     /** Looks up the SST rank of a node ID. Returns -1 if that node ID is not a member of this view. */
     int rank_of(const node_id_t& who) const;
@@ -8,8 +8,12 @@
 #include "PersistentInterface.hpp"
 #include "derecho/mutils-serialization/SerializationSupport.hpp"
 #include "derecho/utils/logger.hpp"
+#include "detail/DaxPersistLog.hpp"
+#include "detail/DeltaKeyIndex.hpp"
 #include "detail/FilePersistLog.hpp"
+#include "detail/LogEntryRange.hpp"
 #include "detail/PersistLog.hpp"
+#include "detail/VersionCache.hpp"
 #include "detail/logger.hpp"
 
 #include <functional>
@@ -193,6 +197,14 @@ public:
      */
     void truncate(version_t last_version);
 
+    /**
+     * Returns the log that multicast updates to this object can be received
+     * directly into: that of the only registered Persistent field whose
+     * getPlacementLog() is not null. If there is no such field, or more than
+     * one, there is no unambiguous log to use and this returns nullptr.
+     */
+    PersistLog* getPlacementLog();
+
     /**
      * Add a Persistent<T> to the registry, identified by its name. Since
      * PersistentRegistry does not own the pointer to the Persistent<T>, the
@@ -598,6 +610,7 @@ public:
      * it returns.
      *
      * TODO: see getByIndex(int64_t,const Func&,mutils::DeserializationManager*) for more on the performance.
+     * If the version cache is enabled, the object is read through it, as in getShared().
      *
      * @param ver   if 'ver', the specified version, matches a log entry, the state corresponding to that entry will be
      *              send to 'fun'; if 'ver' does not match a log entry, the latest state before 'ver' will be applied to
@@ -734,6 +747,85 @@ public:
              bool exact,
              mutils::DeserializationManager* dm = nullptr) const;
 
+    /**
+     * enableKeyIndex(const DeltaKeyExtractor&)
+     *
+     * Maintain a per-key version index over the deltas in the log, so that getDeltaByKey() can find the delta that
+     * last updated a key before a given version without reconstructing the object. The extractor lists the keys each
+     * delta updates. The index is persisted with the log and reloaded by calling this again after a restart.
+     *
+     * This function is enabled only if ObjectType implements IDeltaSupport<> interface.
+     *
+     * @param extractor the function listing the keys updated by a delta
+     */
+    template <typename DummyObjectType = ObjectType>
+    std::enable_if_t<std::is_base_of<IDeltaSupport<DummyObjectType>, DummyObjectType>::value>
+    enableKeyIndex(const DeltaKeyExtractor& extractor);
+
+    /**
+     * getDeltaByKey(const std::string&,const version_t,const Func&,mutils::DeserializationManager*)
+     *
+     * Get the latest delta at or before version 'ver' that updated 'key', using the key index. The user lambda will
+     * be fed with the given object of type (const DeltaType&). Please note that due to zero copy design, this object
+     * may not be accessible anymore after it returns.
+     *
+     * This function is enabled only if ObjectType implements IDeltaSupport<> interface.
+     *
+     * @tparam DeltaType    User-specified DeltaType. DeltaType must be a pod type or implement mutils::ByteRepresentable.
+     * @tparam Func         User-specified function type, which is usually deduced.
+     *
+     * @param key   the key
+     * @param ver   version
+     * @param fun   the user function to process a const DeltaType& object
+     * @param dm    the deserialization manager
+     *
+     * @return Returns whatever fun returns.
+     *
+     * @throws persistent_invalid_version, when no delta in the log at or before 'ver' updated 'key'.
+     * @throws persistent_exception, if enableKeyIndex() has not been called.
+     */
+    template <typename DeltaType, typename Func>
+    std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
+    getDeltaByKey(const std::string& key,
+                  const version_t ver,
+                  const Func& fun,
+                  mutils::DeserializationManager* dm = nullptr) const;
+
+    /**
+     * getDeltaByKey(const std::string&,const HLC&,const Func&,mutils::DeserializationManager*)
+     *
+     * Get the latest delta at or before the HLC timestamp 'hlc' that updated 'key', using the key index. See
+     * getDeltaByKey(const std::string&,const version_t,const Func&,mutils::DeserializationManager*).
+     *
+     * @throws persistent_version_not_stable if hlc is beyond the global stability frontier.
+     * @throws persistent_invalid_hlc, when no delta in the log at or before 'hlc' updated 'key'.
+     */
+    template <typename DeltaType, typename Func>
+    std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
+    getDeltaByKey(const std::string& key,
+                  const HLC& hlc,
+                  const Func& fun,
+                  mutils::DeserializationManager* dm = nullptr) const;
+
+    /**
+     * getKeyVersion(const std::string&,const version_t)
+     *
+     * @return the version of the latest delta at or before version 'ver' that updated 'key', or INVALID_VERSION if
+     *         there is none in the log.
+     *
+     * @throws persistent_exception, if enableKeyIndex() has not been called.
+     */
+    version_t getKeyVersion(const std::string& key, const version_t ver) const;
+
+    /**
+     * getKeyVersions(const std::string&)
+     *
+     * @return the versions of the deltas in the log that updated 'key', oldest first.
+     *
+     * @throws persistent_exception, if enableKeyIndex() has not been called.
+     */
+    std::vector<version_t> getKeyVersions(const std::string& key) const;
+
     /**
      * getDeltaSignature(const version_t,const Func&,unsigned char*,version_t&,mutils::DeserializationManager*)
      *
@@ -795,6 +887,7 @@ public:
      * ObjectType&'. Due to the zero-copy design, this object might not be accessible after get() returns.
      *
      * TODO: see getByIndex(int64_t,const Func&,mutils::DeserializationManager*) for more on the performance.
+     * If the version cache is enabled, the object is read through it, as in getShared().
      *
      * @tparam Func         User-specified function type, which is usually deduced.
      *
@@ -830,6 +923,111 @@ public:
             const HLC& hlc,
             mutils::DeserializationManager* dm = nullptr) const;
 
+    /**
+     * getShared(const version_t,mutils::DeserializationManager*)
+     *
+     * Get a version of ObjectType as an immutable object shared with other readers. If the version cache is enabled
+     * (PERS/version_cache_bytes), the object is looked up in, or materialized into, this Persistent<T>'s cache of
+     * recently read versions, so repeated reads of the same version do not deserialize its log entry (or replay its
+     * deltas) again. Otherwise, this is the same as get(const version_t,mutils::DeserializationManager*). Note that a
+     * cached object is shared by readers using any deserialization manager.
+     *
+     * @param ver   the version, resolved to a log entry as in get(const version_t,mutils::DeserializationManager*)
+     * @param dm    the deserialization manager
+     *
+     * @return a shared pointer to the ObjectType object.
+     *
+     * @throws persistent_invalid_version, when the state at 'ver' has no state.
+     */
+    std::shared_ptr<const ObjectType> getShared(
+            const version_t ver,
+            mutils::DeserializationManager* dm = nullptr) const;
+
+    /**
+     * getShared(const HLC&,mutils::DeserializationManager*)
+     *
+     * Get a version of ObjectType, specified by HLC clock, as an immutable object shared with other readers. See
+     * getShared(const version_t,mutils::DeserializationManager*).
+     *
+     * @param hlc   the HLC timestamp
+     * @param dm    the deserialization manager
+     *
+     * @return a shared pointer to the ObjectType object.
+     *
+     * @throws persistent_version_not_stable if hlc is beyond the global stability frontier.
+     */
+    std::shared_ptr<const ObjectType> getShared(
+            const HLC& hlc,
+            mutils::DeserializationManager* dm = nullptr) const;
+
+    /**
+     * getEntries(const version_t,const version_t,bool)
+     *
+     * Get the range of log entries with versions between 'from' and 'to', inclusive, for a sequential scan. Iterating
+     * over the range yields zero-copy LogEntryView objects, whose data is the serialized ObjectType (or, if ObjectType
+     * implements IDeltaSupport<>, the serialized delta) and can be read with mutils::deserialize_and_run(). The range
+     * can be split into subranges to scan in parallel. See LogEntryRange.
+     *
+     * @param from      the lowest version in the range
+     * @param to        the highest version in the range
+     * @param reverse   true to scan from the newest entry to the oldest one
+     *
+     * @return the range of log entries, which may be empty.
+     */
+    LogEntryRange getEntries(
+            const version_t from,
+            const version_t to,
+            bool reverse = false) const;
+
+    /**
+     * getEntries(const HLC&,const HLC&,bool)
+     *
+     * Get the range of log entries with HLC timestamps between 'from' and 'to', inclusive, for a sequential scan. See
+     * getEntries(const version_t,const version_t,bool).
+     *
+     * @param from      the lowest HLC timestamp in the range
+     * @param to        the highest HLC timestamp in the range
+     * @param reverse   true to scan from the newest entry to the oldest one
+     *
+     * @return the range of log entries, which may be empty.
+     *
+     * @throws persistent_version_not_stable if 'to' is beyond the global stability frontier.
+     */
+    LogEntryRange getEntries(
+            const HLC& from,
+            const HLC& to,
+            bool reverse = false) const;
+
+    /**
+     * forEachVersion(const version_t,const version_t,const Func&,mutils::DeserializationManager*)
+     *
+     * Visit the state of ObjectType at each version in the log between 'from' and 'to', inclusive, from the oldest to
+     * the newest. The user function will be fed with the version and an object of type 'const ObjectType&', which may
+     * not be accessible after the function returns. If ObjectType implements IDeltaSupport<>, the state at the first
+     * version is reconstructed once, and each following state is obtained by applying one delta to it, instead of
+     * replaying the log for every version.
+     *
+     * @tparam Func     User-specified function type, which is usually deduced.
+     *
+     * @param from  the lowest version to visit
+     * @param to    the highest version to visit
+     * @param fun   the user function to process a version_t and a const ObjectType& object
+     * @param dm    the deserialization manager
+     */
+    template <typename Func>
+    void forEachVersion(
+            const version_t from,
+            const version_t to,
+            const Func& fun,
+            mutils::DeserializationManager* dm = nullptr) const;
+
+    /**
+     * getVersionCacheBytes()
+     *
+     * @return the total serialized size of the versions in the version cache, or 0 if it is disabled.
+     */
+    uint64_t getVersionCacheBytes() const;
+
     /**
      * [](const version_t)
      *
@@ -1032,6 +1230,13 @@ public:
      */
     virtual std::size_t getSignatureSize() const;
 
+    /**
+     * @return this object's log if ObjectType implements IDeltaSupport, since
+     * a delta can be appended in place from a region of the log that received
+     * the update; nullptr otherwise.
+     */
+    virtual PersistLog* getPlacementLog();
+
     /**
      * Retrieves the signature associated with the specified version and copies
      * it into the provided buffer, which must be of the correct length. Does
@@ -1082,6 +1287,14 @@ protected:
     PersistentRegistry* m_pRegistry;
     // Pointer to the Persistence-module logger
     std::shared_ptr<spdlog::logger> m_logger;
+    // Recently read historical versions, or nullptr if the version cache is disabled
+    std::unique_ptr<VersionCache<ObjectType>> m_pVersionCache;
+    // Per-key version index over the deltas in the log, or nullptr if not enabled
+    std::unique_ptr<DeltaKeyIndex> m_pKeyIndex;
+    // Get the key index, throwing if it is not enabled.
+    DeltaKeyIndex& getKeyIndex() const;
+    // Get the object at a log index through the version cache.
+    std::shared_ptr<const ObjectType> getSharedByIndex(int64_t idx, mutils::DeserializationManager* dm) const;
     // get the static name maker.
     static _NameMaker<ObjectType, storageType>& getNameMaker(const std::string& prefix = std::string(""));
 
@@ -10,6 +10,8 @@ namespace persistent {
 
 using version_t = int64_t;
 
+class PersistLog;
+
 /**
  * This interface represents the API of a Persistent Object, and is inherited
  * by all versions of the Persistent<T> template. It can be used to call
@@ -118,6 +120,14 @@ public:
      * @param latest_version The latest version to keep
      */
     virtual void truncate(version_t latest_version) = 0;
+    /**
+     * @return the log that updates to this object can be received directly
+     * into (see PersistLog::reservePlacement()), or nullptr if its log entries
+     * are not raw update payloads. Only objects that log deltas qualify.
+     */
+    virtual PersistLog* getPlacementLog() {
+        return nullptr;
+    }
     /**
      * Ensure destructors continue to work with inheritance
      */
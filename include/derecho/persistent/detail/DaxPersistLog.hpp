@@ -0,0 +1,88 @@
+#ifndef DAX_PERSIST_LOG_HPP
+#define DAX_PERSIST_LOG_HPP
+
+#include "FilePersistLog.hpp"
+
+#include <string>
+
+namespace persistent {
+
+// The second meta header slot in a DAX meta file holds a redo copy of the
+// header while the first slot is being overwritten. It is valid only while
+// its last 8 bytes hold this value.
+#define DAX_META_REDO_MAGIC (0x4441585245444f31ull)
+
+/**
+ * A persistent log for byte-addressable persistent memory, such as a file on a
+ * DAX-mounted file system. It keeps FilePersistLog's file layout and in-memory
+ * ring buffers, but the files are mapped with MAP_SYNC so that stores reach
+ * the media directly, and persist() writes back exactly the cache lines of the
+ * new log entries, their data, and the meta header (with CLWB, CLFLUSHOPT, or
+ * CLFLUSH, whichever the CPU supports) instead of calling msync on whole pages.
+ *
+ * The meta header cannot be replaced atomically by a rename, so it is updated
+ * in place through a redo copy in a second slot of the meta file, which is
+ * replayed if a crash interrupts the update.
+ *
+ * If the log directory is on tmpfs, MAP_SYNC is not available and the log is
+ * not durable, but it behaves the same way otherwise; this allows testing
+ * without persistent memory hardware. Any other non-DAX file system is
+ * rejected, since cache line flushes would not make its data durable.
+ */
+class DaxPersistLog : public FilePersistLog {
+protected:
+    // the meta file descriptor, kept open for the mapping of the meta file
+    int m_iMetaFileDesc;
+    // memory mapped meta file: the meta header followed by its redo copy
+    MetaHeader* m_pMeta;
+    // true if the files are mapped with MAP_SYNC, false if this is only an emulation on tmpfs
+    bool m_bMapSync;
+
+    // Persist the meta header through the mapped meta file. We assume
+    // FPL_PERS_LOCK is acquired.
+    virtual void persistMetaHeaderAtomically(MetaHeader*) override;
+
+    /**
+     * Remaps the log and data ring buffers mapped by FilePersistLog::load()
+     * with MAP_SYNC, and maps the meta file.
+     */
+    void mapForDax();
+
+    /**
+     * Writes back the cache lines covering [addr, addr + len) to persistent
+     * memory. The caller must issue a store fence afterwards.
+     */
+    void flushRange(const void* addr, uint64_t len);
+
+    /**
+     * Completes an interrupted meta header update, if the log's meta file has
+     * a valid redo copy, by copying it over the first slot. This has to happen
+     * before FilePersistLog::load() reads (and truncates) the meta file, so it
+     * is called while constructing the base class.
+     * @param name the name of the log
+     * @param dataPath the directory holding the log
+     * @return dataPath
+     */
+    static const std::string& replayMetaRedo(const std::string& name, const std::string& dataPath);
+
+public:
+    //Constructor
+    DaxPersistLog(const std::string& name, const std::string& dataPath, bool enableSignatures);
+    DaxPersistLog(const std::string& name, bool enableSignatures) : DaxPersistLog(name, getPersDaxPath(), enableSignatures){};
+    //Destructor
+    virtual ~DaxPersistLog() noexcept(true);
+
+    virtual version_t persist(version_t ver,
+                              bool preLocked = false) override;
+
+    /**
+     * Get the minimum latest persisted version for a subgroup/shard with prefix
+     * from the logs in the DAX directory
+     * @param prefix the subgroup/shard prefix
+     * @return the minimum latest persisted version
+     */
+    static const uint64_t getMinimumLatestPersistedVersion(const std::string& prefix);
+};
+}  // namespace persistent
+
+#endif  //DAX_PERSIST_LOG_HPP
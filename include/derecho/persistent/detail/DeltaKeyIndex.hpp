@@ -0,0 +1,110 @@
+#ifndef DELTA_KEY_INDEX_HPP
+#define DELTA_KEY_INDEX_HPP
+
+#include "PersistLog.hpp"
+#include "derecho/utils/logger.hpp"
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace persistent {
+
+#define KEY_INDEX_FILE_SUFFIX "kidx"
+
+/**
+ * Type of a function that lists the keys a delta updates, for a Persistent<T>
+ * whose T implements IDeltaSupport and stores key-value pairs.
+ * @param arg1 a pointer to the delta, as it is stored in the log
+ * @param arg2 the delta's size
+ * @return the keys updated by the delta
+ */
+using DeltaKeyExtractor = std::function<std::vector<std::string>(uint8_t const* const, std::size_t)>;
+
+/**
+ * A secondary index over a log of deltas, mapping each key to the versions
+ * and log entry numbers of the deltas that updated it. It answers "which entry
+ * last updated key K at or before version V" with a binary search instead of
+ * reconstructing the whole object at V.
+ *
+ * The index follows the log lazily: it indexes the entries appended since it
+ * was last used before each lookup, and before persist(). Its records are
+ * appended to a file alongside the log, which is read back (up to the first
+ * record that no longer matches the log) when the index is created, so
+ * restarting does not replay the whole log through the key extractor. A
+ * truncation appends a record to the file too. Trimmed entries are skipped
+ * by lookups and compacted away lazily: the postings and the file are only
+ * rewritten once more entries have been trimmed than remain in the index.
+ */
+class DeltaKeyIndex {
+    PersistLog* m_pLog;
+    const DeltaKeyExtractor m_extractor;
+    // the index file, or empty if the log cannot store one
+    const std::string m_sIndexFile;
+    // the index file descriptor, open for appending, or -1
+    int m_iIndexFileDesc;
+    std::mutex m_mutex;
+    // for each key, the (version, entry number) of the entries that updated it, in log order
+    std::unordered_map<std::string, std::vector<std::pair<version_t, int64_t>>> m_postings;
+    // the entry number of the first log entry that has not been indexed yet
+    int64_t m_iNextIndex;
+    // the earliest entry number of the log when the postings were last compacted;
+    // postings of entries trimmed since then are still in m_postings and the file
+    int64_t m_iCompactedIndex;
+    std::shared_ptr<spdlog::logger> m_logger;
+
+    // Index the log entries appended since the last call. We assume m_mutex is acquired.
+    void catchUp();
+    // Read the index file, keeping the prefix of it that matches the log. We assume m_mutex is acquired.
+    void load();
+    // Drop the postings with versions newer than 'ver'. We assume m_mutex is acquired.
+    void dropAfter(version_t ver);
+    // Drop the postings of trimmed entries and rewrite the index file with the
+    // rest. We assume m_mutex is acquired.
+    void compact();
+
+public:
+    /**
+     * @param log the log of deltas to index
+     * @param extractor the function listing the keys of a delta
+     */
+    DeltaKeyIndex(PersistLog* log, const DeltaKeyExtractor& extractor);
+    virtual ~DeltaKeyIndex() noexcept(true);
+
+    /**
+     * @return the version and entry number of the latest log entry at or
+     *         before version 'ver' that updated 'key', or
+     *         (INVALID_VERSION, INVALID_INDEX) if there is none, or if it has
+     *         been trimmed from the log.
+     */
+    std::pair<version_t, int64_t> lookup(const std::string& key, version_t ver);
+
+    /**
+     * @return the versions of the log entries that updated 'key', oldest first.
+     */
+    std::vector<version_t> getKeyVersions(const std::string& key);
+
+    /**
+     * Index the entries appended to the log so far, and flush the index file.
+     */
+    void persist();
+
+    /**
+     * Drop the entries strictly newer than 'ver', which were truncated from the log.
+     */
+    void truncate(version_t ver);
+
+    /**
+     * Drop the entries that were trimmed from the log. Their postings are
+     * removed lazily, once they outnumber the entries left in the index.
+     */
+    void trim();
+};
+
+}  // namespace persistent
+
+#endif  // DELTA_KEY_INDEX_HPP
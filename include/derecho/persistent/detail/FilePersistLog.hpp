@@ -4,6 +4,8 @@
 #include "PersistLog.hpp"
 #include "util.hpp"
 #include "derecho/utils/logger.hpp"
+#include <atomic>
+#include <deque>
 #include <pthread.h>
 #include <string>
 
@@ -129,6 +131,17 @@ protected:
     pthread_rwlock_t m_rwlock;
     // persistent lock
     pthread_mutex_t m_perslock;
+    // Regions of the data ring handed out by reservePlacement() that have not
+    // been appended in place or released yet, as (absolute offset, size) pairs
+    // in the order they were reserved. Guarded by m_rwlock.
+    std::deque<std::pair<uint64_t, uint64_t>> m_placements;
+    // how far ahead of the data tail the data ring is kept allocated and
+    // faulted in by the prewarming thread; 0 disables prewarming
+    const uint64_t m_iPrewarmBytes;
+    // the absolute data offset up to which the data ring has been prewarmed
+    std::atomic<uint64_t> m_iPrewarmedOfst;
+    // whether the log entry ring has been prewarmed yet
+    bool m_bLogPrewarmed;
 
 // lock macro
 #define FPL_WRLOCK                                                           \
@@ -177,6 +190,14 @@ protected:
     // FPL_PERS_LOCK is acquired.
     virtual void persistMetaHeaderAtomically(MetaHeader*);
 
+    // Registers the log with the prewarming thread, if prewarming is enabled,
+    // starting from the current tail.
+    void startPrewarming();
+
+    // Unregisters the log from the prewarming thread, waiting for any
+    // prewarming of it in progress to finish.
+    void stopPrewarming();
+
 public:
     //Constructor
     FilePersistLog(const std::string& name, const std::string& dataPath, bool enableSignatures);
@@ -201,6 +222,12 @@ public:
     virtual version_t getLatestVersion() override;
     virtual version_t getLastPersistedVersion() override;
     virtual const void* getEntryByIndex(int64_t eno) override;
+    virtual version_t getVersionByIndex(int64_t eno) override;
+    virtual std::size_t getEntryViews(int64_t eno, std::size_t count, bool reverse, LogEntryView* views) override;
+    virtual void readahead(int64_t from_eno, int64_t to_eno) override;
+    virtual std::string getAuxiliaryFilePath(const std::string& suffix) const override {
+        return m_sDataPath + "/" + m_sName + "." + suffix;
+    }
     virtual const void* getEntry(version_t ver, bool exact = false) override;
     virtual const void* getEntry(const HLC& hlc) override;
     virtual version_t persist(version_t ver,
@@ -218,6 +245,18 @@ public:
     virtual void post_object(const std::function<void(uint8_t const* const, std::size_t)>& f,
                              version_t ver) override;
     virtual void applyLogTail(uint8_t const* v) override;
+    virtual void* reservePlacement(uint64_t size) override;
+    virtual void releasePlacement(const void* region) override;
+    virtual std::pair<void*, uint64_t> getPlacementRegion() override;
+
+    /**
+     * Allocates on disk and faults into memory the part of the data ring that
+     * the next PERS/prewarm_bytes bytes of appends will be written to (and,
+     * the first time, the whole log entry ring), so that append() does not
+     * take page faults or wait for block allocation. Called by the background
+     * prewarming thread.
+     */
+    void prewarm();
 
     template <typename TKey, typename KeyGetter>
     void trim(const TKey& key, const KeyGetter& keyGetter) {
@@ -269,6 +308,15 @@ public:
      */
     static const uint64_t getMinimumLatestPersistedVersion(const std::string& prefix);
 
+    /**
+     * Get the minimum latest persisted version for a subgroup/shard with prefix
+     * from the logs in a specific directory
+     * @param prefix the subgroup/shard prefix
+     * @param dataPath the directory holding the logs
+     * @return the minimum latest persisted version
+     */
+    static const uint64_t getMinimumLatestPersistedVersion(const std::string& prefix, const std::string& dataPath);
+
 private:
     /** verify the existence of the meta file */
     bool checkOrCreateMetaFile();
@@ -369,7 +417,28 @@ private:
      * @param size: size of the data to be append in this log entry
      * @param ver: version of the new log entry
      */
-    void do_append_validation(const uint64_t size, const int64_t ver);
+    void do_append_validation(const uint64_t size, const int64_t ver, bool in_place = false);
+
+    /**
+     * The absolute offset at which the next copied entry's data will be
+     * written: after the last entry and after every outstanding placement.
+     * Note: no lock protected, use FPL_RDLOCK
+     */
+    uint64_t nextFreeDataOffset();
+
+    /**
+     * The number of bytes of the data ring that are neither used by entries
+     * nor reserved by placements.
+     * Note: no lock protected, use FPL_RDLOCK
+     */
+    uint64_t numFreeDataBytes();
+
+    /**
+     * Finds the outstanding placement that contains [pdata, pdata + size).
+     * Note: no lock protected, use FPL_RDLOCK
+     * @return an iterator to the placement, or m_placements.end()
+     */
+    std::deque<std::pair<uint64_t, uint64_t>>::iterator findPlacement(const void* pdata, uint64_t size);
 
 #ifndef NDEBUG
     //dbg functions
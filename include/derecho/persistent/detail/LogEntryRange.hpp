@@ -0,0 +1,115 @@
+#ifndef LOG_ENTRY_RANGE_HPP
+#define LOG_ENTRY_RANGE_HPP
+
+#include "PersistLog.hpp"
+
+#include <cstddef>
+#include <iterator>
+#include <vector>
+
+namespace persistent {
+
+/**
+ * A range of consecutive entries of a PersistLog, which can be scanned from
+ * the oldest entry to the newest one or in reverse. The iterators read the log
+ * sequentially in batches, each taken under a single lock acquisition, and ask
+ * the log to read the following batch ahead while the current one is being
+ * visited. They yield zero-copy LogEntryViews, which are valid as long as the
+ * entries are neither trimmed nor truncated; if entries of the range are
+ * trimmed or truncated during a scan, the scan ends early.
+ *
+ * A large range can be split into disjoint subranges to be scanned in
+ * parallel, one per thread.
+ */
+class LogEntryRange {
+    PersistLog* m_pLog;
+    // the lowest and highest entry numbers in the range; empty if low > high
+    int64_t m_iLowIndex;
+    int64_t m_iHighIndex;
+    // true to visit the entries from the highest entry number to the lowest
+    bool m_bReverse;
+
+public:
+    // the number of entries read from the log at a time
+    static constexpr std::size_t BATCH_SIZE = 256;
+
+    class iterator {
+        PersistLog* m_pLog;
+        // the next entry number to read from the log, and the last one in the range
+        int64_t m_iNextIndex;
+        int64_t m_iLastIndex;
+        bool m_bReverse;
+        std::vector<LogEntryView> m_batch;
+        std::size_t m_iBatchLength;
+        std::size_t m_iPos;
+
+        // Read the next batch of entries and start reading ahead the one after it.
+        void fetch();
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = LogEntryView;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const LogEntryView*;
+        using reference = const LogEntryView&;
+
+        /** Constructs an end iterator. */
+        iterator();
+        iterator(PersistLog* log, int64_t first_index, int64_t last_index, bool reverse);
+
+        reference operator*() const {
+            return m_batch[m_iPos];
+        }
+        pointer operator->() const {
+            return &m_batch[m_iPos];
+        }
+        iterator& operator++();
+        /** Two iterators are equal if they are both past the end, or point to the same entry. */
+        bool operator==(const iterator& other) const;
+        bool operator!=(const iterator& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * @param log the log
+     * @param low_index the lowest entry number in the range
+     * @param high_index the highest entry number in the range; the range is
+     *        empty if it is less than low_index
+     * @param reverse true to scan from high_index to low_index
+     */
+    LogEntryRange(PersistLog* log, int64_t low_index, int64_t high_index, bool reverse);
+
+    iterator begin() const;
+    iterator end() const;
+
+    /** @return the number of entries in the range */
+    int64_t size() const {
+        return empty() ? 0 : m_iHighIndex - m_iLowIndex + 1;
+    }
+    bool empty() const {
+        return m_iLowIndex > m_iHighIndex;
+    }
+
+    /**
+     * Splits the range into at most num_parts disjoint, nonempty subranges of
+     * about the same size, listed in the order this range would visit them.
+     */
+    std::vector<LogEntryRange> split(std::size_t num_parts) const;
+
+    /**
+     * @return the range of the entries of a log whose versions are between
+     * 'from' and 'to', inclusive.
+     */
+    static LogEntryRange byVersion(PersistLog* log, version_t from, version_t to, bool reverse);
+
+    /**
+     * @return the range of the entries of a log whose HLC timestamps are
+     * between 'from' and 'to', inclusive.
+     */
+    static LogEntryRange byHLC(PersistLog* log, const HLC& from, const HLC& to, bool reverse);
+};
+
+}  // namespace persistent
+
+#endif  // LOG_ENTRY_RANGE_HPP
@@ -14,6 +14,7 @@
 #include <set>
 #include <stdio.h>
 #include <string>
+#include <utility>
 
 namespace persistent {
 
@@ -21,6 +22,7 @@ namespace persistent {
 enum StorageType {
     ST_FILE = 0,
     ST_MEM,
+    /** Byte-addressable persistent memory, accessed through a DAX file system */
     ST_3DXP
 };
 
@@ -59,6 +61,19 @@ struct hlc_index_entry_comp {
     }
 };
 
+/**
+ * A zero-copy view of one log entry. The data points into the log itself, so
+ * it is only valid until the entry is trimmed or truncated.
+ */
+struct LogEntryView {
+    int64_t index;
+    version_t version;
+    HLC hlc;
+    // the entry's data, not including its signature
+    const void* data;
+    uint64_t size;
+};
+
 /**
  * Persistent log interface.
  * This class defines the interface that all persistent logs must implement, and
@@ -149,6 +164,39 @@ public:
     // Get a version by entry number return both length and buffer
     virtual const void* getEntryByIndex(int64_t eno) = 0;
 
+    // Get the version of the log entry at an entry number
+    virtual version_t getVersionByIndex(int64_t eno) = 0;
+
+    /**
+     * Get views of up to 'count' consecutive log entries, starting at entry
+     * number 'eno' and moving towards the tail, or towards the head if
+     * 'reverse' is true. This is the building block of sequential scans: the
+     * log is locked once per batch instead of once per entry.
+     * @param eno - the first entry number
+     * @param count - the maximum number of entries
+     * @param reverse - true to move towards the head of the log
+     * @param views - an array of at least 'count' views to fill in
+     * @return the number of views filled in, which is less than 'count' if
+     *         the head or tail of the log was reached.
+     */
+    virtual std::size_t getEntryViews(int64_t eno, std::size_t count, bool reverse, LogEntryView* views) = 0;
+
+    /**
+     * Hint that the log entries numbered 'from_eno' to 'to_eno' (inclusive,
+     * in either order) and their data will be read soon, so that they can be
+     * read ahead from storage. Does nothing by default.
+     */
+    virtual void readahead(int64_t from_eno, int64_t to_eno) {}
+
+    /**
+     * @return the path of a file stored alongside the log and named after it,
+     *         with the given suffix, for auxiliary structures persisted with
+     *         the log; an empty string if the log has no storage for one.
+     */
+    virtual std::string getAuxiliaryFilePath(const std::string& suffix) const {
+        return "";
+    }
+
     // Get the latest version equal or earlier than ver.
     // @param ver - version requested
     // @param exact - ask for the exact version
@@ -273,6 +321,37 @@ public:
      * @param ver - all log entry strictly after ver will be truncated.
      */
     virtual void truncate(version_t ver) = 0;
+
+    /**
+     * Reserves space in the log's data region for an entry that will be
+     * written there directly, e.g. by an RDMA transfer, before it is appended.
+     * If append() is later called with data that lies inside the reserved
+     * region, the entry is recorded in place instead of being copied. Logs
+     * that do not support this return nullptr, as do logs that have no room
+     * or that reserve space for signatures in front of each entry.
+     * @param size - the number of bytes to reserve
+     * @return a pointer to the reserved region, or nullptr
+     */
+    virtual void* reservePlacement(uint64_t size) {
+        return nullptr;
+    }
+
+    /**
+     * Releases a region returned by reservePlacement(). Does nothing if an
+     * entry was already appended in place from the region.
+     * @param region - the pointer returned by reservePlacement()
+     */
+    virtual void releasePlacement(const void* region) {}
+
+    /**
+     * @return the start and length of the memory that reservePlacement()
+     * hands out regions of, which bounds the windows of it that are
+     * registered for RDMA; {nullptr, 0} if reservePlacement() is not
+     * supported. Regions are always contiguous within this memory.
+     */
+    virtual std::pair<void*, uint64_t> getPlacementRegion() {
+        return {nullptr, 0};
+    }
 };
 }  // namespace persistent
 
@@ -95,10 +95,19 @@ inline void Persistent<ObjectType, storageType>::initialize_log(const char* obje
             }
             break;
         }
+        // persistent memory
+        case ST_3DXP:
+            this->m_pLog = std::make_unique<DaxPersistLog>(object_name, enable_signatures);
+            break;
         //default
         default:
             throw persistent_unknown_storage_type(storageType);
     }
+    // STEP 2: initialize version cache
+    const uint64_t version_cache_bytes = getPersVersionCacheBytes();
+    if(version_cache_bytes > 0) {
+        this->m_pVersionCache = std::make_unique<VersionCache<ObjectType>>(version_cache_bytes);
+    }
 }
 
 template <typename ObjectType,
@@ -154,6 +163,8 @@ template <typename ObjectType,
 Persistent<ObjectType, storageType>::Persistent(Persistent&& other) {
     this->m_pWrappedObject = std::move(other.m_pWrappedObject);
     this->m_pLog = std::move(other.m_pLog);
+    this->m_pVersionCache = std::move(other.m_pVersionCache);
+    this->m_pKeyIndex = std::move(other.m_pKeyIndex);
     this->m_pRegistry = other.m_pRegistry;
     this->m_logger = PersistLogger::get();
     if(this->m_pRegistry != nullptr) {
@@ -310,6 +321,9 @@ auto Persistent<ObjectType, storageType>::get(
         version_t ver,
         const Func& fun,
         mutils::DeserializationManager* dm) const {
+    if(this->m_pVersionCache) {
+        return fun(*this->getShared(ver, dm));
+    }
     uint8_t* pdat = (uint8_t*)this->m_pLog->getEntry(ver);
     if(pdat == nullptr) {
         throw persistent_invalid_version(ver);
@@ -369,6 +383,70 @@ Persistent<ObjectType, storageType>::getDelta(
     return mutils::from_bytes<DeltaType>(dm, (const uint8_t*)this->m_pLog->getEntryByIndex(idx));
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+template <typename DummyObjectType>
+std::enable_if_t<std::is_base_of<IDeltaSupport<DummyObjectType>, DummyObjectType>::value>
+Persistent<ObjectType, storageType>::enableKeyIndex(const DeltaKeyExtractor& extractor) {
+    this->m_pKeyIndex = std::make_unique<DeltaKeyIndex>(this->m_pLog.get(), extractor);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+DeltaKeyIndex& Persistent<ObjectType, storageType>::getKeyIndex() const {
+    if(!this->m_pKeyIndex) {
+        throw persistent_exception("The key index of " + this->m_pLog->m_sName + " is not enabled.");
+    }
+    return *this->m_pKeyIndex;
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+template <typename DeltaType, typename Func>
+std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
+Persistent<ObjectType, storageType>::getDeltaByKey(const std::string& key,
+                                                   const version_t ver,
+                                                   const Func& fun,
+                                                   mutils::DeserializationManager* dm) const {
+    int64_t idx = getKeyIndex().lookup(key, ver).second;
+    if(idx == INVALID_INDEX) {
+        throw persistent_invalid_version(ver);
+    }
+    return mutils::deserialize_and_run(dm, (uint8_t*)this->m_pLog->getEntryByIndex(idx), fun);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+template <typename DeltaType, typename Func>
+std::enable_if_t<std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value, std::result_of_t<Func(const DeltaType&)>>
+Persistent<ObjectType, storageType>::getDeltaByKey(const std::string& key,
+                                                   const HLC& hlc,
+                                                   const Func& fun,
+                                                   mutils::DeserializationManager* dm) const {
+    // global stability frontier test
+    if(m_pRegistry != nullptr && m_pRegistry->getFrontier() <= hlc) {
+        throw persistent_version_not_stable();
+    }
+    version_t ver = this->m_pLog->getHLCVersion(hlc);
+    int64_t idx = (ver == INVALID_VERSION) ? INVALID_INDEX : getKeyIndex().lookup(key, ver).second;
+    if(idx == INVALID_INDEX) {
+        throw persistent_invalid_hlc();
+    }
+    return mutils::deserialize_and_run(dm, (uint8_t*)this->m_pLog->getEntryByIndex(idx), fun);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+version_t Persistent<ObjectType, storageType>::getKeyVersion(const std::string& key, const version_t ver) const {
+    return getKeyIndex().lookup(key, ver).first;
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+std::vector<version_t> Persistent<ObjectType, storageType>::getKeyVersions(const std::string& key) const {
+    return getKeyIndex().getKeyVersions(key);
+}
+
 template <typename ObjectType,
           StorageType storageType>
 template <typename DeltaType, typename DummyObjectType>
@@ -396,6 +474,17 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::trim(const HLC& key) {
     dbg_trace(m_logger, "trim.");
     this->m_pLog->trim(key);
+    if(this->m_pVersionCache) {
+        const version_t earliest_version = this->m_pLog->getEarliestVersion();
+        if(earliest_version == INVALID_VERSION) {
+            this->m_pVersionCache->clear();
+        } else {
+            this->m_pVersionCache->invalidateBefore(earliest_version);
+        }
+    }
+    if(this->m_pKeyIndex) {
+        this->m_pKeyIndex->trim();
+    }
     dbg_trace(m_logger, "trim...done");
 }
 
@@ -404,6 +493,17 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::trim(version_t ver) {
     dbg_trace(m_logger, "trim.");
     this->m_pLog->trim(ver);
+    if(this->m_pVersionCache) {
+        const version_t earliest_version = this->m_pLog->getEarliestVersion();
+        if(earliest_version == INVALID_VERSION) {
+            this->m_pVersionCache->clear();
+        } else {
+            this->m_pVersionCache->invalidateBefore(earliest_version);
+        }
+    }
+    if(this->m_pKeyIndex) {
+        this->m_pKeyIndex->trim();
+    }
     dbg_trace(m_logger, "trim...done");
 }
 
@@ -412,6 +512,12 @@ template <typename ObjectType,
 void Persistent<ObjectType, storageType>::truncate(const version_t ver) {
     dbg_trace(m_logger, "truncate.");
     this->m_pLog->truncate(ver);
+    if(this->m_pVersionCache) {
+        this->m_pVersionCache->invalidateAfter(ver);
+    }
+    if(this->m_pKeyIndex) {
+        this->m_pKeyIndex->truncate(ver);
+    }
     dbg_trace(m_logger, "truncate...done");
 }
 
@@ -427,6 +533,13 @@ auto Persistent<ObjectType, storageType>::get(
         throw persistent_version_not_stable();
     }
 
+    if(this->m_pVersionCache) {
+        int64_t idx = this->m_pLog->getHLCIndex(hlc);
+        if(idx == INVALID_INDEX) {
+            throw persistent_invalid_hlc();
+        }
+        return fun(*getSharedByIndex(idx, dm));
+    }
     if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
         int64_t idx = this->m_pLog->getHLCIndex(hlc);
         if(idx == INVALID_INDEX) {
@@ -466,6 +579,110 @@ std::unique_ptr<ObjectType> Persistent<ObjectType, storageType>::get(
     }
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+std::shared_ptr<const ObjectType> Persistent<ObjectType, storageType>::getSharedByIndex(
+        int64_t idx,
+        mutils::DeserializationManager* dm) const {
+    if(!this->m_pVersionCache) {
+        return getByIndex(idx, dm);
+    }
+    // Like a seqlock: read the generation before the entry's version and data, and insert() reads it
+    // again, so an object read while a concurrent truncate() replaced the entry is kept out of the cache
+    const uint64_t generation = this->m_pVersionCache->getGeneration();
+    const version_t entry_ver = this->m_pLog->getVersionByIndex(idx);
+    std::shared_ptr<const ObjectType> object = this->m_pVersionCache->lookup(entry_ver);
+    if(object) {
+        return object;
+    }
+    object = getByIndex(idx, dm);
+    this->m_pVersionCache->insert(entry_ver, object, mutils::bytes_size(*object), generation);
+    return object;
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+std::shared_ptr<const ObjectType> Persistent<ObjectType, storageType>::getShared(
+        const version_t ver,
+        mutils::DeserializationManager* dm) const {
+    int64_t idx = this->m_pLog->getVersionIndex(ver);
+    if(idx == INVALID_INDEX) {
+        throw persistent_invalid_version(ver);
+    }
+    return getSharedByIndex(idx, dm);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+std::shared_ptr<const ObjectType> Persistent<ObjectType, storageType>::getShared(
+        const HLC& hlc,
+        mutils::DeserializationManager* dm) const {
+    // global stability frontier test
+    if(m_pRegistry != nullptr && m_pRegistry->getFrontier() <= hlc) {
+        throw persistent_version_not_stable();
+    }
+    int64_t idx = this->m_pLog->getHLCIndex(hlc);
+    if(idx == INVALID_INDEX) {
+        throw persistent_invalid_hlc();
+    }
+    return getSharedByIndex(idx, dm);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+LogEntryRange Persistent<ObjectType, storageType>::getEntries(
+        const version_t from,
+        const version_t to,
+        bool reverse) const {
+    return LogEntryRange::byVersion(this->m_pLog.get(), from, to, reverse);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+LogEntryRange Persistent<ObjectType, storageType>::getEntries(
+        const HLC& from,
+        const HLC& to,
+        bool reverse) const {
+    // global stability frontier test
+    if(m_pRegistry != nullptr && m_pRegistry->getFrontier() <= to) {
+        throw persistent_version_not_stable();
+    }
+    return LogEntryRange::byHLC(this->m_pLog.get(), from, to, reverse);
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+template <typename Func>
+void Persistent<ObjectType, storageType>::forEachVersion(
+        const version_t from,
+        const version_t to,
+        const Func& fun,
+        mutils::DeserializationManager* dm) const {
+    LogEntryRange range = LogEntryRange::byVersion(this->m_pLog.get(), from, to, false);
+    if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        std::unique_ptr<ObjectType> state;
+        for(const LogEntryView& entry : range) {
+            if(!state) {
+                state = getByIndex(entry.index, dm);
+            } else {
+                state->applyDelta(static_cast<const uint8_t*>(entry.data));
+            }
+            fun(entry.version, static_cast<const ObjectType&>(*state));
+        }
+    } else {
+        for(const LogEntryView& entry : range) {
+            mutils::deserialize_and_run(dm, static_cast<const uint8_t*>(entry.data),
+                                        [&](const ObjectType& object) { fun(entry.version, object); });
+        }
+    }
+}
+
+template <typename ObjectType,
+          StorageType storageType>
+uint64_t Persistent<ObjectType, storageType>::getVersionCacheBytes() const {
+    return this->m_pVersionCache ? this->m_pVersionCache->getUsedBytes() : 0;
+}
+
 template <typename ObjectType,
           StorageType storageType>
 int64_t Persistent<ObjectType, storageType>::getNumOfVersions() const {
@@ -622,6 +839,16 @@ std::size_t Persistent<ObjectType, storageType>::getSignatureSize() const {
     return this->m_pLog->signature_size;
 }
 
+template <typename ObjectType,
+          StorageType storageType>
+PersistLog* Persistent<ObjectType, storageType>::getPlacementLog() {
+    if constexpr(std::is_base_of<IDeltaSupport<ObjectType>, ObjectType>::value) {
+        return this->m_pLog.get();
+    } else {
+        return nullptr;
+    }
+}
+
 template <typename ObjectType,
           StorageType storageType>
 void Persistent<ObjectType, storageType>::updateVerifier(version_t ver, openssl::Verifier& verifier) {
@@ -642,12 +869,18 @@ version_t Persistent<ObjectType, storageType>::persist(version_t ver) {
     struct timespec t1, t2;
     clock_gettime(CLOCK_REALTIME, &t1);
     version_t ret = this->m_pLog->persist(ver);
+    if(this->m_pKeyIndex) {
+        this->m_pKeyIndex->persist();
+    }
     clock_gettime(CLOCK_REALTIME, &t2);
     cnt_in_persist++;
     ns_in_persist += ((t2.tv_sec - t1.tv_sec) * 1000000000ul + t2.tv_nsec - t1.tv_nsec);
     return ret;
 #else
     version_t persisted_ver = this->m_pLog->persist(ver);
+    if(this->m_pKeyIndex) {
+        this->m_pKeyIndex->persist();
+    }
     dbg_debug(m_logger, "{} persist({}), actually persisted version {}", this->m_pLog->m_sName, ver, persisted_ver);
     return persisted_ver;
 #endif  //_PERFORMANCE_DEBUG
@@ -788,7 +1021,7 @@ std::unique_ptr<ObjectType> loadObject(const char* object_name) {
 }
 
 template <StorageType storageType>
-const typename std::enable_if<(storageType == ST_FILE || storageType == ST_MEM), version_t>::type getMinimumLatestPersistedVersion(const std::type_index& subgroup_type, uint32_t subgroup_index, uint32_t shard_num) {
+const typename std::enable_if<(storageType == ST_FILE || storageType == ST_MEM || storageType == ST_3DXP), version_t>::type getMinimumLatestPersistedVersion(const std::type_index& subgroup_type, uint32_t subgroup_index, uint32_t shard_num) {
     // All persistent log implementation MUST implement getMinimumLatestPersistedVersion()
     // All of them need to be checked here
     // NOTE: we assume that an application will only use ONE type of PERSISTED LOG (ST_FILE or ST_NVM, ...). Otherwise,
@@ -798,7 +1031,11 @@ const typename std::enable_if<(storageType == ST_FILE || storageType == ST_MEM),
     // In case we get a valid version from log stored in other storage type, we should return INVALID_VERSION for 1)
     // but return the valid version for 2).
     version_t mlpv = INVALID_VERSION;
-    mlpv = FilePersistLog::getMinimumLatestPersistedVersion(PersistentRegistry::generate_prefix(subgroup_type, subgroup_index, shard_num));
+    if constexpr(storageType == ST_3DXP) {
+        mlpv = DaxPersistLog::getMinimumLatestPersistedVersion(PersistentRegistry::generate_prefix(subgroup_type, subgroup_index, shard_num));
+    } else {
+        mlpv = FilePersistLog::getMinimumLatestPersistedVersion(PersistentRegistry::generate_prefix(subgroup_type, subgroup_index, shard_num));
+    }
     return mlpv;
 }
 }  // namespace persistent
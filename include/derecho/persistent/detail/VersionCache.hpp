@@ -0,0 +1,170 @@
+#ifndef VERSION_CACHE_HPP
+#define VERSION_CACHE_HPP
+
+#include "../PersistentInterface.hpp"
+
+#include <cstdint>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+namespace persistent {
+
+/**
+ * A bounded LRU cache of materialized historical versions of a Persistent<T>,
+ * keyed by the version of the log entry they were materialized from. Cached
+ * objects are immutable and handed out by shared_ptr, so a reader keeps its
+ * object alive even after the cache evicts it. The cache is bounded by the
+ * total size of its objects, as reported by the caller when inserting them
+ * (Persistent<T> uses their serialized size). Thread-safe.
+ *
+ * Versions are only ever appended to a log, but a truncated version number can
+ * be reused by a different entry, so invalidateAfter() must be called whenever
+ * the log is truncated. An object materialized before an invalidation is not
+ * inserted after it, even if its insert() call comes later.
+ */
+template <typename ObjectType>
+class VersionCache {
+    struct CacheEntry {
+        version_t ver;
+        std::shared_ptr<const ObjectType> object;
+        uint64_t size;
+    };
+
+    std::mutex m_mutex;
+    // least recently used at the back
+    std::list<CacheEntry> m_lruList;
+    std::unordered_map<version_t, typename std::list<CacheEntry>::iterator> m_entries;
+    // the maximum and current total size of the cached objects
+    const uint64_t m_capacity;
+    uint64_t m_usedBytes;
+    // incremented by every invalidation
+    uint64_t m_generation;
+    uint64_t m_hits;
+    uint64_t m_misses;
+
+    // Remove an entry. We assume m_mutex is acquired.
+    void erase(typename std::list<CacheEntry>::iterator it) {
+        m_usedBytes -= it->size;
+        m_entries.erase(it->ver);
+        m_lruList.erase(it);
+    }
+
+public:
+    /**
+     * @param capacity the maximum total size of the cached objects, in bytes
+     */
+    VersionCache(uint64_t capacity)
+            : m_capacity(capacity), m_usedBytes(0), m_generation(0), m_hits(0), m_misses(0) {}
+
+    /**
+     * @return the cached object materialized from the log entry with version
+     * ver, or nullptr if it is not cached.
+     */
+    std::shared_ptr<const ObjectType> lookup(version_t ver) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        auto it = m_entries.find(ver);
+        if(it == m_entries.end()) {
+            m_misses++;
+            return nullptr;
+        }
+        m_hits++;
+        m_lruList.splice(m_lruList.begin(), m_lruList, it->second);
+        return it->second->object;
+    }
+
+    /**
+     * @return the current generation, to be passed to insert() for an object
+     * materialized after this call.
+     */
+    uint64_t getGeneration() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_generation;
+    }
+
+    /**
+     * Cache an object, evicting the least recently used ones to make room for
+     * it. Nothing happens if the object is larger than the whole cache, if the
+     * version is already cached, or if the cache has been invalidated since
+     * generation was read.
+     * @param ver the version of the log entry the object was materialized from
+     * @param object the object
+     * @param size the size of the object, in bytes
+     * @param generation the value of getGeneration() before the object was materialized
+     */
+    void insert(version_t ver, const std::shared_ptr<const ObjectType>& object, uint64_t size, uint64_t generation) {
+        if(size > m_capacity) {
+            return;
+        }
+        std::lock_guard<std::mutex> lck(m_mutex);
+        if(generation != m_generation || m_entries.find(ver) != m_entries.end()) {
+            return;
+        }
+        while(m_usedBytes + size > m_capacity) {
+            erase(std::prev(m_lruList.end()));
+        }
+        m_lruList.push_front({ver, object, size});
+        m_entries.emplace(ver, m_lruList.begin());
+        m_usedBytes += size;
+    }
+
+    /**
+     * Drop the versions newer than ver, because the log was truncated to ver.
+     */
+    void invalidateAfter(version_t ver) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_generation++;
+        for(auto it = m_lruList.begin(); it != m_lruList.end();) {
+            auto next = std::next(it);
+            if(it->ver > ver) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+
+    /**
+     * Drop the versions older than ver, because the log was trimmed to ver.
+     * They are no longer reachable through the log.
+     */
+    void invalidateBefore(version_t ver) {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        for(auto it = m_lruList.begin(); it != m_lruList.end();) {
+            auto next = std::next(it);
+            if(it->ver < ver) {
+                erase(it);
+            }
+            it = next;
+        }
+    }
+
+    /**
+     * Drop all cached versions.
+     */
+    void clear() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        m_generation++;
+        m_lruList.clear();
+        m_entries.clear();
+        m_usedBytes = 0;
+    }
+
+    /** @return the total size of the cached objects, in bytes */
+    uint64_t getUsedBytes() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return m_usedBytes;
+    }
+
+    /** @return the number of lookups that found / did not find their version */
+    std::pair<uint64_t, uint64_t> getHitsAndMisses() {
+        std::lock_guard<std::mutex> lck(m_mutex);
+        return {m_hits, m_misses};
+    }
+};
+
+}  // namespace persistent
+
+#endif  // VERSION_CACHE_HPP
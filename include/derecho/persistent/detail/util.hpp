@@ -37,6 +37,14 @@ inline std::string getPersFilePath() {
     return std::string(derecho::getConfString(derecho::Conf::PERS_FILE_PATH));
 }
 
+inline std::string getPersDaxPath() {
+    return std::string(derecho::getConfString(derecho::Conf::PERS_DAX_PATH));
+}
+
+inline uint64_t getPersVersionCacheBytes() {
+    return derecho::getConfUInt64(derecho::Conf::PERS_VERSION_CACHE_BYTES);
+}
+
 // verify the existence of a folder
 // Check if directory exists or not. Create it on absence.
 // return error if creating failed
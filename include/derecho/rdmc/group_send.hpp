@@ -32,6 +32,7 @@ protected:
     const size_t block_size;
     const uint32_t num_members;
     const uint32_t member_index;  // our index in the members list
+    const uint32_t priority;      // sends in higher-priority groups preempt ours
 
     const unique_ptr<schedule> transfer_schedule;
 
@@ -49,7 +50,8 @@ protected:
           vector<uint32_t> members, uint32_t member_index,
           incoming_message_callback_t upcall,
           completion_callback_t callback,
-          unique_ptr<schedule> transfer_schedule);
+          unique_ptr<schedule> transfer_schedule,
+          uint32_t priority);
 
 public:
     virtual ~group();
@@ -60,6 +62,11 @@ public:
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
                               size_t offset, size_t length)
             = 0;
+    /**
+     * Continues a send that was held back while a higher-priority send from
+     * this node was in progress.
+     */
+    virtual void resume_send() = 0;
 };
 
 class polling_group : public group {
@@ -104,7 +111,9 @@ public:
                   vector<uint32_t> members, uint32_t member_index,
                   incoming_message_callback_t upcall,
                   completion_callback_t callback,
-                  unique_ptr<schedule> transfer_schedule);
+                  unique_ptr<schedule> transfer_schedule,
+                  uint32_t priority);
+    virtual ~polling_group();
 
     virtual void receive_block(uint32_t send_imm, size_t size);
     virtual void receive_ready_for_block(uint32_t step, uint32_t sender);
@@ -112,6 +121,7 @@ public:
 
     virtual void send_message(std::shared_ptr<rdma::memory_region> message_mr,
                               size_t offset, size_t length);
+    virtual void resume_send();
 
 private:
     void post_recv(schedule::block_transfer transfer);
@@ -44,11 +44,40 @@ typedef std::function<void(uint8_t* buffer, size_t size)> completion_callback_t;
 typedef std::function<void(std::optional<uint32_t> suspected_victim)>
         failure_callback_t;
 
+/**
+ * Initializes RDMC. It can be called once by each Derecho group in a process:
+ * the calls after the first one share the RDMA context it created, and only
+ * connect to the nodes in addresses that are not connected yet. They must all
+ * use the same node_rank, and their groups share a single namespace of RDMC
+ * group numbers, in which each Derecho group should reserve its own range
+ * with reserve_group_numbers().
+ * @return false if RDMC has been shut down, or node_rank differs from the
+ * one RDMC was first initialized with.
+ */
 bool initialize(const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& addresses,
                 uint32_t node_rank) __attribute__((warn_unused_result));
 void add_address(uint32_t index, const std::pair<ip_addr_t, uint16_t>& address);
+/**
+ * Matches one call to initialize(). The RDMA context is destroyed by the call
+ * matching the last initialize() call still in effect.
+ */
 void shutdown();
 
+/** The number of group numbers in each range returned by reserve_group_numbers() */
+constexpr uint16_t GROUP_NUMBER_RANGE_SIZE = 4096;
+/**
+ * Reserves a range of GROUP_NUMBER_RANGE_SIZE group numbers for the RDMC
+ * groups of one Derecho group, so that the Derecho groups in a process never
+ * create RDMC groups with the same number. A group number only tags this
+ * node's own RDMA operations and is never sent to other nodes, so each member
+ * of a Derecho group reserves its range independently.
+ * @return The first group number of the lowest free range, or std::nullopt if
+ * all the ranges are in use.
+ */
+std::optional<uint16_t> reserve_group_numbers();
+/** Releases a range of group numbers reserved by reserve_group_numbers(). */
+void release_group_numbers(uint16_t first_group_number);
+
 /**
  * Creates a new RDMC group.
  * @param group_number The group's unique identifier.
@@ -64,13 +93,17 @@ void shutdown();
  * message in this group
  * @param failure_callback The function to call when RDMC detects a failure in
  * this group. It will be called with the suspected failed node's ID.
+ * @param priority The priority of messages sent in this group. When this node
+ * is the root of a send in a group with a higher priority, it holds back the
+ * blocks of its sends in lower-priority groups until that send completes.
  * @return True if group creation succeeds, false if it fails.
  */
 bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_receive,
                   completion_callback_t send_callback,
-                  failure_callback_t failure_callback)
+                  failure_callback_t failure_callback,
+                  uint32_t priority = 0)
         __attribute__((warn_unused_result));
 void destroy_group(uint16_t group_number);
 
@@ -101,6 +101,8 @@ protected:
 public:
     /** ID of the remote node. */
     int remote_id;
+    /** ID of the local node (the Group or ExternalGroupClient) this connection belongs to. */
+    uint32_t local_id;
     /** tx/rx completion queue */
     // struct fid_cq *txcq, *rxcq; - moved to g_ctxt
     /** Handle for the LibFabric endpoint. */
@@ -285,6 +287,8 @@ public:
      * Initializes the resources. Registers write_addr and read_addr as the read
      * and write buffers and connects a queue pair with the specified remote node.
      *
+     * @param local_id The node id of the local node, which selects the TCP
+     *        connections used to set up the connection.
      * @param r_id The node id of the remote node to connect to.
      * @param write_addr A pointer to the memory to use as the write buffer. This
      * is where data should be written locally in order to send it in an RDMA write
@@ -298,7 +302,7 @@ public:
      *         node, while a libfabric server waiting for the conneciton using its
      *         local passive endpoint.
      */
-    _resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+    _resources(uint32_t local_id, int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
                int size_r, int is_lf_server);
     /** Destroys the resources. */
     virtual ~_resources();
@@ -311,8 +315,8 @@ public:
 class resources : public _resources {
 public:
     /** Constructor: simply forwards to _resources::_resources */
-    resources(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
-              int size_r, int is_lf_server) : _resources(r_id, write_addr, read_addr, size_w, size_r, is_lf_server) {
+    resources(uint32_t local_id, int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+              int size_r, int is_lf_server) : _resources(local_id, r_id, write_addr, read_addr, size_w, size_r, is_lf_server) {
     }
     /**
      * Report that the remote node this object is connected to has failed.
@@ -347,8 +351,8 @@ class resources_two_sided : public _resources {
 
 public:
     /** constructor: simply forwards to _resources::_resources */
-    resources_two_sided(int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
-                        int size_r, int is_lf_server) : _resources(r_id, write_addr, read_addr, size_w, size_r, is_lf_server) {
+    resources_two_sided(uint32_t local_id, int r_id, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+                        int size_r, int is_lf_server) : _resources(local_id, r_id, write_addr, read_addr, size_w, size_r, is_lf_server) {
     }
     /**
      * Report that the remote node this object is connected to has failed.
@@ -365,37 +369,52 @@ public:
     void post_two_sided_receive(lf_completion_entry_ctxt* ctxt, const long long int offset, const long long int size);
 };
 
+/*
+ * The TCP connections used to set up RDMA connections are kept separately for
+ * each local node ID that called lf_initialize(), so the functions below take
+ * the ID of the local node whose connections they use.
+ */
+
 /**
- * Adds a new node to the SST TCP connections set.
+ * Adds a new node to the SST TCP connections set of a local node.
  */
-bool add_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
+bool add_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
 /**
- * Adds a new node to external client connections set.
+ * Adds a new node to the external client connections set of a local node.
  */
-bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
+bool add_external_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
 /**
- * Removes a node from the SST TCP connections set
+ * Removes a node from the SST TCP connections set of a local node
  */
-bool remove_node(uint32_t node_id);
+bool remove_node(uint32_t local_id, uint32_t node_id);
 /**
  * Blocks the current thread until both this node and a remote node reach this
  * function, which exchanges some trivial data over a TCP connection.
+ * @param local_id - ID of the local node.
  * @param r_id - ID of the node to exchange data with.
  * @return true/false
  */
-bool sync(uint32_t r_id);
+bool sync(uint32_t local_id, uint32_t r_id);
 /**
  * Compares the set of external client connections to a list of known live nodes and
  * removes any connections to nodes not in that list. This is used to
  * filter out connections to nodes that were removed from the view.
+ * @param local_id The ID of the local node whose connections are filtered
  * @param live_nodes_list A list of node IDs whose connections should be
  * retained; all other connections will be deleted.
  */
-void filter_external_to(const std::vector<node_id_t>& live_nodes_list);
+void filter_external_to(uint32_t local_id, const std::vector<node_id_t>& live_nodes_list);
 /**
  * Initializes the global libfabric resources. Must be called before creating
  * or using any SST instance.
  *
+ * The resources (fabric, domain, completion queue, and polling thread) are
+ * shared by every Group and ExternalGroupClient in the process, whatever
+ * their node IDs: the first call sets them up, and later calls only set up
+ * the TCP connections of their node ID. Each call should be matched by a call
+ * to lf_destroy() with the same node ID; the resources are released when the
+ * last user does so, or when the process exits.
+ *
  * @param internal_ip_addrs_and_ports A map from id to (IP address, port) pairs for internal group members
  * @param external_ip_addrs_and_ports A map from id to (IP address, port) pairs for external connections
  * @param node_id id of this node.
@@ -409,8 +428,13 @@ void lf_initialize(const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& int
 std::pair<uint32_t, std::pair<int32_t, int32_t>> lf_poll_completion();
 /** Shutdown the polling thread. */
 void shutdown_polling_thread();
-/** Destroys the global libfabric resources. */
-void lf_destroy();
+/**
+ * Releases the reference of one lf_initialize() call to the global libfabric
+ * resources, closing the TCP connections of its node ID if it was the last
+ * call for that node ID, and destroying the resources if it was the last one.
+ * @param node_id The node ID passed to lf_initialize()
+ */
+void lf_destroy(uint32_t node_id);
 
 /* -------- Error-handling tools -------- */
 
@@ -9,6 +9,7 @@
 #include "../sst.hpp"
 
 #include "../predicates.hpp"
+#include "derecho/utils/placement.hpp"
 #include "poll_utils.hpp"
 
 #include <chrono>
@@ -35,7 +36,7 @@ SST<DerivedSST>::~SST() {
     }
 
     if(rows != nullptr) {
-        delete[](const_cast<uint8_t*>(rows));
+        derecho::free_registered_buffer(const_cast<uint8_t*>(rows), rowLen * num_members);
     }
 }
 
@@ -61,6 +62,7 @@ void SST<DerivedSST>::start_predicate_evaluation() {
 template <typename DerivedSST>
 void SST<DerivedSST>::detect() {
     pthread_setname_np(pthread_self(), "sst_detect");
+    derecho::pin_thread("sst_detect");
     if(!thread_start) {
         std::unique_lock<std::mutex> lock(thread_start_mutex);
         thread_start_cv.wait(lock, [this]() { return thread_start; });
@@ -266,7 +268,7 @@ void SST<DerivedSST>::sync_with_members() const {
     for(auto const& id_index : members_by_id) {
         std::tie(node_id, sst_index) = id_index;
         if(sst_index != my_index && !row_is_frozen[sst_index]) {
-            sync(node_id);
+            sync(my_node_id, node_id);
         }
     }
 }
@@ -281,7 +283,7 @@ void SST<DerivedSST>::sync_with_members(std::vector<uint32_t> row_indices) const
             continue;
         }
         if(!row_is_frozen[row_index]) {
-            sync(members[row_index]);
+            sync(my_node_id, members[row_index]);
         }
     }
 }
@@ -83,6 +83,8 @@ protected:
 public:
     /** Index of the remote node. */
     int remote_index;
+    /** ID of the local node (the Group or ExternalGroupClient) this connection belongs to. */
+    uint32_t local_id;
     /** Handle for the IB Verbs Queue Pair object. */
     struct ibv_qp* qp;
     /** Memory Region handle for the write buffer. */
@@ -107,7 +109,7 @@ public:
 
     /** Constructor; initializes Queue Pair, Memory Regions, and `remote_props`.
      */
-    _resources(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+    _resources(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
                int size_r);
     /** Destroys the resources. */
     virtual ~_resources();
@@ -115,7 +117,7 @@ public:
 
 class resources : public _resources {
 public:
-    resources(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+    resources(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
               int size_r);
     /**
      * Report that the remote node this object is connected to has failed.
@@ -144,7 +146,7 @@ class resources_two_sided : public _resources {
     int post_receive(verbs_sender_ctxt* ce_ctxt, const long long int offset, const long long int size);
 
 public:
-    resources_two_sided(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+    resources_two_sided(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
                         int size_r);
     /**
      * Report that the remote node this object is connected to has failed.
@@ -161,37 +163,52 @@ public:
     void post_two_sided_receive(verbs_sender_ctxt* ce_ctxt, const long long int offset, const long long int size);
 };
 
-bool add_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
-bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
-bool remove_node(uint32_t node_id);
+/*
+ * The TCP connections used to set up queue pairs are kept separately for each
+ * local node ID that called verbs_initialize(), so the functions below take
+ * the ID of the local node whose connections they use.
+ */
+bool add_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
+bool add_external_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port);
+bool remove_node(uint32_t local_id, uint32_t node_id);
 
 /*
  * Blocks the current rehad until both this node and a remote node reach this function.
  *
+ * @param local_id
  * @param r_index
  *
  * @return
  */
-bool sync(uint32_t r_index);
+bool sync(uint32_t local_id, uint32_t r_index);
 
 /**
  * Compares the set of external client connections to a list of known live nodes and
  * removes any connections to nodes not in that list. This is used to filter out
  * connections to nodes that were removed from the view.
+ * @param local_id The ID of the local node whose connections are filtered
  * @param live_nodes_list A list of node IDs whose connections should be retained;
  *        all other connections will be deleted.
  */
-void filter_external_to(const std::vector<node_id_t>& live_nodes_list);
+void filter_external_to(uint32_t local_id, const std::vector<node_id_t>& live_nodes_list);
 
-/** Initializes the global verbs resources. */
+/**
+ * Initializes the global verbs resources. Like lf_initialize(), the resources
+ * are shared by every Group and ExternalGroupClient in the process: the first
+ * call creates them, and each call sets up the TCP connections of its node ID.
+ */
 void verbs_initialize(const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_sst_ports,
                       const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_external_ports,
                       uint32_t node_id);
 /** Polls for completion of a single posted remote write. */
 std::pair<uint32_t, std::pair<int, int>> verbs_poll_completion();
 void shutdown_polling_thread();
-/** Destroys the global verbs resources. */
-void verbs_destroy();
+/**
+ * Releases the reference of one verbs_initialize() call to the global verbs
+ * resources, closing the TCP connections of its node ID if it was the last
+ * call for that node ID, and destroying the resources if it was the last one.
+ */
+void verbs_destroy(uint32_t node_id);
 
 }  // namespace sst
 
@@ -107,6 +107,20 @@ public:
         initialize();
     }
 
+    /**
+     * A run of consecutive slots, starting at a given multicast index, that
+     * are sent as a single message: only the first bytes_to_push bytes of the
+     * first slot are pushed, and the remaining slots in the run are skipped.
+     * Receivers learn the length of the run from the message itself. A run of
+     * one slot is a message, such as a coalesced batch, that only fills part
+     * of its slot.
+     */
+    struct slot_run {
+        int32_t first_index;
+        uint32_t num_slots;
+        uint64_t bytes_to_push;
+    };
+
     volatile uint8_t* get_buffer(uint64_t msg_size) {
         assert(my_sender_index >= 0);
         std::lock_guard<std::mutex> lock(msg_send_mutex);
@@ -172,6 +186,53 @@ public:
              first_null_index, header_size);
     }
 
+    /**
+     * A version of send() for when the committed messages include runs of
+     * slots sent as a single message (see slot_run). Contiguous ordinary
+     * slots are still pushed together.
+     * @param committed_index The index returned by commit_send()
+     * @param ready_to_be_sent The number of indices committed by that call
+     * @param runs The runs within the committed indices, in increasing order
+     * of first_index
+     */
+    void send(uint32_t committed_index, uint32_t ready_to_be_sent, const std::vector<slot_run>& runs) {
+        int32_t next_index = committed_index - ready_to_be_sent + 1;
+        auto next_run = runs.begin();
+        uint32_t push_start_slot = 0;
+        uint64_t size_to_push = 0;
+        auto push = [&]() {
+            if(size_to_push > 0) {
+                sst->put((uint8_t*)std::addressof(sst->slots[0][slots_offset + max_msg_size * push_start_slot]) - sst->getBaseAddress(),
+                         size_to_push);
+                size_to_push = 0;
+            }
+        };
+        while(next_index <= static_cast<int32_t>(committed_index)) {
+            uint32_t slot = next_index % window_size;
+            // Slots can only be pushed together if they are adjacent in the ring
+            if(slot == 0) {
+                push();
+            }
+            if(size_to_push == 0) {
+                push_start_slot = slot;
+            }
+            if(next_run != runs.end() && next_run->first_index == next_index) {
+                size_to_push += next_run->bytes_to_push;
+                next_index += next_run->num_slots;
+                // The rest of the run is skipped, so the next slot is not adjacent
+                if(next_run->num_slots > 1 || next_run->bytes_to_push < max_msg_size) {
+                    push();
+                }
+                ++next_run;
+            } else {
+                size_to_push += max_msg_size;
+                ++next_index;
+            }
+        }
+        push();
+        sst->put(sst->index, index_offset);
+    }
+
     void debug_print() {
         using std::cout;
         using std::endl;
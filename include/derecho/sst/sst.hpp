@@ -2,6 +2,7 @@
 
 #include "derecho/conf/conf.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 #include "predicates.hpp"
 
 #ifdef USE_VERBS_API
@@ -170,7 +171,8 @@ private:
     void init_SSTFields(Fields&... fields) {
         rowLen = 0;
         compute_rowLen(rowLen, fields...);
-        void* mem_ptr = new uint8_t[rowLen * num_members];
+        //Rows are registered with the NIC, so place them on its NUMA node if configured to
+        void* mem_ptr = derecho::allocate_registered_buffer(rowLen * num_members);
         memset(mem_ptr, 0, rowLen * num_members);
         rows = (volatile uint8_t*)mem_ptr;
         // snapshot = new uint8_t[rowLen * num_members];
@@ -291,10 +293,10 @@ public:
                 }
 #ifdef USE_VERBS_API
                 res_vec[sst_index] = std::make_unique<resources>(
-                        node_rank, write_addr, read_addr, rowLen, rowLen);
+                        my_node_id, node_rank, write_addr, read_addr, rowLen, rowLen);
 #else  // use libfabric api by default
                 res_vec[sst_index] = std::make_unique<resources>(
-                        node_rank, write_addr, read_addr, rowLen, rowLen, (my_node_id < node_rank));
+                        my_node_id, node_rank, write_addr, read_addr, rowLen, rowLen, (my_node_id < node_rank));
 #endif
                 // update qp_num_to_index
                 // qp_num_to_index[res_vec[sst_index].get()->qp->qp_num] = sst_index;
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace derecho {
+
+/**
+ * Parses the value of the NUMA/thread_cpus option, which has the form
+ * "role:cpu_list;role:cpu_list" with Linux-style CPU lists such as
+ * "0-3,8,10-11".
+ * @param thread_cpus_option The value of the option
+ * @return A map from thread role to the CPUs that role is pinned to
+ * @throws std::logic_error if the option is malformed
+ */
+std::map<std::string, std::vector<int>> parse_thread_cpus(const std::string& thread_cpus_option);
+
+/**
+ * Pins the calling thread to the CPUs configured for its role in the
+ * NUMA/thread_cpus option, or to the CPUs of the NIC's NUMA node if
+ * NUMA/pin_to_nic_node is enabled and the role has no explicit CPU list.
+ * Does nothing if neither applies. The resulting placement is recorded so
+ * that it can be included in the placement report.
+ * @param role The role of the calling thread; by convention, this is the same
+ * name the thread gives itself with pthread_setname_np (e.g. "sst_detect").
+ */
+void pin_thread(const std::string& role);
+
+/**
+ * @return The NUMA node the configured RDMA NIC (RDMA/domain) is attached to,
+ * either as configured in NUMA/nic_node or as reported by sysfs; -1 if it is
+ * unknown or the host is not a NUMA system.
+ */
+int get_nic_numa_node();
+
+/**
+ * Logs the NIC's NUMA node, the buffer allocation policy, and the CPU
+ * placement of every thread that has called pin_thread() so far.
+ */
+void log_placement_report();
+
+/**
+ * Allocates a buffer to be registered with the NIC. Like new[], it does not
+ * clear the buffer; callers that need zeroes must write them. If
+ * RDMA/huge_pages is enabled, the buffer is backed by huge pages; buffers
+ * smaller than a huge page are sliced out of a shared pool. If
+ * NUMA/bind_buffers is enabled and the NIC's NUMA node is known, the memory
+ * is bound to that node before it is first touched. Otherwise this is an
+ * ordinary heap allocation.
+ * @param size The size of the buffer in bytes
+ * @return A pointer to the buffer, which must be released with free_registered_buffer
+ */
+uint8_t* allocate_registered_buffer(std::size_t size);
+
+/**
+ * Releases a buffer returned by allocate_registered_buffer.
+ * @param buffer The buffer to release
+ * @param size The size it was allocated with
+ */
+void free_registered_buffer(uint8_t* buffer, std::size_t size);
+
+/**
+ * A unique_ptr deleter for buffers returned by allocate_registered_buffer,
+ * which remembers the allocation size needed to release them. A deleter with
+ * owned = false does nothing, for pointers that borrow memory owned elsewhere.
+ */
+struct registered_buffer_deleter {
+    std::size_t size = 0;
+    bool owned = true;
+    void operator()(uint8_t* buffer) const {
+        if(owned) {
+            free_registered_buffer(buffer, size);
+        }
+    }
+    void operator()(volatile uint8_t* buffer) const {
+        if(owned) {
+            free_registered_buffer(const_cast<uint8_t*>(buffer), size);
+        }
+    }
+};
+
+using registered_buffer_ptr = std::unique_ptr<uint8_t[], registered_buffer_deleter>;
+/** An owning pointer to a registered buffer that is written remotely, and must be read as volatile. */
+using volatile_registered_buffer_ptr = std::unique_ptr<volatile uint8_t[], registered_buffer_deleter>;
+
+/**
+ * Convenience wrapper around allocate_registered_buffer that returns an owning pointer.
+ */
+inline registered_buffer_ptr make_registered_buffer(std::size_t size) {
+    return registered_buffer_ptr(allocate_registered_buffer(size), registered_buffer_deleter{size});
+}
+
+inline volatile_registered_buffer_ptr make_volatile_registered_buffer(std::size_t size) {
+    return volatile_registered_buffer_ptr(allocate_registered_buffer(size), registered_buffer_deleter{size});
+}
+
+}  // namespace derecho
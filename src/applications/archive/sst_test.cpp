@@ -54,7 +54,7 @@ int main() {
     int b = 5 + my_rank;
     sst.a(my_rank, b);
     sst.put();
-    sst::sync(1 - my_rank);
+    sst::sync(my_rank, 1 - my_rank);
     int n;
     cin >> n;
     for(uint i = 0; i < num_nodes; ++i) {
@@ -68,9 +68,9 @@ int main() {
 
     // create the rdma struct for exchanging data
 #ifdef USE_VERBS_API
-    resources *res = new resources(r_index, read_buf, write_buf, ROWSIZE, ROWSIZE);
+    resources *res = new resources(node_rank, r_index, read_buf, write_buf, ROWSIZE, ROWSIZE);
 #else
-    resources *res = new resources(r_index, read_buf, write_buf, ROWSIZE, ROWSIZE, node_rank < r_index);
+    resources *res = new resources(node_rank, r_index, read_buf, write_buf, ROWSIZE, ROWSIZE, node_rank < r_index);
 #endif
 
     const auto tid = std::this_thread::get_id();
@@ -92,7 +92,7 @@ int main() {
       auto ce =  util::polling_data.get_completion_entry(tid,r_index);
       if (ce) break;
     }
-    sync(r_index);
+    sync(node_rank, r_index);
 
     cout << "Buffer written by remote side is : " << read_buf << endl;
 
@@ -103,7 +103,7 @@ int main() {
 
     cout << "write buffer is " << write_buf << endl;
 
-    sync(r_index);
+    sync(node_rank, r_index);
     cout << "Buffer written by remote side is : " << read_buf << endl;
 
     // // destroy resources
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <derecho/core/derecho.hpp>
+#include <derecho/core/kv_store.hpp>
+
+#include "partial_senders_allocator.hpp"
+
+using std::cout;
+using std::endl;
+using namespace persistent;
+using namespace std::chrono;
+
+/**
+ * Measures the throughput of ordered puts to a KVStore, issued by every member
+ * of the subgroup, then the latency of P2P gets and versioned gets sent to
+ * another member.
+ */
+
+#define DEFAULT_PROC_NAME "kv_store_bench"
+
+static std::string make_key(uint64_t key_num) {
+    return "key" + std::to_string(key_num);
+}
+
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 5) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "Usage: " << argv[0] << " [<derecho config options> -- ] <num_of_nodes> <num_keys> <value_size> <num_ops> [proc_name]" << endl;
+        cout << "Note: each node issues num_ops puts, then num_ops gets and num_ops versioned gets" << endl;
+        cout << "Note: proc_name sets the process's name as displayed in ps and pkill commands, default is " DEFAULT_PROC_NAME << endl;
+        return -1;
+    }
+    const int num_of_nodes = atoi(argv[dashdash_pos + 1]);
+    const uint64_t num_keys = std::stoull(argv[dashdash_pos + 2]);
+    const std::size_t value_size = std::stoull(argv[dashdash_pos + 3]);
+    const int num_ops = atoi(argv[dashdash_pos + 4]);
+
+    if((argc - dashdash_pos) > 5) {
+        pthread_setname_np(pthread_self(), argv[dashdash_pos + 5]);
+    } else {
+        pthread_setname_np(pthread_self(), DEFAULT_PROC_NAME);
+    }
+
+    derecho::Conf::initialize(argc, argv);
+
+    const long total_num_ops = static_cast<long>(num_of_nodes) * num_ops;
+    steady_clock::time_point begin_time, send_complete_time, persist_complete_time;
+    std::atomic<bool> done = false;
+    persistent::version_t last_version;
+    std::atomic<bool> last_version_set = false;
+
+    auto stability_callback = [&last_version,
+                               &last_version_set,
+                               &send_complete_time,
+                               total_num_ops,
+                               num_delivered = 0l](uint32_t subgroup,
+                                                   uint32_t sender_id,
+                                                   long long int index,
+                                                   std::optional<std::pair<uint8_t*, long long int>> data,
+                                                   persistent::version_t ver) mutable {
+        if(++num_delivered == total_num_ops) {
+            send_complete_time = steady_clock::now();
+            last_version = ver;
+            last_version_set = true;
+        }
+    };
+    auto persistence_callback = [&](derecho::subgroup_id_t subgroup, persistent::version_t ver) {
+        if(last_version_set && ver >= last_version && !done) {
+            persist_complete_time = steady_clock::now();
+            done = true;
+        }
+    };
+    derecho::UserMessageCallbacks callback_set{
+            stability_callback,
+            nullptr,
+            persistence_callback};
+
+    derecho::SubgroupInfo subgroup_info(PartialSendersAllocator(num_of_nodes, PartialSendMode::ALL_SENDERS));
+    auto kv_factory = [](PersistentRegistry* pr, derecho::subgroup_id_t) { return std::make_unique<derecho::KVStore>(pr); };
+    derecho::Group<derecho::KVStore> group{callback_set, subgroup_info, {}, std::vector<derecho::view_upcall_t>{}, kv_factory};
+
+    cout << "Finished constructing/joining Group" << endl;
+    derecho::Replicated<derecho::KVStore>& handle = group.get_subgroup<derecho::KVStore>();
+    const std::vector<derecho::node_id_t> members = group.get_members();
+    const uint32_t node_rank = group.get_my_rank();
+
+    //Generate the keys before starting the timer, and give each node its own sequence of keys
+    std::mt19937_64 random(node_rank);
+    std::uniform_int_distribution<uint64_t> key_distribution(0, num_keys - 1);
+    std::vector<std::string> keys(num_ops);
+    for(auto& key : keys) {
+        key = make_key(key_distribution(random));
+    }
+    std::vector<uint8_t> value_buf(value_size, static_cast<uint8_t>(node_rank));
+    const derecho::Bytes value(value_buf.data(), value_size);
+
+    begin_time = steady_clock::now();
+    for(int i = 0; i < num_ops; i++) {
+        handle.ordered_send<RPC_NAME(put)>(keys[i], value);
+    }
+    while(!done) {
+    }
+    const double send_sec = duration_cast<nanoseconds>(send_complete_time - begin_time).count() / 1e9;
+    const double persist_sec = duration_cast<nanoseconds>(persist_complete_time - begin_time).count() / 1e9;
+    cout << "(put)delivered: " << total_num_ops / send_sec << " ops/s, "
+         << total_num_ops * value_size / send_sec / 1e6 << " MB/s" << endl;
+    cout << "(put)persisted: " << total_num_ops / persist_sec << " ops/s" << endl;
+
+    //Read from the next member, so that the reads cross the network
+    const derecho::node_id_t other_node = members[(node_rank + 1) % members.size()];
+    const auto measure = [&](const char* name, const auto& read) {
+        std::vector<uint64_t> latencies_ns(num_ops);
+        std::size_t bytes_read = 0;
+        for(int i = 0; i < num_ops; i++) {
+            steady_clock::time_point start = steady_clock::now();
+            bytes_read += read(keys[i]).size();
+            latencies_ns[i] = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        }
+        std::sort(latencies_ns.begin(), latencies_ns.end());
+        uint64_t total_ns = 0;
+        for(uint64_t latency : latencies_ns) {
+            total_ns += latency;
+        }
+        cout << "(" << name << ")latency: mean " << total_ns / 1000.0 / num_ops << " us, median "
+             << latencies_ns[num_ops / 2] / 1000.0 << " us, p99 "
+             << latencies_ns[num_ops * 99 / 100] / 1000.0 << " us, read " << bytes_read << " bytes" << endl;
+    };
+    measure("get", [&](const std::string& key) {
+        return handle.p2p_send<RPC_NAME(get)>(other_node, key).get().get(other_node);
+    });
+    measure("get_by_version", [&](const std::string& key) {
+        return handle.p2p_send<RPC_NAME(get_by_version)>(other_node, key, last_version).get().get(other_node);
+    });
+    cout << std::flush;
+
+    group.barrier_sync();
+    group.leave();
+}
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+
+#include <derecho/core/derecho.hpp>
+
+#include "bytes_object.hpp"
+
+using std::cout;
+using std::endl;
+using namespace persistent;
+
+/**
+ * Replays an RPC trace recorded by a member of the subgroup of
+ * persistent_bw_test (run it with DERECHO/rpc_trace_path set) against a
+ * standalone ByteArrayObject, and reports the cost of each RPC function.
+ */
+class ByteArrayObject : public mutils::ByteRepresentable, public derecho::PersistsFields {
+public:
+    Persistent<test::Bytes> pers_bytes;
+
+    void change_pers_bytes(const test::Bytes& bytes) {
+        *pers_bytes = bytes;
+    }
+
+    // deserialization constructor
+    ByteArrayObject(Persistent<test::Bytes>& _p_bytes) : pers_bytes(std::move(_p_bytes)) {}
+    // default constructor
+    ByteArrayObject(PersistentRegistry* pr)
+            : pers_bytes(pr) {}
+
+    REGISTER_RPC_FUNCTIONS(ByteArrayObject, ORDERED_TARGETS(change_pers_bytes));
+    DEFAULT_SERIALIZATION_SUPPORT(ByteArrayObject, pers_bytes);
+};
+
+int main(int argc, char* argv[]) {
+    int dashdash_pos = argc - 1;
+    while(dashdash_pos > 0) {
+        if(strcmp(argv[dashdash_pos], "--") == 0) {
+            break;
+        }
+        dashdash_pos--;
+    }
+
+    if((argc - dashdash_pos) < 2) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "Usage: " << argv[0] << " [<derecho config options> -- ] <trace_file> [persist_interval]" << endl;
+        cout << "Note: persist_interval is the number of versions between two calls to persist, default is 1; 0 disables persisting" << endl;
+        return -1;
+    }
+    const std::string trace_file(argv[dashdash_pos + 1]);
+    const uint32_t persist_interval = (argc - dashdash_pos) > 2 ? std::stoul(argv[dashdash_pos + 2]) : 1;
+
+    derecho::Conf::initialize(argc, argv);
+
+    const std::map<derecho::rpc::FunctionTag, std::string> function_names = {
+            {derecho::rpc::to_internal_tag<false>(derecho::rpc::hash_cstr("change_pers_bytes")), "change_pers_bytes"}};
+
+    derecho::rpc::RPCTraceReader reader(trace_file);
+    derecho::rpc::RPCTraceReplayer<ByteArrayObject> replayer(
+            [](PersistentRegistry* pr, derecho::subgroup_id_t) {
+                return std::make_unique<ByteArrayObject>(pr);
+            });
+    derecho::rpc::RPCReplayResult result = replayer.replay(reader, persist_interval);
+
+    uint64_t total_count = 0;
+    cout << std::left << std::setw(24) << "function" << std::right
+         << std::setw(12) << "count" << std::setw(14) << "handler(us)" << std::setw(14) << "max(us)"
+         << std::setw(14) << "version(us)" << std::setw(12) << "MB/s" << endl;
+    for(const auto& [tag, stats] : result.functions) {
+        auto name = function_names.find(tag);
+        cout << std::left << std::setw(24) << (name != function_names.end() ? name->second : std::to_string(tag))
+             << std::right << std::fixed << std::setprecision(3)
+             << std::setw(12) << stats.count
+             << std::setw(14) << static_cast<double>(stats.handler_ns) / stats.count / 1000.0
+             << std::setw(14) << static_cast<double>(stats.max_handler_ns) / 1000.0
+             << std::setw(14) << static_cast<double>(stats.version_ns) / stats.count / 1000.0
+             << std::setw(12) << static_cast<double>(stats.bytes) * 1000.0 / (stats.handler_ns + stats.version_ns)
+             << endl;
+        total_count += stats.count;
+    }
+    if(result.persist_count > 0) {
+        cout << "persist: " << result.persist_count << " calls, "
+             << static_cast<double>(result.persist_ns) / result.persist_count / 1000.0 << " us per call" << endl;
+    }
+    cout << "replayed " << total_count << " messages in " << static_cast<double>(result.total_ns) / 1e6 << " ms ("
+         << (result.total_ns > 0 ? total_count * 1e9 / result.total_ns : 0) << " messages/s)" << endl;
+    if(result.gap_version != INVALID_VERSION) {
+        cout << "The replay stopped at a gap in the trace: messages from version " << result.gap_version
+             << " on were dropped while recording." << endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <derecho/core/shard_router.hpp>
+
+using std::cout;
+using std::endl;
+using namespace std::chrono;
+
+/**
+ * Measures the cost of routing keys with a ShardRouter, one at a time and in
+ * batches, and of updating it when a shard is added or a member changes. It
+ * does not need a Group, since the router only depends on the shard members.
+ */
+int main(int argc, char* argv[]) {
+    if(argc < 5) {
+        cout << "Usage: " << argv[0] << " <num_shards> <shard_size> <num_keys> <key_size> [batch_size] [virtual_nodes]" << endl;
+        return -1;
+    }
+    const uint32_t num_shards = std::stoul(argv[1]);
+    const uint32_t shard_size = std::stoul(argv[2]);
+    const std::size_t num_keys = std::stoull(argv[3]);
+    const std::size_t key_size = std::stoull(argv[4]);
+    const std::size_t batch_size = argc > 5 ? std::stoull(argv[5]) : 64;
+    const uint32_t virtual_nodes = argc > 6 ? std::stoul(argv[6]) : derecho::ShardRouter::DEFAULT_VIRTUAL_NODES;
+
+    std::vector<std::vector<derecho::node_id_t>> shard_members(num_shards);
+    derecho::node_id_t next_node_id = 0;
+    for(auto& members : shard_members) {
+        for(uint32_t i = 0; i < shard_size; ++i) {
+            members.push_back(next_node_id++);
+        }
+    }
+    derecho::ShardRouter router(virtual_nodes);
+    steady_clock::time_point start = steady_clock::now();
+    router.update(shard_members);
+    cout << "initial update: " << duration_cast<microseconds>(steady_clock::now() - start).count() << " us" << endl;
+
+    std::mt19937_64 random(0);
+    std::vector<std::string> keys(num_keys);
+    for(auto& key : keys) {
+        key = std::to_string(random());
+        key.resize(key_size, 'k');
+    }
+    const std::vector<std::string_view> key_views(keys.begin(), keys.end());
+
+    uint64_t checksum = 0;
+    start = steady_clock::now();
+    for(const auto& key : key_views) {
+        checksum += router.route(key).node_id;
+    }
+    const double single_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    cout << "route: " << single_ns / num_keys << " ns/key" << endl;
+
+    derecho::ShardRouter::BatchRoutes routes;
+    start = steady_clock::now();
+    for(std::size_t first = 0; first < num_keys; first += batch_size) {
+        router.route_batch(key_views.data() + first, std::min(batch_size, num_keys - first), routes);
+        checksum += routes.nodes.size();
+    }
+    const double batch_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    cout << "route_batch(" << batch_size << "): " << batch_ns / num_keys << " ns/key" << endl;
+
+    std::vector<uint64_t> hashes(num_keys);
+    start = steady_clock::now();
+    derecho::ShardRouter::hash_keys(key_views.data(), num_keys, hashes.data());
+    const double hash_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    cout << "hash_keys: " << hash_ns / num_keys << " ns/key" << endl;
+
+    std::vector<uint32_t> old_shards(num_keys);
+    for(std::size_t i = 0; i < num_keys; ++i) {
+        old_shards[i] = router.get_shard(key_views[i]);
+    }
+    shard_members.emplace_back();
+    for(uint32_t i = 0; i < shard_size; ++i) {
+        shard_members.back().push_back(next_node_id++);
+    }
+    start = steady_clock::now();
+    router.update(shard_members);
+    cout << "update adding a shard: " << duration_cast<microseconds>(steady_clock::now() - start).count() << " us" << endl;
+    std::size_t moved = 0;
+    for(std::size_t i = 0; i < num_keys; ++i) {
+        moved += router.get_shard(key_views[i]) != old_shards[i];
+    }
+    cout << "keys moved: " << moved * 100.0 / num_keys << "% (ideal " << 100.0 / (num_shards + 1) << "%)" << endl;
+
+    shard_members[0].back() = next_node_id++;
+    start = steady_clock::now();
+    router.update(shard_members);
+    cout << "update replacing a member: " << duration_cast<microseconds>(steady_clock::now() - start).count() << " us" << endl;
+    cout << "(checksum " << checksum << ")" << endl;
+    return 0;
+}
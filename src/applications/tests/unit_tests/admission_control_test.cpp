@@ -0,0 +1,128 @@
+#include <derecho/core/detail/admission_control.hpp>
+#include <derecho/utils/time.h>
+
+#include <string>
+
+#include "unit_test_checks.hpp"
+
+using derecho::LatencyAdmissionController;
+using derecho::send_admission;
+using derecho::SendAdmissionControl;
+using derecho::TokenBucket;
+using unit_test::check;
+
+/**
+ * Tests the building blocks of send rate limiting and admission control
+ * without a Group: the refill and burst limit of TokenBucket, and the CoDel
+ * drop decision of LatencyAdmissionController, both driven by explicit
+ * timestamps, plus the token accounting of SendAdmissionControl with a rate
+ * low enough that the real clock cannot refill a token during the test.
+ */
+
+constexpr uint64_t MS = 1000000;
+
+/** @return The number of tokens try_consume() takes at now_ns, trying at most max_tries times */
+static int consume_all(TokenBucket& bucket, uint64_t now_ns, int max_tries = 10000) {
+    int num_consumed = 0;
+    while(num_consumed < max_tries && bucket.try_consume(now_ns)) {
+        num_consumed++;
+    }
+    return num_consumed;
+}
+
+static void test_token_bucket() {
+    TokenBucket unlimited(0, 4);
+    const uint64_t start = get_time();
+    check(unlimited.unlimited() && consume_all(unlimited, start) == 10000, "a rate of 0 is unlimited");
+    check(unlimited.time_until_token(start) == 0, "an unlimited bucket never waits");
+
+    // One token per millisecond, with a burst of 5
+    TokenBucket bucket(1000, 5);
+    const uint64_t t0 = get_time();
+    check(consume_all(bucket, t0) == 5, "a full bucket allows a burst of its capacity");
+    const uint64_t wait = bucket.time_until_token(t0);
+    check(wait >= MS - 1 && wait <= MS + 1, "an empty bucket waits one refill period for a token");
+    check(!bucket.try_consume(t0 + MS / 2), "half a refill period does not make a token");
+    check(consume_all(bucket, t0 + 5 * MS / 2) == 2, "tokens refill at the configured rate");
+    check(bucket.time_until_token(t0 + 5 * MS / 2) <= MS / 2 + 1, "a partial token shortens the wait");
+    check(consume_all(bucket, t0 + 1000 * MS) == 5, "refilling stops at the burst size");
+    // An earlier timestamp must not refill the bucket again
+    check(!bucket.try_consume(t0 + 999 * MS), "time going backwards does not add tokens");
+
+    bucket.refund();
+    check(consume_all(bucket, t0 + 1000 * MS) == 1, "a refunded token can be taken again");
+    for(int i = 0; i < 10; ++i) {
+        bucket.refund();
+    }
+    check(consume_all(bucket, t0 + 1000 * MS) == 5, "refunds do not overfill the bucket");
+
+    TokenBucket tiny_burst(1000, 0);
+    check(consume_all(tiny_burst, get_time()) == 1, "the burst size is at least 1");
+}
+
+static void test_admission_controller() {
+    LatencyAdmissionController disabled(0, 1000);
+    disabled.record_sojourn(1000 * MS, 1);
+    disabled.record_sojourn(1000 * MS, 100 * MS);
+    check(!disabled.enabled() && disabled.try_admit(100 * MS), "a target of 0 disables the controller");
+
+    // A 100us target and a 1ms interval
+    const uint64_t t = 1000 * MS;
+    LatencyAdmissionController controller(100, 1000);
+    controller.record_sojourn(MS / 5, t);
+    controller.record_sojourn(MS / 5, t + MS / 2);
+    check(controller.try_admit(t + MS / 2) && controller.try_admit(t + MS / 2),
+          "latency above target for less than an interval does not pace sends");
+    controller.record_sojourn(MS / 20, t + 3 * MS / 4);
+    controller.record_sojourn(MS / 5, t + MS);
+    controller.record_sojourn(MS / 5, t + 3 * MS / 2);
+    check(controller.time_until_admit(t + 3 * MS / 2) == 0,
+          "a delivery within the target restarts the interval");
+
+    // Above target from t + MS, so pacing starts at t + 2 * MS with the first slot one interval later
+    controller.record_sojourn(MS / 5, t + 2 * MS);
+    check(controller.time_until_admit(t + 2 * MS) == MS, "pacing starts after a whole interval above target");
+    check(!controller.try_admit(t + 5 * MS / 2), "a send before the next pacing slot is dropped");
+    check(controller.try_admit(t + 3 * MS), "a send at the pacing slot is admitted");
+    check(!controller.try_admit(t + 3 * MS), "each pacing slot admits one send");
+    controller.cancel_admit();
+    check(controller.time_until_admit(t + 3 * MS) == 0, "cancel_admit gives back the pacing slot");
+    check(controller.try_admit(t + 3 * MS), "a send at a given-back pacing slot is admitted");
+    // The control law spaces the following slots interval / sqrt(n) apart
+    const uint64_t second_gap = controller.time_until_admit(t + 3 * MS);
+    check(second_gap >= 707106 && second_gap <= 707107, "the second gap is interval / sqrt(2)");
+    check(controller.try_admit(t + 3 * MS + second_gap), "a send at the second pacing slot is admitted");
+    const uint64_t third_gap = controller.time_until_admit(t + 3 * MS + second_gap);
+    check(third_gap >= 577349 && third_gap <= 577351, "the third gap is interval / sqrt(3)");
+    // New samples above target while pacing do not reset the schedule
+    controller.record_sojourn(MS / 5, t + 3 * MS + second_gap);
+    check(controller.time_until_admit(t + 3 * MS + second_gap) == third_gap, "pacing continues while latency stays high");
+
+    controller.record_sojourn(MS / 20, t + 4 * MS);
+    check(controller.try_admit(t + 4 * MS) && controller.try_admit(t + 4 * MS),
+          "a delivery within the target stops pacing");
+}
+
+static void test_send_admission_control() {
+    SendAdmissionControl unrestricted(0, 0, 16, 0, 100000, 3);
+    check(unrestricted.unrestricted() && unrestricted.try_admit() == send_admission::ADMITTED,
+          "no limits and no target admit every send");
+
+    // The subgroup limit of 3 per second is shared by 3 senders, so the per-sender limit of 100 does not apply
+    SendAdmissionControl limited(3, 100, 2, 0, 100000, 3);
+    check(!limited.unrestricted(), "a rate limit restricts sends");
+    check(limited.try_admit() == send_admission::ADMITTED && limited.try_admit() == send_admission::ADMITTED,
+          "sends up to the burst are admitted");
+    check(limited.try_admit() == send_admission::RATE_LIMITED, "a send past the burst is rate limited");
+    const uint64_t wait = limited.time_until_admit();
+    check(wait > 900 * MS && wait <= 1000 * MS, "the wait is one token at the sender's share of the subgroup rate");
+    limited.cancel_admit();
+    check(limited.try_admit() == send_admission::ADMITTED, "cancel_admit returns the token");
+}
+
+int main(int argc, char** argv) {
+    test_token_bucket();
+    test_admission_controller();
+    test_send_admission_control();
+    return unit_test::report_result();
+}
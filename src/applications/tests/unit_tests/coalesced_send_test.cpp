@@ -0,0 +1,137 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace derecho;
+using std::cout;
+using std::endl;
+
+/**
+ * Tests sender-side coalescing of small multicasts: every member sends a
+ * burst of small messages of varying sizes to one raw subgroup, fast enough
+ * that they are packed into shared SST slots, and checks that each message is
+ * still delivered on its own, with its own size, contents and message index,
+ * and in the order it was sent. Coalescing must be enabled in the
+ * configuration, e.g. with SUBGROUP/DEFAULT/coalesce_max_bytes.
+ *
+ * If slow_delivery_us is nonzero, the member with rank 0 sleeps that long in
+ * every delivery upcall. Its deliveries then hold back every sender's window,
+ * so batches fill up, and the SST slots wrap around many times while most of
+ * the messages in a batch are still waiting to be delivered. Receivers
+ * deliver a batch's messages straight from its slot, so this checks that the
+ * slot is not reused before the last of them is delivered.
+ */
+
+/** The size of a sender's i-th message, which varies so batch boundaries are checked */
+static uint32_t message_size(uint32_t counter) {
+    return sizeof(uint32_t) + counter % 13;
+}
+
+int main(int argc, char** argv) {
+    const int num_args = 3;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_msgs slow_delivery_us" << endl;
+        return -1;
+    }
+    Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[argc - num_args]);
+    const uint32_t num_msgs = std::stoi(argv[argc - num_args + 1]);
+    const uint32_t slow_delivery_us = std::stoi(argv[argc - num_args + 2]);
+    if((!hasCustomizedConfKey(Conf::SUBGROUP_DEFAULT_COALESCE_MAX_BYTES)
+        || getConfUInt32(Conf::SUBGROUP_DEFAULT_COALESCE_MAX_BYTES) == 0)
+       && (!hasCustomizedConfKey(Conf::SUBGROUP_DEFAULT_COALESCE_LINGER_US)
+           || getConfUInt32(Conf::SUBGROUP_DEFAULT_COALESCE_LINGER_US) == 0)) {
+        cout << "This test needs " << Conf::SUBGROUP_DEFAULT_COALESCE_MAX_BYTES << " or "
+             << Conf::SUBGROUP_DEFAULT_COALESCE_LINGER_US << " to be set to a nonzero value" << endl;
+        return -1;
+    }
+
+    SubgroupInfo subgroup_info([num_nodes](const std::vector<std::type_index>& subgroup_type_order,
+                                           const std::unique_ptr<View>& prev_view, View& curr_view) {
+        if(curr_view.members.size() < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        return one_subgroup_entire_view(subgroup_type_order, prev_view, curr_view);
+    });
+
+    std::mutex delivery_mutex;
+    std::condition_variable all_delivered;
+    uint32_t num_delivered = 0;
+    bool passed = true;
+    // Set once this node's rank is known
+    std::atomic<bool> slow_receiver = false;
+    std::map<node_id_t, uint32_t> next_counter_by_sender;
+    std::map<node_id_t, message_id_t> last_index_by_sender;
+    auto delivery_callback = [&](subgroup_id_t subgroup_id, node_id_t sender_id, message_id_t index,
+                                 std::optional<std::pair<uint8_t*, long long int>> data, persistent::version_t ver) {
+        if(slow_receiver) {
+            std::this_thread::sleep_for(std::chrono::microseconds(slow_delivery_us));
+        }
+        std::lock_guard<std::mutex> lock(delivery_mutex);
+        auto [buf, size] = data.value();
+        uint32_t& expected_counter = next_counter_by_sender[sender_id];
+        uint32_t counter;
+        memcpy(&counter, buf, sizeof(counter));
+        if(counter != expected_counter) {
+            cout << "FAILED: message " << counter << " from node " << sender_id << " was delivered when "
+                 << expected_counter << " was expected" << endl;
+            passed = false;
+        } else if(size != message_size(counter)) {
+            cout << "FAILED: message " << counter << " from node " << sender_id << " was delivered with size " << size
+                 << " instead of " << message_size(counter) << endl;
+            passed = false;
+        } else {
+            for(long long int i = sizeof(counter); i < size; ++i) {
+                if(buf[i] != static_cast<uint8_t>(counter + i)) {
+                    cout << "FAILED: message " << counter << " from node " << sender_id << " has the wrong contents" << endl;
+                    passed = false;
+                    break;
+                }
+            }
+        }
+        auto last_index = last_index_by_sender.find(sender_id);
+        if(last_index != last_index_by_sender.end() && index != last_index->second + 1) {
+            cout << "FAILED: node " << sender_id << " skipped from message index " << last_index->second << " to " << index << endl;
+            passed = false;
+        }
+        last_index_by_sender[sender_id] = index;
+        expected_counter = counter + 1;
+        if(++num_delivered == num_nodes * num_msgs) {
+            all_delivered.notify_all();
+        }
+    };
+
+    Group<RawObject> group(UserMessageCallbacks{delivery_callback}, subgroup_info,
+                           std::vector<DeserializationContext*>{}, std::vector<view_upcall_t>{}, &raw_object_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    slow_receiver = slow_delivery_us > 0 && group.get_my_rank() == 0;
+    Replicated<RawObject>& group_as_subgroup = group.get_subgroup<RawObject>();
+    for(uint32_t counter = 0; counter < num_msgs; ++counter) {
+        group_as_subgroup.send(message_size(counter), [counter](uint8_t* buf) {
+            memcpy(buf, &counter, sizeof(counter));
+            for(uint32_t i = sizeof(counter); i < message_size(counter); ++i) {
+                buf[i] = static_cast<uint8_t>(counter + i);
+            }
+        });
+    }
+    {
+        std::unique_lock<std::mutex> lock(delivery_mutex);
+        all_delivered.wait(lock, [&]() { return num_delivered == num_nodes * num_msgs; });
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+
+    group.barrier_sync();
+    group.leave(true);
+    return passed ? 0 : 1;
+}
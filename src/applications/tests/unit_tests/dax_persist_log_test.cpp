@@ -0,0 +1,193 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/HLC.hpp>
+#include <derecho/persistent/detail/DaxPersistLog.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::DaxPersistLog;
+using persistent::MetaHeader;
+using persistent::version_t;
+using unit_test::check;
+
+/**
+ * Tests DaxPersistLog without a Group or persistent memory, using its tmpfs
+ * emulation in /dev/shm. Entries must survive reopening the log once they
+ * are persisted, including entries whose data wraps around the end of the
+ * data ring, and entries that were appended but not persisted must not. A
+ * crash in the middle of a meta header update is simulated by editing the
+ * meta file: a valid redo copy of the header must be replayed when the log is
+ * opened, or by getMinimumLatestPersistedVersion, and an invalid one must be
+ * ignored. The data ring is made small with PERS/max_data_size.
+ */
+
+constexpr uint64_t RING_SIZE = 64 << 10;
+const std::string LOG_DIR = "/dev/shm/dax_persist_log_test";
+/** Logs are named by subgroup prefixes followed by the field, like this one */
+const std::string LOG_PREFIX = "dax_persist_log_test_";
+const std::string LOG_NAME = LOG_PREFIX + "field";
+
+/** Entry data for a version: a pattern that depends on the version, of a size that varies with it */
+static std::vector<uint8_t> entry_data(version_t ver) {
+    std::vector<uint8_t> data(1000 + (ver * 97) % 3000);
+    for(std::size_t i = 0; i < data.size(); ++i) {
+        data[i] = static_cast<uint8_t>(ver * 31 + i);
+    }
+    return data;
+}
+
+static void append(DaxPersistLog& log, version_t ver) {
+    const std::vector<uint8_t> data = entry_data(ver);
+    log.append(data.data(), data.size(), ver, HLC(ver, 0));
+}
+
+/** @return Whether the log holds exactly the versions first to last, with the right data */
+static bool holds_versions(DaxPersistLog& log, version_t first, version_t last) {
+    if(log.getLength() != last - first + 1 || log.getEarliestVersion() != first || log.getLatestVersion() != last) {
+        return false;
+    }
+    for(version_t ver = first; ver <= last; ++ver) {
+        const std::vector<uint8_t> data = entry_data(ver);
+        const void* entry = log.getEntry(ver, true);
+        if(!entry || memcmp(entry, data.data(), data.size()) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static std::string meta_file() {
+    return LOG_DIR + "/" + LOG_NAME + "." + META_FILE_SUFFIX;
+}
+
+/** Reads the meta header and its redo copy from the meta file */
+static void read_meta(MetaHeader (&headers)[2]) {
+    int fd = open(meta_file().c_str(), O_RDONLY);
+    check(fd != -1 && pread(fd, headers, sizeof(headers), 0) == sizeof(headers), "the meta file can be read");
+    close(fd);
+}
+
+/** Overwrites the meta header and its redo copy in the meta file */
+static void write_meta(MetaHeader (&headers)[2]) {
+    int fd = open(meta_file().c_str(), O_WRONLY);
+    check(fd != -1 && pwrite(fd, headers, sizeof(headers), 0) == sizeof(headers), "the meta file can be written");
+    close(fd);
+}
+
+static uint64_t& redo_magic(MetaHeader& header) {
+    return *reinterpret_cast<uint64_t*>(header.bytes + META_HEADER_SIZE - sizeof(uint64_t));
+}
+
+static void test_append_persist_reload() {
+    {
+        DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+        for(version_t ver = 1; ver <= 10; ++ver) {
+            append(log, ver);
+        }
+        check(log.persist(10) == 10 && log.getLastPersistedVersion() == 10, "persist() reports the version it persisted");
+        append(log, 11);
+        append(log, 12);
+    }
+    DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+    check(holds_versions(log, 1, 10), "persisted entries survive reopening the log");
+    check(log.getLastPersistedVersion() == 10, "the persisted version survives reopening the log");
+    MetaHeader headers[2];
+    read_meta(headers);
+    check(redo_magic(headers[1]) == 0, "the redo copy is retired after a completed header update");
+}
+
+static void test_wrap_reload() {
+    version_t first = 1;
+    version_t last = 10;
+    {
+        DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+        // Several passes around the data ring, keeping a few entries and persisting as it goes
+        while(last < 200) {
+            append(log, ++last);
+            if(last % 7 == 0) {
+                log.persist(last);
+                first = last - 4;
+                log.trim(first - 1);
+            }
+        }
+        log.persist(last);
+    }
+    DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+    check(holds_versions(log, first, last), "entries persisted after the data ring wrapped survive reopening the log");
+}
+
+static void test_meta_redo_recovery() {
+    // Persist two states of the log, and keep the meta header of the first
+    MetaHeader old_headers[2];
+    version_t old_ver;
+    version_t new_ver;
+    {
+        DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+        old_ver = log.getLatestVersion();
+        read_meta(old_headers);
+        for(new_ver = old_ver + 1; new_ver <= old_ver + 5; ++new_ver) {
+            append(log, new_ver);
+        }
+        new_ver = log.getLatestVersion();
+        log.persist(new_ver);
+    }
+    MetaHeader new_headers[2];
+    read_meta(new_headers);
+    const version_t first = new_ver - (new_headers[0].fields.tail - new_headers[0].fields.head) + 1;
+
+    // A crash after the redo copy was written but before the header was updated
+    MetaHeader crashed[2];
+    crashed[0] = old_headers[0];
+    crashed[1] = new_headers[0];
+    redo_magic(crashed[1]) = DAX_META_REDO_MAGIC;
+    write_meta(crashed);
+    {
+        DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+        check(holds_versions(log, first, new_ver), "opening the log replays a valid redo copy of the meta header");
+    }
+    MetaHeader replayed[2];
+    read_meta(replayed);
+    check(replayed[0] == new_headers[0] && redo_magic(replayed[1]) == 0,
+          "replaying the redo copy writes it over the header and retires it");
+
+    // A crash while the redo copy was being written
+    crashed[0] = old_headers[0];
+    crashed[1] = new_headers[0];
+    redo_magic(crashed[1]) = 0;
+    write_meta(crashed);
+    {
+        DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+        check(log.getLatestVersion() == old_ver, "a redo copy that was not marked valid is ignored");
+    }
+
+    // The same crash, found by the restart logic before any log is opened
+    crashed[0] = old_headers[0];
+    crashed[1] = new_headers[0];
+    redo_magic(crashed[1]) = DAX_META_REDO_MAGIC;
+    write_meta(crashed);
+    check(DaxPersistLog::getMinimumLatestPersistedVersion(LOG_PREFIX) == static_cast<uint64_t>(new_ver),
+          "getMinimumLatestPersistedVersion replays a valid redo copy first");
+    DaxPersistLog log(LOG_NAME, LOG_DIR, false);
+    check(holds_versions(log, first, new_ver), "the log replayed by getMinimumLatestPersistedVersion opens normally");
+}
+
+int main(int argc, char** argv) {
+    std::string max_data_size = "--" + std::string(derecho::Conf::PERS_MAX_DATA_SIZE) + "=" + std::to_string(RING_SIZE);
+    std::string dax_path = "--" + std::string(derecho::Conf::PERS_DAX_PATH) + "=" + LOG_DIR;
+    std::vector<char*> conf_args = {argv[0], max_data_size.data(), dax_path.data()};
+    derecho::Conf::initialize(conf_args.size(), conf_args.data());
+
+    std::filesystem::remove_all(LOG_DIR);
+    std::filesystem::create_directories(LOG_DIR);
+    test_append_persist_reload();
+    test_wrap_reload();
+    test_meta_redo_recovery();
+    std::filesystem::remove_all(LOG_DIR);
+    return unit_test::report_result();
+}
@@ -21,7 +21,7 @@ using std::vector;
 int main(int argc, char* argv[]) {
     if(argc < 5) {
         // Print out error message
-        cout << "Usage: " << argv[0] << " <input_file_path> <num_nodes> <num_msgs> <msg_size> [configuration options...]" << endl;
+        cout << "Usage: " << argv[0] << " <input_file_path> <num_nodes> <num_msgs> <msg_size> [ordered|sequenced] [configuration options...]" << endl;
         exit(1);
     }
 
@@ -30,17 +30,35 @@ int main(int argc, char* argv[]) {
     const uint32_t num_nodes = std::stoi(argv[2]);
     const uint32_t num_msgs = std::stoi(argv[3]);
     const uint32_t msg_size = std::stoi(argv[4]);
+    // SEQUENCED mode delivers in the order the shard leader picks instead of round-robin,
+    // so the global ordering check below is what shows that every member agrees on it
+    Mode delivery_mode = Mode::ORDERED;
+    if(argc > 5 && argv[5][0] != '-') {
+        const string mode_name = argv[5];
+        if(mode_name == "sequenced") {
+            delivery_mode = Mode::SEQUENCED;
+        } else if(mode_name != "ordered") {
+            cout << "Unknown delivery mode " << mode_name << ", expected ordered or sequenced" << endl;
+            exit(1);
+        }
+    }
 
     Conf::initialize(argc, argv);
 
     uint32_t node_id = derecho::getConfUInt32(Conf::DERECHO_LOCAL_ID);
 
-    SubgroupInfo subgroup_info([num_nodes](const std::vector<std::type_index>& subgroup_type_order,
-                                           const std::unique_ptr<derecho::View>& prev_view, derecho::View& curr_view) {
+    SubgroupInfo subgroup_info([num_nodes, delivery_mode](const std::vector<std::type_index>& subgroup_type_order,
+                                                          const std::unique_ptr<derecho::View>& prev_view, derecho::View& curr_view) {
         if(curr_view.members.size() < num_nodes) {
             throw subgroup_provisioning_exception();
         }
-        return one_subgroup_entire_view(subgroup_type_order, prev_view, curr_view);
+        subgroup_allocation_map_t subgroup_layouts;
+        for(const auto& subgroup_type : subgroup_type_order) {
+            subgroup_layouts.emplace(subgroup_type, subgroup_shard_layout_t{1});
+            subgroup_layouts[subgroup_type][0].emplace_back(curr_view.make_subview(curr_view.members, delivery_mode));
+            curr_view.next_unassigned_rank = curr_view.members.size();
+        }
+        return subgroup_layouts;
     });
 
     auto get_next_line = [&input_file_map](node_id_t sender_id) {
@@ -167,7 +185,7 @@ int main(int argc, char* argv[]) {
     while(!done) {
     }
     if(my_rank == 0) {
-        cout << "Global ordering test successful!" << endl;
+        cout << "Global ordering test successful" << (delivery_mode == Mode::SEQUENCED ? " in SEQUENCED mode!" : "!") << endl;
     }
     group->barrier_sync();
     group->leave();
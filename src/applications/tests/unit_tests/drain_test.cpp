@@ -0,0 +1,136 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace derecho;
+using std::cout;
+using std::endl;
+using namespace std::chrono_literals;
+
+/**
+ * Tests a planned leave with Group::drain() in a group of two nodes that
+ * share one ORDERED raw subgroup. The node with rank 1 queues a stream of
+ * messages with send_async() and drains right away, while most of them are
+ * still queued or in flight, and then leaves. It checks that drain() reports
+ * that the other node caught up within the timeout and that every queued
+ * message was sent. The node with rank 0 waits for the view that removes the
+ * leaving node and checks that it delivered every one of its messages exactly
+ * once and in order, so the ragged edge cleanup of the leave had nothing to
+ * discard.
+ */
+
+constexpr uint32_t num_nodes = 2;
+/** How long the leaving node waits for the other node to catch up */
+constexpr auto drain_timeout = 60s;
+
+int main(int argc, char** argv) {
+    const int num_args = 1;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_msgs" << endl;
+        return -1;
+    }
+    Conf::initialize(argc, argv);
+    const uint32_t num_msgs = std::stoi(argv[argc - num_args]);
+
+    // The group must stay provisioned after the leaving node is gone
+    SubgroupInfo subgroup_info([](const std::vector<std::type_index>& subgroup_type_order,
+                                  const std::unique_ptr<View>& prev_view, View& curr_view) {
+        if(!prev_view && curr_view.members.size() < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        return one_subgroup_entire_view(subgroup_type_order, prev_view, curr_view);
+    });
+
+    std::mutex test_mutex;
+    std::condition_variable view_changed;
+    bool passed = true;
+    std::atomic<node_id_t> leaver_id = 0;
+    // The counters in the leaving node's messages, in delivery order
+    std::vector<uint32_t> delivered_counters;
+    bool leave_view_installed = false;
+
+    UserMessageCallbacks callbacks;
+    callbacks.global_stability_callback = [&](subgroup_id_t subgroup_num, node_id_t sender, message_id_t index,
+                                              std::optional<std::pair<uint8_t*, long long int>> data,
+                                              persistent::version_t version) {
+        if(sender != leaver_id || !data) {
+            return;
+        }
+        uint32_t counter;
+        memcpy(&counter, data->first, sizeof(counter));
+        std::lock_guard<std::mutex> lock(test_mutex);
+        delivered_counters.push_back(counter);
+    };
+    auto view_upcall = [&](const View& view) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        if(view.members.size() < num_nodes) {
+            leave_view_installed = true;
+            view_changed.notify_all();
+        }
+    };
+
+    Group<RawObject> group(callbacks, subgroup_info, std::vector<DeserializationContext*>{},
+                           std::vector<view_upcall_t>{view_upcall}, &raw_object_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    leaver_id = group.get_members().back();
+    const int32_t my_rank = group.get_my_rank();
+    Replicated<RawObject>& group_as_subgroup = group.get_subgroup<RawObject>();
+    // Both nodes must have set leaver_id before any message is delivered
+    group.barrier_sync();
+
+    if(my_rank == 1) {
+        std::atomic<uint32_t> num_sent = 0;
+        std::atomic<uint32_t> num_dropped = 0;
+        for(uint32_t counter = 0; counter < num_msgs; ++counter) {
+            // Retry while the send queue is full
+            while(!group_as_subgroup.send_async(
+                    sizeof(counter),
+                    [counter](uint8_t* buf) { memcpy(buf, &counter, sizeof(counter)); },
+                    [&](bool sent) { sent ? num_sent++ : num_dropped++; })) {
+                std::this_thread::sleep_for(1ms);
+            }
+        }
+        const bool caught_up = group.drain(drain_timeout);
+        if(!caught_up) {
+            cout << "FAILED: the other node did not catch up before the drain timed out" << endl;
+            passed = false;
+        }
+        if(num_sent != num_msgs || num_dropped != 0) {
+            cout << "FAILED: " << num_sent << " of " << num_msgs << " queued messages were sent and "
+                 << num_dropped << " were dropped before the node left" << endl;
+            passed = false;
+        }
+        cout << (passed ? "PASSED" : "FAILED") << endl;
+        return passed ? 0 : 1;
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(test_mutex);
+        view_changed.wait(lock, [&]() { return leave_view_installed; });
+        if(delivered_counters.size() != num_msgs) {
+            cout << "FAILED: delivered " << delivered_counters.size() << " of the " << num_msgs
+                 << " messages from the leaving node" << endl;
+            passed = false;
+        }
+        for(uint32_t i = 0; i < delivered_counters.size(); ++i) {
+            if(delivered_counters[i] != i) {
+                cout << "FAILED: message " << delivered_counters[i] << " from the leaving node was delivered in position " << i << endl;
+                passed = false;
+                break;
+            }
+        }
+        cout << (passed ? "PASSED" : "FAILED") << endl;
+    }
+
+    group.leave(true);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,89 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+#include <derecho/mutils-serialization/SerializationSupport.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <string>
+
+using derecho::ExternalClientCaller;
+using std::cout;
+using std::endl;
+
+/**
+ * Runs a Group member and an ExternalGroupClient of the same group in one
+ * process, to check that the two can share the process's SST and P2P
+ * connections. Each process must set DERECHO/external_client_id (and, if the
+ * processes share a host, DERECHO/external_client_port) to an ID that is not
+ * used by any member.
+ */
+
+class Register : public mutils::ByteRepresentable,
+                 public derecho::GroupReference {
+    std::string value;
+
+public:
+    Register(const std::string& value = "") : value(value) {}
+
+    void put(const std::string& new_value) {
+        value = new_value;
+    }
+
+    std::string get() const {
+        return value;
+    }
+
+    REGISTER_RPC_FUNCTIONS(Register, ORDERED_TARGETS(put), P2P_TARGETS(get));
+    DEFAULT_SERIALIZATION_SUPPORT(Register, value);
+};
+
+int main(int argc, char** argv) {
+    const int num_args = 2;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_reads" << endl;
+        return -1;
+    }
+    derecho::Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[argc - num_args]);
+    const int num_reads = std::stoi(argv[argc - num_args + 1]);
+    if(!derecho::hasCustomizedConfKey(derecho::Conf::DERECHO_EXTERNAL_CLIENT_ID)) {
+        cout << "This test needs " << derecho::Conf::DERECHO_EXTERNAL_CLIENT_ID << " to be set" << endl;
+        return -1;
+    }
+
+    derecho::SubgroupInfo subgroup_info{derecho::DefaultSubgroupAllocator(
+            {{std::type_index(typeid(Register)),
+              derecho::one_subgroup_policy(derecho::fixed_even_shards(1, num_nodes))}})};
+    auto register_factory = [](persistent::PersistentRegistry*, derecho::subgroup_id_t) { return std::make_unique<Register>(); };
+    derecho::Group<Register> group({}, subgroup_info, {}, std::vector<derecho::view_upcall_t>{}, register_factory);
+    cout << "Finished constructing/joining Group" << endl;
+
+    const uint32_t my_rank = group.get_my_rank();
+    const std::string my_value = "value from rank " + std::to_string(my_rank);
+    if(my_rank == 0) {
+        group.get_subgroup<Register>().ordered_send<RPC_NAME(put)>(my_value).get();
+    }
+    group.barrier_sync();
+
+    {
+        derecho::ExternalGroupClient<Register> client([]() { return std::make_unique<Register>(); });
+        cout << "Finished constructing ExternalGroupClient with ID " << client.get_my_id() << endl;
+        ExternalClientCaller<Register, decltype(client)>& caller = client.get_subgroup_caller<Register>();
+        const std::vector<node_id_t> members = client.get_members();
+        bool all_correct = true;
+        for(int i = 0; i < num_reads; ++i) {
+            const node_id_t target = members[i % members.size()];
+            std::string result = caller.p2p_send<RPC_NAME(get)>(target).get().get(target);
+            if(result != "value from rank 0") {
+                cout << "Read " << i << " from node " << target << " returned \"" << result << "\"" << endl;
+                all_correct = false;
+            }
+        }
+        cout << (all_correct ? "All reads returned the value put through the Group" : "Some reads returned the wrong value") << endl;
+    }
+
+    group.barrier_sync();
+    group.leave(true);
+    return 0;
+}
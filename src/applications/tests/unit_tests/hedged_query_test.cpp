@@ -0,0 +1,221 @@
+#include <derecho/core/detail/hedged_query.hpp>
+#include <derecho/utils/logger.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using derecho::rpc::HedgedQueryResults;
+using derecho::rpc::PendingResults;
+using derecho::rpc::QueryResults;
+using derecho::rpc::ReplyLatencyTracker;
+using unit_test::check;
+using namespace std::chrono_literals;
+
+/**
+ * Tests hedged P2P queries without a Group. ReplyLatencyTracker is checked
+ * against known latency distributions. HedgedQueryResults is given fake
+ * requests whose replies the test fulfills by hand, to check when the
+ * duplicate request is sent (including while nobody is waiting in get()),
+ * which reply get() returns, and which request it cancels.
+ */
+
+constexpr node_id_t primary_node = 1;
+constexpr node_id_t hedge_node = 2;
+/** Long enough that a reply fulfilled at once always beats the hedge */
+constexpr auto hedge_delay = 50ms;
+
+/** A P2P request whose reply is fulfilled by the test rather than a remote node */
+struct FakeRequest {
+    std::shared_ptr<PendingResults<int>> pending = std::make_shared<PendingResults<int>>();
+
+    QueryResults<int> send(node_id_t node) {
+        std::unique_ptr<QueryResults<int>> results = pending->get_future();
+        pending->fulfill_map({node});
+        return std::move(*results);
+    }
+};
+
+/** A hedged query, along with its fake requests and a record of what it did */
+struct FakeHedgedQuery {
+    FakeRequest primary;
+    FakeRequest hedge;
+    std::atomic<int> num_hedges_sent = 0;
+    /** While true, sending the hedge fails as if the P2P window to the backup were full */
+    std::atomic<bool> hedge_window_full = false;
+    std::vector<node_id_t> cancelled_nodes;
+    std::unique_ptr<HedgedQueryResults<int>> results;
+
+    FakeHedgedQuery() {
+        auto tracker = std::make_shared<ReplyLatencyTracker>(95, std::chrono::microseconds(hedge_delay).count());
+        results = std::make_unique<HedgedQueryResults<int>>(
+                primary.send(primary_node), primary_node, hedge_node,
+                [this]() {
+                    if(hedge_window_full) {
+                        throw derecho::send_window_full_exception("the window to the backup is full");
+                    }
+                    num_hedges_sent++;
+                    return hedge.send(hedge_node);
+                },
+                [this](node_id_t node, const QueryResults<int>&) { cancelled_nodes.push_back(node); },
+                tracker);
+    }
+};
+
+static std::exception_ptr reply_failure() {
+    return std::make_exception_ptr(std::runtime_error("the replica failed"));
+}
+
+static void test_latency_tracker() {
+    ReplyLatencyTracker tracker(95, 200);
+    check(tracker.hedge_delay() == 200us, "the minimum delay is used before any samples");
+    // One reply in ten is slow, so the 95th percentile is a slow one
+    for(int i = 0; i < 1024; ++i) {
+        tracker.record(i % 10 == 0 ? 100ms : 1ms);
+    }
+    check(tracker.hedge_delay() == 100ms, "the delay is the 95th percentile of the samples");
+    // The slow samples roll out of the window
+    for(int i = 0; i < 1024; ++i) {
+        tracker.record(1ms);
+    }
+    check(tracker.hedge_delay() == 1ms, "old samples leave the window");
+
+    ReplyLatencyTracker fast_tracker(50, 200);
+    for(int i = 0; i < 1024; ++i) {
+        fast_tracker.record(1us);
+    }
+    check(fast_tracker.hedge_delay() == 200us, "the delay is never less than the minimum");
+
+    ReplyLatencyTracker new_tracker(95, 200);
+    for(int i = 0; i < 16; ++i) {
+        new_tracker.record(100ms);
+    }
+    check(new_tracker.hedge_delay() == 200us, "a few samples do not change the delay");
+}
+
+static void test_fast_primary() {
+    FakeHedgedQuery query;
+    query.primary.pending->set_value(primary_node, 1);
+    check(query.results->get() == 1, "a fast primary's reply is returned");
+    check(query.results->get_responder() == primary_node, "a fast primary is the responder");
+    std::this_thread::sleep_for(2 * hedge_delay);
+    check(query.num_hedges_sent == 0 && !query.results->was_hedged(), "a fast primary is not hedged");
+    check(query.cancelled_nodes.empty(), "nothing is cancelled if there was no hedge");
+}
+
+static void test_get_wakes_on_reply() {
+    FakeHedgedQuery query;
+    std::thread replier([&]() {
+        std::this_thread::sleep_for(hedge_delay / 10);
+        query.primary.pending->set_value(primary_node, 1);
+    });
+    const auto start = std::chrono::steady_clock::now();
+    check(query.results->get() == 1, "a reply that arrives during get() is returned");
+    check(std::chrono::steady_clock::now() - start < hedge_delay, "get() returns as soon as the reply arrives");
+    replier.join();
+    check(query.num_hedges_sent == 0, "a primary that replies before the delay is not hedged");
+}
+
+static void test_hedge_sent_without_get() {
+    FakeHedgedQuery query;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    check(query.num_hedges_sent == 1, "the hedge is sent after the delay even if get() is not called");
+    check(query.results->was_hedged(), "was_hedged() reports the hedge");
+    query.hedge.pending->set_value(hedge_node, 2);
+    check(query.results->get() == 2, "the backup's reply is returned if it arrives first");
+    check(query.results->get_responder() == hedge_node, "the backup is the responder");
+    check(query.cancelled_nodes == std::vector<node_id_t>{primary_node}, "the slow primary's request is cancelled");
+}
+
+static void test_primary_wins_after_hedge() {
+    FakeHedgedQuery query;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    query.primary.pending->set_value(primary_node, 1);
+    check(query.results->get() == 1, "the primary's reply is returned if it arrives first after hedging");
+    check(query.cancelled_nodes == std::vector<node_id_t>{hedge_node}, "the backup's request is cancelled");
+}
+
+static void test_failure_falls_back() {
+    FakeHedgedQuery query;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    query.primary.pending->set_exception(primary_node, reply_failure());
+    std::thread replier([&]() {
+        std::this_thread::sleep_for(hedge_delay / 10);
+        query.hedge.pending->set_value(hedge_node, 2);
+    });
+    check(query.results->get() == 2, "get() waits for the backup if the primary fails");
+    replier.join();
+    check(query.cancelled_nodes.empty(), "nothing is cancelled once both nodes have replied");
+
+    FakeHedgedQuery unhedged_query;
+    unhedged_query.primary.pending->set_exception(primary_node, reply_failure());
+    bool threw = false;
+    try {
+        unhedged_query.results->get();
+    } catch(std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "the primary's failure is rethrown if there is no hedge to fall back on");
+
+    FakeHedgedQuery failed_query;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    failed_query.primary.pending->set_exception(primary_node, reply_failure());
+    failed_query.hedge.pending->set_exception(hedge_node, reply_failure());
+    threw = false;
+    try {
+        failed_query.results->get();
+    } catch(std::runtime_error&) {
+        threw = true;
+    }
+    check(threw, "the failure is rethrown if both nodes fail");
+}
+
+static void test_full_window_does_not_block() {
+    FakeHedgedQuery blocked_query;
+    blocked_query.hedge_window_full = true;
+    FakeHedgedQuery query;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    check(query.num_hedges_sent == 1, "a full window to one backup does not hold up other hedges");
+    check(blocked_query.num_hedges_sent == 0 && !blocked_query.results->was_hedged(),
+          "a hedge is not sent while the backup's window is full");
+    blocked_query.hedge_window_full = false;
+    std::this_thread::sleep_for(hedge_delay);
+    check(blocked_query.num_hedges_sent == 1, "the hedge is sent once the backup's window has room");
+    blocked_query.hedge.pending->set_value(hedge_node, 2);
+    check(blocked_query.results->get() == 2, "the late hedge's reply is returned");
+
+    FakeHedgedQuery retrying_query;
+    retrying_query.hedge_window_full = true;
+    std::this_thread::sleep_for(2 * hedge_delay);
+    retrying_query.primary.pending->set_value(primary_node, 1);
+    check(retrying_query.results->get() == 1, "the primary's reply is returned while the hedge is retrying");
+    retrying_query.hedge_window_full = false;
+    std::this_thread::sleep_for(hedge_delay);
+    check(retrying_query.num_hedges_sent == 0, "get() stops a hedge that is waiting for window space");
+}
+
+static void test_destroyed_before_hedge() {
+    FakeHedgedQuery query;
+    query.results.reset();
+    std::this_thread::sleep_for(2 * hedge_delay);
+    check(query.num_hedges_sent == 0, "destroying the results stops the hedge from being sent");
+}
+
+int main(int argc, char** argv) {
+    LoggerFactory::createIfAbsent(LoggerFactory::RPC_LOGGER_NAME, "info");
+    derecho::rpc::RpcLoggerPtr::initialize();
+    test_latency_tracker();
+    test_fast_primary();
+    test_get_wakes_on_reply();
+    test_hedge_sent_without_get();
+    test_primary_wins_after_hedge();
+    test_failure_falls_back();
+    test_full_window_does_not_block();
+    test_destroyed_before_hedge();
+    return unit_test::report_result();
+}
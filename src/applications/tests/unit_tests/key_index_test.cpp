@@ -0,0 +1,207 @@
+#include <derecho/persistent/detail/DeltaKeyIndex.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+
+#include <algorithm>
+#include <filesystem>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::DeltaKeyIndex;
+using persistent::FilePersistLog;
+using persistent::INVALID_INDEX;
+using persistent::INVALID_VERSION;
+using persistent::version_t;
+using unit_test::check;
+
+/**
+ * Tests DeltaKeyIndex against a FilePersistLog, without a Group: lookups must
+ * match a model of the log after appends, after trims (whose postings are
+ * dropped lazily), after truncations (whose stale postings must not match the
+ * entries appended in their place), and after reopening the index from its
+ * file, with and without reopening the log too. Each delta is a list of keys
+ * separated by commas. The log is stored in ./key_index_test.plog.
+ */
+
+/** The number of deltas passed to extract_keys, to check that reopening reads the index file */
+static int num_extracted = 0;
+
+static std::vector<std::string> extract_keys(const uint8_t* delta, std::size_t size) {
+    num_extracted++;
+    std::vector<std::string> keys;
+    const std::string keys_string(reinterpret_cast<const char*>(delta), size);
+    std::size_t start = 0;
+    while(start < keys_string.size()) {
+        std::size_t end = keys_string.find(',', start);
+        if(end == std::string::npos) {
+            end = keys_string.size();
+        }
+        keys.push_back(keys_string.substr(start, end - start));
+        start = end + 1;
+    }
+    return keys;
+}
+
+constexpr int NUM_KEYS = 20;
+const std::string LOG_NAME = "key_index_test";
+const std::string LOG_PATH = "key_index_test.plog";
+
+/** The entries in the log, including the trimmed ones, in log order */
+struct ModelEntry {
+    version_t version;
+    int64_t index;
+    std::vector<std::string> keys;
+};
+
+class KeyIndexTest {
+    std::unique_ptr<FilePersistLog> log;
+    std::unique_ptr<DeltaKeyIndex> index;
+    std::vector<ModelEntry> entries;
+    int64_t earliest_index = 0;
+    version_t next_version = 0;
+    std::mt19937_64 random{1};
+
+public:
+    KeyIndexTest() {
+        std::filesystem::remove_all(LOG_PATH);
+        reopen(true);
+    }
+
+    void reopen(bool reopen_log) {
+        index.reset();
+        if(reopen_log) {
+            log.reset();
+            log = std::make_unique<FilePersistLog>(LOG_NAME, LOG_PATH, false);
+        }
+        index = std::make_unique<DeltaKeyIndex>(log.get(), extract_keys);
+    }
+
+    void append(int num_entries) {
+        for(int i = 0; i < num_entries; ++i) {
+            std::vector<std::string> keys;
+            std::string delta;
+            const int num_keys = 1 + random() % 3;
+            // Like KVStoreDelta::extract_keys, list each key once
+            const int first_key = random() % NUM_KEYS;
+            for(int k = 0; k < num_keys; ++k) {
+                keys.push_back("key" + std::to_string((first_key + k * 7) % NUM_KEYS));
+                delta += (k == 0 ? "" : ",") + keys.back();
+            }
+            // Leave gaps between versions, so lookups also land between them
+            next_version += 1 + random() % 3;
+            const int64_t entry_index = entries.empty() ? 0 : entries.back().index + 1;
+            log->append(delta.data(), delta.size(), next_version, HLC(next_version, 0));
+            entries.push_back({next_version, entry_index, keys});
+        }
+    }
+
+    void trim(int num_entries) {
+        earliest_index += num_entries;
+        log->trimByIndex(earliest_index - 1);
+        index->trim();
+    }
+
+    void truncate(version_t ver) {
+        log->truncate(ver);
+        index->truncate(ver);
+        while(!entries.empty() && entries.back().version > ver) {
+            entries.pop_back();
+        }
+    }
+
+    void persist() {
+        log->persist(log->getLatestVersion());
+        index->persist();
+    }
+
+    /** @return The version of a random entry that has not been trimmed */
+    version_t random_live_version() {
+        return entries[earliest_index - entries.front().index + random() % (entries.back().index - earliest_index + 1)].version;
+    }
+
+    version_t random_version() {
+        return entries.empty() ? 0 : entries.front().version + random() % (next_version - entries.front().version + 2);
+    }
+
+    /** Compares lookup() and getKeyVersions() of every key with the model */
+    void check_lookups(const std::string& description) {
+        bool lookups_match = true;
+        bool versions_match = true;
+        for(int k = 0; k < NUM_KEYS; ++k) {
+            const std::string key = "key" + std::to_string(k);
+            std::vector<version_t> expected_versions;
+            for(const ModelEntry& entry : entries) {
+                if(entry.index >= earliest_index
+                   && std::find(entry.keys.begin(), entry.keys.end(), key) != entry.keys.end()) {
+                    expected_versions.push_back(entry.version);
+                }
+            }
+            versions_match = versions_match && index->getKeyVersions(key) == expected_versions;
+            for(int i = 0; i < 20; ++i) {
+                const version_t ver = random_version();
+                // The latest entry at or before ver that updated the key, unless it was trimmed
+                std::pair<version_t, int64_t> expected{INVALID_VERSION, INVALID_INDEX};
+                for(auto entry = entries.rbegin(); entry != entries.rend(); ++entry) {
+                    if(entry->version <= ver
+                       && std::find(entry->keys.begin(), entry->keys.end(), key) != entry->keys.end()) {
+                        if(entry->index >= earliest_index) {
+                            expected = {entry->version, entry->index};
+                        }
+                        break;
+                    }
+                }
+                lookups_match = lookups_match && index->lookup(key, ver) == expected;
+            }
+        }
+        check(lookups_match, "lookup " + description);
+        check(versions_match, "getKeyVersions " + description);
+    }
+};
+
+int main(int argc, char** argv) {
+    KeyIndexTest test;
+    test.append(200);
+    test.check_lookups("after appends");
+
+    // Many small trims, so the postings are compacted more than once
+    for(int i = 0; i < 30; ++i) {
+        test.trim(4);
+        test.check_lookups("after trim " + std::to_string(i));
+        test.append(2);
+    }
+
+    test.persist();
+    int extracted_before_reopen = num_extracted;
+    test.reopen(false);
+    test.check_lookups("after reopening the index");
+    test.reopen(true);
+    test.check_lookups("after reopening the log and the index");
+    check(num_extracted == extracted_before_reopen, "reopening reads the index file instead of the log");
+
+    // A truncation followed by new entries that reuse the truncated entry numbers
+    test.truncate(test.random_live_version());
+    test.check_lookups("after truncate");
+    test.append(40);
+    test.check_lookups("after appending to a truncated log");
+    test.persist();
+    extracted_before_reopen = num_extracted;
+    test.reopen(true);
+    test.check_lookups("after reopening a truncated log");
+    check(num_extracted == extracted_before_reopen, "reopening a truncated log reads the index file instead of the log");
+
+    // A truncation recorded at the end of the index file
+    test.truncate(test.random_live_version());
+    test.persist();
+    extracted_before_reopen = num_extracted;
+    test.reopen(true);
+    test.check_lookups("after reopening right after a truncation");
+    check(num_extracted == extracted_before_reopen, "reopening right after a truncation reads the index file instead of the log");
+    test.append(20);
+    test.trim(10);
+    test.check_lookups("after appending and trimming a reopened log");
+
+    return unit_test::report_result();
+}
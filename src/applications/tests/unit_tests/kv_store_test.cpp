@@ -0,0 +1,290 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/kv_store.hpp>
+#include <derecho/persistent/Persistent.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include <random>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using derecho::Bytes;
+using derecho::KVIndex;
+using derecho::KVStore;
+using derecho::KVStoreDelta;
+using derecho::KVStoreState;
+using unit_test::check;
+
+/**
+ * Tests the building blocks of KVStore that don't need a Group: the KVIndex
+ * hash table, the KVStoreDelta log format, and the serialization of
+ * KVStoreState. KVIndex takes the hash of each key from the caller, so these
+ * tests choose hashes that collide on purpose to exercise linear probing and
+ * backward-shift deletion. It also reads a standalone KVStore at past versions
+ * and times, before and after its log is trimmed, with the log stored under
+ * ./kv_store_test.plog.
+ */
+
+const std::string PERS_PATH = "kv_store_test.plog";
+
+/** @return true if the index holds exactly the entries of the model */
+static bool matches(const KVIndex& index, const std::map<std::string, std::pair<uint64_t, std::string>>& model) {
+    if(index.size() != model.size()) {
+        return false;
+    }
+    for(const auto& [key, hash_and_value] : model) {
+        const std::string* value = index.find(key, hash_and_value.first);
+        if(value == nullptr || *value != hash_and_value.second) {
+            return false;
+        }
+    }
+    std::size_t num_visited = 0;
+    index.for_each([&num_visited](const std::string&, const std::string&) {
+        num_visited++;
+    });
+    return num_visited == model.size();
+}
+
+static void test_index_put_and_erase() {
+    KVIndex index;
+    check(index.find("a", KVIndex::hash("a")) == nullptr, "find on an empty index");
+    check(!index.erase("a", KVIndex::hash("a")), "erase on an empty index");
+    index.put("a", KVIndex::hash("a"), "1");
+    index.put("b", KVIndex::hash("b"), "2");
+    index.put("a", KVIndex::hash("a"), "3");
+    check(index.size() == 2, "overwriting a key does not add an entry");
+    check(index.find("a", KVIndex::hash("a")) && *index.find("a", KVIndex::hash("a")) == "3", "find after overwrite");
+    check(index.erase("a", KVIndex::hash("a")), "erase of a present key");
+    check(!index.erase("a", KVIndex::hash("a")), "erase of a removed key");
+    check(index.find("a", KVIndex::hash("a")) == nullptr, "find after erase");
+    check(index.find("b", KVIndex::hash("b")) && *index.find("b", KVIndex::hash("b")) == "2", "other keys survive erase");
+    // Growing must keep every entry reachable
+    for(int i = 0; i < 1000; ++i) {
+        const std::string key = "key" + std::to_string(i);
+        index.put(key, KVIndex::hash(key), std::to_string(i));
+    }
+    bool all_found = true;
+    for(int i = 0; i < 1000; ++i) {
+        const std::string key = "key" + std::to_string(i);
+        const std::string* value = index.find(key, KVIndex::hash(key));
+        all_found = all_found && value && *value == std::to_string(i);
+    }
+    check(all_found && index.size() == 1001, "all entries are found after growing");
+    index.clear();
+    check(index.size() == 0 && index.find("b", KVIndex::hash("b")) == nullptr, "clear");
+}
+
+static void test_index_backward_shift() {
+    // With the initial 16 slots, hashes 15, 31 and 47 all start probing at
+    // slot 15, so the cluster wraps around to slots 0 and 1, and hash 16
+    // (home slot 0) is pushed past them to slot 2.
+    KVIndex index;
+    index.put("x", 15, "x");
+    index.put("y", 31, "y");
+    index.put("z", 47, "z");
+    index.put("w", 16, "w");
+    check(index.erase("x", 15), "erase at the start of a wrapped cluster");
+    check(index.find("y", 31) && index.find("z", 47) && index.find("w", 16),
+          "entries after the hole are shifted back across the wrap-around");
+    check(index.erase("z", 47), "erase in the middle of a cluster");
+    check(index.find("y", 31) && index.find("w", 16), "entries are reachable after a second erase");
+    // Keys with the same hash are told apart by comparing them
+    index.put("v", 16, "v");
+    check(index.find("v", 16) && *index.find("v", 16) == "v" && *index.find("w", 16) == "w",
+          "keys with equal hashes");
+    check(index.erase("w", 16) && index.find("v", 16) && !index.find("w", 16), "erase of one of two keys with equal hashes");
+
+    // Random updates over few distinct hashes make long clusters; check every step against a map
+    std::mt19937_64 random(1);
+    std::map<std::string, std::pair<uint64_t, std::string>> model;
+    KVIndex clustered;
+    bool consistent = true;
+    for(int step = 0; step < 20000 && consistent; ++step) {
+        const std::string key = std::to_string(random() % 200);
+        const uint64_t hash = std::hash<std::string>{}(key) % 24 + 1;
+        if(random() % 3 == 0) {
+            const bool erased = clustered.erase(key, hash);
+            consistent = erased == (model.erase(key) == 1);
+        } else {
+            const std::string value = std::to_string(step);
+            clustered.put(key, hash, value);
+            model[key] = {hash, value};
+        }
+        consistent = consistent && matches(clustered, model);
+    }
+    check(consistent, "random puts and erases with colliding hashes match a std::map");
+}
+
+/** @return The operations of a delta, as (op, key, value) strings */
+static std::vector<std::tuple<KVStoreDelta::Op, std::string, std::string>> ops_of(const KVStoreDelta& delta) {
+    std::vector<std::tuple<KVStoreDelta::Op, std::string, std::string>> ops;
+    delta.for_each([&ops](KVStoreDelta::Op op, std::string_view key, std::string_view value) {
+        ops.emplace_back(op, std::string(key), std::string(value));
+    });
+    return ops;
+}
+
+static void test_delta_round_trip() {
+    const std::string binary_value("\0\1\2\0", 4);
+    std::string buffer;
+    KVStoreDelta::append(buffer, KVStoreDelta::Op::PUT, "a", "1");
+    KVStoreDelta::append(buffer, KVStoreDelta::Op::PUT, "b", binary_value);
+    KVStoreDelta::append(buffer, KVStoreDelta::Op::REMOVE, "a", "");
+    KVStoreDelta::append(buffer, KVStoreDelta::Op::PUT, "", "empty key");
+    const KVStoreDelta delta(reinterpret_cast<const uint8_t*>(buffer.data()));
+    check(delta.bytes_size() == buffer.size(), "a delta read in place has the size it was built with");
+
+    const auto expected_ops = ops_of(delta);
+    check(expected_ops.size() == 4 && std::get<2>(expected_ops[1]) == binary_value, "a delta reads back its operations");
+
+    std::vector<uint8_t> serialized(delta.bytes_size());
+    check(delta.to_bytes(serialized.data()) == serialized.size(), "to_bytes writes bytes_size() bytes");
+    std::unique_ptr<KVStoreDelta> copy = KVStoreDelta::from_bytes(nullptr, serialized.data());
+    std::fill(serialized.begin(), serialized.end(), 0xff);
+    check(ops_of(*copy) == expected_ops, "from_bytes copies the delta");
+    std::vector<uint8_t> posted;
+    copy->post_object([&posted](const uint8_t* bytes, std::size_t size) {
+        posted.insert(posted.end(), bytes, bytes + size);
+    });
+    check(posted.size() == buffer.size() && memcmp(posted.data(), buffer.data(), buffer.size()) == 0,
+          "post_object posts the same bytes as to_bytes");
+
+    auto last_a = delta.find("a");
+    check(last_a && last_a->first == KVStoreDelta::Op::REMOVE, "find returns the last operation on a key");
+    check(!delta.find("c"), "find of a key the delta does not update");
+    const std::vector<std::string> keys = KVStoreDelta::extract_keys(reinterpret_cast<const uint8_t*>(buffer.data()), buffer.size());
+    check(keys == std::vector<std::string>({"a", "b", ""}), "extract_keys returns each key once, in order");
+}
+
+/** @return The entries of a state, sorted by key */
+static std::map<std::string, std::string> entries_of(const KVStoreState& state, const std::vector<std::string>& keys) {
+    std::map<std::string, std::string> entries;
+    for(const std::string& key : keys) {
+        state.read(key, [&](const std::string& value) { entries[key] = value; });
+    }
+    return entries;
+}
+
+static void test_state_deltas_and_serialization() {
+    std::vector<std::string> keys;
+    for(int i = 0; i < 100; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    KVStoreState state;
+    KVStoreState replica;
+    // Outside of parallel apply, each update is recorded under INVALID_VERSION,
+    // which is also the version finalizeCurrentDelta() finalizes
+    for(int round = 0; round < 3; ++round) {
+        for(int i = round; i < 100; i += 2) {
+            state.put(keys[i], "value " + std::to_string(round) + " " + std::to_string(i));
+        }
+        check(!state.remove("absent"), "remove of an absent key");
+        state.remove(keys[round * 7]);
+        state.finalizeCurrentDelta([&replica](const uint8_t* delta, std::size_t size) {
+            if(size > 0) {
+                replica.applyDelta(delta);
+            }
+        });
+    }
+    check(replica.size() == state.size() && entries_of(replica, keys) == entries_of(state, keys),
+          "applying the finalized deltas reproduces the state");
+    bool empty_delta = false;
+    state.finalizeCurrentDelta([&empty_delta](const uint8_t*, std::size_t size) { empty_delta = size == 0; });
+    check(empty_delta, "a version without updates has an empty delta");
+
+    std::vector<uint8_t> serialized(state.bytes_size());
+    check(state.to_bytes(serialized.data()) == serialized.size(), "to_bytes writes bytes_size() bytes");
+    std::unique_ptr<KVStoreState> copy = KVStoreState::from_bytes(nullptr, serialized.data());
+    check(!copy->needs_rebuild() && entries_of(*copy, keys) == entries_of(state, keys),
+          "a serialized state reads back the same entries");
+    std::vector<uint8_t> posted;
+    state.post_object([&posted](const uint8_t* bytes, std::size_t size) {
+        posted.insert(posted.end(), bytes, bytes + size);
+    });
+    std::unique_ptr<KVStoreState> posted_copy = KVStoreState::from_bytes(nullptr, posted.data());
+    check(posted.size() == serialized.size() && entries_of(*posted_copy, keys) == entries_of(state, keys),
+          "post_object posts the same state as to_bytes");
+
+    // During a state transfer to a node with a log, the state is only a marker
+    persistent::PersistentRegistry::setEarliestVersionToSerialize(0);
+    std::vector<uint8_t> marker(state.bytes_size());
+    state.to_bytes(marker.data());
+    persistent::PersistentRegistry::resetEarliestVersionToSerialize();
+    std::unique_ptr<KVStoreState> received = KVStoreState::from_bytes(nullptr, marker.data());
+    check(marker.size() == sizeof(bool) && received->needs_rebuild() && received->size() == 0,
+          "a state transfer to a node with a log sends a marker");
+}
+
+static std::string to_string(const Bytes& bytes) {
+    return std::string(reinterpret_cast<const char*>(bytes.get()), bytes.size());
+}
+
+/** @return Whether a read throws the exception type E */
+template <typename E, typename Read>
+static bool throws(Read read) {
+    try {
+        read();
+    } catch(E&) {
+        return true;
+    }
+    return false;
+}
+
+static void test_reads_of_trimmed_versions() {
+    persistent::PersistentRegistry registry(nullptr, std::type_index(typeid(KVStore)), 0, 0);
+    KVStore store(&registry);
+    // Version v is created at time 1000 * v microseconds, long before the temporal frontier
+    auto make_version = [&registry](persistent::version_t ver) {
+        registry.makeVersion(ver, HLC(1000 * ver, 0));
+    };
+    const std::string value = "1";
+    store.put("a", Bytes(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+    make_version(1);
+    store.put("b", Bytes(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+    make_version(2);
+    store.remove("b");
+    make_version(3);
+    store.put("c", Bytes(reinterpret_cast<const uint8_t*>(value.data()), value.size()));
+    make_version(4);
+    registry.persist(4);
+
+    check(to_string(store.get_by_version("a", 2)) == value && to_string(store.get_by_time("a", 2500)) == value,
+          "a key reads back at a version and a time after it was set");
+    check(store.get_by_version("b", 3).size() == 0 && store.get_by_time("b", 3500).size() == 0,
+          "a removed key is absent");
+    check(store.get_by_version("z", 2).size() == 0 && store.get_by_time("z", 2500).size() == 0,
+          "a key that was never set is absent");
+    check(store.get_by_time("a", 500).size() == 0, "every key is absent before the first entry of an untrimmed log");
+
+    // Trims the entries of versions 1 and 2
+    registry.trim(2);
+    check(throws<persistent::persistent_invalid_version>([&]() { store.get_by_version("a", 3); })
+                  && throws<persistent::persistent_invalid_version>([&]() { store.get_by_time("a", 3500); }),
+          "a read throws if the key's last update before it was trimmed");
+    check(throws<persistent::persistent_invalid_version>([&]() { store.get_by_version("a", 1); }),
+          "a read at a trimmed version throws");
+    check(throws<persistent::persistent_invalid_hlc>([&]() { store.get_by_time("a", 1500); }),
+          "a read at a time before the first entry left after trimming throws");
+    check(store.get_by_version("b", 3).size() == 0 && to_string(store.get_by_version("c", 4)) == value,
+          "keys updated after the trimmed entries still read back");
+    check(store.get_by_version("z", 3).size() == 0 && store.get_by_time("z", 3500).size() == 0,
+          "a key that was never set is still absent after trimming");
+}
+
+int main(int argc, char** argv) {
+    std::string file_path = "--" + std::string(derecho::Conf::PERS_FILE_PATH) + "=" + PERS_PATH;
+    std::vector<char*> conf_args = {argv[0], file_path.data()};
+    derecho::Conf::initialize(conf_args.size(), conf_args.data());
+
+    test_index_put_and_erase();
+    test_index_backward_shift();
+    test_delta_round_trip();
+    test_state_deltas_and_serialization();
+    std::filesystem::remove_all(PERS_PATH);
+    test_reads_of_trimmed_versions();
+    return unit_test::report_result();
+}
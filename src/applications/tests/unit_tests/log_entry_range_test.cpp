@@ -0,0 +1,248 @@
+#include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <derecho/persistent/Persistent.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+#include <derecho/persistent/detail/LogEntryRange.hpp>
+#include <derecho/persistent/detail/util.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::FilePersistLog;
+using persistent::LogEntryRange;
+using persistent::LogEntryView;
+using persistent::version_t;
+using unit_test::check;
+
+/**
+ * Tests LogEntryRange and Persistent<T>::forEachVersion without a Group.
+ * Scans of ranges that start, end, or fall exactly on the boundaries of the
+ * 256-entry batches must visit each entry once, in order, in both directions;
+ * split() must cover a range with disjoint parts; and forEachVersion must
+ * visit the same states as get() for an object with deltas and one without.
+ * The logs are stored in ./log_entry_range_test.plog and under PERS/file_path.
+ */
+
+constexpr int64_t BATCH = LogEntryRange::BATCH_SIZE;
+constexpr int64_t NUM_ENTRIES = 3 * BATCH + 10;
+const std::string LOG_NAME = "log_entry_range_test";
+const std::string LOG_PATH = "log_entry_range_test.plog";
+
+/** Entry i has version 2 * i + 1, so versions between entries can be looked up, and holds i as its data */
+static version_t version_of(int64_t index) {
+    return 2 * index + 1;
+}
+
+/** @return The entry numbers a scan visits, or -1 in place of an entry whose version or data is wrong */
+static std::vector<int64_t> visit(const LogEntryRange& range) {
+    std::vector<int64_t> visited;
+    for(const LogEntryView& entry : range) {
+        int64_t data;
+        memcpy(&data, entry.data, sizeof(data));
+        const bool valid = entry.size == sizeof(data) && data == entry.index && entry.version == version_of(entry.index);
+        visited.push_back(valid ? entry.index : -1);
+    }
+    return visited;
+}
+
+/** @return The entry numbers from first to last, counting down if first > last */
+static std::vector<int64_t> sequence(int64_t first, int64_t last) {
+    std::vector<int64_t> indices;
+    for(int64_t i = first; first <= last ? i <= last : i >= last; first <= last ? ++i : --i) {
+        indices.push_back(i);
+    }
+    return indices;
+}
+
+static void test_batch_boundaries(FilePersistLog& log) {
+    // Lengths just below, at, and just above one and two batches, starting on and off a batch boundary
+    for(int64_t low : {int64_t{0}, int64_t{1}, BATCH - 1, int64_t{100}}) {
+        for(int64_t length : {int64_t{1}, BATCH - 1, BATCH, BATCH + 1, 2 * BATCH, 2 * BATCH + 1}) {
+            const int64_t high = std::min(low + length - 1, NUM_ENTRIES - 1);
+            const std::string description = " of entries " + std::to_string(low) + " to " + std::to_string(high);
+            LogEntryRange forward(&log, low, high, false);
+            check(forward.size() == high - low + 1, "size" + description);
+            check(visit(forward) == sequence(low, high), "forward scan" + description);
+            check(visit(LogEntryRange(&log, low, high, true)) == sequence(high, low), "reverse scan" + description);
+        }
+    }
+    check(visit(LogEntryRange(&log, 0, NUM_ENTRIES - 1, false)) == sequence(0, NUM_ENTRIES - 1), "forward scan of the whole log");
+    check(visit(LogEntryRange(&log, 0, NUM_ENTRIES - 1, true)) == sequence(NUM_ENTRIES - 1, 0), "reverse scan of the whole log");
+
+    LogEntryRange empty(&log, 5, 4, false);
+    check(empty.empty() && empty.size() == 0 && empty.begin() == empty.end(), "a range with high < low is empty");
+    LogEntryRange one(&log, 3, 3, false);
+    auto it = one.begin();
+    check(it != one.end() && it->index == 3 && ++it == one.end(), "a one-entry range ends after one entry");
+}
+
+static void test_split(FilePersistLog& log) {
+    for(bool reverse : {false, true}) {
+        for(int64_t length : {int64_t{1}, int64_t{7}, BATCH, BATCH + 1, NUM_ENTRIES - 5}) {
+            LogEntryRange range(&log, 5, 5 + length - 1, reverse);
+            const std::vector<int64_t> whole = visit(range);
+            for(std::size_t num_parts : {std::size_t{1}, std::size_t{2}, std::size_t{3}, std::size_t{7}, std::size_t(length + 3)}) {
+                const std::string description = " of " + std::to_string(length) + " entries into " + std::to_string(num_parts)
+                                                + (reverse ? " reverse" : " forward") + " parts";
+                std::vector<LogEntryRange> parts = range.split(num_parts);
+                check(parts.size() == std::min<std::size_t>(num_parts, length), "number of parts" + description);
+                std::vector<int64_t> concatenated;
+                int64_t smallest = length;
+                int64_t largest = 0;
+                for(const LogEntryRange& part : parts) {
+                    const std::vector<int64_t> part_entries = visit(part);
+                    concatenated.insert(concatenated.end(), part_entries.begin(), part_entries.end());
+                    smallest = std::min(smallest, part.size());
+                    largest = std::max(largest, part.size());
+                }
+                check(concatenated == whole, "parts visited in order cover the range once" + description);
+                check(smallest >= 1 && largest - smallest <= 1, "parts have about the same size" + description);
+            }
+        }
+    }
+    check(LogEntryRange(&log, 0, 9, false).split(0).empty(), "splitting into 0 parts");
+    check(LogEntryRange(&log, 9, 0, false).split(4).empty(), "splitting an empty range");
+}
+
+static void test_by_version(FilePersistLog& log) {
+    // Versions that fall between entries select the entries inside them
+    check(visit(LogEntryRange::byVersion(&log, version_of(10) - 1, version_of(20) + 1, false)) == sequence(10, 20),
+          "byVersion between entries");
+    check(visit(LogEntryRange::byVersion(&log, version_of(10), version_of(20), true)) == sequence(20, 10),
+          "byVersion on entries, reversed");
+    check(visit(LogEntryRange::byVersion(&log, 0, version_of(BATCH), false)) == sequence(0, BATCH),
+          "byVersion from before the first entry");
+    check(LogEntryRange::byVersion(&log, version_of(20), version_of(10), false).empty(), "byVersion with from > to");
+    check(LogEntryRange::byVersion(&log, version_of(4) + 1, version_of(5) - 1, false).empty(), "byVersion between two entries");
+}
+
+static void test_truncate_during_scan(FilePersistLog& log) {
+    // The first batch is read when the scan starts; the second one is cut short by the truncation
+    std::vector<int64_t> visited;
+    const int64_t last_kept = BATCH + 40;
+    LogEntryRange range(&log, 0, NUM_ENTRIES - 1, false);
+    for(auto it = range.begin(); it != range.end(); ++it) {
+        if(it->index == 10) {
+            log.truncate(version_of(last_kept));
+        }
+        visited.push_back(it->index);
+    }
+    check(visited == sequence(0, last_kept), "a scan ends at the entries left by a truncation");
+}
+
+/** A counter whose deltas are the amounts added to it */
+class Counter : public mutils::ByteRepresentable, public persistent::IDeltaSupport<Counter> {
+    int64_t delta = 0;
+
+public:
+    int64_t value = 0;
+
+    Counter(int64_t value = 0) : value(value) {}
+
+    void add(int64_t amount) {
+        value += amount;
+        delta += amount;
+    }
+    virtual void finalizeCurrentDelta(const persistent::DeltaFinalizer& finalizer) override {
+        finalizer(reinterpret_cast<const uint8_t*>(&delta), sizeof(delta));
+        delta = 0;
+    }
+    virtual void applyDelta(uint8_t const* const data) override {
+        int64_t amount;
+        memcpy(&amount, data, sizeof(amount));
+        value += amount;
+    }
+    static std::unique_ptr<Counter> create(mutils::DeserializationManager*) {
+        return std::make_unique<Counter>();
+    }
+
+    DEFAULT_SERIALIZATION_SUPPORT(Counter, value);
+};
+
+/** The same counter, logged as whole objects instead of deltas */
+class PlainCounter : public mutils::ByteRepresentable {
+public:
+    int64_t value = 0;
+
+    PlainCounter(int64_t value = 0) : value(value) {}
+
+    DEFAULT_SERIALIZATION_SUPPORT(PlainCounter, value);
+};
+
+static void remove_persistent_log(const std::string& name) {
+    for(const char* suffix : {META_FILE_SUFFIX, LOG_FILE_SUFFIX, DATA_FILE_SUFFIX}) {
+        std::filesystem::remove(getPersFilePath() + "/" + name + "." + suffix);
+    }
+}
+
+static void test_for_each_version() {
+    const std::string delta_name = "log_entry_range_test_counter";
+    const std::string plain_name = "log_entry_range_test_plain_counter";
+    remove_persistent_log(delta_name);
+    remove_persistent_log(plain_name);
+    persistent::Persistent<Counter> counter([]() { return std::make_unique<Counter>(); }, delta_name.c_str());
+    persistent::Persistent<PlainCounter> plain_counter([]() { return std::make_unique<PlainCounter>(); }, plain_name.c_str());
+    // Enough versions to span several batches of the scan; the value at version v is the sum of 1..(v-1)/2
+    int64_t sum = 0;
+    for(int64_t i = 0; i < NUM_ENTRIES; ++i) {
+        sum += i;
+        counter->add(i);
+        counter.version(version_of(i));
+        PlainCounter plain(sum);
+        plain_counter.set(plain, version_of(i));
+    }
+    counter.persist(version_of(NUM_ENTRIES - 1));
+    plain_counter.persist(version_of(NUM_ENTRIES - 1));
+
+    for(const auto& [from, to] : {std::pair<version_t, version_t>{0, version_of(NUM_ENTRIES - 1)},
+                                  {version_of(BATCH - 1), version_of(BATCH)},
+                                  {version_of(3) + 1, version_of(2 * BATCH + 2) - 1}}) {
+        const std::string description = " from version " + std::to_string(from) + " to " + std::to_string(to);
+        std::vector<version_t> delta_versions;
+        bool states_match = true;
+        counter.forEachVersion(from, to, [&](version_t ver, const Counter& state) {
+            delta_versions.push_back(ver);
+            states_match = states_match && state.value == counter.get(ver)->value;
+        });
+        std::vector<version_t> plain_versions;
+        bool plain_states_match = true;
+        plain_counter.forEachVersion(from, to, [&](version_t ver, const PlainCounter& state) {
+            plain_versions.push_back(ver);
+            plain_states_match = plain_states_match && state.value == counter.get(ver)->value;
+        });
+        std::vector<version_t> versions_in_range;
+        for(int64_t i = 0; i < NUM_ENTRIES; ++i) {
+            if(version_of(i) >= from && version_of(i) <= to) {
+                versions_in_range.push_back(version_of(i));
+            }
+        }
+        check(delta_versions == versions_in_range, "forEachVersion with deltas visits every version" + description);
+        check(states_match, "forEachVersion with deltas matches get()" + description);
+        check(plain_versions == versions_in_range, "forEachVersion without deltas visits every version" + description);
+        check(plain_states_match, "forEachVersion without deltas matches get()" + description);
+    }
+    bool visited_any = false;
+    counter.forEachVersion(version_of(4) + 1, version_of(5) - 1, [&](version_t, const Counter&) { visited_any = true; });
+    check(!visited_any, "forEachVersion between two versions visits nothing");
+}
+
+int main(int argc, char** argv) {
+    {
+        std::filesystem::remove_all(LOG_PATH);
+        FilePersistLog log(LOG_NAME, LOG_PATH, false);
+        for(int64_t i = 0; i < NUM_ENTRIES; ++i) {
+            log.append(&i, sizeof(i), version_of(i), HLC(version_of(i), 0));
+        }
+        log.persist(version_of(NUM_ENTRIES - 1));
+        test_batch_boundaries(log);
+        test_split(log);
+        test_by_version(log);
+        test_truncate_during_scan(log);
+    }
+    test_for_each_version();
+    return unit_test::report_result();
+}
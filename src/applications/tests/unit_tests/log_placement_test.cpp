@@ -0,0 +1,166 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/HLC.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::FilePersistLog;
+using persistent::version_t;
+using unit_test::check;
+
+/**
+ * Tests the direct placement API of FilePersistLog without a Group. Entries
+ * appended from inside a reserved region must be recorded where they are,
+ * including regions that are only part of a reservation, while entries from
+ * elsewhere, or from a reservation that an entry appended in place has
+ * overtaken, must be copied. Reservations must stop when the data ring is
+ * full, and must keep working as the tail wraps around the ring several
+ * times, with regions that straddle its end readable in one piece. The data
+ * ring is made small with PERS/max_data_size, and the log is stored in
+ * ./log_placement_test.plog.
+ */
+
+constexpr uint64_t RING_SIZE = 64 << 10;
+const std::string LOG_NAME = "log_placement_test";
+const std::string LOG_PATH = "log_placement_test.plog";
+
+/** Fills a region with a pattern that depends on the version it will be appended as */
+static void fill(void* region, uint64_t size, version_t ver) {
+    for(uint64_t i = 0; i < size; ++i) {
+        static_cast<uint8_t*>(region)[i] = static_cast<uint8_t>(ver * 31 + i);
+    }
+}
+
+/** @return Whether the region holds the pattern fill() writes for the version */
+static bool holds(const void* region, uint64_t size, version_t ver) {
+    for(uint64_t i = 0; i < size; ++i) {
+        if(static_cast<const uint8_t*>(region)[i] != static_cast<uint8_t>(ver * 31 + i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Appends a region (or any data) as the next version of the log */
+static void append(FilePersistLog& log, const void* data, uint64_t size, version_t ver) {
+    log.append(data, size, ver, HLC(ver, 0));
+}
+
+static void test_in_place_append(FilePersistLog& log, version_t& ver) {
+    const auto [mapping, mapping_size] = log.getPlacementRegion();
+    check(mapping != nullptr && mapping_size == 2 * RING_SIZE, "the placement region is the doubly mapped data ring");
+
+    uint8_t* region = static_cast<uint8_t*>(log.reservePlacement(1000));
+    check(region != nullptr && region >= mapping && region < static_cast<uint8_t*>(mapping) + RING_SIZE,
+          "a reservation is handed out in the first mapping of the ring");
+    fill(region, 1000, ++ver);
+    append(log, region, 1000, ver);
+    check(log.getEntry(ver) == region, "an entry appended from a whole reservation is recorded in place");
+
+    // Only part of the reservation is used, as when RDMC rounds a message up to its block size
+    region = static_cast<uint8_t*>(log.reservePlacement(1000));
+    fill(region + 100, 500, ++ver);
+    append(log, region + 100, 500, ver);
+    check(log.getEntry(ver) == region + 100, "an entry appended from part of a reservation is recorded in place");
+
+    uint8_t local[200];
+    fill(local, sizeof(local), ++ver);
+    append(log, local, sizeof(local), ver);
+    check(log.getEntry(ver) != local && holds(log.getEntry(ver), sizeof(local), ver),
+          "an entry appended from outside any reservation is copied");
+}
+
+static void test_out_of_order_append(FilePersistLog& log, version_t& ver) {
+    uint8_t* first = static_cast<uint8_t*>(log.reservePlacement(300));
+    uint8_t* second = static_cast<uint8_t*>(log.reservePlacement(300));
+    check(first != nullptr && second == first + 300, "consecutive reservations are adjacent");
+    fill(second, 300, ++ver);
+    append(log, second, 300, ver);
+    check(log.getEntry(ver) == second, "a later reservation can be appended in place first");
+    // The first region now lies before the last entry, so it cannot be recorded in place
+    fill(first, 300, ++ver);
+    append(log, first, 300, ver);
+    check(log.getEntry(ver) != first && holds(log.getEntry(ver), 300, ver),
+          "an entry from a reservation an in-place entry has overtaken is copied");
+    check(holds(log.getEntry(ver - 1), 300, ver - 1), "copying the overtaken entry does not overwrite the entry after it");
+    log.releasePlacement(first);
+
+    uint8_t* released = static_cast<uint8_t*>(log.reservePlacement(400));
+    log.releasePlacement(released);
+    uint8_t local[400];
+    fill(local, sizeof(local), ++ver);
+    append(log, local, sizeof(local), ver);
+    check(log.getEntry(ver) == released, "a released reservation's space is used by the next copied entry");
+}
+
+static void test_ring_wrap(FilePersistLog& log, version_t& ver) {
+    const auto [mapping, mapping_size] = log.getPlacementRegion();
+    uint8_t* const ring = static_cast<uint8_t*>(mapping);
+    // Not a divisor of the ring size, so reservations straddle its end
+    const uint64_t size = 9000;
+
+    std::vector<uint8_t*> regions;
+    while(uint8_t* region = static_cast<uint8_t*>(log.reservePlacement(size))) {
+        regions.push_back(region);
+    }
+    check(!regions.empty() && regions.size() * size <= RING_SIZE, "reservations stop when the ring is full");
+    for(uint8_t* region : regions) {
+        log.releasePlacement(region);
+    }
+
+    bool straddled = false;
+    bool all_in_place = true;
+    bool all_readable = true;
+    for(int i = 0; i < 3 * static_cast<int>(RING_SIZE / size); ++i) {
+        // Keep only the latest entry, so there is always room for the next one
+        log.trim(ver - 1);
+        uint8_t* region = static_cast<uint8_t*>(log.reservePlacement(size));
+        if(!region) {
+            check(false, "a reservation succeeds once the entries before it are trimmed");
+            return;
+        }
+        all_in_place = all_in_place && region >= ring && region < ring + RING_SIZE;
+        fill(region, size, ++ver);
+        if(region + size > ring + RING_SIZE) {
+            straddled = true;
+            // The bytes past the end of the first mapping are the start of the ring
+            all_readable = all_readable && ring[0] == region[ring + RING_SIZE - region];
+        }
+        append(log, region, size, ver);
+        all_in_place = all_in_place && log.getEntry(ver) == region;
+        all_readable = all_readable && holds(log.getEntry(ver), size, ver);
+    }
+    check(straddled, "some reservation straddles the end of the ring");
+    check(all_in_place, "every reservation is handed out in the first mapping and appended in place as the tail wraps");
+    check(all_readable, "every entry reads back in one piece, including the ones that straddle the end of the ring");
+}
+
+static void test_reload(version_t ver) {
+    FilePersistLog log(LOG_NAME, LOG_PATH, false);
+    check(log.getLatestVersion() == ver, "the latest version survives reopening the log");
+    const int64_t index = log.getLatestIndex();
+    check(holds(log.getEntryByIndex(index), 9000, ver), "an entry appended in place survives reopening the log");
+}
+
+int main(int argc, char** argv) {
+    std::string max_data_size = "--" + std::string(derecho::Conf::PERS_MAX_DATA_SIZE) + "=" + std::to_string(RING_SIZE);
+    std::vector<char*> conf_args = {argv[0], max_data_size.data()};
+    derecho::Conf::initialize(conf_args.size(), conf_args.data());
+
+    std::filesystem::remove_all(LOG_PATH);
+    version_t ver = 0;
+    {
+        FilePersistLog log(LOG_NAME, LOG_PATH, false);
+        test_in_place_append(log, ver);
+        test_out_of_order_append(log, ver);
+        test_ring_wrap(log, ver);
+        log.persist(ver);
+    }
+    test_reload(ver);
+    return unit_test::report_result();
+}
@@ -0,0 +1,103 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/persistent/HLC.hpp>
+#include <derecho/persistent/detail/FilePersistLog.hpp>
+
+#include <chrono>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::FilePersistLog;
+using persistent::version_t;
+using unit_test::check;
+using namespace std::chrono_literals;
+
+/**
+ * Tests the prewarming of FilePersistLog's data ring (PERS/prewarm_bytes)
+ * without a Group. The part of the ring just ahead of the tail must be
+ * faulted into memory soon after the log is opened, and again after appends
+ * move the tail, including after the tail wraps around the ring. A log with
+ * static storage duration is also left to be destroyed after main() returns,
+ * when it removes itself from the prewarming thread, so the test fails if
+ * that thread has been destroyed first. The logs are stored in
+ * ./log_prewarm_test.plog.
+ */
+
+constexpr uint64_t RING_SIZE = 1 << 20;
+constexpr uint64_t PREWARM_BYTES = 256 << 10;
+constexpr uint64_t ENTRY_SIZE = 4096;
+const std::string LOG_PATH = "log_prewarm_test.plog";
+
+/** Outlives main(), so it is destroyed while the process exits */
+static std::unique_ptr<FilePersistLog> static_log;
+
+/** @return Whether every page of [ofst, ofst + len) of the data ring is resident, wrapping around its end */
+static bool is_resident(FilePersistLog& log, uint64_t ofst, uint64_t len) {
+    uint8_t* const ring = static_cast<uint8_t*>(log.getPlacementRegion().first);
+    const uint64_t page_size = getpagesize();
+    const uint64_t first_page = (ofst % RING_SIZE) / page_size * page_size;
+    const uint64_t end = ofst % RING_SIZE + len;
+    // The data ring is mapped twice, so the range is contiguous in the mapping
+    std::vector<unsigned char> pages((end - first_page + page_size - 1) / page_size);
+    if(mincore(ring + first_page, end - first_page, pages.data()) != 0) {
+        return false;
+    }
+    for(unsigned char page : pages) {
+        if(!(page & 1)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** Waits up to a few seconds for the prewarming thread to make a range resident */
+static bool becomes_resident(FilePersistLog& log, uint64_t ofst, uint64_t len) {
+    for(auto deadline = std::chrono::steady_clock::now() + 5s; std::chrono::steady_clock::now() < deadline;) {
+        if(is_resident(log, ofst, len)) {
+            return true;
+        }
+        std::this_thread::sleep_for(10ms);
+    }
+    return false;
+}
+
+static void test_prewarm() {
+    FilePersistLog log("log_prewarm_test", LOG_PATH, false);
+    check(becomes_resident(log, 0, PREWARM_BYTES), "the start of the data ring is prewarmed when the log is opened");
+
+    const std::vector<uint8_t> entry(ENTRY_SIZE, 1);
+    uint64_t tail = 0;
+    version_t ver = 0;
+    // Past the first prewarmed part, then around the end of the ring
+    for(uint64_t target : {3 * PREWARM_BYTES, RING_SIZE + PREWARM_BYTES / 2}) {
+        while(tail < target) {
+            log.append(entry.data(), entry.size(), ++ver, HLC(ver, 0));
+            tail += ENTRY_SIZE;
+            // Keep a few entries, so the ring never fills up
+            if(ver > 8) {
+                log.trim(ver - 8);
+            }
+        }
+        // Each append that passes the middle of the prewarmed part extends it to PREWARM_BYTES past the tail
+        check(becomes_resident(log, tail, PREWARM_BYTES / 2),
+              "the data ring ahead of the tail is prewarmed after appends at offset " + std::to_string(tail));
+    }
+}
+
+int main(int argc, char** argv) {
+    std::string max_data_size = "--" + std::string(derecho::Conf::PERS_MAX_DATA_SIZE) + "=" + std::to_string(RING_SIZE);
+    std::string prewarm_bytes = "--" + std::string(derecho::Conf::PERS_PREWARM_BYTES) + "=" + std::to_string(PREWARM_BYTES);
+    std::vector<char*> conf_args = {argv[0], max_data_size.data(), prewarm_bytes.data()};
+    derecho::Conf::initialize(conf_args.size(), conf_args.data());
+
+    std::filesystem::remove_all(LOG_PATH);
+    test_prewarm();
+    static_log = std::make_unique<FilePersistLog>("log_prewarm_test_static", LOG_PATH, false);
+    return unit_test::report_result();
+}
@@ -0,0 +1,220 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace derecho;
+using std::cout;
+using std::endl;
+
+/**
+ * Tests optimistic delivery across a failure. Every member joins one ORDERED
+ * raw subgroup. The member with the highest rank sends a stream of messages
+ * and crashes partway through it; the member with rank 1 stalls its
+ * predicate thread in a delivery upcall shortly before the crash, so that
+ * the other survivors receive (and optimistically deliver) messages that it
+ * has not acknowledged. The ragged edge cleanup after the crash then trims
+ * those messages, which must be rolled back.
+ *
+ * On each survivor, the test checks that every optimistically delivered
+ * message is resolved exactly once by the time the new view is installed:
+ * either confirmed, in which case it was also delivered normally with the
+ * same version, or rolled back, in which case it was never delivered. It also
+ * checks that optimistic deliveries happen in version order. Rollbacks depend
+ * on the timing of the crash, so a run in which none happened is reported but
+ * does not fail.
+ */
+
+/** How long the sender streams messages before it crashes */
+constexpr std::chrono::milliseconds crash_after(1000);
+/** How long the member with rank 1 stalls, which must outlast the crash */
+constexpr std::chrono::milliseconds stall_for(3000);
+
+using message_key_t = std::pair<node_id_t, message_id_t>;
+
+int main(int argc, char** argv) {
+    const int num_args = 2;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_msgs" << endl;
+        return -1;
+    }
+    Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[argc - num_args]);
+    const uint32_t num_msgs = std::stoi(argv[argc - num_args + 1]);
+    if(num_nodes < 3) {
+        cout << "This test needs at least 3 nodes: a sender that crashes and two survivors" << endl;
+        return -1;
+    }
+
+    // The group must stay provisioned after the sender crashes
+    SubgroupInfo subgroup_info([num_nodes](const std::vector<std::type_index>& subgroup_type_order,
+                                           const std::unique_ptr<View>& prev_view, View& curr_view) {
+        if(!prev_view && curr_view.members.size() < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        return one_subgroup_entire_view(subgroup_type_order, prev_view, curr_view);
+    });
+
+    std::mutex test_mutex;
+    std::condition_variable view_changed;
+    bool passed = true;
+    // Set once this node's role is known
+    std::atomic<bool> stall_receiver = false;
+    std::atomic<node_id_t> sender_id = 0;
+    bool stalled = false;
+    persistent::version_t last_optimistic_version = persistent::INVALID_VERSION;
+    // Optimistically delivered messages that have not been resolved, with their versions
+    std::map<message_key_t, persistent::version_t> unresolved;
+    std::map<message_key_t, persistent::version_t> delivered;
+    std::map<message_key_t, persistent::version_t> confirmed;
+    std::map<message_key_t, persistent::version_t> rolled_back;
+    uint32_t num_optimistic = 0;
+    bool failure_view_installed = false;
+
+    UserMessageCallbacks callbacks;
+    callbacks.global_stability_callback = [&](subgroup_id_t subgroup_num, node_id_t sender, message_id_t index,
+                                              std::optional<std::pair<uint8_t*, long long int>> data,
+                                              persistent::version_t version) {
+        bool stall = false;
+        {
+            std::lock_guard<std::mutex> lock(test_mutex);
+            delivered[{sender, index}] = version;
+            stall = stall_receiver && sender == sender_id && !stalled;
+            stalled = stalled || stall;
+        }
+        if(stall) {
+            // Blocks this node's predicate thread, so it stops acknowledging the sender's messages
+            std::this_thread::sleep_for(stall_for);
+        }
+    };
+    callbacks.optimistic_delivery_callback = [&](subgroup_id_t subgroup_num, node_id_t sender, message_id_t index,
+                                                 std::optional<std::pair<uint8_t*, long long int>> data,
+                                                 persistent::version_t version) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        if(!data) {
+            cout << "FAILED: raw message " << index << " from node " << sender << " was optimistically delivered without a body" << endl;
+            passed = false;
+        }
+        if(version <= last_optimistic_version) {
+            cout << "FAILED: version " << version << " was optimistically delivered after version " << last_optimistic_version << endl;
+            passed = false;
+        }
+        last_optimistic_version = version;
+        if(!unresolved.emplace(message_key_t{sender, index}, version).second) {
+            cout << "FAILED: message " << index << " from node " << sender << " was optimistically delivered twice" << endl;
+            passed = false;
+        }
+        num_optimistic++;
+    };
+    // Moves an optimistically delivered message from unresolved to the map for its outcome
+    auto resolve = [&](node_id_t sender, message_id_t index, persistent::version_t version,
+                       std::map<message_key_t, persistent::version_t>& outcomes, const char* outcome) {
+        auto message = unresolved.find({sender, index});
+        if(message == unresolved.end()) {
+            cout << "FAILED: message " << index << " from node " << sender << " was " << outcome
+                 << " without an unresolved optimistic delivery" << endl;
+            passed = false;
+            return;
+        }
+        if(message->second != version) {
+            cout << "FAILED: message " << index << " from node " << sender << " was " << outcome << " with version "
+                 << version << " but optimistically delivered with version " << message->second << endl;
+            passed = false;
+        }
+        unresolved.erase(message);
+        outcomes[{sender, index}] = version;
+    };
+    callbacks.optimistic_confirmation_callback = [&](subgroup_id_t subgroup_num, node_id_t sender,
+                                                     message_id_t index, persistent::version_t version) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        resolve(sender, index, version, confirmed, "confirmed");
+    };
+    callbacks.optimistic_rollback_callback = [&](subgroup_id_t subgroup_num, node_id_t sender,
+                                                 message_id_t index, persistent::version_t version) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        resolve(sender, index, version, rolled_back, "rolled back");
+    };
+
+    auto view_upcall = [&](const View& view) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        if(view.members.size() < num_nodes) {
+            failure_view_installed = true;
+            view_changed.notify_all();
+        }
+    };
+
+    Group<RawObject> group(callbacks, subgroup_info, std::vector<DeserializationContext*>{},
+                           std::vector<view_upcall_t>{view_upcall}, &raw_object_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    const std::vector<node_id_t> initial_members = group.get_members();
+    sender_id = initial_members.back();
+    const int32_t my_rank = group.get_my_rank();
+    Replicated<RawObject>& group_as_subgroup = group.get_subgroup<RawObject>();
+    if(my_rank == static_cast<int32_t>(num_nodes) - 1) {
+        // Crash without leaving, while messages are still in flight
+        std::thread crasher([]() {
+            std::this_thread::sleep_for(crash_after);
+            std::_Exit(0);
+        });
+        crasher.detach();
+        for(uint32_t counter = 0; counter < num_msgs; ++counter) {
+            group_as_subgroup.send(sizeof(counter), [counter](uint8_t* buf) {
+                memcpy(buf, &counter, sizeof(counter));
+            });
+        }
+        // Keep the messages unstable until the crash
+        std::this_thread::sleep_for(crash_after + stall_for);
+        cout << "The sender should have crashed by now; num_msgs is too small" << endl;
+        std::_Exit(1);
+    }
+    stall_receiver = my_rank == 1;
+
+    {
+        std::unique_lock<std::mutex> lock(test_mutex);
+        view_changed.wait(lock, [&]() { return failure_view_installed; });
+        // The ragged edge cleanup resolves every optimistic delivery before the new view is installed
+        for(const auto& [message, version] : unresolved) {
+            cout << "FAILED: message " << message.second << " from node " << message.first
+                 << " was neither confirmed nor rolled back" << endl;
+            passed = false;
+        }
+        // Confirmation comes just before the stability upcall, so deliveries are matched up here
+        for(const auto& [message, version] : confirmed) {
+            auto delivery = delivered.find(message);
+            if(delivery == delivered.end() || delivery->second != version) {
+                cout << "FAILED: message " << message.second << " from node " << message.first
+                     << " was confirmed but not delivered with version " << version << endl;
+                passed = false;
+            }
+        }
+        for(const auto& [message, version] : rolled_back) {
+            if(delivered.count(message)) {
+                cout << "FAILED: message " << message.second << " from node " << message.first
+                     << " was both rolled back and delivered" << endl;
+                passed = false;
+            }
+        }
+        cout << num_optimistic << " messages were delivered optimistically: " << confirmed.size() << " confirmed, "
+             << rolled_back.size() << " rolled back" << endl;
+        if(rolled_back.empty()) {
+            cout << "No message was rolled back in this run; the crash may have come after every message was stable" << endl;
+        }
+        cout << (passed ? "PASSED" : "FAILED") << endl;
+    }
+
+    group.barrier_sync();
+    group.leave(true);
+    return passed ? 0 : 1;
+}
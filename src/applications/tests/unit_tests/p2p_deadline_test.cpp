@@ -0,0 +1,164 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace derecho;
+using std::cout;
+using std::endl;
+using namespace std::chrono_literals;
+
+/**
+ * Tests deadlines and cancellation of P2P requests, which are only available
+ * to non-members of a subgroup. Every member is alone in its own subgroup and
+ * sends requests to the next member's subgroup, while that member's P2P worker
+ * thread is kept busy by a slow request, and checks that:
+ * - a request whose deadline passes while it is queued gets a
+ *   request_expired_exception, and one that is handled in time gets its reply
+ * - a cancelled request that is still queued gets a request_expired_exception,
+ *   while the request ahead of it still gets its reply
+ * - a burst of requests that are all cancelled at once, by every member at
+ *   the same time and several times the size of the P2P window, is resolved
+ *   without deadlocking the members that cancel requests to each other
+ */
+
+class SlowReader : public mutils::ByteRepresentable {
+    int value;
+
+public:
+    SlowReader(int value) : value(value) {}
+
+    /** Keeps the P2P worker thread busy for delay_ms before replying */
+    int slow_read(uint32_t delay_ms) const {
+        std::this_thread::sleep_for(std::chrono::milliseconds(delay_ms));
+        return value;
+    }
+
+    DEFAULT_SERIALIZATION_SUPPORT(SlowReader, value);
+    REGISTER_RPC_FUNCTIONS(SlowReader, P2P_TARGETS(slow_read));
+};
+
+/** How long the request that blocks the destination's worker thread takes */
+constexpr uint32_t blocking_delay_ms = 500;
+/** How long to wait for a reply before deciding the members are deadlocked */
+constexpr auto reply_timeout = 30s;
+
+bool passed = true;
+
+void check(bool condition, const std::string& description) {
+    if(!condition) {
+        cout << "FAILED: " << description << endl;
+        passed = false;
+    }
+}
+
+enum class Outcome { REPLIED,
+                     EXPIRED,
+                     TIMED_OUT,
+                     FAILED };
+
+/** Waits for the reply to a P2P request to one node and reports how it was resolved */
+Outcome await_reply(rpc::QueryResults<int>& results, node_id_t dest_node) {
+    auto* replies = results.wait(reply_timeout);
+    if(!replies) {
+        return Outcome::TIMED_OUT;
+    }
+    auto& reply = replies->rmap.at(dest_node);
+    if(reply.wait_for(reply_timeout) != std::future_status::ready) {
+        return Outcome::TIMED_OUT;
+    }
+    try {
+        reply.get();
+        return Outcome::REPLIED;
+    } catch(rpc::request_expired_exception&) {
+        return Outcome::EXPIRED;
+    } catch(derecho_exception& ex) {
+        cout << "Unexpected exception from node " << dest_node << ": " << ex.what() << endl;
+        return Outcome::FAILED;
+    }
+}
+
+void test_deadlines(PeerCaller<SlowReader>& neighbor, node_id_t dest_node) {
+    auto blocker = neighbor.p2p_send<RPC_NAME(slow_read)>(dest_node, blocking_delay_ms);
+    auto expired = neighbor.p2p_send_with_deadline<RPC_NAME(slow_read)>(dest_node, 50ms, 0u);
+    auto in_time = neighbor.p2p_send_with_deadline<RPC_NAME(slow_read)>(dest_node, 60s, 0u);
+    check(await_reply(blocker, dest_node) == Outcome::REPLIED, "a request without a deadline gets its reply");
+    check(await_reply(expired, dest_node) == Outcome::EXPIRED,
+          "a request whose deadline passes while it is queued gets a request_expired_exception");
+    check(await_reply(in_time, dest_node) == Outcome::REPLIED, "a request that is handled before its deadline gets its reply");
+}
+
+void test_cancellation(PeerCaller<SlowReader>& neighbor, node_id_t dest_node) {
+    auto blocker = neighbor.p2p_send<RPC_NAME(slow_read)>(dest_node, blocking_delay_ms);
+    auto cancelled = neighbor.p2p_send<RPC_NAME(slow_read)>(dest_node, 0u);
+    neighbor.cancel(dest_node, cancelled);
+    check(await_reply(cancelled, dest_node) == Outcome::EXPIRED,
+          "a request cancelled while it is queued gets a request_expired_exception");
+    check(await_reply(blocker, dest_node) == Outcome::REPLIED, "the request ahead of a cancelled one gets its reply");
+}
+
+void test_cancellation_burst(PeerCaller<SlowReader>& neighbor, node_id_t dest_node, uint32_t num_requests) {
+    std::vector<rpc::QueryResults<int>> requests;
+    for(uint32_t i = 0; i < num_requests; ++i) {
+        requests.emplace_back(neighbor.p2p_send<RPC_NAME(slow_read)>(dest_node, 1u));
+        neighbor.cancel(dest_node, requests.back());
+    }
+    uint32_t num_replied = 0;
+    uint32_t num_expired = 0;
+    for(auto& request : requests) {
+        const Outcome outcome = await_reply(request, dest_node);
+        if(outcome == Outcome::TIMED_OUT) {
+            check(false, "a cancelled request was resolved within the timeout");
+            return;
+        }
+        check(outcome != Outcome::FAILED, "a cancelled request is either executed or expired");
+        num_replied += (outcome == Outcome::REPLIED);
+        num_expired += (outcome == Outcome::EXPIRED);
+    }
+    cout << "Of " << num_requests << " cancelled requests, " << num_replied << " were executed and "
+         << num_expired << " expired" << endl;
+}
+
+int main(int argc, char** argv) {
+    const int num_args = 1;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes" << endl;
+        return -1;
+    }
+    Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[argc - num_args]);
+    if(num_nodes < 2) {
+        cout << "This test needs at least 2 nodes" << endl;
+        return -1;
+    }
+
+    SubgroupInfo subgroup_info(DefaultSubgroupAllocator(
+            {{std::type_index(typeid(SlowReader)),
+              identical_subgroups_policy(num_nodes, fixed_even_shards(1, 1))}}));
+    auto slow_reader_factory = [](persistent::PersistentRegistry*, subgroup_id_t) {
+        return std::make_unique<SlowReader>(1);
+    };
+
+    Group<SlowReader> group({}, subgroup_info, {}, std::vector<view_upcall_t>{}, slow_reader_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    const uint32_t my_subgroup = group.get_my_subgroup_indexes<SlowReader>().at(0);
+    const uint32_t dest_subgroup = (my_subgroup + 1) % num_nodes;
+    const node_id_t dest_node = group.get_subgroup_members<SlowReader>(dest_subgroup)[0][0];
+    PeerCaller<SlowReader>& neighbor = group.get_nonmember_subgroup<SlowReader>(dest_subgroup);
+
+    test_deadlines(neighbor, dest_node);
+    test_cancellation(neighbor, dest_node);
+    // Every member cancels requests to its neighbor's subgroup at the same time
+    group.barrier_sync();
+    test_cancellation_burst(neighbor, dest_node, 4 * getConfUInt32(Conf::DERECHO_P2P_WINDOW_SIZE));
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+
+    group.barrier_sync();
+    group.leave(true);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,203 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+#include <derecho/mutils-serialization/SerializationSupport.hpp>
+#include <derecho/persistent/Persistent.hpp>
+
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <vector>
+
+using std::cout;
+using std::endl;
+
+/**
+ * Tests parallel apply with a small ParallelApply type: every member appends
+ * tokens to a few keys with ordered calls, which are applied concurrently for
+ * different keys. It checks that the calls on each key were applied in the
+ * order each sender sent them, that replaying the persisted log one version at
+ * a time (as sequential execution would) gives the same state as the parallel
+ * one, and that every member has the same log.
+ */
+
+constexpr uint32_t NUM_KEYS = 16;
+
+/** The tokens appended to each key, logged as one (key, token) delta per version. */
+class AppendLogState : public mutils::ByteRepresentable, public persistent::IDeltaSupport<AppendLogState> {
+    std::mutex delta_mutex;
+    /** The delta of each version being applied */
+    std::map<persistent::version_t, std::pair<uint32_t, uint64_t>> pending_deltas;
+
+public:
+    static constexpr std::size_t DELTA_SIZE = sizeof(uint32_t) + sizeof(uint64_t);
+    std::vector<std::vector<uint64_t>> tokens;
+
+    AppendLogState(const std::vector<std::vector<uint64_t>>& tokens = std::vector<std::vector<uint64_t>>(NUM_KEYS))
+            : tokens(tokens) {}
+
+    void append(uint32_t key, uint64_t token) {
+        // Calls on the same key run on one worker thread, so only the deltas need a lock
+        tokens[key].push_back(token);
+        std::lock_guard<std::mutex> lock(delta_mutex);
+        pending_deltas[derecho::ParallelApply::applying_version()] = {key, token};
+    }
+
+    virtual void finalizeCurrentDelta(const persistent::DeltaFinalizer& finalizer) override {
+        uint8_t delta[DELTA_SIZE];
+        {
+            std::lock_guard<std::mutex> lock(delta_mutex);
+            auto pending = pending_deltas.find(derecho::ParallelApply::applying_version());
+            if(pending == pending_deltas.end()) {
+                finalizer(nullptr, 0);
+                return;
+            }
+            memcpy(delta, &pending->second.first, sizeof(uint32_t));
+            memcpy(delta + sizeof(uint32_t), &pending->second.second, sizeof(uint64_t));
+            pending_deltas.erase(pending);
+        }
+        finalizer(delta, DELTA_SIZE);
+    }
+
+    virtual void applyDelta(uint8_t const* const delta) override {
+        uint32_t key;
+        uint64_t token;
+        memcpy(&key, delta, sizeof(key));
+        memcpy(&token, delta + sizeof(key), sizeof(token));
+        tokens[key].push_back(token);
+    }
+
+    static std::unique_ptr<AppendLogState> create(mutils::DeserializationManager*) {
+        return std::make_unique<AppendLogState>();
+    }
+
+    DEFAULT_SERIALIZATION_SUPPORT(AppendLogState, tokens);
+};
+
+class ParallelAppendLog : public mutils::ByteRepresentable,
+                          public derecho::PersistsFields,
+                          public derecho::ParallelApply {
+public:
+    persistent::Persistent<AppendLogState> state;
+
+    ParallelAppendLog(persistent::PersistentRegistry* registry)
+            : state(std::make_unique<AppendLogState>, nullptr, registry) {}
+    ParallelAppendLog(persistent::Persistent<AppendLogState>& other_state)
+            : state(std::move(other_state)) {}
+
+    void append(uint32_t key, uint64_t token) {
+        state->append(key, token);
+    }
+
+    /** @return A hash of the version, key and token of every entry in the log */
+    uint64_t get_log_digest() const {
+        uint64_t digest = 14695981039346656037ull;
+        const persistent::version_t earliest = state.getEarliestVersion();
+        if(earliest == persistent::INVALID_VERSION) {
+            return digest;
+        }
+        for(const persistent::LogEntryView& entry : state.getEntries(earliest, state.getLatestVersion())) {
+            digest = (digest ^ static_cast<uint64_t>(entry.version)) * 1099511628211ull;
+            const uint8_t* data = static_cast<const uint8_t*>(entry.data);
+            for(uint64_t i = 0; i < entry.size; ++i) {
+                digest = (digest ^ data[i]) * 1099511628211ull;
+            }
+        }
+        return digest;
+    }
+
+    /** Appends conflict only with appends to the same key, which is their first argument. */
+    virtual std::optional<uint64_t> conflict_key(derecho::rpc::FunctionTag tag, const uint8_t* args, std::size_t args_size) const override {
+        if(tag != derecho::rpc::to_internal_tag<false>(RPC_NAME(append)) || args_size < sizeof(uint32_t)) {
+            return std::nullopt;
+        }
+        uint32_t key;
+        memcpy(&key, args, sizeof(key));
+        return key;
+    }
+
+    REGISTER_RPC_FUNCTIONS(ParallelAppendLog, ORDERED_TARGETS(append), P2P_TARGETS(get_log_digest));
+    DEFAULT_SERIALIZATION_SUPPORT(ParallelAppendLog, state);
+};
+
+int main(int argc, char** argv) {
+    const int num_args = 2;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_nodes num_appends" << endl;
+        return -1;
+    }
+    derecho::Conf::initialize(argc, argv);
+    const uint32_t num_nodes = std::stoi(argv[argc - num_args]);
+    const uint32_t num_appends = std::stoi(argv[argc - num_args + 1]);
+    if(num_appends == 0) {
+        cout << "num_appends must be positive" << endl;
+        return -1;
+    }
+
+    derecho::SubgroupInfo subgroup_info{derecho::DefaultSubgroupAllocator(
+            {{std::type_index(typeid(ParallelAppendLog)),
+              derecho::one_subgroup_policy(derecho::fixed_even_shards(1, num_nodes))}})};
+    auto log_factory = [](persistent::PersistentRegistry* registry, derecho::subgroup_id_t) {
+        return std::make_unique<ParallelAppendLog>(registry);
+    };
+    derecho::Group<ParallelAppendLog> group({}, subgroup_info, {}, std::vector<derecho::view_upcall_t>{}, log_factory);
+    cout << "Finished constructing/joining Group" << endl;
+
+    derecho::Replicated<ParallelAppendLog>& handle = group.get_subgroup<ParallelAppendLog>();
+    const uint64_t my_rank = group.get_my_rank();
+    // Each token is the sender's rank and its sequence number, so the order of each sender's tokens can be
+    // checked. The replies to the last append are only sent once the appends delivered before it are applied.
+    for(uint32_t i = 0; i < num_appends; ++i) {
+        const uint32_t key = (my_rank + i) % NUM_KEYS;
+        auto results = handle.ordered_send<RPC_NAME(append)>(key, (my_rank << 32) | i);
+        if(i + 1 == num_appends) {
+            results.get();
+        }
+    }
+    group.barrier_sync();
+
+    bool passed = true;
+    const ParallelAppendLog& object = handle.get_ref();
+    for(uint32_t key = 0; key < NUM_KEYS; ++key) {
+        std::map<uint64_t, uint64_t> next_sequence_number_by_sender;
+        for(uint64_t token : object.state->tokens[key]) {
+            uint64_t& next_sequence_number = next_sequence_number_by_sender[token >> 32];
+            if((token & 0xffffffff) < next_sequence_number) {
+                cout << "Key " << key << ": token " << (token & 0xffffffff) << " from rank " << (token >> 32)
+                     << " was applied after a later one" << endl;
+                passed = false;
+            }
+            next_sequence_number = (token & 0xffffffff) + 1;
+        }
+    }
+
+    AppendLogState sequential_state;
+    for(const persistent::LogEntryView& entry : object.state.getEntries(object.state.getEarliestVersion(),
+                                                                         object.state.getLatestVersion())) {
+        if(entry.size == AppendLogState::DELTA_SIZE) {
+            sequential_state.applyDelta(static_cast<const uint8_t*>(entry.data));
+        }
+    }
+    if(sequential_state.tokens != object.state->tokens) {
+        cout << "Replaying the log one version at a time does not give the state applied in parallel" << endl;
+        passed = false;
+    }
+
+    const uint64_t my_digest = object.get_log_digest();
+    for(node_id_t member : group.get_members()) {
+        if(member == group.get_my_id()) {
+            continue;
+        }
+        const uint64_t digest = handle.p2p_send<RPC_NAME(get_log_digest)>(member).get().get(member);
+        if(digest != my_digest) {
+            cout << "The log of node " << member << " differs from this node's log" << endl;
+            passed = false;
+        }
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+
+    group.barrier_sync();
+    group.leave(true);
+    return passed ? 0 : 1;
+}
@@ -1,6 +1,7 @@
 #include "persistence_notification_test.hpp"
 
 #include <random>
+#include <set>
 
 /* ------------------------ StorageNode implementation ------------------------ */
 
@@ -57,8 +58,9 @@ void StorageNode::request_notification(node_id_t client_node_id,
 
 void StorageNode::notification_thread_function() {
     pthread_setname_np(pthread_self(), "notif_check");
-    //Thread-local list of pending notification requests
-    std::map<persistent::version_t, NotificationRequest> requests_by_version;
+    //Thread-local list of pending notification requests; a client may request more than
+    //one type of notification for the same version, which are handled in the order requested
+    std::multimap<persistent::version_t, NotificationRequest> requests_by_version;
     //Thread-local list of QueryResults that are related to notification requests
     std::map<persistent::version_t, derecho::rpc::QueryResults<void>> queryresults_for_requests;
     while(!thread_shutdown) {
@@ -104,6 +106,10 @@ void StorageNode::notification_thread_function() {
                               && result_search->second.global_persistence_is_ready()) {
                         result_search->second.await_global_persistence();
                         requested_event_happened = true;
+                    } else if(requests_iter->second.notification_type == NotificationMessageType::QUORUM_PERSISTENCE
+                              && result_search->second.quorum_persistence_is_ready()) {
+                        result_search->second.await_quorum_persistence();
+                        requested_event_happened = true;
                     }
                 } else {
                     auto cached_result_search = queryresults_for_requests.find(requested_version);
@@ -117,6 +123,10 @@ void StorageNode::notification_thread_function() {
                                   && cached_result_search->second.global_persistence_is_ready()) {
                             cached_result_search->second.await_global_persistence();
                             requested_event_happened = true;
+                        } else if(requests_iter->second.notification_type == NotificationMessageType::QUORUM_PERSISTENCE
+                                  && cached_result_search->second.quorum_persistence_is_ready()) {
+                            cached_result_search->second.await_quorum_persistence();
+                            requested_event_happened = true;
                         }
                     }
                 }
@@ -165,6 +175,10 @@ void StorageNode::notification_thread_function() {
                 dbg_default_debug("notification thread awaiting global persistence for version {}", requests_by_version.begin()->first);
                 queryresults_for_requests.at(requests_by_version.begin()->first).await_global_persistence();
                 break;
+            case NotificationMessageType::QUORUM_PERSISTENCE:
+                dbg_default_debug("notification thread awaiting quorum persistence for version {}", requests_by_version.begin()->first);
+                queryresults_for_requests.at(requests_by_version.begin()->first).await_quorum_persistence();
+                break;
         }
         //Send a notification to the client
         derecho::ExternalClientCallback<StorageNode>& client_callback = group->template get_client_callback<StorageNode>(subgroup_index);
@@ -185,7 +199,10 @@ void StorageNode::notification_thread_function() {
 
 /**
  * This test creates a group with a single StorageNode subgroup, then has an external client
- * submit several updates and request notifications for when they are persisted.
+ * submit several updates and request notifications for when they are persisted by a quorum
+ * of the storage nodes and by all of them. The quorum notification for a version must arrive
+ * before its global notification; set SUBGROUP/DEFAULT/persistence_quorum to less than
+ * num_storage_nodes to have it arrive while the slower nodes are still persisting.
  *
  * Command line arguments [external_node_id] [num_storage_nodes] [num_updates]
  * external_node_id: The node ID of the machine that should act as the external client.
@@ -218,7 +235,12 @@ int main(int argc, char** argv) {
         return std::make_unique<StorageNode>(registry, subgroup_id);
     };
 
-    auto client_callback_function = [](const derecho::NotificationMessage& message) {
+    //The versions for which the client has received each type of notification
+    std::mutex notified_versions_mutex;
+    std::set<persistent::version_t> quorum_notified_versions;
+    std::set<persistent::version_t> global_notified_versions;
+    bool notifications_in_order = true;
+    auto client_callback_function = [&](const derecho::NotificationMessage& message) {
         std::size_t body_offset = 0;
         auto version = mutils::from_bytes<persistent::version_t>(nullptr, message.body + body_offset);
         body_offset += mutils::bytes_size(*version);
@@ -226,6 +248,19 @@ int main(int argc, char** argv) {
         if(message.message_type == NotificationMessageType::GLOBAL_PERSISTENCE) {
             std::cout << "Got a client-side callback for global persistence of version "
                       << *version << " from subgroup " << *subgroup_id << std::endl;
+            std::unique_lock<std::mutex> lock(notified_versions_mutex);
+            //A version persisted on every member has also been persisted on a quorum of them
+            if(quorum_notified_versions.count(*version) == 0) {
+                std::cout << "Error: global persistence of version " << *version
+                          << " was notified before quorum persistence" << std::endl;
+                notifications_in_order = false;
+            }
+            global_notified_versions.insert(*version);
+        } else if(message.message_type == NotificationMessageType::QUORUM_PERSISTENCE) {
+            std::cout << "Got a client-side callback for quorum persistence of version "
+                      << *version << " from subgroup " << *subgroup_id << std::endl;
+            std::unique_lock<std::mutex> lock(notified_versions_mutex);
+            quorum_notified_versions.insert(*version);
         } else if(message.message_type == NotificationMessageType::LOCAL_PERSISTENCE) {
             std::cout << "Got a client-side callback for local persistence of version "
                       << *version << " from subgroup " << *subgroup_id << std::endl;
@@ -264,7 +299,7 @@ int main(int argc, char** argv) {
         //Register the client callback handler
         storage_caller.add_p2p_connection(notification_node);
         storage_caller.register_notification_handler(client_callback_function);
-        //Send some updates to the storage nodes and request callbacks when they have globally persisted
+        //Send some updates to the storage nodes and request callbacks when they have persisted on a quorum and globally
         derecho::Bytes test_update(update_size);
         for(unsigned counter = 0; counter < num_updates; ++counter) {
             std::generate(&test_update.get()[0], &test_update.get()[test_update.size()], [&]() {
@@ -276,13 +311,25 @@ int main(int argc, char** argv) {
             std::pair<persistent::version_t, uint64_t> version_and_timestamp = query_result.get().get(update_node);
             std::cout << "Update " << counter << " submitted. Result: Version = " << version_and_timestamp.first
                       << " timestamp = " << version_and_timestamp.second << std::endl;
-            //Request a callback for this version number
+            //Request callbacks for this version number
+            auto quorum_query_result = storage_caller.p2p_send<RPC_NAME(request_notification)>(
+                    notification_node, my_id, NotificationMessageType::QUORUM_PERSISTENCE, version_and_timestamp.first);
             auto callback_query_result = storage_caller.p2p_send<RPC_NAME(request_notification)>(
                     notification_node, my_id, NotificationMessageType::GLOBAL_PERSISTENCE, version_and_timestamp.first);
-            std::cout << "Requested a callback from node " << notification_node << " for version " << version_and_timestamp.first << std::endl;
+            std::cout << "Requested callbacks from node " << notification_node << " for version " << version_and_timestamp.first << std::endl;
         }
         std::cout << "Done sending all updates" << std::endl;
         std::cout << "Press enter when finished with test." << std::endl;
         std::cin.get();
+        std::unique_lock<std::mutex> lock(notified_versions_mutex);
+        std::cout << "Received " << quorum_notified_versions.size() << " quorum persistence and "
+                  << global_notified_versions.size() << " global persistence notifications for "
+                  << num_updates << " updates" << std::endl;
+        if(!notifications_in_order || quorum_notified_versions.size() != num_updates
+           || global_notified_versions.size() != num_updates) {
+            std::cout << "FAILED" << std::endl;
+            return 1;
+        }
+        std::cout << "PASSED" << std::endl;
     }
 }
@@ -11,7 +11,8 @@
 
 enum NotificationMessageType : uint64_t {
     LOCAL_PERSISTENCE = 1,
-    GLOBAL_PERSISTENCE
+    GLOBAL_PERSISTENCE,
+    QUORUM_PERSISTENCE
 };
 
 struct NotificationRequest {
@@ -24,8 +25,8 @@ struct NotificationRequest {
  * A simple persistent-storage subgroup for a Derecho group that can send notifications
  * to external clients when it finishes persisting their updates. An external client must
  * first request a notification for a particular version number; then its notify() method
- * will be invoked by the StorageNode when that version has finished persisting locally
- * or globally.
+ * will be invoked by the StorageNode when that version has finished persisting locally,
+ * on a quorum of the shard's members, or globally.
  */
 class StorageNode : public mutils::ByteRepresentable,
                     public derecho::PersistsFields,
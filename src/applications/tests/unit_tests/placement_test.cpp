@@ -0,0 +1,83 @@
+#include <derecho/utils/placement.hpp>
+
+#include <map>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using derecho::parse_thread_cpus;
+using unit_test::check;
+
+/**
+ * Tests the parsing of the NUMA/thread_cpus option without a Group: lists of
+ * single CPUs and ranges for several roles, with the spaces people write
+ * after separators, and each kind of malformed entry, which must be reported
+ * as a configuration error rather than being truncated or ignored.
+ */
+
+using thread_cpus_t = std::map<std::string, std::vector<int>>;
+
+/** @return The message of the configuration error parse_thread_cpus throws for the option, or "" if it parses */
+static std::string parse_error(const std::string& option) {
+    try {
+        parse_thread_cpus(option);
+    } catch(std::logic_error& ex) {
+        return ex.what();
+    }
+    return "";
+}
+
+static void test_valid_options() {
+    check(parse_thread_cpus("").empty(), "an empty option pins no threads");
+    check(parse_thread_cpus(" ; ").empty(), "an option with only separators pins no threads");
+    check(parse_thread_cpus("sst_detect:3") == thread_cpus_t{{"sst_detect", {3}}}, "one role on one CPU");
+    check(parse_thread_cpus("sst_detect:0-3,8,10-11")
+                  == thread_cpus_t{{"sst_detect", {0, 1, 2, 3, 8, 10, 11}}},
+          "ranges and single CPUs in one list");
+    // Every entry after the first must be split at its own end, not run to the end of the option
+    check(parse_thread_cpus("sst_detect:0-1;rpc_lsnr:2;rdmc_poll:4,6")
+                  == thread_cpus_t{{"sst_detect", {0, 1}}, {"rpc_lsnr", {2}}, {"rdmc_poll", {4, 6}}},
+          "several roles");
+    check(parse_thread_cpus(" sst_detect : 0 - 1 , 5 ; rpc_lsnr: 2 ;")
+                  == thread_cpus_t{{"sst_detect", {0, 1, 5}}, {"rpc_lsnr", {2}}},
+          "spaces around separators and a trailing separator");
+    check(parse_thread_cpus("sst_detect:2-2") == thread_cpus_t{{"sst_detect", {2}}}, "a range of one CPU");
+    check(parse_thread_cpus("sst_detect:") == thread_cpus_t{{"sst_detect", {}}}, "a role with an empty CPU list");
+    check(parse_thread_cpus("sst_detect:1;sst_detect:2") == thread_cpus_t{{"sst_detect", {2}}},
+          "a repeated role takes its last CPU list");
+}
+
+static void test_malformed_options() {
+    const std::vector<std::string> malformed = {
+            "sst_detect",             // no CPU list
+            "sst_detect:1;rdmc_poll",  // no CPU list in a later entry
+            ":1",                     // no role
+            " :1",
+            "sst_detect:0-3x",  // trailing garbage, which stoi alone would ignore
+            "sst_detect:x",
+            "sst_detect:1.5",
+            "sst_detect:-1",
+            "sst_detect:3-1",  // empty range
+            "sst_detect:1--2",
+            "sst_detect:1-",
+            "sst_detect:-",
+            "sst_detect:99999999999999999999",  // out of range for stoi
+            "sst_detect:" + std::to_string(CPU_SETSIZE),
+            "sst_detect:0-" + std::to_string(CPU_SETSIZE)};
+    for(const std::string& option : malformed) {
+        const std::string error = parse_error(option);
+        check(error.find("Configuration error") == 0, "\"" + option + "\" is reported as a configuration error");
+    }
+    check(parse_error("sst_detect:0-3x").find("\"3x\"") != std::string::npos, "the error names the malformed CPU");
+    check(parse_error("sst_detect:3-1").find("\"3-1\"") != std::string::npos, "the error names the empty range");
+    check(parse_error("sst_detect:" + std::to_string(CPU_SETSIZE - 1)).empty(), "the largest CPU number is accepted");
+}
+
+int main(int argc, char** argv) {
+    test_valid_options();
+    test_malformed_options();
+    return unit_test::report_result();
+}
@@ -6,6 +6,7 @@
  */
 #include <iostream>
 #include <string>
+#include <vector>
 
 #include <derecho/core/derecho.hpp>
 #include <derecho/mutils-serialization/SerializationSupport.hpp>
@@ -75,4 +76,66 @@ int main(int argc, char** argv) {
         }
         std::this_thread::sleep_for(std::chrono::milliseconds(1000));
     }
+
+    // Under a DESIGNATED policy, only the member at the given shard rank (modulo the shard size)
+    // sends its return value, and the others only acknowledge the call. Going one rank past the
+    // end of the shard checks the wrap-around, which the caller and the replicas must agree on.
+    const std::vector<node_id_t> shard_members = group.get_subgroup_members<StringObject>()[0];
+    bool all_correct = true;
+    for(uint16_t rank = 0; rank <= shard_members.size(); ++rank) {
+        const node_id_t expected_node = shard_members[rank % shard_members.size()];
+        QueryResults<std::string> print_results = rpc_handle.ordered_send_with_reply_policy<RPC_NAME(print)>(
+                ReplyPolicy::designated(rank));
+        QueryResults<std::string>::ReplyMap& string_reply_map = print_results.await_reply_policy();
+        // The caller stops waiting once the node it thinks is designated has replied
+        if(!string_reply_map.is_ready(expected_node)) {
+            std::cout << "FAILED: reply policy for rank " << rank << " satisfied before node " << expected_node << " replied" << std::endl;
+            all_correct = false;
+        }
+        for(auto& reply : string_reply_map) {
+            try {
+                std::string function_result = reply.second.get();
+                if(reply.first != expected_node) {
+                    std::cout << "FAILED: node " << reply.first << " sent a value for designated rank " << rank
+                              << ", but node " << expected_node << " is at that rank" << std::endl;
+                    all_correct = false;
+                }
+            } catch(reply_omitted_exception& ex) {
+                if(reply.first == expected_node) {
+                    std::cout << "FAILED: designated node " << expected_node << " for rank " << rank
+                              << " only acknowledged the call" << std::endl;
+                    all_correct = false;
+                }
+            }
+        }
+        std::cout << "Designated rank " << rank << ": reply value from node " << expected_node << std::endl;
+    }
+
+    // Under FIRST_K, the first k members in rank order send values and the rest only acknowledge
+    const uint16_t k = 2;
+    QueryResults<std::string> first_k_results = rpc_handle.ordered_send_with_reply_policy<RPC_NAME(print)>(
+            ReplyPolicy::first_k(k));
+    QueryResults<std::string>::ReplyMap& first_k_reply_map = first_k_results.await_reply_policy();
+    for(std::size_t rank = 0; rank < shard_members.size(); ++rank) {
+        const node_id_t member = shard_members[rank];
+        if(rank < k && !first_k_reply_map.is_ready(member)) {
+            std::cout << "FAILED: reply policy for first " << k << " satisfied before node " << member << " replied" << std::endl;
+            all_correct = false;
+        }
+        try {
+            first_k_reply_map.get(member);
+            if(rank >= k) {
+                std::cout << "FAILED: node " << member << " at rank " << rank << " sent a value for first " << k << std::endl;
+                all_correct = false;
+            }
+        } catch(reply_omitted_exception& ex) {
+            if(rank < k) {
+                std::cout << "FAILED: node " << member << " at rank " << rank << " only acknowledged the call" << std::endl;
+                all_correct = false;
+            }
+        }
+    }
+    std::cout << (all_correct ? "PASSED" : "FAILED") << std::endl;
+    group.barrier_sync();
+    group.leave();
 }
@@ -0,0 +1,307 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/detail/rpc_trace.hpp>
+#include <derecho/core/register_rpc_functions.hpp>
+#include <derecho/utils/logger.hpp>
+
+#include <cstring>
+#include <fcntl.h>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using derecho::rpc::RPCReplayResult;
+using derecho::rpc::RPCTraceReader;
+using derecho::rpc::RPCTraceRecord;
+using derecho::rpc::RPCTraceRecorder;
+using derecho::rpc::RPCTraceReplayer;
+using persistent::version_t;
+using unit_test::check;
+
+/**
+ * Tests RPC trace recording and replay without a Group. RPC messages built
+ * for a small persistent type are recorded in two subgroups' traces, enough
+ * of them that the recorder hands buffers off to its writer thread while
+ * recording continues. Reading each trace back must return every record of
+ * its subgroup, unchanged and in order, and a trace whose last record was
+ * torn must end before that record. Replaying a trace must apply every
+ * message to a standalone object, with the recorded versions, and persist it
+ * as often as requested. The traces are stored in ./rpc_trace_test.<subgroup>
+ * and the replayed object under ./rpc_trace_test.plog.
+ *
+ * Finally, a trace is recorded into a FIFO that is not read until recording
+ * is done, so the writer thread blocks and the recorder has to drop records.
+ * The reader and the replayer must stop at the gap record that marks them.
+ */
+
+class TraceCounter : public mutils::ByteRepresentable {
+public:
+    persistent::Persistent<std::string> text;
+    int64_t total;
+    uint64_t text_bytes;
+
+    TraceCounter(persistent::PersistentRegistry* registry) : text(registry), total(0), text_bytes(0) {}
+    TraceCounter(persistent::Persistent<std::string>& other_text, int64_t total, uint64_t text_bytes)
+            : text(std::move(other_text)), total(total), text_bytes(text_bytes) {}
+
+    void add(const int64_t& amount) {
+        total += amount;
+    }
+
+    void set_text(const std::string& new_text) {
+        *text = new_text;
+        text_bytes += new_text.size();
+    }
+
+    REGISTER_RPC_FUNCTIONS(TraceCounter, ORDERED_TARGETS(add, set_text));
+    DEFAULT_SERIALIZATION_SUPPORT(TraceCounter, text, total, text_bytes);
+};
+
+const std::string TRACE_PREFIX = "rpc_trace_test";
+const std::string PERS_PATH = "rpc_trace_test.plog";
+constexpr derecho::subgroup_id_t SUBGROUP = 3;
+constexpr derecho::subgroup_id_t OTHER_SUBGROUP = 4;
+constexpr derecho::subgroup_id_t GAP_SUBGROUP = 5;
+const std::string GAP_TRACE_PREFIX = "rpc_trace_test_gap";
+constexpr uint32_t NUM_MESSAGES = 600;
+/** With NUM_MESSAGES / 2 of them, the texts pass the recorder's FLUSH_THRESHOLD twice */
+constexpr std::size_t TEXT_SIZE = 8000;
+constexpr uint32_t PERSIST_INTERVAL = 16;
+
+/** A message as it is recorded */
+struct TracedMessage {
+    node_id_t sender_id;
+    version_t version;
+    uint64_t timestamp_us;
+    std::vector<uint8_t> bytes;
+};
+
+/** Builds RPC messages the way ordered_send() does for a Replicated<TraceCounter> */
+class MessageBuilder {
+    std::unique_ptr<TraceCounter> no_object;
+    std::map<derecho::rpc::Opcode, derecho::rpc::receive_fun_t> no_receivers;
+    decltype(derecho::rpc::make_replay_invocable_class(&no_object, no_receivers)) invocable;
+
+public:
+    MessageBuilder() : invocable(derecho::rpc::make_replay_invocable_class(&no_object, no_receivers)) {}
+
+    template <derecho::rpc::FunctionTag Tag, typename... Args>
+    std::vector<uint8_t> build(Args&&... args) {
+        std::vector<uint8_t> bytes;
+        invocable->template send<derecho::rpc::to_internal_tag<false>(Tag)>(
+                [&bytes](std::size_t size) {
+                    bytes.resize(size);
+                    return bytes.data();
+                },
+                std::forward<Args>(args)...);
+        return bytes;
+    }
+};
+
+/** The text set by the message with the given index, if it calls set_text */
+static std::string text_of(uint32_t index) {
+    return std::string(TEXT_SIZE, static_cast<char>('a' + index % 26));
+}
+
+/** The messages for SUBGROUP, alternating between the two functions, and the total they lead to */
+static std::vector<TracedMessage> make_messages(int64_t& expected_total) {
+    MessageBuilder builder;
+    std::vector<TracedMessage> messages;
+    for(uint32_t i = 0; i < NUM_MESSAGES; ++i) {
+        TracedMessage message{i % 2, static_cast<version_t>(i + 1), 1000000 + i * 10, {}};
+        if(i % 2 == 0) {
+            const int64_t amount = i;
+            message.bytes = builder.build<RPC_NAME(add)>(amount);
+            expected_total += amount;
+        } else {
+            message.bytes = builder.build<RPC_NAME(set_text)>(text_of(i));
+        }
+        messages.push_back(std::move(message));
+    }
+    return messages;
+}
+
+static bool matches(const RPCTraceRecord& record, const uint8_t* msg_buf, const TracedMessage& message) {
+    return record.version == message.version && record.timestamp_us == message.timestamp_us
+           && record.sender_id == message.sender_id && record.size == message.bytes.size()
+           && memcmp(msg_buf, message.bytes.data(), message.bytes.size()) == 0;
+}
+
+/** @return The number of records read before the first one that differs from messages */
+static std::size_t num_matching_records(RPCTraceReader& reader, const std::vector<TracedMessage>& messages) {
+    RPCTraceRecord record;
+    const uint8_t* msg_buf;
+    std::size_t count = 0;
+    while(reader.next(record, msg_buf)) {
+        if(count >= messages.size() || !matches(record, msg_buf, messages[count])) {
+            break;
+        }
+        ++count;
+    }
+    return count;
+}
+
+static void test_record_and_read(const std::vector<TracedMessage>& messages) {
+    MessageBuilder builder;
+    const std::vector<uint8_t> other_message = builder.build<RPC_NAME(add)>(int64_t{7});
+    {
+        RPCTraceRecorder recorder(TRACE_PREFIX, derecho::rpc::RpcLoggerPtr::get());
+        for(std::size_t i = 0; i < messages.size(); ++i) {
+            const TracedMessage& message = messages[i];
+            recorder.record(SUBGROUP, message.sender_id, message.version, message.timestamp_us,
+                            message.bytes.data(), message.bytes.size());
+            if(i % 100 == 0) {
+                recorder.record(OTHER_SUBGROUP, 1, i, 0, other_message.data(), other_message.size());
+            }
+        }
+        recorder.flush();
+        check(std::filesystem::file_size(TRACE_PREFIX + "." + std::to_string(SUBGROUP)) > 2 * RPCTraceRecorder::FLUSH_THRESHOLD,
+              "flush() writes out every buffered record");
+    }
+
+    RPCTraceReader reader(TRACE_PREFIX + "." + std::to_string(SUBGROUP));
+    check(reader.get_subgroup_id() == SUBGROUP, "the trace file records its subgroup");
+    check(num_matching_records(reader, messages) == messages.size(), "every record reads back unchanged and in order");
+    RPCTraceRecord record;
+    const uint8_t* msg_buf;
+    check(!reader.next(record, msg_buf), "the trace ends after the last record");
+    reader.rewind();
+    check(reader.next(record, msg_buf) && matches(record, msg_buf, messages[0]), "rewind() restarts from the first record");
+
+    RPCTraceReader other_reader(TRACE_PREFIX + "." + std::to_string(OTHER_SUBGROUP));
+    std::size_t num_other = 0;
+    bool other_valid = other_reader.get_subgroup_id() == OTHER_SUBGROUP;
+    while(other_reader.next(record, msg_buf)) {
+        other_valid = other_valid && record.version == static_cast<version_t>(100 * num_other++)
+                      && record.size == other_message.size();
+    }
+    check(other_valid && num_other == (messages.size() + 99) / 100, "each subgroup is recorded in its own trace file");
+
+    // A crash while the last record was being written
+    const std::string torn_trace = TRACE_PREFIX + ".torn";
+    std::filesystem::copy_file(TRACE_PREFIX + "." + std::to_string(SUBGROUP), torn_trace,
+                               std::filesystem::copy_options::overwrite_existing);
+    std::filesystem::resize_file(torn_trace, std::filesystem::file_size(torn_trace) - 5);
+    RPCTraceReader torn_reader(torn_trace);
+    check(num_matching_records(torn_reader, messages) == messages.size() - 1 && !torn_reader.next(record, msg_buf),
+          "a torn last record ends the trace before it");
+    std::filesystem::remove(torn_trace);
+}
+
+static void test_replay(const std::vector<TracedMessage>& messages, int64_t expected_total) {
+    RPCTraceReader reader(TRACE_PREFIX + "." + std::to_string(SUBGROUP));
+    RPCTraceReplayer<TraceCounter> replayer([](persistent::PersistentRegistry* registry, derecho::subgroup_id_t) {
+        return std::make_unique<TraceCounter>(registry);
+    });
+    const RPCReplayResult result = replayer.replay(reader, PERSIST_INTERVAL);
+    TraceCounter& object = replayer.get_object();
+    check(object.total == expected_total && object.text_bytes == TEXT_SIZE * (messages.size() / 2)
+                  && *object.text == text_of(messages.size() - 1),
+          "replaying the trace applies every message in order");
+    bool versions_match = object.text.getLatestVersion() == messages.back().version;
+    for(uint32_t i = 1; i < messages.size(); i += 2) {
+        versions_match = versions_match && *object.text.get(messages[i].version) == text_of(i);
+    }
+    check(versions_match, "replaying the trace creates the recorded versions");
+    check(object.text.getLastPersistedVersion() == messages.back().version,
+          "the last version is persisted at the end of the replay");
+    check(result.persist_count == (messages.size() + PERSIST_INTERVAL - 1) / PERSIST_INTERVAL,
+          "the object is persisted every persist_interval versions and at the end");
+
+    const auto add_stats = result.functions.find(derecho::rpc::to_internal_tag<false>(RPC_NAME(add)));
+    const auto set_text_stats = result.functions.find(derecho::rpc::to_internal_tag<false>(RPC_NAME(set_text)));
+    check(result.functions.size() == 2 && add_stats != result.functions.end() && set_text_stats != result.functions.end()
+                  && add_stats->second.count == messages.size() / 2 && set_text_stats->second.count == messages.size() / 2,
+          "the replay counts the messages of each function");
+    uint64_t set_text_bytes = 0;
+    for(std::size_t i = 1; i < messages.size(); i += 2) {
+        set_text_bytes += messages[i].bytes.size();
+    }
+    check(set_text_stats != result.functions.end() && set_text_stats->second.bytes == set_text_bytes,
+          "the replay counts the bytes of each function's messages");
+}
+
+static void test_gap(const std::vector<TracedMessage>& messages) {
+    const std::string fifo_path = GAP_TRACE_PREFIX + "." + std::to_string(GAP_SUBGROUP);
+    const std::string captured_trace = GAP_TRACE_PREFIX + ".captured";
+    std::filesystem::remove(fifo_path);
+    check(mkfifo(fifo_path.c_str(), S_IRUSR | S_IWUSR) == 0, "the FIFO for the gap test is created");
+    // Opening the read end first lets the recorder open the write end without blocking
+    int fifo_fd = open(fifo_path.c_str(), O_RDONLY | O_NONBLOCK);
+    fcntl(fifo_fd, F_SETFL, fcntl(fifo_fd, F_GETFL) & ~O_NONBLOCK);
+    std::thread drain_thread;
+    {
+        RPCTraceRecorder recorder(GAP_TRACE_PREFIX, derecho::rpc::RpcLoggerPtr::get(), RPCTraceRecorder::FLUSH_THRESHOLD);
+        // The first buffer handed off fills the FIFO, so the rest of the messages overflow the other one
+        for(const TracedMessage& message : messages) {
+            recorder.record(GAP_SUBGROUP, message.sender_id, message.version, message.timestamp_us,
+                            message.bytes.data(), message.bytes.size());
+        }
+        drain_thread = std::thread([fifo_fd, captured_trace]() {
+            int capture_fd = open(captured_trace.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+            uint8_t buf[1 << 16];
+            ssize_t n;
+            while((n = read(fifo_fd, buf, sizeof(buf))) > 0) {
+                if(write(capture_fd, buf, n) != n) {
+                    break;
+                }
+            }
+            close(capture_fd);
+        });
+        recorder.flush();
+        // A record accepted after the gap must not be read as if it followed on
+        const TracedMessage& last = messages.back();
+        recorder.record(GAP_SUBGROUP, last.sender_id, last.version + 1, last.timestamp_us + 10,
+                        last.bytes.data(), last.bytes.size());
+    }
+    drain_thread.join();
+    close(fifo_fd);
+    std::filesystem::remove(fifo_path);
+
+    RPCTraceReader reader(captured_trace);
+    const std::size_t num_before_gap = num_matching_records(reader, messages);
+    check(num_before_gap > 0 && num_before_gap < messages.size(), "records are dropped when the writer cannot keep up");
+    check(reader.reached_gap() && reader.get_gap_version() == messages[num_before_gap].version,
+          "the reader stops at a gap record naming the first dropped version");
+    RPCTraceRecord record;
+    const uint8_t* msg_buf;
+    check(!reader.next(record, msg_buf), "the reader does not read past a gap");
+
+    std::filesystem::remove_all(PERS_PATH);
+    reader.rewind();
+    check(!reader.reached_gap(), "rewind() clears the gap");
+    RPCTraceReplayer<TraceCounter> replayer([](persistent::PersistentRegistry* registry, derecho::subgroup_id_t) {
+        return std::make_unique<TraceCounter>(registry);
+    });
+    const RPCReplayResult result = replayer.replay(reader, 0);
+    uint64_t num_replayed = 0;
+    for(const auto& [tag, stats] : result.functions) {
+        num_replayed += stats.count;
+    }
+    check(num_replayed == num_before_gap && result.gap_version == messages[num_before_gap].version,
+          "the replay stops at the gap and reports it");
+    std::filesystem::remove(captured_trace);
+}
+
+int main(int argc, char** argv) {
+    std::string file_path = "--" + std::string(derecho::Conf::PERS_FILE_PATH) + "=" + PERS_PATH;
+    std::string max_data_size = "--" + std::string(derecho::Conf::PERS_MAX_DATA_SIZE) + "=" + std::to_string(64 << 20);
+    std::vector<char*> conf_args = {argv[0], file_path.data(), max_data_size.data()};
+    derecho::Conf::initialize(conf_args.size(), conf_args.data());
+    LoggerFactory::createIfAbsent(LoggerFactory::RPC_LOGGER_NAME, "info");
+    derecho::rpc::RpcLoggerPtr::initialize();
+
+    std::filesystem::remove_all(PERS_PATH);
+    int64_t expected_total = 0;
+    const std::vector<TracedMessage> messages = make_messages(expected_total);
+    test_record_and_read(messages);
+    test_replay(messages, expected_total);
+    test_gap(messages);
+    return unit_test::report_result();
+}
@@ -0,0 +1,178 @@
+#include <derecho/conf/conf.hpp>
+#include <derecho/core/derecho.hpp>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <vector>
+
+using namespace derecho;
+using std::cout;
+using std::endl;
+using namespace std::chrono_literals;
+
+/**
+ * Tests send_async() across a view change in a group of three nodes that
+ * share one ORDERED raw subgroup. The node with rank 1 streams messages with
+ * send_async() without waiting for anything but a full send queue, and the
+ * node with rank 2 leaves once it has delivered the first num_msgs of them,
+ * so that the stream runs through the view change: some messages are sent in
+ * the old view, some are queued while it is wedged and replayed into the new
+ * one, and the last num_msgs are issued after the sender has installed the
+ * new view. The sender then marks the end of the stream. The two remaining
+ * nodes check that they delivered every message exactly once and in order,
+ * some of them in the new view, and the sender checks that every message was
+ * reported sent and none dropped.
+ */
+
+constexpr uint32_t num_nodes = 3;
+
+/** The payload of each streamed message */
+struct StreamMessage {
+    uint32_t counter;
+    /** The number of messages in the stream, set only in the last one */
+    uint32_t total;
+};
+
+int main(int argc, char** argv) {
+    const int num_args = 1;
+    if(argc < (num_args + 1) || (argc > (num_args + 1) && strcmp("--", argv[argc - (num_args + 1)]) != 0)) {
+        cout << "Invalid command line arguments." << endl;
+        cout << "USAGE: " << argv[0] << " [ derecho-config-list -- ] num_msgs" << endl;
+        return -1;
+    }
+    Conf::initialize(argc, argv);
+    const uint32_t num_msgs = std::stoi(argv[argc - num_args]);
+
+    // The group must stay provisioned after the leaving node is gone
+    SubgroupInfo subgroup_info([](const std::vector<std::type_index>& subgroup_type_order,
+                                  const std::unique_ptr<View>& prev_view, View& curr_view) {
+        if(!prev_view && curr_view.members.size() < num_nodes) {
+            throw subgroup_provisioning_exception();
+        }
+        return one_subgroup_entire_view(subgroup_type_order, prev_view, curr_view);
+    });
+
+    std::mutex test_mutex;
+    std::condition_variable delivery_cv;
+    bool passed = true;
+    std::atomic<node_id_t> sender_id = 0;
+    // The counters in the sender's messages, and the view each was delivered in, in delivery order
+    std::vector<uint32_t> delivered_counters;
+    std::vector<int32_t> delivered_vids;
+    uint32_t stream_total = 0;
+    int32_t leave_vid = -1;
+
+    UserMessageCallbacks callbacks;
+    callbacks.global_stability_callback = [&](subgroup_id_t subgroup_num, node_id_t sender, message_id_t index,
+                                              std::optional<std::pair<uint8_t*, long long int>> data,
+                                              persistent::version_t version) {
+        if(sender != sender_id || !data) {
+            return;
+        }
+        StreamMessage message;
+        memcpy(&message, data->first, sizeof(message));
+        std::lock_guard<std::mutex> lock(test_mutex);
+        delivered_counters.push_back(message.counter);
+        delivered_vids.push_back(persistent::unpack_version<int32_t>(version).first);
+        if(message.total != 0) {
+            stream_total = message.total;
+        }
+        delivery_cv.notify_all();
+    };
+    auto view_upcall = [&](const View& view) {
+        std::lock_guard<std::mutex> lock(test_mutex);
+        if(view.members.size() < num_nodes) {
+            leave_vid = view.vid;
+            delivery_cv.notify_all();
+        }
+    };
+
+    Group<RawObject> group(callbacks, subgroup_info, std::vector<DeserializationContext*>{},
+                           std::vector<view_upcall_t>{view_upcall}, &raw_object_factory);
+    cout << "Finished constructing/joining Group" << endl;
+    sender_id = group.get_members()[1];
+    const int32_t my_rank = group.get_my_rank();
+    Replicated<RawObject>& group_as_subgroup = group.get_subgroup<RawObject>();
+    // Every node must have set sender_id before any message is delivered
+    group.barrier_sync();
+
+    if(my_rank == static_cast<int32_t>(num_nodes) - 1) {
+        {
+            std::unique_lock<std::mutex> lock(test_mutex);
+            delivery_cv.wait(lock, [&]() { return delivered_counters.size() >= num_msgs; });
+        }
+        group.leave(false);
+        cout << "Left the group" << endl;
+        return 0;
+    }
+
+    std::atomic<uint32_t> num_sent = 0;
+    std::atomic<uint32_t> num_dropped = 0;
+    if(my_rank == 1) {
+        auto stream_send = [&](const StreamMessage& message) {
+            // Retry while the send queue is full
+            while(!group_as_subgroup.send_async(
+                    sizeof(message),
+                    [message](uint8_t* buf) { memcpy(buf, &message, sizeof(message)); },
+                    [&](bool sent) { sent ? num_sent++ : num_dropped++; })) {
+                std::this_thread::sleep_for(1ms);
+            }
+        };
+        uint32_t counter = 0;
+        // Send until this node has installed the view without the leaving node, then num_msgs more
+        std::optional<uint32_t> stream_end;
+        while(!stream_end || counter < *stream_end) {
+            stream_send({counter++, 0});
+            if(!stream_end) {
+                std::lock_guard<std::mutex> lock(test_mutex);
+                if(leave_vid != -1) {
+                    stream_end = counter + num_msgs;
+                }
+            }
+        }
+        stream_send({counter, counter + 1});
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(test_mutex);
+        delivery_cv.wait(lock, [&]() { return stream_total != 0; });
+        if(delivered_counters.size() != stream_total) {
+            cout << "FAILED: delivered " << delivered_counters.size() << " messages from a stream of "
+                 << stream_total << endl;
+            passed = false;
+        }
+        for(uint32_t i = 0; i < delivered_counters.size(); ++i) {
+            if(delivered_counters[i] != i) {
+                cout << "FAILED: message " << delivered_counters[i] << " was delivered in position " << i << endl;
+                passed = false;
+                break;
+            }
+        }
+        uint32_t num_in_new_view = 0;
+        for(int32_t vid : delivered_vids) {
+            num_in_new_view += vid >= leave_vid ? 1 : 0;
+        }
+        if(num_in_new_view < num_msgs || num_in_new_view == delivered_vids.size()) {
+            cout << "FAILED: " << num_in_new_view << " of the " << delivered_vids.size()
+                 << " messages were delivered in the view without the leaving node" << endl;
+            passed = false;
+        }
+        cout << num_in_new_view << " of " << delivered_vids.size() << " messages were delivered in the new view" << endl;
+    }
+    if(my_rank == 1 && (num_sent != stream_total || num_dropped != 0)) {
+        cout << "FAILED: " << num_sent << " of " << stream_total << " messages were reported sent and "
+             << num_dropped << " were dropped" << endl;
+        passed = false;
+    }
+    cout << (passed ? "PASSED" : "FAILED") << endl;
+
+    group.barrier_sync();
+    group.leave(true);
+    return passed ? 0 : 1;
+}
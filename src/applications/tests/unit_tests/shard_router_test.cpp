@@ -0,0 +1,271 @@
+#include <derecho/core/shard_router.hpp>
+
+#include <algorithm>
+#include <set>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using derecho::ShardRouter;
+using unit_test::check;
+
+/**
+ * Tests ShardRouter without a Group, since it only depends on the members of
+ * each shard: the batched hash and batched routing must agree with their
+ * one-key versions, and an update must only move the keys that consistent
+ * hashing (for shards) and rendezvous hashing (for members) say it moves.
+ */
+
+constexpr std::size_t NUM_KEYS = 20000;
+
+static std::vector<std::string> make_keys() {
+    std::vector<std::string> keys;
+    for(std::size_t i = 0; i < NUM_KEYS; ++i) {
+        keys.push_back("key" + std::to_string(i));
+    }
+    return keys;
+}
+
+static std::vector<ShardRouter::Route> route_all(const ShardRouter& router, const std::vector<std::string>& keys) {
+    std::vector<ShardRouter::Route> routes;
+    for(const std::string& key : keys) {
+        routes.push_back(router.route(key));
+    }
+    return routes;
+}
+
+static bool same_routes(const std::vector<ShardRouter::Route>& a, const std::vector<ShardRouter::Route>& b) {
+    if(a.size() != b.size()) {
+        return false;
+    }
+    for(std::size_t i = 0; i < a.size(); ++i) {
+        if(a[i].shard_num != b[i].shard_num || a[i].node_id != b[i].node_id) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_hash_keys() {
+    // Every length from empty to several words, in groups that mix lengths within the lanes of hash_keys
+    std::string bytes;
+    for(int i = 0; i < 200; ++i) {
+        bytes.push_back(static_cast<char>(i * 37 + 11));
+    }
+    std::vector<std::string_view> keys;
+    for(std::size_t length = 0; length <= 40; ++length) {
+        // Start at odd offsets too, so the words are not aligned
+        keys.push_back(std::string_view(bytes).substr(length % 7, length));
+        keys.push_back(std::string_view(bytes).substr(100 + length, 40 - length));
+    }
+    for(std::size_t num_keys = 0; num_keys <= keys.size(); ++num_keys) {
+        std::vector<uint64_t> hashes(num_keys + 1, 0);
+        ShardRouter::hash_keys(keys.data(), num_keys, hashes.data());
+        bool all_match = hashes[num_keys] == 0;
+        for(std::size_t i = 0; i < num_keys; ++i) {
+            all_match = all_match && hashes[i] == ShardRouter::hash_key(keys[i]);
+        }
+        check(all_match, "hash_keys of " + std::to_string(num_keys) + " keys matches hash_key");
+    }
+    check(ShardRouter::hash_key("a") != ShardRouter::hash_key(std::string_view("a\0", 2)),
+          "keys that differ only by a trailing zero byte have different hashes");
+}
+
+static void test_route_batch() {
+    // Node 3 is in two shards, so it must get one group with the keys of both
+    ShardRouter router;
+    router.update({{1, 2, 3}, {3, 4}, {5}, {6, 7, 8, 9}});
+    const std::vector<std::string> keys = make_keys();
+    const std::vector<ShardRouter::Route> routes = route_all(router, keys);
+
+    ShardRouter::BatchRoutes batch;
+    for(std::size_t num_keys : {std::size_t{0}, std::size_t{1}, std::size_t{255}, std::size_t{257}, NUM_KEYS}) {
+        const std::string description = " for " + std::to_string(num_keys) + " keys";
+        // Reusing the same BatchRoutes must not leave anything from the previous batch
+        std::vector<std::string_view> key_views(keys.begin(), keys.begin() + num_keys);
+        router.route_batch(key_views.data(), num_keys, batch);
+        check(batch.offsets.size() == batch.nodes.size() + 1 && batch.offsets.front() == 0
+                      && batch.offsets.back() == num_keys && batch.key_indices.size() == num_keys,
+              "offsets delimit all the keys" + description);
+        check(std::set<node_id_t>(batch.nodes.begin(), batch.nodes.end()).size() == batch.nodes.size(),
+              "each node appears once" + description);
+        std::vector<bool> seen(num_keys, false);
+        bool matches_route = true;
+        bool in_batch_order = true;
+        for(std::size_t n = 0; n < batch.nodes.size(); ++n) {
+            in_batch_order = in_batch_order && batch.offsets[n] < batch.offsets[n + 1];
+            for(std::size_t k = batch.offsets[n]; k < batch.offsets[n + 1]; ++k) {
+                const std::size_t key_index = batch.key_indices[k];
+                matches_route = matches_route && key_index < num_keys && !seen[key_index]
+                                && routes[key_index].node_id == batch.nodes[n];
+                in_batch_order = in_batch_order && (k == batch.offsets[n] || batch.key_indices[k - 1] < key_index);
+                if(key_index < num_keys) {
+                    seen[key_index] = true;
+                }
+            }
+        }
+        check(matches_route, "route_batch sends each key once, to the node route() picks" + description);
+        check(in_batch_order, "each node's keys are nonempty and in batch order" + description);
+    }
+    check(batch.nodes.size() == 9, "all 9 nodes get keys from a large batch");
+
+    ShardRouter::BatchRoutes from_vector = router.route_batch(keys);
+    check(from_vector.nodes == batch.nodes && from_vector.offsets == batch.offsets && from_vector.key_indices == batch.key_indices,
+          "route_batch of a vector matches route_batch of an array");
+}
+
+static void test_minimal_movement() {
+    const std::vector<std::string> keys = make_keys();
+    const std::vector<std::vector<node_id_t>> three_shards = {{1, 2, 3}, {4, 5, 6}, {7, 8, 9}};
+    ShardRouter router;
+    check(router.update(three_shards), "the first update changes the routes");
+    check(!router.update(three_shards), "an update with the same members does not change the routes");
+    const std::vector<ShardRouter::Route> before = route_all(router, keys);
+    std::vector<std::size_t> keys_per_shard(3, 0);
+    for(const ShardRouter::Route& route : before) {
+        keys_per_shard[route.shard_num]++;
+    }
+    for(std::size_t count : keys_per_shard) {
+        check(count > NUM_KEYS / 6 && count < NUM_KEYS / 2, "keys are spread over the shards");
+    }
+
+    // Adding a shard only moves keys to it, about a quarter of them
+    std::vector<std::vector<node_id_t>> four_shards = three_shards;
+    four_shards.push_back({10, 11});
+    check(router.update(four_shards), "adding a shard changes the routes");
+    const std::vector<ShardRouter::Route> after_add = route_all(router, keys);
+    std::size_t moved = 0;
+    bool only_to_new_shard = true;
+    for(std::size_t i = 0; i < NUM_KEYS; ++i) {
+        if(after_add[i].shard_num != before[i].shard_num) {
+            moved++;
+            only_to_new_shard = only_to_new_shard && after_add[i].shard_num == 3;
+        } else {
+            only_to_new_shard = only_to_new_shard && after_add[i].node_id == before[i].node_id;
+        }
+    }
+    check(only_to_new_shard, "adding a shard only moves keys to the new shard");
+    check(moved > NUM_KEYS / 8 && moved < NUM_KEYS * 3 / 8, "adding a fourth shard moves about a quarter of the keys");
+    ShardRouter fresh_four;
+    fresh_four.update(four_shards);
+    check(same_routes(route_all(fresh_four, keys), after_add), "an updated router routes like a new one");
+
+    // Removing the shard again restores the original routes
+    router.update(three_shards);
+    check(same_routes(route_all(router, keys), before), "removing the added shard restores the routes");
+
+    // A member joining a shard only takes keys of that shard, about a quarter of them
+    std::vector<std::vector<node_id_t>> joined = three_shards;
+    joined[0].push_back(12);
+    router.update(joined);
+    const std::vector<ShardRouter::Route> after_join = route_all(router, keys);
+    std::size_t moved_to_joined = 0;
+    bool only_to_joined = true;
+    for(std::size_t i = 0; i < NUM_KEYS; ++i) {
+        if(after_join[i].node_id != before[i].node_id) {
+            moved_to_joined++;
+            only_to_joined = only_to_joined && after_join[i].node_id == 12;
+        }
+        only_to_joined = only_to_joined && after_join[i].shard_num == before[i].shard_num;
+    }
+    check(only_to_joined, "a joining member only takes keys, and no key changes shard");
+    check(moved_to_joined > keys_per_shard[0] / 8 && moved_to_joined < keys_per_shard[0] * 3 / 8,
+          "a fourth member of a shard takes about a quarter of its keys");
+
+    // A member leaving only moves its own keys, to the other members of its shard
+    std::vector<std::vector<node_id_t>> left = three_shards;
+    left[1] = {4, 6};
+    router.update(left);
+    const std::vector<ShardRouter::Route> after_leave = route_all(router, keys);
+    bool only_from_leaver = true;
+    bool leaver_had_keys = false;
+    for(std::size_t i = 0; i < NUM_KEYS; ++i) {
+        leaver_had_keys = leaver_had_keys || before[i].node_id == 5;
+        if(after_leave[i].node_id != before[i].node_id) {
+            only_from_leaver = only_from_leaver && before[i].node_id == 5 && after_leave[i].shard_num == 1;
+        }
+    }
+    check(leaver_had_keys && only_from_leaver, "a leaving member only gives up its own keys, within its shard");
+    // Reordering the members of a shard changes its member list but not where keys go
+    left[1] = {6, 4};
+    router.update(left);
+    check(same_routes(route_all(router, keys), after_leave), "the order of a shard's members does not affect routing");
+}
+
+static void test_standbys() {
+    // One subgroup of two shards, where node 3 is a warm standby in the first
+    using derecho::IpAndPorts;
+    using derecho::SubView;
+    const std::vector<node_id_t> members = {1, 2, 3, 4, 5};
+    const std::vector<IpAndPorts> member_ips_and_ports(members.size());
+    derecho::View view(0, members, member_ips_and_ports, std::vector<char>(members.size(), 0), {}, {}, 0, 0, {});
+    view.subgroup_shard_views.push_back(
+            {SubView(derecho::Mode::ORDERED, {1, 2, 3}, {1, 1, 0}, {member_ips_and_ports.begin(), member_ips_and_ports.begin() + 3},
+                     "default", {0, 0, 1}),
+             SubView(derecho::Mode::ORDERED, {4, 5}, {1, 1}, {member_ips_and_ports.begin() + 3, member_ips_and_ports.end()},
+                     "default")});
+
+    ShardRouter router;
+    router.update(view, 0);
+    const std::vector<std::string> keys = make_keys();
+    const std::vector<ShardRouter::Route> routes = route_all(router, keys);
+    bool to_standby = false;
+    for(const ShardRouter::Route& route : routes) {
+        to_standby = to_standby || route.node_id == 3;
+    }
+    check(!to_standby, "no key is routed to a warm standby");
+    ShardRouter without_standby;
+    without_standby.update({{1, 2}, {4, 5}});
+    check(same_routes(routes, route_all(without_standby, keys)), "a shard with a standby routes like one without it");
+    const std::vector<std::string> batch_keys(keys.begin(), keys.begin() + 1000);
+    ShardRouter::BatchRoutes batch = router.route_batch(batch_keys);
+    check(std::find(batch.nodes.begin(), batch.nodes.end(), 3) == batch.nodes.end(),
+          "no batch of keys is sent to a warm standby");
+
+    bool threw = false;
+    try {
+        router.update(view, 1);
+    } catch(derecho::derecho_exception&) {
+        threw = true;
+    }
+    check(threw, "updating to a subgroup the view does not have throws");
+}
+
+static void test_errors() {
+    bool threw = false;
+    try {
+        ShardRouter no_virtual_nodes(0);
+    } catch(derecho::derecho_exception&) {
+        threw = true;
+    }
+    check(threw, "a router needs virtual nodes");
+
+    ShardRouter router;
+    threw = false;
+    try {
+        router.get_shard("key");
+    } catch(derecho::derecho_exception&) {
+        threw = true;
+    }
+    check(threw, "routing without shards throws");
+
+    router.update({{}, {}});
+    threw = false;
+    try {
+        router.route("key");
+    } catch(derecho::derecho_exception&) {
+        threw = true;
+    }
+    check(threw && router.get_shard("key") < 2, "routing to a shard without members throws, but the shard is known");
+}
+
+int main(int argc, char** argv) {
+    test_hash_keys();
+    test_route_batch();
+    test_minimal_movement();
+    test_standbys();
+    test_errors();
+    return unit_test::report_result();
+}
@@ -245,13 +245,131 @@ void test_json_layout() {
     derecho::test_provision_subgroups(test_json_overlapping, prev_view, *curr_view);
 }
 
+/**
+ * Checks that a shard in an adequately provisioned View has the expected
+ * members and senders, and logs the result.
+ * @return true if the shard matches
+ */
+bool check_shard(const derecho::View& view, derecho::subgroup_id_t subgroup_id, uint32_t shard_num,
+                 const std::vector<node_id_t>& expected_members, const std::vector<int>& expected_senders) {
+    if(!view.is_adequately_provisioned) {
+        rls_default_info("FAILED: the View is inadequate, but shard {} should have members {}", shard_num, expected_members);
+        return false;
+    }
+    const derecho::SubView& shard_view = view.subgroup_shard_views.at(subgroup_id).at(shard_num);
+    if(shard_view.members != expected_members || shard_view.is_sender != expected_senders) {
+        rls_default_info("FAILED: shard {} has members {} and senders {}, but should have members {} and senders {}",
+                         shard_num, shard_view.members, shard_view.is_sender, expected_members, expected_senders);
+        return false;
+    }
+    return true;
+}
+
+bool test_standby_nodes() {
+    using derecho::DefaultSubgroupAllocator;
+    using derecho::SubgroupAllocationPolicy;
+    bool passed = true;
+    std::vector<derecho::Mode> two_ordered(2, derecho::Mode::ORDERED);
+    std::vector<std::string> two_default_profiles(2, "default");
+
+    //Two shards of 2 nodes, where node 4 is a standby for shard 0 and node 5 for shard 1
+    derecho::ShardAllocationPolicy standby_shards = derecho::custom_shards_policy({2, 2}, {2, 2}, two_ordered, two_default_profiles);
+    standby_shards.standby_node_ids_by_shard = {{4}, {5}};
+    derecho::SubgroupInfo test_standby_subgroups(
+            DefaultSubgroupAllocator({{std::type_index(typeid(TestType1)), derecho::one_subgroup_policy(standby_shards)}}));
+    std::vector<std::type_index> subgroup_type_order = {std::type_index(typeid(TestType1))};
+
+    std::vector<node_id_t> members(6);
+    std::iota(members.begin(), members.end(), 0);
+    std::vector<derecho::IpAndPorts> ips_and_ports(members.size());
+    std::generate(ips_and_ports.begin(), ips_and_ports.end(), ip_and_ports_generator);
+    std::vector<char> none_failed(members.size(), 0);
+    auto curr_view = std::make_unique<derecho::View>(0, members, ips_and_ports, none_failed,
+                                                     std::vector<node_id_t>{}, std::vector<node_id_t>{},
+                                                     0, 0, subgroup_type_order);
+    rls_default_info("Now testing standby nodes");
+    rls_default_info("TEST 15: Initial allocation; standby nodes 4 and 5 stay idle");
+    derecho::test_provision_subgroups(test_standby_subgroups, nullptr, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {0, 1}, {1, 1});
+    passed &= check_shard(*curr_view, 0, 1, {2, 3}, {1, 1});
+
+    rls_default_info("TEST 16: Node 1 fails; standby node 4 is promoted into shard 0");
+    std::unique_ptr<derecho::View> prev_view(std::move(curr_view));
+    curr_view = derecho::make_next_view(*prev_view, {1}, {}, {});
+    derecho::test_provision_subgroups(test_standby_subgroups, prev_view, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {0, 4}, {1, 1});
+    passed &= check_shard(*curr_view, 0, 1, {2, 3}, {1, 1});
+
+    std::vector<node_id_t> new_member{6};
+    std::vector<derecho::IpAndPorts> new_member_ip(1);
+    std::generate(new_member_ip.begin(), new_member_ip.end(), ip_and_ports_generator);
+    rls_default_info("TEST 17: Node 6 joins; the promoted standby keeps its place, and node 6 stays unassigned");
+    prev_view.swap(curr_view);
+    curr_view = derecho::make_next_view(*prev_view, {}, new_member, new_member_ip);
+    derecho::test_provision_subgroups(test_standby_subgroups, prev_view, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {0, 4}, {1, 1});
+    passed &= check_shard(*curr_view, 0, 1, {2, 3}, {1, 1});
+
+    //Members are now 0, 2, 3, 4, 5, 6, so ranks 1 and 4 are nodes 2 and 5
+    rls_default_info("TEST 18: Nodes 2 and 5 fail; shard 1 has no standby left, so it gets unassigned node 6");
+    prev_view.swap(curr_view);
+    curr_view = derecho::make_next_view(*prev_view, {1, 4}, {}, {});
+    derecho::test_provision_subgroups(test_standby_subgroups, prev_view, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {0, 4}, {1, 1});
+    passed &= check_shard(*curr_view, 0, 1, {3, 6}, {1, 1});
+
+    //A shard of 2 to 3 nodes with warm standby node 3, which receives updates without sending or being counted
+    derecho::ShardAllocationPolicy warm_standby_shard = derecho::custom_shards_policy({2}, {3}, {derecho::Mode::ORDERED}, {"default"});
+    warm_standby_shard.standby_node_ids_by_shard = {{3}};
+    warm_standby_shard.warm_standbys = true;
+    derecho::SubgroupInfo test_warm_standby_subgroups(
+            DefaultSubgroupAllocator({{std::type_index(typeid(TestType1)), derecho::one_subgroup_policy(warm_standby_shard)}}));
+
+    std::vector<node_id_t> warm_members(4);
+    std::iota(warm_members.begin(), warm_members.end(), 0);
+    std::vector<derecho::IpAndPorts> warm_ips_and_ports(warm_members.size());
+    std::generate(warm_ips_and_ports.begin(), warm_ips_and_ports.end(), ip_and_ports_generator);
+    curr_view = std::make_unique<derecho::View>(0, warm_members, warm_ips_and_ports, std::vector<char>(warm_members.size(), 0),
+                                                std::vector<node_id_t>{}, std::vector<node_id_t>{},
+                                                0, 0, subgroup_type_order);
+    rls_default_info("TEST 19: Initial allocation with a warm standby, which is a non-sending member of its shard");
+    derecho::test_provision_subgroups(test_warm_standby_subgroups, nullptr, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {0, 1, 2, 3}, {1, 1, 1, 0});
+
+    rls_default_info("TEST 20: Node 0 fails; the warm standby is promoted to replace it");
+    prev_view = std::move(curr_view);
+    curr_view = derecho::make_next_view(*prev_view, {0}, {}, {});
+    derecho::test_provision_subgroups(test_warm_standby_subgroups, prev_view, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {1, 2, 3}, {1, 1, 1});
+
+    rls_default_info("TEST 21: Node 1 fails; the promoted standby stays in the shard, which keeps its minimum size");
+    prev_view.swap(curr_view);
+    curr_view = derecho::make_next_view(*prev_view, {0}, {}, {});
+    derecho::test_provision_subgroups(test_warm_standby_subgroups, prev_view, *curr_view);
+    passed &= check_shard(*curr_view, 0, 0, {2, 3}, {1, 1});
+
+    rls_default_info("TEST 22: A node that is a standby for two shards is rejected");
+    derecho::ShardAllocationPolicy conflicting_standbys = derecho::custom_shards_policy({2, 2}, {2, 2}, two_ordered, two_default_profiles);
+    conflicting_standbys.standby_node_ids_by_shard = {{4}, {4}};
+    try {
+        DefaultSubgroupAllocator({{std::type_index(typeid(TestType1)), derecho::one_subgroup_policy(conflicting_standbys)}});
+        rls_default_info("FAILED: the allocator accepted node 4 as a standby for two shards");
+        passed = false;
+    } catch(derecho::derecho_exception& ex) {
+        rls_default_info("Got the expected exception: {}", ex.what());
+    }
+    return passed;
+}
+
 int main(int argc, char* argv[]) {
 
     test_fixed_allocation_functions();
     test_flexible_allocation_functions();
     test_json_layout();
+    const bool standby_tests_passed = test_standby_nodes();
+    rls_default_info(standby_tests_passed ? "Standby node tests PASSED" : "Standby node tests FAILED");
 
-    return 0;
+    return standby_tests_passed ? 0 : 1;
 }
 
 namespace derecho {
@@ -263,8 +381,11 @@ void print_subgroup_layout(const subgroup_shard_layout_t& layout) {
         for(std::size_t shard_num = 0; shard_num < layout[subgroup_num].size(); ++shard_num) {
             string_builder << layout[subgroup_num][shard_num].members
                            << "|"
-                           << layout[subgroup_num][shard_num].is_sender
-                           << ", ";
+                           << layout[subgroup_num][shard_num].is_sender;
+            if(!layout[subgroup_num][shard_num].is_standby.empty()) {
+                string_builder << "|standby:" << layout[subgroup_num][shard_num].is_standby;
+            }
+            string_builder << ", ";
         }
         string_builder << "\b\b";
         rls_default_info(string_builder.str());
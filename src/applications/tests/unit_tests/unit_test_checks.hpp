@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+
+/**
+ * Result reporting shared by the unit tests that run without a Group. check()
+ * records a failed condition and lets the test keep going, so that one run
+ * reports every failure; report_result() prints the outcome for main() to
+ * return as the exit status.
+ */
+namespace unit_test {
+
+inline bool passed = true;
+
+inline void check(bool condition, const std::string& description) {
+    if(!condition) {
+        std::cout << "FAILED: " << description << std::endl;
+        passed = false;
+    }
+}
+
+/** @return The exit status of the test: 0 if every check passed, 1 otherwise */
+inline int report_result() {
+    std::cout << (passed ? "PASSED" : "FAILED") << std::endl;
+    return passed ? 0 : 1;
+}
+
+}  // namespace unit_test
@@ -0,0 +1,111 @@
+#include <derecho/persistent/detail/VersionCache.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "unit_test_checks.hpp"
+
+using persistent::VersionCache;
+using unit_test::check;
+
+/**
+ * Tests the LRU cache of historical versions used by Persistent<T>, without a
+ * log: eviction of the least recently used versions when the cache is full,
+ * the handling of objects that don't fit, and the generation check that keeps
+ * an object materialized before a truncation from being cached after it.
+ */
+
+using StringCache = VersionCache<std::string>;
+
+static std::shared_ptr<const std::string> object_for(persistent::version_t ver) {
+    return std::make_shared<const std::string>("version " + std::to_string(ver));
+}
+
+/** @return true if the cache holds the given versions, with the objects object_for() makes, and none of the absent ones */
+static bool holds(StringCache& cache, const std::vector<persistent::version_t>& versions,
+                  const std::vector<persistent::version_t>& absent_versions) {
+    for(persistent::version_t ver : versions) {
+        std::shared_ptr<const std::string> object = cache.lookup(ver);
+        if(!object || *object != *object_for(ver)) {
+            return false;
+        }
+    }
+    for(persistent::version_t ver : absent_versions) {
+        if(cache.lookup(ver)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_lru_eviction() {
+    StringCache cache(100);
+    check(cache.lookup(1) == nullptr, "lookup in an empty cache");
+    for(persistent::version_t ver = 1; ver <= 3; ++ver) {
+        cache.insert(ver, object_for(ver), 30, cache.getGeneration());
+    }
+    check(cache.getUsedBytes() == 90 && holds(cache, {1, 2, 3}, {}), "versions are cached while they fit");
+
+    // The lookups above used 1, 2, 3 in that order, so 1 is the least recently used
+    cache.insert(4, object_for(4), 30, cache.getGeneration());
+    check(cache.getUsedBytes() == 90 && holds(cache, {2, 3, 4}, {1}), "a full cache evicts the least recently used version");
+    cache.lookup(2);
+    cache.insert(5, object_for(5), 30, cache.getGeneration());
+    check(holds(cache, {2, 4, 5}, {3}), "a lookup makes a version recently used");
+
+    std::shared_ptr<const std::string> held = cache.lookup(2);
+    cache.insert(6, object_for(6), 90, cache.getGeneration());
+    check(cache.getUsedBytes() == 90 && holds(cache, {6}, {2, 4, 5}), "a large object evicts as many versions as needed");
+    check(held && *held == *object_for(2), "an evicted object stays alive while a reader holds it");
+
+    cache.insert(7, object_for(7), 101, cache.getGeneration());
+    check(cache.getUsedBytes() == 90 && holds(cache, {6}, {7}), "an object larger than the cache is not cached");
+    cache.insert(6, std::make_shared<const std::string>("another object"), 10, cache.getGeneration());
+    check(cache.getUsedBytes() == 90 && holds(cache, {6}, {}), "a cached version is not replaced");
+    cache.insert(8, object_for(8), 10, cache.getGeneration());
+    check(cache.getUsedBytes() == 100 && holds(cache, {6, 8}, {}), "the cache can be filled exactly");
+
+    StringCache counted(100);
+    counted.insert(1, object_for(1), 10, counted.getGeneration());
+    counted.lookup(1);
+    counted.lookup(1);
+    counted.lookup(2);
+    check(counted.getHitsAndMisses() == std::make_pair<uint64_t, uint64_t>(2, 1), "hits and misses are counted");
+}
+
+static void test_invalidation() {
+    StringCache cache(1000);
+    for(persistent::version_t ver = 1; ver <= 6; ++ver) {
+        cache.insert(ver, object_for(ver), 10, cache.getGeneration());
+    }
+
+    // An object materialized before a truncation must not be cached after it
+    const uint64_t stale_generation = cache.getGeneration();
+    cache.invalidateAfter(4);
+    check(cache.getUsedBytes() == 40 && holds(cache, {1, 2, 3, 4}, {5, 6}), "invalidateAfter drops the newer versions");
+    cache.insert(5, object_for(5), 10, stale_generation);
+    check(holds(cache, {}, {5}), "an insert with a generation from before invalidateAfter is ignored");
+    cache.insert(5, object_for(5), 10, cache.getGeneration());
+    check(holds(cache, {5}, {}), "an insert with the current generation is cached");
+
+    // Trimming doesn't reuse version numbers, so it doesn't start a new generation
+    const uint64_t generation_before_trim = cache.getGeneration();
+    cache.invalidateBefore(3);
+    check(cache.getUsedBytes() == 30 && holds(cache, {3, 4, 5}, {1, 2}), "invalidateBefore drops the older versions");
+    check(cache.getGeneration() == generation_before_trim, "invalidateBefore keeps the generation");
+    cache.insert(6, object_for(6), 10, generation_before_trim);
+    check(holds(cache, {6}, {}), "an insert with a generation from before invalidateBefore is cached");
+
+    const uint64_t generation_before_clear = cache.getGeneration();
+    cache.clear();
+    check(cache.getUsedBytes() == 0 && holds(cache, {}, {3, 4, 5, 6}), "clear drops every version");
+    cache.insert(7, object_for(7), 10, generation_before_clear);
+    check(holds(cache, {}, {7}), "an insert with a generation from before clear is ignored");
+}
+
+int main(int argc, char** argv) {
+    test_lru_eviction();
+    test_invalidation();
+    return unit_test::report_result();
+}
@@ -1,4 +1,5 @@
 #include "derecho/conf/conf.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <nlohmann/json.hpp>
 
@@ -18,6 +19,24 @@ const std::vector<std::string> Conf::subgroupProfileFields = {
         "window_size",
         "rdmc_send_algorithm"};
 
+const std::map<std::string, uint32_t> Conf::subgroupProfileOptionalFields = {
+        {"priority", 0},
+        {"weight", 1},
+        // Rate limits and admission control are off by default
+        {"rate_limit", 0},
+        {"sender_rate_limit", 0},
+        // 0 means the profile's window_size, so a sender can fill its window in one burst
+        {"rate_limit_burst", 0},
+        {"admission_target_us", 0},
+        {"admission_interval_us", 100000},
+        // Coalescing is opt-in, so latency-critical subgroups are unaffected
+        {"coalesce_linger_us", 0},
+        {"coalesce_max_bytes", 0},
+        // By default the quorum frontier waits for every member, like the global one
+        {"persistence_quorum", 0},
+        // Placing messages in the log pins its data ring, so it must be requested
+        {"direct_log_placement", 0}};
+
 std::unique_ptr<Conf> Conf::singleton = nullptr;
 
 std::atomic<uint32_t> Conf::singleton_initialized_flag = 0;
@@ -41,6 +60,8 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(DERECHO_SST_PORT),
         MAKE_LONG_OPT_ENTRY(DERECHO_RDMC_PORT),
         MAKE_LONG_OPT_ENTRY(DERECHO_EXTERNAL_PORT),
+        MAKE_LONG_OPT_ENTRY(DERECHO_EXTERNAL_CLIENT_ID),
+        MAKE_LONG_OPT_ENTRY(DERECHO_EXTERNAL_CLIENT_PORT),
         MAKE_LONG_OPT_ENTRY(DERECHO_P2P_LOOP_BUSY_WAIT_BEFORE_SLEEP_MS),
         MAKE_LONG_OPT_ENTRY(DERECHO_HEARTBEAT_MS),
         MAKE_LONG_OPT_ENTRY(DERECHO_SST_POLL_CQ_TIMEOUT_MS),
@@ -50,6 +71,11 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(DERECHO_P2P_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_P2P_HEDGE_PERCENTILE),
+        MAKE_LONG_OPT_ENTRY(DERECHO_P2P_HEDGE_MIN_DELAY_US),
+        MAKE_LONG_OPT_ENTRY(DERECHO_MAX_QUEUED_SENDS),
+        MAKE_LONG_OPT_ENTRY(DERECHO_RPC_TRACE_PATH),
+        MAKE_LONG_OPT_ENTRY(DERECHO_PARALLEL_APPLY_THREADS),
         MAKE_LONG_OPT_ENTRY(DERECHO_MAX_NODE_ID),
         MAKE_LONG_OPT_ENTRY(LAYOUT_JSON_LAYOUT),
         MAKE_LONG_OPT_ENTRY(LAYOUT_JSON_LAYOUT_FILE),
@@ -60,18 +86,40 @@ struct option Conf::long_options[] = {
         MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_MAX_SMC_PAYLOAD_SIZE),
         MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_BLOCK_SIZE),
         MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_WINDOW_SIZE),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_PRIORITY),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_WEIGHT),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_RATE_LIMIT),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_SENDER_RATE_LIMIT),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_RATE_LIMIT_BURST),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_ADMISSION_TARGET_US),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_ADMISSION_INTERVAL_US),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_COALESCE_LINGER_US),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_COALESCE_MAX_BYTES),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_PERSISTENCE_QUORUM),
+        MAKE_LONG_OPT_ENTRY(SUBGROUP_DEFAULT_DIRECT_LOG_PLACEMENT),
         // [RDMA]
         MAKE_LONG_OPT_ENTRY(RDMA_PROVIDER),
         MAKE_LONG_OPT_ENTRY(RDMA_DOMAIN),
         MAKE_LONG_OPT_ENTRY(RDMA_TX_DEPTH),
         MAKE_LONG_OPT_ENTRY(RDMA_RX_DEPTH),
+        MAKE_LONG_OPT_ENTRY(RDMA_HUGE_PAGES),
         // [PERS]
         MAKE_LONG_OPT_ENTRY(PERS_FILE_PATH),
         MAKE_LONG_OPT_ENTRY(PERS_RAMDISK_PATH),
+        MAKE_LONG_OPT_ENTRY(PERS_DAX_PATH),
         MAKE_LONG_OPT_ENTRY(PERS_RESET),
         MAKE_LONG_OPT_ENTRY(PERS_MAX_LOG_ENTRY),
         MAKE_LONG_OPT_ENTRY(PERS_MAX_DATA_SIZE),
+        MAKE_LONG_OPT_ENTRY(PERS_PREALLOCATE),
+        MAKE_LONG_OPT_ENTRY(PERS_PREWARM_BYTES),
+        MAKE_LONG_OPT_ENTRY(PERS_VERSION_CACHE_BYTES),
+        MAKE_LONG_OPT_ENTRY(PERS_ALLOW_DIRECT_LOG_PLACEMENT),
         MAKE_LONG_OPT_ENTRY(PERS_PRIVATE_KEY_FILE),
+        // [NUMA]
+        MAKE_LONG_OPT_ENTRY(NUMA_THREAD_CPUS),
+        MAKE_LONG_OPT_ENTRY(NUMA_PIN_TO_NIC_NODE),
+        MAKE_LONG_OPT_ENTRY(NUMA_NIC_NODE),
+        MAKE_LONG_OPT_ENTRY(NUMA_BIND_BUFFERS),
         // [LOGGER]
         MAKE_LONG_OPT_ENTRY(LOGGER_LOG_FILE_DEPTH),
         MAKE_LONG_OPT_ENTRY(LOGGER_LOG_TO_TERMINAL),
@@ -149,6 +197,12 @@ void Conf::initialize(int argc, char* argv[], const char* conf_file) {
         if(getConfUInt32(DERECHO_LOCAL_ID) >= getConfUInt32(DERECHO_MAX_NODE_ID)) {
             throw std::logic_error("Configuration error: Local node ID must be less than max node ID");
         }
+        if(hasCustomizedConfKey(DERECHO_EXTERNAL_CLIENT_ID)
+           && getConfUInt32(DERECHO_EXTERNAL_CLIENT_ID) >= getConfUInt32(DERECHO_MAX_NODE_ID)) {
+            throw std::logic_error("Configuration error: External client ID must be less than max node ID");
+        }
+        // Threads are pinned from the threads themselves, so report a bad CPU list here instead
+        parse_thread_cpus(getConfString(NUMA_THREAD_CPUS));
         if(getConfUInt32(SUBGROUP_DEFAULT_MAX_REPLY_PAYLOAD_SIZE) < DERECHO_MIN_RPC_RESPONSE_SIZE) {
             throw std::logic_error(std::string("Configuration error: Default subgroup reply size must be at least ")
                                    + std::to_string(DERECHO_MIN_RPC_RESPONSE_SIZE));
@@ -234,7 +288,7 @@ std::vector<std::string> split_string(const std::string& str, const std::string&
     std::size_t lastpos = 0;
     std::size_t nextpos = 0;
     while((nextpos = str.find(delimiter, lastpos)) != std::string::npos) {
-        result.emplace_back(str.substr(lastpos, nextpos));
+        result.emplace_back(str.substr(lastpos, nextpos - lastpos));
         lastpos = nextpos + delimiter.length();
     }
     result.emplace_back(str.substr(lastpos));
@@ -0,0 +1,175 @@
+#include "derecho/core/detail/admission_control.hpp"
+#include "derecho/utils/time.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace derecho {
+
+TokenBucket::TokenBucket(double rate_per_sec, double burst)
+        : tokens_per_ns(rate_per_sec / 1e9),
+          capacity(std::max(burst, 1.0)),
+          tokens(capacity),
+          last_refill_ns(get_time()) {}
+
+void TokenBucket::refill(uint64_t now_ns) {
+    if(now_ns > last_refill_ns) {
+        tokens = std::min(capacity, tokens + (now_ns - last_refill_ns) * tokens_per_ns);
+        last_refill_ns = now_ns;
+    }
+}
+
+void TokenBucket::set_rate(double rate_per_sec) {
+    refill(get_time());
+    tokens_per_ns = rate_per_sec / 1e9;
+}
+
+bool TokenBucket::try_consume(uint64_t now_ns) {
+    if(unlimited()) {
+        return true;
+    }
+    refill(now_ns);
+    if(tokens < 1.0) {
+        return false;
+    }
+    tokens -= 1.0;
+    return true;
+}
+
+void TokenBucket::refund() {
+    if(!unlimited()) {
+        tokens = std::min(capacity, tokens + 1.0);
+    }
+}
+
+uint64_t TokenBucket::time_until_token(uint64_t now_ns) {
+    if(unlimited()) {
+        return 0;
+    }
+    refill(now_ns);
+    if(tokens >= 1.0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(std::ceil((1.0 - tokens) / tokens_per_ns));
+}
+
+LatencyAdmissionController::LatencyAdmissionController(uint64_t target_us, uint64_t interval_us)
+        : target_ns(target_us * 1000),
+          interval_ns(interval_us * 1000) {}
+
+uint64_t LatencyAdmissionController::control_law(uint64_t t_ns) const {
+    return t_ns + static_cast<uint64_t>(interval_ns / std::sqrt(static_cast<double>(pacing_count)));
+}
+
+void LatencyAdmissionController::record_sojourn(uint64_t sojourn_ns, uint64_t now_ns) {
+    if(!enabled()) {
+        return;
+    }
+    if(sojourn_ns < target_ns) {
+        first_above_time_ns = 0;
+        pacing = false;
+        pacing_count = 0;
+        last_admit_paced = false;
+        return;
+    }
+    if(pacing) {
+        return;
+    }
+    if(first_above_time_ns == 0) {
+        // Latency must stay above target for a whole interval before pacing starts
+        first_above_time_ns = now_ns + interval_ns;
+    } else if(now_ns >= first_above_time_ns) {
+        pacing = true;
+        pacing_count = 1;
+        next_admit_ns = control_law(now_ns);
+        last_admit_paced = false;
+    }
+}
+
+bool LatencyAdmissionController::try_admit(uint64_t now_ns) {
+    if(!pacing) {
+        last_admit_paced = false;
+        return true;
+    }
+    if(now_ns < next_admit_ns) {
+        return false;
+    }
+    last_admit_slot_ns = next_admit_ns;
+    last_admit_paced = true;
+    ++pacing_count;
+    next_admit_ns = control_law(std::max(now_ns, next_admit_ns));
+    return true;
+}
+
+void LatencyAdmissionController::cancel_admit() {
+    // If pacing stopped or restarted since the admission, there is no slot to give back
+    if(!pacing || !last_admit_paced) {
+        return;
+    }
+    --pacing_count;
+    next_admit_ns = last_admit_slot_ns;
+    last_admit_paced = false;
+}
+
+uint64_t LatencyAdmissionController::time_until_admit(uint64_t now_ns) const {
+    if(!pacing || now_ns >= next_admit_ns) {
+        return 0;
+    }
+    return next_admit_ns - now_ns;
+}
+
+double SendAdmissionControl::effective_rate(double subgroup_rate_limit, double sender_rate_limit, uint32_t num_senders) {
+    double sender_share = subgroup_rate_limit / std::max(num_senders, 1u);
+    if(subgroup_rate_limit == 0) {
+        return sender_rate_limit;
+    } else if(sender_rate_limit == 0) {
+        return sender_share;
+    } else {
+        return std::min(sender_share, sender_rate_limit);
+    }
+}
+
+SendAdmissionControl::SendAdmissionControl(uint32_t subgroup_rate_limit, uint32_t sender_rate_limit, uint32_t burst,
+                                           uint32_t target_delay_us, uint32_t interval_us, uint32_t num_senders)
+        : subgroup_rate_limit(subgroup_rate_limit),
+          sender_rate_limit(sender_rate_limit),
+          bucket(effective_rate(subgroup_rate_limit, sender_rate_limit, num_senders), burst),
+          controller(target_delay_us, interval_us) {}
+
+void SendAdmissionControl::set_num_senders(uint32_t num_senders) {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    bucket.set_rate(effective_rate(subgroup_rate_limit, sender_rate_limit, num_senders));
+}
+
+send_admission SendAdmissionControl::try_admit() {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    uint64_t now = get_time();
+    // Check the controller first, so a paced-out send doesn't use up a token
+    if(controller.time_until_admit(now) > 0) {
+        return send_admission::OVERLOADED;
+    }
+    if(!bucket.try_consume(now)) {
+        return send_admission::RATE_LIMITED;
+    }
+    controller.try_admit(now);
+    return send_admission::ADMITTED;
+}
+
+void SendAdmissionControl::cancel_admit() {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    bucket.refund();
+    controller.cancel_admit();
+}
+
+uint64_t SendAdmissionControl::time_until_admit() {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    uint64_t now = get_time();
+    return std::max(controller.time_until_admit(now), bucket.time_until_token(now));
+}
+
+void SendAdmissionControl::record_sojourn(uint64_t sojourn_ns) {
+    std::lock_guard<std::mutex> lock(control_mutex);
+    controller.record_sojourn(sojourn_ns, get_time());
+}
+
+}  // namespace derecho
@@ -74,6 +74,13 @@ tcp_connections::tcp_connections(node_id_t my_id, uint16_t my_port)
 tcp_connections::tcp_connections(node_id_t my_id)
         : my_id(my_id) {}
 
+void tcp_connections::start_listening(uint16_t my_port) {
+    std::lock_guard<std::mutex> lock(sockets_mutex);
+    if(!conn_listener) {
+        conn_listener = std::make_unique<connection_listener>(my_port);
+    }
+}
+
 void tcp_connections::destroy() {
     std::lock_guard<std::mutex> lock(sockets_mutex);
     sockets.clear();
@@ -42,6 +42,9 @@ void DerechoSST::init_local_row_from_previous(const DerechoSST& old_sst, const i
     for(size_t i = 0; i < global_min.size(); ++i) {
         global_min[local_row][i] = 0;
     }
+    for(size_t i = 0; i < global_num_cuts.size(); ++i) {
+        global_num_cuts[local_row][i] = 0;
+    }
     num_changes[local_row] = old_sst.num_changes[row];
     num_committed[local_row] = old_sst.num_committed[row];
     num_acked[local_row] = old_sst.num_acked[row];
@@ -0,0 +1,122 @@
+#include "derecho/core/detail/hedged_query.hpp"
+#include "derecho/conf/conf.hpp"
+
+#include <algorithm>
+#include <pthread.h>
+
+namespace derecho {
+namespace rpc {
+
+ReplyLatencyTracker::ReplyLatencyTracker(double percentile, uint64_t min_delay_us)
+        : samples(window_size, 0),
+          percentile(std::clamp(percentile, 0.0, 100.0)),
+          min_delay_ns(min_delay_us * 1000),
+          cached_delay_ns(min_delay_ns) {}
+
+ReplyLatencyTracker::ReplyLatencyTracker()
+        : ReplyLatencyTracker(getConfDouble(Conf::DERECHO_P2P_HEDGE_PERCENTILE),
+                              getConfUInt64(Conf::DERECHO_P2P_HEDGE_MIN_DELAY_US)) {}
+
+void ReplyLatencyTracker::recompute_delay() {
+    std::vector<uint64_t> sorted(samples.begin(), samples.begin() + num_samples);
+    std::size_t rank = std::min(num_samples - 1, static_cast<std::size_t>(percentile / 100.0 * num_samples));
+    std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+    cached_delay_ns = std::max(min_delay_ns, sorted[rank]);
+    samples_since_recompute = 0;
+}
+
+void ReplyLatencyTracker::record(std::chrono::nanoseconds latency) {
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    samples[next_sample] = latency.count();
+    next_sample = (next_sample + 1) % window_size;
+    num_samples = std::min(num_samples + 1, window_size);
+    if(num_samples >= min_samples && ++samples_since_recompute >= recompute_interval) {
+        recompute_delay();
+    }
+}
+
+std::chrono::nanoseconds ReplyLatencyTracker::hedge_delay() {
+    std::lock_guard<std::mutex> lock(tracker_mutex);
+    return std::chrono::nanoseconds(cached_delay_ns);
+}
+
+std::mutex HedgeTimer::instance_mutex;
+std::weak_ptr<HedgeTimer> HedgeTimer::instance;
+
+HedgeTimer::HedgeTimer() : timer_thread(&HedgeTimer::run, this) {}
+
+HedgeTimer::~HedgeTimer() {
+    {
+        std::lock_guard<std::mutex> lock(timer_mutex);
+        shutdown = true;
+        tasks_changed.notify_one();
+    }
+    timer_thread.join();
+}
+
+std::shared_ptr<HedgeTimer> HedgeTimer::get() {
+    std::lock_guard<std::mutex> lock(instance_mutex);
+    std::shared_ptr<HedgeTimer> timer = instance.lock();
+    if(!timer) {
+        //The constructor is private, so make_shared can't be used
+        timer = std::shared_ptr<HedgeTimer>(new HedgeTimer());
+        instance = timer;
+    }
+    return timer;
+}
+
+void HedgeTimer::run() {
+    pthread_setname_np(pthread_self(), "hedge_timer");
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    while(!shutdown) {
+        if(tasks.empty()) {
+            tasks_changed.wait(lock);
+            continue;
+        }
+        auto next_task = tasks.begin();
+        if(std::chrono::steady_clock::now() < next_task->first.first) {
+            tasks_changed.wait_until(lock, next_task->first.first);
+            continue;
+        }
+        task_t task = std::move(next_task->second);
+        running_task = next_task->first.second;
+        task_deadlines.erase(running_task);
+        tasks.erase(next_task);
+        lock.unlock();
+        std::optional<time_point_t> next_run = task();
+        lock.lock();
+        if(next_run && !running_task_cancelled) {
+            tasks.emplace(std::make_pair(*next_run, running_task), std::move(task));
+            task_deadlines.emplace(running_task, *next_run);
+        }
+        running_task = 0;
+        running_task_cancelled = false;
+        task_finished.notify_all();
+    }
+}
+
+HedgeTimer::task_id_t HedgeTimer::schedule(time_point_t deadline, task_t task) {
+    std::lock_guard<std::mutex> lock(timer_mutex);
+    const task_id_t task_id = next_task_id++;
+    tasks.emplace(std::make_pair(deadline, task_id), std::move(task));
+    task_deadlines.emplace(task_id, deadline);
+    tasks_changed.notify_one();
+    return task_id;
+}
+
+void HedgeTimer::cancel(task_id_t task_id) {
+    std::unique_lock<std::mutex> lock(timer_mutex);
+    auto deadline = task_deadlines.find(task_id);
+    if(deadline != task_deadlines.end()) {
+        tasks.erase({deadline->second, task_id});
+        task_deadlines.erase(deadline);
+        return;
+    }
+    if(running_task == task_id) {
+        running_task_cancelled = true;
+    }
+    task_finished.wait(lock, [&]() { return running_task != task_id; });
+}
+
+}  // namespace rpc
+}  // namespace derecho
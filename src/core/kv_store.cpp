@@ -0,0 +1,481 @@
+/**
+ * @file kv_store.cpp
+ */
+
+#include "derecho/core/kv_store.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace derecho {
+
+/* ---------------------------- KVIndex ---------------------------- */
+
+uint64_t KVIndex::hash(std::string_view key) {
+    const uint64_t hash = std::hash<std::string_view>{}(key);
+    return hash == 0 ? 1 : hash;
+}
+
+void KVIndex::grow() {
+    std::vector<Slot> old_slots(std::max<std::size_t>(16, slots.size() * 2));
+    old_slots.swap(slots);
+    const std::size_t mask = slots.size() - 1;
+    for(Slot& old_slot : old_slots) {
+        if(old_slot.hash == 0) {
+            continue;
+        }
+        std::size_t pos = old_slot.hash & mask;
+        while(slots[pos].hash != 0) {
+            pos = (pos + 1) & mask;
+        }
+        slots[pos] = std::move(old_slot);
+    }
+}
+
+const std::string* KVIndex::find(std::string_view key, uint64_t hash) const {
+    if(slots.empty()) {
+        return nullptr;
+    }
+    const std::size_t mask = slots.size() - 1;
+    for(std::size_t pos = hash & mask; slots[pos].hash != 0; pos = (pos + 1) & mask) {
+        if(slots[pos].hash == hash && slots[pos].key == key) {
+            return &slots[pos].value;
+        }
+    }
+    return nullptr;
+}
+
+void KVIndex::put(std::string_view key, uint64_t hash, std::string_view value) {
+    // Keep the load factor under 3/4, so probe sequences stay short
+    if((num_entries + 1) * 4 > slots.size() * 3) {
+        grow();
+    }
+    const std::size_t mask = slots.size() - 1;
+    std::size_t pos = hash & mask;
+    for(; slots[pos].hash != 0; pos = (pos + 1) & mask) {
+        if(slots[pos].hash == hash && slots[pos].key == key) {
+            slots[pos].value.assign(value);
+            return;
+        }
+    }
+    slots[pos].hash = hash;
+    slots[pos].key.assign(key);
+    slots[pos].value.assign(value);
+    num_entries++;
+}
+
+bool KVIndex::erase(std::string_view key, uint64_t hash) {
+    if(slots.empty()) {
+        return false;
+    }
+    const std::size_t mask = slots.size() - 1;
+    std::size_t hole = hash & mask;
+    for(; slots[hole].hash != 0; hole = (hole + 1) & mask) {
+        if(slots[hole].hash == hash && slots[hole].key == key) {
+            break;
+        }
+    }
+    if(slots[hole].hash == 0) {
+        return false;
+    }
+    // Shift back the following entries of the cluster that would no longer
+    // be reachable from their home slot across the hole
+    for(std::size_t next = (hole + 1) & mask; slots[next].hash != 0; next = (next + 1) & mask) {
+        const std::size_t home = slots[next].hash & mask;
+        const bool reachable = (hole <= next) ? (hole < home && home <= next) : (hole < home || home <= next);
+        if(!reachable) {
+            slots[hole] = std::move(slots[next]);
+            hole = next;
+        }
+    }
+    slots[hole].hash = 0;
+    slots[hole].key.clear();
+    slots[hole].value.clear();
+    num_entries--;
+    return true;
+}
+
+void KVIndex::clear() {
+    slots.clear();
+    num_entries = 0;
+}
+
+/* ---------------------------- KVStoreDelta ---------------------------- */
+
+KVStoreDelta::KVStoreDelta(const uint8_t* buffer) : buffer(buffer), length(sizeof(uint32_t)) {
+    for_each([this](Op, std::string_view key, std::string_view value) {
+        length += 1 + 2 * sizeof(uint32_t) + key.size() + value.size();
+    });
+}
+
+void KVStoreDelta::append(std::string& delta, Op op, std::string_view key, std::string_view value) {
+    uint32_t num_ops = 0;
+    if(delta.empty()) {
+        delta.append(reinterpret_cast<const char*>(&num_ops), sizeof(num_ops));
+    }
+    memcpy(&num_ops, delta.data(), sizeof(num_ops));
+    num_ops++;
+    memcpy(delta.data(), &num_ops, sizeof(num_ops));
+    const uint32_t key_size = key.size();
+    const uint32_t value_size = value.size();
+    delta.push_back(static_cast<char>(op));
+    delta.append(reinterpret_cast<const char*>(&key_size), sizeof(key_size));
+    delta.append(reinterpret_cast<const char*>(&value_size), sizeof(value_size));
+    delta.append(key);
+    delta.append(value);
+}
+
+std::optional<std::pair<KVStoreDelta::Op, std::string_view>> KVStoreDelta::find(std::string_view key) const {
+    std::optional<std::pair<Op, std::string_view>> result;
+    for_each([&](Op op, std::string_view op_key, std::string_view value) {
+        if(op_key == key) {
+            result.emplace(op, value);
+        }
+    });
+    return result;
+}
+
+std::vector<std::string> KVStoreDelta::extract_keys(const uint8_t* const buffer, std::size_t size) {
+    std::vector<std::string> keys;
+    KVStoreDelta(buffer).for_each([&keys](Op, std::string_view key, std::string_view) {
+        if(std::find(keys.begin(), keys.end(), key) == keys.end()) {
+            keys.emplace_back(key);
+        }
+    });
+    return keys;
+}
+
+std::size_t KVStoreDelta::to_bytes(uint8_t* buffer) const {
+    memcpy(buffer, this->buffer, length);
+    return length;
+}
+
+std::size_t KVStoreDelta::bytes_size() const {
+    return length;
+}
+
+void KVStoreDelta::post_object(const std::function<void(uint8_t const* const, std::size_t)>& post_func) const {
+    post_func(buffer, length);
+}
+
+std::unique_ptr<KVStoreDelta> KVStoreDelta::from_bytes(mutils::DeserializationManager*, const uint8_t* const buffer) {
+    auto delta = std::make_unique<KVStoreDelta>(buffer);
+    delta->owned_buffer = std::make_unique<uint8_t[]>(delta->length);
+    memcpy(delta->owned_buffer.get(), buffer, delta->length);
+    delta->buffer = delta->owned_buffer.get();
+    return delta;
+}
+
+mutils::context_ptr<KVStoreDelta> KVStoreDelta::from_bytes_noalloc(mutils::DeserializationManager*, const uint8_t* const buffer) {
+    return mutils::context_ptr<KVStoreDelta>{new KVStoreDelta(buffer)};
+}
+
+mutils::context_ptr<const KVStoreDelta> KVStoreDelta::from_bytes_noalloc_const(mutils::DeserializationManager*, const uint8_t* const buffer) {
+    return mutils::context_ptr<const KVStoreDelta>{new KVStoreDelta(buffer)};
+}
+
+/* ---------------------------- KVStoreState ---------------------------- */
+
+bool KVStoreState::apply(KVStoreDelta::Op op, std::string_view key, std::string_view value) {
+    const uint64_t hash = KVIndex::hash(key);
+    Partition& partition = partition_of(hash);
+    std::lock_guard<std::mutex> lock(partition.mutex);
+    if(op == KVStoreDelta::Op::PUT) {
+        partition.index.put(key, hash, value);
+        return true;
+    }
+    return partition.index.erase(key, hash);
+}
+
+void KVStoreState::record(KVStoreDelta::Op op, std::string_view key, std::string_view value) {
+    const persistent::version_t version = ParallelApply::applying_version();
+    std::lock_guard<std::mutex> lock(delta_mutex);
+    KVStoreDelta::append(pending_deltas[version], op, key, value);
+}
+
+void KVStoreState::put(std::string_view key, std::string_view value) {
+    apply(KVStoreDelta::Op::PUT, key, value);
+    record(KVStoreDelta::Op::PUT, key, value);
+}
+
+bool KVStoreState::remove(std::string_view key) {
+    if(!apply(KVStoreDelta::Op::REMOVE, key, {})) {
+        return false;
+    }
+    record(KVStoreDelta::Op::REMOVE, key, {});
+    return true;
+}
+
+std::size_t KVStoreState::size() const {
+    std::size_t num_keys = 0;
+    for(const Partition& partition : partitions) {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        num_keys += partition.index.size();
+    }
+    return num_keys;
+}
+
+bool KVStoreState::log_is_complete(const persistent::Persistent<KVStoreState>& log) {
+    // Trimming moves the first entry past index 0, or empties a log that had entries
+    return log.getLatestIndex() < 0 || log.getEarliestIndex() == 0;
+}
+
+void KVStoreState::rebuild(const persistent::Persistent<KVStoreState>& log) {
+    if(!log_is_complete(log)) {
+        // The joining node should have asked for the entries instead of a marker
+        throw derecho_exception("Cannot rebuild a KVStore from a log that has been trimmed");
+    }
+    const persistent::version_t earliest = log.getEarliestVersion();
+    if(earliest != persistent::INVALID_VERSION) {
+        for(const persistent::LogEntryView& entry : log.getEntries(earliest, log.getLatestVersion())) {
+            applyDelta(static_cast<const uint8_t*>(entry.data));
+        }
+    }
+    rebuild_needed = false;
+}
+
+void KVStoreState::finalizeCurrentDelta(const persistent::DeltaFinalizer& finalizer) {
+    std::string delta;
+    {
+        std::lock_guard<std::mutex> lock(delta_mutex);
+        auto pending = pending_deltas.find(ParallelApply::applying_version());
+        if(pending != pending_deltas.end()) {
+            delta = std::move(pending->second);
+            pending_deltas.erase(pending);
+        }
+    }
+    if(delta.empty()) {
+        finalizer(nullptr, 0);
+    } else {
+        finalizer(reinterpret_cast<const uint8_t*>(delta.data()), delta.size());
+    }
+}
+
+void KVStoreState::applyDelta(uint8_t const* const delta) {
+    KVStoreDelta(delta).for_each([this](KVStoreDelta::Op op, std::string_view key, std::string_view value) {
+        apply(op, key, value);
+    });
+}
+
+std::unique_ptr<KVStoreState> KVStoreState::create(mutils::DeserializationManager*) {
+    return std::make_unique<KVStoreState>();
+}
+
+bool KVStoreState::serialize_as_marker() const {
+    return rebuild_needed
+           || persistent::PersistentRegistry::getEarliestVersionToSerialize() != persistent::INVALID_VERSION;
+}
+
+// Each entry is serialized as the 32-bit sizes of its key and value, then the key and the value
+static constexpr std::size_t ENTRY_HEADER_SIZE = 2 * sizeof(uint32_t);
+
+static std::size_t write_entry(uint8_t* buffer, const std::string& key, const std::string& value) {
+    const uint32_t key_size = key.size();
+    const uint32_t value_size = value.size();
+    memcpy(buffer, &key_size, sizeof(key_size));
+    memcpy(buffer + sizeof(key_size), &value_size, sizeof(value_size));
+    memcpy(buffer + ENTRY_HEADER_SIZE, key.data(), key_size);
+    memcpy(buffer + ENTRY_HEADER_SIZE + key_size, value.data(), value_size);
+    return ENTRY_HEADER_SIZE + key_size + value_size;
+}
+
+std::size_t KVStoreState::to_bytes(uint8_t* buffer) const {
+    const bool is_marker = serialize_as_marker();
+    std::size_t offset = mutils::to_bytes(is_marker, buffer);
+    if(is_marker) {
+        return offset;
+    }
+    const uint64_t num_keys = size();
+    offset += mutils::to_bytes(num_keys, buffer + offset);
+    for(const Partition& partition : partitions) {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.index.for_each([&](const std::string& key, const std::string& value) {
+            offset += write_entry(buffer + offset, key, value);
+        });
+    }
+    return offset;
+}
+
+std::size_t KVStoreState::bytes_size() const {
+    if(serialize_as_marker()) {
+        return sizeof(bool);
+    }
+    std::size_t size = sizeof(bool) + sizeof(uint64_t);
+    for(const Partition& partition : partitions) {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.index.for_each([&size](const std::string& key, const std::string& value) {
+            size += ENTRY_HEADER_SIZE + key.size() + value.size();
+        });
+    }
+    return size;
+}
+
+void KVStoreState::post_object(const std::function<void(uint8_t const* const, std::size_t)>& post_func) const {
+    const bool is_marker = serialize_as_marker();
+    mutils::post_object(post_func, is_marker);
+    if(is_marker) {
+        return;
+    }
+    const uint64_t num_keys = size();
+    mutils::post_object(post_func, num_keys);
+    // Post the entries in large chunks rather than one at a time, since this usually writes to a socket
+    constexpr std::size_t CHUNK_SIZE = 1 << 20;
+    std::vector<uint8_t> chunk;
+    chunk.reserve(CHUNK_SIZE);
+    for(const Partition& partition : partitions) {
+        std::lock_guard<std::mutex> lock(partition.mutex);
+        partition.index.for_each([&](const std::string& key, const std::string& value) {
+            const std::size_t entry_size = ENTRY_HEADER_SIZE + key.size() + value.size();
+            if(!chunk.empty() && chunk.size() + entry_size > CHUNK_SIZE) {
+                post_func(chunk.data(), chunk.size());
+                chunk.clear();
+            }
+            const std::size_t chunk_size = chunk.size();
+            chunk.resize(chunk_size + entry_size);
+            write_entry(chunk.data() + chunk_size, key, value);
+        });
+    }
+    if(!chunk.empty()) {
+        post_func(chunk.data(), chunk.size());
+    }
+}
+
+std::unique_ptr<KVStoreState> KVStoreState::from_bytes(mutils::DeserializationManager*, const uint8_t* const buffer) {
+    auto state = std::make_unique<KVStoreState>();
+    bool is_marker;
+    memcpy(&is_marker, buffer, sizeof(is_marker));
+    if(is_marker) {
+        state->rebuild_needed = true;
+        return state;
+    }
+    uint64_t num_keys;
+    memcpy(&num_keys, buffer + sizeof(bool), sizeof(num_keys));
+    std::size_t offset = sizeof(bool) + sizeof(num_keys);
+    for(uint64_t i = 0; i < num_keys; ++i) {
+        uint32_t key_size;
+        uint32_t value_size;
+        memcpy(&key_size, buffer + offset, sizeof(key_size));
+        memcpy(&value_size, buffer + offset + sizeof(key_size), sizeof(value_size));
+        offset += ENTRY_HEADER_SIZE;
+        state->apply(KVStoreDelta::Op::PUT,
+                     std::string_view(reinterpret_cast<const char*>(buffer + offset), key_size),
+                     std::string_view(reinterpret_cast<const char*>(buffer + offset + key_size), value_size));
+        offset += key_size + value_size;
+    }
+    return state;
+}
+
+mutils::context_ptr<KVStoreState> KVStoreState::from_bytes_noalloc(mutils::DeserializationManager* dsm, const uint8_t* const buffer) {
+    return mutils::context_ptr<KVStoreState>{from_bytes(dsm, buffer).release()};
+}
+
+mutils::context_ptr<const KVStoreState> KVStoreState::from_bytes_noalloc_const(mutils::DeserializationManager* dsm, const uint8_t* const buffer) {
+    return mutils::context_ptr<const KVStoreState>{from_bytes(dsm, buffer).release()};
+}
+
+/* ---------------------------- KVStore ---------------------------- */
+
+KVStore::KVStore(persistent::PersistentRegistry* registry)
+        : state(std::make_unique<KVStoreState>, nullptr, registry) {
+    state.enableKeyIndex(&KVStoreDelta::extract_keys);
+}
+
+KVStore::KVStore(persistent::Persistent<KVStoreState>& received_state)
+        : state(std::move(received_state)) {
+    if(state->needs_rebuild()) {
+        // The sender only appended the log entries this node was missing
+        state->rebuild(state);
+    }
+    state.enableKeyIndex(&KVStoreDelta::extract_keys);
+}
+
+void KVStore::put(const std::string& key, const Bytes& value) {
+    state->put(key, std::string_view(reinterpret_cast<const char*>(value.get()), value.size()));
+}
+
+bool KVStore::remove(const std::string& key) {
+    return state->remove(key);
+}
+
+Bytes KVStore::get(const std::string& key) const {
+    Bytes result;
+    state->read(key, [&result](const std::string& value) {
+        result = Bytes(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    });
+    return result;
+}
+
+// The value a key has after a delta that updated it
+static Bytes value_after(const KVStoreDelta& delta, const std::string& key) {
+    auto update = delta.find(key);
+    if(!update || update->first == KVStoreDelta::Op::REMOVE) {
+        return Bytes();
+    }
+    return Bytes(reinterpret_cast<const uint8_t*>(update->second.data()), update->second.size());
+}
+
+Bytes KVStore::value_without_update(const std::string& key, persistent::version_t version) const {
+    // A key with no remaining update at or before the version was absent then
+    // if the log was never trimmed. Otherwise a trimmed entry may have set it,
+    // unless the key has no remaining updates at all and is absent now.
+    if(KVStoreState::log_is_complete(state)
+       || (state.getKeyVersions(key).empty() && !state->read(key, [](const std::string&) {}))) {
+        return Bytes();
+    }
+    throw persistent::persistent_invalid_version(version);
+}
+
+Bytes KVStore::get_by_version(const std::string& key, persistent::version_t version) const {
+    if(state.getKeyVersion(key, version) == persistent::INVALID_VERSION) {
+        if(version < state.getEarliestVersion()) {
+            throw persistent::persistent_invalid_version(version);
+        }
+        return value_without_update(key, version);
+    }
+    return state.getDeltaByKey<KVStoreDelta>(key, version, [&key](const KVStoreDelta& delta) {
+        return value_after(delta, key);
+    });
+}
+
+Bytes KVStore::get_by_time(const std::string& key, uint64_t time_us) const {
+    const HLC hlc{time_us, 0};
+    try {
+        return state.getDeltaByKey<KVStoreDelta>(key, hlc, [&key](const KVStoreDelta& delta) {
+            return value_after(delta, key);
+        });
+    } catch(persistent::persistent_invalid_hlc&) {
+        const persistent::version_t version = state.getVersionAtTime(hlc);
+        if(version == persistent::INVALID_VERSION || version < state.getEarliestVersion()) {
+            // The time comes before every remaining entry
+            if(KVStoreState::log_is_complete(state)) {
+                return Bytes();
+            }
+            throw;
+        }
+        return value_without_update(key, version);
+    }
+}
+
+std::vector<persistent::version_t> KVStore::get_key_versions(const std::string& key) const {
+    return state.getKeyVersions(key);
+}
+
+uint64_t KVStore::get_size() const {
+    return state->size();
+}
+
+bool KVStore::local_log_is_complete() const {
+    return KVStoreState::log_is_complete(state);
+}
+
+std::optional<uint64_t> KVStore::conflict_key(rpc::FunctionTag tag, const uint8_t* args, std::size_t args_size) const {
+    // Every ordered function takes the key first, serialized as a null-terminated string
+    const char* key = reinterpret_cast<const char*>(args);
+    const std::size_t key_size = strnlen(key, args_size);
+    if(key_size == args_size) {
+        return std::nullopt;
+    }
+    return KVIndex::hash(std::string_view(key, key_size));
+}
+
+}  // namespace derecho
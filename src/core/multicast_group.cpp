@@ -6,12 +6,15 @@
 #include "derecho/persistent/detail/PersistLog.hpp"
 #include "derecho/rdmc/detail/util.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 #include "derecho/utils/time.h"
 
 #include <algorithm>
 #include <atomic>
 #include <cassert>
 #include <chrono>
+#include <cstring>
+#include <functional>
 #include <limits>
 #include <thread>
 
@@ -39,6 +42,7 @@ MulticastGroup::MulticastGroup(
         const std::map<subgroup_id_t, SubgroupSettings>& subgroup_settings_by_id,
         unsigned int sender_timeout,
         PersistenceManager& persistence_manager_ref,
+        uint16_t rdmc_group_num_base,
         std::vector<char> already_failed)
         : members(_members),
           num_members(members.size()),
@@ -48,6 +52,7 @@ MulticastGroup::MulticastGroup(
           total_num_subgroups(total_num_subgroups),
           subgroup_settings_map(subgroup_settings_by_id),
           received_intervals(sst->num_received.size(), {-1, -1}),
+          rdmc_group_num_base(rdmc_group_num_base),
           rdmc_group_num_offset(0),
           future_message_indices(total_num_subgroups, 0),
           next_sends(total_num_subgroups),
@@ -57,18 +62,28 @@ MulticastGroup::MulticastGroup(
           pending_sends(total_num_subgroups),
           current_sends(total_num_subgroups),
           next_message_to_deliver(total_num_subgroups),
+          optimistically_delivered_num(total_num_subgroups, -1),
           minimum_persisted_version(total_num_subgroups),
           minimum_persisted_cv(total_num_subgroups),
           minimum_persisted_mtx(total_num_subgroups),
+          quorum_persisted_version(total_num_subgroups),
+          quorum_persisted_cv(total_num_subgroups),
+          quorum_persisted_mtx(total_num_subgroups),
           minimum_verified_version(total_num_subgroups),
           delivered_version(total_num_subgroups),
+          last_send_coalesced(total_num_subgroups, false),
+          coalesced_slot_runs(total_num_subgroups),
+          sst_slot_last_index(total_num_subgroups),
+          num_sst_slots_reserved(total_num_subgroups, 0),
           sender_timeout(sender_timeout),
           sst(sst),
           sst_multicast_group_ptrs(total_num_subgroups),
           last_transfer_medium(total_num_subgroups),
           persistence_manager(persistence_manager_ref) {
+    check_rdmc_group_count();
     for(uint i = 0; i < total_num_subgroups; ++i) {
         minimum_persisted_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
+        quorum_persisted_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
         minimum_verified_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
         delivered_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
     }
@@ -84,6 +99,8 @@ MulticastGroup::MulticastGroup(
             free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
         }
     }
+    init_send_admission_controls();
+    init_coalesced_sends();
 
     initialize_sst_row();
     bool no_member_failed = true;
@@ -95,6 +112,7 @@ MulticastGroup::MulticastGroup(
             }
         }
     }
+    init_placement_thread();
     if(!already_failed.size() || no_member_failed) {
         // if groups are created successfully, rdmc_sst_groups_created will be set to true
         rdmc_sst_groups_created = create_rdmc_sst_groups();
@@ -119,7 +137,8 @@ MulticastGroup::MulticastGroup(
           total_num_subgroups(total_num_subgroups),
           subgroup_settings_map(subgroup_settings_by_id),
           received_intervals(sst->num_received.size(), {-1, -1}),
-          rdmc_group_num_offset(old_group.rdmc_group_num_offset + old_group.num_members),
+          rdmc_group_num_base(old_group.rdmc_group_num_base),
+          rdmc_group_num_offset((old_group.rdmc_group_num_offset + old_group.num_members) % rdmc::GROUP_NUMBER_RANGE_SIZE),
           future_message_indices(total_num_subgroups, 0),
           next_sends(total_num_subgroups),
           committed_sst_index(total_num_subgroups, -1),
@@ -128,22 +147,29 @@ MulticastGroup::MulticastGroup(
           pending_sends(total_num_subgroups),
           current_sends(total_num_subgroups),
           next_message_to_deliver(total_num_subgroups),
+          optimistically_delivered_num(total_num_subgroups, -1),
           minimum_persisted_version(total_num_subgroups),
           minimum_persisted_cv(total_num_subgroups),
           minimum_persisted_mtx(total_num_subgroups),
+          quorum_persisted_version(total_num_subgroups),
+          quorum_persisted_cv(total_num_subgroups),
+          quorum_persisted_mtx(total_num_subgroups),
           minimum_verified_version(total_num_subgroups),
           delivered_version(total_num_subgroups),
+          last_send_coalesced(total_num_subgroups, false),
+          coalesced_slot_runs(total_num_subgroups),
+          sst_slot_last_index(total_num_subgroups),
+          num_sst_slots_reserved(total_num_subgroups, 0),
           sender_timeout(old_group.sender_timeout),
           sst(sst),
           sst_multicast_group_ptrs(total_num_subgroups),
           last_transfer_medium(total_num_subgroups),
           persistence_manager(old_group.persistence_manager) {
-    // Make sure rdmc_group_num_offset didn't overflow.
-    assert(old_group.rdmc_group_num_offset <= std::numeric_limits<uint16_t>::max() - old_group.num_members - num_members);
-
+    check_rdmc_group_count();
     // initialize persisted_version and verified_version
     for (uint i = 0; i< total_num_subgroups; ++i) {
         minimum_persisted_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
+        quorum_persisted_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
         minimum_verified_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
         delivered_version[i] = std::make_unique<std::atomic<persistent::version_t>>(persistent::INVALID_VERSION);
     }
@@ -151,6 +177,9 @@ MulticastGroup::MulticastGroup(
     // Just in case
     old_group.wedge();
 
+    send_admission_controls = std::move(old_group.send_admission_controls);
+    init_send_admission_controls();
+
     for(uint i = 0; i < num_members; ++i) {
         node_id_to_sst_index[members[i]] = i;
     }
@@ -171,18 +200,15 @@ MulticastGroup::MulticastGroup(
         return std::move(msg);
     };
 
-    for(const auto& p : subgroup_settings_by_id) {
-        subgroup_id_t id = p.first;
-        const SubgroupSettings& settings = p.second;
-        auto num_shard_members = settings.members.size();
-        while(free_message_buffers[id].size() < settings.profile.window_size * num_shard_members) {
-            free_message_buffers[id].emplace_back(settings.profile.max_msg_size);
-        }
-    }
-
     // Reclaim RDMCMessageBuffers from the old group, and supplement them with
-    // additional if the group has grown.
+    // additional if the group has grown. The old buffers keep their memory
+    // registrations, so a view change only registers the buffers it adds.
     std::lock_guard<std::recursive_mutex> lock(old_group.msg_state_mtx);
+    // Messages still waiting to be coalesced have not been assigned indices
+    // yet, so they can simply be sent in this view, unless this node is no
+    // longer a sender in their subgroup (then init_coalesced_sends fails them)
+    coalesced_sends = std::move(old_group.coalesced_sends);
+    init_coalesced_sends();
     for(const auto& p : subgroup_settings_by_id) {
         const subgroup_id_t subgroup_num = p.first;
         const SubgroupSettings& settings = p.second;
@@ -194,8 +220,18 @@ MulticastGroup::MulticastGroup(
         }
     }
 
+    // A buffer borrowed from a persistent log can only be given back if that
+    // log still belongs to this node's object in the subgroup
+    auto reclaim_buffer = [this](subgroup_id_t subgroup_num, MessageBuffer&& buffer) {
+        if(buffer.placement_log
+           && (!internal_callbacks.placement_log_callback
+               || internal_callbacks.placement_log_callback(subgroup_num) != buffer.placement_log)) {
+            return;
+        }
+        recycle_message_buffer(subgroup_num, std::move(buffer));
+    };
     for(auto& msg : old_group.current_receives) {
-        free_message_buffers[msg.first.first].push_back(std::move(msg.second.message_buffer));
+        reclaim_buffer(msg.first.first, std::move(msg.second.message_buffer));
     }
     old_group.current_receives.clear();
 
@@ -211,7 +247,7 @@ MulticastGroup::MulticastGroup(
             if(q.second.sender_id == members[member_index]) {
                 pending_sends[p.first].push(convert_msg(q.second, p.first));
             } else {
-                free_message_buffers[p.first].push_back(std::move(q.second.message_buffer));
+                reclaim_buffer(p.first, std::move(q.second.message_buffer));
             }
         }
     }
@@ -268,6 +304,7 @@ MulticastGroup::MulticastGroup(
             }
         }
     }
+    init_placement_thread();
     if(!already_failed.size() || no_member_failed) {
         // if groups are created successfully, rdmc_sst_groups_created will be set to true
         rdmc_sst_groups_created = create_rdmc_sst_groups();
@@ -290,6 +327,9 @@ bool MulticastGroup::create_rdmc_sst_groups() {
         sst_multicast_group_ptrs[subgroup_num] = std::make_unique<sst::multicast_group<DerechoSST>>(
                 sst, shard_sst_indices, subgroup_settings.profile.window_size, subgroup_settings.profile.sst_max_msg_size, subgroup_settings.senders,
                 subgroup_settings.num_received_offset, subgroup_settings.slot_offset, subgroup_settings.index_offset);
+        if(subgroup_settings.sender_rank >= 0) {
+            sst_slot_last_index[subgroup_num].assign(subgroup_settings.profile.window_size, -1);
+        }
 
         if(subgroup_settings.profile.max_msg_size > subgroup_settings.profile.sst_max_msg_size) {
             for(uint shard_rank = 0, sender_rank = -1; shard_rank < num_shard_members; ++shard_rank) {
@@ -332,8 +372,8 @@ bool MulticastGroup::create_rdmc_sst_groups() {
 
                     auto new_num_received = resolve_num_received(index, subgroup_settings.num_received_offset + sender_rank);
                     // NULL Send Scheme
-                    // only if I am a sender in the subgroup and the subgroup is not in UNORDERED mode
-                    if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode != Mode::UNORDERED) {
+                    // only if I am a sender in the subgroup and the subgroup is in round-robin ORDERED mode
+                    if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode == Mode::ORDERED) {
                         if(subgroup_settings.sender_rank < (int)sender_rank) {
                             while(future_message_indices[subgroup_num] <= new_num_received) {
                                 get_buffer_and_send_auto_null(subgroup_num);
@@ -381,7 +421,7 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                                                                         {{buf + h->header_size, msg.size - h->header_size}},
                                                                         persistent::INVALID_VERSION);
                                 }
-                                free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
+                                recycle_message_buffer(subgroup_num, std::move(msg.message_buffer));
                                 if(node_id == members[member_index]) {
                                     pending_message_timestamps[subgroup_num].erase(h->timestamp);
                                 }
@@ -427,52 +467,205 @@ bool MulticastGroup::create_rdmc_sst_groups() {
                     continue;
                 }
 
+                // Group numbers wrap around within this Group's range; the groups
+                // of old views are destroyed when they are wedged, before this
+                // view's groups are created, and check_rdmc_group_count() made
+                // sure that this view's groups do not wrap onto each other
+                const uint16_t rdmc_group_num = rdmc_group_num_base + rdmc_group_num_offset;
+                rdmc_group_num_offset = (rdmc_group_num_offset + 1) % rdmc::GROUP_NUMBER_RANGE_SIZE;
                 if(node_id == members[member_index]) {
                     //Create a group in which this node is the sender, and only self-receives happen
                     if(!rdmc::create_group(
-                               rdmc_group_num_offset, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
+                               rdmc_group_num, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
                                [](size_t length) -> rdmc::receive_destination {
                                    assert_always(false);
                                    return {nullptr, 0};
                                },
                                receive_handler_plus_notify,
-                               [](std::optional<uint32_t>) {})) {
+                               [](std::optional<uint32_t>) {},
+                               subgroup_settings.profile.priority)) {
                         return false;
                     }
-                    subgroup_to_rdmc_group[subgroup_num] = rdmc_group_num_offset;
-                    rdmc_group_num_offset++;
+                    subgroup_to_rdmc_group[subgroup_num] = rdmc_group_num;
                 } else {
                     if(!rdmc::create_group(
-                               rdmc_group_num_offset, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
+                               rdmc_group_num, rotated_shard_members, subgroup_settings.profile.block_size, subgroup_settings.profile.rdmc_send_algorithm,
                                [this, subgroup_num, node_id](size_t length) {
                                    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
-                                   assert(!free_message_buffers[subgroup_num].empty());
                                    //Create a Message struct to receive the data into.
                                    RDMCMessage msg;
                                    msg.sender_id = node_id;
                                    // The length variable is not the exact size of the msg,
                                    // but it is the nearest multiple of the block size greater then the size
                                    // so we will set the size in the receive handler
-                                   msg.message_buffer = std::move(free_message_buffers[subgroup_num].back());
-                                   free_message_buffers[subgroup_num].pop_back();
-
-                                   rdmc::receive_destination ret{msg.message_buffer.mr, 0};
+                                   size_t offset = 0;
+                                   if(auto placed_buffer = reserve_log_placement(subgroup_num, length)) {
+                                       offset = placed_buffer->buffer.get() - placed_buffer->mr->buffer;
+                                       msg.message_buffer = std::move(*placed_buffer);
+                                   } else {
+                                       assert(!free_message_buffers[subgroup_num].empty());
+                                       msg.message_buffer = std::move(free_message_buffers[subgroup_num].back());
+                                       free_message_buffers[subgroup_num].pop_back();
+                                   }
+
+                                   rdmc::receive_destination ret{msg.message_buffer.mr, offset};
                                    current_receives[{subgroup_num, node_id}] = std::move(msg);
 
                                    assert(ret.mr->buffer != nullptr);
                                    return ret;
                                },
-                               rdmc_receive_handler, [](std::optional<uint32_t>) {})) {
+                               rdmc_receive_handler, [](std::optional<uint32_t>) {},
+                               subgroup_settings.profile.priority)) {
                         return false;
                     }
-                    rdmc_group_num_offset++;
                 }
+                rdmc_group_numbers.push_back(rdmc_group_num);
             }
         }
     }
     return true;
 }
 
+void MulticastGroup::check_rdmc_group_count() const {
+    uint32_t num_rdmc_groups = 0;
+    for(const auto& [subgroup_num, subgroup_settings] : subgroup_settings_map) {
+        // create_rdmc_sst_groups() creates one group per sender of each shard that uses RDMC
+        if(subgroup_settings.profile.max_msg_size > subgroup_settings.profile.sst_max_msg_size
+           && subgroup_settings.members.size() > 1) {
+            num_rdmc_groups += get_num_senders(subgroup_settings.senders);
+        }
+    }
+    if(num_rdmc_groups > rdmc::GROUP_NUMBER_RANGE_SIZE) {
+        throw derecho_exception("This view needs " + std::to_string(num_rdmc_groups)
+                                + " RDMC groups, but a Group can only have "
+                                + std::to_string(rdmc::GROUP_NUMBER_RANGE_SIZE));
+    }
+}
+
+void MulticastGroup::init_placement_thread() {
+    if(!getConfBoolean(Conf::PERS_ALLOW_DIRECT_LOG_PLACEMENT) || !internal_callbacks.placement_log_callback) {
+        return;
+    }
+    for(const auto& [subgroup_num, settings] : subgroup_settings_map) {
+        if(settings.profile.direct_log_placement) {
+            placement_thread = std::thread(&MulticastGroup::register_placement_windows_loop, this);
+            return;
+        }
+    }
+}
+
+std::optional<MessageBuffer> MulticastGroup::reserve_log_placement(subgroup_id_t subgroup_num, size_t length) {
+    if(!placement_thread.joinable() || !subgroup_settings_map.at(subgroup_num).profile.direct_log_placement) {
+        return std::nullopt;
+    }
+    auto log_iter = placement_logs.find(subgroup_num);
+    if(log_iter == placement_logs.end()) {
+        persistent::PersistLog* log = internal_callbacks.placement_log_callback(subgroup_num);
+        if(!log || !log->getPlacementRegion().first) {
+            dbg_default_warn("Subgroup {} requested direct log placement, but its object has no suitable persistent log", subgroup_num);
+            log = nullptr;
+        }
+        log_iter = placement_logs.emplace(subgroup_num, PlacementLog{log}).first;
+    }
+    PlacementLog& placement_log = log_iter->second;
+    if(!placement_log.log) {
+        return std::nullopt;
+    }
+    uint8_t* region = static_cast<uint8_t*>(placement_log.log->reservePlacement(length));
+    if(!region) {
+        // The ring is too full; fall back to an ordinary buffer and let the log copy the entry
+        return std::nullopt;
+    }
+    auto window = std::find_if(placement_log.windows.begin(), placement_log.windows.end(),
+                               [&](const std::shared_ptr<rdma::memory_region>& mr) {
+                                   return region >= mr->buffer && region + length <= mr->buffer + mr->size;
+                               });
+    // The data ring is mapped twice, and regions are always handed out in the first mapping
+    const auto [mapping, mapping_size] = placement_log.log->getPlacementRegion();
+    uint8_t* const ring_end = static_cast<uint8_t*>(mapping) + mapping_size / 2;
+    if(window == placement_log.windows.end()) {
+        // The tail has left the registered windows, so the next one must start here
+        if(!placement_log.requested_window) {
+            placement_log.requested_window = region;
+            placement_cv.notify_all();
+        }
+        placement_log.log->releasePlacement(region);
+        return std::nullopt;
+    }
+    const std::shared_ptr<rdma::memory_region>& newest = placement_log.windows.back();
+    if(*window == newest && !placement_log.requested_window
+       && region + length > newest->buffer + newest->size / 2) {
+        // Register the next window, where the tail will be, before the tail gets there
+        uint8_t* next_start = region + length;
+        placement_log.requested_window = next_start >= ring_end ? next_start - mapping_size / 2 : next_start;
+        placement_cv.notify_all();
+    }
+    return MessageBuffer(region, *window, placement_log.log);
+}
+
+std::shared_ptr<rdma::memory_region> MulticastGroup::register_placement_window(subgroup_id_t subgroup_num,
+                                                                               persistent::PersistLog* log,
+                                                                               uint8_t* start) {
+    const SubgroupSettings& settings = subgroup_settings_map.at(subgroup_num);
+    const uint64_t in_flight_size = 2ull * settings.profile.window_size * get_num_senders(settings.senders)
+                                    * settings.profile.max_msg_size;
+    // The data ring is mapped twice, so a window starting anywhere in the first mapping is contiguous
+    const auto [mapping, mapping_size] = log->getPlacementRegion();
+    const uint64_t rest_of_mapping = static_cast<uint8_t*>(mapping) + mapping_size - start;
+    const uint64_t window_size = std::min(std::max(in_flight_size, MIN_PLACEMENT_WINDOW_SIZE), rest_of_mapping);
+    dbg_default_debug("Subgroup {}: registering {} bytes of the persistent log for direct placement", subgroup_num, window_size);
+    return std::make_shared<rdma::memory_region>(start, window_size);
+}
+
+void MulticastGroup::register_placement_windows_loop() {
+    pthread_setname_np(pthread_self(), "log_placement");
+    pin_thread("log_placement");
+    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+    while(!thread_shutdown) {
+        auto requested = std::find_if(placement_logs.begin(), placement_logs.end(),
+                                      [](const auto& entry) { return entry.second.requested_window != nullptr; });
+        if(requested == placement_logs.end()) {
+            placement_cv.wait(lock);
+            continue;
+        }
+        const subgroup_id_t subgroup_num = requested->first;
+        persistent::PersistLog* log = requested->second.log;
+        uint8_t* start = requested->second.requested_window;
+        // Pinning the window can take a while, and receives must not wait for it
+        lock.unlock();
+        std::shared_ptr<rdma::memory_region> window_mr;
+        try {
+            window_mr = register_placement_window(subgroup_num, log, start);
+        } catch(...) {
+            dbg_default_warn("Subgroup {}: failed to register a window of the persistent log for direct placement; "
+                             "receiving into ordinary buffers from now on",
+                             subgroup_num);
+        }
+        lock.lock();
+        // Entries of placement_logs are never erased, so the iterator is still valid
+        PlacementLog& placement_log = requested->second;
+        placement_log.requested_window = nullptr;
+        if(!window_mr) {
+            placement_log.log = nullptr;
+            placement_log.windows.clear();
+            continue;
+        }
+        placement_log.windows.push_back(std::move(window_mr));
+        if(placement_log.windows.size() > 2) {
+            // Buffers placed in the oldest window keep it registered until they are released
+            placement_log.windows.erase(placement_log.windows.begin());
+        }
+    }
+}
+
+void MulticastGroup::recycle_message_buffer(subgroup_id_t subgroup_num, MessageBuffer&& buffer) {
+    if(buffer.placement_log) {
+        buffer.placement_log->releasePlacement(buffer.buffer.get());
+    } else {
+        free_message_buffers[subgroup_num].push_back(std::move(buffer));
+    }
+}
+
 void MulticastGroup::initialize_sst_row() {
     auto num_received_size = sst->num_received.size();
     auto seq_num_size = sst->seq_num.size();
@@ -485,11 +678,17 @@ void MulticastGroup::initialize_sst_row() {
         sst->delivered_num[member_index][j] = -1;
         sst->persisted_num[member_index][j] = -1;
         sst->verified_num[member_index][j] = -1;
+        sst->num_cuts[member_index][j] = 0;
     }
     memset(const_cast<uint8_t*>(sst->signatures[member_index]), 0, sst->signatures.size());
     for(uint j = 0; j < total_num_subgroups; j++) {
         sst->index[member_index][j] = -1;
     }
+    for(const auto& [subgroup_num, settings] : subgroup_settings_map) {
+        if(settings.mode == Mode::SEQUENCED) {
+            sequencer_states[subgroup_num].last_delivered_cut.assign(get_num_senders(settings.senders), -1);
+        }
+    }
     // No put(), no sync(). The caller will issue them later.
 }
 
@@ -499,9 +698,13 @@ void MulticastGroup::deliver_message(RDMCMessage& msg, const subgroup_id_t& subg
     if(msg.size <= sizeof(header)) {
         return;
     }
+    confirm_optimistic_delivery(subgroup_num, msg.sender_id, msg.index, version);
 
     uint8_t* buf = msg.message_buffer.buffer.get();
     header* h = (header*)(buf);
+    if(msg.sender_id == members[member_index]) {
+        record_send_latency(subgroup_num, h->timestamp);
+    }
     // cooked send
     if(h->cooked_send) {
         buf += h->header_size;
@@ -527,9 +730,13 @@ void MulticastGroup::deliver_message(SSTMessage& msg, const subgroup_id_t& subgr
     if(msg.size <= sizeof(header)) {
         return;
     }
+    confirm_optimistic_delivery(subgroup_num, msg.sender_id, msg.index, version);
 
     uint8_t* buf = const_cast<uint8_t*>(msg.buf);
     header* h = (header*)(buf);
+    if(msg.sender_id == members[member_index]) {
+        record_send_latency(subgroup_num, h->timestamp);
+    }
     // cooked send
     if(h->cooked_send) {
         buf += h->header_size;
@@ -559,7 +766,7 @@ bool MulticastGroup::version_message(RDMCMessage& msg, const subgroup_id_t& subg
         return false;
     }
     if(msg.sender_id == members[member_index]) {
-        pending_persistence[subgroup_num][locally_stable_rdmc_messages[subgroup_num].begin()->first] = msg_timestamp;
+        pending_persistence[subgroup_num][persistent::unpack_version<int32_t>(version).second] = msg_timestamp;
     }
     // make a version for persistent<t>/volatile<t>
     uint64_t msg_ts_us = msg_timestamp / 1e3;
@@ -581,7 +788,7 @@ bool MulticastGroup::version_message(SSTMessage& msg, const subgroup_id_t& subgr
         return false;
     }
     if(msg.sender_id == members[member_index]) {
-        pending_persistence[subgroup_num][locally_stable_sst_messages[subgroup_num].begin()->first] = msg_timestamp;
+        pending_persistence[subgroup_num][persistent::unpack_version<int32_t>(version).second] = msg_timestamp;
     }
     // make a version for persistent<t>/volatile<t>
     uint64_t msg_ts_us = msg_timestamp / 1e3;
@@ -594,11 +801,44 @@ bool MulticastGroup::version_message(SSTMessage& msg, const subgroup_id_t& subgr
     return true;
 }
 
+void MulticastGroup::finish_delivery_batch(const subgroup_id_t& subgroup_num,
+                                           const persistent::version_t& version) {
+    if(internal_callbacks.delivery_batch_callback) {
+        internal_callbacks.delivery_batch_callback(subgroup_num);
+    }
+    dbg_default_debug("MulticastGroup: Posting persistence request for subgroup {}, version {}", subgroup_num, version);
+    persistence_manager.post_persist_request(subgroup_num, version);
+}
+
 void MulticastGroup::deliver_messages_upto(
         const std::vector<int32_t>& max_indices_for_senders,
-        subgroup_id_t subgroup_num, uint32_t num_shard_senders) {
+        subgroup_id_t subgroup_num, uint32_t num_shard_senders, int32_t num_cuts) {
     bool non_null_msgs_delivered = false;
     assert(max_indices_for_senders.size() == (size_t)num_shard_senders);
+    if(subgroup_settings_map.at(subgroup_num).mode == Mode::SEQUENCED) {
+        {
+            std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+            SequencerState& state = sequencer_states.at(subgroup_num);
+            persistent::version_t assigned_version = persistent::INVALID_VERSION;
+            // Finish the cuts that the ragged trim agreed on, which include every
+            // cut that any member might have delivered, then deliver the rest
+            // in round-robin order
+            while(state.num_delivered_cuts < num_cuts) {
+                assert(!state.pending_cuts.empty());
+                deliver_sequenced_messages(subgroup_num, state.pending_cuts.front(),
+                                           non_null_msgs_delivered, assigned_version);
+                state.pending_cuts.pop_front();
+                state.num_delivered_cuts++;
+            }
+            deliver_sequenced_messages(subgroup_num, max_indices_for_senders, non_null_msgs_delivered, assigned_version);
+            if(non_null_msgs_delivered) {
+                finish_delivery_batch(subgroup_num, assigned_version);
+            }
+        }
+        sst->put(get_shard_sst_indices(subgroup_num),
+                 sst->delivered_num, subgroup_num);
+        return;
+    }
     {
         std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
         int32_t curr_seq_num = sst->delivered_num[member_index][subgroup_num];
@@ -626,7 +866,7 @@ void MulticastGroup::deliver_messages_upto(
                 delivered_version[subgroup_num]->store(assigned_version,std::memory_order_release);
                 non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
                 // free the message buffer only after it version_message has been called
-                free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
+                recycle_message_buffer(subgroup_num, std::move(msg.message_buffer));
                 locally_stable_rdmc_messages[subgroup_num].erase(rdmc_msg_ptr);
             } else {
                 dbg_default_trace("Subgroup {}, deliver_messages_upto delivering an SST message with seq_num = {}",
@@ -641,10 +881,29 @@ void MulticastGroup::deliver_messages_upto(
             }
         }
         gmssst::set(sst->delivered_num[member_index][subgroup_num], max_seq_num);
+        // Optimistically delivered messages that the ragged trim did not deliver
+        // are still waiting here, and will be discarded with this view
+        if(callbacks.optimistic_rollback_callback) {
+            for(int32_t seq_num = curr_seq_num + 1; seq_num <= optimistically_delivered_num[subgroup_num]; seq_num++) {
+                persistent::version_t tentative_version = persistent::combine_int32s(sst->vid[member_index], seq_num);
+                auto rdmc_msg_ptr = locally_stable_rdmc_messages[subgroup_num].find(seq_num);
+                auto sst_msg_ptr = locally_stable_sst_messages[subgroup_num].find(seq_num);
+                if(rdmc_msg_ptr != locally_stable_rdmc_messages[subgroup_num].end()) {
+                    if(rdmc_msg_ptr->second.size > sizeof(header)) {
+                        callbacks.optimistic_rollback_callback(subgroup_num, rdmc_msg_ptr->second.sender_id,
+                                                               rdmc_msg_ptr->second.index, tentative_version);
+                    }
+                } else if(sst_msg_ptr != locally_stable_sst_messages[subgroup_num].end()) {
+                    if(sst_msg_ptr->second.size > sizeof(header)) {
+                        callbacks.optimistic_rollback_callback(subgroup_num, sst_msg_ptr->second.sender_id,
+                                                               sst_msg_ptr->second.index, tentative_version);
+                    }
+                }
+            }
+        }
         if(non_null_msgs_delivered) {
             //Call the persistence_manager_post_persist_func
-            dbg_default_debug("MulticastGroup: Posting persistence request for subgroup {}, version {}", subgroup_num, assigned_version);
-            persistence_manager.post_persist_request(subgroup_num, assigned_version);
+            finish_delivery_batch(subgroup_num, assigned_version);
         }
     }
     sst->put(get_shard_sst_indices(subgroup_num),
@@ -705,10 +964,20 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
     header* h = (header*)data;
     int32_t index = h->index;
     int32_t num_nulls = h->num_nulls;
+    // A coalesced batch is received as one message per index, each pointing
+    // to its own header within the slot. The sender does not reuse the slot
+    // until the whole batch has been delivered.
+    const uint32_t num_batched = h->num_batched > 1 ? h->num_batched : 1;
+    uint32_t batch_position = 0;
 
     do {
         if(num_nulls > 0) {
             size = h->header_size;
+        } else if(num_batched > 1) {
+            if(batch_position > 0) {
+                data += ((header*)data)->record_size;
+            }
+            size = ((header*)data)->record_size;
         }
         message_id_t sequence_number = index * num_shard_senders + sender_rank;
         node_id_t node_id = subgroup_settings.members[shard_ranks_by_sender_rank.at(sender_rank)];
@@ -718,8 +987,8 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
         auto new_num_received = resolve_num_received(index, subgroup_settings.num_received_offset + sender_rank);
 
         /* NULL Send Scheme */
-        // only if I am a sender in the subgroup and the subgroup is not in UNORDERED mode
-        if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode != Mode::UNORDERED) {
+        // only if I am a sender in the subgroup and the subgroup is in round-robin ORDERED mode
+        if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode == Mode::ORDERED) {
             if(subgroup_settings.sender_rank < (int)sender_rank) {
                 while(future_message_indices[subgroup_num] <= new_num_received) {
                     get_buffer_and_send_auto_null(subgroup_num);
@@ -763,7 +1032,7 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
                                                             {{buf + h->header_size, msg.size - h->header_size}},
                                                             persistent::INVALID_VERSION);
                     }
-                    free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
+                    recycle_message_buffer(subgroup_num, std::move(msg.message_buffer));
                     if(node_id == members[member_index]) {
                         pending_message_timestamps[subgroup_num].erase(h->timestamp);
                     }
@@ -773,7 +1042,7 @@ void MulticastGroup::sst_receive_handler(subgroup_id_t subgroup_num, const Subgr
         }
         sst->num_received[member_index][subgroup_settings.num_received_offset + sender_rank] = new_num_received;
         index++;
-    } while(--num_nulls > 0);
+    } while(--num_nulls > 0 || ++batch_position < num_batched);
 }
 
 void MulticastGroup::receiver_function(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
@@ -836,10 +1105,15 @@ void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const Subgroup
     bool update_sst = false;
     {
         std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
-        // compute the min of the seq_num
-        message_id_t min_stable_num
-                = sst.seq_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
+        if(callbacks.optimistic_delivery_callback) {
+            deliver_optimistically(subgroup_num, sst);
+        }
+        // compute the min of the seq_num over the members that count toward stability
+        message_id_t min_stable_num = sst.seq_num[member_index][subgroup_num];
         for(uint i = 0; i < num_shard_members; ++i) {
+            if(!counts_toward_stability(subgroup_settings, i)) {
+                continue;
+            }
             // to avoid a race condition, do not read the same SST entry twice
             message_id_t stable_num_copy = sst.seq_num[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num];
             min_stable_num = std::min(min_stable_num, stable_num_copy);
@@ -871,7 +1145,7 @@ void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const Subgroup
                 delivered_version[subgroup_num]->store(assigned_version,std::memory_order_release);
                 non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
                 // free the message buffer only after version_message has been called
-                free_message_buffers[subgroup_num].push_back(std::move(msg.message_buffer));
+                recycle_message_buffer(subgroup_num, std::move(msg.message_buffer));
                 sst.delivered_num[member_index][subgroup_num] = least_undelivered_rdmc_seq_num;
                 locally_stable_rdmc_messages[subgroup_num].erase(locally_stable_rdmc_messages[subgroup_num].begin());
             } else if(least_undelivered_sst_seq_num < least_undelivered_rdmc_seq_num && least_undelivered_sst_seq_num <= min_stable_num) {
@@ -894,8 +1168,7 @@ void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const Subgroup
         if(update_sst) {
             // post persistence request for ordered mode.
             if(non_null_msgs_delivered) {
-                dbg_default_debug("MulticastGroup: Posting persistence request for subgroup {}, version {}", subgroup_num, assigned_version);
-                persistence_manager.post_persist_request(subgroup_num, assigned_version);
+                finish_delivery_batch(subgroup_num, assigned_version);
             }
         }
     }
@@ -905,14 +1178,313 @@ void MulticastGroup::delivery_trigger(subgroup_id_t subgroup_num, const Subgroup
     }
 }
 
+void MulticastGroup::deliver_optimistically(subgroup_id_t subgroup_num, DerechoSST& sst) {
+    // Everything up to this node's own seq_num has been received in order, and
+    // will be delivered in that order unless a view change trims it
+    const message_id_t local_seq_num = sst.seq_num[member_index][subgroup_num];
+    message_id_t seq_num = std::max(optimistically_delivered_num[subgroup_num],
+                                    static_cast<message_id_t>(sst.delivered_num[member_index][subgroup_num]));
+    while(++seq_num <= local_seq_num) {
+        auto rdmc_msg_ptr = locally_stable_rdmc_messages[subgroup_num].find(seq_num);
+        node_id_t sender_id;
+        message_id_t index;
+        uint8_t* buf;
+        long long int size;
+        if(rdmc_msg_ptr != locally_stable_rdmc_messages[subgroup_num].end()) {
+            sender_id = rdmc_msg_ptr->second.sender_id;
+            index = rdmc_msg_ptr->second.index;
+            buf = rdmc_msg_ptr->second.message_buffer.buffer.get();
+            size = rdmc_msg_ptr->second.size;
+        } else {
+            auto sst_msg_ptr = locally_stable_sst_messages[subgroup_num].find(seq_num);
+            if(sst_msg_ptr == locally_stable_sst_messages[subgroup_num].end()) {
+                continue;
+            }
+            sender_id = sst_msg_ptr->second.sender_id;
+            index = sst_msg_ptr->second.index;
+            buf = const_cast<uint8_t*>(sst_msg_ptr->second.buf);
+            size = sst_msg_ptr->second.size;
+        }
+        // no optimistic delivery for a NULL message
+        if(size <= static_cast<long long int>(sizeof(header))) {
+            continue;
+        }
+        header* h = (header*)buf;
+        std::optional<std::pair<uint8_t*, long long int>> body;
+        if(!h->cooked_send) {
+            body = {buf + h->header_size, size - h->header_size};
+        }
+        callbacks.optimistic_delivery_callback(subgroup_num, sender_id, index, body,
+                                               persistent::combine_int32s(sst.vid[member_index], seq_num));
+    }
+    optimistically_delivered_num[subgroup_num] = std::max(optimistically_delivered_num[subgroup_num], local_seq_num);
+}
+
+void MulticastGroup::confirm_optimistic_delivery(subgroup_id_t subgroup_num, node_id_t sender_id,
+                                                 message_id_t index, const persistent::version_t& version) {
+    if(callbacks.optimistic_confirmation_callback
+       && persistent::unpack_version<int32_t>(version).second <= optimistically_delivered_num[subgroup_num]) {
+        callbacks.optimistic_confirmation_callback(subgroup_num, sender_id, index, version);
+    }
+}
+
+void MulticastGroup::sequenced_delivery_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
+                                                const uint32_t num_shard_members, DerechoSST& sst) {
+    const uint32_t num_shard_senders = get_num_senders(subgroup_settings.senders);
+    const uint32_t leader_row = node_id_to_sst_index.at(subgroup_settings.members[0]);
+    const uint32_t ring_offset = subgroup_settings.num_received_offset * sequencer_cut_ring_size;
+    int32_t published_cut_position = -1;
+    bool cuts_copied = false;
+    bool update_sst = false;
+    {
+        std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+        SequencerState& state = sequencer_states.at(subgroup_num);
+        int32_t num_copied_cuts = sst.num_cuts[member_index][subgroup_num];
+        if(subgroup_settings.shard_rank == 0) {
+            // As the sequencer, publish a cut that adds every message received since the last one
+            const std::vector<int32_t>& last_cut = state.pending_cuts.empty() ? state.last_delivered_cut
+                                                                              : state.pending_cuts.back();
+            bool new_messages = false;
+            for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+                if(sst.num_received[member_index][subgroup_settings.num_received_offset + sender] > last_cut[sender]) {
+                    new_messages = true;
+                    break;
+                }
+            }
+            // The cut overwrites the one sequencer_cut_ring_size cuts ago, which every member must have copied
+            bool ring_has_room = true;
+            for(uint i = 0; i < num_shard_members; ++i) {
+                if(sst.num_cuts[node_id_to_sst_index.at(subgroup_settings.members[i])][subgroup_num]
+                   <= num_copied_cuts - static_cast<int32_t>(sequencer_cut_ring_size)) {
+                    ring_has_room = false;
+                    break;
+                }
+            }
+            if(new_messages && ring_has_room) {
+                published_cut_position = ring_offset + (num_copied_cuts % sequencer_cut_ring_size) * num_shard_senders;
+                std::vector<int32_t> cut(num_shard_senders);
+                for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+                    cut[sender] = sst.num_received[member_index][subgroup_settings.num_received_offset + sender];
+                    sst.sequencer_cuts[member_index][published_cut_position + sender] = cut[sender];
+                }
+                state.pending_cuts.emplace_back(std::move(cut));
+                gmssst::set(sst.num_cuts[member_index][subgroup_num], num_copied_cuts + 1);
+            }
+        } else {
+            const int32_t num_published_cuts = sst.num_cuts[leader_row][subgroup_num];
+            while(num_copied_cuts < num_published_cuts) {
+                const uint32_t cut_position = ring_offset + (num_copied_cuts % sequencer_cut_ring_size) * num_shard_senders;
+                std::vector<int32_t> cut(num_shard_senders);
+                for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+                    cut[sender] = sst.sequencer_cuts[leader_row][cut_position + sender];
+                }
+                state.pending_cuts.emplace_back(std::move(cut));
+                num_copied_cuts++;
+                cuts_copied = true;
+            }
+            if(cuts_copied) {
+                gmssst::set(sst.num_cuts[member_index][subgroup_num], num_copied_cuts);
+            }
+        }
+
+        // Deliver the oldest cut once every member has copied it and received all of its messages
+        bool non_null_msgs_delivered = false;
+        persistent::version_t assigned_version = persistent::INVALID_VERSION;
+        while(!state.pending_cuts.empty()) {
+            const std::vector<int32_t>& cut = state.pending_cuts.front();
+            bool stable = true;
+            for(uint i = 0; i < num_shard_members && stable; ++i) {
+                if(!counts_toward_stability(subgroup_settings, i)) {
+                    continue;
+                }
+                const uint32_t member_row = node_id_to_sst_index.at(subgroup_settings.members[i]);
+                if(sst.num_cuts[member_row][subgroup_num] <= state.num_delivered_cuts) {
+                    stable = false;
+                }
+                for(uint32_t sender = 0; sender < num_shard_senders && stable; ++sender) {
+                    if(sst.num_received[member_row][subgroup_settings.num_received_offset + sender] < cut[sender]) {
+                        stable = false;
+                    }
+                }
+            }
+            if(!stable) {
+                break;
+            }
+            dbg_default_trace("Subgroup {}, delivering sequencer cut {}", subgroup_num, state.num_delivered_cuts);
+            deliver_sequenced_messages(subgroup_num, cut, non_null_msgs_delivered, assigned_version);
+            state.pending_cuts.pop_front();
+            state.num_delivered_cuts++;
+            update_sst = true;
+        }
+        if(non_null_msgs_delivered) {
+            finish_delivery_batch(subgroup_num, assigned_version);
+        }
+
+        // Since sequence numbers no longer identify the sender, find out how
+        // far every member has delivered this node's own messages by matching
+        // delivered_num against the ends of the cuts that included them
+        if(!state.own_cut_ends.empty()) {
+            const message_id_t min_delivered_num = min_shard_delivered_num(subgroup_num, sst);
+            bool own_messages_delivered = false;
+            while(!state.own_cut_ends.empty() && state.own_cut_ends.front().first <= min_delivered_num) {
+                state.own_index_delivered = state.own_cut_ends.front().second;
+                state.own_cut_ends.pop_front();
+                own_messages_delivered = true;
+            }
+            if(own_messages_delivered) {
+                sender_cv.notify_all();
+            }
+        }
+    }
+    const std::vector<uint32_t> shard_sst_indices = get_shard_sst_indices(subgroup_num);
+    if(published_cut_position >= 0) {
+        // The cut must arrive before the count that makes it visible
+        sst.put(shard_sst_indices,
+                (uint8_t*)std::addressof(sst.sequencer_cuts[0][published_cut_position]) - sst.getBaseAddress(),
+                sizeof(sst.sequencer_cuts[0][0]) * num_shard_senders);
+    }
+    if(published_cut_position >= 0 || cuts_copied) {
+        sst.put(shard_sst_indices, sst.num_cuts, subgroup_num);
+    }
+    if(update_sst) {
+        sst.put(shard_sst_indices, sst.delivered_num, subgroup_num);
+    }
+}
+
+void MulticastGroup::deliver_sequenced_messages(subgroup_id_t subgroup_num, const std::vector<int32_t>& next_cut,
+                                                bool& non_null_msgs_delivered, persistent::version_t& assigned_version) {
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    SequencerState& state = sequencer_states.at(subgroup_num);
+    std::vector<int32_t>& last_cut = state.last_delivered_cut;
+    const uint32_t num_shard_senders = last_cut.size();
+    int32_t first_index = std::numeric_limits<int32_t>::max();
+    int32_t last_index = -1;
+    for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+        if(next_cut[sender] > last_cut[sender]) {
+            first_index = std::min(first_index, last_cut[sender] + 1);
+            last_index = std::max(last_index, next_cut[sender]);
+        }
+    }
+    message_id_t seq_num = sst->delivered_num[member_index][subgroup_num];
+    for(int32_t index = first_index; index <= last_index; ++index) {
+        for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+            if(index <= last_cut[sender] || index > next_cut[sender]) {
+                continue;
+            }
+            seq_num++;
+            // The message is stored under its round-robin sequence number, but
+            // versioned by its position in the sequencer's order
+            const message_id_t storage_seq_num = index * num_shard_senders + sender;
+            assigned_version = persistent::combine_int32s(sst->vid[member_index], seq_num);
+            auto rdmc_msg_ptr = locally_stable_rdmc_messages[subgroup_num].find(storage_seq_num);
+            if(rdmc_msg_ptr != locally_stable_rdmc_messages[subgroup_num].end()) {
+                auto& msg = rdmc_msg_ptr->second;
+                uint8_t* buf = msg.message_buffer.buffer.get();
+                uint64_t msg_ts = ((header*)buf)->timestamp;
+                deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
+                delivered_version[subgroup_num]->store(assigned_version, std::memory_order_release);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                recycle_message_buffer(subgroup_num, std::move(msg.message_buffer));
+                locally_stable_rdmc_messages[subgroup_num].erase(rdmc_msg_ptr);
+            } else {
+                auto& msg = locally_stable_sst_messages[subgroup_num].at(storage_seq_num);
+                uint8_t* buf = (uint8_t*)msg.buf;
+                uint64_t msg_ts = ((header*)buf)->timestamp;
+                deliver_message(msg, subgroup_num, assigned_version, msg_ts / 1000);
+                delivered_version[subgroup_num]->store(assigned_version, std::memory_order_release);
+                non_null_msgs_delivered |= version_message(msg, subgroup_num, assigned_version, msg_ts);
+                locally_stable_sst_messages[subgroup_num].erase(storage_seq_num);
+            }
+        }
+    }
+    const int sender_rank = subgroup_settings.sender_rank;
+    if(sender_rank >= 0 && next_cut[sender_rank] > last_cut[sender_rank]) {
+        state.own_cut_ends.emplace_back(seq_num, next_cut[sender_rank]);
+    }
+    for(uint32_t sender = 0; sender < num_shard_senders; ++sender) {
+        last_cut[sender] = std::max(last_cut[sender], next_cut[sender]);
+    }
+    gmssst::set(sst->delivered_num[member_index][subgroup_num], seq_num);
+}
+
+int32_t MulticastGroup::get_ragged_trim_num_cuts(subgroup_id_t subgroup_num, int32_t max_num_cuts,
+                                                 const std::vector<int32_t>& max_indices_for_senders) {
+    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    auto state = sequencer_states.find(subgroup_num);
+    if(state == sequencer_states.end()) {
+        return 0;
+    }
+    // Cuts that have already been delivered here lie within the trim, since
+    // every member received their messages
+    int32_t num_cuts = state->second.num_delivered_cuts;
+    for(const auto& cut : state->second.pending_cuts) {
+        if(num_cuts >= max_num_cuts) {
+            break;
+        }
+        for(uint32_t sender = 0; sender < cut.size(); ++sender) {
+            if(cut[sender] > max_indices_for_senders[sender]) {
+                return num_cuts;
+            }
+        }
+        num_cuts++;
+    }
+    return num_cuts;
+}
+
+bool MulticastGroup::delivered_by_all(subgroup_id_t subgroup_num, message_id_t index) {
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    if(subgroup_settings.mode == Mode::SEQUENCED) {
+        // own_index_delivered only advances when the delivery trigger runs, so
+        // also match the cuts not yet retired against the shard's current minimum
+        const SequencerState& state = sequencer_states.at(subgroup_num);
+        if(state.own_index_delivered >= index) {
+            return true;
+        }
+        const message_id_t min_delivered_num = min_shard_delivered_num(subgroup_num, *sst);
+        for(const auto& [cut_end, own_index] : state.own_cut_ends) {
+            if(cut_end > min_delivered_num) {
+                return false;
+            }
+            if(own_index >= index) {
+                return true;
+            }
+        }
+        return false;
+    }
+    const uint32_t num_shard_senders = get_num_senders(subgroup_settings.senders);
+    const message_id_t seq_num = index * num_shard_senders + subgroup_settings.sender_rank;
+    for(const node_id_t shard_member : subgroup_settings.members) {
+        if(sst->delivered_num[node_id_to_sst_index.at(shard_member)][subgroup_num] < seq_num) {
+            return false;
+        }
+    }
+    return true;
+}
+
+message_id_t MulticastGroup::min_shard_delivered_num(subgroup_id_t subgroup_num, const DerechoSST& sst) const {
+    message_id_t min_delivered_num = std::numeric_limits<message_id_t>::max();
+    for(const node_id_t shard_member : subgroup_settings_map.at(subgroup_num).members) {
+        message_id_t delivered_num_copy = sst.delivered_num[node_id_to_sst_index.at(shard_member)][subgroup_num];
+        min_delivered_num = std::min(min_delivered_num, delivered_num_copy);
+    }
+    return min_delivered_num;
+}
+
 void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                       const uint32_t num_shard_members, DerechoSST& sst) {
     int32_t current_committed_index;
     int32_t to_be_sent;
     int32_t current_first_null_index;
     uint32_t current_num_nulls_queued;
+    std::vector<sst::multicast_group<DerechoSST>::slot_run> current_slot_runs;
     {
         std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+        // Send any coalesced messages that have waited out their linger time
+        auto batch = coalesced_sends.find(subgroup_num);
+        if(batch != coalesced_sends.end() && batch->second.num_messages > 0
+           && get_time() - batch->second.first_message_time >= subgroup_settings.profile.coalesce_linger_us * 1000ull) {
+            flush_coalesced_sends(subgroup_num);
+        }
         to_be_sent = committed_sst_index[subgroup_num] - sst.index[member_index][subgroup_settings.index_offset];
         if(to_be_sent > 0) {
             current_committed_index = sst_multicast_group_ptrs[subgroup_num]->commit_send(to_be_sent);
@@ -921,6 +1493,7 @@ void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const Subgroup
             current_num_nulls_queued = num_nulls_queued[subgroup_num];
             first_null_index[subgroup_num] = -1;
             num_nulls_queued[subgroup_num] = 0;
+            current_slot_runs.swap(coalesced_slot_runs[subgroup_num]);
         }
     }
     // Here lock is released
@@ -933,21 +1506,70 @@ void MulticastGroup::sst_send_trigger(subgroup_id_t subgroup_num, const Subgroup
             h->num_nulls = current_num_nulls_queued;
         }
 
-        sst_multicast_group_ptrs[subgroup_num]->send(current_committed_index, to_be_sent, current_num_nulls_queued,
-                                                     current_first_null_index, sizeof(header));
+        if(current_slot_runs.empty()) {
+            sst_multicast_group_ptrs[subgroup_num]->send(current_committed_index, to_be_sent, current_num_nulls_queued,
+                                                         current_first_null_index, sizeof(header));
+        } else {
+            // Coalesced batches only push the part of their slot they fill, and a run of nulls only its first slot
+            if(current_num_nulls_queued > 0) {
+                current_slot_runs.push_back({current_first_null_index, current_num_nulls_queued, sizeof(header)});
+                std::sort(current_slot_runs.begin(), current_slot_runs.end(),
+                          [](const auto& lhs, const auto& rhs) { return lhs.first_index < rhs.first_index; });
+            }
+            sst_multicast_group_ptrs[subgroup_num]->send(current_committed_index, to_be_sent, current_slot_runs);
+        }
     }
 }
 
 void MulticastGroup::update_min_persisted_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                               uint32_t num_shard_members, DerechoSST& sst) {
     std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
-    // compute the min of the persisted_num
+    // Warm standbys persist every version too, but the frontiers don't wait for them
+    std::vector<persistent::version_t> persisted_nums;
+    persisted_nums.reserve(num_shard_members);
+    bool standby_advanced = false;
+    for(uint32_t i = 0; i < num_shard_members; ++i) {
+        const uint32_t member_row = node_id_to_sst_index.at(subgroup_settings.members[i]);
+        if(!is_standby(subgroup_settings, i)) {
+            persisted_nums.push_back(sst.persisted_num[member_row][subgroup_num]);
+            continue;
+        }
+        // Track the standby's own progress instead, for wait_for_standby()
+        std::vector<std::pair<message_id_t, persistent::version_t>>& progress = standby_progress[subgroup_num];
+        progress.resize(num_shard_members, {-1, persistent::INVALID_VERSION});
+        const std::pair<message_id_t, persistent::version_t> standby_nums{sst.delivered_num[member_row][subgroup_num],
+                                                                          sst.persisted_num[member_row][subgroup_num]};
+        if(standby_nums != progress[i]) {
+            progress[i] = standby_nums;
+            standby_advanced = true;
+        }
+    }
+    if(standby_advanced) {
+        sender_cv.notify_all();
+    }
+    if(persisted_nums.empty()) {
+        return;
+    }
+    // the quorum frontier is the k-th largest persisted_num, and the global frontier is the smallest
+    uint32_t quorum = subgroup_settings.profile.persistence_quorum;
+    if(quorum == 0 || quorum > persisted_nums.size()) {
+        quorum = persisted_nums.size();
+    }
+    std::nth_element(persisted_nums.begin(), persisted_nums.begin() + (quorum - 1), persisted_nums.end(),
+                     std::greater<persistent::version_t>());
+    persistent::version_t quorum_persisted_num = persisted_nums[quorum - 1];
     persistent::version_t min_persisted_num
-            = sst.persisted_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
-    for(uint32_t i = 1; i < num_shard_members; ++i) {
-        persistent::version_t persisted_num_copy = sst.persisted_num[node_id_to_sst_index.at(subgroup_settings.members[i])]
-                                                                    [subgroup_num];
-        min_persisted_num = std::min(min_persisted_num, persisted_num_copy);
+            = *std::min_element(persisted_nums.begin() + (quorum - 1), persisted_nums.end());
+    // The quorum frontier moves first, since it can never be behind the global one
+    if(quorum_persisted_num > quorum_persisted_version[subgroup_num]->load(std::memory_order_relaxed)) {
+        if(callbacks.quorum_persistence_callback) {
+            callbacks.quorum_persistence_callback(subgroup_num, quorum_persisted_num);
+        }
+        if(internal_callbacks.quorum_persistence_callback) {
+            internal_callbacks.quorum_persistence_callback(subgroup_num, quorum_persisted_num);
+        }
+        quorum_persisted_version[subgroup_num]->store(quorum_persisted_num, std::memory_order_relaxed);
+        quorum_persisted_cv[subgroup_num].notify_all();
     }
     // callbacks
     if(min_persisted_num > minimum_persisted_version[subgroup_num]->load(std::memory_order_relaxed)) {
@@ -960,20 +1582,25 @@ void MulticastGroup::update_min_persisted_num(subgroup_id_t subgroup_num, const
         persistence_manager.post_verify_request(subgroup_num, min_persisted_num);
         minimum_persisted_version[subgroup_num]->store(min_persisted_num,std::memory_order_relaxed);
         minimum_persisted_cv[subgroup_num].notify_all();
+        // ViewManager::drain() waits on sender_cv for the global frontier
+        sender_cv.notify_all();
     }
 }
 
 void MulticastGroup::update_min_verified_num(subgroup_id_t subgroup_num, const SubgroupSettings& subgroup_settings,
                                              uint32_t num_shard_members, DerechoSST& sst) {
     //Do I need msg_state_mtx here? What does it guard?
-    persistent::version_t min_verified_num
-            = sst.verified_num[node_id_to_sst_index.at(subgroup_settings.members[0])][subgroup_num];
-    for(uint32_t i = 1; i < num_shard_members; ++i) {
+    persistent::version_t min_verified_num = std::numeric_limits<persistent::version_t>::max();
+    for(uint32_t i = 0; i < num_shard_members; ++i) {
+        if(is_standby(subgroup_settings, i)) {
+            continue;
+        }
         persistent::version_t member_verified_num = sst.verified_num[node_id_to_sst_index.at(subgroup_settings.members[i])]
                                                                     [subgroup_num];
         min_verified_num = std::min(min_verified_num, member_verified_num);
     }
-    if(min_verified_num > minimum_verified_version[subgroup_num]->load(std::memory_order_relaxed)) {
+    if(min_verified_num != std::numeric_limits<persistent::version_t>::max()
+       && min_verified_num > minimum_verified_version[subgroup_num]->load(std::memory_order_relaxed)) {
         if(callbacks.global_verified_callback) {
             callbacks.global_verified_callback(subgroup_num, min_verified_num);
         }
@@ -1030,7 +1657,11 @@ void MulticastGroup::register_predicates() {
                 return true;
             };
             auto delivery_trig = [=](DerechoSST& sst) mutable {
-                delivery_trigger(subgroup_num, subgroup_settings, num_shard_members, sst);
+                if(subgroup_settings.mode == Mode::SEQUENCED) {
+                    sequenced_delivery_trigger(subgroup_num, subgroup_settings, num_shard_members, sst);
+                } else {
+                    delivery_trigger(subgroup_num, subgroup_settings, num_shard_members, sst);
+                }
             };
 
             delivery_pred_handles.emplace_back(sst->predicates.insert(delivery_pred, delivery_trig,
@@ -1059,7 +1690,8 @@ void MulticastGroup::register_predicates() {
 
             persistence_pred_handles.emplace_back(sst->predicates.insert(verified_pred, verified_trig, sst::PredicateType::RECURRENT));
 
-            if(subgroup_settings.sender_rank >= 0) {
+            // In SEQUENCED mode, sequenced_delivery_trigger wakes up the sender instead
+            if(subgroup_settings.sender_rank >= 0 && subgroup_settings.mode == Mode::ORDERED) {
                 auto sender_pred = [=](const DerechoSST& sst) {
                     message_id_t seq_num = next_message_to_deliver[subgroup_num] * num_shard_senders + subgroup_settings.sender_rank;
                     for(uint i = 0; i < num_shard_members; ++i) {
@@ -1070,6 +1702,9 @@ void MulticastGroup::register_predicates() {
                     return true;
                 };
                 auto sender_trig = [=](DerechoSST& sst) {
+                    // Lock msg_state_mtx so a thread that just found its message
+                    // undelivered is already waiting when it is notified
+                    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
                     sender_cv.notify_all();
                     next_message_to_deliver[subgroup_num]++;
                 };
@@ -1130,18 +1765,27 @@ void MulticastGroup::wedge() {
         handle_iter = persistence_pred_handles.erase(handle_iter);
     }
 
-    for(uint i = 0; i < num_members; ++i) {
-        rdmc::destroy_group(i + rdmc_group_num_offset);
+    for(uint16_t rdmc_group_num : rdmc_group_numbers) {
+        rdmc::destroy_group(rdmc_group_num);
     }
 
+    {
+        // Threads that checked thread_shutdown under msg_state_mtx are waiting by now
+        std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    }
     sender_cv.notify_all();
     if(sender_thread.joinable()) {
         sender_thread.join();
     }
+    placement_cv.notify_all();
+    if(placement_thread.joinable()) {
+        placement_thread.join();
+    }
 }
 
 void MulticastGroup::send_loop() {
     pthread_setname_np(pthread_self(), "sender_thread");
+    pin_thread("sender_thread");
     subgroup_id_t subgroup_to_send = 0;
     auto should_send_to_subgroup = [&](subgroup_id_t subgroup_num) {
         if(!rdmc_sst_groups_created) {
@@ -1154,8 +1798,6 @@ void MulticastGroup::send_loop() {
         const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
 
         int shard_sender_index = subgroup_settings.sender_rank;
-        std::vector<int> shard_senders = subgroup_settings.senders;
-        uint32_t num_shard_senders = get_num_senders(shard_senders);
         assert(shard_sender_index >= 0);
 
         if(sst->num_received[member_index][subgroup_settings.num_received_offset + shard_sender_index] < msg.index - 1) {
@@ -1166,10 +1808,8 @@ void MulticastGroup::send_loop() {
         auto num_shard_members = shard_members.size();
         assert(num_shard_members >= 1);
         if(subgroup_settings.mode != Mode::UNORDERED) {
-            for(uint i = 0; i < num_shard_members; ++i) {
-                if(sst->delivered_num[node_id_to_sst_index.at(shard_members[i])][subgroup_num] < static_cast<message_id_t>((msg.index - subgroup_settings.profile.window_size) * num_shard_senders + shard_sender_index)) {
-                    return false;
-                }
+            if(!delivered_by_all(subgroup_num, msg.index - subgroup_settings.profile.window_size)) {
+                return false;
             }
         } else {
             for(uint i = 0; i < num_shard_members; ++i) {
@@ -1183,21 +1823,53 @@ void MulticastGroup::send_loop() {
 
         return true;
     };
+    // Among the ready subgroups, only those with the highest priority are
+    // eligible, and they share the sender by smooth weighted round-robin:
+    // each round, every eligible subgroup gains its weight in credit, and the
+    // one with the most credit sends and pays back the total weight.
+    std::vector<int64_t> send_credits(total_num_subgroups, 0);
+    std::vector<subgroup_id_t> eligible_subgroups;
+    // Finds the eligible subgroups without changing the credits, since the
+    // wait predicate may be evaluated any number of times per send
     auto should_send = [&]() {
-        for(uint i = 1; i <= total_num_subgroups; ++i) {
-            auto subgroup_num = (subgroup_to_send + i) % total_num_subgroups;
-            if(should_send_to_subgroup(subgroup_num)) {
-                subgroup_to_send = subgroup_num;
-                return true;
+        eligible_subgroups.clear();
+        uint32_t highest_priority = 0;
+        for(subgroup_id_t subgroup_num = 0; subgroup_num < total_num_subgroups; ++subgroup_num) {
+            if(!should_send_to_subgroup(subgroup_num)) {
+                continue;
+            }
+            uint32_t priority = subgroup_settings_map.at(subgroup_num).profile.priority;
+            if(eligible_subgroups.empty() || priority > highest_priority) {
+                eligible_subgroups.clear();
+                highest_priority = priority;
+            }
+            if(priority == highest_priority) {
+                eligible_subgroups.push_back(subgroup_num);
             }
         }
-        return false;
+        return !eligible_subgroups.empty();
+    };
+    // Charges one round of credits, once per send, to pick the subgroup to send in
+    auto pick_subgroup = [&]() {
+        int64_t total_weight = 0;
+        subgroup_id_t best_subgroup = eligible_subgroups.front();
+        for(subgroup_id_t subgroup_num : eligible_subgroups) {
+            int64_t weight = std::max<uint32_t>(subgroup_settings_map.at(subgroup_num).profile.weight, 1);
+            send_credits[subgroup_num] += weight;
+            total_weight += weight;
+            if(send_credits[subgroup_num] > send_credits[best_subgroup]) {
+                best_subgroup = subgroup_num;
+            }
+        }
+        send_credits[best_subgroup] -= total_weight;
+        return best_subgroup;
     };
     auto should_wake = [&]() { return thread_shutdown || should_send(); };
     std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
     while(!thread_shutdown) {
         sender_cv.wait(lock, should_wake);
         if(!thread_shutdown) {
+            subgroup_to_send = pick_subgroup();
             current_sends[subgroup_to_send] = std::move(pending_sends[subgroup_to_send].front());
             dbg_default_trace("Calling send in subgroup {} on message {} from sender {}",
                               subgroup_to_send, current_sends[subgroup_to_send]->index, current_sends[subgroup_to_send]->sender_id);
@@ -1220,14 +1892,93 @@ void MulticastGroup::send_loop() {
 
 const uint64_t MulticastGroup::compute_global_stability_frontier(uint32_t subgroup_num) const {
     uint64_t global_stability_frontier = sst->local_stability_frontier[member_index][subgroup_num];
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
     auto shard_sst_indices = get_shard_sst_indices(subgroup_num);
-    for(auto index : shard_sst_indices) {
-        uint64_t local_stability_frontier_copy = sst->local_stability_frontier[index][subgroup_num];
+    for(uint32_t shard_rank = 0; shard_rank < shard_sst_indices.size(); ++shard_rank) {
+        if(!counts_toward_stability(subgroup_settings, shard_rank)) {
+            continue;
+        }
+        uint64_t local_stability_frontier_copy = sst->local_stability_frontier[shard_sst_indices[shard_rank]][subgroup_num];
         global_stability_frontier = std::min(global_stability_frontier, local_stability_frontier_copy);
     }
     return global_stability_frontier;
 }
 
+std::map<subgroup_id_t, message_id_t> MulticastGroup::get_last_send_indices() {
+    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    std::map<subgroup_id_t, message_id_t> last_send_indices;
+    for(const auto& [subgroup_num, subgroup_settings] : subgroup_settings_map) {
+        if(subgroup_settings.sender_rank < 0) {
+            continue;
+        }
+        message_id_t last_index = future_message_indices[subgroup_num] - 1;
+        // An unflushed batch will take the next index when it is flushed
+        auto batch = coalesced_sends.find(subgroup_num);
+        if(batch != coalesced_sends.end() && batch->second.num_messages > 0) {
+            last_index++;
+        }
+        last_send_indices.emplace(subgroup_num, last_index);
+    }
+    return last_send_indices;
+}
+
+bool MulticastGroup::delivered_upto(const std::map<subgroup_id_t, message_id_t>& last_send_indices) {
+    std::lock_guard<std::recursive_mutex> lock(msg_state_mtx);
+    for(const auto& [subgroup_num, last_index] : last_send_indices) {
+        if(last_index >= 0 && !delivered_by_all(subgroup_num, last_index)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+persistent::version_t MulticastGroup::get_delivered_version(subgroup_id_t subgroup_num) const {
+    return delivered_version[subgroup_num]->load(std::memory_order_acquire);
+}
+
+bool MulticastGroup::wait_for_drained(const std::map<subgroup_id_t, message_id_t>& last_send_indices,
+                                      const std::map<subgroup_id_t, persistent::version_t>& persisted_versions,
+                                      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    auto caught_up = [&]() {
+        if(!delivered_upto(last_send_indices)) {
+            return false;
+        }
+        for(const auto& [subgroup_num, version] : persisted_versions) {
+            if(get_global_persistence_frontier(subgroup_num) < version) {
+                return false;
+            }
+        }
+        return true;
+    };
+    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+    auto should_wake = [&]() { return thread_shutdown || caught_up(); };
+    if(deadline) {
+        sender_cv.wait_until(lock, *deadline, should_wake);
+    } else {
+        sender_cv.wait(lock, should_wake);
+    }
+    return caught_up();
+}
+
+bool MulticastGroup::wait_for_standby(subgroup_id_t subgroup_num, node_id_t standby_id,
+                                      persistent::version_t persisted_version,
+                                      std::optional<std::chrono::steady_clock::time_point> deadline) {
+    const uint32_t standby_row = node_id_to_sst_index.at(standby_id);
+    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+    const message_id_t delivered_num = sst->delivered_num[member_index][subgroup_num];
+    auto caught_up = [&]() {
+        return sst->delivered_num[standby_row][subgroup_num] >= delivered_num
+               && sst->persisted_num[standby_row][subgroup_num] >= persisted_version;
+    };
+    auto should_wake = [&]() { return thread_shutdown || caught_up(); };
+    if(deadline) {
+        sender_cv.wait_until(lock, *deadline, should_wake);
+    } else {
+        sender_cv.wait(lock, should_wake);
+    }
+    return caught_up();
+}
+
 const persistent::version_t MulticastGroup::get_global_persistence_frontier(uint32_t subgroup_num) const {
     return this->minimum_persisted_version[subgroup_num]->load(std::memory_order_relaxed);
 }
@@ -1250,12 +2001,34 @@ bool MulticastGroup::wait_for_global_persistence_frontier(subgroup_id_t subgroup
     return true;
 }
 
+const persistent::version_t MulticastGroup::get_quorum_persistence_frontier(uint32_t subgroup_num) const {
+    return this->quorum_persisted_version[subgroup_num]->load(std::memory_order_relaxed);
+}
+
+bool MulticastGroup::wait_for_quorum_persistence_frontier(subgroup_id_t subgroup_num, persistent::version_t version) const {
+    if(this->quorum_persisted_version[subgroup_num]->load(std::memory_order_relaxed) >= version) {
+        return true;
+    }
+
+    if(version > delivered_version[subgroup_num]->load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    std::unique_lock<std::mutex> lck{quorum_persisted_mtx[subgroup_num]};
+    quorum_persisted_cv[subgroup_num].wait(lck, [this, subgroup_num, version] {
+        return this->quorum_persisted_version[subgroup_num]->load(std::memory_order_relaxed) >= version;
+    });
+
+    return true;
+}
+
 const persistent::version_t MulticastGroup::get_global_verified_frontier(uint32_t subgroup_num) const {
     return this->minimum_verified_version[subgroup_num]->load(std::memory_order_relaxed);
 }
 
 void MulticastGroup::check_failures_loop() {
     pthread_setname_np(pthread_self(), "timeout_thread");
+    pin_thread("timeout_thread");
     while(!thread_shutdown) {
         std::this_thread::sleep_for(std::chrono::milliseconds(sender_timeout));
         if(sst) {
@@ -1333,8 +2106,10 @@ void MulticastGroup::get_buffer_and_send_auto_null(subgroup_id_t subgroup_num) {
         ((header*)buf)->index = future_message_indices[subgroup_num];
         ((header*)buf)->timestamp = current_time;
         ((header*)buf)->num_nulls = 0;
+        ((header*)buf)->num_batched = 0;
         ((header*)buf)->cooked_send = false;
 
+        record_sst_slot(subgroup_num, future_message_indices[subgroup_num]);
         future_message_indices[subgroup_num]++;
         committed_sst_index[subgroup_num]++;
 
@@ -1356,33 +2131,21 @@ uint8_t* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
         throw derecho_exception(exp_msg);
     }
 
-    std::vector<node_id_t> shard_members = subgroup_settings.members;
-    auto num_shard_members = shard_members.size();
-    // if the current node is not a sender, shard_sender_index will be -1
-    uint32_t num_shard_senders;
-    std::vector<int> shard_senders = subgroup_settings.senders;
-    int shard_sender_index = subgroup_settings.sender_rank;
-    num_shard_senders = get_num_senders(shard_senders);
-    assert(shard_sender_index >= 0);
-
-    if(subgroup_settings.mode != Mode::UNORDERED) {
-        for(uint i = 0; i < num_shard_members; ++i) {
-            if(sst->delivered_num[node_id_to_sst_index.at(shard_members[i])][subgroup_num]
-               < static_cast<int32_t>((future_message_indices[subgroup_num] - subgroup_settings.profile.window_size) * num_shard_senders + shard_sender_index)) {
-                return nullptr;
-            }
+    if(coalesced_sends.count(subgroup_num)) {
+        if(msg_size <= subgroup_settings.profile.sst_max_msg_size) {
+            return get_coalesced_sendbuffer_ptr(subgroup_num, msg_size, cooked_send);
         }
-    } else {
-        for(uint i = 0; i < num_shard_members; ++i) {
-            auto num_received_offset = subgroup_settings.num_received_offset;
-            if(sst->num_received[node_id_to_sst_index.at(shard_members[i])][num_received_offset + shard_sender_index]
-               < static_cast<int32_t>(future_message_indices[subgroup_num] - subgroup_settings.profile.window_size)) {
-                return nullptr;
-            }
+        // A message that is sent directly must not overtake the ones waiting to be coalesced
+        if(!flush_coalesced_sends(subgroup_num)) {
+            return nullptr;
         }
     }
 
     if(msg_size > subgroup_settings.profile.sst_max_msg_size) {
+        if(!window_has_room(subgroup_num)) {
+            return nullptr;
+        }
+
         if(thread_shutdown) {
             return nullptr;
         }
@@ -1419,6 +2182,10 @@ uint8_t* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
         last_transfer_medium[subgroup_num] = true;
         return buf + sizeof(header);
     } else {
+        if(!sst_window_has_room(subgroup_num)) {
+            return nullptr;
+        }
+
         if(smc_send_in_progress[subgroup_num] || next_sends[subgroup_num]) {
             return nullptr;
         }
@@ -1440,7 +2207,9 @@ uint8_t* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
         ((header*)buf)->index = future_message_indices[subgroup_num];
         ((header*)buf)->timestamp = current_time;
         ((header*)buf)->num_nulls = 0;
+        ((header*)buf)->num_batched = 0;
         ((header*)buf)->cooked_send = cooked_send;
+        record_sst_slot(subgroup_num, future_message_indices[subgroup_num]);
         future_message_indices[subgroup_num]++;
         dbg_default_trace("Subgroup {}: get_sendbuffer_ptr increased future_message_indices to {}",
                           subgroup_num, future_message_indices[subgroup_num]);
@@ -1450,11 +2219,255 @@ uint8_t* MulticastGroup::get_sendbuffer_ptr(subgroup_id_t subgroup_num,
     }
 }
 
+void MulticastGroup::init_send_admission_controls() {
+    for(const auto& [subgroup_num, settings] : subgroup_settings_map) {
+        const DerechoParams& profile = settings.profile;
+        if(settings.sender_rank < 0
+           || (profile.rate_limit == 0 && profile.sender_rate_limit == 0 && profile.admission_target_us == 0)) {
+            continue;
+        }
+        uint32_t num_shard_senders = get_num_senders(settings.senders);
+        auto control = send_admission_controls.find(subgroup_num);
+        if(control != send_admission_controls.end()) {
+            control->second->set_num_senders(num_shard_senders);
+        } else {
+            send_admission_controls.emplace(subgroup_num, std::make_unique<SendAdmissionControl>(
+                                                                  profile.rate_limit, profile.sender_rate_limit,
+                                                                  profile.rate_limit_burst, profile.admission_target_us,
+                                                                  profile.admission_interval_us, num_shard_senders));
+        }
+    }
+}
+
+void MulticastGroup::init_coalesced_sends() {
+    for(auto it = coalesced_sends.begin(); it != coalesced_sends.end();) {
+        auto settings = subgroup_settings_map.find(it->first);
+        if(settings == subgroup_settings_map.end() || settings->second.sender_rank < 0) {
+            dbg_default_warn("Failing {} coalesced messages for subgroup {} because this node is no longer a sender in it",
+                             it->second.num_messages, it->first);
+            fail_coalesced_sends(it->first, it->second);
+            it = coalesced_sends.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    for(const auto& [subgroup_num, settings] : subgroup_settings_map) {
+        const DerechoParams& profile = settings.profile;
+        // Either setting turns coalescing on; with no linger time, a batch is
+        // sent by the next pass of the send trigger, so messages only wait for
+        // one another while the sender is busy
+        if(settings.sender_rank < 0 || (profile.coalesce_linger_us == 0 && profile.coalesce_max_bytes == 0)
+           || profile.sst_max_msg_size <= sizeof(header) || coalesced_sends.count(subgroup_num)) {
+            continue;
+        }
+        CoalescedSends& batch = coalesced_sends[subgroup_num];
+        batch.capacity = profile.sst_max_msg_size;
+        batch.flush_threshold = profile.coalesce_max_bytes > 0
+                                        ? std::min<std::size_t>(profile.coalesce_max_bytes, batch.capacity)
+                                        : batch.capacity;
+        batch.buffer = std::make_unique<uint8_t[]>(batch.capacity);
+    }
+}
+
+void MulticastGroup::fail_coalesced_sends(subgroup_id_t subgroup_num, const CoalescedSends& batch) {
+    uint32_t num_rpc_calls = 0;
+    uint8_t* record = batch.buffer.get();
+    for(uint32_t i = 0; i < batch.num_messages; ++i) {
+        header* h = (header*)record;
+        if(h->cooked_send) {
+            num_rpc_calls++;
+        } else if(callbacks.send_failure_callback) {
+            callbacks.send_failure_callback(subgroup_num, {record + h->header_size, h->record_size - h->header_size});
+        }
+        record += h->record_size;
+    }
+    if(num_rpc_calls > 0 && internal_callbacks.rpc_send_failure_callback) {
+        internal_callbacks.rpc_send_failure_callback(subgroup_num, num_rpc_calls);
+    }
+}
+
+bool MulticastGroup::window_has_room(subgroup_id_t subgroup_num) {
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    const std::vector<node_id_t>& shard_members = subgroup_settings.members;
+    int shard_sender_index = subgroup_settings.sender_rank;
+    assert(shard_sender_index >= 0);
+    const message_id_t next_index = future_message_indices[subgroup_num];
+
+    if(subgroup_settings.mode != Mode::UNORDERED) {
+        if(!delivered_by_all(subgroup_num, next_index - subgroup_settings.profile.window_size)) {
+            return false;
+        }
+    } else {
+        for(uint i = 0; i < shard_members.size(); ++i) {
+            auto num_received_offset = subgroup_settings.num_received_offset;
+            if(sst->num_received[node_id_to_sst_index.at(shard_members[i])][num_received_offset + shard_sender_index]
+               < static_cast<int32_t>(next_index - subgroup_settings.profile.window_size)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+bool MulticastGroup::sst_window_has_room(subgroup_id_t subgroup_num) {
+    const SubgroupSettings& subgroup_settings = subgroup_settings_map.at(subgroup_num);
+    const std::vector<node_id_t>& shard_members = subgroup_settings.members;
+    int shard_sender_index = subgroup_settings.sender_rank;
+    assert(shard_sender_index >= 0);
+    // The last message held by the slot the next SST multicast will overwrite.
+    // For a slot holding a coalesced batch, this is the end of the batch.
+    const std::vector<message_id_t>& slot_last_index = sst_slot_last_index[subgroup_num];
+    const message_id_t overwritten_index = slot_last_index[num_sst_slots_reserved[subgroup_num] % slot_last_index.size()];
+    if(overwritten_index < 0) {
+        return true;
+    }
+
+    if(subgroup_settings.mode != Mode::UNORDERED) {
+        return delivered_by_all(subgroup_num, overwritten_index);
+    }
+    for(uint i = 0; i < shard_members.size(); ++i) {
+        auto num_received_offset = subgroup_settings.num_received_offset;
+        if(sst->num_received[node_id_to_sst_index.at(shard_members[i])][num_received_offset + shard_sender_index]
+           < overwritten_index) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void MulticastGroup::record_sst_slot(subgroup_id_t subgroup_num, message_id_t last_index) {
+    std::vector<message_id_t>& slot_last_index = sst_slot_last_index[subgroup_num];
+    slot_last_index[num_sst_slots_reserved[subgroup_num] % slot_last_index.size()] = last_index;
+    num_sst_slots_reserved[subgroup_num]++;
+}
+
+uint8_t* MulticastGroup::get_coalesced_sendbuffer_ptr(subgroup_id_t subgroup_num,
+                                                      long long unsigned int msg_size,
+                                                      bool cooked_send) {
+    if(thread_shutdown) {
+        return nullptr;
+    }
+    CoalescedSends& batch = coalesced_sends.at(subgroup_num);
+    if(batch.used + msg_size > batch.capacity || batch.num_messages >= std::numeric_limits<uint16_t>::max()) {
+        if(!flush_coalesced_sends(subgroup_num)) {
+            return nullptr;
+        }
+    }
+    uint8_t* buf = batch.buffer.get() + batch.used;
+    header* h = (header*)buf;
+    h->header_size = sizeof(header);
+    // The index is assigned when the batch is flushed
+    h->index = -1;
+    h->timestamp = get_walltime();
+    h->num_nulls = 0;
+    h->cooked_send = cooked_send;
+    h->num_batched = 0;
+    h->record_size = msg_size;
+    last_send_coalesced[subgroup_num] = true;
+    return buf + sizeof(header);
+}
+
+bool MulticastGroup::flush_coalesced_sends(subgroup_id_t subgroup_num) {
+    auto batch_iter = coalesced_sends.find(subgroup_num);
+    if(batch_iter == coalesced_sends.end() || batch_iter->second.num_messages == 0) {
+        return true;
+    }
+    CoalescedSends& batch = batch_iter->second;
+    if(thread_shutdown || smc_send_in_progress[subgroup_num] || next_sends[subgroup_num]) {
+        return false;
+    }
+    const uint32_t num_messages = batch.num_messages;
+    if(!sst_window_has_room(subgroup_num)) {
+        return false;
+    }
+    // The batch takes one message index per message, but only one SST slot and multicast index
+    uint8_t* slot = (uint8_t*)sst_multicast_group_ptrs[subgroup_num]->get_buffer(batch.used);
+    if(!slot) {
+        return false;
+    }
+    memcpy(slot, batch.buffer.get(), batch.used);
+    uint8_t* record = slot;
+    for(uint32_t i = 0; i < num_messages; ++i) {
+        header* h = (header*)record;
+        h->index = future_message_indices[subgroup_num] + i;
+        pending_message_timestamps[subgroup_num].insert(h->timestamp);
+        record += h->record_size;
+    }
+    if(num_messages > 1) {
+        // A batch of one is sent as an ordinary message; a larger batch only
+        // pushes the part of the slot it fills, since receivers use the size
+        // in each record's header instead of the slot's size field
+        ((header*)slot)->num_batched = num_messages;
+        coalesced_slot_runs[subgroup_num].push_back({static_cast<int32_t>(committed_sst_index[subgroup_num] + 1),
+                                                     1, batch.used});
+    }
+    dbg_default_trace("Subgroup {}: flushing {} coalesced messages ({} bytes) at index {}",
+                      subgroup_num, num_messages, batch.used, future_message_indices[subgroup_num]);
+    record_sst_slot(subgroup_num, future_message_indices[subgroup_num] + num_messages - 1);
+    future_message_indices[subgroup_num] += num_messages;
+    committed_sst_index[subgroup_num]++;
+    last_transfer_medium[subgroup_num] = false;
+    batch.used = 0;
+    batch.num_messages = 0;
+    return true;
+}
+
+void MulticastGroup::record_send_latency(subgroup_id_t subgroup_num, uint64_t send_timestamp) {
+    auto control = send_admission_controls.find(subgroup_num);
+    if(control != send_admission_controls.end()) {
+        uint64_t now = get_walltime();
+        control->second->record_sojourn(now > send_timestamp ? now - send_timestamp : 0);
+    }
+}
+
+bool MulticastGroup::wait_for_send_admission(subgroup_id_t subgroup_num) {
+    auto control = send_admission_controls.find(subgroup_num);
+    if(control == send_admission_controls.end()) {
+        return true;
+    }
+    while(control->second->try_admit() != send_admission::ADMITTED) {
+        if(thread_shutdown) {
+            return false;
+        }
+        // Sleep in short slices so a wedge is noticed promptly
+        uint64_t wait_ns = std::min<uint64_t>(control->second->time_until_admit(), 1000000);
+        std::this_thread::sleep_for(std::chrono::nanoseconds(std::max<uint64_t>(wait_ns, 1000)));
+    }
+    return true;
+}
+
+void MulticastGroup::commit_send(subgroup_id_t subgroup_num) {
+    if(last_send_coalesced[subgroup_num]) {
+        last_send_coalesced[subgroup_num] = false;
+        CoalescedSends& batch = coalesced_sends.at(subgroup_num);
+        if(batch.num_messages == 0) {
+            batch.first_message_time = get_time();
+        }
+        batch.used += ((header*)(batch.buffer.get() + batch.used))->record_size;
+        batch.num_messages++;
+        // If there is no room in the window yet, sst_send_trigger will flush it later
+        if(batch.used >= batch.flush_threshold) {
+            flush_coalesced_sends(subgroup_num);
+        }
+    } else if(last_transfer_medium[subgroup_num]) {
+        assert(next_sends[subgroup_num]);
+        pending_sends[subgroup_num].push(std::move(*next_sends[subgroup_num]));
+        next_sends[subgroup_num] = std::nullopt;
+        sender_cv.notify_all();
+    } else {
+        committed_sst_index[subgroup_num]++;
+        smc_send_in_progress[subgroup_num] = false;
+    }
+}
+
 bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
                           const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send) {
     if(!rdmc_sst_groups_created) {
         return false;
     }
+    if(!wait_for_send_admission(subgroup_num)) {
+        return false;
+    }
     std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
     uint8_t* buf = get_sendbuffer_ptr(subgroup_num, payload_size, cooked_send);
     while(!buf) {
@@ -1464,6 +2477,11 @@ bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int pay
         // That will cause a bug. We want to unlock only when we are sure that buf is nullptr.
         lock.unlock();
         if(thread_shutdown) {
+            // The send will be retried in the next view, and admitted again there
+            auto control = send_admission_controls.find(subgroup_num);
+            if(control != send_admission_controls.end()) {
+                control->second->cancel_admit();
+            }
             return false;
         }
         lock.lock();
@@ -1472,17 +2490,33 @@ bool MulticastGroup::send(subgroup_id_t subgroup_num, long long unsigned int pay
     // call to the user supplied message generator
     msg_generator(buf);
 
-    if(last_transfer_medium[subgroup_num]) {
-        assert(next_sends[subgroup_num]);
-        pending_sends[subgroup_num].push(std::move(*next_sends[subgroup_num]));
-        next_sends[subgroup_num] = std::nullopt;
-        sender_cv.notify_all();
-        return true;
-    } else {
-        committed_sst_index[subgroup_num]++;
-        smc_send_in_progress[subgroup_num] = false;
-        return true;
+    commit_send(subgroup_num);
+    return true;
+}
+
+send_admission MulticastGroup::try_send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                                        const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send) {
+    if(!rdmc_sst_groups_created || thread_shutdown) {
+        return send_admission::WOULD_BLOCK;
+    }
+    auto control = send_admission_controls.find(subgroup_num);
+    if(control != send_admission_controls.end()) {
+        send_admission admission = control->second->try_admit();
+        if(admission != send_admission::ADMITTED) {
+            return admission;
+        }
+    }
+    std::unique_lock<std::recursive_mutex> lock(msg_state_mtx);
+    uint8_t* buf = get_sendbuffer_ptr(subgroup_num, payload_size, cooked_send);
+    if(!buf) {
+        if(control != send_admission_controls.end()) {
+            control->second->cancel_admit();
+        }
+        return send_admission::WOULD_BLOCK;
     }
+    msg_generator(buf);
+    commit_send(subgroup_num);
+    return send_admission::ADMITTED;
 }
 
 std::vector<uint32_t> MulticastGroup::get_shard_sst_indices(subgroup_id_t subgroup_num) const {
@@ -28,8 +28,11 @@ std::ostream& operator<<(std::ostream& os, MESSAGE_TYPE mt) {
 
 P2PConnection::P2PConnection(uint32_t my_node_id, uint32_t remote_id, uint64_t p2p_buf_size, const ConnectionParams& connection_params)
         : my_node_id(my_node_id), remote_id(remote_id), connection_params(connection_params), rpc_logger(spdlog::get(LoggerFactory::RPC_LOGGER_NAME)) {
-    incoming_p2p_buffer = std::make_unique<volatile uint8_t[]>(p2p_buf_size);
-    outgoing_p2p_buffer = std::make_unique<volatile uint8_t[]>(p2p_buf_size);
+    incoming_p2p_buffer = derecho::make_volatile_registered_buffer(p2p_buf_size);
+    outgoing_p2p_buffer = derecho::make_volatile_registered_buffer(p2p_buf_size);
+    // Slots are recognized by their sequence numbers, so both buffers must start out zeroed
+    memset(const_cast<uint8_t*>(incoming_p2p_buffer.get()), 0, p2p_buf_size);
+    memset(const_cast<uint8_t*>(outgoing_p2p_buffer.get()), 0, p2p_buf_size);
 
     for(auto type : p2p_message_types) {
         incoming_seq_nums_map.try_emplace(type, 0);
@@ -38,11 +41,11 @@ P2PConnection::P2PConnection(uint32_t my_node_id, uint32_t remote_id, uint64_t p
 
     if(my_node_id != remote_id) {
 #ifdef USE_VERBS_API
-        res = std::make_unique<resources>(remote_id, const_cast<uint8_t*>(incoming_p2p_buffer.get()),
+        res = std::make_unique<resources>(my_node_id, remote_id, const_cast<uint8_t*>(incoming_p2p_buffer.get()),
                                           const_cast<uint8_t*>(outgoing_p2p_buffer.get()),
                                           p2p_buf_size, p2p_buf_size);
 #else
-        res = std::make_unique<resources>(remote_id, const_cast<uint8_t*>(incoming_p2p_buffer.get()),
+        res = std::make_unique<resources>(my_node_id, remote_id, const_cast<uint8_t*>(incoming_p2p_buffer.get()),
                                           const_cast<uint8_t*>(outgoing_p2p_buffer.get()),
                                           p2p_buf_size, p2p_buf_size, my_node_id > remote_id);
 #endif
@@ -4,6 +4,7 @@
 #include "derecho/conf/conf.hpp"
 #include "derecho/sst/detail/poll_utils.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <cassert>
 #include <cstring>
@@ -117,8 +118,9 @@ std::optional<MessagePointer> P2PConnectionManager::probe_all() {
         // In include/derecho/core/detail/rpc_utils.hpp:
         // Please note that populate_header() put payload_size(size_t) at the beginning of buffer.
         // If we only test buf[0], it will fall in the wrong path if the least significant byte of the payload size is
-        // zero.
-        if(buf_type_pair && reinterpret_cast<size_t*>(buf_type_pair->first)[0] != 0) {
+        // zero. Only replies can be null; requests start with a p2p_request_header, whose first field may be 0.
+        if(buf_type_pair && (buf_type_pair->second != MESSAGE_TYPE::P2P_REPLY
+                             || reinterpret_cast<size_t*>(buf_type_pair->first)[0] != 0)) {
             return MessagePointer{node_id, buf_type_pair->first, buf_type_pair->second};
         } else if(buf_type_pair) {
             // this means that we have a null reply
@@ -151,6 +153,7 @@ void P2PConnectionManager::send(node_id_t node_id, MESSAGE_TYPE type, uint64_t s
 
 void P2PConnectionManager::check_failures_loop() {
     pthread_setname_np(pthread_self(), "p2p_timeout");
+    derecho::pin_thread("p2p_timeout");
 
     // using Conf::DERECHO_HEARTBEAT_MS from derecho.cfg
     uint32_t heartbeat_ms = derecho::getConfUInt32(derecho::Conf::DERECHO_HEARTBEAT_MS);
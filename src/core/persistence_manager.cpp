@@ -6,6 +6,7 @@
 #include "derecho/core/detail/view_manager.hpp"
 #include "derecho/openssl/signature.hpp"
 #include "derecho/persistent/detail/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <map>
 #include <string>
@@ -56,6 +57,7 @@ void PersistenceManager::start() {
     //Start the thread
     this->persist_thread = std::thread{[this]() {
         pthread_setname_np(pthread_self(), "persist");
+        pin_thread("persist");
         dbg_debug(persistence_logger, "PersistenceManager thread started");
         do {
             // wait for semaphore
@@ -42,21 +42,9 @@ void RestartState::load_ragged_trim(const View& curr_view) {
                     }
                     int32_t last_vid, last_seq_num;
                     std::tie(last_vid, last_seq_num) = persistent::unpack_version<int32_t>(last_persisted_version);
-                    //Divide the sequence number into sender rank and message counter
                     uint32_t num_shard_senders = curr_view.subgroup_shard_views.at(subgroup_id).at(shard_num).num_senders();
-                    int32_t last_message_counter = last_seq_num / num_shard_senders;
-                    uint32_t last_sender = last_seq_num % num_shard_senders;
-                    /* Fill max_received_by_sender: In round-robin order, all senders ranked below
-                     * the last sender delivered last_message_counter, while all senders ranked above
-                     * the last sender have only delivered last_message_counter-1. */
-                    std::vector<int32_t> max_received_by_sender(num_shard_senders);
-                    for(uint sender_rank = 0; sender_rank <= last_sender; ++sender_rank) {
-                        max_received_by_sender[sender_rank] = last_message_counter;
-                    }
-                    for(uint sender_rank = last_sender + 1; sender_rank < num_shard_senders; ++sender_rank) {
-                        max_received_by_sender[sender_rank] = last_message_counter - 1;
-                    }
-                    ragged_trim = std::make_unique<RaggedTrim>(subgroup_id, shard_num, last_vid, -1, max_received_by_sender);
+                    ragged_trim = std::make_unique<RaggedTrim>(subgroup_id, shard_num, last_vid, -1,
+                                                               seq_num_to_ragged_trim(last_seq_num, num_shard_senders));
                 }
                 //operator[] is intentional: default-construct an inner std::map at subgroup_id
                 //Note that the inner map will only one entry, except on the restart leader where it will have one for every shard
@@ -66,6 +54,26 @@ void RestartState::load_ragged_trim(const View& curr_view) {
     }
 }
 
+std::vector<int32_t> RestartState::seq_num_to_ragged_trim(const int32_t seq_num, const uint32_t num_shard_senders) {
+    std::vector<int32_t> max_received_by_sender(num_shard_senders, -1);
+    if(seq_num < 0) {
+        return max_received_by_sender;
+    }
+    //Divide the sequence number into sender rank and message counter
+    int32_t last_message_counter = seq_num / num_shard_senders;
+    uint32_t last_sender = seq_num % num_shard_senders;
+    /* Fill max_received_by_sender: In round-robin order, all senders ranked below
+     * the last sender delivered last_message_counter, while all senders ranked above
+     * the last sender have only delivered last_message_counter-1. */
+    for(uint sender_rank = 0; sender_rank <= last_sender; ++sender_rank) {
+        max_received_by_sender[sender_rank] = last_message_counter;
+    }
+    for(uint sender_rank = last_sender + 1; sender_rank < num_shard_senders; ++sender_rank) {
+        max_received_by_sender[sender_rank] = last_message_counter - 1;
+    }
+    return max_received_by_sender;
+}
+
 persistent::version_t RestartState::ragged_trim_to_latest_version(const int32_t view_id,
                                                                   const std::vector<int32_t>& max_received_by_sender) {
     uint32_t num_shard_senders = max_received_by_sender.size();
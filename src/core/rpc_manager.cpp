@@ -6,10 +6,15 @@
 
 #include "derecho/core/detail/rpc_manager.hpp"
 #include "derecho/core/detail/view_manager.hpp"
+#include "derecho/utils/placement.hpp"
+#include "derecho/utils/time.h"
 
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <exception>
 #include <functional>
+#include <iterator>
 #include <iostream>
 #include <memory>
 #include <mutex>
@@ -21,6 +26,12 @@ namespace rpc {
 
 thread_local bool _in_rpc_handler = false;
 
+thread_local bool _reply_value_omitted = false;
+
+thread_local persistent::version_t _parallel_apply_version = persistent::INVALID_VERSION;
+
+thread_local uint64_t _parallel_apply_timestamp = 0;
+
 thread_local node_id_t RPCManager::rpc_caller_id;
 
 RPCManager::RPCManager(ViewManager& group_view_manager,
@@ -34,6 +45,10 @@ RPCManager::RPCManager(ViewManager& group_view_manager,
     for(const auto& deserialization_context_ptr : deserialization_context) {
         rdv.push_back(deserialization_context_ptr);
     }
+    const std::string trace_path = getConfString(Conf::DERECHO_RPC_TRACE_PATH);
+    if(!trace_path.empty()) {
+        trace_recorder = std::make_unique<RPCTraceRecorder>(trace_path, rpc_logger);
+    }
     rpc_listener_thread = std::thread(&RPCManager::p2p_receive_loop, this);
 }
 
@@ -42,6 +57,14 @@ RPCManager::~RPCManager() {
     if(rpc_listener_thread.joinable()) {
         rpc_listener_thread.join();
     }
+    {
+        std::lock_guard<std::mutex> lock(apply_mutex);
+        apply_shutdown = true;
+    }
+    apply_cv.notify_all();
+    for(auto& worker : apply_workers) {
+        worker.join();
+    }
 }
 
 void RPCManager::report_failure(const node_id_t who) {
@@ -50,7 +73,7 @@ void RPCManager::report_failure(const node_id_t who) {
         // external client
         dbg_debug(rpc_logger, "External client with id {} failed, doing cleanup", who);
         connections->remove_connections({who});
-        sst::remove_node(who);
+        sst::remove_node(nid, who);
     } else {
         // internal member
         view_manager.report_failure(who);
@@ -63,7 +86,8 @@ void RPCManager::create_connections() {
             getConfUInt32(Conf::DERECHO_P2P_WINDOW_SIZE),
             view_manager.view_max_rpc_window_size,
             getConfUInt64(Conf::DERECHO_MAX_P2P_REPLY_PAYLOAD_SIZE) + sizeof(header),
-            getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header),
+            getConfUInt64(Conf::DERECHO_MAX_P2P_REQUEST_PAYLOAD_SIZE) + sizeof(header)
+                    + sizeof(remote_invocation_utilities::p2p_request_header),
             view_manager.view_max_rpc_reply_payload_size + sizeof(header),
             false,
             [this](const uint32_t node_id) { report_failure(node_id); }});
@@ -89,7 +113,7 @@ void RPCManager::destroy_remote_invocable_class(uint32_t instance_id) {
         if(pending_results) {
             pending_results->set_exception_for_caller_removed();
         }
-        pending_results_to_fulfill[instance_id].pop();
+        pending_results_to_fulfill[instance_id].pop_front();
     }
     for(auto& pending_results_pair : results_awaiting_local_persistence[instance_id]) {
         std::shared_ptr<AbstractPendingResults> pending_results = pending_results_pair.second.lock();
@@ -98,6 +122,141 @@ void RPCManager::destroy_remote_invocable_class(uint32_t instance_id) {
         }
     }
     results_awaiting_local_persistence[instance_id].clear();
+    results_awaiting_quorum_persistence.erase(instance_id);
+    // The queued tasks point into the subgroup's batch, so let them finish before dropping it
+    wait_for_parallel_apply();
+    std::lock_guard<std::mutex> parallel_apply_lock(parallel_apply_mutex);
+    parallel_apply_subgroups.erase(instance_id);
+}
+
+void RPCManager::register_parallel_apply(subgroup_id_t subgroup_id, const conflict_key_func_t& conflict_key,
+                                         const make_version_func_t& make_version) {
+    std::lock_guard<std::mutex> lock(parallel_apply_mutex);
+    // A subgroup is registered again when its Replicated object moves; keep the calls it has pending
+    std::shared_ptr<parallel_apply_state>& state = parallel_apply_subgroups[subgroup_id];
+    if(!state) {
+        state = std::make_shared<parallel_apply_state>();
+    }
+    state->conflict_key = conflict_key;
+    state->make_version = make_version;
+    // The worker pool is shared by all subgroups, and only started once a subgroup needs it
+    if(apply_workers.empty()) {
+        const uint32_t num_workers = std::max(1u, getConfUInt32(Conf::DERECHO_PARALLEL_APPLY_THREADS));
+        apply_queues.resize(num_workers);
+        for(uint32_t worker_index = 0; worker_index < num_workers; ++worker_index) {
+            apply_workers.emplace_back(&RPCManager::parallel_apply_worker, this, worker_index);
+        }
+    }
+}
+
+void RPCManager::defer_make_version(subgroup_id_t subgroup_id, persistent::version_t version, const HLC& hlc) {
+    std::shared_ptr<parallel_apply_state> state = get_parallel_apply_state(subgroup_id);
+    // The subgroup's Replicated object may already be gone, in which case there is nothing to version
+    if(state) {
+        state->deferred_versions.emplace_back(version, hlc);
+    }
+}
+
+std::shared_ptr<RPCManager::parallel_apply_state> RPCManager::get_parallel_apply_state(subgroup_id_t subgroup_id) {
+    std::lock_guard<std::mutex> lock(parallel_apply_mutex);
+    auto state = parallel_apply_subgroups.find(subgroup_id);
+    return state == parallel_apply_subgroups.end() ? nullptr : state->second;
+}
+
+void RPCManager::parallel_apply_worker(uint32_t worker_index) {
+    pthread_setname_np(pthread_self(), "rpc_apply");
+    pin_thread("rpc_apply");
+    std::unique_lock<std::mutex> lock(apply_mutex);
+    while(true) {
+        apply_cv.wait(lock, [&]() { return apply_shutdown || !apply_queues[worker_index].empty(); });
+        if(apply_shutdown) {
+            return;
+        }
+        apply_task& task = *apply_queues[worker_index].front();
+        apply_queues[worker_index].pop_front();
+        lock.unlock();
+        apply(task);
+        lock.lock();
+        if(--apply_tasks_outstanding == 0) {
+            apply_cv.notify_all();
+        }
+    }
+}
+
+void RPCManager::apply(apply_task& task) {
+    _in_rpc_handler = true;
+    _reply_value_omitted = task.reply_value_omitted;
+    _parallel_apply_version = task.version;
+    _parallel_apply_timestamp = task.timestamp;
+    try {
+        parse_and_receive(task.msg.data(), task.msg.size(),
+                          [&task](size_t size) -> uint8_t* {
+                              task.reply.resize(size);
+                              return task.reply.data();
+                          });
+    } catch(...) {
+        // A worker thread can't propagate the exception, and must still count the task as done
+        task.exception = std::current_exception();
+    }
+    _in_rpc_handler = false;
+    _reply_value_omitted = false;
+    _parallel_apply_version = persistent::INVALID_VERSION;
+    _parallel_apply_timestamp = 0;
+}
+
+void RPCManager::wait_for_parallel_apply() {
+    std::unique_lock<std::mutex> lock(apply_mutex);
+    apply_cv.wait(lock, [&]() { return apply_tasks_outstanding == 0; });
+}
+
+void RPCManager::end_delivery_batch(subgroup_id_t subgroup_id) {
+    std::shared_ptr<parallel_apply_state> state = get_parallel_apply_state(subgroup_id);
+    if(!state) {
+        return;
+    }
+    wait_for_parallel_apply();
+    const bool discard_replies = is_warm_standby(subgroup_id);
+    // Send the replies in delivery order, as they would have been without parallel apply
+    for(apply_task& task : state->batch) {
+        if(task.exception) {
+            // Fail as applying the call on the delivery thread would have
+            std::exception_ptr exception = task.exception;
+            state->batch.clear();
+            state->deferred_versions.clear();
+            std::rethrow_exception(exception);
+        }
+        if(task.reply.empty() || discard_replies) {
+            continue;
+        }
+        if(task.reply.size() > connections->get_max_rpc_reply_size()) {
+            throw buffer_overflow_exception("Size of a P2P reply exceeds the maximum P2P reply message size");
+        }
+        if(task.sender_id == nid) {
+            parse_and_receive(task.reply.data(), task.reply.size(),
+                              [](size_t) -> uint8_t* {
+                                  assert_always(false);
+                                  return nullptr;
+                              });
+        } else {
+            std::optional<sst::P2PBufferHandle> reply_buffer = connections->get_sendbuffer_ptr(
+                    task.sender_id, sst::MESSAGE_TYPE::RPC_REPLY);
+            if(!reply_buffer) {
+                throw derecho_exception("Failed to allocate a buffer for a P2P reply because the send window was full!");
+            }
+            memcpy(reply_buffer->buf_ptr, task.reply.data(), task.reply.size());
+            connections->send(task.sender_id, sst::MESSAGE_TYPE::RPC_REPLY, reply_buffer->seq_num);
+        }
+    }
+    state->batch.clear();
+    // Only now that every call in the batch has been applied can their versions be created
+    for(const auto& [version, hlc] : state->deferred_versions) {
+        _parallel_apply_version = version;
+        _parallel_apply_timestamp = hlc.m_rtc_us;
+        state->make_version(version, hlc);
+    }
+    _parallel_apply_version = persistent::INVALID_VERSION;
+    _parallel_apply_timestamp = 0;
+    state->deferred_versions.clear();
 }
 
 void RPCManager::start_listening() {
@@ -149,21 +308,140 @@ std::exception_ptr RPCManager::parse_and_receive(uint8_t* buf, std::size_t size,
                            payload_size, out_alloc);
 }
 
+bool RPCManager::reply_value_omitted(subgroup_id_t subgroup_id, const uint8_t* msg_buf) {
+    // Under any reply policy but ALL, only some members of the shard send their return value
+    using namespace remote_invocation_utilities;
+    std::size_t payload_size;
+    Opcode indx;
+    node_id_t received_from;
+    uint32_t flags;
+    retrieve_header(nullptr, msg_buf, payload_size, indx, received_from, flags);
+    const ReplyPolicy reply_policy = get_reply_policy(flags);
+    if(reply_policy.kind == ReplyPolicy::Kind::ALL) {
+        return false;
+    }
+    const View& curr_view = view_manager.unsafe_get_current_view();
+    const SubView& shard_view = curr_view.subgroup_shard_views.at(subgroup_id).at(curr_view.my_subgroups.at(subgroup_id));
+    // The caller ranks the members that reply, which leaves out warm standbys
+    const std::vector<node_id_t> replying_members = shard_view.non_standby_members();
+    // Skip members already suspected of failing, the same way the caller will once they are removed
+    std::vector<char> failed(replying_members.size());
+    for(std::size_t rank = 0; rank < replying_members.size(); ++rank) {
+        failed[rank] = curr_view.failed[curr_view.rank_of(replying_members[rank])];
+    }
+    const std::vector<uint32_t> senders = reply_policy.value_senders(failed);
+    const uint32_t my_reply_rank = std::distance(replying_members.begin(),
+                                                 std::find(replying_members.begin(), replying_members.end(), nid));
+    return std::find(senders.begin(), senders.end(), my_reply_rank) == senders.end();
+}
+
+bool RPCManager::is_warm_standby(subgroup_id_t subgroup_id) {
+    const View& curr_view = view_manager.unsafe_get_current_view();
+    const SubView& shard_view = curr_view.subgroup_shard_views.at(subgroup_id).at(curr_view.my_subgroups.at(subgroup_id));
+    return shard_view.is_standby_rank(shard_view.my_rank);
+}
+
+void RPCManager::fulfill_self_receive(subgroup_id_t subgroup_id, persistent::version_t version, uint64_t timestamp) {
+    //This is a self-receive of an RPC message I sent, so I have a reply-map that needs fulfilling
+    const uint32_t my_shard = view_manager.unsafe_get_current_view().my_subgroups.at(subgroup_id);
+    whenlog(int32_t msg_seq_num = persistent::unpack_version<int32_t>(version).second);
+    dbg_trace(rpc_logger, "RPCManager got a self-receive for message {}", msg_seq_num);
+    std::unique_lock<std::mutex> lock(pending_results_mutex);
+    // because of a race condition, pending_results_to_fulfill can genuinely be empty
+    // so before accessing it we should sleep on a condition variable and let the main
+    // thread that called the orderedSend signal us
+    // although the race condition is infinitely rare
+    pending_results_cv.wait(lock, [&]() { return !pending_results_to_fulfill[subgroup_id].empty(); });
+    std::shared_ptr<AbstractPendingResults> pending_results = pending_results_to_fulfill[subgroup_id].front().lock();
+    if(pending_results) {
+        //We now know the membership of "all nodes in my shard of the subgroup" in the current view;
+        //warm standbys apply the call too, but don't reply
+        pending_results->fulfill_map(
+                view_manager.unsafe_get_current_view().subgroup_shard_views.at(subgroup_id).at(my_shard).non_standby_members());
+        pending_results->set_persistent_version(version, timestamp);
+        //Move the fulfilled PendingResults to either the "completed" list or the "awaiting persistence" list
+        //(but move the weak_ptr, not the shared_ptr)
+        if(view_manager.subgroup_is_persistent(subgroup_id)) {
+            results_awaiting_local_persistence[subgroup_id].emplace(version,
+                                                                    pending_results_to_fulfill[subgroup_id].front());
+            auto frontier = quorum_persistence_frontier.find(subgroup_id);
+            if(frontier != quorum_persistence_frontier.end() && version <= frontier->second) {
+                pending_results->set_quorum_persistence();
+            } else {
+                results_awaiting_quorum_persistence[subgroup_id].emplace(version,
+                                                                         pending_results_to_fulfill[subgroup_id].front());
+            }
+        } else {
+            completed_pending_results[subgroup_id].emplace_back(pending_results_to_fulfill[subgroup_id].front());
+        }
+    } else {
+        dbg_debug(rpc_logger, "Did not fulfill the PendingResults for message {} because it was already gone", msg_seq_num);
+    }
+    //Regardless of whether the weak_ptr was valid, delete the entry because we're done with it
+    pending_results_to_fulfill[subgroup_id].pop_front();
+}
+
 void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender_id,
                                      persistent::version_t version, uint64_t timestamp,
                                      uint8_t* msg_buf, uint32_t buffer_size) {
     // WARNING: This assumes the current view doesn't change during execution!
     // (It accesses curr_view without a lock).
 
+    if(trace_recorder) {
+        trace_recorder->record(subgroup_id, sender_id, version, timestamp, msg_buf, buffer_size);
+    }
+
+    std::shared_ptr<parallel_apply_state> parallel_state = get_parallel_apply_state(subgroup_id);
+    if(parallel_state) {
+        if(sender_id == nid) {
+            fulfill_self_receive(subgroup_id, version, timestamp);
+        }
+        parallel_state->batch.push_back(apply_task{sender_id, version, timestamp,
+                                                   reply_value_omitted(subgroup_id, msg_buf),
+                                                   std::vector<uint8_t>(msg_buf, msg_buf + buffer_size), {}, {}});
+        apply_task& task = parallel_state->batch.back();
+        using namespace remote_invocation_utilities;
+        std::size_t payload_size;
+        Opcode indx;
+        node_id_t received_from;
+        uint32_t flags;
+        retrieve_header(nullptr, msg_buf, payload_size, indx, received_from, flags);
+        // The arguments follow the invocation ID
+        const uint8_t* args = msg_buf + header_space() + sizeof(void*);
+        std::optional<uint64_t> key = parallel_state->conflict_key(
+                indx.function_id, args, payload_size - sizeof(void*));
+        if(!key) {
+            // A call that conflicts with everything runs alone, after all the calls before it
+            wait_for_parallel_apply();
+            apply(task);
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(apply_mutex);
+            apply_queues[*key % apply_queues.size()].push_back(&task);
+            apply_tasks_outstanding++;
+        }
+        apply_cv.notify_all();
+        return;
+    }
+
     // set the thread local rpc_handler context
     _in_rpc_handler = true;
+    _reply_value_omitted = reply_value_omitted(subgroup_id, msg_buf);
+    // A warm standby applies the call, but nobody waits for its reply
+    const bool discard_reply = is_warm_standby(subgroup_id);
+    std::vector<uint8_t> discarded_reply;
 
     // Use the reply-buffer allocation lambda to detect whether parse_and_receive generated a reply
     size_t reply_size = 0;
     std::optional<sst::P2PBufferHandle> reply_buffer;
     parse_and_receive(msg_buf, buffer_size,
-                      [this, &reply_buffer, &reply_size, &sender_id](size_t size) -> uint8_t* {
+                      [this, &reply_buffer, &reply_size, &sender_id, discard_reply, &discarded_reply](size_t size) -> uint8_t* {
                           reply_size = size;
+                          if(discard_reply) {
+                              discarded_reply.resize(size);
+                              return discarded_reply.data();
+                          }
                           if(reply_size <= connections->get_max_rpc_reply_size()) {
                               reply_buffer = connections->get_sendbuffer_ptr(
                                       sender_id, sst::MESSAGE_TYPE::RPC_REPLY);
@@ -176,37 +454,7 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
                           }
                       });
     if(sender_id == nid) {
-        //This is a self-receive of an RPC message I sent, so I have a reply-map that needs fulfilling
-        const uint32_t my_shard = view_manager.unsafe_get_current_view().my_subgroups.at(subgroup_id);
-        {
-            whenlog(int32_t msg_seq_num = persistent::unpack_version<int32_t>(version).second);
-            dbg_trace(rpc_logger, "RPCManager got a self-receive for message {}", msg_seq_num);
-            std::unique_lock<std::mutex> lock(pending_results_mutex);
-            // because of a race condition, pending_results_to_fulfill can genuinely be empty
-            // so before accessing it we should sleep on a condition variable and let the main
-            // thread that called the orderedSend signal us
-            // although the race condition is infinitely rare
-            pending_results_cv.wait(lock, [&]() { return !pending_results_to_fulfill[subgroup_id].empty(); });
-            std::shared_ptr<AbstractPendingResults> pending_results = pending_results_to_fulfill[subgroup_id].front().lock();
-            if(pending_results) {
-                //We now know the membership of "all nodes in my shard of the subgroup" in the current view
-                pending_results->fulfill_map(
-                        view_manager.unsafe_get_current_view().subgroup_shard_views.at(subgroup_id).at(my_shard).members);
-                pending_results->set_persistent_version(version, timestamp);
-                //Move the fulfilled PendingResults to either the "completed" list or the "awaiting persistence" list
-                //(but move the weak_ptr, not the shared_ptr)
-                if(view_manager.subgroup_is_persistent(subgroup_id)) {
-                    results_awaiting_local_persistence[subgroup_id].emplace(version,
-                                                                            pending_results_to_fulfill[subgroup_id].front());
-                } else {
-                    completed_pending_results[subgroup_id].emplace_back(pending_results_to_fulfill[subgroup_id].front());
-                }
-            } else {
-                dbg_debug(rpc_logger, "Did not fulfill the PendingResults for message {} because it was already gone", msg_seq_num);
-            }
-            //Regardless of whether the weak_ptr was valid, delete the entry because we're done with it
-            pending_results_to_fulfill[subgroup_id].pop();
-        }  //release pending_results_mutex
+        fulfill_self_receive(subgroup_id, version, timestamp);
         if(reply_size > 0) {
             // Since this was a self-receive, the reply also goes to myself.
             // Note that we pass the outgoing buffer obtained from connections->get_sendbuffer_ptr()
@@ -215,20 +463,29 @@ void RPCManager::rpc_message_handler(subgroup_id_t subgroup_id, node_id_t sender
             // a time in the self-connection.
             parse_and_receive(
                     reply_buffer->buf_ptr, reply_size,
-                    [](size_t size) -> uint8_t* { assert_always(false); });
+                    [](size_t) -> uint8_t* {
+                        assert_always(false);
+                        return nullptr;
+                    });
         }
-    } else if(reply_size > 0) {
+    } else if(reply_size > 0 && !discard_reply) {
         // Otherwise, the only thing to do is send the reply (if there was one)
         connections->send(sender_id, sst::MESSAGE_TYPE::RPC_REPLY, reply_buffer->seq_num);
     }
 
     // clear the thread local rpc_handler context
     _in_rpc_handler = false;
+    _reply_value_omitted = false;
 }
 
-void RPCManager::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
+void RPCManager::p2p_message_handler(node_id_t sender_id, sst::MESSAGE_TYPE type, uint8_t* msg_buf) {
     using namespace remote_invocation_utilities;
     const std::size_t header_size = header_space();
+    p2p_request_header request_header{0, 0};
+    if(type == sst::MESSAGE_TYPE::P2P_REQUEST) {
+        request_header = retrieve_p2p_request_header(msg_buf);
+        msg_buf += sizeof(request_header);
+    }
     std::size_t payload_size;
     Opcode indx;
     node_id_t received_from;
@@ -242,6 +499,17 @@ void RPCManager::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
                         [](size_t _size) -> uint8_t* {
                             throw derecho::derecho_exception("A P2P reply message attempted to generate another reply");
                         });
+    } else if(RPC_HEADER_FLAG_TST(flags, CANCEL)) {
+        // Cancellations are handled here, since they only need to find the request in the queue
+        const uint64_t cancelled_request_id = reinterpret_cast<uint64_t*>(msg_buf + header_size)[0];
+        cancel_queued_request(sender_id, cancelled_request_id);
+        // Every P2P request must get a reply to free its slot in the sender's window, but waiting for
+        // a reply buffer here could deadlock two nodes that cancel requests to each other, since
+        // neither listener would be free to receive the replies that free up the other's window.
+        // The worker thread sends the null reply instead.
+        std::unique_lock<std::mutex> lock(request_queue_mutex);
+        p2p_request_queue.emplace_back(sender_id, msg_buf, 0, cancelled_request_id, true);
+        request_queue_cv.notify_one();
     } else if(RPC_HEADER_FLAG_TST(flags, CASCADE)) {
         // TODO: what is the lifetime of msg_buf? discuss with Sagar to make
         // sure the buffers are safely managed.
@@ -250,11 +518,71 @@ void RPCManager::p2p_message_handler(node_id_t sender_id, uint8_t* msg_buf) {
     } else {
         // send to fifo queue.
         std::unique_lock<std::mutex> lock(request_queue_mutex);
-        p2p_request_queue.emplace(sender_id, msg_buf);
+        p2p_request_queue.emplace_back(sender_id, msg_buf, request_header.deadline, request_header.request_id);
         request_queue_cv.notify_one();
     }
 }
 
+void RPCManager::cancel_queued_request(node_id_t sender_id, uint64_t request_id) {
+    std::lock_guard<std::mutex> lock(request_queue_mutex);
+    for(auto& request : p2p_request_queue) {
+        if(request.sender_id == sender_id && request.request_id == request_id && !request.cancellation) {
+            dbg_debug(rpc_logger, "Cancelling queued P2P request {} from node {}", request_id, sender_id);
+            request.cancelled = true;
+            return;
+        }
+    }
+    dbg_trace(rpc_logger, "P2P request {} from node {} was already handled, ignoring cancellation", request_id, sender_id);
+}
+
+std::optional<sst::P2PBufferHandle> RPCManager::get_p2p_reply_buffer(node_id_t dest_id) {
+    std::optional<sst::P2PBufferHandle> buffer_handle;
+    while(!thread_shutdown) {
+        try {
+            buffer_handle = connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REPLY);
+        } catch(std::out_of_range& map_error) {
+            dbg_debug(rpc_logger, "Not replying to node {}: it is no longer connected", dest_id);
+            return std::nullopt;
+        }
+        if(buffer_handle) {
+            return buffer_handle;
+        }
+        // The reply window frees up as the sender receives earlier replies
+        std::this_thread::yield();
+    }
+    return std::nullopt;
+}
+
+void RPCManager::send_expired_reply(const p2p_req& request) {
+    using namespace remote_invocation_utilities;
+    const std::size_t header_size = header_space();
+    auto buffer_handle = get_p2p_reply_buffer(request.sender_id);
+    if(!buffer_handle) {
+        return;
+    }
+    uint64_t invocation_id = reinterpret_cast<uint64_t*>(request.msg_buf + header_size)[0];
+    if(invocation_id == 0) {
+        // Void functions have no invocation ID and expect a null reply, as if they had been executed
+        reinterpret_cast<size_t*>(buffer_handle->buf_ptr)[0] = 0;
+    } else {
+        std::size_t payload_size;
+        Opcode indx;
+        node_id_t received_from;
+        uint32_t flags;
+        retrieve_header(nullptr, request.msg_buf, payload_size, indx, received_from, flags);
+        indx.is_reply = true;
+        uint8_t* reply = buffer_handle->buf_ptr + header_size;
+        reply[0] = static_cast<uint8_t>(reply_status::EXPIRED);
+        std::memcpy(reply + 1, &invocation_id, sizeof(invocation_id));
+        populate_header(buffer_handle->buf_ptr, sizeof(invocation_id) + 1, indx, nid, 0);
+    }
+    try {
+        connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+    } catch(std::out_of_range& map_error) {
+        dbg_debug(rpc_logger, "Not replying to node {}: it is no longer connected", request.sender_id);
+    }
+}
+
 //This is always called while holding a write lock on view_manager.view_mutex
 void RPCManager::new_view_callback(const View& new_view) {
     connections->remove_connections(new_view.departed);
@@ -397,6 +725,22 @@ void RPCManager::notify_global_persistence_finished(subgroup_id_t subgroup_id, p
     }
 }
 
+void RPCManager::notify_quorum_persistence_finished(subgroup_id_t subgroup_id, persistent::version_t version) {
+    dbg_trace(rpc_logger, "RPCManager: Got a quorum persistence callback for version {}", version);
+    std::lock_guard<std::mutex> lock(pending_results_mutex);
+    auto frontier = quorum_persistence_frontier.emplace(subgroup_id, version).first;
+    frontier->second = std::max(frontier->second, version);
+    for(auto pending_results_iter = results_awaiting_quorum_persistence[subgroup_id].begin();
+        pending_results_iter != results_awaiting_quorum_persistence[subgroup_id].upper_bound(version);) {
+        dbg_trace(rpc_logger, "RPCManager: Setting quorum persistence on version {}", pending_results_iter->first);
+        std::shared_ptr<AbstractPendingResults> live_pending_results = pending_results_iter->second.lock();
+        if(live_pending_results) {
+            live_pending_results->set_quorum_persistence();
+        }
+        pending_results_iter = results_awaiting_quorum_persistence[subgroup_id].erase(pending_results_iter);
+    }
+}
+
 void RPCManager::notify_verification_finished(subgroup_id_t subgroup_id, persistent::version_t version) {
     dbg_trace(rpc_logger, "RPCManager: Got a global verification callback for version {}", version);
     std::lock_guard<std::mutex> lock(pending_results_mutex);
@@ -419,10 +763,24 @@ void RPCManager::add_external_connection(node_id_t node_id) {
 
 void RPCManager::register_rpc_results(subgroup_id_t subgroup_id, std::weak_ptr<AbstractPendingResults> pending_results_handle) {
     std::lock_guard<std::mutex> lock(pending_results_mutex);
-    pending_results_to_fulfill[subgroup_id].push(pending_results_handle);
+    pending_results_to_fulfill[subgroup_id].push_back(pending_results_handle);
     pending_results_cv.notify_all();
 }
 
+void RPCManager::fail_unsent_rpc_calls(subgroup_id_t subgroup_id, uint32_t num_calls) {
+    dbg_debug(rpc_logger, "Failing {} RPC calls in subgroup {} that could not be sent", num_calls, subgroup_id);
+    std::lock_guard<std::mutex> lock(pending_results_mutex);
+    //The unsent calls are the newest ones, since every call sent before them has been registered
+    auto& unfulfilled = pending_results_to_fulfill[subgroup_id];
+    for(uint32_t i = 0; i < num_calls && !unfulfilled.empty(); ++i) {
+        std::shared_ptr<AbstractPendingResults> pending_results = unfulfilled.back().lock();
+        if(pending_results) {
+            pending_results->set_exception_for_caller_removed();
+        }
+        unfulfilled.pop_back();
+    }
+}
+
 sst::P2PBufferHandle RPCManager::get_sendbuffer_ptr(uint32_t dest_id, sst::MESSAGE_TYPE type) {
     std::optional<sst::P2PBufferHandle> buffer;
     int curr_vid = -1;
@@ -445,6 +803,30 @@ sst::P2PBufferHandle RPCManager::get_sendbuffer_ptr(uint32_t dest_id, sst::MESSA
     return *buffer;
 }
 
+sst::P2PBufferHandle RPCManager::get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline) {
+    sst::P2PBufferHandle buffer_handle = get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+    buffer_handle.buf_ptr = remote_invocation_utilities::populate_p2p_request_header(
+            buffer_handle.buf_ptr, deadline, buffer_handle.seq_num);
+    return buffer_handle;
+}
+
+std::optional<sst::P2PBufferHandle> RPCManager::try_get_p2p_request_buffer(node_id_t dest_id, uint64_t deadline) {
+    std::optional<sst::P2PBufferHandle> buffer_handle;
+    {
+        SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+        try {
+            buffer_handle = connections->get_sendbuffer_ptr(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST);
+        } catch(std::out_of_range& map_error) {
+            throw node_removed_from_group_exception(dest_id);
+        }
+    }
+    if(buffer_handle) {
+        buffer_handle->buf_ptr = remote_invocation_utilities::populate_p2p_request_header(
+                buffer_handle->buf_ptr, deadline, buffer_handle->seq_num);
+    }
+    return buffer_handle;
+}
+
 void RPCManager::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup_id, uint64_t sequence_num,
                                   std::weak_ptr<AbstractPendingResults> pending_results_handle) {
     try {
@@ -458,6 +840,7 @@ void RPCManager::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup
     }
     std::shared_ptr<AbstractPendingResults> pending_results = pending_results_handle.lock();
     if(pending_results) {
+        pending_results->set_p2p_request_id(sequence_num);
         pending_results->fulfill_map({dest_id});
         std::lock_guard<std::mutex> lock(pending_results_mutex);
         // These PendingResults don't need to have ReplyMaps fulfilled, and they
@@ -466,8 +849,24 @@ void RPCManager::send_p2p_message(node_id_t dest_id, subgroup_id_t dest_subgroup
     }
 }
 
+void RPCManager::send_p2p_cancel(node_id_t dest_id, uint64_t request_id) {
+    using namespace remote_invocation_utilities;
+    auto buffer_handle = get_p2p_request_buffer(dest_id);
+    uint32_t flags = 0;
+    RPC_HEADER_FLAG_SET(flags, CANCEL);
+    populate_header(buffer_handle.buf_ptr, sizeof(request_id), Opcode{}, nid, flags);
+    std::memcpy(buffer_handle.buf_ptr + header_space(), &request_id, sizeof(request_id));
+    try {
+        SharedLockedReference<View> view_and_lock = view_manager.get_current_view();
+        connections->send(dest_id, sst::MESSAGE_TYPE::P2P_REQUEST, buffer_handle.seq_num);
+    } catch(std::out_of_range& map_error) {
+        throw node_removed_from_group_exception(dest_id);
+    }
+}
+
 void RPCManager::p2p_request_worker() {
     pthread_setname_np(pthread_self(), "p2p_req_wkr");
+    pin_thread("p2p_req_wkr");
     using namespace remote_invocation_utilities;
     const std::size_t header_size = header_space();
     std::size_t payload_size;
@@ -485,9 +884,26 @@ void RPCManager::p2p_request_worker() {
                 break;
             }
             request = p2p_request_queue.front();
-            p2p_request_queue.pop();
+            p2p_request_queue.pop_front();
+        }
+        if(request.cancellation) {
+            auto buffer_handle = get_p2p_reply_buffer(request.sender_id);
+            if(buffer_handle) {
+                dbg_trace(rpc_logger, "Sending a null reply to node {} for its cancellation of request {}",
+                          request.sender_id, request.request_id);
+                reinterpret_cast<size_t*>(buffer_handle->buf_ptr)[0] = 0;
+                connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, buffer_handle->seq_num);
+            }
+            continue;
         }
         retrieve_header(nullptr, request.msg_buf, payload_size, indx, received_from, flags);
+        // Don't spend time on requests that nobody is waiting for anymore
+        if(request.cancelled || (request.deadline != 0 && get_walltime() > request.deadline)) {
+            dbg_debug(rpc_logger, "Dropping P2P request from node {} for function {}: {}", request.sender_id,
+                      indx.function_id, request.cancelled ? "cancelled" : "deadline expired");
+            send_expired_reply(request);
+            continue;
+        }
         if(indx.is_reply || RPC_HEADER_FLAG_TST(flags, CASCADE)) {
             dbg_error(rpc_logger, "Invalid rpc message in fifo queue: is_reply={}, is_cascading={}",
                       indx.is_reply, RPC_HEADER_FLAG_TST(flags, CASCADE));
@@ -516,7 +932,7 @@ void RPCManager::p2p_request_worker() {
             connections->send(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY, reply_seq_num);
         } else {
             // hack for now to "simulate" a reply for p2p_sends to functions that do not generate a reply
-            auto buffer_handle = connections->get_sendbuffer_ptr(request.sender_id, sst::MESSAGE_TYPE::P2P_REPLY);
+            auto buffer_handle = get_p2p_reply_buffer(request.sender_id);
             if(buffer_handle) {
                 dbg_trace(rpc_logger, "Sending a null reply to node {} for a void P2P call", request.sender_id);
                 reinterpret_cast<size_t*>(buffer_handle->buf_ptr)[0] = 0;
@@ -528,6 +944,7 @@ void RPCManager::p2p_request_worker() {
 
 void RPCManager::p2p_receive_loop() {
     pthread_setname_np(pthread_self(), "rpc_lsnr");
+    pin_thread("rpc_lsnr");
 
     // set the thread local rpc_handler context
     _in_rpc_handler = true;
@@ -558,7 +975,7 @@ void RPCManager::p2p_receive_loop() {
                 // Invalid ID means the message was empty (a null reply)
                 if(message_handle.sender_id != INVALID_NODE_ID) {
                     dbg_trace(rpc_logger, "P2P thread detected a message from {}", message_handle.sender_id);
-                    p2p_message_handler(message_handle.sender_id, message_handle.buf);
+                    p2p_message_handler(message_handle.sender_id, message_handle.type, message_handle.buf);
                     connections->increment_incoming_seq_num(message_handle.sender_id, message_handle.type);
                 }
                 // update last time
@@ -610,5 +1027,13 @@ void RPCManager::wait_for_oob_op(const node_id_t& remote_node, uint32_t op, uint
 bool in_rpc_handler() {
     return _in_rpc_handler;
 }
+
+bool rpc_reply_value_omitted() {
+    return _reply_value_omitted;
+}
+
+std::pair<persistent::version_t, uint64_t> parallel_apply_version() {
+    return {_parallel_apply_version, _parallel_apply_timestamp};
+}
 }  // namespace rpc
 }  // namespace derecho
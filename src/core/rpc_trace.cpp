@@ -0,0 +1,242 @@
+/**
+ * @file rpc_trace.cpp
+ */
+
+#include "derecho/core/detail/rpc_trace.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace derecho {
+
+namespace rpc {
+
+// Records are padded to 8 bytes, so the messages are as aligned as they were when delivered
+static std::size_t padded_size(uint32_t size) {
+    return (static_cast<std::size_t>(size) + 7) & ~static_cast<std::size_t>(7);
+}
+
+static bool write_fully(int fd, const uint8_t* buf, std::size_t size) {
+    std::size_t written = 0;
+    while(written < size) {
+        ssize_t n = write(fd, buf + written, size - written);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+RPCTraceRecorder::RPCTraceRecorder(const std::string& path_prefix, std::shared_ptr<spdlog::logger> logger,
+                                   std::size_t max_buffered_bytes)
+        : path_prefix(path_prefix), logger(logger), max_buffered_bytes(max_buffered_bytes), shutdown(false),
+          writer_thread(&RPCTraceRecorder::writer_loop, this) {}
+
+RPCTraceRecorder::~RPCTraceRecorder() {
+    flush();
+    {
+        std::lock_guard<std::mutex> lock(trace_mutex);
+        shutdown = true;
+    }
+    writer_cv.notify_one();
+    writer_thread.join();
+    for(auto& [subgroup_id, file] : trace_files) {
+        if(file.fd != -1) {
+            close(file.fd);
+        }
+    }
+}
+
+void RPCTraceRecorder::hand_off(TraceFile& file) {
+    if(file.write_pending || file.buffer.empty()) {
+        return;
+    }
+    file.buffer.swap(file.write_buffer);
+    file.write_pending = true;
+    writer_cv.notify_one();
+}
+
+void RPCTraceRecorder::end_gap(subgroup_id_t subgroup_id, TraceFile& file) {
+    if(file.num_dropped == 0) {
+        return;
+    }
+    dbg_warn(logger, "Dropped {} records from the RPC trace of subgroup {}, starting at version {}.",
+             file.num_dropped, subgroup_id, file.first_dropped_version);
+    const RPCTraceRecord gap{file.first_dropped_version, file.first_dropped_timestamp_us, RPC_TRACE_GAP_SENDER, 0};
+    const uint8_t* gap_bytes = reinterpret_cast<const uint8_t*>(&gap);
+    file.buffer.insert(file.buffer.end(), gap_bytes, gap_bytes + sizeof(gap));
+    file.num_dropped = 0;
+}
+
+void RPCTraceRecorder::writer_loop() {
+    pthread_setname_np(pthread_self(), "rpc_trace");
+    std::unique_lock<std::mutex> lock(trace_mutex);
+    while(true) {
+        writer_cv.wait(lock, [this]() {
+            return shutdown
+                   || std::any_of(trace_files.begin(), trace_files.end(),
+                                  [](const auto& file_pair) { return file_pair.second.write_pending; });
+        });
+        bool wrote = false;
+        for(auto& [subgroup_id, file] : trace_files) {
+            if(!file.write_pending) {
+                continue;
+            }
+            // record() leaves write_buffer and fd alone while write_pending is set
+            lock.unlock();
+            const bool written = file.fd == -1
+                                 || write_fully(file.fd, file.write_buffer.data(), file.write_buffer.size());
+            const int write_errno = errno;
+            lock.lock();
+            if(!written) {
+                dbg_error(logger, "Failed to write an RPC trace file: {}. Recording stopped for subgroup {}.",
+                          strerror(write_errno), subgroup_id);
+                close(file.fd);
+                file.fd = -1;
+                file.buffer.clear();
+            }
+            file.write_buffer.clear();
+            file.write_pending = false;
+            wrote = true;
+            // Records that piled up during the write are handed off right away
+            if(file.buffer.size() >= FLUSH_THRESHOLD) {
+                hand_off(file);
+            }
+        }
+        if(wrote) {
+            written_cv.notify_all();
+        } else if(shutdown) {
+            return;
+        }
+    }
+}
+
+void RPCTraceRecorder::record(subgroup_id_t subgroup_id, node_id_t sender_id, persistent::version_t version,
+                              uint64_t timestamp_us, const uint8_t* msg_buf, uint32_t size) {
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    auto file = trace_files.find(subgroup_id);
+    if(file == trace_files.end()) {
+        const std::string trace_path = path_prefix + "." + std::to_string(subgroup_id);
+        int fd = open(trace_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IROTH);
+        if(fd == -1) {
+            dbg_error(logger, "Failed to open RPC trace file {}: {}. Subgroup {} will not be recorded.",
+                      trace_path, strerror(errno), subgroup_id);
+        }
+        file = trace_files.emplace(subgroup_id, TraceFile{fd, {}}).first;
+        const RPCTraceFileHeader header{RPC_TRACE_MAGIC, RPC_TRACE_FORMAT_VERSION, subgroup_id};
+        const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+        file->second.buffer.insert(file->second.buffer.end(), header_bytes, header_bytes + sizeof(header));
+    }
+    if(file->second.fd == -1) {
+        return;
+    }
+    std::vector<uint8_t>& buffer = file->second.buffer;
+    // Only the write in progress can hold up a buffer past FLUSH_THRESHOLD.
+    // Room for a gap record is always kept, so a run of dropped records can be marked.
+    if(!buffer.empty()
+       && buffer.size() + sizeof(RPCTraceRecord) + padded_size(size) + sizeof(RPCTraceRecord) > max_buffered_bytes) {
+        if(file->second.num_dropped++ == 0) {
+            dbg_warn(logger, "RPC trace of subgroup {} is recorded faster than it can be written. Dropping records until {} buffered bytes are written.",
+                     subgroup_id, buffer.size());
+            file->second.first_dropped_version = version;
+            file->second.first_dropped_timestamp_us = timestamp_us;
+        }
+        return;
+    }
+    end_gap(subgroup_id, file->second);
+    const RPCTraceRecord record{version, timestamp_us, sender_id, size};
+    const uint8_t* record_bytes = reinterpret_cast<const uint8_t*>(&record);
+    buffer.insert(buffer.end(), record_bytes, record_bytes + sizeof(record));
+    buffer.insert(buffer.end(), msg_buf, msg_buf + size);
+    buffer.resize(buffer.size() + padded_size(size) - size, 0);
+    if(buffer.size() >= FLUSH_THRESHOLD) {
+        hand_off(file->second);
+    }
+}
+
+void RPCTraceRecorder::flush() {
+    std::unique_lock<std::mutex> lock(trace_mutex);
+    // Each buffer is handed off as soon as the writer is done with the previous one
+    written_cv.wait(lock, [this]() {
+        bool all_written = true;
+        for(auto& [subgroup_id, file] : trace_files) {
+            if(file.fd == -1) {
+                continue;
+            }
+            end_gap(subgroup_id, file);
+            hand_off(file);
+            all_written = all_written && !file.write_pending;
+        }
+        return all_written;
+    });
+}
+
+RPCTraceReader::RPCTraceReader(const std::string& trace_file)
+        : offset(0), subgroup_id(0), gap_version(persistent::INVALID_VERSION) {
+    int fd = open(trace_file.c_str(), O_RDONLY);
+    if(fd == -1) {
+        throw derecho_exception("Failed to open RPC trace file " + trace_file + ": " + strerror(errno));
+    }
+    struct stat st;
+    if(fstat(fd, &st) != 0) {
+        close(fd);
+        throw derecho_exception("Failed to stat RPC trace file " + trace_file + ": " + strerror(errno));
+    }
+    data.resize(st.st_size);
+    std::size_t nread = 0;
+    while(nread < data.size()) {
+        ssize_t n = read(fd, data.data() + nread, data.size() - nread);
+        if(n <= 0) {
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            close(fd);
+            throw derecho_exception("Failed to read RPC trace file " + trace_file + ".");
+        }
+        nread += n;
+    }
+    close(fd);
+    RPCTraceFileHeader header;
+    if(data.size() < sizeof(header)) {
+        throw derecho_exception(trace_file + " is not an RPC trace file.");
+    }
+    memcpy(&header, data.data(), sizeof(header));
+    if(header.magic != RPC_TRACE_MAGIC || header.format_version != RPC_TRACE_FORMAT_VERSION) {
+        throw derecho_exception(trace_file + " is not an RPC trace file, or was recorded by an incompatible version.");
+    }
+    subgroup_id = header.subgroup_id;
+    rewind();
+}
+
+bool RPCTraceReader::next(RPCTraceRecord& record, const uint8_t*& msg_buf) {
+    if(offset + sizeof(record) > data.size()) {
+        return false;
+    }
+    memcpy(&record, data.data() + offset, sizeof(record));
+    if(record.sender_id == RPC_TRACE_GAP_SENDER) {
+        gap_version = record.version;
+        return false;
+    }
+    if(offset + sizeof(record) + padded_size(record.size) > data.size()) {
+        return false;
+    }
+    msg_buf = data.data() + offset + sizeof(record);
+    offset += sizeof(record) + padded_size(record.size);
+    return true;
+}
+
+void RPCTraceReader::rewind() {
+    offset = sizeof(RPCTraceFileHeader);
+    gap_version = persistent::INVALID_VERSION;
+}
+
+}  // namespace rpc
+}  // namespace derecho
@@ -0,0 +1,318 @@
+/**
+ * @file shard_router.cpp
+ */
+
+#include "derecho/core/shard_router.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <endian.h>
+#include <map>
+#include <mutex>
+
+namespace derecho {
+
+static constexpr uint64_t HASH_SEED = 0x9e3779b97f4a7c15ull;
+static constexpr uint64_t HASH_MUL1 = 0xbf58476d1ce4e5b9ull;
+static constexpr uint64_t HASH_MUL2 = 0x94d049bb133111ebull;
+/** The number of keys hash_keys() hashes in lockstep */
+static constexpr std::size_t HASH_LANES = 4;
+/** The number of keys route_batch() hashes at a time */
+static constexpr std::size_t ROUTE_BATCH_SIZE = 256;
+
+static inline uint64_t load_word(const char* bytes) {
+    uint64_t word;
+    memcpy(&word, bytes, sizeof(word));
+    return le64toh(word);
+}
+
+static inline uint64_t load_tail(const char* bytes, std::size_t size) {
+    uint64_t word = 0;
+    memcpy(&word, bytes, size);
+    return le64toh(word);
+}
+
+static inline uint64_t absorb(uint64_t hash, uint64_t word) {
+    word *= HASH_MUL1;
+    word ^= word >> 31;
+    return (hash ^ word) * HASH_MUL2;
+}
+
+// The splitmix64 finalizer, which is a bijection
+static inline uint64_t finalize(uint64_t hash) {
+    hash ^= hash >> 30;
+    hash *= HASH_MUL1;
+    hash ^= hash >> 27;
+    hash *= HASH_MUL2;
+    hash ^= hash >> 31;
+    return hash;
+}
+
+uint64_t ShardRouter::hash_key(std::string_view key) {
+    const std::size_t num_words = key.size() / sizeof(uint64_t);
+    uint64_t hash = HASH_SEED ^ key.size();
+    for(std::size_t i = 0; i < num_words; ++i) {
+        hash = absorb(hash, load_word(key.data() + i * sizeof(uint64_t)));
+    }
+    hash = absorb(hash, load_tail(key.data() + num_words * sizeof(uint64_t), key.size() % sizeof(uint64_t)));
+    return finalize(hash);
+}
+
+void ShardRouter::hash_keys(const std::string_view* keys, std::size_t num_keys, uint64_t* hashes) {
+    std::size_t first = 0;
+    for(; first + HASH_LANES <= num_keys; first += HASH_LANES) {
+        const std::string_view* lane_keys = keys + first;
+        uint64_t lane_hashes[HASH_LANES];
+        std::size_t num_words[HASH_LANES];
+        std::size_t common_words = SIZE_MAX;
+        for(std::size_t lane = 0; lane < HASH_LANES; ++lane) {
+            lane_hashes[lane] = HASH_SEED ^ lane_keys[lane].size();
+            num_words[lane] = lane_keys[lane].size() / sizeof(uint64_t);
+            common_words = std::min(common_words, num_words[lane]);
+        }
+        // The lanes are independent, so each step of this loop runs the lanes' multiplications in parallel
+        for(std::size_t i = 0; i < common_words; ++i) {
+            for(std::size_t lane = 0; lane < HASH_LANES; ++lane) {
+                lane_hashes[lane] = absorb(lane_hashes[lane], load_word(lane_keys[lane].data() + i * sizeof(uint64_t)));
+            }
+        }
+        for(std::size_t lane = 0; lane < HASH_LANES; ++lane) {
+            const char* data = lane_keys[lane].data();
+            for(std::size_t i = common_words; i < num_words[lane]; ++i) {
+                lane_hashes[lane] = absorb(lane_hashes[lane], load_word(data + i * sizeof(uint64_t)));
+            }
+            lane_hashes[lane] = absorb(lane_hashes[lane], load_tail(data + num_words[lane] * sizeof(uint64_t),
+                                                                    lane_keys[lane].size() % sizeof(uint64_t)));
+        }
+        for(std::size_t lane = 0; lane < HASH_LANES; ++lane) {
+            hashes[first + lane] = finalize(lane_hashes[lane]);
+        }
+    }
+    for(; first < num_keys; ++first) {
+        hashes[first] = hash_key(keys[first]);
+    }
+}
+
+ShardRouter::ShardRouter(uint32_t virtual_nodes) : virtual_nodes(virtual_nodes) {
+    if(virtual_nodes == 0) {
+        throw derecho_exception("ShardRouter needs at least one virtual node per shard");
+    }
+}
+
+void ShardRouter::add_shards(uint32_t first_shard, uint32_t end_shard) {
+    std::vector<std::pair<uint64_t, uint32_t>> new_points;
+    new_points.reserve(static_cast<std::size_t>(end_shard - first_shard) * virtual_nodes);
+    for(uint32_t shard_num = first_shard; shard_num < end_shard; ++shard_num) {
+        for(uint32_t i = 0; i < virtual_nodes; ++i) {
+            // Distinct (shard, virtual node) pairs get distinct points, since finalize() is a bijection
+            new_points.emplace_back(finalize(HASH_SEED ^ ((static_cast<uint64_t>(shard_num) << 32) | i)), shard_num);
+        }
+    }
+    std::sort(new_points.begin(), new_points.end());
+    // Merge the new points into the ring, rather than sorting it all again
+    std::vector<uint64_t> merged_points;
+    std::vector<uint32_t> merged_shards;
+    merged_points.reserve(ring_points.size() + new_points.size());
+    merged_shards.reserve(ring_points.size() + new_points.size());
+    std::size_t old_index = 0;
+    for(const auto& [point, shard_num] : new_points) {
+        while(old_index < ring_points.size() && ring_points[old_index] < point) {
+            merged_points.push_back(ring_points[old_index]);
+            merged_shards.push_back(ring_shards[old_index]);
+            old_index++;
+        }
+        merged_points.push_back(point);
+        merged_shards.push_back(shard_num);
+    }
+    merged_points.insert(merged_points.end(), ring_points.begin() + old_index, ring_points.end());
+    merged_shards.insert(merged_shards.end(), ring_shards.begin() + old_index, ring_shards.end());
+    ring_points.swap(merged_points);
+    ring_shards.swap(merged_shards);
+}
+
+void ShardRouter::remove_shards(uint32_t first_shard) {
+    std::size_t kept = 0;
+    for(std::size_t i = 0; i < ring_points.size(); ++i) {
+        if(ring_shards[i] < first_shard) {
+            ring_points[kept] = ring_points[i];
+            ring_shards[kept] = ring_shards[i];
+            kept++;
+        }
+    }
+    ring_points.resize(kept);
+    ring_shards.resize(kept);
+}
+
+void ShardRouter::rebuild_buckets() {
+    // About one point per bucket
+    bucket_bits = 0;
+    while(bucket_bits < 32 && (std::size_t{1} << bucket_bits) < ring_points.size()) {
+        bucket_bits++;
+    }
+    const std::size_t num_buckets = std::size_t{1} << bucket_bits;
+    bucket_starts.assign(num_buckets + 1, ring_points.size());
+    std::size_t point = 0;
+    for(std::size_t bucket = 0; bucket < num_buckets; ++bucket) {
+        const uint64_t bucket_low = bucket_bits == 0 ? 0 : static_cast<uint64_t>(bucket) << (64 - bucket_bits);
+        while(point < ring_points.size() && ring_points[point] < bucket_low) {
+            point++;
+        }
+        bucket_starts[bucket] = point;
+    }
+}
+
+void ShardRouter::rebuild_node_slots() {
+    std::map<node_id_t, uint32_t> slots_by_node;
+    node_slots.clear();
+    for(Shard& shard : shards) {
+        shard.member_slots.resize(shard.members.size());
+        for(std::size_t rank = 0; rank < shard.members.size(); ++rank) {
+            auto [slot, added] = slots_by_node.emplace(shard.members[rank], node_slots.size());
+            if(added) {
+                node_slots.push_back(shard.members[rank]);
+            }
+            shard.member_slots[rank] = slot->second;
+        }
+    }
+}
+
+bool ShardRouter::update(const std::vector<std::vector<node_id_t>>& shard_members) {
+    std::unique_lock<std::shared_mutex> lock(router_mutex);
+    const uint32_t old_num_shards = shards.size();
+    const uint32_t new_num_shards = shard_members.size();
+    bool changed = old_num_shards != new_num_shards;
+    if(new_num_shards > old_num_shards) {
+        add_shards(old_num_shards, new_num_shards);
+        rebuild_buckets();
+    } else if(new_num_shards < old_num_shards) {
+        remove_shards(new_num_shards);
+        rebuild_buckets();
+    }
+    shards.resize(new_num_shards);
+    for(uint32_t shard_num = 0; shard_num < new_num_shards; ++shard_num) {
+        Shard& shard = shards[shard_num];
+        if(shard.members == shard_members[shard_num]) {
+            continue;
+        }
+        shard.members = shard_members[shard_num];
+        shard.member_seeds.resize(shard.members.size());
+        for(std::size_t rank = 0; rank < shard.members.size(); ++rank) {
+            shard.member_seeds[rank] = finalize(HASH_SEED + shard.members[rank]);
+        }
+        changed = true;
+    }
+    if(changed) {
+        rebuild_node_slots();
+    }
+    return changed;
+}
+
+bool ShardRouter::update(const View& view, subgroup_id_t subgroup_id) {
+    if(subgroup_id >= view.subgroup_shard_views.size()) {
+        throw derecho_exception("ShardRouter: view " + std::to_string(view.vid) + " has no subgroup "
+                                + std::to_string(subgroup_id));
+    }
+    std::vector<std::vector<node_id_t>> shard_members;
+    for(const SubView& shard_view : view.subgroup_shard_views[subgroup_id]) {
+        shard_members.push_back(shard_view.non_standby_members());
+    }
+    return update(shard_members);
+}
+
+uint32_t ShardRouter::get_num_shards() const {
+    std::shared_lock<std::shared_mutex> lock(router_mutex);
+    return shards.size();
+}
+
+uint32_t ShardRouter::shard_of_hash(uint64_t hash) const {
+    if(ring_points.empty()) {
+        throw derecho_exception("ShardRouter has no shards to route to");
+    }
+    const std::size_t bucket = bucket_bits == 0 ? 0 : hash >> (64 - bucket_bits);
+    // The first point after the hash is in the hash's bucket, or is the first point of a later bucket
+    auto next_point = std::upper_bound(ring_points.begin() + bucket_starts[bucket],
+                                       ring_points.begin() + bucket_starts[bucket + 1], hash);
+    const std::size_t index = next_point - ring_points.begin();
+    return ring_shards[index == ring_points.size() ? 0 : index];
+}
+
+std::size_t ShardRouter::member_of_hash(uint32_t shard_num, uint64_t hash) const {
+    const Shard& shard = shards[shard_num];
+    if(shard.members.empty()) {
+        throw derecho_exception("ShardRouter: shard " + std::to_string(shard_num) + " has no members");
+    }
+    std::size_t best_rank = 0;
+    uint64_t best_score = finalize(hash ^ shard.member_seeds[0]);
+    for(std::size_t rank = 1; rank < shard.members.size(); ++rank) {
+        const uint64_t score = finalize(hash ^ shard.member_seeds[rank]);
+        if(score > best_score) {
+            best_score = score;
+            best_rank = rank;
+        }
+    }
+    return best_rank;
+}
+
+uint32_t ShardRouter::get_shard(std::string_view key) const {
+    const uint64_t hash = hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(router_mutex);
+    return shard_of_hash(hash);
+}
+
+ShardRouter::Route ShardRouter::route(std::string_view key) const {
+    const uint64_t hash = hash_key(key);
+    std::shared_lock<std::shared_mutex> lock(router_mutex);
+    const uint32_t shard_num = shard_of_hash(hash);
+    return Route{shard_num, shards[shard_num].members[member_of_hash(shard_num, hash)]};
+}
+
+void ShardRouter::route_batch(const std::string_view* keys, std::size_t num_keys, BatchRoutes& routes) const {
+    uint64_t hashes[ROUTE_BATCH_SIZE];
+    std::shared_lock<std::shared_mutex> lock(router_mutex);
+    const std::size_t num_slots = node_slots.size();
+    // Counting sort of the keys by node slot: count the keys of each slot in offsets[slot + 1]...
+    routes.key_slots.resize(num_keys);
+    routes.offsets.assign(num_slots + 1, 0);
+    for(std::size_t first = 0; first < num_keys; first += ROUTE_BATCH_SIZE) {
+        const std::size_t batch_size = std::min(ROUTE_BATCH_SIZE, num_keys - first);
+        hash_keys(keys + first, batch_size, hashes);
+        for(std::size_t i = 0; i < batch_size; ++i) {
+            const uint32_t shard_num = shard_of_hash(hashes[i]);
+            const uint32_t slot = shards[shard_num].member_slots[member_of_hash(shard_num, hashes[i])];
+            routes.key_slots[first + i] = slot;
+            routes.offsets[slot + 1]++;
+        }
+    }
+    // ...so that their prefix sum is the start of each slot's keys...
+    for(std::size_t slot = 0; slot < num_slots; ++slot) {
+        routes.offsets[slot + 1] += routes.offsets[slot];
+    }
+    // ...then place each key, which leaves offsets[slot] at the end of the slot's keys...
+    routes.key_indices.resize(num_keys);
+    for(std::size_t i = 0; i < num_keys; ++i) {
+        routes.key_indices[routes.offsets[routes.key_slots[i]]++] = i;
+    }
+    // ...and keep only the nodes that have keys, overwriting offsets in place
+    routes.nodes.clear();
+    std::size_t slot_start = 0;
+    std::size_t num_nodes = 0;
+    for(std::size_t slot = 0; slot < num_slots; ++slot) {
+        const std::size_t slot_end = routes.offsets[slot];
+        if(slot_end > slot_start) {
+            routes.nodes.push_back(node_slots[slot]);
+            routes.offsets[num_nodes++] = slot_start;
+        }
+        slot_start = slot_end;
+    }
+    routes.offsets[num_nodes] = num_keys;
+    routes.offsets.resize(num_nodes + 1);
+}
+
+ShardRouter::BatchRoutes ShardRouter::route_batch(const std::vector<std::string>& keys) const {
+    std::vector<std::string_view> key_views(keys.begin(), keys.end());
+    BatchRoutes routes;
+    route_batch(key_views.data(), key_views.size(), routes);
+    return routes;
+}
+
+}  // namespace derecho
@@ -119,6 +119,114 @@ SubgroupAllocationPolicy identical_subgroups_policy(int num_subgroups, const Sha
     return SubgroupAllocationPolicy{num_subgroups, true, {subgroup_policy}};
 }
 
+/**
+ * @return The standby node IDs of a shard, which are empty if the policy has
+ * no standby nodes.
+ */
+static const std::set<node_id_t>& shard_standby_node_ids(const ShardAllocationPolicy& sharding_policy,
+                                                         int shard_num) {
+    static const std::set<node_id_t> no_standby_nodes;
+    return sharding_policy.standby_node_ids_by_shard.empty() ? no_standby_nodes
+                                                             : sharding_policy.standby_node_ids_by_shard[shard_num];
+}
+
+/**
+ * Lists the standby nodes of a shard that are in the current View but are not
+ * counted among the shard's members, in ascending order of node ID. These are
+ * the standby nodes that can be promoted into the shard.
+ */
+static std::vector<node_id_t> available_standby_nodes(const ShardAllocationPolicy& sharding_policy,
+                                                      int shard_num,
+                                                      const std::set<node_id_t>& curr_member_set,
+                                                      const std::set<node_id_t>& shard_member_set) {
+    std::vector<node_id_t> available_nodes;
+    for(const node_id_t node_id : shard_standby_node_ids(sharding_policy, shard_num)) {
+        if(curr_member_set.count(node_id) > 0 && shard_member_set.count(node_id) == 0) {
+            available_nodes.push_back(node_id);
+        }
+    }
+    return available_nodes;
+}
+
+/**
+ * Computes the size that a shard's standby nodes should restore it to. They
+ * only replace members that failed or left, so this is 0 if the shard had no
+ * members (or there was no previous View). Otherwise it is the number of
+ * members the shard had in the previous View, not counting its unpromoted
+ * warm standbys, but at least its minimum size and at most its maximum size.
+ */
+static std::size_t standby_target_size(const ShardAllocationPolicy& sharding_policy,
+                                       int shard_num,
+                                       std::size_t prev_shard_size) {
+    const std::size_t min_shard_size = sharding_policy.even_shards ? sharding_policy.min_nodes_per_shard
+                                                                   : sharding_policy.min_num_nodes_by_shard[shard_num];
+    const std::size_t max_shard_size = sharding_policy.even_shards ? sharding_policy.max_nodes_per_shard
+                                                                   : sharding_policy.max_num_nodes_by_shard[shard_num];
+    if(prev_shard_size == 0) {
+        return 0;
+    }
+    return std::max(min_shard_size, std::min(prev_shard_size, max_shard_size));
+}
+
+std::set<node_id_t> DefaultSubgroupAllocator::collect_standby_node_ids() const {
+    std::set<node_id_t> all_standby_node_ids;
+    for(const auto& policy_entry : policies) {
+        if(!std::holds_alternative<SubgroupAllocationPolicy>(policy_entry.second)) {
+            continue;
+        }
+        for(const auto& sharding_policy : std::get<SubgroupAllocationPolicy>(policy_entry.second).shard_policy_by_subgroup) {
+            for(const auto& standby_id_set : sharding_policy.standby_node_ids_by_shard) {
+                all_standby_node_ids.insert(standby_id_set.begin(), standby_id_set.end());
+            }
+        }
+    }
+    return all_standby_node_ids;
+}
+
+void DefaultSubgroupAllocator::validate_standby_node_ids() const {
+    //Collect the reserved nodes from the policies, since all_reserved_node_ids may not be set
+    std::set<node_id_t> reserved_node_ids;
+    for(const auto& policy_entry : policies) {
+        if(!std::holds_alternative<SubgroupAllocationPolicy>(policy_entry.second)) {
+            continue;
+        }
+        for(const auto& sharding_policy : std::get<SubgroupAllocationPolicy>(policy_entry.second).shard_policy_by_subgroup) {
+            for(const auto& reserved_id_set : sharding_policy.reserved_node_ids_by_shard) {
+                reserved_node_ids.insert(reserved_id_set.begin(), reserved_id_set.end());
+            }
+        }
+    }
+    std::set<node_id_t> standby_node_ids;
+    for(const auto& policy_entry : policies) {
+        if(!std::holds_alternative<SubgroupAllocationPolicy>(policy_entry.second)) {
+            continue;
+        }
+        const SubgroupAllocationPolicy& subgroup_type_policy = std::get<SubgroupAllocationPolicy>(policy_entry.second);
+        for(int subgroup_num = 0; subgroup_num < subgroup_type_policy.num_subgroups; ++subgroup_num) {
+            const ShardAllocationPolicy& sharding_policy
+                    = subgroup_type_policy.identical_subgroups
+                              ? subgroup_type_policy.shard_policy_by_subgroup[0]
+                              : subgroup_type_policy.shard_policy_by_subgroup[subgroup_num];
+            if(sharding_policy.standby_node_ids_by_shard.empty()) {
+                continue;
+            }
+            if(sharding_policy.standby_node_ids_by_shard.size() != static_cast<std::size_t>(sharding_policy.num_shards)) {
+                throw derecho_exception("standby_node_ids_by_shard must have an entry for every shard of the subgroup");
+            }
+            for(const auto& standby_id_set : sharding_policy.standby_node_ids_by_shard) {
+                for(const node_id_t node_id : standby_id_set) {
+                    if(reserved_node_ids.count(node_id) > 0) {
+                        throw derecho_exception("Node " + std::to_string(node_id) + " cannot be both a reserved node and a standby node");
+                    }
+                    if(!standby_node_ids.insert(node_id).second) {
+                        throw derecho_exception("Node " + std::to_string(node_id) + " cannot be a standby node for more than one shard");
+                    }
+                }
+            }
+        }
+    }
+}
+
 void DefaultSubgroupAllocator::compute_standard_memberships(
         const std::vector<std::type_index>& subgroup_type_order,
         const std::unique_ptr<View>& prev_view,
@@ -132,11 +240,16 @@ void DefaultSubgroupAllocator::compute_standard_memberships(
     //knowing exactly how many nodes they will get
 
     dbg_default_trace("Ready to really assign nodes");
+    /* Reserved nodes and standby nodes are only ever assigned to their own shards,
+     * so both are kept out of the pool of unassigned nodes in the same way.
+     */
+    std::set<node_id_t> inherent_node_ids = collect_standby_node_ids();
+    inherent_node_ids.insert(all_reserved_node_ids.begin(), all_reserved_node_ids.end());
     if(!prev_view) {
         /* allocate_standard_subgroup_type is invoked when we have no prev_view, and thus
-         * next_unassigned_rank is 0. If we have reserved node_ids, we need to rearrange
+         * next_unassigned_rank is 0. If we have reserved or standby node_ids, we need to rearrange
          * node_ids in curr_view.members into two "parts": the first part holds current
-         * active reserved node_ids, while the second part holds normal node_ids. We then
+         * active reserved and standby node_ids, while the second part holds normal node_ids. We then
          * rearrange next_unassigned_rank to be the length of the first part, since nodes
          * in the first part are inherent nodes for some shards, and definitely will be
          * assigned, sometimes more than once if we want to overlap shards.
@@ -145,16 +258,16 @@ void DefaultSubgroupAllocator::compute_standard_memberships(
         std::vector<node_id_t> curr_members;
         std::set<node_id_t> curr_member_set(curr_view.members.begin(), curr_view.members.end());
         dbg_default_trace("Initial curr_view.next_unassigned_rank is {}", curr_view.next_unassigned_rank);
-        if(all_reserved_node_ids.size() > 0) {
+        if(inherent_node_ids.size() > 0) {
             std::set_intersection(
                     curr_member_set.begin(), curr_member_set.end(),
-                    all_reserved_node_ids.begin(), all_reserved_node_ids.end(),
+                    inherent_node_ids.begin(), inherent_node_ids.end(),
                     std::inserter(curr_members, curr_members.end()));
             curr_view.next_unassigned_rank = curr_members.size();
             dbg_default_trace("After rearranging inherent node_ids, curr_view.next_unassigned_rank is {}", curr_view.next_unassigned_rank);
             std::set_difference(
                     curr_member_set.begin(), curr_member_set.end(),
-                    all_reserved_node_ids.begin(), all_reserved_node_ids.end(),
+                    inherent_node_ids.begin(), inherent_node_ids.end(),
                     std::inserter(curr_members, curr_members.end()));
         } else {
             curr_members = curr_view.members;
@@ -180,24 +293,24 @@ void DefaultSubgroupAllocator::compute_standard_memberships(
          * curr_view.members is already arranged into two parts: the first part holds
          * surviving nodes from prev_view, and the second part holds newly added nodes.
          * The next_unassigned_rank is the length of the first part. If we have reserved
-         * node_ids, we need to rearrange curr_view.members into 2 parts: the first part
-         * holds inherent node_ids for shards, which is composed with surviving node_ids
-         * and reserved node_ids the second part holds newly added non-reserved node_ids.
+         * or standby node_ids, we need to rearrange curr_view.members into 2 parts: the first
+         * part holds inherent node_ids for shards, which is composed with surviving node_ids
+         * and reserved and standby node_ids, and the second part holds the other newly added node_ids.
          * We then rearrange next_unassigned_rank to be the length of the first part,
          * since they will definitely be assigned.
          */
         std::vector<node_id_t> curr_members;
         std::set<node_id_t> curr_member_set(curr_view.members.begin(), curr_view.members.end());
         dbg_default_trace("Initial curr_view.next_unassigned_rank is {}", curr_view.next_unassigned_rank);
-        if(all_reserved_node_ids.size() > 0) {
-            std::set<node_id_t> active_reserved_node_id_set;
+        if(inherent_node_ids.size() > 0) {
+            std::set<node_id_t> active_inherent_node_id_set;
             std::set_intersection(
                     curr_member_set.begin(), curr_member_set.end(),
-                    all_reserved_node_ids.begin(), all_reserved_node_ids.end(),
-                    std::inserter(active_reserved_node_id_set, active_reserved_node_id_set.end()));
+                    inherent_node_ids.begin(), inherent_node_ids.end(),
+                    std::inserter(active_inherent_node_id_set, active_inherent_node_id_set.end()));
             std::set_union(
                     surviving_member_set.begin(), surviving_member_set.end(),
-                    active_reserved_node_id_set.begin(), active_reserved_node_id_set.end(),
+                    active_inherent_node_id_set.begin(), active_inherent_node_id_set.end(),
                     std::inserter(curr_members, curr_members.end()));
             dbg_default_trace("With inherent nodes, curr_members is: {}", curr_members);
 
@@ -206,9 +319,11 @@ void DefaultSubgroupAllocator::compute_standard_memberships(
 
             std::set_difference(
                     added_member_set.begin(), added_member_set.end(),
-                    all_reserved_node_ids.begin(), all_reserved_node_ids.end(),
+                    inherent_node_ids.begin(), inherent_node_ids.end(),
                     std::inserter(curr_members, curr_members.end()));
-            dbg_default_trace("Adding newly added non-reserved nodes, curr_members is: {}", curr_members);
+            dbg_default_trace("Adding newly added non-inherent nodes, curr_members is: {}", curr_members);
+        } else {
+            curr_members = curr_view.members;
         }
 
         for(uint32_t subgroup_type_id = 0; subgroup_type_id < subgroup_type_order.size();
@@ -252,6 +367,9 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
         nodes_needed = all_active_reserved_node_id_set.size();
         dbg_default_trace("After counting all_active_reserved_node_id_set, nodes_needed is {}", nodes_needed);
     }
+    // The number of standby nodes in curr_view that will not be promoted; they are
+    // members of the View (and of their shards, if warm), but not available to any shard
+    int unpromoted_standby_nodes = 0;
 
     std::map<std::type_index, std::vector<std::vector<uint32_t>>> shard_sizes;
     for(uint32_t subgroup_type_id = 0; subgroup_type_id < subgroup_type_order.size(); ++subgroup_type_id) {
@@ -284,6 +402,7 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
                 dbg_default_trace("Calculate node size for type {}, subgroup_num {}, shard_num {}", std::string(subgroup_type.name()), subgroup_num, shard_num);
 
                 std::set<node_id_t> survived_node_set;
+                std::size_t prev_shard_size = 0;
                 //If there was a previous view, we must include all non-failed nodes from that view
                 if(prev_view) {
                     const subgroup_id_t previous_assignment_offset
@@ -291,7 +410,13 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
                     const SubView& previous_shard_assignment
                             = prev_view->subgroup_shard_views[previous_assignment_offset + subgroup_num]
                                                              [shard_num];
+                    prev_shard_size = previous_shard_assignment.non_standby_members().size();
                     for(std::size_t rank = 0; rank < previous_shard_assignment.members.size(); ++rank) {
+                        //Warm standbys are shard members, but they are promoted again in every View
+                        if(sharding_policy.warm_standbys
+                           && shard_standby_node_ids(sharding_policy, shard_num).count(previous_shard_assignment.members[rank]) > 0) {
+                            continue;
+                        }
                         if(curr_view.rank_of(previous_shard_assignment.members[rank]) != -1) {
                             survived_node_set.insert(previous_shard_assignment.members[rank]);
                         }
@@ -327,8 +452,19 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
                 // All active reserved nodes just count once.
                 nodes_needed += inherent_node_id_set.size() - active_reserved_node_id_set.size();
 
-                if(inherent_node_id_set.size() >= min_shard_size) {
-                    min_shard_size = inherent_node_id_set.size();
+                // Promote standby nodes to restore the shard's size, before using any other nodes
+                const std::size_t num_available_standbys
+                        = available_standby_nodes(sharding_policy, shard_num, curr_member_set, inherent_node_id_set).size();
+                const std::size_t standby_target = standby_target_size(sharding_policy, shard_num, prev_shard_size);
+                const std::size_t num_promoted = inherent_node_id_set.size() >= standby_target
+                                                         ? 0
+                                                         : std::min(num_available_standbys, standby_target - inherent_node_id_set.size());
+                unpromoted_standby_nodes += num_available_standbys - num_promoted;
+                dbg_default_trace("The shard has {} available standby node(s), {} of which will be promoted", num_available_standbys, num_promoted);
+
+                if(inherent_node_id_set.size() + num_promoted >= min_shard_size) {
+                    min_shard_size = inherent_node_id_set.size() + num_promoted;
+                    nodes_needed += num_promoted;
                 } else {
                     nodes_needed += min_shard_size - inherent_node_id_set.size();
                 }
@@ -341,7 +477,7 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
     }
     //At this point we know whether the View has enough members,
     //so throw the exception if it will be inadequate
-    if(nodes_needed > curr_view.num_members) {
+    if(nodes_needed + unpromoted_standby_nodes > curr_view.num_members) {
         throw subgroup_provisioning_exception();
     }
 
@@ -366,7 +502,7 @@ DefaultSubgroupAllocator::compute_standard_shard_sizes(
                     uint max_shard_members = sharding_policy.even_shards
                                                      ? sharding_policy.max_nodes_per_shard
                                                      : sharding_policy.max_num_nodes_by_shard[shard_num];
-                    if(nodes_needed >= curr_view.num_members) {
+                    if(nodes_needed + unpromoted_standby_nodes >= curr_view.num_members) {
                         done_adding = true;
                         break;
                     }
@@ -454,6 +590,24 @@ subgroup_shard_layout_t DefaultSubgroupAllocator::allocate_standard_subgroup_typ
                     }
                 }
             }
+            // Standby nodes only replace failed members, so in the first View they are not promoted,
+            // but warm standbys follow the shard as non-senders
+            const std::vector<node_id_t> warm_standbys
+                    = sharding_policy.warm_standbys
+                              ? available_standby_nodes(sharding_policy, shard_num, curr_member_set,
+                                                        std::set<node_id_t>(desired_nodes.begin(), desired_nodes.end()))
+                              : std::vector<node_id_t>{};
+            std::vector<int> is_standby;
+            if(warm_standbys.size() > 0) {
+                if(is_sender.empty()) {
+                    is_sender.assign(desired_nodes.size(), true);
+                }
+                is_standby.assign(desired_nodes.size(), false);
+                desired_nodes.insert(desired_nodes.end(), warm_standbys.begin(), warm_standbys.end());
+                is_sender.resize(desired_nodes.size(), false);
+                is_standby.resize(desired_nodes.size(), true);
+                dbg_default_trace("Adding warm standby nodes to shard {}: {}", shard_num, warm_standbys);
+            }
 
             //Figure out what the Mode policy for this shard is
             Mode delivery_mode = sharding_policy.even_shards
@@ -466,7 +620,7 @@ subgroup_shard_layout_t DefaultSubgroupAllocator::allocate_standard_subgroup_typ
             //Put the SubView at the end of subgroup_allocation[subgroup_num]
             //Since we go through shards in order, this is at index shard_num
             subgroup_allocation[subgroup_num].emplace_back(
-                    curr_view.make_subview(desired_nodes, delivery_mode, is_sender, profile));
+                    curr_view.make_subview(desired_nodes, delivery_mode, is_sender, profile, is_standby));
         }
     }
     return subgroup_allocation;
@@ -507,21 +661,25 @@ subgroup_shard_layout_t DefaultSubgroupAllocator::update_standard_subgroup_type(
             uint32_t allocated_shard_size = shard_sizes.at(subgroup_type)[subgroup_num][shard_num];
             dbg_default_trace("Subgroup {}, shard {}, is assigned {} nodes", subgroup_num, shard_num, allocated_shard_size);
 
-            //Add all the non-failed nodes from the previous assignment
+            const ShardAllocationPolicy& sharding_policy
+                    = subgroup_type_policy.identical_subgroups
+                              ? subgroup_type_policy.shard_policy_by_subgroup[0]
+                              : subgroup_type_policy.shard_policy_by_subgroup[subgroup_num];
+
+            //Add all the non-failed nodes from the previous assignment, except warm standbys, which are promoted again below
             for(std::size_t rank = 0; rank < previous_shard_assignment.members.size(); ++rank) {
                 if(curr_view.rank_of(previous_shard_assignment.members[rank]) == -1) {
                     continue;
                 }
+                if(sharding_policy.warm_standbys
+                   && shard_standby_node_ids(sharding_policy, shard_num).count(previous_shard_assignment.members[rank]) > 0) {
+                    continue;
+                }
                 next_shard_members.push_back(previous_shard_assignment.members[rank]);
                 next_is_sender.push_back(previous_shard_assignment.is_sender[rank]);
             }
             dbg_default_trace("After assigning surviving nodes, next_shard_members is: {}", next_shard_members);
 
-            const ShardAllocationPolicy& sharding_policy
-                    = subgroup_type_policy.identical_subgroups
-                              ? subgroup_type_policy.shard_policy_by_subgroup[0]
-                              : subgroup_type_policy.shard_policy_by_subgroup[subgroup_num];
-
             //Add newly added reserved nodes
             if(sharding_policy.reserved_node_ids_by_shard.size() > 0) {
                 std::set<node_id_t> added_reserved_node_id_set;
@@ -552,21 +710,46 @@ subgroup_shard_layout_t DefaultSubgroupAllocator::update_standard_subgroup_type(
                 dbg_default_trace("There is no reserved node_id configured.");
             }
 
+            //Promote standby nodes to replace members that failed or left, up to the shard's previous size
+            const std::vector<node_id_t> available_standbys = available_standby_nodes(
+                    sharding_policy, shard_num, curr_member_set,
+                    std::set<node_id_t>(next_shard_members.begin(), next_shard_members.end()));
+            const std::size_t standby_target = standby_target_size(sharding_policy, shard_num,
+                                                                   previous_shard_assignment.non_standby_members().size());
+            std::size_t num_promoted = 0;
+            for(; num_promoted < available_standbys.size() && next_shard_members.size() < standby_target; ++num_promoted) {
+                next_shard_members.push_back(available_standbys[num_promoted]);
+                next_is_sender.push_back(sharding_policy.reserved_sender_ids_by_shard.empty() ? true : sharding_policy.reserved_sender_ids_by_shard[shard_num].empty());
+                dbg_default_trace("Promoting standby node {} into shard {}", available_standbys[num_promoted], shard_num);
+            }
+
             //Add additional members if needed
             while(next_shard_members.size() < allocated_shard_size) {
                 //This must be true if compute_standard_shard_sizes said our view was adequate
-                assert(curr_view.next_unassigned_rank < (int)curr_view.members.size());
-                next_shard_members.push_back(curr_view.members[curr_view.next_unassigned_rank]);
+                assert(curr_view.next_unassigned_rank < (int)curr_members.size());
+                next_shard_members.push_back(curr_members[curr_view.next_unassigned_rank]);
                 curr_view.next_unassigned_rank++;
                 //If senders are not specified, all nodes are senders; otherwise, additional members are not senders.
                 next_is_sender.push_back(sharding_policy.reserved_sender_ids_by_shard.empty() ? true : sharding_policy.reserved_sender_ids_by_shard[shard_num].empty());
             }
+
+            //Warm standbys that were not promoted follow the shard as non-senders
+            std::vector<int> next_is_standby;
+            if(sharding_policy.warm_standbys && num_promoted < available_standbys.size()) {
+                next_is_standby.assign(next_shard_members.size(), false);
+                for(std::size_t i = num_promoted; i < available_standbys.size(); ++i) {
+                    next_shard_members.push_back(available_standbys[i]);
+                    next_is_sender.push_back(false);
+                    next_is_standby.push_back(true);
+                }
+            }
             dbg_default_trace("Assigned shard {} nodes in total, with curr_view.next_unassigned_rank {}: {}", next_shard_members.size(), curr_view.next_unassigned_rank, next_shard_members);
 
             next_assignment[subgroup_num].emplace_back(curr_view.make_subview(next_shard_members,
                                                                               previous_shard_assignment.mode,
                                                                               next_is_sender,
-                                                                              previous_shard_assignment.profile));
+                                                                              previous_shard_assignment.profile,
+                                                                              next_is_standby));
         }
     }
     return next_assignment;
@@ -654,6 +837,7 @@ DefaultSubgroupAllocator::DefaultSubgroupAllocator(std::vector<std::type_index>
         policies.emplace(subgroup_types[subgroup_type_index],
                          parse_json_subgroup_policy(layout_array[subgroup_type_index], all_reserved_node_ids));
     }
+    validate_standby_node_ids();
 }
 
 DefaultSubgroupAllocator::DefaultSubgroupAllocator(std::vector<std::type_index> subgroup_types, const std::string& json_file_path) {
@@ -670,6 +854,7 @@ DefaultSubgroupAllocator::DefaultSubgroupAllocator(std::vector<std::type_index>
         policies.emplace(subgroup_types[subgroup_type_index],
                          parse_json_subgroup_policy(layout_array[subgroup_type_index], all_reserved_node_ids));
     }
+    validate_standby_node_ids();
 }
 
 DefaultSubgroupAllocator::DefaultSubgroupAllocator(std::vector<std::type_index> subgroup_types) {
@@ -699,6 +884,7 @@ DefaultSubgroupAllocator::DefaultSubgroupAllocator(std::vector<std::type_index>
     } else {
         throw derecho_exception("Either json_layout or json_layout_file is required when constructing DefaultSubgroupAllocator with no arguments");
     }
+    validate_standby_node_ids();
 }
 
 SubgroupAllocationPolicy parse_json_subgroup_policy(const json& jconf, std::set<node_id_t>& all_reserved_node_ids) {
@@ -720,7 +906,10 @@ SubgroupAllocationPolicy parse_json_subgroup_policy(const json& jconf, std::set<
            || subgroup_it[profiles_by_shard_field].size() != num_shards ||
            // "reserved_node_ids_by_shard" is not a mandatory field
            (subgroup_it[reserved_node_ids_by_shard_field].size() != 0
-            && subgroup_it[reserved_node_ids_by_shard_field].size() != num_shards)) {
+            && subgroup_it[reserved_node_ids_by_shard_field].size() != num_shards)
+           // "standby_node_ids_by_shard" is not a mandatory field either
+           || (subgroup_it[standby_node_ids_by_shard_field].size() != 0
+               && subgroup_it[standby_node_ids_by_shard_field].size() != num_shards)) {
             dbg_default_error("parse_json_subgroup_policy: shards does not match in at least one subgroup: {}",
                               subgroup_it.get<std::string>());
 
@@ -741,6 +930,8 @@ SubgroupAllocationPolicy parse_json_subgroup_policy(const json& jconf, std::set<
         for(auto it : subgroup_it[delivery_modes_by_shard_field]) {
             if(it == delivery_mode_raw) {
                 shard_allocation_policy.modes_by_shard.push_back(Mode::UNORDERED);
+            } else if(it == delivery_mode_sequenced) {
+                shard_allocation_policy.modes_by_shard.push_back(Mode::SEQUENCED);
             } else {
                 shard_allocation_policy.modes_by_shard.push_back(Mode::ORDERED);
             }
@@ -796,6 +987,21 @@ SubgroupAllocationPolicy parse_json_subgroup_policy(const json& jconf, std::set<
             dbg_default_trace("There is no reserved node_id configured.");
         }
 
+        // "standby_node_ids_by_shard" is not a mandatory field; the allocator validates it
+        if(!subgroup_it[standby_node_ids_by_shard_field].is_null()) {
+            for(const auto& per_shard_set : subgroup_it[standby_node_ids_by_shard_field].get<std::vector<std::set<std::string>>>()) {
+                std::set<node_id_t> nodes;
+                for(const auto& node_string : per_shard_set) {
+                    nodes.insert(static_cast<node_id_t>(std::stoi(node_string)));
+                }
+                shard_allocation_policy.standby_node_ids_by_shard.emplace_back(std::move(nodes));
+            }
+        }
+        // "warm_standbys" is not a mandatory field either
+        if(subgroup_it[warm_standbys_field].is_boolean()) {
+            shard_allocation_policy.warm_standbys = subgroup_it[warm_standbys_field].get<bool>();
+        }
+
         subgroup_allocation_policy.shard_policy_by_subgroup.emplace_back(std::move(shard_allocation_policy));
     }
     return subgroup_allocation_policy;
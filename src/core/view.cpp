@@ -26,10 +26,12 @@ SubView::SubView(Mode mode,
                  const std::vector<node_id_t>& members,
                  std::vector<int> is_sender,
                  const std::vector<IpAndPorts>& member_ips_and_ports,
-                 const std::string profile)
+                 const std::string profile,
+                 std::vector<int> is_standby)
         : mode(mode),
           members(members),
           is_sender(members.size(), 1),
+          is_standby(is_standby),
           member_ips_and_ports(member_ips_and_ports),
           my_rank(-1),
           profile(profile) {
@@ -71,6 +73,20 @@ uint32_t SubView::num_senders() const {
     return num;
 }
 
+bool SubView::is_standby_rank(uint32_t rank) const {
+    return !is_standby.empty() && is_standby[rank];
+}
+
+std::vector<node_id_t> SubView::non_standby_members() const {
+    std::vector<node_id_t> non_standbys;
+    for(uint32_t rank = 0; rank < members.size(); ++rank) {
+        if(!is_standby_rank(rank)) {
+            non_standbys.push_back(members[rank]);
+        }
+    }
+    return non_standbys;
+}
+
 void SubView::init_joined_departed(const SubView& previous_subview) {
     //To ensure this method is idempotent
     joined.clear();
@@ -163,7 +179,8 @@ int View::rank_of(const node_id_t& who) const {
 SubView View::make_subview(const std::vector<node_id_t>& with_members,
                            const Mode mode,
                            const std::vector<int>& is_sender,
-                           std::string profile) const {
+                           std::string profile,
+                           const std::vector<int>& is_standby) const {
     // Make the profile string all uppercase so that it is effectively case-insensitive
     std::transform(profile.begin(), profile.end(), profile.begin(), ::toupper);
     std::vector<IpAndPorts> subview_member_ips_and_ports(with_members.size());
@@ -176,7 +193,7 @@ SubView View::make_subview(const std::vector<node_id_t>& with_members,
         subview_member_ips_and_ports[subview_rank] = member_ips_and_ports[view_rank_of_member];
     }
     // Note that joined and departed do not need to get initialized here; they will be initialized by ViewManager
-    return SubView(mode, with_members, is_sender, subview_member_ips_and_ports, profile);
+    return SubView(mode, with_members, is_sender, subview_member_ips_and_ports, profile, is_standby);
 }
 
 int View::subview_rank_of_shard_leader(subgroup_id_t subgroup_id,
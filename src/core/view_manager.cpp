@@ -12,9 +12,11 @@
 #include "derecho/persistent/Persistent.hpp"
 #include "derecho/utils/container_template_functions.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <mutils/macro_utils.hpp>
 
+#include <algorithm>
 #include <arpa/inet.h>
 #include <tuple>
 
@@ -32,6 +34,7 @@ ViewManager::ViewManager(
         PersistenceManager& persistence_manager,
         std::vector<view_upcall_t> _view_upcalls)
         : vm_logger(LoggerFactory::createIfAbsent(LoggerFactory::VIEWMANAGER_LOGGER_NAME, getConfString(Conf::LOGGER_VIEWMANAGER_LOG_LEVEL))),
+          max_queued_sends(getConfUInt32(Conf::DERECHO_MAX_QUEUED_SENDS)),
           server_socket(getConfUInt16(Conf::DERECHO_GMS_PORT)),
           thread_shutdown(false),
           disable_partitioning_safety(getConfBoolean(Conf::DERECHO_DISABLE_PARTITIONING_SAFETY)),
@@ -59,6 +62,27 @@ ViewManager::~ViewManager() {
     if(old_view_cleanup_thread.joinable()) {
         old_view_cleanup_thread.join();
     }
+    queued_sends_cv.notify_all();
+    view_change_cv.notify_all();
+    if(queued_send_thread.joinable()) {
+        queued_send_thread.join();
+    }
+    // Destroy the RDMC groups and SSTs of all views before releasing the
+    // group numbers and transports they use, which other Groups may share
+    old_views = {};
+    next_view.reset();
+    curr_view.reset();
+    if(rdmc_group_num_base) {
+        rdmc::release_group_numbers(*rdmc_group_num_base);
+    }
+    if(transport_node_id) {
+        rdmc::shutdown();
+#ifdef USE_VERBS_API
+        sst::verbs_destroy(*transport_node_id);
+#else
+        sst::lf_destroy(*transport_node_id);
+#endif
+    }
     tcp_sockets.destroy();
 }
 
@@ -110,6 +134,7 @@ void ViewManager::startup_to_first_view() {
                 std::vector<node_id_t>{}, std::vector<node_id_t>{},
                 0, 0, subgroup_type_order);
         active_leader = true;
+        reserve_rdmc_group_numbers();
         await_first_view();
         setup_initial_tcp_connections(*curr_view, my_id);
     } else {
@@ -143,6 +168,7 @@ bool ViewManager::restart_to_initial_view() {
             curr_view->subgroup_type_order = subgroup_type_order;
             //Set up restart state and await rejoining nodes as the leader
             restart_state->load_ragged_trim(*curr_view);
+            reserve_rdmc_group_numbers();
             restart_leader_state_machine = std::make_unique<RestartLeaderState>(
                     std::move(curr_view), *restart_state,
                     subgroup_info, my_id);
@@ -335,6 +361,7 @@ bool ViewManager::receive_view_and_leaders() {
     } catch(tcp::socket_error& e) {
         return false;
     }
+    reserve_rdmc_group_numbers();
 
     //Set up non-serialized fields of curr_view
     curr_view->subgroup_type_order = subgroup_type_order;
@@ -445,6 +472,14 @@ void ViewManager::initialize_multicast_groups(const UserMessageCallbacks& callba
                 assert(subgroup_objects.find(subgroup_id) != subgroup_objects.end());
                 subgroup_objects.at(subgroup_id)->post_next_version(ver, msg_ts);
             };
+    internal_callbacks.placement_log_callback =
+            [this](const subgroup_id_t& subgroup_id) -> persistent::PersistLog* {
+                auto object_iter = subgroup_objects.find(subgroup_id);
+                if(object_iter == subgroup_objects.end()) {
+                    return nullptr;
+                }
+                return object_iter->second->get_placement_log();
+            };
     dbg_debug(vm_logger, "Initializing SST and RDMC for the first time.");
     construct_multicast_group(callbacks, internal_callbacks, subgroup_settings_map, num_received_size, slot_size, index_field_size);
     curr_view->gmsSST->vid[curr_view->my_rank] = curr_view->vid;
@@ -689,6 +724,16 @@ void ViewManager::await_first_view() {
     }
 }
 
+void ViewManager::reserve_rdmc_group_numbers() {
+    if(rdmc_group_num_base) {
+        return;
+    }
+    rdmc_group_num_base = rdmc::reserve_group_numbers();
+    if(!rdmc_group_num_base) {
+        throw derecho_exception("All RDMC group numbers are reserved by other Groups in this process");
+    }
+}
+
 void ViewManager::await_rejoining_nodes(const node_id_t my_id) {
     bool quorum_achieved = false;
     while(!quorum_achieved) {
@@ -754,6 +799,8 @@ void ViewManager::initialize_rdmc_sst() {
         std::cout << "Global setup failed" << std::endl;
         exit(0);
     }
+    //Every node reserved its range of RDMC group numbers before it got the View
+    assert(rdmc_group_num_base);
     auto member_ips_and_sst_ports_map = make_member_ips_and_ports_map(*curr_view, PortType::SST);
     node_id_t my_id = curr_view->members[curr_view->my_rank];
     const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>> self_ip_and_port_map = {
@@ -770,11 +817,13 @@ void ViewManager::initialize_rdmc_sst() {
                        self_ip_and_port_map,
                        my_id);
 #endif
+    transport_node_id = my_id;
 }
 
 void ViewManager::create_threads() {
     client_listener_thread = std::thread{[this]() {
         pthread_setname_np(pthread_self(), "client_thread");
+        pin_thread("client_thread");
         while(!thread_shutdown) {
             tcp::socket client_socket = server_socket.accept();
             dbg_debug(vm_logger, "Background thread got a client connection from {}", client_socket.get_remote_ip());
@@ -784,6 +833,7 @@ void ViewManager::create_threads() {
 
     old_view_cleanup_thread = std::thread([this]() {
         pthread_setname_np(pthread_self(), "old_view");
+        pin_thread("old_view");
         while(!thread_shutdown) {
             unique_lock_t old_views_lock(old_views_mutex);
             old_views_cv.wait(old_views_lock, [this]() {
@@ -795,6 +845,67 @@ void ViewManager::create_threads() {
             }
         }
     });
+
+    queued_send_thread = std::thread(&ViewManager::replay_queued_sends, this);
+}
+
+void ViewManager::replay_queued_sends() {
+    pthread_setname_np(pthread_self(), "queued_send");
+    pin_thread("queued_send");
+    unique_lock_t queue_lock(queued_sends_mutex);
+    while(!thread_shutdown) {
+        queued_sends_cv.wait(queue_lock, [this]() {
+            return thread_shutdown
+                   || std::any_of(queued_sends.begin(), queued_sends.end(),
+                                  [](const auto& queue_pair) { return !queue_pair.second.empty(); });
+        });
+        //Replay one message from each non-empty subgroup queue in turn, so that a
+        //long backlog in one subgroup does not starve the others
+        for(auto& queue_pair : queued_sends) {
+            if(thread_shutdown || queue_pair.second.empty()) {
+                continue;
+            }
+            const subgroup_id_t subgroup_num = queue_pair.first;
+            //Leave the message at the front of the queue until it has been sent, so
+            //send_async() keeps queueing behind it instead of overtaking it
+            QueuedSend& next_send = queue_pair.second.front();
+            queue_lock.unlock();
+            bool sent = false;
+            try {
+                shared_lock_t view_lock(view_mutex);
+                view_change_cv.wait(view_lock, [&]() {
+                    if(thread_shutdown) {
+                        return true;
+                    }
+                    sent = curr_view->multicast_group->send(subgroup_num, next_send.payload_size,
+                                                            next_send.msg_generator, next_send.cooked_send);
+                    return sent;
+                });
+            } catch(const std::out_of_range&) {
+                //The new view's MulticastGroup has no settings for this subgroup,
+                //which means this node is no longer a member of it
+                dbg_warn(vm_logger, "Dropping a queued send for subgroup {} because this node is no longer a sender in it", subgroup_num);
+            }
+            if(next_send.completion_callback) {
+                next_send.completion_callback(sent);
+            }
+            queue_lock.lock();
+            queue_pair.second.pop();
+            if(queue_pair.second.empty()) {
+                // drain() waits for every queue to empty
+                queued_sends_cv.notify_all();
+            }
+        }
+    }
+    //Report everything that was still queued at shutdown as dropped
+    for(auto& queue_pair : queued_sends) {
+        while(!queue_pair.second.empty()) {
+            if(queue_pair.second.front().completion_callback) {
+                queue_pair.second.front().completion_callback(false);
+            }
+            queue_pair.second.pop();
+        }
+    }
 }
 
 void ViewManager::register_predicates() {
@@ -1089,8 +1200,8 @@ void ViewManager::external_join_handler(tcp::socket& client_socket, const node_i
             dbg_debug(vm_logger, "Socket error description: {}", ex.what());
             return;
         }
-        sst::add_external_node(joiner_id, {client_socket.get_remote_ip(),
-                                           external_client_external_port});
+        sst::add_external_node(curr_view->members[curr_view->my_rank], joiner_id,
+                               {client_socket.get_remote_ip(), external_client_external_port});
         add_external_connection_upcall(joiner_id);
     }
 }
@@ -1399,6 +1510,16 @@ void ViewManager::deliver_ragged_trim(DerechoSST& gmsSST) {
         for(auto v : shard_view.is_sender) {
             if(v) num_shard_senders++;
         }
+        // A warm standby that is missing part of the trim can't deliver it, and
+        // gets the shard's state again in the next View instead
+        if(shard_view.is_standby_rank(shard_view.my_rank)) {
+            const std::vector<node_id_t> lagging_standbys = standbys_behind_ragged_trim(subgroup_id, shard_num);
+            if(std::find(lagging_standbys.begin(), lagging_standbys.end(), curr_view->members[curr_view->my_rank])
+               != lagging_standbys.end()) {
+                dbg_warn(vm_logger, "This warm standby missed some of the updates in subgroup {} before the view change, and will receive the shard's state again", subgroup_id);
+                continue;
+            }
+        }
         deliver_in_order(curr_view->rank_of(shard_leader), subgroup_id,
                          curr_view->multicast_group->get_subgroup_settings()
                                  .at(subgroup_id)
@@ -1417,9 +1538,13 @@ void ViewManager::deliver_ragged_trim(DerechoSST& gmsSST) {
                 continue;
             }
             message_id_t last_delivered_seq_num = gmsSST.delivered_num[curr_view->my_rank][subgroup_id];
-            // For each member of that shard...
-            for(const node_id_t& shard_member :
-                curr_view->subgroup_shard_views.at(subgroup_id).at(shard_num).members) {
+            const SubView& shard_view = curr_view->subgroup_shard_views.at(subgroup_id).at(shard_num);
+            // For each member of that shard, except other warm standbys...
+            for(uint32_t shard_rank = 0; shard_rank < shard_view.members.size(); ++shard_rank) {
+                if(shard_view.is_standby_rank(shard_rank) && static_cast<int32_t>(shard_rank) != shard_view.my_rank) {
+                    continue;
+                }
+                const node_id_t shard_member = shard_view.members[shard_rank];
                 uint member_row = curr_view->rank_of(shard_member);
                 // Check to see if the member persisted up to the ragged edge trim
                 if(!curr_view->failed[member_row]
@@ -1510,6 +1635,8 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
         }
     }
 
+    mark_standbys_behind_ragged_trim();
+
     // Set up TCP connections to the joined nodes
     update_tcp_connections();
     // After doing that, shard leaders can send them RPC objects over state_transfer_port
@@ -1547,7 +1674,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
 #else
         rdma::impl::lf_remove_connection(failed_node_id);
 #endif
-        sst::remove_node(failed_node_id);
+        sst::remove_node(my_id, failed_node_id);
     }
     // if new members have joined, tell RDMC and SST to add socket connections to them
     for(std::size_t i = 0; i < next_view->joined.size(); ++i) {
@@ -1571,7 +1698,7 @@ void ViewManager::finish_view_change(DerechoSST& gmsSST) {
     }
     for(std::size_t i = 0; i < next_view->joined.size(); ++i) {
         int joiner_rank = next_view->num_members - next_view->joined.size() + i;
-        if(!sst::add_node(next_view->members[joiner_rank],
+        if(!sst::add_node(my_id, next_view->members[joiner_rank],
                           {next_view->member_ips_and_ports[joiner_rank].ip_address,
                            next_view->member_ips_and_ports[joiner_rank].sst_port})) {
             dbg_warn(vm_logger, "Failed to add an SST TCP connection to new node {}", next_view->members[joiner_rank]);
@@ -1643,7 +1770,7 @@ void ViewManager::construct_multicast_group(const UserMessageCallbacks& callback
             curr_view->members, curr_view->members[curr_view->my_rank],
             curr_view->gmsSST, callbacks, internal_callbacks, num_subgroups, subgroup_settings,
             getConfUInt32(Conf::DERECHO_HEARTBEAT_MS),
-            persistence_manager, curr_view->failed);
+            persistence_manager, *rdmc_group_num_base, curr_view->failed);
 }
 
 void ViewManager::transition_multicast_group(
@@ -1846,6 +1973,8 @@ void ViewManager::send_subgroup_object(subgroup_id_t subgroup_id, node_id_t new_
     }
     dbg_debug(vm_logger, "Sending Replicated Object state for subgroup {} to node {} over the state-transfer socket", subgroup_id, new_node_id);
     subgroup_object->send_object(joiner_socket.get());
+    // Later serializations on this thread, such as computing the size of the object, must see the whole log
+    persistent::PersistentRegistry::resetEarliestVersionToSerialize();
 }
 
 void ViewManager::update_tcp_connections() {
@@ -1976,6 +2105,7 @@ std::tuple<uint32_t, uint32_t, uint32_t> ViewManager::derive_subgroup_settings(V
                         (uint32_t)shard_view.my_rank,
                         shard_view.members,
                         shard_view.is_sender,
+                        shard_view.is_standby,
                         shard_view.sender_rank_of(shard_view.my_rank),
                         num_received_offset,
                         slot_offset,
@@ -2170,6 +2300,135 @@ vector_int64_2d ViewManager::old_shard_leaders_by_new_ids(const View& curr_view,
     return old_shard_leaders_by_new_id;
 }
 
+std::vector<node_id_t> ViewManager::standbys_behind_ragged_trim(subgroup_id_t subgroup_id, uint32_t shard_num) const {
+    const View& Vc = *curr_view;
+    const SubView& shard_view = Vc.subgroup_shard_views.at(subgroup_id).at(shard_num);
+    const SubgroupSettings& subgroup_settings = Vc.multicast_group->get_subgroup_settings().at(subgroup_id);
+    std::vector<node_id_t> lagging_standbys;
+    if(shard_view.is_standby.empty() || subgroup_settings.mode == Mode::UNORDERED) {
+        return lagging_standbys;
+    }
+    const uint32_t num_received_offset = subgroup_settings.num_received_offset;
+    const int shard_leader_rank = Vc.rank_of(shard_view.members.at(Vc.subview_rank_of_shard_leader(subgroup_id, shard_num)));
+    for(uint32_t shard_rank = 0; shard_rank < shard_view.members.size(); ++shard_rank) {
+        const int member_row = Vc.rank_of(shard_view.members[shard_rank]);
+        if(!shard_view.is_standby_rank(shard_rank) || Vc.failed[member_row]) {
+            continue;
+        }
+        bool missed_updates = subgroup_settings.mode == Mode::SEQUENCED
+                              && Vc.gmsSST->num_cuts[member_row][subgroup_id]
+                                         < Vc.gmsSST->global_num_cuts[shard_leader_rank][subgroup_id];
+        for(uint32_t sender = 0; sender < shard_view.num_senders() && !missed_updates; ++sender) {
+            missed_updates = Vc.gmsSST->num_received[member_row][num_received_offset + sender]
+                             < Vc.gmsSST->global_min[shard_leader_rank][num_received_offset + sender];
+        }
+        if(missed_updates) {
+            lagging_standbys.push_back(shard_view.members[shard_rank]);
+        }
+    }
+    return lagging_standbys;
+}
+
+void ViewManager::mark_standbys_behind_ragged_trim() {
+    for(const auto& [subgroup_type_id, old_subgroup_ids] : curr_view->subgroup_ids_by_type_id) {
+        for(uint32_t subgroup_index = 0; subgroup_index < old_subgroup_ids.size(); ++subgroup_index) {
+            const auto my_shard = curr_view->my_subgroups.find(old_subgroup_ids[subgroup_index]);
+            if(my_shard == curr_view->my_subgroups.end()) {
+                continue;
+            }
+            //The subgroup is uniquely identified by (type ID, subgroup index) in both old and new views
+            const subgroup_id_t new_subgroup_id = next_view->subgroup_ids_by_type_id.at(subgroup_type_id)
+                                                          .at(subgroup_index);
+            if(my_shard->second >= next_view->subgroup_shard_views[new_subgroup_id].size()) {
+                continue;
+            }
+            SubView& next_shard_view = next_view->subgroup_shard_views[new_subgroup_id][my_shard->second];
+            for(const node_id_t standby_id : standbys_behind_ragged_trim(my_shard->first, my_shard->second)) {
+                if(next_shard_view.rank_of(standby_id) != -1
+                   && std::find(next_shard_view.joined.begin(), next_shard_view.joined.end(), standby_id)
+                              == next_shard_view.joined.end()) {
+                    dbg_debug(vm_logger, "Warm standby {} missed updates in subgroup {}, so it will get the shard's state like a joining member", standby_id, new_subgroup_id);
+                    next_shard_view.joined.push_back(standby_id);
+                }
+            }
+        }
+    }
+}
+
+std::map<subgroup_id_t, node_id_t> ViewManager::choose_drain_successors() const {
+    std::map<subgroup_id_t, node_id_t> successors;
+    for(const auto& [subgroup_id, shard_num] : curr_view->my_subgroups) {
+        const SubView& shard_view = curr_view->subgroup_shard_views.at(subgroup_id).at(shard_num);
+        if(shard_view.mode == Mode::UNORDERED || shard_view.is_standby_rank(shard_view.my_rank)) {
+            continue;
+        }
+        for(uint32_t shard_rank = 0; shard_rank < shard_view.members.size(); ++shard_rank) {
+            const node_id_t member_id = shard_view.members[shard_rank];
+            if(!shard_view.is_standby_rank(shard_rank) || curr_view->failed[curr_view->rank_of(member_id)]) {
+                continue;
+            }
+            auto successor = successors.find(subgroup_id);
+            if(successor == successors.end()) {
+                successors.emplace(subgroup_id, member_id);
+            } else if(member_id < successor->second) {
+                successor->second = member_id;
+            }
+        }
+    }
+    return successors;
+}
+
+bool ViewManager::wait_for_handover(bool include_own_sends, std::optional<std::chrono::steady_clock::time_point> deadline) {
+    // A view change resolves every message of the old view, so the successors
+    // and targets are chosen again whenever the view changes
+    shared_lock_t lock(view_mutex);
+    while(true) {
+        const int32_t target_vid = curr_view->vid;
+        bool caught_up = true;
+        if(include_own_sends) {
+            const std::map<subgroup_id_t, message_id_t> last_send_indices
+                    = curr_view->multicast_group->get_last_send_indices();
+            std::map<subgroup_id_t, persistent::version_t> delivered_versions;
+            for(const auto& subgroup_settings : curr_view->multicast_group->get_subgroup_settings()) {
+                if(subgroup_is_persistent(subgroup_settings.first)) {
+                    delivered_versions.emplace(subgroup_settings.first,
+                                               curr_view->multicast_group->get_delivered_version(subgroup_settings.first));
+                }
+            }
+            caught_up = curr_view->multicast_group->wait_for_drained(last_send_indices, delivered_versions, deadline);
+        }
+        for(const auto& [subgroup_id, successor_id] : choose_drain_successors()) {
+            if(!caught_up) {
+                break;
+            }
+            dbg_debug(vm_logger, "drain: waiting for warm standby {} to catch up in subgroup {}", successor_id, subgroup_id);
+            const persistent::version_t delivered_version
+                    = subgroup_is_persistent(subgroup_id)
+                              ? curr_view->multicast_group->get_delivered_version(subgroup_id)
+                              : persistent::INVALID_VERSION;
+            caught_up = curr_view->multicast_group->wait_for_standby(subgroup_id, successor_id, delivered_version, deadline);
+        }
+        if(caught_up) {
+            dbg_info(vm_logger, "drain: caught up in view {}", target_vid);
+            return true;
+        }
+        // Either the deadline passed or the view was wedged; in the second case,
+        // release the view lock until the next view is installed
+        if(deadline && std::chrono::steady_clock::now() >= *deadline) {
+            return false;
+        }
+        auto new_view = [&]() { return thread_shutdown || curr_view->vid != target_vid; };
+        if(deadline) {
+            view_change_cv.wait_until(lock, *deadline, new_view);
+        } else {
+            view_change_cv.wait(lock, new_view);
+        }
+        if(curr_view->vid == target_vid || thread_shutdown) {
+            return false;
+        }
+    }
+}
+
 bool ViewManager::suspected_not_equal(const DerechoSST& gmsSST, const std::vector<bool>& old) {
     for(unsigned int r = 0; r < gmsSST.get_num_rows(); r++) {
         for(size_t who = 0; who < gmsSST.suspected.size(); who++) {
@@ -2338,17 +2597,22 @@ void ViewManager::leader_ragged_edge_cleanup(const subgroup_id_t subgroup_num,
             //Copy this shard's slice of global_min, starting at num_received_offset
             gmssst::set(&Vc.gmsSST->global_min[myRank][num_received_offset],
                         &Vc.gmsSST->global_min[node_rank][num_received_offset], num_shard_senders);
+            gmssst::set(Vc.gmsSST->global_num_cuts[myRank][subgroup_num],
+                        Vc.gmsSST->global_num_cuts[node_rank][subgroup_num]);
             found = true;
         }
     }
 
     if(!found) {
+        // Members may have delivered anything that every non-standby member received,
+        // so the trim leaves out warm standbys, which may not have received all of it
+        const SubView& shard_view = Vc.subgroup_shard_views.at(subgroup_num).at(Vc.my_subgroups.at(subgroup_num));
         //Compute the global_min for this shard
         for(uint n = 0; n < num_shard_senders; n++) {
             int min_num_received = Vc.gmsSST->num_received[myRank][num_received_offset + n];
             for(uint r = 0; r < shard_members.size(); r++) {
                 auto node_rank = Vc.rank_of(shard_members[r]);
-                if(!Vc.failed[node_rank]) {
+                if(!Vc.failed[node_rank] && !shard_view.is_standby_rank(r)) {
                     int num_received_copy = Vc.gmsSST->num_received[node_rank][num_received_offset + n];
                     min_num_received = std::min(min_num_received, num_received_copy);
                 }
@@ -2356,6 +2620,22 @@ void ViewManager::leader_ragged_edge_cleanup(const subgroup_id_t subgroup_num,
 
             gmssst::set(Vc.gmsSST->global_min[myRank][num_received_offset + n], min_num_received);
         }
+        if(Vc.multicast_group->get_subgroup_settings().at(subgroup_num).mode == Mode::SEQUENCED) {
+            // Any cut a member delivered was copied by every non-standby member, so delivering
+            // the cuts every such survivor has copied preserves the order of those deliveries
+            int32_t min_num_cuts = Vc.gmsSST->num_cuts[myRank][subgroup_num];
+            for(uint r = 0; r < shard_members.size(); r++) {
+                auto node_rank = Vc.rank_of(shard_members[r]);
+                if(!Vc.failed[node_rank] && !shard_view.is_standby_rank(r)) {
+                    int32_t num_cuts_copy = Vc.gmsSST->num_cuts[node_rank][subgroup_num];
+                    min_num_cuts = std::min(min_num_cuts, num_cuts_copy);
+                }
+            }
+            std::vector<int32_t> max_received_indices(&Vc.gmsSST->global_min[myRank][num_received_offset],
+                                                      &Vc.gmsSST->global_min[myRank][num_received_offset] + num_shard_senders);
+            gmssst::set(Vc.gmsSST->global_num_cuts[myRank][subgroup_num],
+                        Vc.multicast_group->get_ragged_trim_num_cuts(subgroup_num, min_num_cuts, max_received_indices));
+        }
     }
 
     dbg_debug(vm_logger, "Shard leader for subgroup {} finished computing global_min", subgroup_num);
@@ -2364,6 +2644,8 @@ void ViewManager::leader_ragged_edge_cleanup(const subgroup_id_t subgroup_num,
             Vc.multicast_group->get_shard_sst_indices(subgroup_num),
             (uint8_t*)std::addressof(Vc.gmsSST->global_min[0][num_received_offset]) - Vc.gmsSST->getBaseAddress(),
             sizeof(Vc.gmsSST->global_min[0][num_received_offset]) * num_shard_senders);
+    Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
+                   Vc.gmsSST->global_num_cuts, subgroup_num);
     Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
                    Vc.gmsSST->global_min_ready, subgroup_num);
 
@@ -2387,11 +2669,15 @@ void ViewManager::follower_ragged_edge_cleanup(
     gmssst::set(&Vc.gmsSST->global_min[myRank][num_received_offset],
                 &Vc.gmsSST->global_min[shard_leader_rank][num_received_offset],
                 num_shard_senders);
+    gmssst::set(Vc.gmsSST->global_num_cuts[myRank][subgroup_num],
+                Vc.gmsSST->global_num_cuts[shard_leader_rank][subgroup_num]);
     gmssst::set(Vc.gmsSST->global_min_ready[myRank][subgroup_num], true);
     Vc.gmsSST->put(
             Vc.multicast_group->get_shard_sst_indices(subgroup_num),
             (uint8_t*)std::addressof(Vc.gmsSST->global_min[0][num_received_offset]) - Vc.gmsSST->getBaseAddress(),
             sizeof(Vc.gmsSST->global_min[0][num_received_offset]) * num_shard_senders);
+    Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
+                   Vc.gmsSST->global_num_cuts, subgroup_num);
     Vc.gmsSST->put(Vc.multicast_group->get_shard_sst_indices(subgroup_num),
                    Vc.gmsSST->global_min_ready, subgroup_num);
 }
@@ -2420,7 +2706,8 @@ void ViewManager::deliver_in_order(const int shard_leader_rank,
                 = Vc.gmsSST->global_min[shard_leader_rank][num_received_offset + sender_rank];
     }
     dbg_debug(vm_logger, "Delivering ragged-edge messages in order: {}", delivery_order.str());
-    Vc.multicast_group->deliver_messages_upto(max_received_indices, subgroup_num, num_shard_senders);
+    Vc.multicast_group->deliver_messages_upto(max_received_indices, subgroup_num, num_shard_senders,
+                                              Vc.gmsSST->global_num_cuts[shard_leader_rank][subgroup_num]);
 }
 
 void ViewManager::log_ragged_trim(const int shard_leader_rank,
@@ -2433,6 +2720,16 @@ void ViewManager::log_ragged_trim(const int shard_leader_rank,
         max_received_indices[sender_rank]
                 = curr_view->gmsSST->global_min[shard_leader_rank][num_received_offset + sender_rank];
     }
+    if(curr_view->multicast_group->get_subgroup_settings().at(subgroup_num).mode == Mode::SEQUENCED) {
+        // Sequence numbers don't follow the round-robin order in this mode, so log
+        // the round-robin trim that ends at the same sequence number as this one:
+        // every message up to the trim is delivered, so that is one less than their count
+        int32_t last_seq_num = -1;
+        for(const int32_t max_index : max_received_indices) {
+            last_seq_num += max_index + 1;
+        }
+        max_received_indices = RestartState::seq_num_to_ragged_trim(last_seq_num, num_shard_senders);
+    }
     uint32_t shard_num = curr_view->my_subgroups.at(subgroup_num);
     RaggedTrim trim_log{subgroup_num, shard_num, curr_view->vid,
                         static_cast<int32_t>(curr_view->members[curr_view->find_rank_of_leader()]),
@@ -2494,8 +2791,51 @@ void ViewManager::leave() {
     thread_shutdown = true;
 }
 
+bool ViewManager::drain(std::chrono::milliseconds timeout) {
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    if(timeout.count() > 0) {
+        deadline = std::chrono::steady_clock::now() + timeout;
+    }
+    // Waits on a condition variable until the predicate holds or the deadline passes
+    auto wait_until_deadline = [&deadline](auto& cv, auto& lock, auto predicate) {
+        if(deadline) {
+            return cv.wait_until(lock, *deadline, predicate);
+        }
+        cv.wait(lock, predicate);
+        return true;
+    };
+    dbg_info(vm_logger, "Draining this node before leaving the group.");
+    // Keep serving while the successors catch up with this node
+    if(!wait_for_handover(false, deadline)) {
+        dbg_warn(vm_logger, "drain: timed out waiting for the successors to catch up");
+        return false;
+    }
+    draining = true;
+    // Let the background thread replay the sends that were already queued
+    {
+        std::unique_lock<std::mutex> queue_lock(queued_sends_mutex);
+        const bool queues_empty = wait_until_deadline(queued_sends_cv, queue_lock, [this]() {
+            return thread_shutdown
+                   || std::all_of(queued_sends.begin(), queued_sends.end(),
+                                  [](const auto& queue_pair) { return queue_pair.second.empty(); });
+        });
+        if(!queues_empty || thread_shutdown) {
+            dbg_warn(vm_logger, "drain: stopped before the queued sends were replayed");
+            return false;
+        }
+    }
+    if(!wait_for_handover(true, deadline)) {
+        dbg_warn(vm_logger, "drain: timed out waiting for the rest of the group to catch up");
+        return false;
+    }
+    return true;
+}
+
 void ViewManager::send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
                        const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send) {
+    if(draining) {
+        throw derecho_exception("Cannot send: this node is draining before leaving the group.");
+    }
     shared_lock_t lock(view_mutex);
     view_change_cv.wait(lock, [&]() {
         return curr_view->multicast_group->send(subgroup_num, payload_size,
@@ -2503,6 +2843,58 @@ void ViewManager::send(subgroup_id_t subgroup_num, long long unsigned int payloa
     });
 }
 
+bool ViewManager::send_async(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                             const std::function<void(uint8_t* buf)>& msg_generator,
+                             const send_completion_callback_t& completion_callback,
+                             bool cooked_send) {
+    if(draining) {
+        return false;
+    }
+    //If a view change holds the write lock, don't wait for it; queue the message instead
+    shared_lock_t view_lock(view_mutex, std::try_to_lock);
+    if(view_lock.owns_lock()) {
+        bool queue_empty;
+        {
+            lock_guard_t queue_lock(queued_sends_mutex);
+            auto queue_iter = queued_sends.find(subgroup_num);
+            queue_empty = queue_iter == queued_sends.end() || queue_iter->second.empty();
+        }
+        //Anything that would make the caller wait (a wedged view, a full window,
+        //or the subgroup's rate limits) sends the message to the queue instead
+        if(queue_empty
+           && curr_view->multicast_group->try_send(subgroup_num, payload_size, msg_generator, cooked_send)
+                      == send_admission::ADMITTED) {
+            if(completion_callback) {
+                completion_callback(true);
+            }
+            return true;
+        }
+        view_lock.unlock();
+    }
+    lock_guard_t queue_lock(queued_sends_mutex);
+    std::queue<QueuedSend>& subgroup_queue = queued_sends[subgroup_num];
+    if(subgroup_queue.size() >= max_queued_sends) {
+        dbg_debug(vm_logger, "send_async: queue for subgroup {} is full ({} messages)", subgroup_num, subgroup_queue.size());
+        return false;
+    }
+    subgroup_queue.push(QueuedSend{payload_size, msg_generator, cooked_send, completion_callback});
+    dbg_trace(vm_logger, "send_async: queued a message for subgroup {}, {} messages queued", subgroup_num, subgroup_queue.size());
+    queued_sends_cv.notify_all();
+    return true;
+}
+
+send_admission ViewManager::try_send(subgroup_id_t subgroup_num, long long unsigned int payload_size,
+                                     const std::function<void(uint8_t* buf)>& msg_generator, bool cooked_send) {
+    if(draining) {
+        return send_admission::WOULD_BLOCK;
+    }
+    shared_lock_t lock(view_mutex, std::try_to_lock);
+    if(!lock.owns_lock()) {
+        return send_admission::WOULD_BLOCK;
+    }
+    return curr_view->multicast_group->try_send(subgroup_num, payload_size, msg_generator, cooked_send);
+}
+
 const uint64_t ViewManager::compute_global_stability_frontier(subgroup_id_t subgroup_num) {
     shared_lock_t lock(view_mutex);
     return curr_view->multicast_group->compute_global_stability_frontier(subgroup_num);
@@ -2516,6 +2908,14 @@ bool ViewManager::wait_for_global_persistence_frontier(subgroup_id_t subgroup_nu
     return curr_view->multicast_group->wait_for_global_persistence_frontier(subgroup_num, version);
 }
 
+const persistent::version_t ViewManager::get_quorum_persistence_frontier(subgroup_id_t subgroup_num) const {
+    return curr_view->multicast_group->get_quorum_persistence_frontier(subgroup_num);
+}
+
+bool ViewManager::wait_for_quorum_persistence_frontier(subgroup_id_t subgroup_num, persistent::version_t version) const {
+    return curr_view->multicast_group->wait_for_quorum_persistence_frontier(subgroup_num, version);
+}
+
 const persistent::version_t ViewManager::get_global_verified_frontier(subgroup_id_t subgroup_num) const {
     return curr_view->multicast_group->get_global_verified_frontier(subgroup_num);
 }
@@ -2549,6 +2949,16 @@ std::vector<std::vector<node_id_t>> ViewManager::get_subgroup_members(subgroup_t
     return subgroup_members;
 }
 
+std::vector<std::vector<node_id_t>> ViewManager::get_subgroup_non_standby_members(subgroup_type_id_t subgroup_type, uint32_t subgroup_index) {
+    shared_lock_t read_lock(view_mutex);
+    subgroup_id_t subgroup_id = curr_view->subgroup_ids_by_type_id.at(subgroup_type).at(subgroup_index);
+    std::vector<std::vector<node_id_t>> subgroup_members;
+    for(const auto& shard_view : curr_view->subgroup_shard_views.at(subgroup_id)) {
+        subgroup_members.push_back(shard_view.non_standby_members());
+    }
+    return subgroup_members;
+}
+
 std::vector<std::vector<IpAndPorts>> ViewManager::get_subgroup_member_addresses(subgroup_type_id_t subgroup_type, uint32_t subgroup_index) {
     shared_lock_t read_lock(view_mutex);
     subgroup_id_t subgroup_id = curr_view->subgroup_ids_by_type_id.at(subgroup_type).at(subgroup_index);
@@ -0,0 +1,310 @@
+#include "derecho/persistent/detail/DaxPersistLog.hpp"
+
+#include "derecho/persistent/detail/logger.hpp"
+#include "derecho/persistent/detail/util.hpp"
+#include "derecho/persistent/PersistException.hpp"
+
+#include <algorithm>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/magic.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/vfs.h>
+#include <unistd.h>
+
+#if defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+// MAP_SYNC makes the file system's block allocations durable at page fault
+// time, so that a store to a DAX mapping only needs a cache line flush.
+#ifdef MAP_SYNC
+#define DAX_MAP_FLAGS (MAP_SHARED_VALIDATE | MAP_SYNC)
+#else
+#define DAX_MAP_FLAGS (0)
+#endif
+
+#define CACHE_LINE_SIZE (64)
+
+using namespace std;
+
+namespace persistent {
+
+/////////////////////////
+// internal structures //
+/////////////////////////
+
+namespace {
+
+enum class cache_flush_instruction {
+    CLWB,
+    CLFLUSHOPT,
+    CLFLUSH
+};
+
+#if defined(__x86_64__)
+// CLWB keeps the line in the cache, CLFLUSHOPT evicts it but can be
+// reordered with other flushes, and CLFLUSH is serialized but always present.
+cache_flush_instruction detect_cache_flush_instruction() {
+    unsigned int eax, ebx, ecx, edx;
+    if(__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx)) {
+        if(ebx & (1u << 24)) {
+            return cache_flush_instruction::CLWB;
+        }
+        if(ebx & (1u << 23)) {
+            return cache_flush_instruction::CLFLUSHOPT;
+        }
+    }
+    return cache_flush_instruction::CLFLUSH;
+}
+#endif
+
+inline void store_fence() {
+#if defined(__x86_64__)
+    asm volatile("sfence" ::: "memory");
+#else
+    __sync_synchronize();
+#endif
+}
+
+inline uint64_t* redo_magic_of(MetaHeader* header) {
+    return reinterpret_cast<uint64_t*>(header->bytes + META_HEADER_SIZE - sizeof(uint64_t));
+}
+
+}  // namespace
+
+////////////////////////
+// visible to outside //
+////////////////////////
+
+DaxPersistLog::DaxPersistLog(const string& name, const string& dataPath, bool enableSignatures)
+        : FilePersistLog(name, replayMetaRedo(name, dataPath), enableSignatures),
+          m_iMetaFileDesc(-1),
+          m_pMeta(static_cast<MetaHeader*>(MAP_FAILED)),
+          m_bMapSync(false) {
+    // the prewarmer must not fault in the old mappings while they are replaced
+    stopPrewarming();
+    mapForDax();
+    startPrewarming();
+    dbg_info(m_logger, "{0} DAX log mapped from {1}{2}", name, dataPath,
+             m_bMapSync ? "" : " (tmpfs emulation, not durable)");
+}
+
+DaxPersistLog::~DaxPersistLog() noexcept(true) {
+    if(this->m_pMeta != MAP_FAILED) {
+        munmap(m_pMeta, META_SIZE << 1);
+    }
+    if(this->m_iMetaFileDesc != -1) {
+        close(this->m_iMetaFileDesc);
+    }
+}
+
+void DaxPersistLog::mapForDax() {
+    // STEP 1: find out if we are on persistent memory or only emulating it
+    struct statfs fs_stat;
+    if(statfs(this->m_sDataPath.c_str(), &fs_stat) != 0) {
+        throw persistent_file_error("statfs failed.", errno);
+    }
+    m_bMapSync = (fs_stat.f_type != TMPFS_MAGIC);
+    if(m_bMapSync && DAX_MAP_FLAGS == 0) {
+        throw persistent_exception("MAP_SYNC is not supported on this platform, so " + this->m_sDataPath + " cannot be used for DAX logs.");
+    }
+    const int map_flags = (m_bMapSync ? DAX_MAP_FLAGS : MAP_SHARED) | MAP_FIXED;
+    auto remap = [&](void* addr, size_t len, int fd) {
+        if(mmap(addr, len, PROT_READ | PROT_WRITE, map_flags, fd, 0) == MAP_FAILED) {
+            if(errno == EOPNOTSUPP) {
+                dbg_error(m_logger, "{0}:{1} is not on a DAX file system.", this->m_sName, this->m_sDataPath);
+            }
+            throw persistent_file_error("mmap failed.", errno);
+        }
+    };
+    // STEP 2: replace the ring buffer mappings made by load(); MAP_FIXED discards the old ones
+    remap(this->m_pLog, MAX_LOG_SIZE, this->m_iLogFileDesc);
+    remap((void*)((uint64_t)this->m_pLog + MAX_LOG_SIZE), MAX_LOG_SIZE, this->m_iLogFileDesc);
+    remap(this->m_pData, (size_t)MAX_DATA_SIZE, this->m_iDataFileDesc);
+    remap((void*)((uint64_t)this->m_pData + MAX_DATA_SIZE), (size_t)MAX_DATA_SIZE, this->m_iDataFileDesc);
+    // STEP 3: map the meta file, with room for the redo copy of the header
+    this->m_iMetaFileDesc = open(this->m_sMetaFile.c_str(), O_RDWR);
+    if(this->m_iMetaFileDesc == -1) {
+        throw persistent_file_error("Failed to open file.", errno);
+    }
+    // The destructor does not run if the constructor throws, so close the file before throwing
+    auto close_and_throw = [this](const char* message) {
+        const int error = errno;
+        close(this->m_iMetaFileDesc);
+        this->m_iMetaFileDesc = -1;
+        throw persistent_file_error(message, error);
+    };
+    if(ftruncate(this->m_iMetaFileDesc, META_SIZE << 1) != 0) {
+        close_and_throw("Failed to truncate file.");
+    }
+    void* meta = mmap(NULL, META_SIZE << 1, PROT_READ | PROT_WRITE, map_flags & ~MAP_FIXED, this->m_iMetaFileDesc, 0);
+    if(meta == MAP_FAILED) {
+        close_and_throw("mmap failed.");
+    }
+    m_pMeta = static_cast<MetaHeader*>(meta);
+}
+
+void DaxPersistLog::flushRange(const void* addr, uint64_t len) {
+#if defined(__x86_64__)
+    static const cache_flush_instruction flush_instruction = detect_cache_flush_instruction();
+    const uintptr_t end = reinterpret_cast<uintptr_t>(addr) + len;
+    for(uintptr_t line = reinterpret_cast<uintptr_t>(addr) & ~(uintptr_t)(CACHE_LINE_SIZE - 1);
+        line < end; line += CACHE_LINE_SIZE) {
+        volatile char* p = reinterpret_cast<volatile char*>(line);
+        switch(flush_instruction) {
+            case cache_flush_instruction::CLWB:
+                asm volatile("clwb %0" : "+m"(*p) : : "memory");
+                break;
+            case cache_flush_instruction::CLFLUSHOPT:
+                asm volatile("clflushopt %0" : "+m"(*p) : : "memory");
+                break;
+            case cache_flush_instruction::CLFLUSH:
+                asm volatile("clflush %0" : "+m"(*p) : : "memory");
+                break;
+        }
+    }
+#else
+    // no user-space cache flush here, so fall back to msync on the covering pages
+    if(msync(ALIGN_TO_PAGE(addr), len + ((uint64_t)addr) % PAGE_SIZE, MS_SYNC) != 0) {
+        throw persistent_file_error("msync failed.", errno);
+    }
+#endif
+}
+
+version_t DaxPersistLog::persist(version_t ver, bool preLocked) {
+    int64_t ver_ret = INVALID_VERSION;
+    if(!preLocked) {
+        FPL_PERS_LOCK;
+        FPL_RDLOCK;
+    }
+
+    if(m_currMetaHeader == m_persMetaHeader) {
+        if(CURR_LOG_IDX != INVALID_INDEX) {
+            ver_ret = m_currMetaHeader.fields.ver;
+        }
+        if(!preLocked) {
+            FPL_UNLOCK;
+            FPL_PERS_UNLOCK;
+        }
+        dbg_trace(m_logger, "{} persist returning early with version {}", this->m_sName, ver_ret);
+        return ver_ret;
+    }
+
+    dbg_trace(m_logger, "{0} flush data,log,and meta.", this->m_sName);
+    try {
+        // shadow the current state
+        MetaHeader shadow_header = m_currMetaHeader;
+        const int64_t first_idx = std::max(m_persMetaHeader.fields.tail, m_currMetaHeader.fields.head);
+        const int64_t end_idx = m_currMetaHeader.fields.tail;
+        if(first_idx < end_idx) {
+            // Both ring buffers are mapped twice, so these ranges are contiguous
+            // even if they wrap around the end of the buffer.
+            const LogEntry* first_entry = LOG_ENTRY_AT(first_idx);
+            const LogEntry* last_entry = LOG_ENTRY_AT(end_idx - 1);
+            flushRange(LOG_ENTRY_SIGNATURE(first_entry),
+                       last_entry->fields.ofst + last_entry->fields.sdlen - first_entry->fields.ofst);
+            flushRange(first_entry, (end_idx - first_idx) * sizeof(LogEntry));
+        }
+        if(NUM_USED_SLOTS > 0) {
+            ver_ret = m_currMetaHeader.fields.ver;
+        }
+        if(!preLocked) {
+            FPL_UNLOCK;
+        }
+        // the entries must be durable before the header that covers them
+        store_fence();
+        this->persistMetaHeaderAtomically(&shadow_header);
+    } catch(std::exception& e) {
+        if(!preLocked) {
+            FPL_PERS_UNLOCK;
+        }
+        throw;
+    }
+    dbg_trace(m_logger, "{0} flush data,log,and meta...done.", this->m_sName);
+
+    if(!preLocked) {
+        FPL_PERS_UNLOCK;
+    }
+    return ver_ret;
+}
+
+//////////////////////////
+// invisible to outside //
+//////////////////////////
+
+void DaxPersistLog::persistMetaHeaderAtomically(MetaHeader* pShadowHeader) {
+    MetaHeader* redo_header = m_pMeta + 1;
+    uint64_t* redo_magic = redo_magic_of(redo_header);
+
+    // STEP 1: write the redo copy, and only then mark it valid
+    redo_header->fields = pShadowHeader->fields;
+    flushRange(&redo_header->fields, sizeof(redo_header->fields));
+    store_fence();
+    *redo_magic = DAX_META_REDO_MAGIC;
+    flushRange(redo_magic, sizeof(uint64_t));
+    store_fence();
+
+    // STEP 2: update the meta header in place
+    m_pMeta->fields = pShadowHeader->fields;
+    flushRange(&m_pMeta->fields, sizeof(m_pMeta->fields));
+    store_fence();
+
+    // STEP 3: retire the redo copy
+    *redo_magic = 0;
+    flushRange(redo_magic, sizeof(uint64_t));
+    store_fence();
+
+    // STEP 4: update the persisted header in memory
+    m_persMetaHeader = *pShadowHeader;
+}
+
+const string& DaxPersistLog::replayMetaRedo(const string& name, const string& dataPath) {
+    const string metaFile = dataPath + "/" + name + "." + META_FILE_SUFFIX;
+    int fd = open(metaFile.c_str(), O_RDWR);
+    if(fd == -1) {
+        // a new log has nothing to recover
+        return dataPath;
+    }
+    MetaHeader headers[2];
+    if(pread(fd, headers, sizeof(headers), 0) == sizeof(headers)
+       && *redo_magic_of(&headers[1]) == DAX_META_REDO_MAGIC) {
+        dbg_warn(PersistLogger::get(), "{0}: completing an interrupted meta header update.", metaFile);
+        headers[0].fields = headers[1].fields;
+        *redo_magic_of(&headers[1]) = 0;
+        if(pwrite(fd, &headers[0], sizeof(MetaHeader), 0) != sizeof(MetaHeader) || fsync(fd) != 0
+           || pwrite(fd, &headers[1], sizeof(MetaHeader), sizeof(MetaHeader)) != sizeof(MetaHeader) || fsync(fd) != 0) {
+            int error = errno;
+            close(fd);
+            throw persistent_file_error("Failed to replay meta header.", error);
+        }
+    }
+    close(fd);
+    return dataPath;
+}
+
+const uint64_t DaxPersistLog::getMinimumLatestPersistedVersion(const std::string& prefix) {
+    const string dataPath = getPersDaxPath();
+    // Finish any interrupted header updates first, so that the headers read below are complete
+    DIR* dir = opendir(dataPath.c_str());
+    if(dir != NULL) {
+        const string suffix = string(".") + META_FILE_SUFFIX;
+        struct dirent* dent;
+        while((dent = readdir(dir)) != NULL) {
+            const string file_name(dent->d_name);
+            if(file_name.length() > prefix.length() + suffix.length()
+               && file_name.compare(0, prefix.length(), prefix) == 0
+               && file_name.compare(file_name.length() - suffix.length(), suffix.length(), suffix) == 0) {
+                replayMetaRedo(file_name.substr(0, file_name.length() - suffix.length()), dataPath);
+            }
+        }
+        closedir(dir);
+    }
+    return FilePersistLog::getMinimumLatestPersistedVersion(prefix, dataPath);
+}
+
+}  // namespace persistent
@@ -0,0 +1,348 @@
+#include "derecho/persistent/detail/DeltaKeyIndex.hpp"
+
+#include "derecho/persistent/PersistException.hpp"
+#include "derecho/persistent/detail/FilePersistLog.hpp"
+#include "derecho/persistent/detail/LogEntryRange.hpp"
+#include "derecho/persistent/detail/logger.hpp"
+
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits>
+#include <map>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace persistent {
+
+/*
+ * The index file is a sequence of records, one for each indexed log entry in
+ * log order: the entry's version and entry number, the number of keys it
+ * updated, then each key as a 32-bit length followed by its bytes. A
+ * truncation of the log is recorded as a header alone, with TRUNCATE_RECORD
+ * as the number of keys, the version the log was truncated to, and the entry
+ * number of the next entry to index.
+ */
+struct KeyIndexRecordHeader {
+    int64_t ver;
+    int64_t idx;
+    uint32_t num_keys;
+} __attribute__((packed));
+
+static constexpr uint32_t TRUNCATE_RECORD = UINT32_MAX;
+
+static void append_record(std::vector<uint8_t>& buf, version_t ver, int64_t idx,
+                          const std::vector<const std::string*>& keys) {
+    const KeyIndexRecordHeader header{ver, idx, static_cast<uint32_t>(keys.size())};
+    const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+    buf.insert(buf.end(), header_bytes, header_bytes + sizeof(header));
+    for(const std::string* key : keys) {
+        const uint32_t len = key->size();
+        const uint8_t* len_bytes = reinterpret_cast<const uint8_t*>(&len);
+        buf.insert(buf.end(), len_bytes, len_bytes + sizeof(len));
+        buf.insert(buf.end(), key->begin(), key->end());
+    }
+}
+
+static void write_fully(int fd, const std::vector<uint8_t>& buf) {
+    std::size_t written = 0;
+    while(written < buf.size()) {
+        ssize_t n = write(fd, buf.data() + written, buf.size() - written);
+        if(n < 0) {
+            if(errno == EINTR) {
+                continue;
+            }
+            throw persistent_file_error("Failed to write key index file.", errno);
+        }
+        written += n;
+    }
+}
+
+DeltaKeyIndex::DeltaKeyIndex(PersistLog* log, const DeltaKeyExtractor& extractor)
+        : m_pLog(log),
+          m_extractor(extractor),
+          m_sIndexFile(log->getAuxiliaryFilePath(KEY_INDEX_FILE_SUFFIX)),
+          m_iIndexFileDesc(-1),
+          m_iNextIndex(0),
+          m_iCompactedIndex(std::max<int64_t>(log->getEarliestIndex(), 0)),
+          m_logger(PersistLogger::get()) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    if(!m_sIndexFile.empty()) {
+        m_iIndexFileDesc = open(m_sIndexFile.c_str(), O_RDWR | O_CREAT | O_APPEND, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+        if(m_iIndexFileDesc == -1) {
+            throw persistent_file_error("Failed to open key index file.", errno);
+        }
+        load();
+    }
+    catchUp();
+}
+
+DeltaKeyIndex::~DeltaKeyIndex() noexcept(true) {
+    if(m_iIndexFileDesc != -1) {
+        close(m_iIndexFileDesc);
+    }
+}
+
+void DeltaKeyIndex::load() {
+    struct stat st;
+    if(fstat(m_iIndexFileDesc, &st) != 0) {
+        throw persistent_file_error("Failed to stat key index file.", errno);
+    }
+    std::vector<uint8_t> buf(st.st_size);
+    std::size_t nread = 0;
+    while(nread < buf.size()) {
+        ssize_t n = pread(m_iIndexFileDesc, buf.data() + nread, buf.size() - nread, nread);
+        if(n <= 0) {
+            if(n < 0 && errno == EINTR) {
+                continue;
+            }
+            throw persistent_file_error("Failed to read key index file.", errno);
+        }
+        nread += n;
+    }
+
+    // parse the records, stopping at a torn one
+    struct ParsedRecord {
+        KeyIndexRecordHeader header;
+        std::vector<std::string> keys;
+        std::size_t end_ofst;
+    };
+    std::vector<ParsedRecord> records;
+    std::size_t ofst = 0;
+    while(ofst + sizeof(KeyIndexRecordHeader) <= buf.size()) {
+        ParsedRecord record;
+        memcpy(&record.header, buf.data() + ofst, sizeof(record.header));
+        std::size_t rec_ofst = ofst + sizeof(record.header);
+        const uint32_t num_keys = record.header.num_keys == TRUNCATE_RECORD ? 0 : record.header.num_keys;
+        for(uint32_t i = 0; i < num_keys && rec_ofst + sizeof(uint32_t) <= buf.size(); i++) {
+            uint32_t len;
+            memcpy(&len, buf.data() + rec_ofst, sizeof(len));
+            rec_ofst += sizeof(len);
+            if(rec_ofst + len > buf.size()) {
+                break;
+            }
+            record.keys.emplace_back(reinterpret_cast<const char*>(buf.data() + rec_ofst), len);
+            rec_ofst += len;
+        }
+        if(record.keys.size() != num_keys) {
+            break;
+        }
+        record.end_ofst = rec_ofst;
+        records.emplace_back(std::move(record));
+        ofst = rec_ofst;
+    }
+    // a record newer than a later truncation was truncated from the log, so it
+    // must not be checked against the entry that took its place
+    std::vector<bool> truncated(records.size());
+    version_t truncated_after = std::numeric_limits<version_t>::max();
+    for(std::size_t i = records.size(); i-- > 0;) {
+        if(records[i].header.num_keys == TRUNCATE_RECORD) {
+            truncated_after = std::min(truncated_after, static_cast<version_t>(records[i].header.ver));
+        } else {
+            truncated[i] = records[i].header.ver > truncated_after;
+        }
+    }
+
+    const int64_t earliest = m_pLog->getEarliestIndex();
+    const int64_t latest = m_pLog->getLatestIndex();
+    std::size_t valid_len = 0;
+    for(std::size_t i = 0; i < records.size() && earliest != INVALID_INDEX; i++) {
+        const KeyIndexRecordHeader& header = records[i].header;
+        if(header.num_keys == TRUNCATE_RECORD) {
+            m_iNextIndex = std::min(m_iNextIndex, static_cast<int64_t>(header.idx));
+        } else if(!truncated[i]) {
+            // records of trimmed entries stay in the file until it is compacted
+            m_iCompactedIndex = std::min(m_iCompactedIndex, static_cast<int64_t>(header.idx));
+            if(header.idx >= earliest) {
+                // keep records only as long as they match the log entry by entry
+                if(header.idx != std::max(m_iNextIndex, earliest) || header.idx > latest
+                   || m_pLog->getVersionByIndex(header.idx) != header.ver) {
+                    break;
+                }
+                for(auto& key : records[i].keys) {
+                    m_postings[std::move(key)].emplace_back(static_cast<version_t>(header.ver), static_cast<int64_t>(header.idx));
+                }
+                m_iNextIndex = header.idx + 1;
+            }
+        }
+        valid_len = records[i].end_ofst;
+    }
+    if(valid_len < buf.size()) {
+        dbg_info(m_logger, "{0}: discarding {1} bytes of stale key index records.", m_sIndexFile, buf.size() - valid_len);
+        if(ftruncate(m_iIndexFileDesc, valid_len) != 0) {
+            throw persistent_file_error("Failed to truncate key index file.", errno);
+        }
+    }
+}
+
+void DeltaKeyIndex::catchUp() {
+    const int64_t latest = m_pLog->getLatestIndex();
+    if(latest == INVALID_INDEX || latest < m_iNextIndex) {
+        return;
+    }
+    const int64_t first = std::max(m_iNextIndex, m_pLog->getEarliestIndex());
+    std::vector<uint8_t> records;
+    std::vector<const std::string*> key_ptrs;
+    for(const LogEntryView& entry : LogEntryRange(m_pLog, first, latest, false)) {
+        std::vector<std::string> keys = m_extractor(static_cast<const uint8_t*>(entry.data), entry.size);
+        key_ptrs.clear();
+        for(auto& key : keys) {
+            key_ptrs.push_back(&key);
+        }
+        if(m_iIndexFileDesc != -1) {
+            append_record(records, entry.version, entry.index, key_ptrs);
+        }
+        for(auto& key : keys) {
+            m_postings[std::move(key)].emplace_back(entry.version, entry.index);
+        }
+        m_iNextIndex = entry.index + 1;
+    }
+    if(m_iIndexFileDesc != -1) {
+        write_fully(m_iIndexFileDesc, records);
+    }
+}
+
+void DeltaKeyIndex::dropAfter(version_t ver) {
+    for(auto it = m_postings.begin(); it != m_postings.end();) {
+        auto& postings = it->second;
+        while(!postings.empty() && postings.back().first > ver) {
+            postings.pop_back();
+        }
+        it = postings.empty() ? m_postings.erase(it) : std::next(it);
+    }
+}
+
+void DeltaKeyIndex::compact() {
+    const int64_t earliest = m_pLog->getEarliestIndex();
+    for(auto it = m_postings.begin(); it != m_postings.end();) {
+        auto& postings = it->second;
+        if(earliest == INVALID_INDEX) {
+            postings.clear();
+        } else {
+            postings.erase(postings.begin(),
+                           std::lower_bound(postings.begin(), postings.end(), earliest,
+                                            [](const std::pair<version_t, int64_t>& posting, int64_t idx) {
+                                                return posting.second < idx;
+                                            }));
+        }
+        it = postings.empty() ? m_postings.erase(it) : std::next(it);
+    }
+    m_iCompactedIndex = (earliest == INVALID_INDEX) ? m_iNextIndex : earliest;
+    if(m_sIndexFile.empty()) {
+        return;
+    }
+    // invert the postings to list the keys of each indexed entry
+    std::map<int64_t, std::vector<const std::string*>> entry_keys;
+    for(const auto& [key, postings] : m_postings) {
+        for(const auto& posting : postings) {
+            entry_keys[posting.second].push_back(&key);
+        }
+    }
+    std::vector<uint8_t> records;
+    if(earliest != INVALID_INDEX && earliest < m_iNextIndex) {
+        const std::vector<const std::string*> no_keys;
+        for(const LogEntryView& entry : LogEntryRange(m_pLog, earliest, m_iNextIndex - 1, false)) {
+            auto keys = entry_keys.find(entry.index);
+            append_record(records, entry.version, entry.index, keys == entry_keys.end() ? no_keys : keys->second);
+        }
+    }
+
+    const std::string swp_file = m_sIndexFile + "." + SWAP_FILE_SUFFIX;
+    int fd = open(swp_file.c_str(), O_RDWR | O_CREAT | O_TRUNC, S_IWUSR | S_IRUSR | S_IRGRP | S_IWGRP | S_IROTH);
+    if(fd == -1) {
+        throw persistent_file_error("Failed to open file.", errno);
+    }
+    try {
+        write_fully(fd, records);
+    } catch(persistent_file_error&) {
+        close(fd);
+        throw;
+    }
+    if(fdatasync(fd) != 0) {
+        close(fd);
+        throw persistent_file_error("Failed to sync key index file.", errno);
+    }
+    close(fd);
+    if(rename(swp_file.c_str(), m_sIndexFile.c_str()) != 0) {
+        throw persistent_file_error("Failed to rename file.", errno);
+    }
+    close(m_iIndexFileDesc);
+    m_iIndexFileDesc = open(m_sIndexFile.c_str(), O_RDWR | O_APPEND);
+    if(m_iIndexFileDesc == -1) {
+        throw persistent_file_error("Failed to open key index file.", errno);
+    }
+}
+
+std::pair<version_t, int64_t> DeltaKeyIndex::lookup(const std::string& key, version_t ver) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    catchUp();
+    auto postings = m_postings.find(key);
+    if(postings == m_postings.end()) {
+        return {INVALID_VERSION, INVALID_INDEX};
+    }
+    auto it = std::upper_bound(postings->second.begin(), postings->second.end(), ver,
+                               [](version_t v, const std::pair<version_t, int64_t>& posting) {
+                                   return v < posting.first;
+                               });
+    if(it == postings->second.begin()) {
+        return {INVALID_VERSION, INVALID_INDEX};
+    }
+    --it;
+    const int64_t earliest = m_pLog->getEarliestIndex();
+    if(earliest == INVALID_INDEX || it->second < earliest) {
+        return {INVALID_VERSION, INVALID_INDEX};
+    }
+    return *it;
+}
+
+std::vector<version_t> DeltaKeyIndex::getKeyVersions(const std::string& key) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    catchUp();
+    std::vector<version_t> versions;
+    auto postings = m_postings.find(key);
+    if(postings != m_postings.end()) {
+        const int64_t earliest = m_pLog->getEarliestIndex();
+        for(const auto& posting : postings->second) {
+            if(earliest != INVALID_INDEX && posting.second >= earliest) {
+                versions.push_back(posting.first);
+            }
+        }
+    }
+    return versions;
+}
+
+void DeltaKeyIndex::persist() {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    catchUp();
+    if(m_iIndexFileDesc != -1 && fdatasync(m_iIndexFileDesc) != 0) {
+        throw persistent_file_error("Failed to sync key index file.", errno);
+    }
+}
+
+void DeltaKeyIndex::truncate(version_t ver) {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    dropAfter(ver);
+    const int64_t latest = m_pLog->getLatestIndex();
+    m_iNextIndex = (latest == INVALID_INDEX) ? 0 : std::min(m_iNextIndex, latest + 1);
+    m_iCompactedIndex = std::min(m_iCompactedIndex, m_iNextIndex);
+    if(m_iIndexFileDesc != -1) {
+        const KeyIndexRecordHeader header{ver, m_iNextIndex, TRUNCATE_RECORD};
+        const uint8_t* header_bytes = reinterpret_cast<const uint8_t*>(&header);
+        write_fully(m_iIndexFileDesc, std::vector<uint8_t>(header_bytes, header_bytes + sizeof(header)));
+    }
+}
+
+void DeltaKeyIndex::trim() {
+    std::lock_guard<std::mutex> lck(m_mutex);
+    // Lookups skip the postings of trimmed entries, so they are only dropped
+    // once there are more of them than live ones, which keeps trimming O(1)
+    // amortized per entry
+    const int64_t earliest = m_pLog->getEarliestIndex();
+    if(earliest == INVALID_INDEX
+       || earliest - m_iCompactedIndex > std::max<int64_t>(m_iNextIndex - earliest, 0)) {
+        compact();
+    }
+}
+
+}  // namespace persistent
@@ -4,15 +4,21 @@
 #include "derecho/persistent/detail/util.hpp"
 #include "derecho/persistent/detail/logger.hpp"
 #include "derecho/persistent/PersistException.hpp"
+#include "derecho/utils/placement.hpp"
 
+#include <algorithm>
+#include <condition_variable>
 #include <dirent.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <iostream>
+#include <mutex>
+#include <set>
 #include <string.h>
 #include <string>
 #include <sys/mman.h>
 #include <sys/stat.h>
+#include <thread>
 #include <unistd.h>
 
 #if __GNUC__ > 7
@@ -31,6 +37,119 @@ namespace persistent {
 // internal structures //
 /////////////////////////
 
+/**
+ * Allocates disk blocks for [ofst, ofst + len) of a ring buffer file of
+ * ring_size bytes, wrapping around the end of the file. File systems that do
+ * not support fallocate are left to allocate blocks on demand.
+ */
+static void allocate_ring_range(int fd, uint64_t ring_size, uint64_t ofst, uint64_t len) {
+    ofst %= ring_size;
+    while(len > 0) {
+        const uint64_t chunk = std::min(len, ring_size - ofst);
+        if(fallocate(fd, 0, ofst, chunk) != 0) {
+            if(errno == EOPNOTSUPP) {
+                return;
+            }
+            throw persistent_file_error("fallocate failed.", errno);
+        }
+        len -= chunk;
+        ofst = 0;
+    }
+}
+
+/**
+ * Faults [addr, addr + len) of a shared file mapping in for writing, without
+ * changing its contents.
+ */
+static void populate_range(void* addr, uint64_t len) {
+    uint8_t* start = static_cast<uint8_t*>(ALIGN_TO_PAGE(addr));
+    len += static_cast<uint8_t*>(addr) - start;
+#ifdef MADV_POPULATE_WRITE
+    if(madvise(start, len, MADV_POPULATE_WRITE) == 0) {
+        return;
+    }
+#endif
+    // Without MADV_POPULATE_WRITE, write-fault each page with an atomic add of
+    // zero, which is safe even if an append is writing to the same page
+    for(uint64_t page_ofst = 0; page_ofst < len; page_ofst += PAGE_SIZE) {
+        __atomic_fetch_add(start + page_ofst, 0, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * The background thread that prewarms the rings of every FilePersistLog with
+ * PERS/prewarm_bytes set. It sleeps until a log is added or an append finds
+ * that the tail is halfway through the prewarmed part of its data ring. It is
+ * never destroyed, since logs with static storage duration may still remove
+ * themselves from it while the process exits.
+ */
+class LogPrewarmer {
+    std::mutex logs_mutex;
+    std::condition_variable logs_cv;
+    std::set<FilePersistLog*> logs;
+    bool work_pending = false;
+    // held while logs are being prewarmed, so remove() can wait for that to finish
+    std::mutex prewarm_mutex;
+    std::thread prewarm_thread;
+
+    LogPrewarmer() : prewarm_thread(&LogPrewarmer::prewarm_loop, this) {}
+    void prewarm_loop();
+
+public:
+    static LogPrewarmer& get() {
+        //Deliberately leaked, so that its thread is never destroyed while it runs
+        static LogPrewarmer* prewarmer = new LogPrewarmer();
+        return *prewarmer;
+    }
+
+    void add(FilePersistLog* log) {
+        {
+            std::lock_guard<std::mutex> lock(logs_mutex);
+            logs.insert(log);
+            work_pending = true;
+        }
+        logs_cv.notify_one();
+    }
+
+    void remove(FilePersistLog* log) {
+        {
+            std::lock_guard<std::mutex> lock(logs_mutex);
+            logs.erase(log);
+        }
+        std::lock_guard<std::mutex> prewarm_lock(prewarm_mutex);
+    }
+
+    void notify() {
+        {
+            std::lock_guard<std::mutex> lock(logs_mutex);
+            work_pending = true;
+        }
+        logs_cv.notify_one();
+    }
+};
+
+void LogPrewarmer::prewarm_loop() {
+    pthread_setname_np(pthread_self(), "log_prewarm");
+    derecho::pin_thread("log_prewarm");
+    std::unique_lock<std::mutex> lock(logs_mutex);
+    while(true) {
+        logs_cv.wait(lock, [this]() { return work_pending; });
+        work_pending = false;
+        std::lock_guard<std::mutex> prewarm_lock(prewarm_mutex);
+        std::vector<FilePersistLog*> logs_to_prewarm(logs.begin(), logs.end());
+        // appends must not wait on logs_mutex while the file system works
+        lock.unlock();
+        for(FilePersistLog* log : logs_to_prewarm) {
+            try {
+                log->prewarm();
+            } catch(std::exception& e) {
+                dbg_warn(PersistLogger::get(), "Failed to prewarm a log: {}", e.what());
+            }
+        }
+        lock.lock();
+    }
+}
+
 ////////////////////////
 // visible to outside //
 ////////////////////////
@@ -47,7 +166,10 @@ FilePersistLog::FilePersistLog(const string& name, const string& dataPath, bool
           m_iLogFileDesc(-1),
           m_iDataFileDesc(-1),
           m_pLog(MAP_FAILED),
-          m_pData(MAP_FAILED) {
+          m_pData(MAP_FAILED),
+          m_iPrewarmBytes(derecho::getConfUInt64(derecho::Conf::PERS_PREWARM_BYTES)),
+          m_iPrewarmedOfst(0),
+          m_bLogPrewarmed(false) {
     if(pthread_rwlock_init(&this->m_rwlock, NULL) != 0) {
         throw persistent_lock_error("rwlock_init failed", errno);
     }
@@ -60,6 +182,7 @@ FilePersistLog::FilePersistLog(const string& name, const string& dataPath, bool
     }
     load();
     dbg_trace(m_logger, "{0} constructor: after load()", name);
+    startPrewarming();
 }
 
 void FilePersistLog::reset() {
@@ -100,6 +223,12 @@ void FilePersistLog::load() {
     if(this->m_iDataFileDesc == -1) {
         throw persistent_file_error("Failed to open file.", errno);
     }
+    //// allocate the files on disk up front, so appends never wait for block allocation
+    if(derecho::getConfBoolean(derecho::Conf::PERS_PREALLOCATE)) {
+        allocate_ring_range(this->m_iLogFileDesc, MAX_LOG_SIZE, 0, MAX_LOG_SIZE);
+        allocate_ring_range(this->m_iDataFileDesc, MAX_DATA_SIZE, 0, MAX_DATA_SIZE);
+        dbg_trace(m_logger, "{0}:log and data files preallocated.", this->m_sName);
+    }
     // STEP 3: mmap to memory
     //// we map the log entry and data twice to faciliate the search and data
     //// retrieving then the data is rewinding across the buffer end as follow:
@@ -198,6 +327,7 @@ void FilePersistLog::load() {
 }
 
 FilePersistLog::~FilePersistLog() noexcept(true) {
+    stopPrewarming();
     pthread_rwlock_destroy(&this->m_rwlock);
     pthread_mutex_destroy(&this->m_perslock);
     if(this->m_pData != MAP_FAILED) {
@@ -216,7 +346,115 @@ FilePersistLog::~FilePersistLog() noexcept(true) {
     }
 }
 
-inline void FilePersistLog::do_append_validation(const uint64_t size, const int64_t ver) {
+uint64_t FilePersistLog::nextFreeDataOffset() {
+    uint64_t ofst = NEXT_DATA_OFST;
+    if(!m_placements.empty()) {
+        // placements are reserved in increasing offset order
+        ofst = std::max(ofst, m_placements.back().first + m_placements.back().second);
+    }
+    return ofst;
+}
+
+uint64_t FilePersistLog::numFreeDataBytes() {
+    const uint64_t next_ofst = nextFreeDataOffset();
+    uint64_t start_ofst = next_ofst;
+    if(NUM_USED_SLOTS > 0) {
+        start_ofst = LOG_ENTRY_AT(m_currMetaHeader.fields.head)->fields.ofst;
+    }
+    if(!m_placements.empty()) {
+        start_ofst = std::min(start_ofst, m_placements.front().first);
+    }
+    return MAX_DATA_SIZE - (next_ofst - start_ofst);
+}
+
+std::deque<std::pair<uint64_t, uint64_t>>::iterator FilePersistLog::findPlacement(const void* pdata, uint64_t size) {
+    const uint8_t* data = static_cast<const uint8_t*>(pdata);
+    for(auto placement = m_placements.begin(); placement != m_placements.end(); ++placement) {
+        const uint8_t* region = static_cast<const uint8_t*>(m_pData) + placement->first % MAX_DATA_SIZE;
+        if(data >= region && data + size <= region + placement->second) {
+            // An entry can only be recorded in place if it comes after the last entry
+            if(placement->first + (data - region) < static_cast<uint64_t>(NEXT_DATA_OFST)) {
+                return m_placements.end();
+            }
+            return placement;
+        }
+    }
+    return m_placements.end();
+}
+
+void* FilePersistLog::reservePlacement(uint64_t size) {
+    // Entries with signatures need room for the signature in front of the data
+    if(signature_size > 0) {
+        return nullptr;
+    }
+    FPL_WRLOCK;
+    if(numFreeDataBytes() < size) {
+        FPL_UNLOCK;
+        dbg_debug(m_logger, "{0} reservePlacement: no room for {1} bytes", this->m_sName, size);
+        return nullptr;
+    }
+    const uint64_t ofst = nextFreeDataOffset();
+    m_placements.emplace_back(ofst, size);
+    FPL_UNLOCK;
+    dbg_trace(m_logger, "{0} reserved {1} bytes for placement at offset {2}", this->m_sName, size, ofst);
+    // The data ring is mapped twice, so the region is contiguous even if it wraps around
+    return static_cast<uint8_t*>(m_pData) + ofst % MAX_DATA_SIZE;
+}
+
+void FilePersistLog::releasePlacement(const void* region) {
+    FPL_WRLOCK;
+    for(auto placement = m_placements.begin(); placement != m_placements.end(); ++placement) {
+        if(static_cast<const uint8_t*>(m_pData) + placement->first % MAX_DATA_SIZE == region) {
+            m_placements.erase(placement);
+            break;
+        }
+    }
+    FPL_UNLOCK;
+}
+
+std::pair<void*, uint64_t> FilePersistLog::getPlacementRegion() {
+    return {m_pData, MAX_DATA_SIZE << 1};
+}
+
+void FilePersistLog::startPrewarming() {
+    if(m_iPrewarmBytes == 0) {
+        return;
+    }
+    m_iPrewarmedOfst = 0;
+    m_bLogPrewarmed = false;
+    LogPrewarmer::get().add(this);
+}
+
+void FilePersistLog::stopPrewarming() {
+    if(m_iPrewarmBytes > 0) {
+        LogPrewarmer::get().remove(this);
+    }
+}
+
+void FilePersistLog::prewarm() {
+    if(!m_bLogPrewarmed) {
+        // the log entry ring is comparatively small, so it is prewarmed all at once
+        allocate_ring_range(this->m_iLogFileDesc, MAX_LOG_SIZE, 0, MAX_LOG_SIZE);
+        populate_range(this->m_pLog, MAX_LOG_SIZE);
+        m_bLogPrewarmed = true;
+        dbg_trace(m_logger, "{0} prewarmed the log entry ring.", this->m_sName);
+    }
+    FPL_RDLOCK;
+    const uint64_t tail_ofst = nextFreeDataOffset();
+    FPL_UNLOCK;
+    const uint64_t start_ofst = std::max(m_iPrewarmedOfst.load(), tail_ofst);
+    const uint64_t end_ofst = tail_ofst + std::min(m_iPrewarmBytes, MAX_DATA_SIZE);
+    if(start_ofst >= end_ofst) {
+        return;
+    }
+    allocate_ring_range(this->m_iDataFileDesc, MAX_DATA_SIZE, start_ofst, end_ofst - start_ofst);
+    // The data ring is mapped twice, so the range is contiguous even if it wraps around
+    populate_range(static_cast<uint8_t*>(m_pData) + start_ofst % MAX_DATA_SIZE, end_ofst - start_ofst);
+    m_iPrewarmedOfst = end_ofst;
+    dbg_trace(m_logger, "{0} prewarmed the data ring up to offset {1}.", this->m_sName, end_ofst);
+}
+
+inline void FilePersistLog::do_append_validation(const uint64_t size, const int64_t ver, bool in_place) {
     if(NUM_FREE_SLOTS < 1) {
         dbg_error(m_logger, "{0}-append exception no free slots in log! NUM_FREE_SLOTS={1}",
                   this->m_sName, NUM_FREE_SLOTS);
@@ -225,12 +463,13 @@ inline void FilePersistLog::do_append_validation(const uint64_t size, const int6
         std::cerr << "No space in log: FREESLOT=" << NUM_FREE_SLOTS << ",version=" << ver << std::endl;
         throw persistent_log_full("No free slots in the log.");
     }
-    if(NUM_FREE_BYTES < (signature_size + size)) {
-        dbg_error(m_logger, "{0}-append exception no space for data: NUM_FREE_BYTES={1}, size={2}, signature_size={3}",
-                  this->m_sName, NUM_FREE_BYTES, size, signature_size);
+    // data appended in place already has its space reserved
+    if(!in_place && numFreeDataBytes() < (signature_size + size)) {
+        dbg_error(m_logger, "{0}-append exception no space for data: free bytes={1}, size={2}, signature_size={3}",
+                  this->m_sName, numFreeDataBytes(), size, signature_size);
         dbg_flush(m_logger);
         FPL_UNLOCK;
-        std::cerr << "No space for data: FREE:" << NUM_FREE_BYTES << ",size=" << size
+        std::cerr << "No space for data: FREE:" << numFreeDataBytes() << ",size=" << size
                   << ",signature_size=" << signature_size << std::endl;
         throw persistent_log_full("Insufficient space in the log for the data.");
     }
@@ -249,24 +488,36 @@ void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, cons
     dbg_trace(m_logger, "{0} append event ({1},{2})", this->m_sName, mhlc.m_rtc_us, mhlc.m_logic);
     FPL_RDLOCK;
 
-    do_append_validation(size, ver);
+    do_append_validation(size, ver, findPlacement(pdat, size) != m_placements.end());
 
     FPL_UNLOCK;
     dbg_trace(m_logger, "{0} append:validate check1 Finished.", this->m_sName);
 
     FPL_WRLOCK;
-    do_append_validation(size, ver);
+    auto placement = findPlacement(pdat, size);
+    const bool in_place = (placement != m_placements.end());
+    do_append_validation(size, ver, in_place);
     dbg_trace(m_logger, "{0} append:validate check2 Finished.", this->m_sName);
 
-    // copy data
-    // we reserve the first 'signature_size' bytes at the beginning of NEXT_DATA.
-    memcpy(reinterpret_cast<void*>(reinterpret_cast<uint64_t>(NEXT_DATA) + signature_size), pdat, size);
-    dbg_trace(m_logger, "{0} append:data ({1} bytes) is copied to log.", this->m_sName, size);
+    uint64_t data_ofst;
+    if(in_place) {
+        // the data was written into a reserved region of the ring, so just record where it is
+        const uint8_t* region = static_cast<const uint8_t*>(m_pData) + placement->first % MAX_DATA_SIZE;
+        data_ofst = placement->first + (static_cast<const uint8_t*>(pdat) - region);
+        m_placements.erase(placement);
+        dbg_trace(m_logger, "{0} append:data ({1} bytes) is already in the log.", this->m_sName, size);
+    } else {
+        // copy data
+        // we reserve the first 'signature_size' bytes at the beginning of the entry's data.
+        data_ofst = nextFreeDataOffset();
+        memcpy(static_cast<uint8_t*>(m_pData) + data_ofst % MAX_DATA_SIZE + signature_size, pdat, size);
+        dbg_trace(m_logger, "{0} append:data ({1} bytes) is copied to log.", this->m_sName, size);
+    }
 
     // fill the log entry
     NEXT_LOG_ENTRY->fields.ver = ver;
     NEXT_LOG_ENTRY->fields.sdlen = signature_size + size;
-    NEXT_LOG_ENTRY->fields.ofst = NEXT_DATA_OFST;
+    NEXT_LOG_ENTRY->fields.ofst = data_ofst;
     NEXT_LOG_ENTRY->fields.hlc_r = mhlc.m_rtc_us;
     NEXT_LOG_ENTRY->fields.hlc_l = mhlc.m_logic;
     /* No Sync required here. */
@@ -279,7 +530,12 @@ void FilePersistLog::append(const void* pdat, uint64_t size, version_t ver, cons
     /* No sync */
     dbg_trace(m_logger, "{0} append a log ver:{1} hlc:({2},{3})", this->m_sName,
               ver, mhlc.m_rtc_us, mhlc.m_logic);
+    const uint64_t next_data_ofst = nextFreeDataOffset();
     FPL_UNLOCK;
+    // wake up the prewarming thread before the tail runs into cold pages
+    if(m_iPrewarmBytes > 0 && next_data_ofst + m_iPrewarmBytes / 2 > m_iPrewarmedOfst.load()) {
+        LogPrewarmer::get().notify();
+    }
 }
 
 void FilePersistLog::advanceVersion(version_t ver) {
@@ -540,6 +796,63 @@ const void* FilePersistLog::getEntryByIndex(int64_t eidx) {
     return LOG_ENTRY_DATA(LOG_ENTRY_AT(ridx));
 }
 
+version_t FilePersistLog::getVersionByIndex(int64_t eidx) {
+    FPL_RDLOCK;
+
+    int64_t ridx = (eidx < 0) ? (m_currMetaHeader.fields.tail + eidx) : eidx;
+
+    if(m_currMetaHeader.fields.tail <= ridx || ridx < m_currMetaHeader.fields.head) {
+        FPL_UNLOCK;
+        throw persistent_invalid_index(eidx);
+    }
+    version_t ver = LOG_ENTRY_AT(ridx)->fields.ver;
+    FPL_UNLOCK;
+
+    return ver;
+}
+
+std::size_t FilePersistLog::getEntryViews(int64_t eidx, std::size_t count, bool reverse, LogEntryView* views) {
+    std::size_t num_views = 0;
+    FPL_RDLOCK;
+    for(int64_t idx = eidx;
+        num_views < count && idx >= m_currMetaHeader.fields.head && idx < m_currMetaHeader.fields.tail;
+        idx += (reverse ? -1 : 1)) {
+        const LogEntry* ple = LOG_ENTRY_AT(idx);
+        views[num_views++] = {idx, ple->fields.ver, HLC{ple->fields.hlc_r, ple->fields.hlc_l},
+                              LOG_ENTRY_DATA(ple), ple->fields.sdlen - this->signature_size};
+    }
+    FPL_UNLOCK;
+    return num_views;
+}
+
+void FilePersistLog::readahead(int64_t from_eidx, int64_t to_eidx) {
+    if(from_eidx > to_eidx) {
+        std::swap(from_eidx, to_eidx);
+    }
+    FPL_RDLOCK;
+    from_eidx = MAX(from_eidx, m_currMetaHeader.fields.head);
+    to_eidx = MIN(to_eidx, m_currMetaHeader.fields.tail - 1);
+    if(from_eidx > to_eidx) {
+        FPL_UNLOCK;
+        return;
+    }
+    const LogEntry* first = LOG_ENTRY_AT(from_eidx);
+    const LogEntry* last = LOG_ENTRY_AT(to_eidx);
+    // Both rings are mapped twice back to back, so each range is contiguous
+    // from its first byte even if it wraps around.
+    void* log_start = ALIGN_TO_PAGE(first);
+    uint64_t log_len = reinterpret_cast<uint64_t>(first) - reinterpret_cast<uint64_t>(log_start)
+                       + (to_eidx - from_eidx + 1) * sizeof(LogEntry);
+    void* data_start = ALIGN_TO_PAGE(LOG_ENTRY_SIGNATURE(first));
+    uint64_t data_len = reinterpret_cast<uint64_t>(LOG_ENTRY_SIGNATURE(first)) - reinterpret_cast<uint64_t>(data_start)
+                        + last->fields.ofst + last->fields.sdlen - first->fields.ofst;
+    FPL_UNLOCK;
+
+    if(madvise(log_start, log_len, MADV_WILLNEED) != 0 || madvise(data_start, data_len, MADV_WILLNEED) != 0) {
+        dbg_debug(m_logger, "{0} readahead of entries {1} to {2} failed: {3}", this->m_sName, from_eidx, to_eidx, strerror(errno));
+    }
+}
+
 const void* FilePersistLog::getEntry(version_t ver, bool exact) {
     LogEntry* ple = nullptr;
 
@@ -991,8 +1304,12 @@ void FilePersistLog::truncate(version_t ver) {
 }
 
 const uint64_t FilePersistLog::getMinimumLatestPersistedVersion(const std::string& prefix) {
+    return getMinimumLatestPersistedVersion(prefix, getPersFilePath());
+}
+
+const uint64_t FilePersistLog::getMinimumLatestPersistedVersion(const std::string& prefix, const std::string& dataPath) {
     // STEP 1: list all meta files in the path
-    DIR* dir = opendir(getPersFilePath().c_str());
+    DIR* dir = opendir(dataPath.c_str());
     if(dir == NULL) {
         // We cannot open the persistent directory, so just return error.
         dbg_error(PersistLogger::get(), "{}:{} failed to open the directory. errno={}, err={}.",
@@ -1008,7 +1325,7 @@ const uint64_t FilePersistLog::getMinimumLatestPersistedVersion(const std::strin
         if(name_len > prefix.length() && strncmp(prefix.c_str(), dent->d_name, prefix.length()) == 0 && strncmp("." META_FILE_SUFFIX, dent->d_name + name_len - strlen(META_FILE_SUFFIX) - 1, strlen(META_FILE_SUFFIX) + 1) == 0) {
             MetaHeader mh;
             char fn[1024];
-            sprintf(fn, "%s/%s", getPersFilePath().c_str(), dent->d_name);
+            sprintf(fn, "%s/%s", dataPath.c_str(), dent->d_name);
             int fd = open(fn, O_RDONLY);
             if(fd < 0) {
                 dbg_warn(PersistLogger::get(), "{}:{} cannot read file:{}, errno={}, err={}.",
@@ -0,0 +1,134 @@
+#include "derecho/persistent/detail/LogEntryRange.hpp"
+
+#include <algorithm>
+
+namespace persistent {
+
+LogEntryRange::iterator::iterator()
+        : m_pLog(nullptr),
+          m_iNextIndex(0),
+          m_iLastIndex(0),
+          m_bReverse(false),
+          m_iBatchLength(0),
+          m_iPos(0) {}
+
+LogEntryRange::iterator::iterator(PersistLog* log, int64_t first_index, int64_t last_index, bool reverse)
+        : m_pLog(log),
+          m_iNextIndex(first_index),
+          m_iLastIndex(last_index),
+          m_bReverse(reverse),
+          m_batch(BATCH_SIZE),
+          m_iBatchLength(0),
+          m_iPos(0) {
+    fetch();
+}
+
+void LogEntryRange::iterator::fetch() {
+    m_iPos = 0;
+    m_iBatchLength = 0;
+    const int64_t remaining = m_bReverse ? (m_iNextIndex - m_iLastIndex + 1) : (m_iLastIndex - m_iNextIndex + 1);
+    if(remaining <= 0) {
+        return;
+    }
+    const std::size_t count = std::min(static_cast<int64_t>(BATCH_SIZE), remaining);
+    m_iBatchLength = m_pLog->getEntryViews(m_iNextIndex, count, m_bReverse, m_batch.data());
+    if(m_iBatchLength < count) {
+        // the range has been trimmed or truncated under us
+        m_iNextIndex = m_bReverse ? m_iLastIndex - 1 : m_iLastIndex + 1;
+        return;
+    }
+    m_iNextIndex += m_bReverse ? -static_cast<int64_t>(count) : static_cast<int64_t>(count);
+    if(remaining > static_cast<int64_t>(count)) {
+        const int64_t ahead = std::min(static_cast<int64_t>(BATCH_SIZE), remaining - static_cast<int64_t>(count)) - 1;
+        m_pLog->readahead(m_iNextIndex, m_bReverse ? m_iNextIndex - ahead : m_iNextIndex + ahead);
+    }
+}
+
+LogEntryRange::iterator& LogEntryRange::iterator::operator++() {
+    if(++m_iPos >= m_iBatchLength) {
+        fetch();
+    }
+    return *this;
+}
+
+bool LogEntryRange::iterator::operator==(const iterator& other) const {
+    const bool at_end = (m_iPos >= m_iBatchLength);
+    const bool other_at_end = (other.m_iPos >= other.m_iBatchLength);
+    if(at_end || other_at_end) {
+        return at_end == other_at_end;
+    }
+    return m_pLog == other.m_pLog && (**this).index == (*other).index;
+}
+
+LogEntryRange::LogEntryRange(PersistLog* log, int64_t low_index, int64_t high_index, bool reverse)
+        : m_pLog(log),
+          m_iLowIndex(low_index),
+          m_iHighIndex(high_index),
+          m_bReverse(reverse) {}
+
+LogEntryRange::iterator LogEntryRange::begin() const {
+    if(empty()) {
+        return iterator();
+    }
+    return m_bReverse ? iterator(m_pLog, m_iHighIndex, m_iLowIndex, true)
+                      : iterator(m_pLog, m_iLowIndex, m_iHighIndex, false);
+}
+
+LogEntryRange::iterator LogEntryRange::end() const {
+    return iterator();
+}
+
+std::vector<LogEntryRange> LogEntryRange::split(std::size_t num_parts) const {
+    std::vector<LogEntryRange> parts;
+    const int64_t length = size();
+    if(num_parts == 0 || length == 0) {
+        return parts;
+    }
+    num_parts = std::min(num_parts, static_cast<std::size_t>(length));
+    int64_t low = m_iLowIndex;
+    for(std::size_t i = 0; i < num_parts; i++) {
+        // spread the remainder over the first parts
+        const int64_t part_length = length / num_parts + (static_cast<int64_t>(i) < length % static_cast<int64_t>(num_parts) ? 1 : 0);
+        parts.emplace_back(m_pLog, low, low + part_length - 1, m_bReverse);
+        low += part_length;
+    }
+    if(m_bReverse) {
+        std::reverse(parts.begin(), parts.end());
+    }
+    return parts;
+}
+
+LogEntryRange LogEntryRange::byVersion(PersistLog* log, version_t from, version_t to, bool reverse) {
+    int64_t high_index = log->getVersionIndex(to);
+    if(from > to || high_index == INVALID_INDEX) {
+        return LogEntryRange(log, 0, -1, reverse);
+    }
+    int64_t low_index = log->getVersionIndex(from);
+    if(low_index == INVALID_INDEX) {
+        // every entry is newer than 'from'
+        low_index = log->getEarliestIndex();
+    } else if(log->getVersionByIndex(low_index) < from) {
+        low_index++;
+    }
+    return LogEntryRange(log, low_index, high_index, reverse);
+}
+
+LogEntryRange LogEntryRange::byHLC(PersistLog* log, const HLC& from, const HLC& to, bool reverse) {
+    int64_t high_index = log->getHLCIndex(to);
+    if(from > to || high_index == INVALID_INDEX) {
+        return LogEntryRange(log, 0, -1, reverse);
+    }
+    int64_t low_index = log->getHLCIndex(from);
+    if(low_index == INVALID_INDEX) {
+        // every entry is newer than 'from'
+        low_index = log->getEarliestIndex();
+    } else {
+        LogEntryView view;
+        if(log->getEntryViews(low_index, 1, false, &view) == 1 && view.hlc < from) {
+            low_index++;
+        }
+    }
+    return LogEntryRange(log, low_index, high_index, reverse);
+}
+
+}  // namespace persistent
@@ -196,6 +196,21 @@ void PersistentRegistry::truncate(version_t last_version) {
     }
 }
 
+PersistLog* PersistentRegistry::getPlacementLog() {
+    PersistLog* placement_log = nullptr;
+    for(auto& entry : m_registry) {
+        PersistLog* field_log = entry.second->getPlacementLog();
+        if(field_log != nullptr) {
+            if(placement_log != nullptr) {
+                dbg_debug(m_logger, "PersistentRegistry: more than one delta field, so no placement log for {}", m_subgroupPrefix);
+                return nullptr;
+            }
+            placement_log = field_log;
+        }
+    }
+    return placement_log;
+}
+
 void PersistentRegistry::registerPersistent(const std::string& obj_name,
                                             PersistentObject* persistent_object) {
     std::size_t key = std::hash<std::string>{}(obj_name);
@@ -3,6 +3,7 @@
 #include <derecho/persistent/Persistent.hpp>
 #include <derecho/openssl/signature.hpp>
 #include <derecho/persistent/detail/util.hpp>
+#include <algorithm>
 #include <iostream>
 #include <signal.h>
 #include <spdlog/spdlog.h>
@@ -11,6 +12,7 @@
 #include <sys/mman.h>
 #include <time.h>
 #include <iomanip>
+#include <vector>
 /**
  * @cond DoxygenSuppressed
  */
@@ -144,7 +146,7 @@ printhelp() {
     cout << "\thlc" << endl;
     cout << "\tnologsave <int-value>" << endl;
     cout << "\tnologload" << endl;
-    cout << "\teval <file|mem> <datasize> <num> [batch]" << endl;
+    cout << "\teval <file|mem|dax> <datasize> <num> [batch]" << endl;
     cout << "\tlogtail-set <value> <version>" << endl;
     cout << "\tlogtail-list" << endl;
     cout << "\tlogtail-serialize [since-ver]" << endl;
@@ -208,6 +210,39 @@ static void nologload() {
 }
 
 static void test_hlc();
+
+/**
+ * Prints percentiles and a power-of-two histogram of append latencies, so
+ * that page fault and block allocation spikes show up in the tail.
+ */
+static void print_latency_histogram(std::vector<uint64_t> latencies_ns) {
+    if(latencies_ns.empty()) {
+        return;
+    }
+    std::sort(latencies_ns.begin(), latencies_ns.end());
+    auto percentile = [&latencies_ns](double p) {
+        return latencies_ns[std::min(latencies_ns.size() - 1, static_cast<std::size_t>(p / 100 * latencies_ns.size()))];
+    };
+    cout << "append latency(ns):\tp50=" << percentile(50) << "\tp99=" << percentile(99)
+         << "\tp99.9=" << percentile(99.9) << "\tmax=" << latencies_ns.back() << endl;
+    std::vector<std::size_t> buckets;
+    for(uint64_t latency : latencies_ns) {
+        std::size_t bucket = 0;
+        while((2ull << bucket) <= latency) {
+            bucket++;
+        }
+        if(buckets.size() <= bucket) {
+            buckets.resize(bucket + 1, 0);
+        }
+        buckets[bucket]++;
+    }
+    for(std::size_t bucket = 0; bucket < buckets.size(); bucket++) {
+        if(buckets[bucket] > 0) {
+            cout << "\t[" << (1ull << bucket) << ", " << (2ull << bucket) << ")ns:\t" << buckets[bucket] << endl;
+        }
+    }
+}
+
 template <StorageType st = ST_FILE>
 static void eval_write(std::size_t osize, int nops, bool batch) {
     VariableBytes writeMe;
@@ -217,9 +252,16 @@ static void eval_write(std::size_t osize, int nops, bool batch) {
     int cnt = nops;
     int64_t ver = pvar.getLatestVersion();
     ver = (ver == INVALID_VERSION) ? 0 : ver + 1;
+    // latency of each set(), which is where the log append happens
+    std::vector<uint64_t> append_ns;
+    append_ns.reserve(nops);
     clock_gettime(CLOCK_REALTIME, &ts);
     while(cnt-- > 0) {
+        struct timespec as, ae;
+        clock_gettime(CLOCK_MONOTONIC, &as);
         pvar.set(writeMe, ver++);
+        clock_gettime(CLOCK_MONOTONIC, &ae);
+        append_ns.push_back((ae.tv_sec - as.tv_sec) * 1000000000ull + ae.tv_nsec - as.tv_nsec);
         if(!batch) pvar.persist(ver-1);
     }
     if(batch) {
@@ -239,6 +281,7 @@ static void eval_write(std::size_t osize, int nops, bool batch) {
     cout << "WRITE TEST(st=" << st << ", size=" << osize << " byte, ops=" << nops << ")" << endl;
     cout << "throughput:\t" << thp_MBPS << " MB/s" << endl;
     cout << "latency:\t" << lat_us << " microseconds" << endl;
+    print_latency_histogram(append_ns);
 }
 
 int main(int argc, char** argv) {
@@ -494,6 +537,8 @@ int main(int argc, char** argv) {
                 eval_write<ST_FILE>(osize, nops, batch);
             } else if(strcmp(argv[2], "mem") == 0) {
                 eval_write<ST_MEM>(osize, nops, batch);
+            } else if(strcmp(argv[2], "dax") == 0) {
+                eval_write<ST_3DXP>(osize, nops, batch);
             } else {
                 cout << "unknown storage type:" << argv[2] << endl;
             }
@@ -20,18 +20,91 @@ extern map<uint16_t, shared_ptr<group>> groups;
 extern mutex groups_lock;
 };  // namespace rdmc
 
+namespace {
+/**
+ * Tracks the priorities of the sends this node is currently the root of, so
+ * that a send can hold back its blocks while a higher-priority send is in
+ * progress. The lock is always acquired after a group's monitor, never before.
+ */
+struct {
+    mutex lock;
+    multiset<uint32_t> active_priorities;
+    // Groups holding back their next block, and their priorities
+    map<uint16_t, uint32_t> deferred_groups;
+} root_sends;
+
+void begin_root_send(uint32_t priority) {
+    unique_lock<mutex> lock(root_sends.lock);
+    root_sends.active_priorities.insert(priority);
+}
+
+/**
+ * Checks whether a higher-priority send is in progress, and if so records
+ * the group as deferred so that it is resumed when that send completes.
+ * @return True if the group should not send its next block yet.
+ */
+bool defer_root_send(uint16_t group_number, uint32_t priority) {
+    unique_lock<mutex> lock(root_sends.lock);
+    if(root_sends.active_priorities.empty() || *root_sends.active_priorities.rbegin() <= priority) {
+        return false;
+    }
+    root_sends.deferred_groups[group_number] = priority;
+    return true;
+}
+
+/**
+ * Removes a completed send from the active set.
+ * @return The deferred groups that no longer have a higher-priority send
+ * ahead of them, which the caller must resume.
+ */
+vector<uint16_t> end_root_send(uint16_t group_number, uint32_t priority) {
+    unique_lock<mutex> lock(root_sends.lock);
+    auto active = root_sends.active_priorities.find(priority);
+    if(active != root_sends.active_priorities.end()) {
+        root_sends.active_priorities.erase(active);
+    }
+    root_sends.deferred_groups.erase(group_number);
+    uint32_t highest = root_sends.active_priorities.empty() ? 0 : *root_sends.active_priorities.rbegin();
+    vector<uint16_t> resumable;
+    for(auto it = root_sends.deferred_groups.begin(); it != root_sends.deferred_groups.end();) {
+        if(it->second >= highest) {
+            resumable.push_back(it->first);
+            it = root_sends.deferred_groups.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return resumable;
+}
+
+void resume_root_sends(const vector<uint16_t>& group_numbers) {
+    for(uint16_t group_number : group_numbers) {
+        shared_ptr<group> g;
+        {
+            unique_lock<mutex> lock(groups_lock);
+            auto it = groups.find(group_number);
+            if(it == groups.end()) continue;
+            g = it->second;
+        }
+        g->resume_send();
+    }
+}
+}  // namespace
+
 decltype(polling_group::message_types) polling_group::message_types;
 
 group::group(uint16_t _group_number, size_t _block_size,
              vector<uint32_t> _members, uint32_t _member_index,
              incoming_message_callback_t upcall,
              completion_callback_t callback,
-             unique_ptr<schedule> _schedule)
+             unique_ptr<schedule> _schedule,
+             uint32_t _priority)
         : members(_members),
           group_number(_group_number),
           block_size(_block_size),
           num_members(members.size()),
           member_index(_member_index),
+          priority(_priority),
           transfer_schedule(std::move(_schedule)),
           completion_callback(callback),
           incoming_message_upcall(upcall) {}
@@ -71,9 +144,10 @@ polling_group::polling_group(uint16_t _group_number, size_t _block_size,
                              vector<uint32_t> _members, uint32_t _member_index,
                              incoming_message_callback_t upcall,
                              completion_callback_t callback,
-                             unique_ptr<schedule> _schedule)
+                             unique_ptr<schedule> _schedule,
+                             uint32_t _priority)
         : group(_group_number, _block_size, _members, _member_index, upcall,
-                callback, std::move(_schedule)),
+                callback, std::move(_schedule), _priority),
           first_block_buffer(nullptr) {
     if(member_index != 0) {
         first_block_buffer = unique_ptr<uint8_t[]>(new uint8_t[block_size]);
@@ -95,6 +169,16 @@ polling_group::polling_group(uint16_t _group_number, size_t _block_size,
         // puts("Issued Ready For Block CCCCCCCCC");
     }
 }
+polling_group::~polling_group() {
+    unique_lock<mutex> lock(monitor);
+    if(member_index == 0 && mr) {
+        // Destroyed in the middle of a send. The groups this send was holding
+        // back may belong to another Group in this process, so resume them.
+        vector<uint16_t> resumable = end_root_send(group_number, priority);
+        lock.unlock();
+        resume_root_sends(resumable);
+    }
+}
 void polling_group::receive_block(uint32_t send_imm, size_t received_block_size) {
     unique_lock<mutex> lock(monitor);
 
@@ -267,6 +351,17 @@ void polling_group::complete_block_send() {
     // message.
     if(!sending && send_step == transfer_schedule->get_total_steps(num_blocks) && (member_index == 0 || num_received_blocks == num_blocks)) {
         complete_message();
+        if(member_index == 0) {
+            vector<uint16_t> resumable = end_root_send(group_number, priority);
+            lock.unlock();
+            resume_root_sends(resumable);
+        }
+    }
+}
+void polling_group::resume_send() {
+    unique_lock<mutex> lock(monitor);
+    if(!sending && mr) {
+        send_next_block();
     }
 }
 void polling_group::send_message(shared_ptr<memory_region> message_mr, size_t offset,
@@ -293,6 +388,7 @@ void polling_group::send_message(shared_ptr<memory_region> message_mr, size_t of
     //        message_size, block_size, num_blocks);
     LOG_EVENT(group_number, message_number, -1, "send_message");
 
+    begin_root_send(priority);
     send_next_block();
     // No need to worry about completion here. We must send at least
     // one block, so we can't be done already.
@@ -321,6 +417,14 @@ void polling_group::send_next_block() {
         return;
     }
 
+    // Only the root holds blocks back; relaying a block we already have is
+    // never delayed, since the rest of the group is waiting on it
+    if(member_index == 0 && defer_root_send(group_number, priority)) {
+        LOG_EVENT(group_number, message_number, block_number,
+                  "preempted_by_higher_priority");
+        return;
+    }
+
     receivers_ready.erase(transfer->target);
     sending = true;
     ++send_step;
@@ -5,6 +5,7 @@
 #include "derecho/rdmc/detail/util.hpp"
 #include "derecho/tcp/tcp.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <arpa/inet.h>
 #include <atomic>
@@ -566,6 +567,7 @@ static std::atomic<bool> polling_loop_shutdown_flag;
 static std::thread polling_thread;
 static void polling_loop() {
     pthread_setname_np(pthread_self(), "rdmc_poll");
+    derecho::pin_thread("rdmc_poll");
 
     const int max_cq_entries = 1024;
     std::unique_ptr<fi_cq_data_entry[]> cq_entries(new fi_cq_data_entry[max_cq_entries]);
@@ -740,7 +742,10 @@ bool lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& ip
 
 void lf_destroy() {
     polling_loop_shutdown_flag = true;
-    polling_thread.join();
+    // the polling thread is detached, so it cannot always be joined
+    if(polling_thread.joinable()) {
+        polling_thread.join();
+    }
 }
 
 std::map<uint32_t, remote_memory_region> lf_exchange_memory_regions(
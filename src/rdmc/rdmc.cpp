@@ -15,6 +15,7 @@
 #include <cmath>
 #include <cstdint>
 #include <cstdio>
+#include <limits>
 #include <map>
 #include <memory>
 #include <mutex>
@@ -34,9 +35,31 @@ atomic<bool> shutdown_flag;
 map<uint16_t, shared_ptr<group>> groups;
 mutex groups_lock;
 
+// the number of initialize() calls not yet matched by a shutdown() call
+uint32_t initialize_count = 0;
+mutex initialize_lock;
+
+// the first group numbers of the ranges reserved by reserve_group_numbers(),
+// protected by groups_lock
+set<uint16_t> reserved_group_number_ranges;
+
   bool initialize(const map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_ports, uint32_t _node_rank) {
+    lock_guard<mutex> lock(initialize_lock);
     if(shutdown_flag) return false;
 
+    if(initialize_count > 0) {
+        // Another group already initialized RDMC in this process: share its
+        // context, only connecting to the nodes that are new to it.
+        if(_node_rank != node_rank) return false;
+        for(const auto& [id, address] : ip_addrs_and_ports) {
+            if(id != node_rank) {
+                add_address(id, address);
+            }
+        }
+        initialize_count++;
+        return true;
+    }
+
     node_rank = _node_rank;
 #ifdef USE_VERBS_API
     if(!::rdma::impl::verbs_initialize(ip_addrs_and_ports, node_rank)) {
@@ -47,6 +70,7 @@ mutex groups_lock;
     }
 
     polling_group::initialize_message_types();
+    initialize_count++;
     return true;
 }
 void add_address(uint32_t index, const std::pair<ip_addr_t, uint16_t>& address) {
@@ -61,7 +85,8 @@ bool create_group(uint16_t group_number, std::vector<uint32_t> members,
                   size_t block_size, send_algorithm algorithm,
                   incoming_message_callback_t incoming_upcall,
                   completion_callback_t callback,
-                  failure_callback_t failure_callback) {
+                  failure_callback_t failure_callback,
+                  uint32_t priority) {
     if(shutdown_flag) return false;
 
     schedule* send_schedule;
@@ -83,19 +108,44 @@ bool create_group(uint16_t group_number, std::vector<uint32_t> members,
     unique_lock<mutex> lock(groups_lock);
     auto g = make_shared<polling_group>(group_number, block_size, members,
                                         member_index, incoming_upcall, callback,
-                                        unique_ptr<schedule>(send_schedule));
+                                        unique_ptr<schedule>(send_schedule), priority);
     auto p = groups.emplace(group_number, std::move(g));
     return p.second;
 }
 
+std::optional<uint16_t> reserve_group_numbers() {
+    unique_lock<mutex> lock(groups_lock);
+    for(uint32_t first = 0; first <= numeric_limits<uint16_t>::max(); first += GROUP_NUMBER_RANGE_SIZE) {
+        if(reserved_group_number_ranges.insert(first).second) {
+            return first;
+        }
+    }
+    return std::nullopt;
+}
+
+void release_group_numbers(uint16_t first_group_number) {
+    unique_lock<mutex> lock(groups_lock);
+    reserved_group_number_ranges.erase(first_group_number);
+}
+
 void destroy_group(uint16_t group_number) {
     if(shutdown_flag) return;
 
-    unique_lock<mutex> lock(groups_lock);
-    LOG_EVENT(group_number, -1, -1, "destroy_group");
-    groups.erase(group_number);
+    shared_ptr<group> g;
+    {
+        unique_lock<mutex> lock(groups_lock);
+        LOG_EVENT(group_number, -1, -1, "destroy_group");
+        auto it = groups.find(group_number);
+        if(it == groups.end()) return;
+        g = std::move(it->second);
+        groups.erase(it);
+    }
+    // The group's destructor may resume other groups' sends, which takes groups_lock
+    g.reset();
 }
 void shutdown() {
+    lock_guard<mutex> lock(initialize_lock);
+    if(initialize_count == 0 || --initialize_count > 0) return;
     shutdown_flag = true;
 #ifdef USE_VERBS_API
     ::rdma::impl::verbs_destroy();
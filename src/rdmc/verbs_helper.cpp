@@ -5,6 +5,7 @@
 #include "derecho/rdmc/detail/util.hpp"
 #include "derecho/tcp/tcp.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <atomic>
 #include <cstring>
@@ -81,6 +82,7 @@ static feature_set supported_features;
 static atomic<bool> polling_loop_shutdown_flag;
 static void polling_loop() {
     pthread_setname_np(pthread_self(), "rdmc_poll");
+    derecho::pin_thread("rdmc_poll");
     TRACE("Spawned main loop");
 
     const int max_work_completions = 1024;
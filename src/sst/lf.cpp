@@ -12,6 +12,7 @@
 #include "derecho/sst/detail/sst_impl.hpp"
 #include "derecho/tcp/tcp.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 #include "derecho/utils/time.h"
 #include "derecho/core/derecho_exception.hpp"
 
@@ -19,6 +20,7 @@
 #include <byteswap.h>
 #include <errno.h>
 #include <iostream>
+#include <mutex>
 #include <rdma/fabric.h>
 #include <rdma/fi_cm.h>
 #include <rdma/fi_domain.h>
@@ -71,7 +73,7 @@ struct cm_con_data_t {
 } __attribute__((packed));
 
 /**
- * Global States
+ * Global States, shared by every Group and ExternalGroupClient in the process
  */
 class lf_ctxt {
 public:
@@ -91,16 +93,34 @@ public:
     struct fi_cq_attr cq_attr;  // completion queue attributes
     // logger pointer
     std::shared_ptr<spdlog::logger> sst_logger;
-    virtual ~lf_ctxt() {
-        lf_destroy();
-    }
+    virtual ~lf_ctxt();
 };
 #define LF_CONFIG_FILE "rdma.cfg"
 #define LF_USE_VADDR ((g_ctxt.fi->domain_attr->mr_mode) & (FI_MR_VIRT_ADDR | FI_MR_BASIC))
 static bool shutdown = false;
 std::thread polling_thread;
-tcp::tcp_connections* sst_connections;
-tcp::tcp_connections* external_client_connections;
+/**
+ * The TCP connection managers of one local node ID. The global states are
+ * shared by all the Groups and ExternalGroupClients in the process, but the
+ * TCP connections are identified by the node IDs at both of their ends.
+ */
+struct node_connections {
+    std::unique_ptr<tcp::tcp_connections> sst_connections;
+    std::unique_ptr<tcp::tcp_connections> external_client_connections;
+    // the number of lf_initialize() calls for this node ID not yet matched by lf_destroy()
+    uint32_t refcount = 0;
+};
+// protects the reference counts, connections_by_node, and the setup and
+// teardown of the global states; declared before g_ctxt so that they outlive
+// g_ctxt's destructor
+static std::mutex lf_ctxt_mutex;
+// the number of lf_initialize() calls not yet matched by lf_destroy()
+static uint32_t lf_ctxt_refcount = 0;
+// the TCP connections of each local node ID that called lf_initialize()
+static std::map<uint32_t, node_connections> connections_by_node;
+// serializes accepting connections on the shared passive endpoint, so that a
+// connection request is accepted by the resources that expect it
+static std::mutex pep_accept_mutex;
 // singleton: global states
 lf_ctxt g_ctxt;
 
@@ -118,6 +138,20 @@ inline void crash_with_message(const char* format_str, ...) {
     exit(-1);
 }
 
+/**
+ * @return The TCP connections of a local node ID, which stay valid until the
+ * last lf_destroy() call for that node ID. Crashes if the node ID has not
+ * called lf_initialize().
+ */
+static node_connections& get_node_connections(uint32_t local_id) {
+    std::lock_guard<std::mutex> lock(lf_ctxt_mutex);
+    auto connections = connections_by_node.find(local_id);
+    if(connections == connections_by_node.end()) {
+        crash_with_message("SST: node %u has not called lf_initialize()\n", local_id);
+    }
+    return connections->second;
+}
+
 /** initialize the context with default value */
 static void default_context() {
     memset((void*)&g_ctxt, 0, sizeof(lf_ctxt));
@@ -224,11 +258,18 @@ void _resources::connect_endpoint(bool is_lf_server) {
     local_cm_data.mr_key = (uint64_t)htonll(this->mr_lwkey);
     local_cm_data.vaddr = (uint64_t)htonll((uint64_t)this->write_buf);  // for pull mode
 
+    // Only one server at a time can wait for a connection on the passive
+    // endpoint; a remote client only connects to it after the exchange.
+    std::unique_lock<std::mutex> accept_lock(pep_accept_mutex, std::defer_lock);
+    if(is_lf_server) {
+        accept_lock.lock();
+    }
+    node_connections& connections = get_node_connections(this->local_id);
     try {
-        if(sst_connections->contains_node(this->remote_id)) {
-            sst_connections->exchange(this->remote_id, local_cm_data, remote_cm_data);
-        } else if(external_client_connections->contains_node(this->remote_id)) {
-            external_client_connections->exchange(this->remote_id, local_cm_data, remote_cm_data);
+        if(connections.sst_connections->contains_node(this->remote_id)) {
+            connections.sst_connections->exchange(this->remote_id, local_cm_data, remote_cm_data);
+        } else if(connections.external_client_connections->contains_node(this->remote_id)) {
+            connections.external_client_connections->exchange(this->remote_id, local_cm_data, remote_cm_data);
         } else {
             dbg_error(sst_logger, "No TCP connection exists with node {}, cannot exchange connection info", this->remote_id);
             crash_with_message("No TCP connection exists with node %d, cannot exchange connection info\n", this->remote_id);
@@ -335,13 +376,17 @@ void _resources::connect_endpoint(bool is_lf_server) {
         fi_freeinfo(client_hints);
         fi_freeinfo(client_info);
     }
-    sync(remote_id);
+    if(accept_lock.owns_lock()) {
+        accept_lock.unlock();
+    }
+    sync(local_id, remote_id);
 }
 
 /**
  * Implementation for Public APIs
  */
 _resources::_resources(
+        uint32_t local_id,
         int r_id,
         uint8_t* write_addr,
         uint8_t* read_addr,
@@ -351,6 +396,7 @@ _resources::_resources(
         : sst_logger(spdlog::get(LoggerFactory::SST_LOGGER_NAME)),
           remote_failed(false),
           remote_id(r_id),
+          local_id(local_id),
           write_buf(write_addr),
           read_buf(read_addr) {
     dbg_trace(sst_logger, "resources constructor: this={}", (void*)this);
@@ -869,29 +915,31 @@ int resources_two_sided::post_receive(lf_completion_entry_ctxt* ctxt, const long
     return ret;
 }
 
-bool add_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
-    return sst_connections->add_node(new_id, new_ip_addr_and_port);
+bool add_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
+    return get_node_connections(local_id).sst_connections->add_node(new_id, new_ip_addr_and_port);
 }
 
-bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
-    return external_client_connections->add_node(new_id, new_ip_addr_and_port);
+bool add_external_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
+    return get_node_connections(local_id).external_client_connections->add_node(new_id, new_ip_addr_and_port);
 }
 
-bool remove_node(uint32_t node_id) {
-    if(sst_connections->contains_node(node_id)) {
-        return sst_connections->delete_node(node_id);
+bool remove_node(uint32_t local_id, uint32_t node_id) {
+    node_connections& connections = get_node_connections(local_id);
+    if(connections.sst_connections->contains_node(node_id)) {
+        return connections.sst_connections->delete_node(node_id);
     } else {
-        return external_client_connections->delete_node(node_id);
+        return connections.external_client_connections->delete_node(node_id);
     }
 }
 
-bool sync(uint32_t r_id) {
+bool sync(uint32_t local_id, uint32_t r_id) {
+    node_connections& connections = get_node_connections(local_id);
     int s = 0, t = 0;
     try {
-        if(sst_connections->contains_node(r_id)) {
-            sst_connections->exchange(r_id, s, t);
-        } else if(external_client_connections->contains_node(r_id)) {
-            external_client_connections->exchange(r_id, s, t);
+        if(connections.sst_connections->contains_node(r_id)) {
+            connections.sst_connections->exchange(r_id, s, t);
+        } else if(connections.external_client_connections->contains_node(r_id)) {
+            connections.external_client_connections->exchange(r_id, s, t);
         } else {
             return false;
         }
@@ -901,12 +949,13 @@ bool sync(uint32_t r_id) {
     return true;
 }
 
-void filter_external_to(const std::vector<node_id_t>& live_nodes_list) {
-    external_client_connections->filter_to(live_nodes_list);
+void filter_external_to(uint32_t local_id, const std::vector<node_id_t>& live_nodes_list) {
+    get_node_connections(local_id).external_client_connections->filter_to(live_nodes_list);
 }
 
 void polling_loop() {
     pthread_setname_np(pthread_self(), "sst_poll");
+    derecho::pin_thread("sst_poll");
     auto sst_logger = spdlog::get(LoggerFactory::SST_LOGGER_NAME);
     dbg_trace(sst_logger, "Polling thread starting.");
 
@@ -1055,43 +1104,35 @@ std::pair<uint32_t, std::pair<int32_t, int32_t>> lf_poll_completion() {
     }
 }
 
-void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& internal_ip_addrs_and_ports,
-                   const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& external_ip_addrs_and_ports,
-                   uint32_t node_id) {
-    // Create SST logger, which must be done exactly once before any SST functions are called
-    auto logger = LoggerFactory::createLogger(LoggerFactory::SST_LOGGER_NAME,
-                                              derecho::getConfString(derecho::Conf::LOGGER_SST_LOG_LEVEL));
-
-    // initialize derecho connection manager
-    // May there be a better design?
-    if(internal_ip_addrs_and_ports.empty()) {
-        sst_connections = new tcp::tcp_connections(node_id);
-    } else {
-        uint16_t my_port = internal_ip_addrs_and_ports.at(node_id).second;
-        sst_connections = new tcp::tcp_connections(node_id, my_port);
-        for(const auto& node_entry : internal_ip_addrs_and_ports) {
-            if(node_entry.first != node_id
-               && !sst_connections->add_node(node_entry.first, node_entry.second)) {
-                // Following the rest of lf_initialize, crash immediately on an error instead of reporting it
-                dbg_error(logger, "lf_initialize could not establish a TCP connection to node {} at {}:{}", node_entry.first, node_entry.second.first, node_entry.second.second);
-                crash_with_message("Failure in LibFabric setup! Could not establish a TCP connection to %s:%u\n", node_entry.second.first.c_str(), node_entry.second.second);
-            }
-        }
+/**
+ * Connects a TCP connection manager of this node to the nodes in
+ * ip_addrs_and_ports other than this node. If addresses are given, the manager
+ * starts listening on this node's port, unless an earlier user of the node ID
+ * already made it listen.
+ */
+static void connect_tcp_nodes(tcp::tcp_connections& connections,
+                              const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_ports,
+                              uint32_t node_id, const std::shared_ptr<spdlog::logger>& logger) {
+    if(!ip_addrs_and_ports.empty()) {
+        connections.start_listening(ip_addrs_and_ports.at(node_id).second);
     }
-    if(external_ip_addrs_and_ports.empty()) {
-        external_client_connections = new tcp::tcp_connections(node_id);
-    } else {
-        uint16_t my_external_port = external_ip_addrs_and_ports.at(node_id).second;
-        external_client_connections = new tcp::tcp_connections(node_id, my_external_port);
-        for(const auto& node_entry : external_ip_addrs_and_ports) {
-            if(node_entry.first != node_id
-               && !external_client_connections->add_node(node_entry.first, node_entry.second)) {
-                dbg_error(logger, "lf_initialize could not establish a TCP connection to node {} at {}:{}", node_entry.first, node_entry.second.first, node_entry.second.second);
-                crash_with_message("Failure in LibFabric setup! Could not establish a TCP connection to %s:%u\n", node_entry.second.first.c_str(), node_entry.second.second);
-            }
+    for(const auto& node_entry : ip_addrs_and_ports) {
+        if(node_entry.first != node_id && !connections.contains_node(node_entry.first)
+           && !connections.add_node(node_entry.first, node_entry.second)) {
+            // Following the rest of lf_initialize, crash immediately on an error instead of reporting it
+            dbg_error(logger, "lf_initialize could not establish a TCP connection to node {} at {}:{}", node_entry.first, node_entry.second.first, node_entry.second.second);
+            crash_with_message("Failure in LibFabric setup! Could not establish a TCP connection to %s:%u\n", node_entry.second.first.c_str(), node_entry.second.second);
         }
     }
+}
 
+/**
+ * Sets up the global states: the fabric, domain, completion queue, passive
+ * endpoint, and polling thread. We assume lf_ctxt_mutex is acquired.
+ * @param num_nodes The number of nodes the first user of the context knows
+ * about, used to size the completion queue
+ */
+static void create_context(std::size_t num_nodes) {
     // initialize global resources:
     // STEP 1: initialize with configuration.
     default_context();     // default the context
@@ -1122,7 +1163,7 @@ void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& in
         crash_with_message("SST: failed to get an fi_info data structure.");
     }
 
-    dbg_trace(logger, "going to use virtual address?{}", LF_USE_VADDR);
+    dbg_trace(g_ctxt.sst_logger, "going to use virtual address?{}", LF_USE_VADDR);
     fail_if_nonzero_retry_on_eagain("fi_fabric()", CRASH_ON_FAILURE,
                                     fi_fabric, g_ctxt.fi->fabric_attr, &(g_ctxt.fabric), nullptr);
     fail_if_nonzero_retry_on_eagain("fi_domain()", CRASH_ON_FAILURE,
@@ -1133,8 +1174,7 @@ void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& in
     // by this device". The number is 4194303 (2^22-1) with Mellanox connectx-4 VPI. We hard lift the setting to
     // >=2097151(2^21-1), hoping it works for as many RDMA devices as possible. TODO: find a better approach
     // to determining completion queue size.
-    size_t max_cqe = g_ctxt.fi->tx_attr->size * internal_ip_addrs_and_ports.size()
-                     + g_ctxt.fi->tx_attr->size * external_ip_addrs_and_ports.size();
+    size_t max_cqe = g_ctxt.fi->tx_attr->size * num_nodes;
     g_ctxt.cq_attr.size = (max_cqe > 2097152) ? max_cqe : 2097152;
     fail_if_nonzero_retry_on_eagain("initialize tx completion queue.", REPORT_ON_FAILURE,
                                     fi_cq_open, g_ctxt.domain, &(g_ctxt.cq_attr), &(g_ctxt.cq), nullptr);
@@ -1155,9 +1195,40 @@ void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& in
     }
 
     // STEP 4: start polling thread.
+    shutdown = false;
     polling_thread = std::thread(polling_loop);
 }
 
+void lf_initialize(const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& internal_ip_addrs_and_ports,
+                   const std::map<node_id_t, std::pair<ip_addr_t, uint16_t>>& external_ip_addrs_and_ports,
+                   uint32_t node_id) {
+    // Create SST logger, which must be done before any SST functions are called
+    auto logger = LoggerFactory::createIfAbsent(LoggerFactory::SST_LOGGER_NAME,
+                                                derecho::getConfString(derecho::Conf::LOGGER_SST_LOG_LEVEL));
+    node_connections* connections;
+    {
+        std::lock_guard<std::mutex> lock(lf_ctxt_mutex);
+        // initialize derecho connection managers of this node ID
+        connections = &connections_by_node[node_id];
+        if(connections->refcount++ == 0) {
+            connections->sst_connections = std::make_unique<tcp::tcp_connections>(node_id);
+            connections->external_client_connections = std::make_unique<tcp::tcp_connections>(node_id);
+        }
+        // The fabric, domain, completion queue, passive endpoint, and polling
+        // thread are shared by every user of the context in this process,
+        // whatever its node ID.
+        if(lf_ctxt_refcount++ == 0) {
+            create_context(internal_ip_addrs_and_ports.size() + external_ip_addrs_and_ports.size());
+        } else {
+            dbg_debug(logger, "lf_initialize: node {} attached to the existing fabric context, which now has {} users", node_id, lf_ctxt_refcount);
+        }
+    }
+    // Connecting may wait for other nodes, so don't block the other users of
+    // the context meanwhile
+    connect_tcp_nodes(*connections->sst_connections, internal_ip_addrs_and_ports, node_id, logger);
+    connect_tcp_nodes(*connections->external_client_connections, external_ip_addrs_and_ports, node_id, logger);
+}
+
 void shutdown_polling_thread() {
     shutdown = true;
     if(polling_thread.joinable()) {
@@ -1165,11 +1236,13 @@ void shutdown_polling_thread() {
     }
 }
 
-void lf_destroy() {
+/**
+ * Tears down the global states. We assume lf_ctxt_mutex is acquired.
+ */
+static void release_context() {
     shutdown_polling_thread();
 
-    delete sst_connections;
-    delete external_client_connections;
+    connections_by_node.clear();
 
     // TODO: make sure all resources are destroyed first.
     _resources::global_release();
@@ -1196,11 +1269,34 @@ void lf_destroy() {
     }
     if(g_ctxt.fi) {
         fi_freeinfo(g_ctxt.fi);
-        g_ctxt.hints = nullptr;
+        g_ctxt.fi = nullptr;
     }
     if(g_ctxt.hints) {
         fi_freeinfo(g_ctxt.hints);
         g_ctxt.hints = nullptr;
     }
+    lf_ctxt_refcount = 0;
+}
+
+void lf_destroy(uint32_t node_id) {
+    std::lock_guard<std::mutex> lock(lf_ctxt_mutex);
+    auto connections = connections_by_node.find(node_id);
+    if(connections == connections_by_node.end()) {
+        return;
+    }
+    if(--connections->second.refcount == 0) {
+        connections_by_node.erase(connections);
+    }
+    if(--lf_ctxt_refcount == 0) {
+        release_context();
+    }
+}
+
+lf_ctxt::~lf_ctxt() {
+    // Release the context at exit even if some users never called lf_destroy()
+    std::lock_guard<std::mutex> lock(lf_ctxt_mutex);
+    if(lf_ctxt_refcount > 0) {
+        release_context();
+    }
 }
 }  // namespace sst
@@ -10,6 +10,7 @@
 #include "derecho/sst/detail/sst_impl.hpp"
 #include "derecho/tcp/tcp.hpp"
 #include "derecho/utils/logger.hpp"
+#include "derecho/utils/placement.hpp"
 
 #include <arpa/inet.h>
 #include <byteswap.h>
@@ -20,6 +21,9 @@
 #include <infiniband/verbs.h>
 #include <inttypes.h>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <netdb.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -56,8 +60,37 @@ int ib_port = 1;
 /** GID index to use. */
 int gid_idx = 0;
 
-tcp::tcp_connections* sst_connections;
-tcp::tcp_connections* external_client_connections;
+/**
+ * The TCP connection managers of one local node ID. The global resources are
+ * shared by all the Groups and ExternalGroupClients in the process, but the
+ * TCP connections are identified by the node IDs at both of their ends.
+ */
+struct node_connections {
+    std::unique_ptr<tcp::tcp_connections> sst_connections;
+    std::unique_ptr<tcp::tcp_connections> external_client_connections;
+    /** The number of verbs_initialize() calls for this node ID not yet matched by verbs_destroy() */
+    uint32_t refcount = 0;
+};
+/** Protects the reference counts, connections_by_node, and the setup and teardown of g_res */
+static std::mutex verbs_ctxt_mutex;
+/** The number of verbs_initialize() calls not yet matched by verbs_destroy() */
+static uint32_t verbs_ctxt_refcount = 0;
+/** The TCP connections of each local node ID that called verbs_initialize() */
+static std::map<uint32_t, node_connections> connections_by_node;
+
+/**
+ * @return The TCP connections of a local node ID, which stay valid until the
+ * last verbs_destroy() call for that node ID
+ */
+static node_connections& get_node_connections(uint32_t local_id) {
+    std::lock_guard<std::mutex> lock(verbs_ctxt_mutex);
+    auto connections = connections_by_node.find(local_id);
+    if(connections == connections_by_node.end()) {
+        cerr << "SST: node " << local_id << " has not called verbs_initialize()" << endl;
+        exit(-1);
+    }
+    return connections->second;
+}
 
 //  unsigned int max_time_to_completion = 0;
 
@@ -84,6 +117,8 @@ static bool shutdown = false;
  * Initializes the resources. Registers write_addr and read_addr as the read
  * and write buffers and connects a queue pair with the specified remote node.
  *
+ * @param local_id The node ID of the local node, whose TCP connections are
+ * used to exchange the queue pair information.
  * @param r_index The node rank of the remote node to connect to.
  * @param write_addr A pointer to the memory to use as the write buffer. This
  * is where data should be written locally in order to send it in an RDMA write
@@ -93,10 +128,11 @@ static bool shutdown = false;
  * @param size_w The size of the write buffer (in bytes).
  * @param size_r The size of the read buffer (in bytes).
  */
-_resources::_resources(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+_resources::_resources(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
                        int size_r)
         : remote_failed(false),
           remote_index(r_index),
+          local_id(local_id),
           write_buf(write_addr),
           read_buf(read_addr) {
     if(!write_buf) {
@@ -286,8 +322,13 @@ void _resources::connect_qp() {
     local_con_data.qp_num = htonl(qp->qp_num);
     local_con_data.lid = htons(g_res->port_attr.lid);
     memcpy(local_con_data.gid, &my_gid, 16);
+    node_connections& connections = get_node_connections(local_id);
     try {
-        sst_connections->exchange(remote_index, local_con_data, tmp_con_data);
+        if(connections.sst_connections->contains_node(remote_index)) {
+            connections.sst_connections->exchange(remote_index, local_con_data, tmp_con_data);
+        } else {
+            connections.external_client_connections->exchange(remote_index, local_con_data, tmp_con_data);
+        }
     } catch(tcp::socket_error&) {
         cout << "Could not exchange qp data in connect_qp" << endl;
     }
@@ -311,7 +352,7 @@ void _resources::connect_qp() {
     // sync to make sure that both sides are in states that they can connect to
     // prevent packet loss
     // just send a dummy char back and forth
-    bool success = sync(remote_index);
+    bool success = sync(local_id, remote_index);
     if(!success) {
         cout << "Could not sync in connect_qp after qp transition to RTS state" << endl;
     }
@@ -388,8 +429,8 @@ int _resources::post_remote_send(verbs_sender_ctxt* sctxt, const long long int o
     return ret;
 }
 
-resources::resources(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
-                     int size_r) : _resources(r_index, write_addr, read_addr, size_w, size_r) {
+resources::resources(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+                     int size_r) : _resources(local_id, r_index, write_addr, read_addr, size_w, size_r) {
 }
 
 void resources::report_failure() {
@@ -454,8 +495,8 @@ void resources::post_remote_write_with_completion(verbs_sender_ctxt* sctxt, cons
     }
 }
 
-resources_two_sided::resources_two_sided(int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
-                                         int size_r) : _resources(r_index, write_addr, read_addr, size_w, size_r) {
+resources_two_sided::resources_two_sided(uint32_t local_id, int r_index, uint8_t* write_addr, uint8_t* read_addr, int size_w,
+                                         int size_r) : _resources(local_id, r_index, write_addr, read_addr, size_w, size_r) {
 }
 
 void resources_two_sided::report_failure() {
@@ -538,6 +579,7 @@ void resources_two_sided::post_two_sided_receive(verbs_sender_ctxt* sctxt, const
 
 void polling_loop() {
     pthread_setname_np(pthread_self(), "sst_poll");
+    derecho::pin_thread("sst_poll");
     cout << "Polling thread starting" << endl;
     while(!shutdown) {
         auto ce = verbs_poll_completion();
@@ -700,29 +742,31 @@ void resources_create() {
     polling_thread.detach();
 }
 
-bool add_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
-    return sst_connections->add_node(new_id, new_ip_addr_and_port);
+bool add_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
+    return get_node_connections(local_id).sst_connections->add_node(new_id, new_ip_addr_and_port);
 }
 
-bool add_external_node(uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
-    return external_client_connections->add_node(new_id, new_ip_addr_and_port);
+bool add_external_node(uint32_t local_id, uint32_t new_id, const std::pair<ip_addr_t, uint16_t>& new_ip_addr_and_port) {
+    return get_node_connections(local_id).external_client_connections->add_node(new_id, new_ip_addr_and_port);
 }
 
-bool remove_node(uint32_t node_id) {
-    if(sst_connections->contains_node(node_id)) {
-        return sst_connections->delete_node(node_id);
-    } else if {
-        return external_client_connections->delete_node(node_id);
+bool remove_node(uint32_t local_id, uint32_t node_id) {
+    node_connections& connections = get_node_connections(local_id);
+    if(connections.sst_connections->contains_node(node_id)) {
+        return connections.sst_connections->delete_node(node_id);
+    } else {
+        return connections.external_client_connections->delete_node(node_id);
     }
 }
 
-bool sync(uint32_t r_index) {
+bool sync(uint32_t local_id, uint32_t r_index) {
+    node_connections& connections = get_node_connections(local_id);
     int s = 0, t = 0;
     try {
-        if(sst_connections->contains_node(r_index)) {
-            sst_connections->exchange(r_index, s, t);
-        } else if(external_client_connections->contains_node(r_index)) {
-            external_client_connections->exchange(r_index, s, t);
+        if(connections.sst_connections->contains_node(r_index)) {
+            connections.sst_connections->exchange(r_index, s, t);
+        } else if(connections.external_client_connections->contains_node(r_index)) {
+            connections.external_client_connections->exchange(r_index, s, t);
         } else {
             return false;
         }
@@ -732,8 +776,28 @@ bool sync(uint32_t r_index) {
     return true;
 }
 
-void filter_external_to(const std::vector<node_id_t>& live_nodes_list) {
-    external_client_connections->filter_to(live_nodes_list);
+void filter_external_to(uint32_t local_id, const std::vector<node_id_t>& live_nodes_list) {
+    get_node_connections(local_id).external_client_connections->filter_to(live_nodes_list);
+}
+
+/**
+ * Connects a TCP connection manager of this node to the nodes in
+ * ip_addrs_and_ports other than this node, making it listen on this node's
+ * port if addresses are given.
+ */
+static void connect_tcp_nodes(tcp::tcp_connections& connections,
+                              const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_ports,
+                              uint32_t node_id) {
+    if(ip_addrs_and_ports.empty()) {
+        return;
+    }
+    connections.start_listening(ip_addrs_and_ports.at(node_id).second);
+    for(const auto& node_entry : ip_addrs_and_ports) {
+        if(node_entry.first != node_id && !connections.add_node(node_entry.first, node_entry.second)) {
+            // resources_create has no error reporting other than printing to cerr, so I guess that's what we'll do here
+            cerr << "Failure in verbs_initialize! Could not establish a TCP connection to " << node_entry.second.first << ":" << node_entry.second.second << endl;
+        }
+    }
 }
 
 /**
@@ -743,36 +807,27 @@ void filter_external_to(const std::vector<node_id_t>& live_nodes_list) {
 void verbs_initialize(const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_sst_ports,
                       const std::map<uint32_t, std::pair<ip_addr_t, uint16_t>>& ip_addrs_and_external_ports,
                       uint32_t node_id) {
-    if(ip_addrs_and_sst_ports.empty()) {
-        sst_connections = new tcp::tcp_connections(node_id);
-    } else {
-        uint16_t my_port = ip_addrs_and_sst_ports.at(node_id).second;
-        sst_connections = new tcp::tcp_connections(node_id, my_port);
-        for(const auto& node_entry : ip_addrs_and_sst_ports) {
-            if(!sst_connections->add_node(node_entry.first, node_entry.second)) {
-                // resources_create has no error reporting other than printing to cerr, so I guess that's what we'll do here
-                cerr << "Failure in verbs_initialize! Could not establish a TCP connection to " << node_entry.second.first << ":" << node_entry.second.second << endl;
-            }
+    node_connections* connections;
+    {
+        std::lock_guard<std::mutex> lock(verbs_ctxt_mutex);
+        connections = &connections_by_node[node_id];
+        if(connections->refcount++ == 0) {
+            connections->sst_connections = std::make_unique<tcp::tcp_connections>(node_id);
+            connections->external_client_connections = std::make_unique<tcp::tcp_connections>(node_id);
         }
-    }
-    if(ip_addrs_and_external_ports.empty()) {
-        external_client_connections = new tcp::tcp_connections(node_id);
-    } else {
-        uint16_t my_external_port = ip_addrs_and_external_ports.at(node_id).second;
-        external_client_connections = new tcp::tcp_connections(node_id, my_external_port);
-        for(const auto& node_entry : ip_addrs_and_external_ports) {
-            if(!external_client_connections->add_node(node_entry.first, node_entry.second)) {
-                cerr << "Failure in verbs_initialize! Could not establish a TCP connection to " << node_entry.second.first << ":" << node_entry.second.second << endl;
-            }
+        if(verbs_ctxt_refcount++ == 0) {
+            shutdown = false;
+            // init all of the resources, so cleanup will be easy
+            resources_init();
+            // create resources before using them
+            resources_create();
+            cout << "Initialized global RDMA resources" << endl;
         }
     }
-
-    // init all of the resources, so cleanup will be easy
-    resources_init();
-    // create resources before using them
-    resources_create();
-
-    cout << "Initialized global RDMA resources" << endl;
+    // Connecting may wait for other nodes, so don't block the other users of
+    // the resources meanwhile
+    connect_tcp_nodes(*connections->sst_connections, ip_addrs_and_sst_ports, node_id);
+    connect_tcp_nodes(*connections->external_client_connections, ip_addrs_and_external_ports, node_id);
 }
 
 void shutdown_polling_thread() {
@@ -784,7 +839,18 @@ void shutdown_polling_thread() {
  * This cleans up all the global resources used by the SST system, so it should
  * only be called once all SST instances have been destroyed.
  */
-void verbs_destroy() {
+void verbs_destroy(uint32_t node_id) {
+    std::lock_guard<std::mutex> lock(verbs_ctxt_mutex);
+    auto connections = connections_by_node.find(node_id);
+    if(connections == connections_by_node.end()) {
+        return;
+    }
+    if(--connections->second.refcount == 0) {
+        connections_by_node.erase(connections);
+    }
+    if(--verbs_ctxt_refcount > 0) {
+        return;
+    }
     shutdown = true;
     // int rc;
     // if(g_res->cq) {
@@ -805,8 +871,6 @@ void verbs_destroy() {
     //         cout << "Could not close RDMA device" << endl;
     //     }
     // }
-    delete sst_connections;
-    delete external_client_connections;
     cout << "SST Verbs shutting down" << endl;
 }
 
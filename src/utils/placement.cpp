@@ -0,0 +1,352 @@
+#include "derecho/utils/placement.hpp"
+
+#include "derecho/conf/conf.hpp"
+#include "derecho/utils/logger.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Avoid a dependency on libnuma just for the mbind() constants
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED 1
+#endif
+
+namespace derecho {
+
+namespace {
+
+/** Removes the spaces around a string, since options are usually written with spaces after separators */
+std::string trim_spaces(std::string str) {
+    str.erase(0, str.find_first_not_of(' '));
+    str.erase(str.find_last_not_of(' ') + 1);
+    return str;
+}
+
+/**
+ * Parses one CPU number of a CPU list.
+ * @throws std::logic_error if the number is not a non-negative integer
+ */
+int parse_cpu_number(const std::string& number, const std::string& cpu_list) {
+    std::size_t parsed_length = 0;
+    int cpu = -1;
+    try {
+        cpu = std::stoi(number, &parsed_length);
+    } catch(std::exception&) {
+        parsed_length = 0;
+    }
+    if(number.empty() || parsed_length != number.size() || cpu < 0 || cpu >= CPU_SETSIZE) {
+        throw std::logic_error("Configuration error: \"" + number + "\" in CPU list \"" + cpu_list
+                               + "\" is not a valid CPU number");
+    }
+    return cpu;
+}
+
+/**
+ * Parses a Linux-style CPU list such as "0-3,8,10-11".
+ * @throws std::logic_error if the list is malformed
+ */
+std::vector<int> parse_cpu_list(const std::string& cpu_list) {
+    std::vector<int> cpus;
+    for(const std::string& untrimmed_range : split_string(cpu_list, ",")) {
+        const std::string range = trim_spaces(untrimmed_range);
+        if(range.empty()) {
+            continue;
+        }
+        std::size_t dash_pos = range.find('-');
+        if(dash_pos == std::string::npos) {
+            cpus.emplace_back(parse_cpu_number(range, cpu_list));
+        } else {
+            int first = parse_cpu_number(trim_spaces(range.substr(0, dash_pos)), cpu_list);
+            int last = parse_cpu_number(trim_spaces(range.substr(dash_pos + 1)), cpu_list);
+            if(first > last) {
+                throw std::logic_error("Configuration error: the range \"" + range + "\" in CPU list \"" + cpu_list
+                                       + "\" is empty");
+            }
+            for(int cpu = first; cpu <= last; ++cpu) {
+                cpus.emplace_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+/** Formats a list of CPUs compactly, the inverse of parse_cpu_list */
+std::string format_cpu_list(const std::vector<int>& cpus) {
+    std::ostringstream out;
+    for(std::size_t i = 0; i < cpus.size();) {
+        std::size_t j = i;
+        while(j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1) {
+            ++j;
+        }
+        if(i != 0) {
+            out << ",";
+        }
+        out << cpus[i];
+        if(j != i) {
+            out << "-" << cpus[j];
+        }
+        i = j + 1;
+    }
+    return out.str();
+}
+
+/** Reads the first line of a sysfs file, or returns an empty string if it cannot be read. */
+std::string read_sysfs_line(const std::string& path) {
+    std::ifstream file(path);
+    std::string line;
+    if(file) {
+        std::getline(file, line);
+    }
+    return line;
+}
+
+
+/** The placement of one pinned thread, for the placement report. */
+struct ThreadPlacement {
+    std::string role;
+    pid_t tid;
+    std::string cpus;
+};
+
+std::mutex placements_mutex;
+std::vector<ThreadPlacement> placements;
+
+/** The configuration, parsed once on first use since none of it can change at runtime. */
+struct PlacementConfig {
+    std::map<std::string, std::vector<int>> thread_cpus;
+    bool pin_to_nic_node;
+    int nic_node;
+    std::vector<int> nic_node_cpus;
+    bool bind_buffers;
+    bool huge_pages;
+
+    PlacementConfig()
+            : thread_cpus(parse_thread_cpus(getConfString(Conf::NUMA_THREAD_CPUS))),
+              pin_to_nic_node(getConfBoolean(Conf::NUMA_PIN_TO_NIC_NODE)),
+              nic_node(getConfInt32(Conf::NUMA_NIC_NODE)),
+              bind_buffers(getConfBoolean(Conf::NUMA_BIND_BUFFERS)),
+              huge_pages(getConfBoolean(Conf::RDMA_HUGE_PAGES)) {
+        if(nic_node < 0) {
+            //Verbs devices appear under /sys/class/infiniband, everything else under /sys/class/net
+            const std::string& domain = getConfString(Conf::RDMA_DOMAIN);
+            std::string node_str = read_sysfs_line("/sys/class/infiniband/" + domain + "/device/numa_node");
+            if(node_str.empty()) {
+                node_str = read_sysfs_line("/sys/class/net/" + domain + "/device/numa_node");
+            }
+            //sysfs reports -1 for devices on non-NUMA hosts
+            nic_node = node_str.empty() ? -1 : std::stoi(node_str);
+        }
+        if(nic_node >= 0) {
+            nic_node_cpus = parse_cpu_list(read_sysfs_line("/sys/devices/system/node/node" + std::to_string(nic_node) + "/cpulist"));
+        }
+        //The single-word node mask passed to mbind() can only name nodes 0-63
+        bind_buffers = bind_buffers && nic_node >= 0 && nic_node < 64;
+    }
+};
+
+const PlacementConfig& get_placement_config() {
+    static const PlacementConfig config;
+    return config;
+}
+
+}  // namespace
+
+std::map<std::string, std::vector<int>> parse_thread_cpus(const std::string& thread_cpus_option) {
+    std::map<std::string, std::vector<int>> thread_cpus;
+    for(const std::string& entry : split_string(thread_cpus_option, ";")) {
+        if(trim_spaces(entry).empty()) {
+            continue;
+        }
+        std::size_t colon_pos = entry.find(':');
+        if(colon_pos == std::string::npos) {
+            throw std::logic_error("Configuration error: the entry \"" + entry + "\" in "
+                                   + Conf::NUMA_THREAD_CPUS + " has no CPU list; entries have the form role:cpu_list");
+        }
+        const std::string role = trim_spaces(entry.substr(0, colon_pos));
+        if(role.empty()) {
+            throw std::logic_error("Configuration error: the entry \"" + entry + "\" in "
+                                   + Conf::NUMA_THREAD_CPUS + " has no thread role");
+        }
+        thread_cpus[role] = parse_cpu_list(entry.substr(colon_pos + 1));
+    }
+    return thread_cpus;
+}
+
+void pin_thread(const std::string& role) {
+    const PlacementConfig& config = get_placement_config();
+    const std::vector<int>* cpus = nullptr;
+    auto role_cpus = config.thread_cpus.find(role);
+    if(role_cpus != config.thread_cpus.end()) {
+        cpus = &role_cpus->second;
+    } else if(config.pin_to_nic_node && !config.nic_node_cpus.empty()) {
+        cpus = &config.nic_node_cpus;
+    }
+    if(cpus == nullptr || cpus->empty()) {
+        return;
+    }
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for(int cpu : *cpus) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    if(ret != 0) {
+        dbg_default_warn("Failed to pin thread {} to CPUs {}: error {}", role, format_cpu_list(*cpus), ret);
+        return;
+    }
+    dbg_default_debug("Pinned thread {} to CPUs {}", role, format_cpu_list(*cpus));
+    std::lock_guard<std::mutex> lock(placements_mutex);
+    placements.emplace_back(ThreadPlacement{role, static_cast<pid_t>(syscall(SYS_gettid)), format_cpu_list(*cpus)});
+}
+
+int get_nic_numa_node() {
+    return get_placement_config().nic_node;
+}
+
+void log_placement_report() {
+    const PlacementConfig& config = get_placement_config();
+    rls_default_info("Placement: NIC {} is on NUMA node {} (CPUs {}); registered buffers are {} and use {} pages",
+                     getConfString(Conf::RDMA_DOMAIN), config.nic_node, format_cpu_list(config.nic_node_cpus),
+                     config.bind_buffers ? "bound to the NIC's node" : "placed by first touch",
+                     config.huge_pages ? "huge" : "regular");
+    std::lock_guard<std::mutex> lock(placements_mutex);
+    if(placements.empty()) {
+        rls_default_info("Placement: no threads are pinned");
+    }
+    for(const ThreadPlacement& placement : placements) {
+        rls_default_info("Placement: thread {} (tid {}) is pinned to CPUs {}", placement.role, placement.tid, placement.cpus);
+    }
+}
+
+namespace {
+
+constexpr std::size_t huge_page_size = 2 * 1024 * 1024;
+constexpr std::size_t small_page_size = 4096;
+
+std::size_t round_up(std::size_t size, std::size_t alignment) {
+    return ((size + alignment - 1) / alignment) * alignment;
+}
+
+/**
+ * Maps a zero-filled anonymous region, backed by huge pages if RDMA/huge_pages
+ * is enabled (falling back to transparent huge pages if no hugetlbfs pages are
+ * reserved), and bound to the NIC's NUMA node if NUMA/bind_buffers is enabled.
+ */
+uint8_t* map_region(std::size_t size) {
+    const PlacementConfig& config = get_placement_config();
+    void* region = MAP_FAILED;
+    if(config.huge_pages) {
+        region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    }
+    if(region == MAP_FAILED) {
+        region = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if(region == MAP_FAILED) {
+            throw std::bad_alloc();
+        }
+        if(config.huge_pages) {
+            madvise(region, size, MADV_HUGEPAGE);
+        }
+    }
+    if(config.bind_buffers) {
+        //Set the policy before anything touches the pages, so they are faulted in on the NIC's node.
+        //mbind() ignores the last bit of maxnode, hence the + 1
+        unsigned long nodemask = 1UL << config.nic_node;
+        if(syscall(SYS_mbind, region, size, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8 + 1, 0) != 0) {
+            dbg_default_warn("mbind failed for a {}-byte buffer, errno {}; using first-touch placement", size, errno);
+        }
+    }
+    return static_cast<uint8_t*>(region);
+}
+
+/**
+ * Carves buffers smaller than a huge page out of shared huge-page chunks, so
+ * that the many small windows and rows Derecho registers don't each round up
+ * to a whole huge page. Released slices are kept on a free list for their
+ * size and handed out again to the next allocation of that size, which is
+ * usually the same buffer being re-created for the next view. Chunks are
+ * never returned to the OS.
+ */
+class HugePagePool {
+    std::mutex pool_mutex;
+    std::map<std::size_t, std::vector<uint8_t*>> free_slices;
+    uint8_t* chunk_cursor = nullptr;
+    std::size_t chunk_remaining = 0;
+
+public:
+    uint8_t* allocate(std::size_t slice_size) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        std::vector<uint8_t*>& free_list = free_slices[slice_size];
+        if(!free_list.empty()) {
+            uint8_t* slice = free_list.back();
+            free_list.pop_back();
+            return slice;
+        }
+        if(chunk_remaining < slice_size) {
+            //Whatever is left of the current chunk is abandoned; it is at most one small slice
+            chunk_cursor = map_region(huge_page_size);
+            chunk_remaining = huge_page_size;
+        }
+        uint8_t* slice = chunk_cursor;
+        chunk_cursor += slice_size;
+        chunk_remaining -= slice_size;
+        return slice;
+    }
+    void release(uint8_t* slice, std::size_t slice_size) {
+        std::lock_guard<std::mutex> lock(pool_mutex);
+        free_slices[slice_size].push_back(slice);
+    }
+};
+
+HugePagePool& get_huge_page_pool() {
+    static HugePagePool pool;
+    return pool;
+}
+
+}  // namespace
+
+uint8_t* allocate_registered_buffer(std::size_t size) {
+    const PlacementConfig& config = get_placement_config();
+    if(config.huge_pages) {
+        if(size < huge_page_size) {
+            return get_huge_page_pool().allocate(round_up(size, small_page_size));
+        }
+        return map_region(round_up(size, huge_page_size));
+    } else if(config.bind_buffers) {
+        return map_region(size);
+    } else {
+        return new uint8_t[size];
+    }
+}
+
+void free_registered_buffer(uint8_t* buffer, std::size_t size) {
+    if(buffer == nullptr) {
+        return;
+    }
+    const PlacementConfig& config = get_placement_config();
+    if(config.huge_pages) {
+        if(size < huge_page_size) {
+            get_huge_page_pool().release(buffer, round_up(size, small_page_size));
+        } else {
+            munmap(buffer, round_up(size, huge_page_size));
+        }
+    } else if(config.bind_buffers) {
+        munmap(buffer, size);
+    } else {
+        delete[] buffer;
+    }
+}
+
+}  // namespace derecho